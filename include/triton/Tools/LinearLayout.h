@@ -722,8 +722,8 @@ public:
 
   std::string toString() const;
 
-  friend bool operator==(LinearLayout lhs, LinearLayout rhs);
-  friend bool operator!=(LinearLayout lhs, LinearLayout rhs) {
+  friend bool operator==(const LinearLayout &lhs, const LinearLayout &rhs);
+  friend bool operator!=(const LinearLayout &lhs, const LinearLayout &rhs) {
     return !(lhs == rhs);
   }
   bool equalIgnoringOutDimSizes(const LinearLayout &other) const;
@@ -743,6 +743,8 @@ private:
 
   [[nodiscard]] std::optional<std::string>
   checkInvariants(bool requireSurjective);
+
+  llvm::MapVector<StringAttr, int32_t> getFreeVariableMasksUncached() const;
 };
 
 inline llvm::raw_ostream &operator<<(llvm::raw_ostream &os,
@@ -137,18 +137,34 @@ public:
   void rewriteSlice(SetVector<Value> &slice, DenseMap<Value, Attribute> &layout,
                     ConvertLayoutOp convertOp);
 
+  // A lookup of an existing conversion while computing a backward slice.
+  struct SliceLookup {
+    Value value;
+    Attribute encoding;
+    // Whether the lookup is for the root operand of the slice.
+    bool isRoot;
+  };
+
   LogicalResult
   getConvertBackwardSlice(OpOperand &root, Attribute rootEncoding,
                           SetVector<Value> &slice,
                           DenseMap<Value, Attribute> &layout,
-                          std::function<bool(Operation *)> stopPropagation);
+                          std::function<bool(Operation *)> stopPropagation,
+                          SmallVectorImpl<SliceLookup> *lookups = nullptr);
 
   LogicalResult getRematerializableSlice(
       OpOperand &root, Attribute rootEncoding, SetVector<Value> &slice,
       DenseMap<Value, Attribute> &layout,
-      std::function<bool(Operation *)> stopPropagation = nullptr);
+      std::function<bool(Operation *)> stopPropagation = nullptr,
+      SmallVectorImpl<SliceLookup> *lookups = nullptr);
 
 private:
+  void addFailedSlice(std::pair<Value, Attribute> key,
+                      SmallVector<SliceLookup> lookups);
+  // Forget failed slices that looked up conversions of `value`. With an
+  // encoding, only lookups in that encoding from inside slices are considered.
+  void invalidateFailedSlices(Value value, Attribute encoding = {});
+
   void updateRematMapping(SmallVector<std::tuple<Value, Value>> &values);
   // Existing tuples of (value, layout) that needs to be updated when recreating
   // scf ops. This prevents keeping track of Values that have been delete when
@@ -161,6 +177,15 @@ private:
   FuncOp funcOp;
   DominanceInfo domInfo;
   PostDominanceInfo postDomInfo;
+  // Backward slices that failed by their root value and encoding. Besides the
+  // IR, a slice only depends on the existing conversions it looks up, so a
+  // failure holds for other conversions of the same value, which are then not
+  // sliced again, until the IR is rewritten or one of its lookups may give a
+  // different result. Lookups from the root can only differ for conversions
+  // that are replaced by an existing one before slicing.
+  DenseMap<std::pair<Value, Attribute>, SmallVector<SliceLookup>> failedSlices;
+  // Looked up value -> failed slices that looked it up.
+  DenseMap<Value, SmallVector<std::pair<Value, Attribute>>> failedSliceLookups;
 };
 
 void LayoutRematerialization::addRematValue(Value old, Attribute encoding,
@@ -168,6 +193,39 @@ void LayoutRematerialization::addRematValue(Value old, Attribute encoding,
   LDBG("addRematValue " << old << " encoding " << encoding << " " << newV);
   rematMapping[{old, encoding}] = newV;
   mappedValues[old] = encoding;
+  invalidateFailedSlices(old, encoding);
+}
+
+void LayoutRematerialization::addFailedSlice(std::pair<Value, Attribute> key,
+                                             SmallVector<SliceLookup> lookups) {
+  for (const SliceLookup &lookup : lookups)
+    failedSliceLookups[lookup.value].push_back(key);
+  failedSlices[key] = std::move(lookups);
+}
+
+void LayoutRematerialization::invalidateFailedSlices(Value value,
+                                                     Attribute encoding) {
+  auto it = failedSliceLookups.find(value);
+  if (it == failedSliceLookups.end())
+    return;
+  SmallVector<std::pair<Value, Attribute>> keys = std::move(it->second);
+  failedSliceLookups.erase(it);
+  SmallVector<std::pair<Value, Attribute>> remainingKeys;
+  for (auto key : keys) {
+    auto failed = failedSlices.find(key);
+    if (failed == failedSlices.end())
+      continue;
+    bool dependsOnValue =
+        !encoding || llvm::any_of(failed->second, [&](const SliceLookup &l) {
+          return l.value == value && l.encoding == encoding && !l.isRoot;
+        });
+    if (dependsOnValue)
+      failedSlices.erase(failed);
+    else
+      remainingKeys.push_back(key);
+  }
+  if (!remainingKeys.empty())
+    failedSliceLookups[value] = std::move(remainingKeys);
 }
 
 // Remove unneeded values now that we are done with the rematMapping.
@@ -781,6 +839,9 @@ void LayoutRematerialization::rewriteSlice(SetVector<Value> &slice,
                                            DenseMap<Value, Attribute> &layout,
                                            ConvertLayoutOp convertOp,
                                            IRMapping &mapping) {
+  // Rewriting erases and recreates ops, which failed slices may traverse.
+  failedSlices.clear();
+  failedSliceLookups.clear();
   SetVector<Operation *> opsToRewrite;
   // Keep track of yield operands that need to be duplicated.
   DenseMap<Operation *, SmallVector<int>> yieldOperandsMap;
@@ -957,11 +1018,14 @@ void LayoutRematerialization::rewriteSlice(SetVector<Value> &slice,
 LogicalResult LayoutRematerialization::getConvertBackwardSlice(
     OpOperand &root, Attribute rootEncoding, SetVector<Value> &slice,
     DenseMap<Value, Attribute> &layout,
-    std::function<bool(Operation *)> stopPropagation) {
+    std::function<bool(Operation *)> stopPropagation,
+    SmallVectorImpl<SliceLookup> *lookups) {
   // Allow re-using existing conversions for a value. Check dominance of any
   // reusable materializations against the root value. This is sufficient
   // because the conversions are processed in post-order.
   auto getExistingConversion = [&](OpOperand &value, Attribute encoding) {
+    if (lookups)
+      lookups->push_back({value.get(), encoding, &value == &root});
     Value remat = getRematValue(value.get(), encoding);
     if (!remat)
       return Value();
@@ -992,9 +1056,10 @@ LogicalResult LayoutRematerialization::getConvertBackwardSlice(
 LogicalResult LayoutRematerialization::getRematerializableSlice(
     OpOperand &root, Attribute rootEncoding, SetVector<Value> &slice,
     DenseMap<Value, Attribute> &layout,
-    std::function<bool(Operation *)> stopPropagation) {
-  LogicalResult result = getConvertBackwardSlice(root, rootEncoding, slice,
-                                                 layout, stopPropagation);
+    std::function<bool(Operation *)> stopPropagation,
+    SmallVectorImpl<SliceLookup> *lookups) {
+  LogicalResult result = getConvertBackwardSlice(
+      root, rootEncoding, slice, layout, stopPropagation, lookups);
   if (result.failed() || slice.empty())
     return failure();
 
@@ -1070,20 +1135,31 @@ void LayoutRematerialization::backwardRematerialization(
   Value newV = getRematValue(oldV, targetType.getEncoding());
   if (newV && domInfo.properlyDominates(newV, convertOp)) {
     // Replace it with the remat'ed value.
+    invalidateFailedSlices(convertOp.getResult());
     convertOp.replaceAllUsesWith(newV);
     opToDelete.insert(convertOp);
     LDBG("found remat'ed value" << newV);
     return;
   }
 
+  std::pair<Value, Attribute> sliceKey{oldV, targetType.getEncoding()};
+  if (failedSlices.contains(sliceKey)) {
+    LDBG("  getRematerializableSlice failed for another conversion");
+    return;
+  }
+
   // 1. Take a backward slice of all the tensor dependencies that can be
   // rematerialized.
   SetVector<Value> slice;
   DenseMap<Value, Attribute> layout;
-  LogicalResult result = getRematerializableSlice(
-      convertOp.getSrcMutable(), targetType.getEncoding(), slice, layout);
+  SmallVector<SliceLookup> lookups;
+  LogicalResult result =
+      getRematerializableSlice(convertOp.getSrcMutable(),
+                               targetType.getEncoding(), slice, layout,
+                               /*stopPropagation=*/nullptr, &lookups);
   if (result.failed()) {
     LDBG("  getRematerializableSlice failed");
+    addFailedSlice(sliceKey, std::move(lookups));
     return;
   }
 
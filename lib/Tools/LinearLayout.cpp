@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #include "mlir/IR/BuiltinAttributes.h"
@@ -866,9 +867,41 @@ LinearLayout lstsq(const LinearLayout &A, const LinearLayout &B) {
   return retFlattened.reshapeIns(retInDims).reshapeOuts(retOutDims);
 }
 
-} // namespace
+// Results of layout functions by their arguments. Layout conversions, e.g. in
+// RemoveLayoutConversions, ask for them repeatedly on the same layouts. Each
+// thread has its own caches, which are cleared when they get full. Results
+// only refer to dim names of their arguments, so an entry is valid whenever
+// its key matches, even if the dims named by the key were freed since.
+template <typename KeyT, typename ValueT> class LayoutCache {
+public:
+  template <typename FnT> ValueT get(const KeyT &key, FnT &&compute) {
+    auto it = cache.find(key);
+    if (it != cache.end())
+      return it->second;
+    ValueT value = compute();
+    if (cache.size() >= MaxEntries)
+      cache.clear();
+    cache.emplace(key, value);
+    return value;
+  }
+
+private:
+  static constexpr size_t MaxEntries = 1024;
+
+  struct Hash {
+    size_t operator()(const LinearLayout &layout) const {
+      return hash_value(layout);
+    }
+    size_t operator()(const std::pair<LinearLayout, LinearLayout> &key) const {
+      return llvm::hash_combine(hash_value(key.first), hash_value(key.second));
+    }
+  };
 
-LinearLayout LinearLayout::invertAndCompose(const LinearLayout &outer) const {
+  std::unordered_map<KeyT, ValueT, Hash> cache;
+};
+
+LinearLayout invertAndComposeUncached(const LinearLayout &B,
+                                      const LinearLayout &outer) {
   // TODO(Lezcano) Make friend and perhaps rename to `convertFrom` or `lstsq`
   // For this, we need to implement our LLVM lowerings by inverting the "outer"
   // layout, and then iterating over the elements from the "this" layout and
@@ -877,9 +910,8 @@ LinearLayout LinearLayout::invertAndCompose(const LinearLayout &outer) const {
   // in lstsq.
 
   // The order of dims does not matter. We choose to transpose outer
-  auto outDims = llvm::to_vector(getOutDimNames());
+  auto outDims = llvm::to_vector(B.getOutDimNames());
   assertDimsEqualIgnoringOrder(outDims, outer.getOutDimNames());
-  const auto &B = *this;
   const auto A = outer.transposeOuts(outDims);
   for (auto dim : outDims) {
     assert(A.getOutDimSize(dim) == B.getOutDimSize(dim) &&
@@ -947,6 +979,15 @@ LinearLayout LinearLayout::invertAndCompose(const LinearLayout &outer) const {
       .transposeOuts(llvm::to_vector(A.getInDimNames()));
 }
 
+} // namespace
+
+LinearLayout LinearLayout::invertAndCompose(const LinearLayout &outer) const {
+  thread_local LayoutCache<std::pair<LinearLayout, LinearLayout>, LinearLayout>
+      cache;
+  return cache.get({*this, outer},
+                   [&] { return invertAndComposeUncached(*this, outer); });
+}
+
 LinearLayout LinearLayout::invert() const {
   assert(isInvertible() &&
          "A linear layout must be surjective and square to be invertible");
@@ -966,6 +1007,13 @@ LinearLayout LinearLayout::pseudoinvert() const {
 
 llvm::MapVector<StringAttr, int32_t>
 LinearLayout::getFreeVariableMasks() const {
+  thread_local LayoutCache<LinearLayout, llvm::MapVector<StringAttr, int32_t>>
+      cache;
+  return cache.get(*this, [&] { return getFreeVariableMasksUncached(); });
+}
+
+llvm::MapVector<StringAttr, int32_t>
+LinearLayout::getFreeVariableMasksUncached() const {
   std::unique_ptr<uint64_t[]> mat = getMatrix(*this);
   int numRows = getTotalOutDimSizeLog2();
   int numCols = getTotalInDimSizeLog2();
@@ -1040,7 +1088,7 @@ size_t hash_value(const LinearLayout &layout) {
   return seed;
 }
 
-bool operator==(LinearLayout lhs, LinearLayout rhs) {
+bool operator==(const LinearLayout &lhs, const LinearLayout &rhs) {
   if (!lhs.equalIgnoringOutDimSizes(rhs))
     return false;
 
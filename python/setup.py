@@ -120,6 +120,13 @@ def check_env_flag(name: str, default: str = "") -> bool:
     return os.getenv(name, default).upper() in ["ON", "1", "YES", "TRUE", "Y"]
 
 
+def get_codegen_backends():
+    # In-tree backends to build, e.g. TRITON_CODEGEN_BACKENDS=cpu builds libtriton without GPU backends, so it
+    # links neither the NVPTX nor the AMDGPU code generators and no NVIDIA toolchain is downloaded.
+    active = os.getenv("TRITON_CODEGEN_BACKENDS", "nvidia;amd;cpu")
+    return [name.strip() for name in re.split(r"[;,]", active) if name.strip()]
+
+
 def get_build_type():
     if check_env_flag("DEBUG"):
         return "Debug"
@@ -317,7 +324,7 @@ def get_thirdparty_packages(packages: list):
 
 
 def download_and_copy(name, src_func, dst_path, variable, version, url_func):
-    if is_offline_build():
+    if is_offline_build() or "nvidia" not in get_codegen_backends():
         return
     triton_cache_path = get_triton_cache_path()
     if variable in os.environ:
@@ -583,7 +590,7 @@ download_and_copy(
     f"https://developer.download.nvidia.com/compute/cuda/redist/cuda_cupti/{system}-{arch}/cuda_cupti-{system}-{arch}-{version}-archive.tar.xz",
 )
 
-backends = [*BackendInstaller.copy(["nvidia", "amd", "cpu"]), *BackendInstaller.copy_externals()]
+backends = [*BackendInstaller.copy(get_codegen_backends()), *BackendInstaller.copy_externals()]
 
 
 def add_link_to_backends():
@@ -607,6 +607,57 @@ makeAtomicRMWOp(pybind11::dtype dtype, const uint64_t *ptr, const void *val,
   return atomic_op;
 }
 
+// Elements of a 1-D array, which may be strided, e.g. when it is broadcast,
+// read without the GIL.
+class StridedElements {
+public:
+  explicit StridedElements(const py::array &array)
+      : data(static_cast<const char *>(array.data())),
+        stride(array.strides(0)) {}
+
+  template <typename T> const T *get(ptrdiff_t i) const {
+    return reinterpret_cast<const T *>(data + i * stride);
+  }
+
+  bool isContiguous(size_t itemsize) const {
+    return stride == static_cast<ptrdiff_t>(itemsize);
+  }
+
+private:
+  const char *data;
+  ptrdiff_t stride;
+};
+
+// Return the end of the run of elements starting at begin that have the same
+// mask as begin and, if it is set, access consecutive addresses. Loads and
+// stores copy a run with a single memcpy, so contiguous block accesses and
+// masked-out tails cost a scan of their pointers instead of a copy per
+// element.
+int accessRunEnd(const StridedElements &ptrs, const StridedElements &masks,
+                 int begin, int numel, size_t itemsize) {
+  bool active = *masks.get<int8_t>(begin);
+  uint64_t next = *ptrs.get<uint64_t>(begin) + itemsize;
+  int end = begin + 1;
+  for (; end < numel; ++end, next += itemsize) {
+    if (static_cast<bool>(*masks.get<int8_t>(end)) != active)
+      break;
+    if (active && *ptrs.get<uint64_t>(end) != next)
+      break;
+  }
+  return end;
+}
+
+// Copy elements [begin, end) of src to consecutive elements at dst.
+void copyElements(char *dst, const StridedElements &src, int begin, int end,
+                  size_t itemsize) {
+  if (src.isContiguous(itemsize)) {
+    memcpy(dst, src.get<char>(begin), (end - begin) * itemsize);
+    return;
+  }
+  for (int i = begin; i < end; ++i, dst += itemsize)
+    memcpy(dst, src.get<char>(i), itemsize);
+}
+
 } // namespace
 
 void init_triton_interpreter(py::module &&m) {
@@ -642,14 +693,24 @@ void init_triton_interpreter(py::module &&m) {
           py::array_t<uint64_t> reshaped_ptr = ptr.reshape({numel});
           py::array_t<bool> reshaped_mask = mask.reshape({numel});
           py::array reshaped_others = other.reshape({numel});
-          for (size_t i = 0; i < ptr.size(); ++i) {
-            if (reshaped_mask.at(i))
-              memcpy(ret.mutable_data(i),
-                     reinterpret_cast<void *>(reshaped_ptr.at(i)),
-                     ret_dtype.itemsize());
-            else
-              memcpy(ret.mutable_data(i), reshaped_others.data(i),
-                     ret_dtype.itemsize());
+          StridedElements ptrs(reshaped_ptr), masks(reshaped_mask),
+              others(reshaped_others);
+          char *ret_data = static_cast<char *>(ret.mutable_data());
+          size_t itemsize = ret_dtype.itemsize();
+          {
+            // Programs run concurrently on interpreter threads.
+            py::gil_scoped_release release;
+            for (int i = 0; i < numel;) {
+              int end = accessRunEnd(ptrs, masks, i, numel, itemsize);
+              char *dst = ret_data + i * itemsize;
+              if (*masks.get<bool>(i))
+                memcpy(dst,
+                       reinterpret_cast<const void *>(*ptrs.get<uint64_t>(i)),
+                       (end - i) * itemsize);
+              else
+                copyElements(dst, others, i, end, itemsize);
+              i = end;
+            }
           }
           return ret.reshape(shape);
         });
@@ -660,11 +721,16 @@ void init_triton_interpreter(py::module &&m) {
           py::array_t<uint64_t> reshaped_ptr = ptr.reshape({numel});
           py::array_t<int8_t> reshaped_mask = mask.reshape({numel});
           py::array reshaped_value = value.reshape({numel});
-          for (size_t i = 0; i < ptr.size(); ++i) {
-            if (reshaped_mask.at(i)) {
-              memcpy(reinterpret_cast<void *>(reshaped_ptr.mutable_at(i)),
-                     reshaped_value.data(i), value.dtype().itemsize());
-            }
+          StridedElements ptrs(reshaped_ptr), masks(reshaped_mask),
+              values(reshaped_value);
+          size_t itemsize = value.dtype().itemsize();
+          py::gil_scoped_release release;
+          for (int i = 0; i < numel;) {
+            int end = accessRunEnd(ptrs, masks, i, numel, itemsize);
+            if (*masks.get<int8_t>(i))
+              copyElements(reinterpret_cast<char *>(*ptrs.get<uint64_t>(i)),
+                           values, i, end, itemsize);
+            i = end;
           }
         });
 
@@ -711,7 +777,10 @@ void init_triton_interpreter(py::module &&m) {
 
 #undef MAKE_ATOMIC_RMW_OP
 
-          atomic_op->apply();
+          {
+            py::gil_scoped_release release;
+            atomic_op->apply();
+          }
           return ret.reshape(shape);
         });
 
@@ -731,10 +800,13 @@ void init_triton_interpreter(py::module &&m) {
           memcpy(static_cast<void *>(ret.mutable_data()),
                  static_cast<const void *>(reshaped_cmp.data()),
                  itemsize * numel);
-          AtomicCASOp(reshaped_ptr.data(), ret.mutable_data(),
-                      static_cast<const void *>(reshaped_val.data()), itemsize,
-                      numel, order)
-              .apply();
+          AtomicCASOp cas_op(reshaped_ptr.data(), ret.mutable_data(),
+                             static_cast<const void *>(reshaped_val.data()),
+                             itemsize, numel, order);
+          {
+            py::gil_scoped_release release;
+            cas_op.apply();
+          }
           return ret.reshape(shape);
         });
 }
@@ -313,7 +313,9 @@ void init_triton_ir(py::module &&m) {
              self.printStackTraceOnDiagnostic(v);
            })
       .def("disable_multithreading",
-           [](MLIRContext &self) { self.disableMultithreading(); });
+           [](MLIRContext &self) { self.disableMultithreading(); })
+      .def("enable_multithreading",
+           [](MLIRContext &self) { self.enableMultithreading(); });
 
   py::class_<SourceMgrDiagnosticHandler>(m, "source_mgr_diag",
                                          py::module_local())
@@ -656,6 +658,13 @@ void init_triton_ir(py::module &&m) {
                return py::none();
              return py::int_(ret.getInt());
            })
+      .def("get_str_attr",
+           [](ModuleOp &self, std::string name) -> py::object {
+             auto ret = self->getAttrOfType<StringAttr>(name);
+             if (!ret)
+               return py::none();
+             return py::str(ret.getValue().str());
+           })
       .def("create_location_snapshot",
            [](ModuleOp &self, const std::string &fileName) -> void {
              generateLocationsFromIR(/*raw_ostream=*/llvm::nulls(),
@@ -1960,7 +1969,14 @@ void init_triton_ir(py::module &&m) {
         if (showStacktraces) {
           context->disableMultithreading();
         }
-        if (failed(self.run(mod.getOperation())))
+        // Passes don't call into Python, release the GIL so that kernels
+        // can be compiled concurrently from several threads.
+        bool failure;
+        {
+          py::gil_scoped_release allow_threads;
+          failure = failed(self.run(mod.getOperation()));
+        }
+        if (failure)
           throw std::runtime_error("PassManager::run failed");
       });
 }
@@ -5,6 +5,8 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/CodeGen/CommandFlags.h"
+#include "llvm/IR/DiagnosticHandler.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
@@ -13,15 +15,18 @@
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/MC/TargetRegistry.h"
+#include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Pass.h"
 #include "llvm/Passes/OptimizationLevel.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/PassPlugin.h"
 #include "llvm/Passes/StandardInstrumentations.h"
 #include "llvm/Support/CodeGen.h"
+#include "llvm/Support/PGOOptions.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/VirtualFileSystem.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/TargetParser/Host.h"
 #include "llvm/Transforms/IPO/AlwaysInliner.h"
@@ -29,10 +34,14 @@
 #include "llvm/Transforms/Instrumentation/AddressSanitizer.h"
 #include "llvm/Transforms/Instrumentation/AddressSanitizerOptions.h"
 #include <csignal>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <stdexcept>
+#include <tuple>
 
 namespace py = pybind11;
 
@@ -100,10 +109,102 @@ createTargetMachine(llvm::Module *module, std::string proc,
   return machine;
 }
 
+// Host target machines of the calling thread by their options, which are
+// reused across compilations since creating them is costly. Target machines
+// aren't thread-safe, so each thread has its own.
+TargetMachine *getHostTargetMachine(llvm::Module *module, bool enable_fp_fusion,
+                                    bool enable_fast_math) {
+  thread_local std::map<std::tuple<bool, bool, bool>,
+                        std::unique_ptr<TargetMachine>>
+      machines;
+  bool disableLLVMOpt = mlir::triton::tools::getBoolEnv("DISABLE_LLVM_OPT");
+  auto &machine =
+      machines[{enable_fp_fusion, enable_fast_math, disableLLVMOpt}];
+  if (!machine)
+    machine = createTargetMachine(module, llvm::sys::getHostCPUName().str(),
+                                  enable_fp_fusion, "", enable_fast_math);
+  return machine.get();
+}
+
+// LLVM contexts reused across compilations. Types and constants live as long
+// as their context, so a context is reused for at most TRITON_CONTEXT_REUSE
+// compilations, 16 by default.
+class ContextPool {
+public:
+  static ContextPool &get() {
+    static ContextPool pool;
+    return pool;
+  }
+
+  llvm::LLVMContext *acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (idle.empty())
+      return new llvm::LLVMContext();
+    auto *context = idle.back();
+    idle.pop_back();
+    return context;
+  }
+
+  void release(llvm::LLVMContext *context) {
+    std::string maxUsesStr =
+        mlir::triton::tools::getStrEnv("TRITON_CONTEXT_REUSE");
+    int maxUses = maxUsesStr.empty() ? 16 : std::stoi(maxUsesStr);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (++uses[context] >= maxUses) {
+      uses.erase(context);
+      delete context;
+      return;
+    }
+    idle.push_back(context);
+  }
+
+private:
+  std::mutex mutex;
+  std::vector<llvm::LLVMContext *> idle;
+  std::map<llvm::LLVMContext *, int> uses;
+};
+
+// Options of PGO instrumentation set for the duration of an instrumented
+// compilation, see pgo_instrument of optimize_module. Value profiling emits
+// calls into the profile runtime, which kernels aren't linked with, and
+// programs of a launch run on several threads, so counters are updated
+// atomically. Options are global, so instrumented compilations are
+// serialized and the previous values are restored afterwards.
+class ScopedPGOInstrOptions {
+public:
+  ScopedPGOInstrOptions() : lock(getMutex()) {
+    auto &options = llvm::cl::getRegisteredOptions();
+    for (const char *name :
+         {"disable-vp", "instrprof-atomic-counter-update-all"}) {
+      auto optIt = options.find(name);
+      if (optIt == options.end())
+        continue;
+      auto *optPtr = static_cast<llvm::cl::opt<bool> *>(optIt->second);
+      saved.emplace_back(optPtr, optPtr->getValue());
+      *optPtr = true;
+    }
+  }
+
+  ~ScopedPGOInstrOptions() {
+    for (auto [optPtr, value] : saved)
+      *optPtr = value;
+  }
+
+private:
+  static std::mutex &getMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  std::lock_guard<std::mutex> lock;
+  llvm::SmallVector<std::pair<llvm::cl::opt<bool> *, bool>, 2> saved;
+};
+
 std::string translateLLVMIRToASM(
     llvm::Module &module, const std::string &triple, const std::string &proc,
     const std::string &features, const std::vector<std::string> &flags,
-    bool enable_fp_fusion, bool isObject, bool enable_fast_math = false) {
+    bool enable_fp_fusion, bool isObject, bool enable_fast_math = false,
+    TargetMachine *hostMachine = nullptr) {
   using namespace mlir;
   // options
   auto options = llvm::cl::getRegisteredOptions();
@@ -165,8 +266,13 @@ std::string translateLLVMIRToASM(
 
   // create machine
   module.setTargetTriple(Triple(triple));
-  auto machine = createTargetMachine(&module, proc, enable_fp_fusion, features,
-                                     enable_fast_math);
+  std::unique_ptr<TargetMachine> ownedMachine;
+  TargetMachine *machine = hostMachine;
+  if (!machine) {
+    ownedMachine = createTargetMachine(&module, proc, enable_fp_fusion,
+                                       features, enable_fast_math);
+    machine = ownedMachine.get();
+  }
   // set data layout
   module.setDataLayout(machine->createDataLayout());
   // emit machine code
@@ -190,12 +296,112 @@ std::string translateLLVMIRToASM(
   return result;
 }
 
+// Code generation statistics of a function of the module.
+struct MachineFunctionStats {
+  int64_t stackSize = 0;
+  int64_t numSpills = 0;
+  int64_t numReloads = 0;
+  int64_t numInstructions = 0;
+  int64_t codeSize = 0;
+};
+
+// Collects statistics of functions from remarks of the prologue and epilogue
+// inserter, the register allocator and the asm printer. Other diagnostics are
+// left to the default handler.
+class MachineStatsHandler : public llvm::DiagnosticHandler {
+public:
+  MachineStatsHandler(std::map<std::string, MachineFunctionStats> &stats)
+      : stats(stats) {}
+
+  static bool isStatsPass(StringRef passName) {
+    return passName == "prologepilog" || passName == "regalloc" ||
+           passName == "asm-printer";
+  }
+
+  bool isAnalysisRemarkEnabled(StringRef passName) const override {
+    return isStatsPass(passName);
+  }
+
+  // Spill counts of the register allocator are missed remarks.
+  bool isMissedOptRemarkEnabled(StringRef passName) const override {
+    return passName == "regalloc";
+  }
+
+  // Remarks emitted with builder callbacks, like the stack size and the spill
+  // ones, are only built when some remarks are enabled.
+  bool isAnyRemarkEnabled() const override { return true; }
+
+  bool handleDiagnostics(const DiagnosticInfo &di) override {
+    auto *remark = dyn_cast<DiagnosticInfoOptimizationBase>(&di);
+    if (!remark || !isStatsPass(remark->getPassName()))
+      return false;
+    auto *located = dyn_cast<DiagnosticInfoWithLocationBase>(&di);
+    if (!located)
+      return true;
+    MachineFunctionStats &fnStats =
+        stats[located->getFunction().getName().str()];
+    // Loops also get spill remarks, which are included in the function ones.
+    StringRef name = remark->getRemarkName();
+    for (const auto &arg : remark->getArgs()) {
+      int64_t val;
+      if (StringRef(arg.Val).getAsInteger(10, val))
+        continue;
+      if (name == "StackSize" && arg.Key == "NumStackBytes")
+        fnStats.stackSize = val;
+      else if (name == "SpillReloadCopies" &&
+               (arg.Key == "NumSpills" || arg.Key == "NumFoldedSpills"))
+        fnStats.numSpills += val;
+      else if (name == "SpillReloadCopies" &&
+               (arg.Key == "NumReloads" || arg.Key == "NumFoldedReloads"))
+        fnStats.numReloads += val;
+      else if (name == "InstructionCount" && arg.Key == "NumInstructions")
+        fnStats.numInstructions = val;
+    }
+    return true;
+  }
+
+private:
+  std::map<std::string, MachineFunctionStats> &stats;
+};
+
+// Add sizes in bytes of the functions of the object file to their stats.
+void addCodeSizes(StringRef obj,
+                  std::map<std::string, MachineFunctionStats> &stats) {
+  auto file = llvm::object::ObjectFile::createObjectFile(
+      llvm::MemoryBufferRef(obj, "kernel.o"));
+  if (!file) {
+    llvm::consumeError(file.takeError());
+    return;
+  }
+  auto *elf = dyn_cast<llvm::object::ELFObjectFileBase>(file->get());
+  if (!elf)
+    return;
+  for (llvm::object::ELFSymbolRef sym : elf->symbols()) {
+    auto name = sym.getName();
+    if (!name) {
+      llvm::consumeError(name.takeError());
+      continue;
+    }
+    auto it = stats.find(name->str());
+    if (it != stats.end())
+      it->second.codeSize = sym.getSize();
+  }
+}
+
 using ret = py::return_value_policy;
 
 void init_triton_llvm(py::module &&m) {
 
   py::class_<llvm::LLVMContext>(m, "context", py::module_local())
       .def(py::init<>());
+  // Contexts of the pool are owned by it. A context acquired from Python must
+  // outlive all modules created in it and is released once they are deleted.
+  m.def(
+      "acquire_context", []() { return ContextPool::get().acquire(); },
+      ret::reference);
+  m.def("release_context", [](llvm::LLVMContext *context) {
+    ContextPool::get().release(context);
+  });
   py::class_<llvm::SourceMgr>(m, "source_mgr", py::module_local())
       .def(py::init<>());
 
@@ -325,7 +531,8 @@ void init_triton_llvm(py::module &&m) {
       "optimize_module",
       [](llvm::Module *mod, const llvm::OptimizationLevel &opt,
          std::string arch, std::string features, std::vector<std::string> flags,
-         bool enable_fp_fusion) {
+         bool enable_fp_fusion, bool pgo_instrument, std::string pgo_profile,
+         bool loop_unrolling, bool slp_vectorization) {
         if (mlir::triton::tools::getBoolEnv("DISABLE_LLVM_OPT"))
           return;
         // Check to see if we are passing a list of flags to disable
@@ -365,8 +572,8 @@ void init_triton_llvm(py::module &&m) {
         }
 
         PipelineTuningOptions tuningOptions;
-        tuningOptions.LoopUnrolling = true;
-        tuningOptions.LoopInterleaving = true;
+        tuningOptions.LoopUnrolling = loop_unrolling;
+        tuningOptions.LoopInterleaving = loop_unrolling;
         tuningOptions.LoopVectorization = true;
         // TODO: currently we run SLP vectorizer with an empty target machine.
         // This cause the vectorizer to create larger vector which could be bad.
@@ -374,7 +581,7 @@ void init_triton_llvm(py::module &&m) {
         // applies some scheduling that helps performance in some cases. We
         // should work on using NVPTX target instead and address the performance
         // regressions with some scheduling solution.
-        tuningOptions.SLPVectorization = true;
+        tuningOptions.SLPVectorization = slp_vectorization;
 
         std::string pluginFile =
             mlir::triton::tools::getStrEnv("LLVM_PASS_PLUGIN_PATH");
@@ -393,8 +600,18 @@ void init_triton_llvm(py::module &&m) {
         if (!arch.empty() && pluginFile.empty())
           targetMachine =
               createTargetMachine(mod, arch, enable_fp_fusion, features);
+        // Instrumented modules count executions of their blocks in counters,
+        // which the caller reads back and writes as a profile for pgo_profile.
+        std::optional<PGOOptions> pgoOptions;
+        if (pgo_instrument) {
+          pgoOptions = PGOOptions("", "", "", "", vfs::getRealFileSystem(),
+                                  PGOOptions::IRInstr);
+        } else if (!pgo_profile.empty()) {
+          pgoOptions = PGOOptions(pgo_profile, "", "", "",
+                                  vfs::getRealFileSystem(), PGOOptions::IRUse);
+        }
         PassBuilder pb(/*targetMachine=*/targetMachine.get(), tuningOptions,
-                       std::nullopt, instrCbPtr);
+                       pgoOptions, instrCbPtr);
 
         if (!pluginFile.empty()) {
           // TODO: Add some logging here that we inserted a pass into the LLVM
@@ -431,6 +648,12 @@ void init_triton_llvm(py::module &&m) {
           mpm.addPass(AddressSanitizerPass(Opts));
         }
         mpm.addPass(pb.buildPerModuleDefaultPipeline(opt));
+        py::gil_scoped_release allow_threads;
+        // Options are taken after releasing the GIL, since other instrumented
+        // compilations release them before taking the GIL back.
+        std::optional<ScopedPGOInstrOptions> pgoInstrOptions;
+        if (pgo_instrument)
+          pgoInstrOptions.emplace();
         mpm.run(*mod, mam);
       },
       // Mandatory parameters
@@ -439,50 +662,108 @@ void init_triton_llvm(py::module &&m) {
       // (optional) parameters
       py::arg("arch") = "", py::arg("features") = "",
       py::arg("flags") = std::vector<std::string>{},
-      py::arg("enable_fp_fusion") = false);
+      py::arg("enable_fp_fusion") = false, py::arg("pgo_instrument") = false,
+      py::arg("pgo_profile") = "",
+      // Cheaper pipelines, e.g. to rank autotuning configs
+      py::arg("loop_unrolling") = true, py::arg("slp_vectorization") = true);
 
   m.def("set_host_target", [](llvm::Module *mod) {
     auto triple = getDefaultTargerOrProcessTriple();
     mod->setTargetTriple(Triple(triple));
-    std::string error;
-    auto target =
-        llvm::TargetRegistry::lookupTarget(mod->getTargetTriple().str(), error);
-    if (!target) {
-      throw std::runtime_error("target lookup error: " + error);
-    }
-    std::unique_ptr<llvm::TargetMachine> machine{target->createTargetMachine(
-        mod->getTargetTriple(), llvm::sys::getHostCPUName(), "", {},
-        llvm::Reloc::PIC_)};
-    mod->setDataLayout(machine->createDataLayout());
+    // The data layout of the host doesn't depend on target options, so it is
+    // computed once.
+    static const std::string dataLayout = [&] {
+      std::string error;
+      auto target = llvm::TargetRegistry::lookupTarget(triple, error);
+      if (!target) {
+        throw std::runtime_error("target lookup error: " + error);
+      }
+      std::unique_ptr<llvm::TargetMachine> machine{target->createTargetMachine(
+          mod->getTargetTriple(), llvm::sys::getHostCPUName(), "", {},
+          llvm::Reloc::PIC_)};
+      return machine->createDataLayout().getStringRepresentation();
+    }();
+    mod->setDataLayout(dataLayout);
   });
 
+  auto translateToHost = [](const std::string &llvmIR, bool enable_fp_fusion,
+                            bool enable_fast_math, bool isObject,
+                            std::map<std::string, MachineFunctionStats> *stats =
+                                nullptr) {
+    // when allow_threads goes out of scope, gil will be released
+    py::gil_scoped_release allow_threads;
+    // create LLVM module from C++
+    llvm::LLVMContext *context = ContextPool::get().acquire();
+    std::string result;
+    {
+      std::unique_ptr<llvm::MemoryBuffer> buffer =
+          llvm::MemoryBuffer::getMemBuffer(llvmIR.c_str());
+      llvm::SMDiagnostic error;
+      std::unique_ptr<llvm::Module> module =
+          llvm::parseIR(buffer->getMemBufferRef(), error, *context);
+      if (!module) {
+        llvm::report_fatal_error(
+            "failed to parse IR: " + error.getMessage() +
+            "lineno: " + std::to_string(error.getLineNo()));
+      }
+      auto triple = getDefaultTargerOrProcessTriple();
+      module->setTargetTriple(Triple(triple));
+      TargetMachine *machine = getHostTargetMachine(
+          module.get(), enable_fp_fusion, enable_fast_math);
+      // Contexts are pooled, so their handler is restored afterwards.
+      std::unique_ptr<llvm::DiagnosticHandler> prevHandler;
+      if (stats) {
+        prevHandler = context->getDiagnosticHandler();
+        context->setDiagnosticHandler(
+            std::make_unique<MachineStatsHandler>(*stats));
+      }
+      result = translateLLVMIRToASM(
+          *module, triple, llvm::sys::getHostCPUName().str(), "", {},
+          enable_fp_fusion, isObject, enable_fast_math, machine);
+      if (stats) {
+        context->setDiagnosticHandler(std::move(prevHandler));
+        if (isObject)
+          addCodeSizes(result, *stats);
+      }
+    }
+    ContextPool::get().release(context);
+    return result;
+  };
+
   m.def(
       "translate_to_host_asm",
-      [](std::string llvmIR, bool enable_fp_fusion,
-         bool enable_fast_math) -> py::object {
-        std::string res;
-        {
-          // when allow_threads goes out of scope, gil will be released
-          py::gil_scoped_release allow_threads;
-          // create LLVM module from C++
-          llvm::LLVMContext context;
-          std::unique_ptr<llvm::MemoryBuffer> buffer =
-              llvm::MemoryBuffer::getMemBuffer(llvmIR.c_str());
-          llvm::SMDiagnostic error;
-          std::unique_ptr<llvm::Module> module =
-              llvm::parseIR(buffer->getMemBufferRef(), error, context);
-          if (!module) {
-            llvm::report_fatal_error(
-                "failed to parse IR: " + error.getMessage() +
-                "lineno: " + std::to_string(error.getLineNo()));
-          }
-          auto triple = getDefaultTargerOrProcessTriple();
-          res = translateLLVMIRToASM(*module, triple,
-                                     llvm::sys::getHostCPUName().str(), "", {},
-                                     enable_fp_fusion, false, enable_fast_math);
+      [=](std::string llvmIR, bool enable_fp_fusion,
+          bool enable_fast_math) -> py::object {
+        return py::str(translateToHost(llvmIR, enable_fp_fusion,
+                                       enable_fast_math, /*isObject=*/false));
+      },
+      ret::take_ownership);
+
+  // Same as translate_to_host_asm, but emits an object file, which saves
+  // printing and parsing the assembly. Stack frame sizes, spills, reloads,
+  // instruction counts and code sizes of functions are added to the stats
+  // dict by function name, if given.
+  m.def(
+      "translate_to_host_object",
+      [=](std::string llvmIR, bool enable_fp_fusion, bool enable_fast_math,
+          py::object stats) -> py::object {
+        std::map<std::string, MachineFunctionStats> fnStats;
+        auto obj = py::bytes(translateToHost(
+            llvmIR, enable_fp_fusion, enable_fast_math, /*isObject=*/true,
+            stats.is_none() ? nullptr : &fnStats));
+        for (auto &[name, fn] : fnStats) {
+          py::dict item;
+          item["stack_size"] = fn.stackSize;
+          item["n_spills"] = fn.numSpills;
+          item["n_reloads"] = fn.numReloads;
+          item["n_instructions"] = fn.numInstructions;
+          item["code_size"] = fn.codeSize;
+          stats[py::str(name)] = item;
         }
-        return py::str(res);
+        return obj;
       },
+      py::arg("llvmIR"), py::arg("enable_fp_fusion"),
+      py::arg("enable_fast_math"), py::arg("stats") = py::none(),
       ret::take_ownership);
 
   m.def(
@@ -545,11 +826,29 @@ void init_triton_llvm(py::module &&m) {
   m.def("init_targets", []() {
     static std::once_flag init_flag;
     std::call_once(init_flag, []() {
+#ifdef TRITON_NATIVE_TARGET_ONLY
+      // GPU code generators aren't linked into builds without GPU backends.
+      llvm::InitializeNativeTarget();
+      llvm::InitializeNativeTargetAsmParser();
+      llvm::InitializeNativeTargetAsmPrinter();
+#else
       llvm::InitializeAllTargetInfos();
       llvm::InitializeAllTargets();
       llvm::InitializeAllTargetMCs();
       llvm::InitializeAllAsmParsers();
       llvm::InitializeAllAsmPrinters();
+#endif
+    });
+  });
+
+  // Initialize only the target of the host, which is all the CPU backend
+  // compiles for, instead of every target LLVM was built with.
+  m.def("init_native_target", []() {
+    static std::once_flag init_flag;
+    std::call_once(init_flag, []() {
+      llvm::InitializeNativeTarget();
+      llvm::InitializeNativeTargetAsmParser();
+      llvm::InitializeNativeTargetAsmPrinter();
     });
   });
 
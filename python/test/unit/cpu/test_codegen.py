@@ -0,0 +1,190 @@
+"""Checks of the instruction mix of host assembly generated for canonical kernels.
+
+Pipeline changes that turn vector loads into gathers, bring back masked accesses of full tiles, make kernels spill,
+or drop dots from AMX don't break the results, so they are checked on the assembly of make_asm instead. Codegen stats
+of the kernel metadata are checked against the assembly too.
+"""
+import os
+import re
+import pytest
+import torch
+
+import triton
+import triton.language as tl
+
+
+def is_interpreter():
+    return os.environ.get('TRITON_INTERPRET', '0') == '1'
+
+
+def is_x86():
+    return not is_interpreter() and \
+        triton.runtime.driver.active.get_current_target().backend == "cpu" and \
+        triton.runtime.driver.active.get_current_target().arch == "x86_64"
+
+
+pytestmark = pytest.mark.skipif(not is_x86(), reason="x86 assembly checks")
+
+
+def get_device_properties():
+    return triton.runtime.driver.active.utils.get_device_properties(0)
+
+
+def instruction_mix(asm):
+    """Return counts of gathers, masked ops, spills and AMX instructions in AT&T assembly of make_asm."""
+    mix = {"gathers": 0, "masked_ops": 0, "spills": 0, "amx": 0}
+    for line in asm.splitlines():
+        # make_asm emits verbose assembly, which annotates spills and reloads in comments.
+        if re.search(r"#.*\b(Spill|Folded Spill)\b", line):
+            mix["spills"] += 1
+        line = line.split("#", 1)[0].strip()
+        if not line or line.startswith(".") or line.endswith(":"):
+            continue
+        mnemonic = line.split()[0]
+        if "gather" in mnemonic or "scatter" in mnemonic:
+            mix["gathers"] += 1
+        # AVX-512 ops write lanes under a mask register, AVX2 ones are mask moves.
+        if re.search(r"\{%k[1-7]\}", line) or re.match(r"vp?maskmov", mnemonic):
+            mix["masked_ops"] += 1
+        if mnemonic.startswith(("tdp", "tileload", "tilestore", "tilezero")):
+            mix["amx"] += 1
+    return mix
+
+
+@triton.jit
+def add_kernel(x_ptr, y_ptr, out_ptr, n, BLOCK: tl.constexpr, MASKED: tl.constexpr):
+    offs = tl.program_id(0) * BLOCK + tl.arange(0, BLOCK)
+    mask = offs < n if MASKED else None
+    tl.store(out_ptr + offs, tl.load(x_ptr + offs, mask=mask) + tl.load(y_ptr + offs, mask=mask), mask=mask)
+
+
+@pytest.mark.parametrize("masked", [False, True])
+def test_vector_add(masked, device):
+    BLOCK = 256
+    n = 4 * BLOCK + (3 if masked else 0)
+    x = torch.rand((n, ), dtype=torch.float32, device='cpu')
+    y = torch.rand((n, ), dtype=torch.float32, device='cpu')
+    out = torch.empty_like(x)
+    meta = add_kernel[(triton.cdiv(n, BLOCK), )](x, y, out, n, BLOCK, masked)
+    torch.testing.assert_close(out, x + y)
+
+    mix = instruction_mix(meta.asm["asm"])
+    assert mix["gathers"] == 0
+    assert mix["spills"] == 0
+    if not masked:
+        assert mix["masked_ops"] == 0
+
+
+@triton.jit
+def softmax_kernel(x_ptr, out_ptr, stride, BLOCK: tl.constexpr):
+    offs = tl.program_id(0) * stride + tl.arange(0, BLOCK)
+    x = tl.load(x_ptr + offs)
+    x = tl.exp(x - tl.max(x, axis=0))
+    tl.store(out_ptr + offs, x / tl.sum(x, axis=0))
+
+
+def test_softmax(device):
+    rows, BLOCK = 16, 128
+    x = torch.randn((rows, BLOCK), dtype=torch.float32, device='cpu')
+    out = torch.empty_like(x)
+    meta = softmax_kernel[(rows, )](x, out, x.stride(0), BLOCK)
+    torch.testing.assert_close(out, torch.softmax(x, dim=1))
+
+    # Rows are whole blocks, so loads and stores are neither gathers nor masked.
+    mix = instruction_mix(meta.asm["asm"])
+    assert mix["gathers"] == 0
+    assert mix["masked_ops"] == 0
+
+
+@pytest.mark.parametrize("BLOCK", [256, 4096])
+def test_machine_stats(BLOCK, device):
+    n = 4 * BLOCK
+    x = torch.rand((n, ), dtype=torch.float32, device='cpu')
+    out = torch.empty_like(x)
+    meta = softmax_kernel[(4, )](x, out, BLOCK, BLOCK)
+    torch.testing.assert_close(out, torch.softmax(x.reshape(4, BLOCK), dim=1).reshape(-1))
+
+    # Codegen stats are reported in the metadata, spills as counted in the assembly.
+    mix = instruction_mix(meta.asm["asm"])
+    assert (meta.metadata.n_spills > 0) == (mix["spills"] > 0)
+    assert meta.n_spills == meta.metadata.n_spills
+    assert meta.metadata.stack_size >= 0
+    assert meta.metadata.n_instructions > 0
+    assert meta.metadata.code_size >= meta.metadata.n_instructions
+
+
+@triton.jit
+def accumulate_kernel(x_ptr, out_ptr, n, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr):
+    offs = tl.arange(0, BLOCK_M)[:, None] * BLOCK_N + tl.arange(0, BLOCK_N)[None, :]
+    acc = tl.zeros((BLOCK_M, BLOCK_N), dtype=tl.float32)
+    for i in range(0, n):
+        acc += tl.load(x_ptr + i * BLOCK_M * BLOCK_N + offs)
+    tl.store(out_ptr + offs, acc)
+
+
+def test_machine_stats_spills(device):
+    # The accumulator carried by the loop takes many more vector registers than available, so it is spilled.
+    n, BLOCK_M, BLOCK_N = 3, 64, 64
+    x = torch.rand((n, BLOCK_M, BLOCK_N), dtype=torch.float32, device='cpu')
+    out = torch.empty((BLOCK_M, BLOCK_N), dtype=torch.float32, device='cpu')
+    meta = accumulate_kernel[(1, )](x, out, n, BLOCK_M, BLOCK_N)
+    torch.testing.assert_close(out, x.sum(dim=0))
+
+    assert instruction_mix(meta.asm["asm"])["spills"] > 0
+    assert meta.metadata.n_spills > 0
+    assert meta.metadata.n_reloads > 0
+    assert meta.metadata.stack_size > 0
+
+
+@triton.jit
+def matmul_kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr, BLOCK_M: tl.constexpr,
+                  BLOCK_N: tl.constexpr, BLOCK_K: tl.constexpr, ACC_TYPE: tl.constexpr):
+    pid_m = tl.program_id(0)
+    pid_n = tl.program_id(1)
+    a_block = tl.make_block_ptr(a_ptr, (M, K), (K, 1), (pid_m * BLOCK_M, 0), (BLOCK_M, BLOCK_K), (1, 0))
+    b_block = tl.make_block_ptr(b_ptr, (K, N), (N, 1), (0, pid_n * BLOCK_N), (BLOCK_K, BLOCK_N), (1, 0))
+    acc = tl.zeros((BLOCK_M, BLOCK_N), dtype=ACC_TYPE)
+    for _ in range(0, K // BLOCK_K):
+        acc = tl.dot(tl.load(a_block), tl.load(b_block), acc, out_dtype=ACC_TYPE)
+        a_block = tl.advance(a_block, (0, BLOCK_K))
+        b_block = tl.advance(b_block, (BLOCK_K, 0))
+    c_block = tl.make_block_ptr(c_ptr, (M, N), (N, 1), (pid_m * BLOCK_M, pid_n * BLOCK_N), (BLOCK_M, BLOCK_N), (1, 0))
+    tl.store(c_block, acc)
+
+
+@pytest.mark.parametrize("dtype", [torch.float32, torch.bfloat16, torch.float16, torch.int8])
+def test_matmul(dtype, device):
+    props = get_device_properties()
+    features = props["cpu_features"]
+    amx = {torch.bfloat16: "amx_bf16", torch.float16: "amx_fp16", torch.int8: "amx_int8"}.get(dtype)
+
+    M, N, K = 64, 64, 128
+    BLOCK_M, BLOCK_N, BLOCK_K = 16, 32, 32
+    if dtype == torch.int8:
+        a = torch.randint(-128, 128, (M, K), dtype=dtype, device='cpu')
+        b = torch.randint(-128, 128, (K, N), dtype=dtype, device='cpu')
+        c = torch.empty((M, N), dtype=torch.int32, device='cpu')
+        acc_type = tl.int32
+    else:
+        a = torch.randn((M, K), dtype=dtype, device='cpu')
+        b = torch.randn((K, N), dtype=dtype, device='cpu')
+        c = torch.empty((M, N), dtype=torch.float32, device='cpu')
+        acc_type = tl.float32
+    meta = matmul_kernel[(M // BLOCK_M, N // BLOCK_N)](a, b, c, M, N, K, BLOCK_M, BLOCK_N, BLOCK_K, acc_type)
+    if dtype == torch.int8:
+        torch.testing.assert_close(c, (a.long() @ b.long()).int())
+    else:
+        torch.testing.assert_close(c, a.float() @ b.float(), rtol=1e-2, atol=1e-2)
+
+    # Lowerings through oneDNN or XSMM ukernels call into the libraries, so only the inline paths are checked.
+    if os.environ.get("TRITON_CPU_UKERNELS_LIB", "None") != "None":
+        return
+    asm = meta.asm["asm"]
+    mix = instruction_mix(asm)
+    assert mix["gathers"] == 0
+    if amx and props[amx]:
+        assert mix["amx"] > 0
+    elif dtype == torch.int8 and ("avx512vnni" in features or "avxvnni" in features):
+        assert "vpdpbusd" in asm
+    else:
+        assert mix["amx"] == 0
@@ -0,0 +1,1519 @@
+import os
+import re
+import subprocess
+import sys
+import threading
+
+import pytest
+import torch
+
+import triton
+import triton.language as tl
+
+
+def is_interpreter():
+    return os.environ.get('TRITON_INTERPRET', '0') == '1'
+
+
+def is_cpu():
+    return not is_interpreter() and \
+        triton.runtime.driver.active.get_current_target().backend == "cpu"
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("launch_runtime", ["pool", "omp"])
+@pytest.mark.parametrize("schedule", ["static", "steal"])
+@pytest.mark.parametrize("program_order", ["linear", "tiled", "hilbert"])
+@pytest.mark.parametrize("num_threads", [0, 1, 3])
+@pytest.mark.parametrize("grid", [(1, ), (13, ), (5, 3), (4, 11, 2)])
+def test_launch_runtime(launch_runtime, schedule, program_order, num_threads, grid, device):
+
+    @triton.jit
+    def kernel(dst):
+        pid = tl.program_id(0) + tl.program_id(1) * tl.num_programs(0) + \
+            tl.program_id(2) * tl.num_programs(0) * tl.num_programs(1)
+        x = tl.load(dst + pid)
+        tl.store(dst + pid, x + pid + 1)
+
+    full_grid = tuple(grid) + (1, ) * (3 - len(grid))
+    size = full_grid[0] * full_grid[1] * full_grid[2]
+    res = torch.zeros((size, ), dtype=torch.int32, device=device)
+    for _ in range(3):
+        kernel[grid](res, num_threads=num_threads, launch_runtime=launch_runtime, schedule=schedule,
+                     program_order=program_order, program_tile_size=4)
+    ref = torch.arange(1, size + 1, dtype=torch.int32, device=device) * 3
+    assert (res == ref).all()
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("numa_placement_arg", [-1, 0, 1])
+def test_numa_launch(numa_placement_arg, device):
+
+    @triton.jit
+    def kernel(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(src + offs) * 2)
+
+    size = 1 << 16
+    src = torch.rand((size, ), dtype=torch.float32, device=device)
+    res = torch.empty_like(src)
+    triton.runtime.driver.active.utils.numa_first_touch(res)
+    kernel[(size // 128, )](src, res, BLOCK_SIZE=128, numa=True, numa_placement_arg=numa_placement_arg)
+    assert (res == src * 2).all()
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("cpu_mask", [None, "0", "0-1"])
+@pytest.mark.parametrize("thread_placement", [None, "compact", "scatter"])
+@pytest.mark.parametrize("one_thread_per_core", [False, True])
+@pytest.mark.parametrize("core_type", [None, "performance"])
+def test_thread_affinity(cpu_mask, thread_placement, one_thread_per_core, core_type, device):
+
+    @triton.jit
+    def kernel(dst):
+        pid = tl.program_id(0)
+        tl.store(dst + pid, pid)
+
+    res = torch.zeros((37, ), dtype=torch.int32, device=device)
+    kernel[(37, )](res, cpu_mask=cpu_mask, thread_placement=thread_placement, one_thread_per_core=one_thread_per_core,
+                   core_type=core_type)
+    assert (res == torch.arange(37, dtype=torch.int32, device=device)).all()
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_stream_launch(device):
+
+    @triton.jit
+    def kernel(dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(dst + offs) + 1)
+
+    di = triton.runtime.driver.active.get_device_interface()
+    res = torch.zeros((1024, ), dtype=torch.float32, device=device)
+    s = di.Stream()
+    with di.stream(s):
+        for _ in range(10):
+            kernel[(8, )](res, BLOCK_SIZE=128)
+    s.synchronize()
+    assert s.query()
+    assert (res == 10).all()
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_graph_replay(device):
+
+    @triton.jit
+    def kernel(dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(dst + offs) + 1)
+
+    di = triton.runtime.driver.active.get_device_interface()
+    res = torch.zeros((1024, ), dtype=torch.float32, device=device)
+    g = di.Graph()
+    with g.capture():
+        for _ in range(3):
+            kernel[(8, )](res, BLOCK_SIZE=128)
+    assert len(g) == 3
+    assert (res == 0).all()
+    for _ in range(4):
+        g.replay()
+    assert (res == 12).all()
+    s = di.Stream()
+    g.replay(s)
+    s.synchronize()
+    assert (res == 15).all()
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("generic_launcher", ["0", "1"])
+def test_range_dependency(generic_launcher, device, monkeypatch):
+    monkeypatch.setenv("TRITON_CPU_GENERIC_LAUNCHER", generic_launcher)
+
+    @triton.jit
+    def producer(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(src + offs) * 2)
+
+    @triton.jit
+    def consumer(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(src + offs) + 1)
+
+    di = triton.runtime.driver.active.get_device_interface()
+    x = torch.arange(4096, dtype=torch.float32, device=device)
+    y = torch.zeros_like(x)
+    z = torch.zeros_like(x)
+    dep = di.RangeDependency()
+    s1, s2 = di.Stream(), di.Stream()
+    # Consumer programs process blocks twice as large, 2 of them per chunk of 4 producer programs. Rounds pair
+    # launches, so the consumer of each round reads the output of its producer.
+    for i in range(3):
+        with di.stream(s2), dep.consume(programs_per_chunk=2):
+            consumer[(8, )](y, z, BLOCK_SIZE=512)
+        with di.stream(s1), dep.produce(programs_per_chunk=4):
+            producer[(16, )](x, y, BLOCK_SIZE=256)
+        s1.synchronize()
+        s2.synchronize()
+        assert (z == x * 2 + 1).all()
+        x += 1
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("generic_launcher", ["0", "1"])
+def test_generic_launcher(generic_launcher, device, monkeypatch):
+    monkeypatch.setenv("TRITON_CPU_GENERIC_LAUNCHER", generic_launcher)
+
+    @triton.jit
+    def kernel(dst, a, b, c, flag, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        val = a + b.to(tl.float32) + c.to(tl.float32)
+        if flag:
+            val = val * 2
+        tl.store(dst + offs, tl.full((BLOCK_SIZE, ), val, tl.float32))
+
+    res = torch.zeros((256, ), dtype=torch.float32, device=device)
+    kernel[(4, )](res, 1.5, -3, 2**40, True, BLOCK_SIZE=64)
+    assert (res == (1.5 - 3 + 2**40) * 2).all()
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("launch_runtime", ["pool", "omp"])
+def test_concurrent_launch(launch_runtime, device):
+
+    @triton.jit
+    def kernel(dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(dst + offs) + 1)
+
+    results = [torch.zeros((1024, ), dtype=torch.float32, device=device) for _ in range(4)]
+
+    def launch(idx):
+        for _ in range(20):
+            kernel[(16, )](results[idx], BLOCK_SIZE=64, launch_runtime=launch_runtime, launch_priority=idx % 2)
+
+    threads = [threading.Thread(target=launch, args=(i, )) for i in range(len(results))]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    for res in results:
+        assert (res == 20).all()
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_launch_batch(device):
+
+    @triton.jit
+    def kernel(dst, val, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(dst + offs) + val)
+
+    results = [torch.zeros((64 * (i + 1), ), dtype=torch.float32, device=device) for i in range(5)]
+    compiled = kernel.warmup(results[0], 1.0, BLOCK_SIZE=64, grid=(1, ))
+    launches = [(compiled, (i + 1, ), (res, float(i), 64)) for i, res in enumerate(results)]
+    triton.runtime.driver.active.launch_batch(launches)
+    for i, res in enumerate(results):
+        assert (res == i).all()
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_launch_trace(device):
+
+    @triton.jit
+    def kernel(dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(dst + offs) + 1)
+
+    di = triton.runtime.driver.active.get_device_interface()
+    res = torch.zeros((1024, ), dtype=torch.float32, device=device)
+    trace = di.LaunchTrace()
+    di.LaunchTrace.enable()
+    try:
+        for _ in range(3):
+            kernel[(8, )](res, BLOCK_SIZE=128)
+    finally:
+        di.LaunchTrace.enable(False)
+    records = trace.read()
+    assert len(records) == 3
+    for rec in records:
+        assert rec.num_programs == 8
+        assert rec.end_ns >= rec.start_ns
+    assert trace.read() == []
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_runtime_stats(device):
+    from triton.backends.cpu import stats
+
+    @triton.jit
+    def stats_kernel(dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(dst + offs) + 1)
+
+    res = torch.zeros((1024, ), dtype=torch.float32, device=device)
+    before = stats.get_stats()
+    for _ in range(3):
+        stats_kernel[(8, )](res, BLOCK_SIZE=128, launch_runtime="pool")
+    interval = stats.diff(stats.get_stats(), before)
+    assert (res == 3).all()
+    assert interval["kernels"]["stats_kernel"]["launches"] == 3
+    assert interval["kernels"]["stats_kernel"]["programs"] == 24
+    assert interval["launches"] >= 3
+    assert interval["kernel_ns"] > 0
+    assert interval["pool_jobs"] >= 3
+    assert 0 < interval["parallel_efficiency"] <= 1
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("launch_runtime", ["pool", "omp"])
+def test_launch_counters(launch_runtime, device):
+
+    @triton.jit
+    def kernel(dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(dst + offs) + 1)
+
+    di = triton.runtime.driver.active.get_device_interface()
+    res = torch.zeros((1024, ), dtype=torch.float32, device=device)
+    trace = di.LaunchTrace()
+    di.LaunchTrace.enable()
+    di.LaunchTrace.enable_counters()
+    try:
+        kernel[(8, )](res, BLOCK_SIZE=128, launch_runtime=launch_runtime)
+    finally:
+        di.LaunchTrace.enable_counters(False)
+        di.LaunchTrace.enable(False)
+    records = trace.read()
+    assert len(records) == 1
+    counters = di.LaunchTrace.counters(records[0])
+    # Counters are unavailable for OpenMP launches and where perf events are restricted.
+    if launch_runtime == "omp":
+        assert counters == {}
+    if counters:
+        assert set(counters) <= set(di.LaunchTrace.counter_names())
+        assert counters["instructions"] > 0
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("schedule", ["static", "steal"])
+def test_timeline(schedule, device, tmp_path):
+
+    @triton.jit
+    def kernel(dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(dst + offs) + 1)
+
+    di = triton.runtime.driver.active.get_device_interface()
+    res = torch.zeros((64 * 37, ), dtype=torch.float32, device=device)
+    kernel[(37, )](res, BLOCK_SIZE=64, schedule=schedule)
+    timeline = di.Timeline()
+    with timeline.record():
+        kernel[(37, )](res, BLOCK_SIZE=64, schedule=schedule)
+    ranges = sorted((event.begin, event.end) for event in timeline.events)
+    assert ranges[0][0] == 0 and ranges[-1][1] == 37
+    assert all(prev[1] == cur[0] for prev, cur in zip(ranges, ranges[1:]))
+    timeline.save_chrome_trace(tmp_path / "trace.json")
+    assert len(timeline.to_chrome_trace()["traceEvents"]) == len(ranges)
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("schedule", ["static", "steal"])
+def test_output_line_alignment(schedule, device):
+
+    @triton.jit
+    def row_sum_kernel(src, dst, BLOCK_SIZE: tl.constexpr):
+        row = tl.program_id(0)
+        tl.store(dst + row, tl.sum(tl.load(src + row * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE))))
+
+    di = triton.runtime.driver.active.get_device_interface()
+    src = torch.rand((100, 32), dtype=torch.float32, device=device)
+    dst = torch.empty((100, ), dtype=torch.float32, device=device)
+    kernel = row_sum_kernel[(100, )](src, dst, BLOCK_SIZE=32, schedule=schedule)
+    # 16 fp32 sums fill a line.
+    assert kernel.metadata.program_align == 16
+    timeline = di.Timeline()
+    with timeline.record():
+        row_sum_kernel[(100, )](src, dst, BLOCK_SIZE=32, schedule=schedule)
+    torch.testing.assert_close(dst, src.sum(dim=1))
+    # Chunks of a thread may be split, but chunks of different threads only meet at line boundaries.
+    ranges = sorted((event.begin, event.end, event.thread) for event in timeline.events)
+    assert all(prev[2] == cur[2] or cur[0] % 16 == 0 for prev, cur in zip(ranges, ranges[1:]))
+
+    kernel = row_sum_kernel[(100, )](src, dst, BLOCK_SIZE=32, align_output_lines=False)
+    assert getattr(kernel.metadata, "program_align", 1) == 1
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_region_records(device):
+    import triton.profiler.language as pl
+
+    @triton.jit
+    def region_kernel(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        pl.record(True, 0)
+        x = tl.load(src + offs)
+        pl.record(False, 0)
+        pl.record(True, 1)
+        tl.store(dst + offs, x * 2)
+        pl.record(False, 1)
+
+    di = triton.runtime.driver.active.get_device_interface()
+    src = torch.rand((1024, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    records = di.RegionRecords()
+    region_kernel[(8, )](src, dst, BLOCK_SIZE=128)
+    assert (dst == src * 2).all()
+    events = records.read()
+    assert len(events) == 8 * 4
+    assert {(event.pid_x, event.region_id) for event in events} == {(pid, r) for pid in range(8) for r in range(2)}
+    times = records.region_times_ns(events)
+    assert set(times) == {("region_kernel", 0), ("region_kernel", 1)}
+    assert all(t >= 0 for t in times.values())
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_perf_map(device, monkeypatch):
+    monkeypatch.setenv("TRITON_CPU_PERF_MAP", "1")
+
+    @triton.jit
+    def perf_map_kernel(dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, offs * 7)
+
+    res = torch.zeros((128, ), dtype=torch.int32, device=device)
+    perf_map_kernel[(2, )](res, BLOCK_SIZE=64)
+    with open(f"/tmp/perf-{os.getpid()}.map") as f:
+        names = [line.split()[2] for line in f]
+    assert any(name.startswith("perf_map_kernel") for name in names)
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_roofline(device):
+
+    @triton.jit
+    def axpy_kernel(x, y, out, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(out + offs, tl.load(x + offs) * 2.0 + tl.load(y + offs))
+
+    x = torch.rand((1024, ), dtype=torch.float32, device=device)
+    y = torch.rand((1024, ), dtype=torch.float32, device=device)
+    out = torch.empty_like(x)
+    kernel = axpy_kernel[(8, )](x, y, out, BLOCK_SIZE=128)
+    assert torch.allclose(out, x * 2.0 + y)
+    # Two loads and a store of 128 fp32 values, a multiply-add per element.
+    assert kernel.metadata.program_bytes == 3 * 128 * 4
+    assert kernel.metadata.program_flops == 2 * 128
+    assert kernel.metadata.program_cost_exact
+
+    di = triton.runtime.driver.active.get_device_interface()
+    report = di.Roofline(peak_gflops=100.0, peak_gbps=10.0).report(kernel, (8, ), 0.001)
+    assert report.flops == 8 * 2 * 128
+    assert report.bytes == 8 * 3 * 128 * 4
+    assert report.bound == "memory"
+    assert "axpy_kernel" in str(report)
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_benchmarker(device):
+
+    @triton.jit
+    def scale_kernel(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(src + offs) * 3)
+
+    src = torch.rand((4096, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    bench = triton.runtime.driver.active.get_device_interface().Benchmarker()
+    stats = bench.do_bench(lambda: scale_kernel[(32, )](src, dst, BLOCK_SIZE=128), warmup=1, rep=5, flush=[src, dst],
+                           return_mode="stats")
+    assert (dst == src * 3).all()
+    assert stats["n"] >= 1
+    assert stats["min"] <= stats["p25"] <= stats["median"] <= stats["p75"] <= stats["max"]
+
+    sweep = bench.do_bench(
+        lambda num_threads: scale_kernel[(32, )](src, dst, BLOCK_SIZE=128, num_threads=num_threads), warmup=1, rep=5,
+        flush=False, num_threads=[1, 2])
+    assert set(sweep) == {1, 2}
+    assert all(ms > 0 for ms in sweep.values())
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_device_properties(device):
+    from triton.language.extra.cpu import get_device_properties
+
+    props = triton.runtime.driver.active.utils.get_device_properties(0)
+    assert props["max_shared_mem"] == 0
+    assert 1 <= props["num_cores"] <= props["num_cpus"]
+    assert props["num_numa_nodes"] >= 1
+    assert props["cache_line_size"] > 0
+    assert props["simd_width"] in (0, 128, 256, 512)
+    assert props["cpu_features"] == sorted(props["cpu_features"])
+    assert get_device_properties() == props
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_backend_hash(device):
+    from triton._C.libtriton import llvm
+    from triton.compiler.compiler import make_backend
+
+    backend = make_backend(triton.runtime.driver.active.get_current_target())
+    # CPU names may contain hyphens, e.g. neoverse-v1.
+    prefix, features_hash = backend.hash().rsplit("-", 1)
+    arch, name = prefix.split("-", 1)
+    assert arch == llvm.get_cpu_tripple().split("-")[0]
+    assert name == llvm.get_cpu_name()
+    assert len(features_hash) == 16
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_isa_variants(device):
+    props = triton.runtime.driver.active.utils.get_device_properties(0)
+    if props["cpu_arch"] != "x86_64" or "avx2" not in props["cpu_features"]:
+        pytest.skip("requires an x86-64 host with AVX2")
+
+    @triton.jit
+    def scale_kernel(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(src + offs) * 3)
+
+    src = torch.rand((1024, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    k = scale_kernel[(8, )](src, dst, BLOCK_SIZE=128, isa_variants=("avx512", "avx2"))
+    assert (dst == src * 3).all()
+    assert k.metadata.isa_variants == ["avx2", "avx512"]
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_aot_compile(device, tmp_path):
+    from triton.backends.cpu.driver import library_dirs
+
+    (tmp_path / "kernel.py").write_text("""
+import triton
+import triton.language as tl
+
+@triton.jit
+def add_one(src, dst, n, BLOCK_SIZE: tl.constexpr):
+    offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+    mask = offs < n
+    tl.store(dst + offs, tl.load(src + offs, mask=mask) + 1, mask=mask)
+""")
+    tools_dir = os.path.dirname(triton.tools.__file__)
+    for sig in ["*fp32:16, *fp32:16, i32, 64", "*fp32, *fp32, i32, 64"]:
+        subprocess.run([
+            sys.executable,
+            os.path.join(tools_dir, "compile.py"), "-n", "add_one", "-s", sig, "-g", "(n + 63) / 64, 1, 1", "-on",
+            "add_one", "-o", "add_one", "kernel.py"
+        ], check=True, cwd=tmp_path)
+    headers = [str(p) for p in tmp_path.glob("add_one.*.h")]
+    subprocess.run([sys.executable, os.path.join(tools_dir, "link.py"), *headers, "-o", "add_one"], check=True,
+                   cwd=tmp_path)
+
+    (tmp_path / "main.c").write_text("""
+#include <stdio.h>
+#include "add_one.h"
+
+int main() {
+  float src[1000], dst[1000];
+  for (int i = 0; i < 1000; ++i)
+    src[i] = i;
+  if (add_one_default(2, src, dst, 1000) != TRITON_CPU_SUCCESS)
+    return 1;
+  for (int i = 0; i < 1000; ++i)
+    if (dst[i] != i + 1)
+      return 2;
+  return 0;
+}
+""")
+    cmd = ["gcc", "main.c", "add_one.c", *map(str, tmp_path.glob("add_one.*.a")), "-o", "main"]
+    for lib_dir in library_dirs:
+        cmd += ["-L", lib_dir, f"-Wl,-rpath,{lib_dir}"]
+    cmd += ["-lTritonCPURuntime", "-lsleef", "-lm"]
+    subprocess.run(cmd, check=True, cwd=tmp_path)
+    subprocess.run([str(tmp_path / "main")], check=True, cwd=tmp_path)
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_lazy_asm(device):
+
+    @triton.jit
+    def copy_kernel(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(src + offs))
+
+    src = torch.rand((128, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    k = copy_kernel[(1, )](src, dst, BLOCK_SIZE=128)
+    assert (dst == src).all()
+    # Kernels are built from object files, assembly is only generated on request.
+    assert "asm" not in k.asm
+    assert "copy_kernel_range" in k.asm["asm"]
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_parallel_autotune(device, monkeypatch):
+    monkeypatch.setenv("TRITON_CPU_COMPILE_THREADS", "4")
+    configs = [triton.Config({"BLOCK_SIZE": 2**i}) for i in range(4, 10)]
+
+    @triton.autotune(configs=configs, key=["n"])
+    @triton.jit
+    def add_kernel(src, dst, n, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offs < n
+        tl.store(dst + offs, tl.load(src + offs, mask=mask) + 1, mask=mask)
+
+    src = torch.rand((1000, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    add_kernel[lambda meta: (triton.cdiv(1000, meta["BLOCK_SIZE"]), )](src, dst, 1000)
+    assert (dst == src + 1).all()
+    assert set(add_kernel.configs_timings) == set(configs)
+    assert all(t[0] < float("inf") for t in add_kernel.configs_timings.values())
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_profile_compile(device, capfd):
+
+    @triton.jit
+    def copy_kernel(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(src + offs))
+
+    src = torch.rand((128, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    k = copy_kernel[(1, )](src, dst, BLOCK_SIZE=128, profile_compile=True)
+    assert (dst == src).all()
+    profile = k.metadata.compile_profile
+    assert [stage for stage, _ in profile["stages"]] == ["ttir", "ttcir", "tttcir", "llir", "so"]
+    passes = {(stage, name): ops for stage, name, _, ops in profile["passes"]}
+    assert passes[("ttir", "canonicalize")] > 0
+    assert passes[("llir", "llvm-O3")] > 0
+    assert passes[("so", "llvmir-to-object")] is None
+    assert "llvm-O3" in capfd.readouterr().err
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_share_stages(device, fresh_triton_cache, monkeypatch):
+    from triton.backends.cpu.compiler import CPUBackend
+
+    make_so = CPUBackend.make_so
+    calls = []
+
+    def counting_make_so(src, metadata, options):
+        calls.append(metadata["name"])
+        return make_so(src, metadata, options)
+
+    monkeypatch.setattr(CPUBackend, "make_so", staticmethod(counting_make_so))
+
+    @triton.jit
+    def copy_kernel(src, dst, BLOCK_SIZE: tl.constexpr, UNUSED: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(src + offs))
+
+    src = torch.rand((128, ), dtype=torch.float32, device=device)
+    kernels = []
+    for unused in (1, 2):
+        dst = torch.empty_like(src)
+        kernels.append(copy_kernel[(1, )](src, dst, BLOCK_SIZE=128, UNUSED=unused))
+        assert (dst == src).all()
+    # The specializations only differ by an unused constexpr, so they are linked once and share the library.
+    assert len(calls) == 1
+    assert kernels[0].hash != kernels[1].hash
+    assert kernels[0].asm["so"] == kernels[1].asm["so"]
+    assert kernels[0].metadata.n_instructions == kernels[1].metadata.n_instructions
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_lazy_ir(device, fresh_triton_cache, monkeypatch):
+    monkeypatch.setenv("TRITON_LAZY_IR", "1")
+
+    @triton.jit
+    def copy_kernel(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(src + offs))
+
+    src = torch.rand((128, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    k = copy_kernel[(1, )](src, dst, BLOCK_SIZE=128)
+    assert (dst == src).all()
+    # The binary is dropped once it is loaded, IRs are read from the cache and built ones aren't kept.
+    assert k.kernel is None
+    assert "llir" in k.asm and "define" in k.asm["llir"]
+    assert isinstance(k.asm["so"], bytes) and len(k.asm["so"]) > 0
+    assert "copy_kernel" in k.asm["asm"]
+    assert "asm" not in k.asm
+    assert all(isinstance(ir, (str, bytes)) for ir in k.asm.values())
+    assert all(isinstance(ir, (str, bytes)) for _, ir in k.asm.items())
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_vector_unroll_limit(device):
+
+    @triton.jit
+    def copy_kernel(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.arange(0, BLOCK_SIZE)[:, None] * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)[None, :]
+        tl.store(dst + offs, tl.load(src + offs) + 1)
+
+    src = torch.rand((128, 128), dtype=torch.float32, device=device)
+    sizes = []
+    for limit in (0, 16):
+        dst = torch.empty_like(src)
+        k = copy_kernel[(1, )](src, dst, BLOCK_SIZE=128, vector_unroll_limit=limit)
+        assert (dst == src + 1).all()
+        sizes.append(len(k.asm["llir"]))
+    # Rows of the block are processed in a loop instead of being unrolled.
+    assert sizes[1] < sizes[0] / 4
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("flush_denormals", [False, True])
+@pytest.mark.parametrize("launch_runtime", ["pool", "omp"])
+def test_flush_denormals(flush_denormals, launch_runtime, device):
+
+    @triton.jit
+    def mul_kernel(x_ptr, y_ptr, out_ptr, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(out_ptr + offs, tl.load(x_ptr + offs) * tl.load(y_ptr + offs))
+
+    tiny = torch.finfo(torch.float32).tiny
+    x = torch.full((1024, ), tiny, dtype=torch.float32, device=device)
+    y = torch.full((1024, ), 0.5, dtype=torch.float32, device=device)
+    out = torch.empty_like(x)
+    mul_kernel[(8, )](x, y, out, BLOCK_SIZE=128, flush_denormals=flush_denormals, launch_runtime=launch_runtime)
+    if flush_denormals:
+        assert (out == 0).all()
+    else:
+        assert (out == tiny / 2).all()
+    # The floating-point environment of the calling thread is restored after the launch.
+    assert (x * y == tiny / 2).all()
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_pgo_warmup(device):
+
+    @triton.jit
+    def relu_kernel(x_ptr, out_ptr, n, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offs < n
+        tl.store(out_ptr + offs, tl.maximum(tl.load(x_ptr + offs, mask=mask), 0.0), mask=mask)
+
+    n = 1000
+    x = torch.randn((n, ), dtype=torch.float32, device=device)
+    out = torch.empty_like(x)
+    grid = (triton.cdiv(n, 128), )
+    for _ in range(4):
+        out.zero_()
+        kernel = relu_kernel[grid](x, out, n, BLOCK_SIZE=128, pgo_warmup=2)
+        torch.testing.assert_close(out, x.clamp(min=0))
+    assert kernel.metadata.pgo_counters
+    # Programs run on several threads, so counters are updated atomically.
+    assert re.search(r"atomicrmw add ptr [^\n]*@__profc_", kernel.asm["llir"])
+    # Launches after the warmup run the kernel recompiled with the profile.
+    recompiled = kernel.run.pgo.kernel
+    assert recompiled is not None
+    assert recompiled.metadata.pgo_profile.endswith(".profdata")
+    assert not hasattr(recompiled.metadata, "pgo_counters")
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("block_ptr", [False, True])
+def test_prefetch_distance(block_ptr, device):
+
+    @triton.jit
+    def row_sum_kernel(src, dst, N, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr, BLOCK_PTR: tl.constexpr):
+        acc = tl.zeros((BLOCK_M, BLOCK_N), dtype=tl.float32)
+        if BLOCK_PTR:
+            ptr = tl.make_block_ptr(src, shape=(BLOCK_M, N), strides=(N, 1), offsets=(0, 0),
+                                    block_shape=(BLOCK_M, BLOCK_N), order=(1, 0))
+            for _ in range(0, N, BLOCK_N):
+                acc += tl.load(ptr)
+                ptr = tl.advance(ptr, (0, BLOCK_N))
+        else:
+            ptrs = src + tl.arange(0, BLOCK_M)[:, None] * N + tl.arange(0, BLOCK_N)[None, :]
+            for _ in range(0, N, BLOCK_N):
+                acc += tl.load(ptrs)
+                ptrs += BLOCK_N
+        tl.store(dst + tl.arange(0, BLOCK_M), tl.sum(acc, axis=1))
+
+    src = torch.rand((16, 256), dtype=torch.float32, device=device)
+    dst = torch.empty((16, ), dtype=torch.float32, device=device)
+    k = row_sum_kernel[(1, )](src, dst, 256, BLOCK_M=16, BLOCK_N=32, BLOCK_PTR=block_ptr, prefetch_distance=2)
+    torch.testing.assert_close(dst, src.sum(dim=1))
+    assert "llvm.prefetch" in k.asm["llir"]
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_streaming_store(device):
+
+    @triton.jit
+    def add_kernel(x_ptr, y_ptr, out_ptr, n, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offs < n
+        out = tl.load(x_ptr + offs, mask=mask) + tl.load(y_ptr + offs, mask=mask)
+        tl.store(out_ptr + offs, out, mask=mask, cache_modifier=".cs")
+
+    # The last block is partial and is stored with a masked store.
+    n = 1000
+    x = torch.rand((n, ), dtype=torch.float32, device=device)
+    y = torch.rand((n, ), dtype=torch.float32, device=device)
+    out = torch.empty_like(x)
+    k = add_kernel[(triton.cdiv(n, 128), )](x, y, out, n, BLOCK_SIZE=128)
+    torch.testing.assert_close(out, x + y)
+    assert "!nontemporal" in k.asm["llir"]
+    assert "fence seq_cst" in k.asm["llir"]
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("hints", [{"eviction_policy": "evict_first"}, {"cache_modifier": ".cs"}, {}])
+def test_streaming_load(hints, device):
+
+    @triton.jit
+    def scale_kernel(x_ptr, out_ptr, n, BLOCK_SIZE: tl.constexpr, EVICT: tl.constexpr, CACHE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offs < n
+        x = tl.load(x_ptr + offs, mask=mask, eviction_policy=EVICT, cache_modifier=CACHE)
+        tl.store(out_ptr + offs, x * 2, mask=mask)
+
+    n = 1000
+    x = torch.rand((n, ), dtype=torch.float32, device=device)
+    out = torch.empty_like(x)
+    k = scale_kernel[(triton.cdiv(n, 128), )](x, out, n, BLOCK_SIZE=128, EVICT=hints.get("eviction_policy", ""),
+                                              CACHE=hints.get("cache_modifier", ""))
+    torch.testing.assert_close(out, x * 2)
+    # Streaming loads prefetch their lines with the non-temporal locality 0, even without a prefetch distance.
+    prefetches = re.findall(r"@llvm\.prefetch\.p0\(ptr [^,]+, i32 0, i32 (\d), i32 1\)", k.asm["llir"])
+    assert bool(prefetches) == bool(hints)
+    assert all(locality == "0" for locality in prefetches)
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_ukernel_cache(device):
+    utils = triton.runtime.driver.active.utils
+    if utils.get_ukernel_cache_stats() is None:
+        pytest.skip("Runtime is built without oneDNN")
+
+    @triton.jit
+    def matmul_kernel(a_ptr, b_ptr, c_ptr, K, M: tl.constexpr, N: tl.constexpr, BLOCK_K: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, BLOCK_K)
+        acc = tl.zeros((M, N), dtype=tl.float32)
+        for k in range(0, K, BLOCK_K):
+            a = tl.load(a_ptr + offs_m[:, None] * K + (k + offs_k)[None, :])
+            b = tl.load(b_ptr + (k + offs_k)[:, None] * N + offs_n[None, :])
+            acc += tl.dot(a, b)
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], acc)
+
+    # Row strides of A are a part of ukernel keys, so each K uses a separate ukernel. With the
+    # capacity of one entry per cache shard, some of them must be evicted.
+    M, N, BLOCK_K = 32, 32, 16
+    before = utils.get_ukernel_cache_stats()
+    utils.set_ukernel_cache_capacity(1)
+    try:
+        for K in range(32, 32 + 17 * BLOCK_K, BLOCK_K):
+            a = torch.randn((M, K), dtype=torch.float32, device=device)
+            b = torch.randn((K, N), dtype=torch.float32, device=device)
+            c = torch.empty((M, N), dtype=torch.float32, device=device)
+            matmul_kernel[(1, )](a, b, c, K, M, N, BLOCK_K, ukernels="OneDNN")
+            torch.testing.assert_close(c, a @ b, rtol=1e-4, atol=1e-4)
+        stats = utils.get_ukernel_cache_stats()
+    finally:
+        utils.set_ukernel_cache_capacity(before["capacity"])
+    assert stats["misses"] >= before["misses"] + 17
+    assert stats["evictions"] > before["evictions"]
+    assert stats["entries"] <= 16
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_ukernel_epilogue(device):
+    if triton.runtime.driver.active.utils.get_ukernel_cache_stats() is None:
+        pytest.skip("Runtime is built without oneDNN")
+
+    @triton.jit
+    def matmul_kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr,
+                      BLOCK_K: tl.constexpr):
+        a_block_ptr = tl.make_block_ptr(base=a_ptr, shape=(M, K), strides=(K, 1), offsets=(0, 0),
+                                        block_shape=(M, BLOCK_K), order=(1, 0))
+        b_block_ptr = tl.make_block_ptr(base=b_ptr, shape=(K, N), strides=(N, 1), offsets=(0, 0),
+                                        block_shape=(BLOCK_K, N), order=(1, 0))
+        c_block_ptr = tl.make_block_ptr(base=c_ptr, shape=(M, N), strides=(N, 1), offsets=(0, 0),
+                                        block_shape=(M, N), order=(1, 0))
+        acc = tl.zeros((M, N), dtype=tl.float32)
+        for _ in range(0, K, BLOCK_K):
+            acc += tl.dot(tl.load(a_block_ptr), tl.load(b_block_ptr))
+            a_block_ptr = tl.advance(a_block_ptr, (0, BLOCK_K))
+            b_block_ptr = tl.advance(b_block_ptr, (BLOCK_K, 0))
+        tl.store(c_block_ptr, tl.maximum(acc * 0.5, 0.0).to(tl.bfloat16))
+
+    M, N, K, BLOCK_K = 32, 32, 128, 32
+    a = torch.randn((M, K), dtype=torch.float32, device=device)
+    b = torch.randn((K, N), dtype=torch.float32, device=device)
+    c = torch.empty((M, N), dtype=torch.bfloat16, device=device)
+    k = matmul_kernel[(1, )](a, b, c, M, N, K, BLOCK_K, ukernels="OneDNN")
+    torch.testing.assert_close(c, torch.relu((a @ b) * 0.5).to(torch.bfloat16), rtol=1e-2, atol=1e-2)
+    # Scaling, activation and downcast are applied by the ukernel writing the output.
+    assert 'postOps = ["linear", "relu"]' in k.asm["tttcir"]
+
+
+@pytest.mark.parametrize("dtype", ["int8", "float8_e5m2"])
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_ukernel_low_precision_dot(dtype, device):
+    if triton.runtime.driver.active.utils.get_ukernel_cache_stats() is None:
+        pytest.skip("Runtime is built without oneDNN")
+
+    @triton.jit
+    def matmul_kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr,
+                      BLOCK_K: tl.constexpr):
+        a_block_ptr = tl.make_block_ptr(base=a_ptr, shape=(M, K), strides=(K, 1), offsets=(0, 0),
+                                        block_shape=(M, BLOCK_K), order=(1, 0))
+        b_block_ptr = tl.make_block_ptr(base=b_ptr, shape=(K, N), strides=(N, 1), offsets=(0, 0),
+                                        block_shape=(BLOCK_K, N), order=(1, 0))
+        c_block_ptr = tl.make_block_ptr(base=c_ptr, shape=(M, N), strides=(N, 1), offsets=(0, 0),
+                                        block_shape=(M, N), order=(1, 0))
+        acc = tl.zeros((M, N), dtype=c_ptr.dtype.element_ty)
+        for _ in range(0, K, BLOCK_K):
+            acc += tl.dot(tl.load(a_block_ptr), tl.load(b_block_ptr), out_dtype=c_ptr.dtype.element_ty)
+            a_block_ptr = tl.advance(a_block_ptr, (0, BLOCK_K))
+            b_block_ptr = tl.advance(b_block_ptr, (BLOCK_K, 0))
+        tl.store(c_block_ptr, acc)
+
+    M, N, K, BLOCK_K = 32, 32, 128, 64
+    if dtype == "int8":
+        a = torch.randint(-8, 8, (M, K), dtype=torch.int8, device=device)
+        b = torch.randint(-8, 8, (K, N), dtype=torch.int8, device=device)
+        c = torch.empty((M, N), dtype=torch.int32, device=device)
+        ref = a.to(torch.int32) @ b.to(torch.int32)
+    else:
+        a = torch.randn((M, K), device=device).to(torch.float8_e5m2)
+        b = torch.randn((K, N), device=device).to(torch.float8_e5m2)
+        c = torch.empty((M, N), dtype=torch.float32, device=device)
+        ref = a.to(torch.float32) @ b.to(torch.float32)
+    k = matmul_kernel[(1, )](a, b, c, M, N, K, BLOCK_K, ukernels="OneDNN")
+    torch.testing.assert_close(c, ref, rtol=1e-4, atol=1e-4)
+    assert "triton_cpu.brgemm_execute" in k.asm["tttcir"]
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_gemm_offload(device):
+    from triton.backends.cpu import stats
+
+    if triton.runtime.driver.active.utils.get_ukernel_cache_stats() is None:
+        pytest.skip("Runtime is built without oneDNN")
+
+    @triton.jit
+    def matmul_kernel(a_ptr, b_ptr, c_ptr, M, N, K, stride_am, stride_ak, stride_bk, stride_bn, stride_cm,
+                      stride_cn, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr, BLOCK_K: tl.constexpr):
+        pid = tl.program_id(0)
+        num_pid_n = tl.cdiv(N, BLOCK_N)
+        pid_m = pid // num_pid_n
+        pid_n = pid % num_pid_n
+        offs_am = (pid_m * BLOCK_M + tl.arange(0, BLOCK_M)) % M
+        offs_bn = (pid_n * BLOCK_N + tl.arange(0, BLOCK_N)) % N
+        offs_k = tl.arange(0, BLOCK_K)
+        a_ptrs = a_ptr + (offs_am[:, None] * stride_am + offs_k[None, :] * stride_ak)
+        b_ptrs = b_ptr + (offs_k[:, None] * stride_bk + offs_bn[None, :] * stride_bn)
+        acc = tl.zeros((BLOCK_M, BLOCK_N), dtype=tl.float32)
+        for k in range(0, tl.cdiv(K, BLOCK_K)):
+            a = tl.load(a_ptrs, mask=offs_k[None, :] < K - k * BLOCK_K, other=0.0)
+            b = tl.load(b_ptrs, mask=offs_k[:, None] < K - k * BLOCK_K, other=0.0)
+            acc = tl.dot(a, b, acc)
+            a_ptrs += BLOCK_K * stride_ak
+            b_ptrs += BLOCK_K * stride_bk
+        offs_cm = pid_m * BLOCK_M + tl.arange(0, BLOCK_M)
+        offs_cn = pid_n * BLOCK_N + tl.arange(0, BLOCK_N)
+        c_ptrs = c_ptr + stride_cm * offs_cm[:, None] + stride_cn * offs_cn[None, :]
+        mask = (offs_cm[:, None] < M) & (offs_cn[None, :] < N)
+        tl.store(c_ptrs, tl.maximum(acc, 0.0).to(tl.float16), mask=mask)
+
+    M, N, K, BLOCK_M, BLOCK_N, BLOCK_K = 100, 72, 60, 32, 32, 16
+    a = torch.randn((M, K), dtype=torch.float16, device=device)
+    b = torch.randn((K, N), dtype=torch.float16, device=device)
+    ref = torch.relu(a.float() @ b.float()).half()
+
+    hook_calls = []
+
+    def run(grid):
+        c = torch.full((M, N), -1, dtype=torch.float16, device=device)
+        before = stats.get_stats()
+        k = matmul_kernel[grid](a, b, c, M, N, K, a.stride(0), a.stride(1), b.stride(0), b.stride(1), c.stride(0),
+                                c.stride(1), BLOCK_M, BLOCK_N, BLOCK_K, gemm_offload=True)
+        return k, c, stats.diff(stats.get_stats(), before)["launches"]
+
+    triton.compiler.CompiledKernel.launch_enter_hook = lambda metadata: hook_calls.append(metadata)
+    try:
+        # Offloaded launches don't launch the kernel.
+        k, c, launches = run((triton.cdiv(M, BLOCK_M) * triton.cdiv(N, BLOCK_N), ))
+        torch.testing.assert_close(c, ref, rtol=1e-2, atol=1e-2)
+        assert launches == 0
+        assert len(hook_calls) == 1
+        assert "relu=1" in k.metadata.gemm
+        assert "c_type=fp16" in k.metadata.gemm
+        assert "k_masked=1" in k.metadata.gemm
+        assert "tiles=linear" in k.metadata.gemm
+
+        # A grid computing a part of C runs the kernel, which calls the hooks once.
+        hook_calls.clear()
+        k, c, launches = run((1, ))
+        assert launches == 1
+        assert len(hook_calls) == 1
+    finally:
+        triton.compiler.CompiledKernel.launch_enter_hook = None
+    torch.testing.assert_close(c[:BLOCK_M, :BLOCK_N], ref[:BLOCK_M, :BLOCK_N], rtol=1e-2, atol=1e-2)
+    assert (c[BLOCK_M:] == -1).all()
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_noalias_launch(device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, n, BLOCK: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK + tl.arange(0, BLOCK)
+        mask = offs < n
+        tl.store(out_ptr + offs, tl.load(x_ptr + offs, mask=mask) * 2, mask=mask)
+
+    n, BLOCK = 1000, 128
+    x = torch.rand((2 * n, ), device=device)
+    out = torch.empty((n, ), device=device)
+    grid = (triton.cdiv(n, BLOCK), )
+    k = kernel[grid](x, out, n, BLOCK, noalias=True)
+    torch.testing.assert_close(out, x[:n] * 2)
+    assert "noalias" in k.asm["llir"]
+
+    # Disjoint views of the same storage are accepted, overlapping ones aren't.
+    kernel[grid](x[:n], x[n:], n, BLOCK, noalias=True)
+    torch.testing.assert_close(x[n:], x[:n] * 2)
+    with pytest.raises(ValueError, match="overlapping"):
+        kernel[grid](x[:n], x[n // 2:n // 2 + n], n, BLOCK, noalias=True)
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("num_threads", [0, 3])
+def test_persistent_launch(num_threads, device):
+
+    @triton.jit
+    def kernel(src, dst, num_programs, num_tiles, BLOCK_SIZE: tl.constexpr):
+        pid = tl.program_id(0)
+        if pid == 0:
+            tl.store(num_programs, tl.num_programs(0))
+        for tile in range(pid, num_tiles, tl.num_programs(0)):
+            offs = tile * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+            tl.store(dst + offs, tl.load(src + offs) + 1)
+
+    BLOCK_SIZE, num_tiles = 16, 37
+    src = torch.rand((num_tiles * BLOCK_SIZE, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    num_programs = torch.zeros((1, ), dtype=torch.int32, device=device)
+    # The grid is replaced with a program per worker.
+    kernel[(1, )](src, dst, num_programs, num_tiles, BLOCK_SIZE, persistent=True, num_threads=num_threads)
+    workers = num_threads or triton.runtime.driver.active.utils.get_device_properties(0)["multiprocessor_count"]
+    assert num_programs.item() == workers
+    torch.testing.assert_close(dst, src + 1)
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_kernel_bundle(device):
+
+    @triton.jit
+    def kernel(src, dst, n, SCALE: tl.constexpr, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offs < n
+        tl.store(dst + offs, tl.load(src + offs, mask=mask) * SCALE, mask=mask)
+
+    n, BLOCK_SIZE = 100, 16
+    grid = (triton.cdiv(n, BLOCK_SIZE), )
+    src = torch.rand((n, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    # Specializations of the kernel share its name, but not their symbols in the bundle.
+    kernels = [kernel[grid](src, dst, n, scale, BLOCK_SIZE) for scale in (2, 3)]
+    utils = triton.runtime.driver.active.utils
+    lib = utils.load_kernel_bundle(utils.build_kernel_bundle(kernels))
+
+    # Kernels loaded again are launched from the bundle.
+    kernel.device_caches.clear()
+    for scale in (2, 3):
+        k = kernel[grid](src, dst, n, scale, BLOCK_SIZE)
+        assert k.module is lib
+        torch.testing.assert_close(dst, src * scale)
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("preload", [False, True])
+def test_cache_bundle(preload, tmp_path):
+    (tmp_path / "kernel.py").write_text("""
+import concurrent.futures
+import sys
+
+import torch
+import triton
+import triton.language as tl
+from triton.backends.cpu import cache_bundle, compiler
+
+
+@triton.jit
+def add_one(src, dst, n, BLOCK_SIZE: tl.constexpr):
+    offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+    mask = offs < n
+    tl.store(dst + offs, tl.load(src + offs, mask=mask) + 1, mask=mask)
+
+
+def fail(*args):
+    raise RuntimeError("kernel is compiled")
+
+
+if sys.argv[1] != "write":
+    # The kernel has to come from the bundle.
+    compiler.CPUBackend.make_ttir = staticmethod(fail)
+if sys.argv[1] == "preload":
+    concurrent.futures.wait(cache_bundle.preload())
+src = torch.arange(100, dtype=torch.float32)
+dst = torch.empty_like(src)
+add_one[(2, )](src, dst, 100, 64)
+assert torch.equal(dst, src + 1)
+if sys.argv[1] == "write":
+    cache_bundle.write_bundle(sys.argv[2])
+""")
+    bundle = str(tmp_path / "kernels.bundle")
+    env = dict(os.environ, TRITON_CACHE_DIR=str(tmp_path / "build_cache"))
+    subprocess.run([sys.executable, "kernel.py", "write", bundle], check=True, cwd=tmp_path, env=env)
+    env = dict(os.environ, TRITON_CACHE_DIR=str(tmp_path / "cache"),
+               TRITON_CACHE_MANAGER="triton.backends.cpu.cache_bundle:BundleCacheManager",
+               TRITON_CPU_CACHE_BUNDLE=bundle)
+    subprocess.run([sys.executable, "kernel.py", "preload" if preload else "load"], check=True, cwd=tmp_path, env=env)
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_shared_pool(tmp_path):
+    (tmp_path / "kernel.py").write_text("""
+import torch
+import triton
+import triton.language as tl
+
+
+@triton.jit
+def add_one(src, dst, BLOCK_SIZE: tl.constexpr):
+    offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+    tl.store(dst + offs, tl.load(src + offs) + 1)
+
+
+src = torch.arange(1024, dtype=torch.float32)
+dst = torch.empty_like(src)
+add_one[(16, )](src, dst, 64)
+assert torch.equal(dst, src + 1)
+stats = triton.runtime.driver.active.utils.get_shared_pool_stats()
+# Cores are only leased while launches run.
+assert stats is not None and stats["capacity"] == 2, stats
+assert stats["leased"] == 0 and stats["active"] == 0, stats
+""")
+    name = f"test_{os.getpid()}"
+    env = dict(os.environ, TRITON_CPU_SHARED_POOL=name, TRITON_CPU_SHARED_POOL_SIZE="2")
+    try:
+        for _ in range(2):
+            subprocess.run([sys.executable, "kernel.py"], check=True, cwd=tmp_path, env=env)
+    finally:
+        if os.path.exists(f"/dev/shm/triton_cpu_pool_{name}"):
+            os.remove(f"/dev/shm/triton_cpu_pool_{name}")
+
+
+_SHARED_POOL_KERNELS = """
+import ctypes
+import os
+import sys
+import threading
+
+import torch
+import triton
+import triton.language as tl
+
+
+@triton.jit
+def spin(dst, n):
+    acc = tl.program_id(0)
+    for _ in range(n):
+        acc = acc * 1103515245 + 12345
+    tl.store(dst + tl.program_id(0), acc)
+
+
+def stats():
+    return triton.runtime.driver.active.utils.get_shared_pool_stats()
+"""
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_shared_pool_concurrent(tmp_path):
+    (tmp_path / "kernel.py").write_text(_SHARED_POOL_KERNELS + """
+dst = torch.empty((16, ), dtype=torch.int32)
+for _ in range(100):
+    spin[(16, )](dst, 1000)
+    assert stats()["leased"] <= stats()["capacity"], stats()
+# A forked child, which has no pool workers, leases cores under an entry of its own.
+pid = os.fork()
+if pid == 0:
+    runtime = triton.runtime.driver.active.utils._get_runtime()
+    tokens = ctypes.c_int32()
+    runtime.triton_cpu_shared_pool_lease(2, ctypes.byref(tokens))
+    ok = 0 < stats()["active"] and stats()["leased"] <= stats()["capacity"]
+    runtime.triton_cpu_shared_pool_release(tokens)
+    os._exit(0 if ok else 1)
+assert os.waitpid(pid, 0)[1] == 0
+spin[(16, )](dst, 1000)
+""")
+    name = f"test_concurrent_{os.getpid()}"
+    env = dict(os.environ, TRITON_CPU_SHARED_POOL=name, TRITON_CPU_SHARED_POOL_SIZE="2")
+    try:
+        procs = [subprocess.Popen([sys.executable, "kernel.py"], cwd=tmp_path, env=env) for _ in range(2)]
+        assert all(proc.wait() == 0 for proc in procs)
+        # All leases were returned once both processes completed.
+        (tmp_path / "check.py").write_text(_SHARED_POOL_KERNELS + """
+assert stats()["leased"] == 0 and stats()["active"] == 0, stats()
+""")
+        subprocess.run([sys.executable, "check.py"], check=True, cwd=tmp_path, env=env)
+    finally:
+        if os.path.exists(f"/dev/shm/triton_cpu_pool_{name}"):
+            os.remove(f"/dev/shm/triton_cpu_pool_{name}")
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_shared_pool_killed_holder(tmp_path):
+    (tmp_path / "hold.py").write_text(_SHARED_POOL_KERNELS + """
+dst = torch.empty((2, ), dtype=torch.int32)
+threading.Thread(target=lambda: spin[(2, )](dst, 2**30), daemon=True).start()
+while stats()["leased"] == 0:
+    pass
+print("leased", flush=True)
+threading.Event().wait()
+""")
+    (tmp_path / "kernel.py").write_text(_SHARED_POOL_KERNELS + """
+dst = torch.empty((2, ), dtype=torch.int32)
+spin[(2, )](dst, 10)
+# The lease of the killed process was reclaimed.
+assert stats()["leased"] == 0 and stats()["active"] == 0, stats()
+""")
+    name = f"test_killed_{os.getpid()}"
+    env = dict(os.environ, TRITON_CPU_SHARED_POOL=name, TRITON_CPU_SHARED_POOL_SIZE="1")
+    try:
+        holder = subprocess.Popen([sys.executable, "hold.py"], cwd=tmp_path, env=env, stdout=subprocess.PIPE, text=True)
+        assert holder.stdout.readline().strip() == "leased"
+        holder.kill()
+        holder.wait()
+        subprocess.run([sys.executable, "kernel.py"], check=True, cwd=tmp_path, env=env)
+    finally:
+        if os.path.exists(f"/dev/shm/triton_cpu_pool_{name}"):
+            os.remove(f"/dev/shm/triton_cpu_pool_{name}")
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_bound_kernel(device):
+
+    @triton.jit
+    def kernel(src, dst, n, SCALE: tl.constexpr, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offs < n
+        tl.store(dst + offs, tl.load(src + offs, mask=mask) * SCALE, mask=mask)
+
+    n, BLOCK_SIZE = 100, 16
+    src = torch.rand((n + 1, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    launch = triton.runtime.driver.active.bind(kernel, lambda meta: (triton.cdiv(meta["n"], BLOCK_SIZE), ))
+    for _ in range(3):
+        launch(src, dst, n, 2, BLOCK_SIZE)
+        torch.testing.assert_close(dst[:n], src[:n] * 2)
+    # Misaligned pointers and other constexprs are new specializations.
+    launch(src[1:], dst[1:], n, 2, BLOCK_SIZE)
+    torch.testing.assert_close(dst[1:], src[1:] * 2)
+    launch(src, dst, n, 3, BLOCK_SIZE)
+    torch.testing.assert_close(dst[:n], src[:n] * 3)
+    assert len(launch._kernels) == 3
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_host_array_args():
+    np = pytest.importorskip("numpy")
+
+    @triton.jit
+    def kernel(src, dst, n, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offs < n
+        tl.store(dst + offs, tl.load(src + offs, mask=mask) * 2, mask=mask)
+
+    n, BLOCK_SIZE = 100, 16
+    grid = (triton.cdiv(n, BLOCK_SIZE), )
+    src = np.random.rand(n + 1).astype(np.float32)
+    dst = np.zeros_like(src)
+    # Kernels write to the arrays themselves, without copies.
+    kernel[grid](src, dst, n, BLOCK_SIZE)
+    np.testing.assert_allclose(dst[:n], src[:n] * 2)
+    kernel[grid](src[1:], dst[1:], n, BLOCK_SIZE)
+    np.testing.assert_allclose(dst[1:], src[1:] * 2)
+    # Buffers and DLPack tensors are passed the same way.
+    out = bytearray(dst.nbytes)
+    kernel[grid](memoryview(src).cast("B").cast("f"), memoryview(out).cast("f"), n, BLOCK_SIZE)
+    np.testing.assert_allclose(np.frombuffer(out, dtype=np.float32)[:n], src[:n] * 2)
+
+    class DLPackTensor:
+
+        def __init__(self, array):
+            self.array = array
+
+        def __dlpack__(self, **kwargs):
+            return self.array.__dlpack__(**kwargs)
+
+        def __dlpack_device__(self):
+            return self.array.__dlpack_device__()
+
+    dst[:] = 0
+    kernel[grid](DLPackTensor(src), DLPackTensor(dst), n, BLOCK_SIZE)
+    np.testing.assert_allclose(dst[:n], src[:n] * 2)
+    # Numpy scalars aren't arrays to point to.
+    with pytest.raises(TypeError, match="Unsupported type"):
+        kernel[grid](np.float32(1.0), dst, n, BLOCK_SIZE)
+    # Kernels may write to any pointer, so read-only arrays and buffers are rejected.
+    src.flags.writeable = False
+    with pytest.raises(ValueError, match="writable"):
+        kernel[grid](src, dst, n, BLOCK_SIZE)
+    with pytest.raises(ValueError, match="writable"):
+        kernel[grid](memoryview(bytes(dst.nbytes)).cast("f"), dst, n, BLOCK_SIZE)
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("num_slices", [4, 1000])
+def test_out_of_core_launch(num_slices, tmp_path):
+    np = pytest.importorskip("numpy")
+
+    @triton.jit
+    def kernel(src, dst, n, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offs < n
+        tl.store(dst + offs, tl.load(src + offs, mask=mask) + 1, mask=mask)
+
+    n, BLOCK_SIZE = 1 << 20, 1024
+    src = np.memmap(tmp_path / "src.bin", dtype=np.float32, mode="w+", shape=(n, ))
+    src[:] = np.arange(n, dtype=np.float32)
+    src.flush()
+    src = np.memmap(tmp_path / "src.bin", dtype=np.float32, mode="r", shape=(n, ))
+    dst = torch.empty((n, ), dtype=torch.float32)
+    # More slices than programs run a program per slice.
+    kernel[(triton.cdiv(n, BLOCK_SIZE), )](src, dst, n, BLOCK_SIZE, out_of_core_slices=num_slices)
+    np.testing.assert_array_equal(dst.numpy(), np.arange(n, dtype=np.float32) + 1)
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("page_size", ["4K", "2M"])
+@pytest.mark.parametrize("interleave", [False, True])
+def test_huge_page_allocator(page_size, interleave):
+    from triton.backends.cpu.allocator import HugePageAllocator
+
+    @triton.jit
+    def kernel(src, dst, n, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offs < n
+        tl.store(dst + offs, tl.load(src + offs, mask=mask) * 2, mask=mask)
+
+    allocator = HugePageAllocator(page_size, interleave=interleave)
+    n, BLOCK_SIZE = 3 << 18, 1024
+    src = allocator.empty((n, ), torch.float32)
+    dst = allocator.empty((n, ), torch.float32)
+    assert torch.all(dst == 0)
+    alignment = 4096 if page_size == "4K" else 2 << 20
+    assert src.data_ptr() % alignment == 0
+    src.copy_(torch.rand((n, ), dtype=torch.float32))
+    kernel[(triton.cdiv(n, BLOCK_SIZE), )](src, dst, n, BLOCK_SIZE)
+    torch.testing.assert_close(dst, src * 2)
+
+    buffer = allocator(1000, 64, None)
+    assert buffer.data_ptr() % alignment == 0
+    assert buffer.page_size in (4096, 2 << 20)
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_tune_launch(device, monkeypatch, tmp_path):
+    monkeypatch.setenv("TRITON_CACHE_DIR", str(tmp_path))
+    configs = [triton.Config({"BLOCK_SIZE": 256}), triton.Config({"BLOCK_SIZE": 1024}, num_threads=1)]
+
+    def make_kernel():
+
+        @triton.autotune(configs=configs, key=["n"], tune_launch=True)
+        @triton.jit
+        def add_kernel(src, dst, n, BLOCK_SIZE: tl.constexpr):
+            offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+            mask = offs < n
+            tl.store(dst + offs, tl.load(src + offs, mask=mask) + 1, mask=mask)
+
+        return add_kernel
+
+    n = 1 << 16
+    src = torch.rand((n, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    add_kernel = make_kernel()
+    add_kernel[lambda meta: (triton.cdiv(n, meta["BLOCK_SIZE"]), )](src, dst, n)
+    assert (dst == src + 1).all()
+    space = triton.runtime.driver.active.get_launch_tuning_space()
+    timed = set(add_kernel.configs_timings)
+    # Configs without a thread count are crossed with all launch options, the others keep theirs.
+    assert {(c.num_threads, c.kwargs["schedule"]) for c in timed if c.kwargs["BLOCK_SIZE"] == 256} == \
+        {(options["num_threads"], options["schedule"]) for options in space}
+    assert {(c.num_threads, c.kwargs["schedule"]) for c in timed if c.kwargs["BLOCK_SIZE"] == 1024} == \
+        {(1, options["schedule"]) for options in space}
+    assert "schedule" in add_kernel.best_config.kwargs
+
+    # Results are cached on disk, so a new process picks the same config without benchmarking.
+    cached_kernel = make_kernel()
+    cached_kernel._bench = None
+    cached_kernel[lambda meta: (triton.cdiv(n, meta["BLOCK_SIZE"]), )](src, dst, n)
+    assert cached_kernel.best_config == add_kernel.best_config
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_tune_launch_pre_hook(device, monkeypatch, tmp_path):
+    monkeypatch.setenv("TRITON_CACHE_DIR", str(tmp_path))
+    hook_calls = []
+
+    def pre_hook(nargs):
+        hook_calls.append(nargs["BLOCK_SIZE"])
+
+    configs = [triton.Config({"BLOCK_SIZE": 256}, pre_hook=pre_hook), triton.Config({"BLOCK_SIZE": 1024})]
+
+    def make_kernel():
+
+        @triton.autotune(configs=configs, key=["n"], tune_launch=True)
+        @triton.jit
+        def add_kernel(src, dst, n, BLOCK_SIZE: tl.constexpr):
+            offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+            mask = offs < n
+            tl.store(dst + offs, tl.load(src + offs, mask=mask) + 1, mask=mask)
+
+        return add_kernel
+
+    n = 1 << 16
+    src = torch.rand((n, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    add_kernel = make_kernel()
+    add_kernel[lambda meta: (triton.cdiv(n, meta["BLOCK_SIZE"]), )](src, dst, n)
+    assert (dst == src + 1).all()
+
+    # Cached configs get their prehooks back from the tuned configs.
+    cached_kernel = make_kernel()
+    cached_kernel._bench = None
+    hook_calls.clear()
+    cached_kernel[lambda meta: (triton.cdiv(n, meta["BLOCK_SIZE"]), )](src, dst, n)
+    assert cached_kernel.best_config == add_kernel.best_config
+    assert cached_kernel.best_config.pre_hook is (pre_hook if cached_kernel.best_config.kwargs["BLOCK_SIZE"] == 256
+                                                  else None)
+    assert hook_calls == ([256] if cached_kernel.best_config.pre_hook else [])
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_autotune_fast_compile(device):
+    configs = [triton.Config({"BLOCK_SIZE": 2**i}) for i in range(6, 11)]
+
+    @triton.autotune(configs=configs, key=["n"])
+    @triton.jit
+    def add_kernel(src, dst, n, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offs < n
+        tl.store(dst + offs, tl.load(src + offs, mask=mask) + 1, mask=mask)
+
+    benched = []
+    bench = add_kernel._bench
+
+    def record_bench(*args, config, **kwargs):
+        benched.append((config, kwargs.get("fast_compile", False)))
+        return bench(*args, config=config, **kwargs)
+
+    add_kernel._bench = record_bench
+    n = 1 << 16
+    src = torch.rand((n, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    add_kernel[lambda meta: (triton.cdiv(n, meta["BLOCK_SIZE"]), )](src, dst, n)
+    assert (dst == src + 1).all()
+
+    # All configs are ranked with O1 kernels, and the best one is picked from the three fastest recompiled at O3.
+    assert {config for config, fast in benched if fast} == set(configs)
+    verified = [config for config, fast in benched if not fast]
+    assert len(verified) == 3
+    assert add_kernel.best_config in verified
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+@pytest.mark.parametrize("amx", [False, True])
+def test_cache_model_prune(amx, monkeypatch):
+    from triton.backends.cpu import driver as cpu_driver
+
+    props = dict(l2_cache_size=1 << 20, amx_bf16=amx, amx_fp16=False, amx_int8=False)
+    monkeypatch.setattr(cpu_driver, "_read_device_properties", lambda: props)
+
+    def config(m, n, k):
+        return triton.Config({"BLOCK_SIZE_M": m, "BLOCK_SIZE_N": n, "BLOCK_SIZE_K": k})
+
+    fits = [config(64, 64, 64), config(24, 64, 64)]
+    too_large = [config(512, 512, 256), config(512, 512, 64)]
+    out_of_problem = config(64, 64, 512)
+    configs = fits + too_large + [out_of_problem]
+    a = torch.empty((1, ), dtype=torch.bfloat16)
+    pruned = cpu_driver.prune_configs_by_cache_model(configs, {"a": a, "M": 512, "N": 512, "K": 128})
+    # The 24-row block isn't a whole number of AMX tiles.
+    assert pruned == (fits[:1] if amx else fits)
+    # Configs with the smallest working set are kept when none fits the cache.
+    assert cpu_driver.prune_configs_by_cache_model(too_large, {"a": a}) == too_large[1:]
+    # Configs without GEMM blocks are kept.
+    other = [triton.Config({"BLOCK_SIZE": 1 << 20})]
+    assert cpu_driver.prune_configs_by_cache_model(other, {"a": a}) == other
+
+    @triton.autotune(configs=configs, key=[])
+    @triton.jit
+    def kernel(a, BLOCK_SIZE_M: tl.constexpr, BLOCK_SIZE_N: tl.constexpr, BLOCK_SIZE_K: tl.constexpr):
+        pass
+
+    assert kernel.early_config_prune is cpu_driver.prune_configs_by_cache_model
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_tuning_database(device, monkeypatch, tmp_path):
+    monkeypatch.setenv("TRITON_TUNING_DB_BACKEND", "triton.runtime.cache:DirectoryRemoteCacheBackend")
+    monkeypatch.setenv("TRITON_REMOTE_CACHE_DIR", str(tmp_path / "tuning_db"))
+    configs = [triton.Config({"BLOCK_SIZE": 2**i}) for i in range(6, 10)]
+
+    def make_kernel():
+
+        @triton.autotune(configs=configs, key=["n"])
+        @triton.jit
+        def add_kernel(src, dst, n, BLOCK_SIZE: tl.constexpr):
+            offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+            mask = offs < n
+            tl.store(dst + offs, tl.load(src + offs, mask=mask) + 1, mask=mask)
+
+        return add_kernel
+
+    n = 1 << 14
+    src = torch.rand((n, ), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    grid = lambda meta: (triton.cdiv(n, meta["BLOCK_SIZE"]), )
+    monkeypatch.setenv("TRITON_CACHE_DIR", str(tmp_path / "host0"))
+    tuned = make_kernel()
+    tuned[grid](src, dst, n)
+    assert os.listdir(tmp_path / "tuning_db")
+
+    # Another host with an empty local cache reads results of the first one instead of tuning.
+    monkeypatch.setenv("TRITON_CACHE_DIR", str(tmp_path / "host1"))
+    kernel = make_kernel()
+    kernel._bench = None
+    kernel[grid](src, dst, n)
+    assert (dst == src + 1).all()
+    assert kernel.best_config == tuned.best_config
+
+
+@pytest.mark.skipif(not is_cpu(), reason="CPU launcher test")
+def test_buffered_device_print(device, capfd):
+
+    @triton.jit
+    def kernel(src, BLOCK_SIZE: tl.constexpr):
+        pid = tl.program_id(0)
+        tl.device_print("pid", pid)
+        tl.device_print("x", tl.load(src + pid * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)))
+
+    num_programs = 64
+    src = torch.zeros(num_programs * 4, dtype=torch.int32, device=device)
+    capfd.readouterr()
+    kernel[(num_programs, )](src, BLOCK_SIZE=4, num_threads=4, schedule="steal")
+    lines = [line for line in capfd.readouterr().out.splitlines() if line]
+    # Prints are written when the launch is done, by program id and in program order.
+    assert lines == [
+        line for pid in range(num_programs) for line in (f"({pid}, 0, 0) pid: {pid}", f"({pid}, 0, 0) x: [0, 0, 0, 0]")
+    ]
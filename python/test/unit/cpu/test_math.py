@@ -10,16 +10,23 @@ from triton.language.extra import libdevice
 from itertools import chain, product
 
 
-def get_native_vector_size_in_bits():
+def get_native_vector_size_in_bits(vec_lib):
     """
-    Returns the native vector size of the CPU.
-    Assuming x86 always uses "auto dispatch" with 512-bit vectors for Sleef.
+    Returns the native vector size of the CPU vector math functions are called for.
     """
     cpu_features = llvm.get_cpu_features()
-    # TODO support for arm sve w/ VLA
-    if "neon" in cpu_features:
-        return 128
-    return 512
+    if "sve" in cpu_features and vec_lib == "libsleef":
+        from triton.backends.cpu.compiler import _get_sve_vector_bits
+        return max(_get_sve_vector_bits(), 128)
+    if "v" in cpu_features and vec_lib == "libsleef":
+        # The size of RVV registers is added to host features by the backend.
+        from triton.backends.cpu.compiler import _get_host_cpu, _get_rvv_vector_bits
+        return _get_rvv_vector_bits(_get_host_cpu()[2])
+    if "avx512f" in cpu_features:
+        return 512
+    if "avx" in cpu_features:
+        return 256
+    return 128
 
 
 def is_interpreter():
@@ -48,7 +55,7 @@ def check_num_vec_calls(meta, vec_lib, dtype_str, size, is_always_extern=False):
     elem_size = 8 if dtype_str == "float64" else 4
     data_size = size * elem_size
 
-    vec_size = get_native_vector_size_in_bits() / 8  # bytes
+    vec_size = get_native_vector_size_in_bits(vec_lib) / 8  # bytes
     # 128-bit vector is the smallest supported by Sleef for both x86 and arm
     smallest_vec_size = 128 / 8  # bytes
     if data_size > vec_size:
@@ -103,7 +110,7 @@ def test_libdevice_math_fn(vec_lib, dtype_str, math_fn, size, device):
     if math_fn in {"ceil", "fmod", "pow"}:
         if vec_lib != "libsleef":
             pytest.skip("extern_elementwise only supports libsleef")
-        if dtype_str not in {"float32", "torch.float64"}:
+        if dtype_str not in {"float32", "float64"}:
             pytest.skip(f"{math_fn} only supports fp32, fp64")
 
     @triton.jit
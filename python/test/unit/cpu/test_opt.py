@@ -1,9 +1,12 @@
 import os
+import re
 import pytest
 import torch
 
 import triton
 import triton.language as tl
+from triton.language import core
+from triton.language.extra import libdevice
 
 
 def is_interpreter():
@@ -67,6 +70,903 @@ def test_optimize_tile_mask(size, tile_size, device):
         assert masked_stores == 1
 
 
+@pytest.mark.parametrize("size", [1000, 1024])
+def test_peel_masked_tail(size, device):
+
+    @triton.jit
+    def kernel(src, dst, size, TILE_SIZE: tl.constexpr):
+        acc = tl.zeros((TILE_SIZE, ), dtype=tl.float32)
+        for off in range(0, size, TILE_SIZE):
+            offs = off + tl.arange(0, TILE_SIZE)
+            acc += tl.load(src + offs, mask=offs < size, other=0)
+        tl.store(dst, tl.sum(acc))
+
+    src = torch.rand((size, ), dtype=torch.float32, device='cpu')
+    res = torch.empty((1, ), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](src, res, size, TILE_SIZE=64)
+    torch.testing.assert_close(res, src.sum().reshape(1))
+
+    # Check only the peeled last iteration of the loop is masked. Divisibility
+    # of the size by 16 is not enough to remove the mask without peeling.
+    tttcir = meta.asm["tttcir"]
+    assert tttcir.count("maskedload") == 1
+
+
+@pytest.mark.parametrize("version_masked_tiles", [False, True])
+def test_version_masked_tiles(version_masked_tiles, device):
+
+    @triton.jit
+    def kernel(src, dst, size, TILE_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * TILE_SIZE + tl.arange(0, TILE_SIZE)
+        mask = offs < size
+        tl.store(dst + offs, tl.load(src + offs, mask=mask, other=0) * 2, mask=mask)
+
+    size = 1000
+    src = torch.rand((size, ), dtype=torch.float32, device='cpu')
+    res = torch.empty_like(src)
+    meta = kernel[(triton.cdiv(size, 128), )](src, res, size, TILE_SIZE=128,
+                                               version_masked_tiles=version_masked_tiles)
+    torch.testing.assert_close(res, src * 2)
+
+    # Full tiles run unmasked accesses, masked ones are left for the tail tile.
+    tttcir = meta.asm["tttcir"]
+    assert tttcir.count("maskedload") == 1
+    assert tttcir.count("maskedstore") == 1
+    assert ("vector.load" in tttcir) == version_masked_tiles
+    assert ("vector.store" in tttcir) == version_masked_tiles
+    # The check of full tiles is computed in i64, so it doesn't wrap around for large offsets.
+    assert bool(re.search(r"arith\.cmpi slt, [^\n]*: i64", tttcir)) == version_masked_tiles
+
+
+@pytest.mark.parametrize("max_unrolled_ops", [0, 64])
+def test_max_unrolled_ops(max_unrolled_ops, device):
+
+    @triton.jit
+    def copy_kernel(src, dst, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr):
+        offs = tl.arange(0, BLOCK_M)[:, None] * BLOCK_N + tl.arange(0, BLOCK_N)[None, :]
+        tl.store(dst + offs, tl.load(src + offs))
+
+    @triton.jit
+    def histogram_kernel(src, dst, BLOCK_SIZE: tl.constexpr, NUM_BINS: tl.constexpr):
+        x = tl.load(src + tl.arange(0, BLOCK_SIZE))
+        tl.store(dst + tl.arange(0, NUM_BINS), tl.histogram(x, NUM_BINS))
+
+    src = torch.rand((256, 64), dtype=torch.float32, device=device)
+    dst = torch.empty_like(src)
+    meta = copy_kernel[(1, )](src, dst, BLOCK_M=256, BLOCK_N=64, max_unrolled_ops=max_unrolled_ops)
+    torch.testing.assert_close(dst, src)
+    # Transfers of kernels above the limit are lowered to loops.
+    assert meta.metadata.vector_unroll_limit == (16 if max_unrolled_ops else 0)
+
+    x = torch.randint(0, 16, (1024, ), dtype=torch.int32, device=device)
+    hist = torch.empty((16, ), dtype=torch.int32, device=device)
+    if max_unrolled_ops:
+        # Histograms have no loop lowering, so their configs are rejected.
+        with pytest.raises(triton.runtime.errors.OutOfResources):
+            histogram_kernel[(1, )](x, hist, BLOCK_SIZE=1024, NUM_BINS=16, max_unrolled_ops=max_unrolled_ops)
+    else:
+        histogram_kernel[(1, )](x, hist, BLOCK_SIZE=1024, NUM_BINS=16, max_unrolled_ops=max_unrolled_ops)
+        torch.testing.assert_close(hist, torch.bincount(x, minlength=16).to(torch.int32))
+
+
+def test_fold_selects(device):
+
+    @triton.jit
+    def causal_kernel(src, dst, n, BLOCK_SIZE: tl.constexpr):
+        rows = tl.arange(0, BLOCK_SIZE)[:, None]
+        cols = tl.arange(0, BLOCK_SIZE)[None, :]
+        x = tl.load(src + rows * BLOCK_SIZE + cols)
+        x = tl.where(rows >= cols, x, float("-inf"))
+        x = tl.where(cols < n, x, float("-inf"))
+        tl.store(dst + rows * BLOCK_SIZE + cols, x)
+
+    @triton.jit
+    def update_kernel(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.arange(0, BLOCK_SIZE)
+        x = tl.load(src + offs)
+        tl.store(dst + offs, tl.where(x > 0, x, tl.load(dst + offs)))
+
+    src = torch.randn((16, 16), dtype=torch.float32, device=device)
+    res = torch.empty_like(src)
+    meta = causal_kernel[(1, )](src, res, 10, BLOCK_SIZE=16)
+    idx = torch.arange(16)
+    mask = (idx[:, None] >= idx[None, :]) & (idx[None, :] < 10)
+    torch.testing.assert_close(res, torch.where(mask, src, float("-inf")))
+    # Both masks are applied by a single select.
+    assert meta.asm["ttcir"].count("arith.select") == 1
+
+    src = torch.randn((64, ), dtype=torch.float32, device=device)
+    dst = torch.randn((64, ), dtype=torch.float32, device=device)
+    expected = torch.where(src > 0, src, dst)
+    meta = update_kernel[(1, )](src, dst, BLOCK_SIZE=64)
+    torch.testing.assert_close(dst, expected)
+    # Unselected elements are skipped by a masked store instead of written back, if the target has masked stores.
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    native_masked_store = any(feature in features for feature in ("avx", "sve", "v"))
+    assert ("arith.select" not in meta.asm["ttcir"]) == native_masked_store
+    assert ("maskedstore" in meta.asm["ttcir"]) == native_masked_store
+
+
+def test_carry_ptr_offsets(device):
+
+    @triton.jit
+    def kernel(src, dst, stride, K, BLOCK_SIZE: tl.constexpr):
+        rows = tl.arange(0, BLOCK_SIZE)
+        cols = tl.arange(0, BLOCK_SIZE)
+        ptrs = src + rows[:, None] * stride + cols[None, :]
+        acc = tl.zeros((BLOCK_SIZE, BLOCK_SIZE), dtype=tl.float32)
+        for _ in range(0, K, BLOCK_SIZE):
+            acc += tl.load(ptrs)
+            ptrs += BLOCK_SIZE
+        tl.store(dst + rows[:, None] * BLOCK_SIZE + cols[None, :], acc)
+
+    src = torch.randn((16, 64), dtype=torch.float32, device=device)
+    res = torch.empty((16, 16), dtype=torch.float32, device=device)
+    meta = kernel[(1, )](src, res, 64, 64, BLOCK_SIZE=16)
+    torch.testing.assert_close(res, src.view(16, 4, 16).sum(1))
+    # Row pointers are computed from the scalar offset carried by the loop
+    # instead of being extracted from a vector of addresses.
+    assert "tt.int_to_ptr" not in meta.asm["ttcir"]
+
+
+@pytest.mark.parametrize("masked", [False, True])
+def test_strided_load(masked, device):
+
+    @triton.jit
+    def kernel(src, dst, size, STRIDE: tl.constexpr, BLOCK_SIZE: tl.constexpr, MASKED: tl.constexpr):
+        offs = tl.arange(0, BLOCK_SIZE)
+        if MASKED:
+            x = tl.load(src + offs * STRIDE, mask=offs < size, other=-1.0)
+        else:
+            x = tl.load(src + offs * STRIDE)
+        tl.store(dst + offs, x)
+
+    src = torch.rand((64, ), dtype=torch.float32, device='cpu')
+    res = torch.empty((16, ), dtype=torch.float32, device='cpu')
+    size = 13 if masked else 16
+    meta = kernel[(1, )](src, res, size, STRIDE=2, BLOCK_SIZE=16, MASKED=masked)
+    ref = src[:32:2].clone()
+    ref[size:] = -1.0
+    torch.testing.assert_close(res, ref)
+
+    # Check the load is lowered to a contiguous load and a shuffle.
+    ttcir = meta.asm["ttcir"]
+    assert "vector.shuffle" in ttcir
+    assert "vector.gather" not in ttcir
+
+
+@pytest.mark.parametrize("masked", [False, True])
+def test_interleaved_access(masked, device):
+
+    # Swap real and imaginary parts of 2D blocks of complex numbers.
+    @triton.jit
+    def kernel(src, dst, rows, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr, MASKED: tl.constexpr):
+        offs_m = tl.arange(0, BLOCK_M)[:, None]
+        offs_n = tl.arange(0, BLOCK_N)[None, :]
+        offs = offs_m * BLOCK_N * 2 + offs_n * 2
+        if MASKED:
+            mask = offs_m < rows
+            re = tl.load(src + offs, mask=mask)
+            im = tl.load(src + offs + 1, mask=mask)
+            tl.store(dst + offs, im, mask=mask)
+            tl.store(dst + offs + 1, re, mask=mask)
+        else:
+            re = tl.load(src + offs)
+            im = tl.load(src + offs + 1)
+            tl.store(dst + offs, im)
+            tl.store(dst + offs + 1, re)
+
+    src = torch.rand((4, 16, 2), dtype=torch.float32, device='cpu')
+    res = torch.zeros_like(src)
+    rows = 3 if masked else 4
+    meta = kernel[(1, )](src, res, rows, BLOCK_M=4, BLOCK_N=16, MASKED=masked)
+    ref = torch.zeros_like(src)
+    ref[:rows] = src[:rows].flip(-1)
+    torch.testing.assert_close(res, ref)
+
+    ttcir = meta.asm["ttcir"]
+    assert "vector.shuffle" in ttcir
+    assert "vector.gather" not in ttcir
+    assert "vector.scatter" not in ttcir
+
+
+def test_short_gather(device):
+
+    @triton.jit
+    def kernel(src, idx, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.arange(0, BLOCK_SIZE)
+        x = tl.load(src + tl.load(idx + offs))
+        tl.store(dst + offs, x)
+
+    src = torch.rand((64, ), dtype=torch.float32, device='cpu')
+    idx = torch.randint(0, 64, (4, ), dtype=torch.int32, device='cpu')
+    res = torch.empty((4, ), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](src, idx, res, BLOCK_SIZE=4)
+    torch.testing.assert_close(res, src[idx.long()])
+
+    # Scalar loads are cheaper than a gather of four elements.
+    assert "vector.gather" not in meta.asm["ttcir"]
+
+
+def test_address_gather_scatter(device):
+
+    @triton.jit
+    def kernel(src_addrs, dst_addrs, BLOCK_SIZE: tl.constexpr):
+        offs = tl.arange(0, BLOCK_SIZE)
+        # Pointers built from addresses have no common base.
+        src = tl.load(src_addrs + offs).to(tl.pointer_type(tl.float32))
+        dst = tl.load(dst_addrs + offs).to(tl.pointer_type(tl.float32))
+        tl.store(dst, tl.load(src) + 1)
+
+    src = torch.rand((256, ), dtype=torch.float32, device='cpu')
+    res = torch.zeros((256, ), dtype=torch.float32, device='cpu')
+    perm = torch.randperm(256)[:64]
+    src_addrs = src.data_ptr() + perm * src.element_size()
+    dst_addrs = res.data_ptr() + perm.flip(0) * res.element_size()
+    meta = kernel[(1, )](src_addrs, dst_addrs, BLOCK_SIZE=64)
+    torch.testing.assert_close(res[perm.flip(0)], src[perm] + 1)
+
+    # Hardware gathers and scatters by addresses replace scalar loops.
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    ttcir = meta.asm["ttcir"]
+    scalable = "sve" in features or "v" in features
+    assert ("llvm.intr.masked.gather" in ttcir) == ("avx2" in features or scalable)
+    assert ("llvm.intr.masked.scatter" in ttcir) == ("avx512f" in features or scalable)
+
+
+@pytest.mark.parametrize("offset", [0, 1])
+def test_alignment_assumptions(offset, device):
+
+    @triton.jit
+    def kernel(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        tl.store(dst + offs, tl.load(src + offs))
+
+    # Tensor views with an offset are not specialized as aligned.
+    src = torch.rand((129, ), dtype=torch.float32, device='cpu')[offset:offset + 128]
+    res = torch.empty((129, ), dtype=torch.float32, device='cpu')[offset:offset + 128]
+    meta = kernel[(4, )](src, res, BLOCK_SIZE=32)
+    assert (src == res).all()
+
+    llir = meta.asm["llir"]
+    if offset == 0:
+        assert "llvm.assume" in llir
+        assert "align 16" in llir
+    else:
+        assert "llvm.assume" not in llir
+
+
+def test_fp16_dot(device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, K)
+        a = tl.load(a_ptr + offs_m[:, None] * K + offs_k[None, :])
+        b = tl.load(b_ptr + offs_k[:, None] * N + offs_n[None, :])
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], tl.dot(a, b))
+
+    M, N, K = 32, 32, 64
+    a = torch.randn((M, K), dtype=torch.float16, device='cpu')
+    b = torch.randn((K, N), dtype=torch.float16, device='cpu')
+    res = torch.empty((M, N), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](a, b, res, M, N, K)
+    torch.testing.assert_close(res, a.float() @ b.float(), rtol=1e-3, atol=1e-3)
+
+    props = triton.runtime.driver.active.utils.get_device_properties(0)
+    if props["amx_fp16"]:
+        assert "llvm.x86.tdpfp16ps.internal" in meta.asm["tttcir"]
+
+
+@pytest.mark.parametrize("dtype", [torch.float8_e4m3fn, torch.float8_e5m2])
+def test_fp8_dot(dtype, device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, K)
+        a = tl.load(a_ptr + offs_m[:, None] * K + offs_k[None, :])
+        b = tl.load(b_ptr + offs_k[:, None] * N + offs_n[None, :])
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], tl.dot(a, b))
+
+    M, N, K = 32, 32, 64
+    a = torch.randn((M, K), device='cpu').to(dtype)
+    b = torch.randn((K, N), device='cpu').to(dtype)
+    res = torch.empty((M, N), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](a, b, res, M, N, K)
+    torch.testing.assert_close(res, a.float() @ b.float(), rtol=1e-3, atol=1e-3)
+
+    props = triton.runtime.driver.active.utils.get_device_properties(0)
+    tttcir = meta.asm["tttcir"]
+    if props["amx_fp8"]:
+        instr = "tdphf8ps" if dtype == torch.float8_e4m3fn else "tdpbf8ps"
+        assert f"llvm.x86.{instr}.internal" in tttcir
+    elif props["amx_bf16"]:
+        # FP8 tiles are converted to BF16 in a single staging tile buffer of each operand instead of whole blocks.
+        assert "amx.tile_mulf" in tttcir
+        assert f"memref<{M}x{K}xbf16>" not in tttcir
+        assert f"memref<{K // 2}x{N * 2}xbf16>" not in tttcir
+
+
+@pytest.mark.parametrize("dtype", [torch.int8, torch.int16])
+def test_int_dot(dtype, device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, K)
+        a = tl.load(a_ptr + offs_m[:, None] * K + offs_k[None, :])
+        b = tl.load(b_ptr + offs_k[:, None] * N + offs_n[None, :])
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], tl.dot(a, b, out_dtype=tl.int32))
+
+    M, N, K = 16, 32, 64
+    a = torch.randint(-128, 128, (M, K), dtype=dtype, device='cpu')
+    b = torch.randint(-128, 128, (K, N), dtype=dtype, device='cpu')
+    res = torch.empty((M, N), dtype=torch.int32, device='cpu')
+    meta = kernel[(1, )](a, b, res, M, N, K)
+    torch.testing.assert_close(res, (a.long() @ b.long()).int())
+
+    props = triton.runtime.driver.active.utils.get_device_properties(0)
+    features = props["cpu_features"]
+    vnni = "avx512vnni" in features or "avxvnni" in features
+    if vnni and not (dtype == torch.int8 and props["amx_int8"]):
+        instr = "vpdpbusd" if dtype == torch.int8 else "vpdpwssd"
+        assert f"llvm.x86.avx512.{instr}" in meta.asm["tttcir"]
+    if props["cpu_arch"] == "aarch64" and dtype == torch.int8:
+        if "i8mm" in features:
+            assert "llvm.aarch64.neon.smmla" in meta.asm["tttcir"]
+        elif "dotprod" in features:
+            assert "llvm.aarch64.neon.sdot" in meta.asm["tttcir"]
+
+
+def test_bf16_mmla_dot(device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, K)
+        a = tl.load(a_ptr + offs_m[:, None] * K + offs_k[None, :])
+        b = tl.load(b_ptr + offs_k[:, None] * N + offs_n[None, :])
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], tl.dot(a, b, out_dtype=tl.float32))
+
+    M, N, K = 16, 16, 32
+    a = torch.randn((M, K), dtype=torch.bfloat16, device='cpu')
+    b = torch.randn((K, N), dtype=torch.bfloat16, device='cpu')
+    res = torch.empty((M, N), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](a, b, res, M, N, K)
+    torch.testing.assert_close(res, a.float() @ b.float(), rtol=1e-2, atol=1e-2)
+
+    props = triton.runtime.driver.active.utils.get_device_properties(0)
+    if props["cpu_arch"] == "aarch64" and "bf16" in props["cpu_features"]:
+        assert "llvm.aarch64.neon.bfmmla" in meta.asm["tttcir"]
+
+
+@pytest.mark.parametrize("M, N", [(16, 32), (8, 24)])
+def test_fma_dot(M, N, device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr, BLOCK_K: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, BLOCK_K)
+        acc = tl.zeros((M, N), dtype=tl.float32)
+        for k in range(0, K, BLOCK_K):
+            a = tl.load(a_ptr + offs_m[:, None] * K + (k + offs_k)[None, :])
+            b = tl.load(b_ptr + (k + offs_k)[:, None] * N + offs_n[None, :])
+            acc += tl.dot(a, b)
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], acc)
+
+    K, BLOCK_K = 64, 16
+    a = torch.randn((M, K), dtype=torch.float32, device='cpu')
+    b = torch.randn((K, N), dtype=torch.float32, device='cpu')
+    res = torch.empty((M, N), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](a, b, res, M, N, K, BLOCK_K)
+    torch.testing.assert_close(res, a @ b, rtol=1e-4, atol=1e-4)
+
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    if "avx512f" in features or ("avx2" in features and "fma" in features):
+        assert "vector.fma" in meta.asm["tttcir"]
+
+
+@pytest.mark.parametrize("M, N", [(16, 32), (12, 4)])
+def test_fp64_fma_dot(M, N, device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr, BLOCK_K: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, BLOCK_K)
+        acc = tl.zeros((M, N), dtype=tl.float64)
+        for k in range(0, K, BLOCK_K):
+            a = tl.load(a_ptr + offs_m[:, None] * K + (k + offs_k)[None, :])
+            b = tl.load(b_ptr + (k + offs_k)[:, None] * N + offs_n[None, :])
+            acc += tl.dot(a, b, out_dtype=tl.float64)
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], acc)
+
+    # Rows of FP64 values filling at least a whole vector are lowered to FMAs,
+    # e.g. rows of 4 values on AVX2 targets but not on AVX-512 ones.
+    K, BLOCK_K = 64, 16
+    a = torch.randn((M, K), dtype=torch.float64, device='cpu')
+    b = torch.randn((K, N), dtype=torch.float64, device='cpu')
+    res = torch.empty((M, N), dtype=torch.float64, device='cpu')
+    meta = kernel[(1, )](a, b, res, M, N, K, BLOCK_K)
+    torch.testing.assert_close(res, a @ b)
+
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    vector_bits = 512 if "avx512f" in features else 256
+    if ("avx512f" in features or ("avx2" in features and "fma" in features)) and N * 64 >= vector_bits:
+        assert "vector.fma" in meta.asm["tttcir"]
+    assert "vector.contract" not in meta.asm["tttcir"]
+
+
+@pytest.mark.parametrize("dtype", [torch.float32, torch.int8])
+def test_generic_dot(dtype, device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr, BLOCK_K: tl.constexpr,
+               ACC_TYPE: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, BLOCK_K)
+        acc = tl.zeros((M, N), dtype=ACC_TYPE)
+        for k in range(0, K, BLOCK_K):
+            a = tl.load(a_ptr + offs_m[:, None] * K + (k + offs_k)[None, :])
+            b = tl.load(b_ptr + (k + offs_k)[:, None] * N + offs_n[None, :])
+            acc += tl.dot(a, b, out_dtype=ACC_TYPE)
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], acc)
+
+    # N is too small for the FMA lowering, so the generic one is used.
+    M, N, K, BLOCK_K = 16, 4, 64, 16
+    if dtype == torch.int8:
+        a = torch.randint(-128, 128, (M, K), dtype=dtype, device='cpu')
+        b = torch.randint(-128, 128, (K, N), dtype=dtype, device='cpu')
+        res = torch.empty((M, N), dtype=torch.int32, device='cpu')
+        meta = kernel[(1, )](a, b, res, M, N, K, BLOCK_K, tl.int32)
+        torch.testing.assert_close(res, (a.long() @ b.long()).int())
+    else:
+        a = torch.randn((M, K), dtype=dtype, device='cpu')
+        b = torch.randn((K, N), dtype=dtype, device='cpu')
+        res = torch.empty((M, N), dtype=torch.float32, device='cpu')
+        meta = kernel[(1, )](a, b, res, M, N, K, BLOCK_K, tl.float32)
+        torch.testing.assert_close(res, a @ b, rtol=1e-4, atol=1e-4)
+        assert "vector.fma" in meta.asm["tttcir"]
+    assert "vector.contract" not in meta.asm["tttcir"]
+
+
+@pytest.mark.parametrize("dtype", [torch.float32, torch.bfloat16])
+@pytest.mark.parametrize("acc_block", [(1, 1), (4, 2)])
+def test_dot_acc_block(dtype, acc_block, device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, K)
+        a = tl.load(a_ptr + offs_m[:, None] * K + offs_k[None, :])
+        b = tl.load(b_ptr + offs_k[:, None] * N + offs_n[None, :])
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], tl.dot(a, b, out_dtype=tl.float32))
+
+    # Explicit blocking is used for both AMX and FMA lowerings, AMX one doesn't fit tiles
+    # for (4, 2) and falls back to the cost model.
+    M, N, K = 64, 64, 32
+    a = torch.randn((M, K), dtype=dtype, device='cpu')
+    b = torch.randn((K, N), dtype=dtype, device='cpu')
+    res = torch.empty((M, N), dtype=torch.float32, device='cpu')
+    kernel[(1, )](a, b, res, M, N, K, amx_acc_block=acc_block, fma_acc_block=acc_block)
+    torch.testing.assert_close(res, a.to(torch.float32) @ b.to(torch.float32), rtol=1e-2, atol=1e-2)
+
+
+def test_amx_shared_tile_config(device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, d_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr, K2: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, K)
+        offs_k2 = tl.arange(0, K2)
+        a = tl.load(a_ptr + offs_m[:, None] * K + offs_k[None, :])
+        b = tl.load(b_ptr + offs_k[:, None] * N + offs_n[None, :])
+        c = tl.dot(a, b, out_dtype=tl.float32).to(tl.bfloat16)
+        d = tl.load(d_ptr + offs_n[:, None] * K2 + offs_k2[None, :])
+        tl.store(c_ptr + offs_m[:, None] * K2 + offs_k2[None, :], tl.dot(c, d, out_dtype=tl.float32))
+
+    # The two dots have different K and use different input tile shapes, so the
+    # first accumulator block is shrunk to fit a single function-wide tile config.
+    M, N, K, K2 = 64, 64, 16, 16
+    a = torch.randn((M, K), dtype=torch.bfloat16, device='cpu')
+    b = torch.randn((K, N), dtype=torch.bfloat16, device='cpu')
+    d = torch.randn((N, K2), dtype=torch.bfloat16, device='cpu')
+    res = torch.empty((M, K2), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](a, b, res, d, M, N, K, K2)
+    ref = (a.float() @ b.float()).to(torch.bfloat16).float() @ d.float()
+    torch.testing.assert_close(res, ref, rtol=1e-2, atol=1e-2)
+
+    if triton.runtime.driver.active.utils.get_device_properties(0)["amx_bf16"]:
+        tttcir = meta.asm["tttcir"]
+        assert "amx.tile_mulf" in tttcir
+        # Alone, the first dot would use 2x2 accumulator blocks and 7 tile registers, the second one 4x1 blocks
+        # and 6 registers, 9 registers of different shapes in total. The first dot is shrunk to 1x2 blocks, so
+        # its RHS tiles are loaded in 8 blocks of 2 tiles instead of 4 blocks of 2 tiles.
+        assert len(re.findall(r"amx\.tile_load [^\n]*!amx\.tile<8x32xbf16>", tttcir)) == 16
+
+
+@pytest.mark.parametrize("b_dtype", [torch.float16, torch.int8])
+def test_mixed_precision_fma_dot(b_dtype, device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, K)
+        a = tl.load(a_ptr + offs_m[:, None] * K + offs_k[None, :])
+        b = tl.load(b_ptr + offs_k[:, None] * N + offs_n[None, :]).to(tl.float32)
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], tl.dot(a, b))
+
+    M, N, K = 16, 32, 32
+    a = torch.randn((M, K), dtype=torch.float32, device='cpu')
+    if b_dtype == torch.int8:
+        b = torch.randint(-128, 128, (K, N), dtype=b_dtype, device='cpu')
+    else:
+        b = torch.randn((K, N), dtype=b_dtype, device='cpu')
+    res = torch.empty((M, N), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](a, b, res, M, N, K)
+    torch.testing.assert_close(res, a @ b.float(), rtol=1e-4, atol=1e-4)
+
+    # B is read from the input and converted in registers, not through a converted copy.
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    if "avx512f" in features or ("avx2" in features and "fma" in features):
+        assert "memref.alloca" not in meta.asm["tttcir"]
+
+
+def test_fused_dequant_fma_dot(device):
+
+    @triton.jit
+    def kernel(a_ptr, w_ptr, zp_ptr, scale_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, K)
+        a = tl.load(a_ptr + offs_m[:, None] * K + offs_k[None, :])
+        w = tl.load(w_ptr + offs_k[:, None] * N + offs_n[None, :])
+        zp = tl.load(zp_ptr + offs_n)
+        scale = tl.load(scale_ptr + offs_n)
+        b = (w.to(tl.float32) - zp[None, :]) * scale[None, :]
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], tl.dot(a, b))
+
+    M, N, K = 16, 32, 32
+    a = torch.randn((M, K), dtype=torch.float32, device='cpu')
+    w = torch.randint(-128, 128, (K, N), dtype=torch.int8, device='cpu')
+    zp = torch.randint(-8, 8, (N, ), device='cpu').float()
+    scale = torch.rand((N, ), dtype=torch.float32, device='cpu')
+    res = torch.empty((M, N), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](a, w, zp, scale, res, M, N, K)
+    torch.testing.assert_close(res, a @ ((w.float() - zp) * scale), rtol=1e-4, atol=1e-4)
+
+    # Dequantized weights are computed per row in registers, not in a temporary buffer.
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    if "avx512f" in features or ("avx2" in features and "fma" in features):
+        assert "memref.alloca" not in meta.asm["tttcir"]
+
+
+@pytest.mark.parametrize("M", [4, 8])
+def test_small_m_dot(M, device):
+
+    @triton.jit
+    def kernel(a_ptr, w_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        offs_k = tl.arange(0, K)
+        a = tl.load(a_ptr + offs_m[:, None] * K + offs_k[None, :])
+        # Weights are stored as [N, K], like in linear layers.
+        w = tl.load(w_ptr + offs_n[:, None] * K + offs_k[None, :])
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], tl.dot(a, tl.trans(w)))
+
+    N, K = 16, 64
+    a = torch.randn((M, K), dtype=torch.float32, device='cpu')
+    w = torch.randn((N, K), dtype=torch.float32, device='cpu')
+    res = torch.empty((M, N), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](a, w, res, M, N, K)
+    torch.testing.assert_close(res, a @ w.T, rtol=1e-4, atol=1e-4)
+
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    if "avx512f" in features or ("avx2" in features and "fma" in features):
+        assert "vector.reduction <add>" in meta.asm["tttcir"]
+
+
+def test_batched_dot(device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, B: tl.constexpr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr,
+               BLOCK_K: tl.constexpr):
+        a_block_ptr = tl.make_block_ptr(base=a_ptr, shape=(B, M, K), strides=(M * K, K, 1), offsets=(0, 0, 0),
+                                        block_shape=(B, M, BLOCK_K), order=(2, 1, 0))
+        b_block_ptr = tl.make_block_ptr(base=b_ptr, shape=(B, K, N), strides=(K * N, N, 1), offsets=(0, 0, 0),
+                                        block_shape=(B, BLOCK_K, N), order=(2, 1, 0))
+        acc = tl.zeros((B, M, N), dtype=tl.float32)
+        for k in range(0, K, BLOCK_K):
+            acc += tl.dot(tl.load(a_block_ptr), tl.load(b_block_ptr))
+            a_block_ptr = tl.advance(a_block_ptr, (0, 0, BLOCK_K))
+            b_block_ptr = tl.advance(b_block_ptr, (0, BLOCK_K, 0))
+        c_block_ptr = tl.make_block_ptr(base=c_ptr, shape=(B, M, N), strides=(M * N, N, 1), offsets=(0, 0, 0),
+                                        block_shape=(B, M, N), order=(2, 1, 0))
+        tl.store(c_block_ptr, acc)
+
+    B, M, N, K, BLOCK_K = 4, 16, 32, 64, 16
+    a = torch.randn((B, M, K), dtype=torch.float32, device='cpu')
+    b = torch.randn((B, K, N), dtype=torch.float32, device='cpu')
+    res = torch.empty((B, M, N), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](a, b, res, B, M, N, K, BLOCK_K)
+    torch.testing.assert_close(res, torch.bmm(a, b), rtol=1e-4, atol=1e-4)
+
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    if "avx512f" in features or ("avx2" in features and "fma" in features):
+        assert "vector.fma" in meta.asm["tttcir"]
+
+
+@pytest.mark.parametrize("out_dtype", [torch.float32, torch.float16])
+@pytest.mark.parametrize("num_threads", [1, 4])
+def test_split_k(out_dtype, num_threads, device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M, N, K, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr, BLOCK_K: tl.constexpr):
+        offs_m = tl.program_id(0) * BLOCK_M + tl.arange(0, BLOCK_M)
+        offs_n = tl.program_id(1) * BLOCK_N + tl.arange(0, BLOCK_N)
+        offs_k = tl.arange(0, BLOCK_K)
+        a_ptrs = a_ptr + offs_m[:, None] * K + offs_k[None, :]
+        b_ptrs = b_ptr + offs_k[:, None] * N + offs_n[None, :]
+        acc = tl.zeros((BLOCK_M, BLOCK_N), dtype=tl.float32)
+        for k in range(0, K, BLOCK_K):
+            acc += tl.dot(tl.load(a_ptrs + k), tl.load(b_ptrs + k * N))
+        c = tl.maximum(acc, 0.0).to(c_ptr.dtype.element_ty)
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], c)
+
+    M, N, K = 32, 32, 512
+    BLOCK_M, BLOCK_N, BLOCK_K = 16, 32, 32
+    a = torch.randn((M, K), dtype=torch.float32)
+    b = torch.randn((K, N), dtype=torch.float32)
+    grid = (M // BLOCK_M, N // BLOCK_N)
+    # Run twice to check that tile counters are reset.
+    for _ in range(2):
+        c = torch.empty((M, N), dtype=out_dtype)
+        meta = kernel[grid](a, b, c, M, N, K, BLOCK_M, BLOCK_N, BLOCK_K, split_k=8, num_threads=num_threads)
+        torch.testing.assert_close(c, torch.relu(a @ b).to(out_dtype), rtol=1e-3, atol=1e-3)
+    assert meta.metadata.split_k_slot_size == BLOCK_M * BLOCK_N * 4
+    assert "tt.atomic_rmw" in meta.asm["ttcir"]
+
+
+@pytest.mark.parametrize("ptr_form", ["tensor", "block"])
+def test_split_k_loop_carried_ptrs(ptr_form, device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M, N, K, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr, BLOCK_K: tl.constexpr,
+               PTR_FORM: tl.constexpr):
+        offs_m = tl.program_id(0) * BLOCK_M + tl.arange(0, BLOCK_M)
+        offs_n = tl.program_id(1) * BLOCK_N + tl.arange(0, BLOCK_N)
+        offs_k = tl.arange(0, BLOCK_K)
+        acc = tl.zeros((BLOCK_M, BLOCK_N), dtype=tl.float32)
+        if PTR_FORM == "tensor":
+            a_ptrs = a_ptr + offs_m[:, None] * K + offs_k[None, :]
+            b_ptrs = b_ptr + offs_k[:, None] * N + offs_n[None, :]
+            for k in range(0, K, BLOCK_K):
+                acc += tl.dot(tl.load(a_ptrs), tl.load(b_ptrs))
+                a_ptrs += BLOCK_K
+                b_ptrs += BLOCK_K * N
+        else:
+            a_block = tl.make_block_ptr(a_ptr, (M, K), (K, 1), (tl.program_id(0) * BLOCK_M, 0), (BLOCK_M, BLOCK_K),
+                                        (1, 0))
+            b_block = tl.make_block_ptr(b_ptr, (K, N), (N, 1), (0, tl.program_id(1) * BLOCK_N), (BLOCK_K, BLOCK_N),
+                                        (1, 0))
+            for k in range(0, K, BLOCK_K):
+                acc += tl.dot(tl.load(a_block), tl.load(b_block))
+                a_block = tl.advance(a_block, (0, BLOCK_K))
+                b_block = tl.advance(b_block, (BLOCK_K, 0))
+        tl.store(c_ptr + offs_m[:, None] * N + offs_n[None, :], acc)
+
+    M, N, K = 32, 32, 512
+    BLOCK_M, BLOCK_N, BLOCK_K = 16, 32, 32
+    a = torch.randn((M, K), dtype=torch.float32)
+    b = torch.randn((K, N), dtype=torch.float32)
+    c = torch.empty((M, N), dtype=torch.float32)
+    # Each split starts with pointers advanced past the K tiles of the previous splits.
+    meta = kernel[(M // BLOCK_M, N // BLOCK_N)](a, b, c, M, N, K, BLOCK_M, BLOCK_N, BLOCK_K, ptr_form, split_k=8,
+                                                 num_threads=4)
+    torch.testing.assert_close(c, a @ b, rtol=1e-3, atol=1e-3)
+    assert meta.metadata.split_k_slot_size == BLOCK_M * BLOCK_N * 4
+
+
+@pytest.mark.parametrize("a_format, b_format", [("e2m1", "e4m3"), ("e4m3", "e2m1"), ("e5m2", "bf16")])
+def test_scaled_dot(a_format, b_format, device):
+
+    @triton.jit
+    def kernel(a_ptr, a_scale_ptr, b_ptr, b_scale_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr,
+               A_FORMAT: tl.constexpr, B_FORMAT: tl.constexpr):
+        PACKED_K_A: tl.constexpr = K // 2 if A_FORMAT == "e2m1" else K
+        PACKED_K_B: tl.constexpr = K // 2 if B_FORMAT == "e2m1" else K
+        SCALE_K: tl.constexpr = K // 32
+        a = tl.load(a_ptr + tl.arange(0, M)[:, None] * PACKED_K_A + tl.arange(0, PACKED_K_A)[None, :])
+        b = tl.load(b_ptr + tl.arange(0, PACKED_K_B)[:, None] * N + tl.arange(0, N)[None, :])
+        a_scale = tl.load(a_scale_ptr + tl.arange(0, M)[:, None] * SCALE_K + tl.arange(0, SCALE_K)[None, :])
+        if B_FORMAT == "bf16":
+            b_scale = None
+        else:
+            b_scale = tl.load(b_scale_ptr + tl.arange(0, N)[:, None] * SCALE_K + tl.arange(0, SCALE_K)[None, :])
+        c = tl.dot_scaled(a, a_scale, A_FORMAT, b, b_scale, B_FORMAT)
+        tl.store(c_ptr + tl.arange(0, M)[:, None] * N + tl.arange(0, N)[None, :], c)
+
+    fp4_values = torch.tensor([0, 0.5, 1, 1.5, 2, 3, 4, 6, -0.0, -0.5, -1, -1.5, -2, -3, -4, -6])
+
+    def gen_operand(fmt, shape, k_dim):
+        if fmt == "e2m1":
+            # Pairs of values adjacent along K are packed into a byte, the first one in the low bits.
+            packed_shape = list(shape)
+            packed_shape[k_dim] //= 2
+            lo = torch.randint(0, 16, packed_shape, dtype=torch.uint8)
+            hi = torch.randint(0, 16, packed_shape, dtype=torch.uint8)
+            val = torch.stack([fp4_values[lo.long()], fp4_values[hi.long()]], dim=k_dim + 1).flatten(k_dim, k_dim + 1)
+            return lo | (hi << 4), val
+        dtype = {"e4m3": torch.float8_e4m3fn, "e5m2": torch.float8_e5m2, "bf16": torch.bfloat16}[fmt]
+        x = torch.randn(shape).to(dtype)
+        return x if fmt == "bf16" else x.view(torch.uint8), x.float()
+
+    M, N, K = 16, 32, 64
+    a, a_val = gen_operand(a_format, (M, K), 1)
+    b, b_val = gen_operand(b_format, (K, N), 0)
+    a_scale = torch.randint(124, 130, (M, K // 32), dtype=torch.uint8)
+    b_scale = torch.randint(124, 130, (N, K // 32), dtype=torch.uint8)
+    a_val = a_val * torch.exp2(a_scale.float() - 127).repeat_interleave(32, dim=1)
+    if b_format != "bf16":
+        b_val = b_val * torch.exp2(b_scale.float() - 127).repeat_interleave(32, dim=1).T
+    res = torch.empty((M, N), dtype=torch.float32)
+    kernel[(1, )](a, a_scale, b, b_scale, res, M, N, K, a_format, b_format)
+    torch.testing.assert_close(res, torch.matmul(a_val, b_val), rtol=1e-2, atol=1e-2)
+
+
+def test_vnni_encode(device):
+    from triton.language.extra.cpu import vnni_encode
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr):
+        a_block = tl.make_block_ptr(a_ptr, (M, K), (K, 1), (0, 0), (M, K), (1, 0))
+        # B is packed, pairs of its rows are interleaved.
+        b_block = tl.make_block_ptr(b_ptr, (K // 2, N * 2), (N * 2, 1), (0, 0), (K // 2, N * 2), (1, 0))
+        c_block = tl.make_block_ptr(c_ptr, (M, N), (N, 1), (0, 0), (M, N), (1, 0))
+        b = tl.extra.cpu.vnni_decode(tl.load(b_block))
+        tl.store(c_block, tl.dot(tl.load(a_block), b, out_dtype=tl.float32))
+
+    M, N, K = 32, 32, 32
+    a = torch.randn((M, K), dtype=torch.bfloat16, device='cpu')
+    b = torch.randn((K, N), dtype=torch.bfloat16, device='cpu')
+    b_packed = vnni_encode(b)
+    assert b_packed.shape == (K // 2, N * 2)
+    assert (b_packed[:, 0::2] == b[0::2]).all() and (b_packed[:, 1::2] == b[1::2]).all()
+    # The packed copy is reused until the tensor is modified.
+    assert vnni_encode(b) is b_packed
+    res = torch.empty((M, N), dtype=torch.float32, device='cpu')
+    kernel[(1, )](a, b_packed, res, M, N, K)
+    torch.testing.assert_close(res, a.float() @ b.float(), rtol=1e-2, atol=1e-2)
+
+    b.add_(1)
+    assert vnni_encode(b) is not b_packed
+    kernel[(1, )](a, vnni_encode(b), res, M, N, K)
+    torch.testing.assert_close(res, a.float() @ b.float(), rtol=1e-2, atol=1e-2)
+
+
+@pytest.mark.parametrize("dtype", [torch.bfloat16, torch.float32])
+def test_prepack(dtype, device):
+    from triton.language.extra.cpu import prepack
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr, BLOCK_K: tl.constexpr,
+               BLOCK_N: tl.constexpr, VNNI: tl.constexpr):
+        pid_n = tl.program_id(0)
+        a_block = tl.make_block_ptr(a_ptr, (M, K), (K, 1), (0, 0), (M, BLOCK_K), (1, 0))
+        acc = tl.zeros((M, BLOCK_N), dtype=tl.float32)
+        for k in range(0, K // BLOCK_K):
+            b = tl.extra.cpu.load_prepacked(b_ptr, k, pid_n, N // BLOCK_N, BLOCK_K, BLOCK_N, VNNI)
+            acc = tl.dot(tl.load(a_block), b, acc)
+            a_block = tl.advance(a_block, (0, BLOCK_K))
+        c_block = tl.make_block_ptr(c_ptr, (M, N), (N, 1), (0, pid_n * BLOCK_N), (M, BLOCK_N), (1, 0))
+        tl.store(c_block, acc)
+
+    M, N, K = 16, 64, 64
+    BLOCK_K, BLOCK_N = 32, 32
+    vnni = dtype == torch.bfloat16
+    a = torch.randn((M, K), dtype=dtype, device='cpu')
+    b = torch.randn((K, N), dtype=dtype, device='cpu')
+    b_packed = prepack(b, BLOCK_K, BLOCK_N)
+    pack_num = 2 if vnni else 1
+    assert b_packed.shape == (K // BLOCK_K, N // BLOCK_N, BLOCK_K // pack_num, BLOCK_N * pack_num)
+    assert (b_packed[1, 0, :, 0::pack_num] == b[BLOCK_K:2 * BLOCK_K:pack_num, :BLOCK_N]).all()
+    assert prepack(b, BLOCK_K, BLOCK_N) is b_packed
+    res = torch.empty((M, N), dtype=torch.float32, device='cpu')
+    kernel[(N // BLOCK_N, )](a, b_packed, res, M, N, K, BLOCK_K, BLOCK_N, vnni)
+    torch.testing.assert_close(res, a.float() @ b.float(), rtol=1e-2, atol=1e-2)
+
+
+def test_pack_dot_operands(device):
+
+    @triton.jit
+    def kernel(x_ptr, w_ptr, out_ptr, M, K: tl.constexpr, N: tl.constexpr, BLOCK_M: tl.constexpr):
+        # W is column-major, so rows of its tile aren't contiguous.
+        w_block = tl.make_block_ptr(w_ptr, (K, N), (1, K), (0, 0), (K, N), (0, 1))
+        for m in range(0, M, BLOCK_M):
+            x_block = tl.make_block_ptr(x_ptr, (M, K), (K, 1), (m, 0), (BLOCK_M, K), (1, 0))
+            out_block = tl.make_block_ptr(out_ptr, (M, N), (N, 1), (m, 0), (BLOCK_M, N), (1, 0))
+            x = tl.load(x_block, boundary_check=(0, ))
+            w = tl.load(w_block)
+            tl.store(out_block, tl.dot(x, w), boundary_check=(0, ))
+
+    M, K, N = 100, 32, 16
+    x = torch.rand((M, K), dtype=torch.float32, device='cpu')
+    w = torch.rand((N, K), dtype=torch.float32, device='cpu').T
+    allocas = {}
+    for pack in [False, True]:
+        res = torch.empty((M, N), dtype=torch.float32, device='cpu')
+        meta = kernel[(1, )](x, w, res, M, K, N, BLOCK_M=16, pack_dot_operands=pack)
+        torch.testing.assert_close(res, x @ w, rtol=1e-4, atol=1e-4)
+        allocas[pack] = meta.asm["tttcir"].count("memref.alloca")
+
+    # The W tile is copied to a stack buffer once before the loop.
+    assert allocas[True] == allocas[False] + 1
+
+
+@pytest.mark.parametrize("shape", [(64, 64), (50, 37)])
+def test_tensor_descriptor(shape, device):
+
+    @triton.jit
+    def kernel(src, dst, M, N, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr):
+        src_desc = tl.make_tensor_descriptor(src, [M, N], [N, 1], [BLOCK_M, BLOCK_N])
+        dst_desc = tl.make_tensor_descriptor(dst, [M, N], [N, 1], [BLOCK_M, BLOCK_N])
+        off_m = tl.program_id(0) * BLOCK_M
+        off_n = tl.program_id(1) * BLOCK_N
+        x = src_desc.load([off_m, off_n])
+        dst_desc.store([off_m, off_n], x + 1.0)
+
+    M, N = shape
+    src = torch.rand(shape, dtype=torch.float32, device='cpu')
+    res = torch.zeros(shape, dtype=torch.float32, device='cpu')
+    grid = (triton.cdiv(M, 16), triton.cdiv(N, 16))
+    meta = kernel[grid](src, res, M, N, BLOCK_M=16, BLOCK_N=16)
+    torch.testing.assert_close(res, src + 1.0)
+
+    # Blocks are clipped by the descriptor shape instead of element masks.
+    ttcir = meta.asm["ttcir"]
+    assert "vector.transfer_read" in ttcir
+    assert "vector.transfer_write" in ttcir
+    assert "tt.descriptor_load" not in ttcir
+    assert "vector.maskedload" not in ttcir
+    assert "vector.gather" not in ttcir
+
+
+@pytest.mark.parametrize("min_size", [0, 1024])
+def test_scratch_arena(min_size, device):
+
+    @triton.jit
+    def kernel(a, b, cond, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.arange(0, BLOCK_SIZE)
+        # Pointers with different bases are loaded by a scalar loop into a
+        # temporary buffer.
+        ptrs = tl.where(tl.load(cond + offs) != 0, a + offs, b + offs)
+        tl.store(dst + offs, tl.load(ptrs))
+
+    a = torch.rand((1024, ), dtype=torch.float32, device='cpu')
+    b = torch.rand((1024, ), dtype=torch.float32, device='cpu')
+    cond = torch.randint(0, 2, (1024, ), dtype=torch.int32, device='cpu')
+    res = torch.empty((1024, ), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](a, b, cond, res, BLOCK_SIZE=1024, scratch_arena_min_size=min_size)
+    torch.testing.assert_close(res, torch.where(cond != 0, a, b))
+
+    if min_size:
+        assert meta.metadata.scratch_arena_size >= 4096
+        assert "triton_cpu_scratch_arena" in meta.asm["llir"]
+    else:
+        assert meta.metadata.scratch_arena_size == 0
+        assert "triton_cpu_scratch_arena" not in meta.asm["llir"]
+
+
 # Regression test for compilation failure in masks optimization
 def test_vec_cdiv(device):
 
@@ -80,3 +980,1191 @@ def test_vec_cdiv(device):
     arg0 = torch.zeros((16, ), dtype=torch.int32)
     arg1 = torch.empty_like(arg0)
     kernel[(1, )](arg0, arg1)
+
+
+@pytest.mark.parametrize("M", [4096, 2])
+def test_histogram(M, device):
+
+    @triton.jit
+    def kernel(x_ptr, z_ptr, M: tl.constexpr, N: tl.constexpr):
+        x = tl.load(x_ptr + tl.arange(0, M))
+        tl.store(z_ptr + tl.arange(0, N), tl.histogram(x, N))
+
+    # Values out of the bins range are ignored.
+    N = 16
+    x = torch.randint(-4, N + 4, (M, ), dtype=torch.int32, device='cpu')
+    z = torch.empty(N, dtype=torch.int32, device='cpu')
+    meta = kernel[(1, )](x, z, M, N)
+    ref = torch.bincount(x[(x >= 0) & (x < N)], minlength=N).to(torch.int32)
+    torch.testing.assert_close(z, ref)
+    assert "scf.for" in meta.asm["ttcir"]
+
+
+@pytest.mark.parametrize("dtype", [torch.float32, torch.int32])
+def test_atomic_add(dtype, device):
+
+    @triton.jit
+    def kernel(x_ptr, mask_ptr, sum_ptr, out_ptr, old_ptr, N: tl.constexpr):
+        offs = tl.arange(0, N)
+        x = tl.load(x_ptr + offs)
+        mask = tl.load(mask_ptr + offs) != 0
+        # All lanes update the same address and are combined in registers.
+        tl.atomic_add(sum_ptr, x, mask=mask)
+        old = tl.atomic_add(out_ptr + offs, x, mask=mask)
+        tl.store(old_ptr + offs, old)
+
+    N = 64
+    x = torch.randint(-10, 10, (N, ), device='cpu').to(dtype)
+    mask = torch.randint(0, 2, (N, ), dtype=torch.int32, device='cpu')
+    sum = torch.zeros((1, ), dtype=dtype, device='cpu')
+    out = torch.ones((N, ), dtype=dtype, device='cpu')
+    old = torch.empty((N, ), dtype=dtype, device='cpu')
+    kernel[(1, )](x, mask, sum, out, old, N)
+    selected = mask != 0
+    torch.testing.assert_close(sum, x[selected].sum().reshape(1))
+    torch.testing.assert_close(out, torch.where(selected, x + 1, 1).to(dtype))
+    torch.testing.assert_close(old, torch.where(selected, 1, 0).to(dtype))
+
+
+@pytest.mark.parametrize("dtype", [torch.float16, torch.bfloat16])
+@pytest.mark.parametrize("offset", [0, 1])
+def test_half_atomic_add(dtype, offset, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, old_ptr, N: tl.constexpr):
+        offs = tl.arange(0, N)
+        x = tl.load(x_ptr + offs)
+        old = tl.atomic_add(out_ptr + offs, x, mask=offs < N - 1)
+        tl.store(old_ptr + offs, old)
+
+    # Misaligned outputs go through per-element atomics.
+    N = 32
+    x = torch.randint(-4, 4, (N, ), device='cpu').to(dtype)
+    buf = torch.ones((N + 1, ), dtype=dtype, device='cpu')
+    out = buf[offset:offset + N]
+    old = torch.empty((N, ), dtype=dtype, device='cpu')
+    kernel[(1, )](x, out, old, N)
+    torch.testing.assert_close(old[:-1], torch.ones((N - 1, ), dtype=dtype))
+    assert old[-1] == 0
+    kernel[(4, )](x, out, old, N)
+    ref = torch.ones((N, ), dtype=torch.float32) + 5 * x.float()
+    ref[-1] = 1
+    torch.testing.assert_close(out.float(), ref)
+
+
+@pytest.mark.parametrize("dtype", [torch.float32, torch.int64])
+def test_defer_scalar_atomics(dtype, device):
+
+    @triton.jit
+    def kernel(x_ptr, sum_ptr, BLOCK: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK + tl.arange(0, BLOCK)
+        tl.atomic_add(sum_ptr, tl.sum(tl.load(x_ptr + offs)))
+
+    BLOCK, num_programs = 16, 256
+    x = torch.randint(-10, 10, (BLOCK * num_programs, ), device='cpu').to(dtype)
+    # Run twice to check that slots are reset, and with another target to check that slots
+    # don't keep targets of previous launches.
+    for _ in range(2):
+        sum = torch.ones((1, ), dtype=dtype, device='cpu')
+        meta = kernel[(num_programs, )](x, sum, BLOCK, defer_scalar_atomics=True, num_threads=4)
+        torch.testing.assert_close(sum, x.sum().reshape(1) + 1)
+    assert meta.metadata.thread_partials == {torch.float32: "fp32", torch.int64: "i64"}[dtype]
+    assert "triton_cpu.thread_slot" in meta.asm["ttcir"]
+
+
+def test_deterministic_atomics(device):
+
+    @triton.jit
+    def kernel(x_ptr, sum_ptr, BLOCK: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK + tl.arange(0, BLOCK)
+        tl.atomic_add(sum_ptr, tl.sum(tl.load(x_ptr + offs)))
+
+    @triton.jit
+    def hist_kernel(x_ptr, out_ptr, BLOCK: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK + tl.arange(0, BLOCK)
+        tl.atomic_add(out_ptr + offs % 4, tl.load(x_ptr + offs))
+
+    BLOCK, num_programs = 16, 1000
+    # Values of different magnitudes make float sums depend on the order of additions.
+    x = torch.randn((BLOCK * num_programs, ), device='cpu') * torch.logspace(-8, 8, BLOCK * num_programs)
+    results = []
+    for num_threads, schedule in [(1, "static"), (3, "static"), (4, "steal"), (0, "steal")]:
+        sum = torch.zeros((1, ), device='cpu')
+        meta = kernel[(num_programs, )](x, sum, BLOCK, deterministic=True, num_threads=num_threads,
+                                        schedule=schedule)
+        results.append(sum)
+    assert all(torch.equal(res, results[0]) for res in results)
+    torch.testing.assert_close(results[0], x.sum().reshape(1), rtol=1e-4, atol=1e-4)
+    assert "triton_cpu.thread_slot" not in meta.asm["ttcir"]
+
+    # Tensor atomics can't be deferred and run on a single thread.
+    out = torch.zeros((4, ), device='cpu')
+    meta = hist_kernel[(num_programs, )](x, out, BLOCK, deterministic=True, num_threads=4)
+    assert meta.metadata.num_threads == 1
+
+
+def test_spin_lock_backoff(device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, lock_ptr, BLOCK: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK + tl.arange(0, BLOCK)
+        partial = tl.sum(tl.load(x_ptr + offs))
+        while tl.atomic_cas(lock_ptr, 0, 1) == 1:
+            pass
+        tl.store(out_ptr, tl.load(out_ptr) + partial)
+        tl.atomic_xchg(lock_ptr, 0)
+
+    BLOCK, num_programs = 16, 512
+    x = torch.randint(-10, 10, (BLOCK * num_programs, ), dtype=torch.int32, device='cpu')
+    out = torch.zeros((1, ), dtype=torch.int32, device='cpu')
+    lock = torch.zeros((1, ), dtype=torch.int32, device='cpu')
+    meta = kernel[(num_programs, )](x, out, lock, BLOCK, num_threads=4)
+    assert out.item() == x.sum().item()
+    assert lock.item() == 0
+    assert "triton_cpu.spin_wait" in meta.asm["tttcir"]
+
+
+@pytest.mark.parametrize("dtype", [torch.float32, torch.int32])
+@pytest.mark.parametrize("reverse", [False, True])
+def test_blocked_scan(dtype, reverse, device):
+
+    @triton.jit
+    def combine(a, a_idx, b, b_idx):
+        return a + b, tl.maximum(a_idx, b_idx)
+
+    @triton.jit
+    def kernel(x_ptr, sum_ptr, idx_ptr, N: tl.constexpr, REVERSE: tl.constexpr):
+        offs = tl.arange(0, N)
+        x = tl.load(x_ptr + offs)
+        sum, idx = tl.associative_scan((x, offs), 0, combine, reverse=REVERSE)
+        tl.store(sum_ptr + offs, sum)
+        tl.store(idx_ptr + offs, idx)
+
+    # Scans longer than a vector register are scanned in chunks with a carry.
+    N = 1024
+    x = torch.randint(-10, 10, (N, ), device='cpu').to(dtype)
+    sum = torch.empty_like(x)
+    idx = torch.empty((N, ), dtype=torch.int32, device='cpu')
+    kernel[(1, )](x, sum, idx, N, reverse)
+    offs = torch.arange(N, dtype=torch.int32)
+    if reverse:
+        ref = x.flip(0).cumsum(0).flip(0).to(dtype)
+        ref_idx = torch.full((N, ), N - 1, dtype=torch.int32)
+    else:
+        ref = x.cumsum(0).to(dtype)
+        ref_idx = offs
+    torch.testing.assert_close(sum, ref)
+    torch.testing.assert_close(idx, ref_idx)
+
+
+@pytest.mark.parametrize("dtype", [torch.float32, torch.int32])
+@pytest.mark.parametrize("schedule", ["static", "steal"])
+def test_single_pass_cumsum(dtype, schedule, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, status_ptr, BLOCK: tl.constexpr):
+        block_id = tl.extra.cpu.scan_block_id(status_ptr)
+        offs = block_id * BLOCK + tl.arange(0, BLOCK)
+        x = tl.load(x_ptr + offs)
+        prefix = tl.extra.cpu.exclusive_block_prefix(status_ptr, block_id, tl.sum(x))
+        tl.store(out_ptr + offs, tl.cumsum(x, 0) + prefix)
+
+    # More blocks than threads, and threads run contiguous ranges of programs.
+    BLOCK, num_blocks = 64, 512
+    x = torch.randint(-10, 10, (BLOCK * num_blocks, ), device='cpu').to(dtype)
+    out = torch.empty_like(x)
+    status = torch.zeros((num_blocks + 1, ), dtype=torch.int64, device='cpu')
+    kernel[(num_blocks, )](x, out, status, BLOCK, num_threads=4, schedule=schedule)
+    torch.testing.assert_close(out, x.cumsum(0).to(dtype))
+    assert status[0] == num_blocks
+
+
+@pytest.mark.parametrize("axis", [0, 1])
+def test_multi_operand_reduction(axis, device):
+
+    @triton.jit
+    def welford_combine(mean1, m2_1, weight1, mean2, m2_2, weight2):
+        weight = weight1 + weight2
+        w2_over_w = tl.where(weight == 0.0, 0.0, weight2 / weight)
+        delta = mean2 - mean1
+        return mean1 + delta * w2_over_w, m2_1 + m2_2 + delta * delta * weight1 * w2_over_w, weight
+
+    @triton.jit
+    def kernel(x_ptr, max_ptr, min_ptr, mean_ptr, var_ptr, M: tl.constexpr, N: tl.constexpr, AXIS: tl.constexpr):
+        x = tl.load(x_ptr + tl.arange(0, M)[:, None] * N + tl.arange(0, N)[None, :])
+        offs = tl.arange(0, N if AXIS == 0 else M)
+        tl.store(max_ptr + offs, tl.argmax(x, AXIS))
+        tl.store(min_ptr + offs, tl.argmin(x, AXIS))
+        mean, m2, weight = tl.reduce((x, tl.zeros_like(x), tl.full(x.shape, 1.0, tl.float32)), AXIS,
+                                     welford_combine)
+        tl.store(mean_ptr + offs, mean)
+        tl.store(var_ptr + offs, m2 / weight)
+
+    # Reductions with multiple inputs are lowered to trees over halves of vectors.
+    M, N = 16, 64
+    x = torch.randn((M, N), dtype=torch.float32, device='cpu')
+    size = N if axis == 0 else M
+    amax = torch.empty((size, ), dtype=torch.int32, device='cpu')
+    amin = torch.empty((size, ), dtype=torch.int32, device='cpu')
+    mean = torch.empty((size, ), dtype=torch.float32, device='cpu')
+    var = torch.empty((size, ), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](x, amax, amin, mean, var, M, N, axis)
+    torch.testing.assert_close(amax, x.argmax(axis).to(torch.int32))
+    torch.testing.assert_close(amin, x.argmin(axis).to(torch.int32))
+    torch.testing.assert_close(mean, x.mean(axis))
+    torch.testing.assert_close(var, x.var(axis, unbiased=False))
+    assert "vector.extract_strided_slice" in meta.asm["ttcir"]
+
+
+@pytest.mark.parametrize("dtype", [torch.float32, torch.int32])
+@pytest.mark.parametrize("axis", [0, 1])
+def test_split_multi_reduction(dtype, axis, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, M: tl.constexpr, N: tl.constexpr, AXIS: tl.constexpr):
+        x = tl.load(x_ptr + tl.arange(0, M)[:, None] * N + tl.arange(0, N)[None, :])
+        offs = tl.arange(0, N if AXIS == 0 else M)
+        tl.store(out_ptr + offs, tl.sum(x, AXIS))
+
+    M, N = 32, 256
+    x = torch.randint(-10, 10, (M, N), device='cpu').to(dtype)
+    out = torch.empty((N if axis == 0 else M, ), dtype=dtype, device='cpu')
+    meta = kernel[(1, )](x, out, M, N, axis)
+    torch.testing.assert_close(out, x.sum(axis).to(dtype))
+    if dtype == torch.float32:
+        # Float sums are reduced with trees instead of ordered horizontal reductions.
+        assert "llvm.vector.reduce.fadd" not in meta.asm["llir"]
+
+
+@pytest.mark.parametrize("axis", [0, 1])
+def test_transposed_reduction(axis, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, M: tl.constexpr, N: tl.constexpr, AXIS: tl.constexpr):
+        x = tl.load(x_ptr + tl.arange(0, M)[:, None] * N + tl.arange(0, N)[None, :])
+        offs = tl.arange(0, M if AXIS == 0 else N)
+        tl.store(out_ptr + offs, tl.sum(tl.trans(x), AXIS))
+
+    # Sums of a transposed tile reduce the tile along the other axis, e.g. row sums become vertical adds of rows.
+    M, N = 32, 64
+    x = torch.randn((M, N), dtype=torch.float32, device='cpu')
+    out = torch.empty((M if axis == 0 else N, ), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](x, out, M, N, axis)
+    torch.testing.assert_close(out, x.t().sum(axis))
+    assert "vector.transpose" not in meta.asm["ttcir"]
+
+
+@pytest.mark.parametrize("dtype", [torch.float32, torch.int32])
+@pytest.mark.parametrize("k", [1, 8, 256])
+def test_sort_topk(dtype, k, device):
+
+    @triton.jit
+    def kernel(x_ptr, sorted_ptr, top_ptr, M: tl.constexpr, N: tl.constexpr, K: tl.constexpr):
+        x = tl.load(x_ptr + tl.arange(0, M)[:, None] * N + tl.arange(0, N)[None, :])
+        tl.store(sorted_ptr + tl.arange(0, M)[:, None] * N + tl.arange(0, N)[None, :],
+                 tl.extra.cpu.sort(x, descending=True))
+        tl.store(top_ptr + tl.arange(0, M)[:, None] * K + tl.arange(0, K)[None, :], tl.extra.cpu.topk(x, K))
+
+    M, N = 4, 256
+    x = torch.randn((M, N), device='cpu')
+    x = (x * 1000).to(dtype) if dtype == torch.int32 else x
+    sorted = torch.empty_like(x)
+    top = torch.empty((M, k), dtype=dtype, device='cpu')
+    kernel[(1, )](x, sorted, top, M, N, k)
+    ref = torch.sort(x, dim=1, descending=True).values
+    torch.testing.assert_close(sorted, ref)
+    torch.testing.assert_close(top, ref[:, :k])
+
+
+@pytest.mark.parametrize("block", [1, 16, 128])
+def test_vector_umulhi(block, device):
+
+    @triton.jit
+    def kernel(x_ptr, y_ptr, out_ptr, BLOCK: tl.constexpr):
+        offs = tl.arange(0, BLOCK)
+        x = tl.load(x_ptr + offs)
+        y = tl.load(y_ptr + offs)
+        tl.store(out_ptr + offs, tl.math.umulhi(x, y))
+
+    # Even and odd elements of vectors are multiplied separately with 32x32->64 multiplications.
+    x = torch.randint(0, 2**32, (block, ), dtype=torch.int64)
+    y = torch.randint(0, 2**32, (block, ), dtype=torch.int64)
+    out = torch.empty((block, ), dtype=torch.int32, device='cpu')
+    meta = kernel[(1, )](x.to(torch.int32), y.to(torch.int32), out, block)
+    ref = torch.tensor([(a * b) >> 32 for a, b in zip(x.tolist(), y.tolist())], dtype=torch.int64)
+    torch.testing.assert_close(out, ref.to(torch.int32))
+    if block > 1:
+        assert "arith.mului_extended" not in meta.asm["ttcir"]
+
+
+@pytest.mark.parametrize("math_fn", ["sqrt", "floor", "ceil", "fma", "exp"])
+def test_native_fp16_math(math_fn, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, MATH_FN: tl.constexpr, BLOCK: tl.constexpr):
+        offs = tl.arange(0, BLOCK)
+        x = tl.load(x_ptr + offs)
+        if MATH_FN == "fma":
+            y = tl.fma(x, x, x)
+        else:
+            y = getattr(tl, MATH_FN)(x)
+        tl.store(out_ptr + offs, y)
+
+    BLOCK = 64
+    x = torch.rand((BLOCK, ), dtype=torch.float16, device='cpu') * 4
+    out = torch.empty_like(x)
+    meta = kernel[(1, )](x, out, math_fn, BLOCK)
+    x32 = x.to(torch.float32)
+    ref = x32 * x32 + x32 if math_fn == "fma" else getattr(torch, math_fn)(x32)
+    torch.testing.assert_close(out, ref.to(torch.float16))
+    # Correctly rounded operations are computed in FP16 on targets with FP16 arithmetic, transcendental
+    # functions still use FP32.
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    if math_fn != "exp" and ("avx512fp16" in features or "fullfp16" in features):
+        tttcir = meta.asm["tttcir"]
+        assert "arith.extf" not in tttcir
+        assert re.search(rf"math\.{math_fn} [^\n]*: vector<\d+xf16>", tttcir)
+
+
+@pytest.mark.parametrize("math_fn", ["exp", "log", "tanh", "sigmoid"])
+def test_inline_math(math_fn, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, MATH_FN: tl.constexpr, BLOCK: tl.constexpr):
+        offs = tl.arange(0, BLOCK)
+        x = tl.load(x_ptr + offs)
+        if MATH_FN == "tanh":
+            y = libdevice.tanh(x)
+        else:
+            y = getattr(tl, MATH_FN)(x)
+        tl.store(out_ptr + offs, y)
+
+    BLOCK = 128
+    x = torch.rand((BLOCK, ), dtype=torch.float32, device='cpu') * 8 - 4
+    x = x.abs() if math_fn == "log" else x
+    out = torch.empty_like(x)
+    meta = kernel[(1, )](x, out, math_fn, BLOCK, inline_math=True)
+    torch.testing.assert_close(out, getattr(torch, math_fn)(x), rtol=1e-5, atol=1e-6)
+    # Functions are expanded to polynomials instead of vector library calls.
+    assert "Sleef_" not in meta.asm["asm"]
+
+
+def test_bitcode_libs(tmp_path, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, BLOCK: tl.constexpr):
+        offs = tl.arange(0, BLOCK)
+        x = tl.load(x_ptr + offs)
+        y = tl.extern_elementwise("", "", [x], {(tl.float32, ): ("test_add_one_f%(numel)", tl.float32)},
+                                  is_pure=True)
+        tl.store(out_ptr + offs, y)
+
+    # Textual IR is accepted as well as bitcode.
+    lib = tmp_path / "lib.ll"
+    lib.write_text("".join(f"""
+define <{n} x float> @test_add_one_f{n}(<{n} x float> %x) {{
+  %y = fadd <{n} x float> %x, splat (float 1.0)
+  ret <{n} x float> %y
+}}
+""" for n in (4, 8, 16)))
+    x = torch.randn((64, ), dtype=torch.float32, device='cpu')
+    out = torch.empty_like(x)
+    meta = kernel[(1, )](x, out, 64, bitcode_libs=(str(lib), ))
+    torch.testing.assert_close(out, x + 1)
+    # Linked functions are inlined into the kernel.
+    assert "test_add_one_f" not in meta.asm["asm"]
+
+
+@core.extern
+def _add_two(x, _builder=None):
+    variants = {n: tl.extra.cpu.vector_abi_name("test_add_two", isa, n) for isa, n in (("b", 4), ("d", 8))}
+    return tl.extra.cpu.vector_extern_elementwise([x], {(tl.float32, ): ("test_add_two", variants, tl.float32)},
+                                                  _builder=_builder)
+
+
+@pytest.mark.parametrize("size", [2, 12, 64])
+def test_vector_extern_variants(size, tmp_path, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, BLOCK: tl.constexpr, SIZE: tl.constexpr):
+        offs = tl.arange(0, BLOCK)
+        mask = offs < SIZE
+        x = tl.load(x_ptr + offs, mask=mask)
+        tl.store(out_ptr + offs, _add_two(x), mask=mask)
+
+    # Only vector variants are defined, so calls of the scalar function would fail to link.
+    lib = tmp_path / "lib.ll"
+    lib.write_text("".join(f"""
+define <{n} x float> @_ZGV{isa}N{n}v_test_add_two(<{n} x float> %x) {{
+  %y = fadd <{n} x float> %x, splat (float 2.0)
+  ret <{n} x float> %y
+}}
+""" for isa, n in (("b", 4), ("d", 8))))
+    x = torch.randn((size, ), dtype=torch.float32, device='cpu')
+    out = torch.empty_like(x)
+    kernel[(1, )](x, out, triton.next_power_of_2(size), size, bitcode_libs=(str(lib), ))
+    torch.testing.assert_close(out, x + 2)
+
+
+@pytest.mark.parametrize("dst_dtype", [torch.float16, torch.float32, torch.bfloat16])
+def test_fp8_lookup_decode(dst_dtype, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, M: tl.constexpr, N: tl.constexpr):
+        offs = tl.arange(0, M)[:, None] * N + tl.arange(0, N)[None, :]
+        x = tl.load(x_ptr + offs)
+        tl.store(out_ptr + offs, x.to(out_ptr.dtype.element_ty))
+
+    # All codes including subnormals and NaNs, decoded with table lookups on AVX512-VBMI and NEON targets.
+    M, N = 4, 64
+    x = torch.arange(0, 256, dtype=torch.int32).to(torch.uint8).view(torch.float8_e4m3fn).reshape(M, N)
+    out = torch.empty((M, N), dtype=dst_dtype, device='cpu')
+    meta = kernel[(1, )](x, out, M, N)
+    torch.testing.assert_close(out, x.to(dst_dtype), equal_nan=True)
+    props = triton.runtime.driver.active.utils.get_device_properties(0)
+    # Lookups are emitted by DecomposeFpConversions, which runs in make_tttcir.
+    if "avx512vbmi" in props["cpu_features"]:
+        assert "llvm.x86.avx512.vpermi2var.qi.512" in meta.asm["tttcir"]
+    elif "neon" in props["cpu_features"]:
+        assert "llvm.aarch64.neon.tbl4.v16i8" in meta.asm["tttcir"]
+
+
+@pytest.mark.parametrize("divisor", [1, 3, 7, 64, 1000, -5, 2**31 - 1])
+def test_invariant_int_division(divisor, device):
+
+    @triton.jit
+    def kernel(x_ptr, div_ptr, rem_ptr, d, BLOCK: tl.constexpr):
+        offs = tl.arange(0, BLOCK)
+        x = tl.load(x_ptr + offs)
+        tl.store(div_ptr + offs, x // d)
+        tl.store(rem_ptr + offs, x % d)
+
+    # Divisions by kernel arguments are replaced with multiplications by magic numbers.
+    BLOCK = 128
+    x = torch.randint(-2**31, 2**31 - 1, (BLOCK, ), dtype=torch.int32)
+    x[:4] = torch.tensor([0, -1, -2**31, 2**31 - 1], dtype=torch.int32)
+    div = torch.empty_like(x)
+    rem = torch.empty_like(x)
+    meta = kernel[(1, )](x, div, rem, divisor, BLOCK)
+    x64 = x.to(torch.int64)
+    ref_div = torch.div(x64, divisor, rounding_mode="trunc")
+    torch.testing.assert_close(div, ref_div.to(torch.int32))
+    torch.testing.assert_close(rem, (x64 - ref_div * divisor).to(torch.int32))
+    # Magic numbers are computed from leading zeros of the divisor, quotients are high halves of products
+    # shifted right.
+    assert "arith.divsi" not in meta.asm["tttcir"]
+    assert "arith.remsi" not in meta.asm["tttcir"]
+    assert "math.ctlz" in meta.asm["tttcir"]
+    assert "arith.shrui" in meta.asm["tttcir"]
+
+
+def test_if_to_selects(device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, N: tl.constexpr, BLOCK: tl.constexpr):
+        offs = tl.arange(0, BLOCK)
+        acc = tl.zeros((BLOCK, ), dtype=tl.float32)
+        for i in range(N):
+            x = tl.load(x_ptr + i * BLOCK + offs)
+            if i % 3 == 0:
+                acc += x * 2
+            else:
+                acc -= x
+        tl.store(out_ptr + offs, acc)
+
+    N, BLOCK = 8, 16
+    x = torch.rand((N, BLOCK), dtype=torch.float32, device='cpu')
+    out = torch.empty((BLOCK, ), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](x, out, N, BLOCK)
+    sign = torch.tensor([2.0 if i % 3 == 0 else -1.0 for i in range(N)])
+    torch.testing.assert_close(out, (x * sign[:, None]).sum(0))
+
+    # Both branches are speculated and their results selected.
+    tttcir = meta.asm["tttcir"]
+    assert "scf.if" not in tttcir
+    assert "arith.select" in tttcir
+
+
+@pytest.mark.parametrize("masked", [False, True])
+def test_strip_mine_vectors(masked, device):
+
+    @triton.jit
+    def kernel(x_ptr, y_ptr, out_ptr, n, BLOCK: tl.constexpr, MASKED: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK + tl.arange(0, BLOCK)
+        mask = offs < n if MASKED else None
+        x = tl.load(x_ptr + offs, mask=mask)
+        y = tl.load(y_ptr + offs, mask=mask)
+        tl.store(out_ptr + offs, tl.exp(x) * y + x, mask=mask)
+
+    BLOCK = 4096
+    n = BLOCK * 2 - (100 if masked else 0)
+    x = torch.rand((n, ), dtype=torch.float32, device='cpu')
+    y = torch.rand((n, ), dtype=torch.float32, device='cpu')
+    out = torch.empty_like(x)
+    meta = kernel[(2, )](x, y, out, n, BLOCK, masked, noalias=True)
+    torch.testing.assert_close(out, torch.exp(x) * y + x)
+
+    # The chain runs in a loop over sub-blocks instead of on 4096-element vectors.
+    tttcir = meta.asm["tttcir"]
+    assert "scf.for" in tttcir
+    assert "vector<4096xf32>" not in tttcir
+
+
+def test_strip_mine_vectors_in_place(device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, BLOCK: tl.constexpr):
+        offs = tl.arange(0, BLOCK)
+        tl.store(out_ptr + offs, tl.exp(tl.load(x_ptr + offs)))
+
+    # The output starts one element after the input, so storing a sub-block overwrites the first input element
+    # of the next one. Without noalias, loads aren't interleaved with stores.
+    BLOCK = 4096
+    buf = torch.rand((BLOCK + 1, ), dtype=torch.float32, device='cpu')
+    ref = torch.exp(buf[:-1])
+    meta = kernel[(1, )](buf[:-1], buf[1:], BLOCK)
+    torch.testing.assert_close(buf[1:], ref)
+    assert "vector<4096xf32>" in meta.asm["tttcir"]
+
+
+@pytest.mark.parametrize("reduction_accumulators", [1, 4])
+@pytest.mark.parametrize("K", [512, 496])
+def test_interleave_reductions(reduction_accumulators, K, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, K, BLOCK: tl.constexpr):
+        offs = tl.arange(0, BLOCK)
+        acc = tl.zeros((BLOCK, ), dtype=tl.float32)
+        for k in range(0, K // BLOCK):
+            acc += tl.load(x_ptr + k * BLOCK + offs)
+        tl.store(out_ptr + offs, acc)
+
+    BLOCK = 16
+    x = torch.rand((K, ), dtype=torch.float32, device='cpu')
+    out = torch.empty((BLOCK, ), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](x, out, K, BLOCK, reduction_accumulators=reduction_accumulators)
+    torch.testing.assert_close(out, x[:K // BLOCK * BLOCK].reshape(-1, BLOCK).sum(0))
+
+    # Sums of accumulators of unrolled iterations are combined after the main loop.
+    tttcir = meta.asm["tttcir"]
+    num_loops = tttcir.count("scf.for")
+    assert num_loops == (2 if reduction_accumulators > 1 else 1)
+
+
+@pytest.mark.parametrize("narrow_offsets", [False, True])
+def test_narrow_offsets(narrow_offsets, device):
+
+    @triton.jit
+    def kernel(x_ptr, idx_ptr, out_ptr, BLOCK: tl.constexpr):
+        offs = tl.program_id(0).to(tl.int64) * BLOCK + tl.arange(0, BLOCK)
+        idx = tl.load(idx_ptr + offs)
+        tl.store(out_ptr + offs, tl.load(x_ptr + idx))
+
+    BLOCK, n = 32, 256
+    x = torch.rand((n, ), dtype=torch.float32, device='cpu')
+    idx = torch.randint(0, n, (n, ), dtype=torch.int64, device='cpu')
+    out = torch.empty_like(x)
+    meta = kernel[(n // BLOCK, )](x, idx, out, BLOCK, narrow_offsets=narrow_offsets, memory_access_cost_model=False)
+    torch.testing.assert_close(out, x[idx])
+
+    # Tensors are specialized as less than 2GB, so int64 indices are truncated and gathered as i32.
+    index_types = re.findall(r"vector\.gather .*: memref<f32>, vector<\d+x(i\d+)>", meta.asm["ttcir"])
+    assert index_types
+    assert all(ty == ("i32" if narrow_offsets else "i64") for ty in index_types)
+
+
+@pytest.mark.parametrize("n_iters", [0, 3])
+def test_uniform_loads(n_iters, device):
+
+    @triton.jit
+    def kernel(x_ptr, scale_ptr, bias_ptr, out_ptr, n_iters, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr):
+        offs_m = tl.arange(0, BLOCK_M)
+        offs = offs_m[:, None] * BLOCK_N + tl.arange(0, BLOCK_N)[None, :]
+        zeros = tl.zeros((BLOCK_M, BLOCK_N), dtype=tl.int32)
+        acc = tl.zeros((BLOCK_M, BLOCK_N), dtype=tl.float32)
+        for i in range(n_iters):
+            scale = tl.load(scale_ptr + zeros)
+            bias = tl.load(bias_ptr + offs_m[:, None] + zeros)
+            acc += tl.load(x_ptr + i * BLOCK_M * BLOCK_N + offs) * scale + bias
+        tl.store(out_ptr + offs, acc)
+
+    BLOCK_M, BLOCK_N = 4, 16
+    x = torch.rand((max(n_iters, 1), BLOCK_M, BLOCK_N), dtype=torch.float32, device='cpu')
+    scale = torch.rand((1, ), dtype=torch.float32, device='cpu')
+    bias = torch.rand((BLOCK_M, ), dtype=torch.float32, device='cpu')
+    out = torch.empty((BLOCK_M, BLOCK_N), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](x, scale, bias, out, n_iters, BLOCK_M, BLOCK_N)
+    ref = (x[:n_iters] * scale + bias[:, None]).sum(dim=0)
+    torch.testing.assert_close(out, ref)
+
+    # The scale is loaded once before the loop and the bias once per row, both broadcast instead of gathered.
+    ttcir = meta.asm["ttcir"]
+    assert "vector.gather" not in ttcir
+    loop = ttcir.index("scf.for")
+    scalar_loads = [m.start() for m in re.finditer(r"tt\.load %\S+ : !tt\.ptr<f32>$", ttcir, re.MULTILINE)]
+    assert len([pos for pos in scalar_loads if pos < loop]) == 1
+    assert len([pos for pos in scalar_loads if pos > loop]) == BLOCK_M
+
+
+@pytest.mark.parametrize("bulk_memory_min_size", [0, 4096])
+@pytest.mark.parametrize("dtype_str", ["float32", "bfloat16", "int8"])
+def test_bulk_memory_ops(bulk_memory_min_size, dtype_str, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, fill_ptr, value, n, BLOCK: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK + tl.arange(0, BLOCK)
+        mask = offs < n
+        tl.store(out_ptr + offs, tl.load(x_ptr + offs, mask=mask), mask=mask)
+        tl.store(fill_ptr + offs, tl.full((BLOCK, ), value, fill_ptr.dtype.element_ty), mask=mask)
+
+    dtype = getattr(torch, dtype_str)
+    BLOCK = 4096
+    n = 3 * BLOCK + 5
+    x = torch.arange(n, device='cpu').to(dtype)
+    out = torch.empty_like(x)
+    fill = torch.empty_like(x)
+    meta = kernel[(triton.cdiv(n, BLOCK), )](x, out, fill, 3, n, BLOCK, bulk_memory_min_size=bulk_memory_min_size)
+    torch.testing.assert_close(out, x)
+    torch.testing.assert_close(fill, torch.full_like(x, 3))
+
+    # Full tiles of versioned masks are copied and filled in bulk, the tail tile keeps masked vector code.
+    tttcir = meta.asm["tttcir"]
+    assert ("triton_cpu.bulk_copy" in tttcir) == (bulk_memory_min_size > 0)
+    assert ("triton_cpu.bulk_fill" in tttcir) == (bulk_memory_min_size > 0)
+    assert "vector.maskedstore" in tttcir
+
+
+@pytest.mark.parametrize("dtype_str", ["float32", "int16", "float64"])
+@pytest.mark.parametrize("M, N", [(8, 8), (16, 16), (32, 8), (16, 64)])
+def test_transpose_shuffles(dtype_str, M, N, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, M: tl.constexpr, N: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        x = tl.load(x_ptr + offs_m[:, None] * N + offs_n[None, :])
+        tl.store(out_ptr + offs_n[:, None] * M + offs_m[None, :], tl.trans(x) + 1)
+
+    dtype = getattr(torch, dtype_str)
+    x = torch.arange(M * N, device='cpu').reshape(M, N).to(dtype)
+    out = torch.empty((N, M), dtype=dtype, device='cpu')
+    meta = kernel[(1, )](x, out, M, N)
+    torch.testing.assert_close(out, x.T + 1)
+
+    # Tiles are transposed with shuffles of rows instead of element moves.
+    assert "vector.transpose" in meta.asm["tttcir"]
+    assert "shufflevector" in meta.asm["llir"]
+
+
+def test_fold_transposes(device):
+
+    @triton.jit
+    def kernel(x_ptr, w_ptr, out_ptr, M: tl.constexpr, N: tl.constexpr):
+        x_block_ptr = tl.make_block_ptr(base=x_ptr, shape=(M, N), strides=(N, 1), offsets=(0, 0), block_shape=(M, N),
+                                        order=(1, 0))
+        x = tl.load(x_block_ptr)
+        w = tl.load(w_ptr + tl.arange(0, N))
+        res = tl.trans(x) * tl.trans(tl.broadcast_to(w[None, :], (M, N)))
+        offs_n = tl.arange(0, N)
+        offs_m = tl.arange(0, M)
+        tl.store(out_ptr + offs_n[:, None] * M + offs_m[None, :], res)
+
+    M, N = 16, 32
+    x = torch.rand((M, N), dtype=torch.float32, device='cpu')
+    w = torch.rand((N, ), dtype=torch.float32, device='cpu')
+    out = torch.empty((N, M), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](x, w, out, M, N)
+    torch.testing.assert_close(out, x.T * w[:, None])
+
+    # The tile is read transposed and the transposed row broadcast is a column broadcast.
+    tttcir = meta.asm["tttcir"]
+    assert "vector.transpose" not in tttcir
+    assert "permutation_map" in tttcir
+
+
+@pytest.mark.parametrize("dtype_str", ["float32", "int32", "float16"])
+@pytest.mark.parametrize("table_size", [8, 16, 32, 64])
+def test_gather_table(dtype_str, table_size, device):
+
+    @triton.jit
+    def kernel(table_ptr, idx_ptr, out_ptr, TABLE: tl.constexpr, BLOCK: tl.constexpr):
+        table = tl.load(table_ptr + tl.arange(0, TABLE))
+        idx = tl.load(idx_ptr + tl.arange(0, BLOCK))
+        tl.store(out_ptr + tl.arange(0, BLOCK), tl.gather(table, idx, 0))
+
+    BLOCK = 40
+    dtype = getattr(torch, dtype_str)
+    table = torch.randn((table_size, ), device='cpu').to(dtype)
+    idx = torch.randint(0, table_size, (BLOCK, ), dtype=torch.int32, device='cpu')
+    out = torch.empty((BLOCK, ), dtype=dtype, device='cpu')
+    meta = kernel[(1, )](table, idx, out, table_size, BLOCK)
+    torch.testing.assert_close(out, table[idx.long()])
+
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    if 'avx512f' in features:
+        max_table = 32
+    elif 'avx2' in features:
+        max_table = 8
+    elif 'neon' in features:
+        max_table = 16
+    else:
+        max_table = 0
+    # Small tables of 32-bit elements are permuted in registers instead of gathered from memory.
+    permuted = dtype.itemsize == 4 and table_size <= max_table
+    assert ("vector.gather" in meta.asm["tttcir"]) != permuted
+
+
+@pytest.mark.parametrize("axis", [0, 1])
+def test_gather_2d(axis, device):
+
+    @triton.jit
+    def kernel(src_ptr, idx_ptr, out_ptr, M: tl.constexpr, N: tl.constexpr, AXIS: tl.constexpr):
+        offs_m = tl.arange(0, M)
+        offs_n = tl.arange(0, N)
+        src = tl.load(src_ptr + offs_m[:, None] * N + offs_n[None, :])
+        idx = tl.load(idx_ptr + offs_m[:, None] * N + offs_n[None, :])
+        tl.store(out_ptr + offs_m[:, None] * N + offs_n[None, :], tl.gather(src, idx, AXIS))
+
+    M, N = 8, 16
+    src = torch.randn((M, N), dtype=torch.float32, device='cpu')
+    idx = torch.randint(0, M if axis == 0 else N, (M, N), dtype=torch.int64, device='cpu')
+    out = torch.empty_like(src)
+    kernel[(1, )](src, idx, out, M, N, axis)
+    torch.testing.assert_close(out, torch.gather(src, axis, idx))
+
+
+@pytest.mark.parametrize("K", [1024, 192, 80, 100])
+def test_divisibility_specialization(K, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, K, BLOCK: tl.constexpr):
+        acc = tl.zeros((BLOCK, ), dtype=tl.float32)
+        for k in range(0, tl.cdiv(K, BLOCK)):
+            offs = k * BLOCK + tl.arange(0, BLOCK)
+            acc += tl.load(x_ptr + offs, mask=offs < K, other=0.0)
+        tl.store(out_ptr + tl.arange(0, BLOCK), acc)
+
+    BLOCK = 64
+    x = torch.rand((K, ), dtype=torch.float32, device='cpu')
+    out = torch.empty((BLOCK, ), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](x, out, K, BLOCK)
+    ref = torch.nn.functional.pad(x, (0, (-K) % BLOCK)).reshape(-1, BLOCK).sum(0)
+    torch.testing.assert_close(out, ref)
+
+    # Sizes are specialized on divisibility up to 256, so masks of full blocks are removed.
+    ttir = meta.asm["ttir"]
+    divisibility = next(d for d in (256, 64, 16, 1) if K % d == 0)
+    if divisibility > 1:
+        assert f"tt.divisibility = {divisibility} : i32" in ttir
+    if divisibility >= BLOCK:
+        assert "vector.maskedload" not in meta.asm["tttcir"]
+
+
+@pytest.mark.parametrize("K", [256, 200])
+def test_block_ptr_loop_bounds(K, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, K: tl.constexpr, BLOCK_M: tl.constexpr, BLOCK_K: tl.constexpr):
+        x_block_ptr = tl.make_block_ptr(base=x_ptr, shape=(BLOCK_M, K), strides=(K, 1), offsets=(0, 0),
+                                        block_shape=(BLOCK_M, BLOCK_K), order=(1, 0))
+        acc = tl.zeros((BLOCK_M, BLOCK_K), dtype=tl.float32)
+        for k in range(0, K, BLOCK_K):
+            acc += tl.load(x_block_ptr, boundary_check=(0, 1), padding_option="zero")
+            x_block_ptr = tl.advance(x_block_ptr, (0, BLOCK_K))
+        tl.store(out_ptr + tl.arange(0, BLOCK_M)[:, None] * BLOCK_K + tl.arange(0, BLOCK_K)[None, :], acc)
+
+    BLOCK_M, BLOCK_K = 4, 64
+    x = torch.rand((BLOCK_M, K), dtype=torch.float32, device='cpu')
+    out = torch.empty((BLOCK_M, BLOCK_K), dtype=torch.float32, device='cpu')
+    meta = kernel[(1, )](x, out, K, BLOCK_M, BLOCK_K)
+    ref = torch.nn.functional.pad(x, (0, (-K) % BLOCK_K)).reshape(BLOCK_M, -1, BLOCK_K).sum(1)
+    torch.testing.assert_close(out, ref)
+
+    # Offsets of the advanced pointer are bounded by the loop, so boundary checks are dropped
+    # when the loop covers whole blocks of the tensor.
+    ttcir = meta.asm["ttcir"]
+    assert ("in_bounds = [true, true]" in ttcir) == (K % BLOCK_K == 0)
+
+
+def test_hoist_grid_invariants(device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, stride_xm, stride_om, scale, BLOCK: tl.constexpr):
+        pid_n = tl.program_id(0)
+        pid_m = tl.program_id(1)
+        # Row pointers and the scale only depend on pid_m and arguments, so they are
+        # computed once per range of programs along the x axis.
+        x_row = x_ptr + pid_m * stride_xm
+        out_row = out_ptr + pid_m * stride_om
+        factor = scale * 2.0 + pid_m
+        offs = pid_n * BLOCK + tl.arange(0, BLOCK)
+        tl.store(out_row + offs, tl.load(x_row + offs) * factor)
+
+    M, N, BLOCK = 4, 256, 32
+    x = torch.rand((M, N), dtype=torch.float32, device='cpu')
+    out = torch.empty_like(x)
+    kernel[(N // BLOCK, M)](x, out, x.stride(0), out.stride(0), 0.5, BLOCK)
+    ref = x * (1.0 + torch.arange(M, dtype=torch.float32)[:, None])
+    torch.testing.assert_close(out, ref)
+
+
+@pytest.mark.parametrize("num_stages", [1, 2, 3])
+@pytest.mark.parametrize("K", [64, 82])
+def test_pipeline_loads(num_stages, K, device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, c_ptr, K, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr, BLOCK_K: tl.constexpr):
+        offs_m = tl.arange(0, BLOCK_M)
+        offs_n = tl.arange(0, BLOCK_N)
+        offs_k = tl.arange(0, BLOCK_K)
+        acc = tl.zeros((BLOCK_M, BLOCK_N), dtype=tl.float32)
+        for k in range(0, tl.cdiv(K, BLOCK_K)):
+            k_offs = k * BLOCK_K + offs_k
+            a = tl.load(a_ptr + offs_m[:, None] * K + k_offs[None, :], mask=k_offs[None, :] < K, other=0.0)
+            b = tl.load(b_ptr + k_offs[:, None] * BLOCK_N + offs_n[None, :], mask=k_offs[:, None] < K, other=0.0)
+            acc += tl.dot(a, b)
+        tl.store(c_ptr + offs_m[:, None] * BLOCK_N + offs_n[None, :], acc)
+
+    # Operands of an iteration take 128 bytes, which fit the stage budget of a quarter of the vector
+    # registers of every target with two stages.
+    BLOCK_M, BLOCK_N, BLOCK_K = 4, 4, 4
+    a = torch.rand((BLOCK_M, K), dtype=torch.float32, device='cpu')
+    b = torch.rand((K, BLOCK_N), dtype=torch.float32, device='cpu')
+    c = torch.empty((BLOCK_M, BLOCK_N), dtype=torch.float32, device='cpu')
+    # Loads of the next num_stages - 1 iterations are issued ahead of the dot, loads past the
+    # end of the loop are predicated.
+    meta = kernel[(1, )](a, b, c, K, BLOCK_M, BLOCK_N, BLOCK_K, num_stages=num_stages)
+    torch.testing.assert_close(c, a @ b, rtol=1e-4, atol=1e-4)
+
+    # The prologue of a pipelined loop loads the operands of its first iterations before the loop.
+    tttcir = meta.asm["tttcir"]
+    prologue = tttcir[:tttcir.index("scf.for")]
+    has_prologue_loads = re.search(r"vector\.(transfer_read|load|maskedload)|memref\.load", prologue) is not None
+    if num_stages == 1:
+        assert not has_prologue_loads
+    elif num_stages == 2:
+        assert has_prologue_loads
+
+
+@pytest.mark.parametrize("split_k", [1, 4])
+def test_split_k_sum(split_k, device):
+
+    @triton.jit
+    def kernel(x_ptr, out_ptr, N, BLOCK: tl.constexpr):
+        acc = tl.zeros((BLOCK, ), dtype=tl.float32)
+        for off in range(0, N, BLOCK):
+            acc += tl.load(x_ptr + off + tl.arange(0, BLOCK))
+        tl.store(out_ptr, tl.sum(acc))
+
+    N, BLOCK = 1 << 14, 64
+    x = torch.rand((N, ), dtype=torch.float32)
+    # A single program is split between up to split_k threads. Run twice to check that tile counters
+    # are reset.
+    for _ in range(2):
+        out = torch.empty((1, ), dtype=torch.float32)
+        meta = kernel[(1, )](x, out, N, BLOCK, split_k=split_k, num_threads=4)
+        torch.testing.assert_close(out, x.sum().reshape(1), rtol=1e-4, atol=1e-3)
+    assert meta.metadata.split_k_slot_size == (BLOCK * 4 if split_k > 1 else 0)
+
+
+@pytest.mark.parametrize("num_warps, num_programs, num_splits", [(1, 1, 1), (4, 1, 4), (4, 2, 2), (4, 4, 1)])
+def test_num_warps_team(num_warps, num_programs, num_splits, device):
+    from triton.backends.cpu import stats
+
+    @triton.jit
+    def team_sum_kernel(x_ptr, out_ptr, N, BLOCK: tl.constexpr):
+        row = tl.program_id(0)
+        acc = tl.zeros((BLOCK, ), dtype=tl.float32)
+        for off in range(0, N, BLOCK):
+            acc += tl.load(x_ptr + row * N + off + tl.arange(0, BLOCK))
+        tl.store(out_ptr + row, tl.sum(acc))
+
+    # Programs of GPU-tuned kernels are split between teams of num_warps threads, as long as the grid leaves
+    # threads idle.
+    N, BLOCK = 1 << 12, 64
+    x = torch.rand((num_programs, N), dtype=torch.float32)
+    out = torch.empty((num_programs, ), dtype=torch.float32)
+    before = stats.get_stats()
+    meta = team_sum_kernel[(num_programs, )](x, out, N, BLOCK, num_warps=num_warps, num_threads=4)
+    interval = stats.diff(stats.get_stats(), before)
+    torch.testing.assert_close(out, x.sum(dim=1), rtol=1e-4, atol=1e-3)
+    assert meta.metadata.split_k == max(num_warps, 1)
+    assert interval["kernels"]["team_sum_kernel"]["programs"] == num_programs * num_splits
+
+
+def test_online_softmax_attention(device):
+
+    @triton.jit
+    def kernel(q_ptr, k_ptr, v_ptr, o_ptr, N_CTX, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr,
+               HEAD_DIM: tl.constexpr):
+        offs_m = tl.arange(0, BLOCK_M)
+        offs_n = tl.arange(0, BLOCK_N)
+        offs_d = tl.arange(0, HEAD_DIM)
+        q = tl.load(q_ptr + offs_m[:, None] * HEAD_DIM + offs_d[None, :])
+        m_i = tl.full((BLOCK_M, ), float("-inf"), dtype=tl.float32)
+        l_i = tl.zeros((BLOCK_M, ), dtype=tl.float32)
+        acc = tl.zeros((BLOCK_M, HEAD_DIM), dtype=tl.float32)
+        for start_n in range(0, N_CTX, BLOCK_N):
+            kt = tl.load(k_ptr + (start_n + offs_n)[None, :] * HEAD_DIM + offs_d[:, None])
+            qk = tl.dot(q, kt)
+            m_ij = tl.maximum(m_i, tl.max(qk, 1))
+            p = tl.exp(qk - m_ij[:, None])
+            alpha = tl.exp(m_i - m_ij)
+            l_i = l_i * alpha + tl.sum(p, 1)
+            v = tl.load(v_ptr + (start_n + offs_n)[:, None] * HEAD_DIM + offs_d[None, :])
+            acc = acc * alpha[:, None] + tl.dot(p, v)
+            m_i = m_ij
+        tl.store(o_ptr + offs_m[:, None] * HEAD_DIM + offs_d[None, :], acc / l_i[:, None])
+
+    N_CTX, BLOCK_M, BLOCK_N, HEAD_DIM = 64, 4, 16, 16
+    q = torch.randn((BLOCK_M, HEAD_DIM), dtype=torch.float32)
+    k = torch.randn((N_CTX, HEAD_DIM), dtype=torch.float32)
+    v = torch.randn((N_CTX, HEAD_DIM), dtype=torch.float32)
+    o = torch.empty((BLOCK_M, HEAD_DIM), dtype=torch.float32)
+    # Probabilities computed from the QK^T dot are read from registers by the PV dot.
+    meta = kernel[(1, )](q, k, v, o, N_CTX, BLOCK_M, BLOCK_N, HEAD_DIM)
+    ref = torch.softmax(q @ k.T, dim=1) @ v
+    torch.testing.assert_close(o, ref, rtol=1e-4, atol=1e-4)
+
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    if "avx512f" in features or ("avx2" in features and "fma" in features):
+        assert "vector.fma" in meta.asm["tttcir"]
+
+
+@pytest.mark.parametrize("BLOCK_SIZE", [4, 16])
+def test_paged_kv_gather(BLOCK_SIZE, device):
+
+    @triton.jit
+    def kernel(k_cache_ptr, block_table_ptr, out_ptr, NUM_TOKENS: tl.constexpr, BLOCK_SIZE: tl.constexpr,
+               HEAD_DIM: tl.constexpr):
+        offs_t = tl.arange(0, NUM_TOKENS)
+        offs_d = tl.arange(0, HEAD_DIM)
+        block_idx = tl.load(block_table_ptr + offs_t // BLOCK_SIZE)
+        row = block_idx * BLOCK_SIZE + offs_t % BLOCK_SIZE
+        k = tl.load(k_cache_ptr + row[:, None] * HEAD_DIM + offs_d[None, :])
+        tl.store(out_ptr + offs_t[:, None] * HEAD_DIM + offs_d[None, :], k)
+
+    NUM_TOKENS, HEAD_DIM, NUM_BLOCKS = 32, 16, 16
+    k_cache = torch.randn((NUM_BLOCKS * BLOCK_SIZE, HEAD_DIM), dtype=torch.float32)
+    block_table = torch.randperm(NUM_BLOCKS, dtype=torch.int32)[:NUM_TOKENS // BLOCK_SIZE].contiguous()
+    out = torch.empty((NUM_TOKENS, HEAD_DIM), dtype=torch.float32)
+    # Block indices are loaded as scalars computing row pointers, rows are loaded as vectors.
+    meta = kernel[(1, )](k_cache, block_table, out, NUM_TOKENS, BLOCK_SIZE, HEAD_DIM)
+    ref = k_cache.view(NUM_BLOCKS, BLOCK_SIZE, HEAD_DIM)[block_table.long()].reshape(NUM_TOKENS, HEAD_DIM)
+    torch.testing.assert_close(out, ref)
+    assert "vector.gather" not in meta.asm["tttcir"]
+
+
+def test_grouped_gemm_loaded_pointers(device):
+
+    @triton.jit
+    def kernel(a_ptrs, b_ptrs, c_ptrs, lds, K, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr,
+               BLOCK_K: tl.constexpr):
+        g = tl.program_id(0)
+        a_ptr = tl.load(a_ptrs + g).to(tl.pointer_type(tl.float32))
+        b_ptr = tl.load(b_ptrs + g).to(tl.pointer_type(tl.float32))
+        c_ptr = tl.load(c_ptrs + g).to(tl.pointer_type(tl.float32))
+        lda = tl.load(lds + g * 3)
+        ldb = tl.load(lds + g * 3 + 1)
+        ldc = tl.load(lds + g * 3 + 2)
+        offs_m = tl.arange(0, BLOCK_M)
+        offs_n = tl.arange(0, BLOCK_N)
+        offs_k = tl.arange(0, BLOCK_K)
+        a_tile = a_ptr + offs_m[:, None] * lda + offs_k[None, :]
+        b_tile = b_ptr + offs_k[:, None] * ldb + offs_n[None, :]
+        acc = tl.zeros((BLOCK_M, BLOCK_N), dtype=tl.float32)
+        for _ in range(0, K, BLOCK_K):
+            acc += tl.dot(tl.load(a_tile), tl.load(b_tile))
+            a_tile += BLOCK_K
+            b_tile += BLOCK_K * ldb
+        tl.store(c_ptr + offs_m[:, None] * ldc + offs_n[None, :], acc)
+
+    BLOCK_M, BLOCK_N, BLOCK_K, K = 16, 16, 16, 64
+    groups = [(torch.randn((BLOCK_M, K)), torch.randn((K, BLOCK_N + 8))[:, :BLOCK_N], torch.empty((BLOCK_M, BLOCK_N)))
+              for _ in range(3)]
+    a_ptrs = torch.tensor([a.data_ptr() for a, _, _ in groups], dtype=torch.int64)
+    b_ptrs = torch.tensor([b.data_ptr() for _, b, _ in groups], dtype=torch.int64)
+    c_ptrs = torch.tensor([c.data_ptr() for _, _, c in groups], dtype=torch.int64)
+    lds = torch.tensor([[a.stride(0), b.stride(0), c.stride(0)] for a, b, c in groups], dtype=torch.int32)
+    # Operands addressed from loaded base pointers and leading dimensions are read as strided blocks as if
+    # they were block pointers.
+    meta = kernel[(len(groups), )](a_ptrs, b_ptrs, c_ptrs, lds, K, BLOCK_M, BLOCK_N, BLOCK_K)
+    for a, b, c in groups:
+        torch.testing.assert_close(c, a @ b, rtol=1e-4, atol=1e-4)
+    assert re.search(r"vector\.transfer_read [^\n]*memref<16x16xf32, strided<\[\?, 1\]>>", meta.asm["ttcir"])
+
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    if "avx512f" in features or ("avx2" in features and "fma" in features):
+        assert "vector.fma" in meta.asm["tttcir"]
+
+
+def test_implicit_gemm_conv(device):
+
+    @triton.jit
+    def kernel(x_ptr, w_ptr, y_ptr, H: tl.constexpr, W: tl.constexpr, C: tl.constexpr, KH: tl.constexpr,
+               KW: tl.constexpr, F: tl.constexpr, BLOCK_M: tl.constexpr):
+        OH: tl.constexpr = H - KH + 1
+        OW: tl.constexpr = W - KW + 1
+        offs_m = tl.program_id(0) * BLOCK_M + tl.arange(0, BLOCK_M)
+        oh = offs_m // OW
+        ow = offs_m % OW
+        offs_c = tl.arange(0, C)
+        offs_f = tl.arange(0, F)
+        acc = tl.zeros((BLOCK_M, F), dtype=tl.float32)
+        for tap in range(0, KH * KW):
+            kh = tap // KW
+            kw = tap % KW
+            # NHWC rows of a filter tap are contiguous channel vectors of different pixels.
+            a = tl.load(x_ptr + ((oh + kh) * W + ow + kw)[:, None] * C + offs_c[None, :])
+            b = tl.load(w_ptr + (tap * C + offs_c)[:, None] * F + offs_f[None, :])
+            acc += tl.dot(a, b)
+        tl.store(y_ptr + offs_m[:, None] * F + offs_f[None, :], acc)
+
+    H, W, C, KH, KW, F, BLOCK_M = 6, 6, 16, 3, 3, 16, 4
+    x = torch.randn((H, W, C), dtype=torch.float32)
+    w = torch.randn((KH, KW, C, F), dtype=torch.float32)
+    OH, OW = H - KH + 1, W - KW + 1
+    y = torch.empty((OH * OW, F), dtype=torch.float32)
+    meta = kernel[(OH * OW // BLOCK_M, )](x, w, y, H, W, C, KH, KW, F, BLOCK_M)
+    ref = torch.nn.functional.conv2d(x.permute(2, 0, 1)[None], w.permute(3, 2, 0, 1))[0].permute(1, 2, 0)
+    torch.testing.assert_close(y, ref.reshape(OH * OW, F), rtol=1e-4, atol=1e-4)
+
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    if "avx512f" in features or ("avx2" in features and "fma" in features):
+        assert "vector.fma" in meta.asm["tttcir"]
+        # Rows of A are read from memory instead of a temporary buffer.
+        assert "memref.alloca" not in meta.asm["tttcir"]
+
+
+def test_skip_empty_dot_blocks(device):
+
+    @triton.jit
+    def kernel(a_ptr, b_ptr, block_mask_ptr, c_ptr, K: tl.constexpr, BLOCK_M: tl.constexpr, BLOCK_N: tl.constexpr,
+               BLOCK_K: tl.constexpr):
+        offs_m = tl.arange(0, BLOCK_M)
+        offs_n = tl.arange(0, BLOCK_N)
+        offs_k = tl.arange(0, BLOCK_K)
+        acc = tl.zeros((BLOCK_M, BLOCK_N), dtype=tl.float32)
+        for kb in range(0, K // BLOCK_K):
+            nonzero = tl.load(block_mask_ptr + kb) != 0
+            a = tl.load(a_ptr + offs_m[:, None] * K + (kb * BLOCK_K + offs_k)[None, :], mask=nonzero, other=0.0)
+            b = tl.load(b_ptr + (kb * BLOCK_K + offs_k)[:, None] * BLOCK_N + offs_n[None, :])
+            acc = tl.dot(a, b, acc)
+        tl.store(c_ptr + offs_m[:, None] * BLOCK_N + offs_n[None, :], acc)
+
+    K, BLOCK_M, BLOCK_N, BLOCK_K = 128, 16, 16, 16
+    block_mask = torch.tensor([1, 0, 0, 1, 0, 1, 0, 0], dtype=torch.int32)
+    a = torch.randn((BLOCK_M, K), dtype=torch.float32)
+    b = torch.randn((K, BLOCK_N), dtype=torch.float32)
+    c = torch.empty((BLOCK_M, BLOCK_N), dtype=torch.float32)
+    a_sparse = a * block_mask.repeat_interleave(BLOCK_K)[None, :].float()
+    # Loads and dots of blocks masked off by the block mask are skipped.
+    meta = kernel[(1, )](a, b, block_mask, c, K, BLOCK_M, BLOCK_N, BLOCK_K, skip_empty_dots=True)
+    torch.testing.assert_close(c, a_sparse @ b, rtol=1e-4, atol=1e-4)
+    assert "scf.if" in meta.asm["ttcir"]
+
+    # By default, dots are left unconditional, so the FMA lowering keeps rows of the accumulator in registers
+    # carried by the loop instead of a 2D vector.
+    meta = kernel[(1, )](a, b, block_mask, c, K, BLOCK_M, BLOCK_N, BLOCK_K)
+    torch.testing.assert_close(c, a_sparse @ b, rtol=1e-4, atol=1e-4)
+    assert "scf.if" not in meta.asm["ttcir"]
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    if "avx512f" in features or ("avx2" in features and "fma" in features):
+        assert re.search(r"scf\.for [^\n]*-> \(vector<\d+xf32>", meta.asm["tttcir"])
+
+
+def test_fuse_elementwise(device):
+    from triton.language.extra.cpu import fuse_elementwise
+
+    @triton.jit
+    def add_kernel(x_ptr, y_ptr, out_ptr, n, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offs < n
+        x = tl.load(x_ptr + offs, mask=mask)
+        y = tl.load(y_ptr + offs, mask=mask)
+        tl.store(out_ptr + offs, x + y, mask=mask)
+
+    @triton.jit
+    def scale_kernel(x_ptr, out_ptr, n, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        mask = offs < n
+        x = tl.load(x_ptr + offs, mask=mask)
+        tl.store(out_ptr + offs, x * 2.0, mask=mask)
+
+    n, BLOCK_SIZE = 1000, 128
+    x = torch.randn(n, dtype=torch.float32)
+    y = torch.randn(n, dtype=torch.float32)
+    tmp = torch.empty_like(x)
+    out = torch.empty_like(x)
+    grid = (triton.cdiv(n, BLOCK_SIZE), )
+    fused = fuse_elementwise((add_kernel, dict(out_ptr="tmp_ptr")), (scale_kernel, dict(x_ptr="tmp_ptr")))
+    assert fused is fuse_elementwise((add_kernel, dict(out_ptr="tmp_ptr")), (scale_kernel, dict(x_ptr="tmp_ptr")))
+    meta = fused[grid](x, y, tmp, out, n, BLOCK_SIZE)
+    torch.testing.assert_close(tmp, x + y)
+    torch.testing.assert_close(out, (x + y) * 2.0)
+
+    def count(meta, pattern):
+        return len(re.findall(pattern, meta.asm["ttcir"]))
+
+    loads = r"vector\.(transfer_read|maskedload|load|gather)\b"
+    stores = r"vector\.(transfer_write|maskedstore|store|scatter)\b"
+    separate = [add_kernel[grid](x, y, tmp, n, BLOCK_SIZE), scale_kernel[grid](tmp, out, n, BLOCK_SIZE)]
+    assert count(meta, loads) < sum(count(m, loads) for m in separate)
+
+    # The store of an intermediate bound to the output is overwritten by the final store and dropped.
+    out = torch.empty_like(x)
+    fused_out = fuse_elementwise(add_kernel, (scale_kernel, dict(x_ptr="out_ptr")))
+    meta_out = fused_out[grid](x, y, out, n, BLOCK_SIZE, noalias=True)
+    torch.testing.assert_close(out, (x + y) * 2.0)
+    assert count(meta_out, stores) < count(meta, stores)
+
+
+@pytest.mark.parametrize("debug", [False, True])
+def test_device_assert_cold_path(debug, device):
+
+    @triton.jit
+    def kernel(src, dst, BLOCK_SIZE: tl.constexpr):
+        offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+        x = tl.load(src + offs)
+        tl.device_assert(x >= 0, "negative input")
+        tl.store(dst + offs, x)
+
+    src = torch.rand((128, ), dtype=torch.float32, device='cpu')
+    res = torch.empty_like(src)
+    meta = kernel[(4, )](src, res, BLOCK_SIZE=32, debug=debug)
+    assert (src == res).all()
+
+    llir = meta.asm["llir"]
+    if not debug:
+        assert "triton_assert" not in llir
+        return
+    # Passing asserts branch around the call, which is only reached on failure.
+    call = re.search(r"call void @triton_assert\(.*\bi1 false\b", llir)
+    assert call is not None
+    assert "!prof" in llir
+
+
+@pytest.mark.parametrize("prefer_vector_width", [0, 256])
+def test_prefer_vector_width(prefer_vector_width, device):
+
+    @triton.jit
+    def kernel(x_ptr, y_ptr, out_ptr, BLOCK: tl.constexpr):
+        offs = tl.arange(0, BLOCK)
+        x = tl.load(x_ptr + offs)
+        y = tl.load(y_ptr + offs)
+        tl.store(out_ptr + offs, tl.exp(x) * y + x)
+
+    BLOCK = 256
+    x = torch.rand((BLOCK, ), dtype=torch.float32, device='cpu')
+    y = torch.rand((BLOCK, ), dtype=torch.float32, device='cpu')
+    out = torch.empty_like(x)
+    meta = kernel[(1, )](x, y, out, BLOCK, prefer_vector_width=prefer_vector_width)
+    torch.testing.assert_close(out, torch.exp(x) * y + x)
+
+    features = triton.runtime.driver.active.utils.get_device_properties(0)["cpu_features"]
+    if not is_x86() or "avx512f" not in features:
+        return
+    # Kernels preferring 256-bit vectors don't use 512-bit registers of AVX-512.
+    assert ("zmm" in meta.asm["asm"]) == (prefer_vector_width == 0)
+    if prefer_vector_width:
+        assert '"prefer-vector-width"="256"' in meta.asm["llir"]
@@ -1839,6 +1839,55 @@ def test_atomic_cas(sem, num_ctas, device):
     assert f"atom.global.{sem_str}" in h.asm["ptx"]
 
 
+@pytest.mark.interpreter
+@pytest.mark.parametrize("num_threads", [1, 4, 0])
+def test_interpreter_num_threads(num_threads, device, monkeypatch):
+    if not is_interpreter():
+        pytest.skip("TRITON_INTERPRET_NUM_THREADS only applies to the interpreter")
+    monkeypatch.setenv("TRITON_INTERPRET_NUM_THREADS", str(num_threads))
+
+    @triton.jit
+    def kernel(X, Y, Count, BLOCK: tl.constexpr):
+        pid = tl.program_id(0) * tl.num_programs(1) + tl.program_id(1)
+        offs = pid * BLOCK + tl.arange(0, BLOCK)
+        tl.store(Y + offs, tl.load(X + offs) * 2 + pid)
+        tl.atomic_add(Count, 1)
+
+    grid = (16, 8)
+    BLOCK = 32
+    x = torch.randn(grid[0] * grid[1] * BLOCK, device=device)
+    y = torch.empty_like(x)
+    count = torch.zeros((1, ), device=device, dtype=torch.int32)
+    kernel[grid](x, y, count, BLOCK=BLOCK)
+    pid = torch.arange(grid[0] * grid[1], device=device).repeat_interleave(BLOCK)
+    torch.testing.assert_close(y, x * 2 + pid)
+    assert count.item() == grid[0] * grid[1]
+
+
+@pytest.mark.interpreter
+@pytest.mark.parametrize("stride", [1, 2, -1])
+def test_load_store_runs(stride, device):
+    # Mixes contiguous, non-contiguous, masked and masked-out runs of pointers.
+    @triton.jit
+    def kernel(X, Y, N, stride, BLOCK: tl.constexpr):
+        offs = tl.arange(0, BLOCK)
+        src = tl.where((offs // 8) % 2 == 0, offs, offs * stride + BLOCK)
+        mask = (offs % 24 < 16) & (src >= 0) & (src < N)
+        x = tl.load(X + src, mask=mask, other=-1.0)
+        tl.store(Y + offs, x, mask=offs % 12 < 10)
+
+    BLOCK = 128
+    x = torch.randn(3 * BLOCK, device=device)
+    y = torch.zeros(BLOCK, device=device)
+    kernel[(1, )](x, y, x.numel(), stride, BLOCK=BLOCK)
+    offs = torch.arange(BLOCK, device=device)
+    src = torch.where((offs // 8) % 2 == 0, offs, offs * stride + BLOCK)
+    mask = (offs % 24 < 16) & (src >= 0) & (src < x.numel())
+    ref = torch.where(mask, x[src.clamp(0, x.numel() - 1)], -1.0)
+    ref = torch.where(offs % 12 < 10, ref, 0.0)
+    torch.testing.assert_close(y, ref)
+
+
 @pytest.mark.cpu
 @pytest.mark.interpreter
 @pytest.mark.parametrize("sem", [None, 'acquire', 'release', 'acq_rel', 'relaxed'])
@@ -167,6 +167,27 @@ def test_reuse(device, fresh_triton_cache):
     assert counter == 1
 
 
+def test_context_reuse(device, fresh_triton_cache, monkeypatch):
+    from triton.compiler.compiler import _context_pool
+    monkeypatch.setenv("TRITON_CONTEXT_REUSE", "2")
+    monkeypatch.setattr(_context_pool, "_contexts", dict())
+    x = torch.empty(1, dtype=torch.int32, device=device)
+
+    def pooled_uses():
+        return [uses for contexts in _context_pool._contexts.values() for _, uses in contexts]
+
+    # Each block size is compiled, the second one in the context of the first one, which is then dropped.
+    kernel[(1, )](x, 1, BLOCK=1024)
+    expected = x.clone()
+    assert pooled_uses() == [1]
+    kernel[(1, )](x, 1, BLOCK=512)
+    assert pooled_uses() == []
+    assert torch.equal(x, expected)
+    kernel[(1, )](x, 1, BLOCK=256)
+    assert pooled_uses() == [1]
+    assert torch.equal(x, expected)
+
+
 @pytest.mark.parametrize('mode', ['enable', 'disable', 'disable_on_alignment'])
 def test_specialize(mode, device, fresh_triton_cache):
     counter = 0
@@ -4,7 +4,7 @@ import subprocess
 import sysconfig
 from abc import ABCMeta, abstractmethod
 from dataclasses import dataclass
-from typing import Dict, Union
+from typing import Callable, Dict, Union
 from types import ModuleType
 
 
@@ -84,6 +84,13 @@ class BaseBackend(metaclass=ABCMeta):
         """
         raise NotImplementedError
 
+    def get_lazy_irs(self, metadata) -> Dict[str, Callable]:
+        """
+        Return a map of IR names to functions generating them on demand from the IRs of a compiled kernel,
+        for IRs that are not produced by the compilation stages
+        """
+        return {}
+
     @staticmethod
     def parse_attr(desc):
         assert isinstance(desc, str)
@@ -1,5 +1,5 @@
 from abc import ABCMeta, abstractmethod
-from typing import Callable, List, Protocol, Sequence
+from typing import Callable, Dict, List, Optional, Protocol, Sequence
 
 
 class Benchmarker(Protocol):
@@ -30,6 +30,38 @@ class DriverBase(metaclass=ABCMeta):
         """
         raise NotImplementedError
 
+    def get_num_compile_threads(self) -> int:
+        """
+        Return the number of threads the autotuner can use to compile configs concurrently.
+        """
+        return 1
+
+    def get_default_config_prune(self) -> Optional[Callable]:
+        """
+        Return the early_config_prune function of autotuned kernels without prune_configs_by, or None.
+        """
+        return None
+
+    def get_launch_tuning_space(self) -> List[Dict]:
+        """
+        Return launch options, e.g. thread counts, that the autotuner crosses configs with when it tunes launches.
+        """
+        return [{}]
+
+    def get_fast_compile_options(self) -> Dict:
+        """
+        Return compile options of a low-cost tier the autotuner ranks configs with, e.g. a lower optimization
+        level, or an empty dict. The best configs are then recompiled with the given options and benchmarked again.
+        """
+        return {}
+
+    def get_tuning_fingerprint(self) -> str:
+        """
+        Return a description of the host that tuning results depend on besides the backend hash, e.g. its number
+        of cores. Results cached on disk are keyed by it.
+        """
+        return ""
+
     def __init__(self) -> None:
         pass
 
@@ -17,6 +17,7 @@ import re
 import functools
 import os
 import sysconfig
+import threading
 
 # - ^\s*tt\.func\s+ : match the start of the string, any leading whitespace, the keyword func,
 #    and any following whitespace
@@ -212,6 +213,50 @@ def filter_traceback(e: BaseException):
         e.__traceback__ = frames[0]
 
 
+_compile_locks_lock = threading.Lock()
+_compile_locks = dict()
+
+
+def _compile_lock(hash):
+    with _compile_locks_lock:
+        return _compile_locks.setdefault(hash, threading.Lock())
+
+
+class _ContextPool:
+    """Contexts with the dialects of a backend loaded, reused across compilations to save their setup.
+
+    Types, attributes and modules created in a context live as long as it does, so a context is reused for at most
+    TRITON_CONTEXT_REUSE compilations, 16 by default, and 0 creates a new context for each compilation.
+    """
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        # backend type -> [(context, number of compilations)]
+        self._contexts = dict()
+
+    def acquire(self, backend):
+        with self._lock:
+            contexts = self._contexts.get(type(backend))
+            if contexts:
+                context, uses = contexts.pop()
+                # Multithreading is disabled when contexts are released, see compile().
+                context.enable_multithreading()
+                return context, uses
+        context = ir.context()
+        ir.load_dialects(context)
+        backend.load_dialects(context)
+        return context, 0
+
+    def release(self, backend, context, uses):
+        if uses + 1 >= int(os.environ.get("TRITON_CONTEXT_REUSE", "16")):
+            return
+        with self._lock:
+            self._contexts.setdefault(type(backend), []).append((context, uses + 1))
+
+
+_context_pool = _ContextPool()
+
+
 def compile(src, target=None, options=None):
     if target is None:
         target = driver.active.get_current_target()
@@ -230,91 +275,94 @@ def compile(src, target=None, options=None):
     env_vars = get_cache_invalidating_env_vars()
     key = f"{triton_key()}-{src.hash()}-{backend.hash()}-{options.hash()}-{str(sorted(env_vars.items()))}"
     hash = hashlib.sha256(key.encode("utf-8")).hexdigest()
-    fn_cache_manager = get_cache_manager(hash)
-    # For dumping/overriding only hash the source as we want it to be independent of triton
-    # core changes to make it easier to track kernels by hash.
-    enable_override = os.environ.get("TRITON_KERNEL_OVERRIDE", "0") == "1"
-    enable_ir_dump = os.environ.get("TRITON_KERNEL_DUMP", "0") == "1"
-    store_only_binary = os.environ.get("TRITON_STORE_BINARY_ONLY", "0") == "1"
-    fn_override_manager = get_override_manager(src.hash()) if enable_override else None
-    fn_dump_manager = get_dump_manager(src.hash()) if enable_ir_dump else None
-    # Pre-truncate the file name here to avoid hitting the 255 character limit on common platforms.
-    # The final file name in the cache will have a format of f"{filename}.{ext}.tmp.pid_{pid}_{uuid}".
-    # A PID string can be 5-character long. A UUID string has typically 36 characters. Let's truncate
-    # the file name to 150 characters to be safe.
-    file_name = src.name[:150]
-    metadata_filename = f"{file_name}.json"
-    metadata_group = fn_cache_manager.get_group(metadata_filename) or {}
-    metadata_path = metadata_group.get(metadata_filename)
-    always_compile = os.environ.get("TRITON_ALWAYS_COMPILE", "0") == "1"
-    if not always_compile and metadata_path is not None:
-        # cache hit!
+    # Compilations of the same kernel from several threads, e.g. of autotuner configs, are serialized, so the
+    # kernel is compiled and written to the cache only once.
+    with _compile_lock(hash):
+        fn_cache_manager = get_cache_manager(hash)
+        # For dumping/overriding only hash the source as we want it to be independent of triton
+        # core changes to make it easier to track kernels by hash.
+        enable_override = os.environ.get("TRITON_KERNEL_OVERRIDE", "0") == "1"
+        enable_ir_dump = os.environ.get("TRITON_KERNEL_DUMP", "0") == "1"
+        store_only_binary = os.environ.get("TRITON_STORE_BINARY_ONLY", "0") == "1"
+        fn_override_manager = get_override_manager(src.hash()) if enable_override else None
+        fn_dump_manager = get_dump_manager(src.hash()) if enable_ir_dump else None
+        # Pre-truncate the file name here to avoid hitting the 255 character limit on common platforms.
+        # The final file name in the cache will have a format of f"{filename}.{ext}.tmp.pid_{pid}_{uuid}".
+        # A PID string can be 5-character long. A UUID string has typically 36 characters. Let's truncate
+        # the file name to 150 characters to be safe.
+        file_name = src.name[:150]
+        metadata_filename = f"{file_name}.json"
+        metadata_group = fn_cache_manager.get_group(metadata_filename) or {}
+        metadata_path = metadata_group.get(metadata_filename)
+        always_compile = os.environ.get("TRITON_ALWAYS_COMPILE", "0") == "1"
+        if not always_compile and metadata_path is not None:
+            # cache hit!
+            return CompiledKernel(src, metadata_group, hash)
+        # initialize metadata
+        metadata = {
+            "hash": hash,
+            "target": target,
+            **options.__dict__,
+            **env_vars,
+        }
+        metadata["triton_version"] = __version__
+        # run compilation pipeline  and populate metadata
+        stages = dict()
+        backend.add_stages(stages, options)
+        first_stage = list(stages.keys()).index(src.ext)
+        # when the source is an IR file, don't apply the passes related to this stage. This makes it easier to write IR level tests.
+        if ir_source:
+            first_stage += 1
+
+        # For IRSource, we have already grabbed the context + called both
+        # ir.load_dialects and backend.load_dialects.
+        if not isinstance(src, IRSource):
+            context, context_uses = _context_pool.acquire(backend)
+
+        codegen_fns = backend.get_codegen_implementation(options)
+        module_map = backend.get_module_map()
+        try:
+            module = src.make_ir(options, codegen_fns, module_map, context)
+        except Exception as e:
+            filter_traceback(e)
+            raise
+        use_ir_loc = os.environ.get("USE_IR_LOC", None)
+        for ext, compile_ir in list(stages.items())[first_stage:]:
+            next_module = compile_ir(module, metadata)
+            ir_filename = f"{file_name}.{ext}"
+            if (fn_override_manager is not None and (full_name := fn_override_manager.get_file(ir_filename)) is not None):
+                print(f"\nOverriding kernel with file {full_name}")
+                next_module = parse(full_name, ext, context)
+            # If TRITON_STORE_BINARY_ONLY is 1, only store cubin/hsaco/json
+            if (not store_only_binary) or (ext in ("cubin", "hsaco", "json")):
+                metadata_group[ir_filename] = fn_cache_manager.put(next_module, ir_filename)
+            if fn_dump_manager is not None:
+                fn_dump_manager.put(next_module, ir_filename)
+            # use an env variable to parse ir from file
+            if use_ir_loc == ext:
+                ir_full_name = fn_cache_manager.get_file(ir_filename)
+                next_module.create_location_snapshot(ir_full_name)
+                print(f"Creating new locations for {ir_full_name}")
+            module = next_module
+        # write-back metadata
+        metadata_group[metadata_filename] = fn_cache_manager.put(json.dumps(metadata, default=vars), metadata_filename,
+                                                                 binary=False)
+        fn_cache_manager.put_group(metadata_filename, metadata_group)
+        # Compilation completed, disabling multithreading in context.
+        # This is needed to safely finalize threads pool inside context: if current process forks before
+        # python GC deletes context object, thread pool in child process will be invalid, which could
+        # lead to child crash or hang.
+        #
+        # However disabling multithreading causes the code to hang if the ASAN pass is enabled
+        # this is likely due to the llvm-symbolizer forking a process
+        # TODO: Reconcile the difference here between the ASAN and non-ASAN path with enabling
+        # multithreading in the MLIR context
+        if not os.environ.get("TRITON_ENABLE_ASAN", "0") == "1":
+            context.disable_multithreading()
+        if not isinstance(src, IRSource):
+            _context_pool.release(backend, context, context_uses)
+        # return handle to compiled kernel
         return CompiledKernel(src, metadata_group, hash)
-    # initialize metadata
-    metadata = {
-        "hash": hash,
-        "target": target,
-        **options.__dict__,
-        **env_vars,
-    }
-    metadata["triton_version"] = __version__
-    # run compilation pipeline  and populate metadata
-    stages = dict()
-    backend.add_stages(stages, options)
-    first_stage = list(stages.keys()).index(src.ext)
-    # when the source is an IR file, don't apply the passes related to this stage. This makes it easier to write IR level tests.
-    if ir_source:
-        first_stage += 1
-
-    # For IRSource, we have already grabbed the context + called both
-    # ir.load_dialects and backend.load_dialects.
-    if not isinstance(src, IRSource):
-        context = ir.context()
-        ir.load_dialects(context)
-        backend.load_dialects(context)
-
-    codegen_fns = backend.get_codegen_implementation(options)
-    module_map = backend.get_module_map()
-    try:
-        module = src.make_ir(options, codegen_fns, module_map, context)
-    except Exception as e:
-        filter_traceback(e)
-        raise
-    use_ir_loc = os.environ.get("USE_IR_LOC", None)
-    for ext, compile_ir in list(stages.items())[first_stage:]:
-        next_module = compile_ir(module, metadata)
-        ir_filename = f"{file_name}.{ext}"
-        if (fn_override_manager is not None and (full_name := fn_override_manager.get_file(ir_filename)) is not None):
-            print(f"\nOverriding kernel with file {full_name}")
-            next_module = parse(full_name, ext, context)
-        # If TRITON_STORE_BINARY_ONLY is 1, only store cubin/hsaco/json
-        if (not store_only_binary) or (ext in ("cubin", "hsaco", "json")):
-            metadata_group[ir_filename] = fn_cache_manager.put(next_module, ir_filename)
-        if fn_dump_manager is not None:
-            fn_dump_manager.put(next_module, ir_filename)
-        # use an env variable to parse ir from file
-        if use_ir_loc == ext:
-            ir_full_name = fn_cache_manager.get_file(ir_filename)
-            next_module.create_location_snapshot(ir_full_name)
-            print(f"Creating new locations for {ir_full_name}")
-        module = next_module
-    # write-back metadata
-    metadata_group[metadata_filename] = fn_cache_manager.put(json.dumps(metadata, default=vars), metadata_filename,
-                                                             binary=False)
-    fn_cache_manager.put_group(metadata_filename, metadata_group)
-    # Compilation completed, disabling multithreading in context.
-    # This is needed to safely finalize threads pool inside context: if current process forks before
-    # python GC deletes context object, thread pool in child process will be invalid, which could
-    # lead to child crash or hang.
-    #
-    # However disabling multithreading causes the code to hang if the ASAN pass is enabled
-    # this is likely due to the llvm-symbolizer forking a process
-    # TODO: Reconcile the difference here between the ASAN and non-ASAN path with enabling
-    # multithreading in the MLIR context
-    if not os.environ.get("TRITON_ENABLE_ASAN", "0") == "1":
-        context.disable_multithreading()
-    # return handle to compiled kernel
-    return CompiledKernel(src, metadata_group, hash)
 
 
 def make_backend(target):
@@ -341,16 +389,53 @@ class LazyDict:
         self.extras.append((func, args))
 
 
+class CachedIR:
+    """An IR of a compiled kernel that is read from its cache file on each access, see TRITON_LAZY_IR."""
+
+    def __init__(self, path, binary):
+        self.path = path
+        self.binary = binary
+
+    def read(self):
+        return self.path.read_bytes() if self.binary else self.path.read_text()
+
+
 class AsmDict(dict):
 
+    def __init__(self, *args, lazy_irs=None, retain=True, **kwargs):
+        super().__init__(*args, **kwargs)
+        self.lazy_irs = lazy_irs or {}
+        # Whether IRs built on access are kept, they are built again otherwise.
+        self.retain = retain
+
+    def __getitem__(self, key):
+        value = super().__getitem__(key)
+        return value.read() if isinstance(value, CachedIR) else value
+
+    def get(self, key, default=None):
+        return self[key] if key in self else default
+
+    # dict views bypass __getitem__, so IRs of the cache are read here as well.
+    def values(self):
+        return [self[key] for key in self]
+
+    def items(self):
+        return [(key, self[key]) for key in self]
+
+    def copy(self):
+        return dict(self.items())
+
     def __missing__(self, key):
 
         if key == "sass":
             value = get_sass(self["cubin"])
+        elif key in self.lazy_irs:
+            value = self.lazy_irs[key](self)
         else:
             raise KeyError("Unknown key: '%s'" % key)
 
-        self[key] = value
+        if self.retain:
+            self[key] = value
         return value
 
 
@@ -379,10 +464,13 @@ class CompiledKernel:
         # stores the text of each level of IR that was generated during compilation
         asm_files = [Path(p) for c, p in metadata_group.items() if not c.endswith(".json")]
         binary_ext = backend.binary_ext
-        self.asm = AsmDict({
-            file.suffix[1:]: file.read_bytes() if file.suffix[1:] == binary_ext else file.read_text()
-            for file in asm_files
-        })
+        # With TRITON_LAZY_IR=1, IRs are read from the cache when they are accessed instead, and the binary
+        # is dropped once it is loaded, so processes with many kernels don't keep all their IRs in memory.
+        self.lazy_ir = os.environ.get("TRITON_LAZY_IR", "0") == "1"
+        read_ir = CachedIR if self.lazy_ir else lambda file, binary: CachedIR(file, binary).read()
+        self.asm = AsmDict({file.suffix[1:]: read_ir(file, file.suffix[1:] == binary_ext)
+                            for file in asm_files}, lazy_irs=backend.get_lazy_irs(self.metadata),
+                           retain=not self.lazy_ir)
         self.kernel = self.asm[binary_ext]
         # binaries are lazily initialized
         # because it involves doing runtime things
@@ -408,6 +496,10 @@ class CompiledKernel:
         # TODO: n_regs, n_spills should be metadata generated when calling `ptxas`
         self.module, self.function, self.n_regs, self.n_spills = driver.active.utils.load_binary(
             self.name, self.kernel, self.metadata.shared, device)
+        # Backends that count spills when compiling kernels report them in the metadata instead, e.g. CPUs.
+        self.n_spills = getattr(self.metadata, "n_spills", self.n_spills)
+        if self.lazy_ir:
+            self.kernel = None
 
     def __getattribute__(self, name):
         if name == 'run':
@@ -6,6 +6,8 @@ import time
 import inspect
 import hashlib
 import json
+import warnings
+from concurrent.futures import ThreadPoolExecutor
 from typing import Dict, Tuple, List, Optional
 
 from .jit import KernelInterface
@@ -17,12 +19,14 @@ class Autotuner(KernelInterface):
 
     def __init__(self, fn, arg_names, configs, key, reset_to_zero, restore_value, pre_hook=None, post_hook=None,
                  prune_configs_by: Optional[Dict] = None, warmup=None, rep=None, use_cuda_graph=False, do_bench=None,
-                 cache_results=False):
+                 cache_results=False, tune_launch=False, search=None):
         """
         :param prune_configs_by: a dict of functions that are used to prune configs, fields:
             'perf_model': performance model used to predicate running time with different configs, returns running time
             'top_k': number of configs to bench
             'prune_num_stages_by'(optional): a function used to prune num_stages. It takes configs:List[Config] as its input, and returns pruned configs.
+        :param tune_launch: cross configs with launch options of the driver, see get_launch_tuning_space.
+        :param search: "exhaustive" or "halving", see autotune.
         """
         if not configs:
             self.configs = [Config({}, num_warps=4, num_stages=3, num_ctas=1)]
@@ -31,7 +35,21 @@ class Autotuner(KernelInterface):
         self.keys = key
         self.cache: Dict[Tuple, Config] = {}
         self.arg_names = arg_names
-        self.cache_results = cache_results or os.getenv("TRITON_CACHE_AUTOTUNING", None) == "1"
+        self.cache_results = (cache_results or tune_launch or os.getenv("TRITON_CACHE_AUTOTUNING", None) == "1"
+                              or bool(os.getenv("TRITON_TUNING_DB_BACKEND", None)))
+        self.tune_launch = tune_launch
+        self.search = search or ("halving" if tune_launch else "exhaustive")
+        if self.search not in ("exhaustive", "halving"):
+            raise ValueError(f"Unexpected value for search: {self.search}, should be one of {{exhaustive, halving}}")
+        # Successive halving benchmarks all configs for halving_rep ms first and keeps the fastest
+        # 1/halving_factor of them, and those within early_stop_ratio of the fastest, for a round
+        # halving_factor times longer, until a single config is left.
+        self.halving_rep = 5
+        self.halving_factor = 3
+        self.early_stop_ratio = 1.5
+        # Configs are ranked with kernels of the fast compile tier of the driver, if any, and the fastest
+        # verify_top_k of them are recompiled in full and benchmarked again to pick the best one.
+        self.verify_top_k = 3
 
         # Reset to zero or restore values
         self.reset_to_zero = []
@@ -74,7 +92,10 @@ class Autotuner(KernelInterface):
         self.perf_model = None
         self.configs_top_k = 1.0
         self.early_config_prune = None
-        if prune_configs_by:
+        if prune_configs_by is None:
+            # Backends may discard configs they know to be slow, e.g. from cache sizes of the target.
+            self.early_config_prune = driver.active.get_default_config_prune()
+        elif prune_configs_by:
             self.perf_model = prune_configs_by.get("perf_model", self.perf_model)
             self.configs_top_k = prune_configs_by.get("top_k", self.configs_top_k)
             self.early_config_prune = prune_configs_by.get("early_config_prune", self.early_config_prune)
@@ -118,7 +139,7 @@ class Autotuner(KernelInterface):
         else:
             self.do_bench = do_bench
 
-    def _bench(self, *args, config, **meta):
+    def _bench(self, *args, config, bench_kwargs=None, **meta):
         from ..compiler.errors import CompileTimeAssertionFailure
 
         verbose = os.environ.get("TRITON_PRINT_AUTOTUNING", None) == "1"
@@ -154,21 +175,99 @@ class Autotuner(KernelInterface):
             self.post_hook(full_nargs, exception=None)
 
         try:
-            return self.do_bench(kernel_call, quantiles=(0.5, 0.2, 0.8))
+            return self.do_bench(kernel_call, quantiles=(0.5, 0.2, 0.8), **(bench_kwargs or {}))
         except (OutOfResources, CompileTimeAssertionFailure, PTXASError) as e:
             if verbose:
                 print(f"Autotuning failed with {e}")
             return [float("inf"), float("inf"), float("inf")]
 
+    def _successive_halving(self, configs, *args, **kwargs):
+        # Return the best config and timings of each config from the last round it was benchmarked in.
+        timings = {}
+        survivors = list(configs)
+        rep = self.halving_rep
+        while True:
+            bench_kwargs = dict(warmup=builtins.max(1, rep // 5), rep=rep)
+            round_timings = {
+                config: self._bench(*args, config=config, bench_kwargs=bench_kwargs, **kwargs)
+                for config in survivors
+            }
+            timings.update(round_timings)
+            survivors = sorted(survivors, key=round_timings.get)
+            best = round_timings[survivors[0]][0]
+            keep = builtins.max(1, len(survivors) // self.halving_factor)
+            survivors = [
+                config for config in survivors[:keep] if round_timings[config][0] <= best * self.early_stop_ratio
+            ]
+            if len(survivors) <= 1:
+                return survivors[0], timings
+            rep *= self.halving_factor
+
+    def _fast_compile_options(self, configs, kwargs):
+        # The fast tier only saves time when some configs aren't verified, and options set by the caller or
+        # by configs are kept.
+        if len(configs) <= self.verify_top_k:
+            return {}
+        options = driver.active.get_fast_compile_options()
+        return {
+            name: value
+            for name, value in options.items()
+            if name not in kwargs and not any(name in config.kwargs for config in configs)
+        }
+
+    def _expand_launch_configs(self, configs):
+        # Options set by a config take precedence over the launch options crossed with it.
+        expanded = []
+        for config in configs:
+            for options in driver.active.get_launch_tuning_space():
+                kwargs = dict(config.kwargs)
+                num_threads = config.num_threads
+                for name, value in options.items():
+                    if name == "num_threads":
+                        num_threads = num_threads or value
+                    else:
+                        kwargs.setdefault(name, value)
+                launch_config = Config(kwargs, num_warps=config.num_warps, num_stages=config.num_stages,
+                                       num_ctas=config.num_ctas, num_threads=num_threads, maxnreg=config.maxnreg,
+                                       pre_hook=config.pre_hook)
+                if launch_config not in expanded:
+                    expanded.append(launch_config)
+        return expanded
+
+    def _precompile(self, configs, *args, **kwargs):
+        # Compile configs concurrently when the backend supports it, benchmarking then finds them in the
+        # kernel cache. Compilation errors are ignored here and reported when the config is benchmarked.
+        num_threads = builtins.min(driver.active.get_num_compile_threads(), len(configs))
+        if num_threads <= 1:
+            return
+
+        def compile_config(config):
+            try:
+                self.fn.run(*args, **meta, **config.all_kwargs())
+            except Exception:
+                pass
+
+        meta = dict(kwargs, warmup=True)
+        # The first config initializes kernel caches of the function.
+        compile_config(configs[0])
+        with ThreadPoolExecutor(num_threads) as executor:
+            list(executor.map(compile_config, configs[1:]))
+
+    @staticmethod
+    def _config_fields(config):
+        # Prehooks can't be serialized, cached configs get them back from the tuned configs with the same fields.
+        return {name: value for name, value in config.__dict__.items() if name != "pre_hook"}
+
     def check_disk_cache(self, tuning_key, configs, bench_fn):
-        # We can't serialize prehooks, so just give up and run the benchmarks.
-        if not tuning_key or any(cfg.pre_hook for cfg in configs):
+        configs_by_fields = {json.dumps(self._config_fields(cfg), sort_keys=True): cfg for cfg in configs}
+        # Configs that only differ by their prehooks can't be told apart in the cache, so just run the benchmarks.
+        if not tuning_key or len(configs_by_fields) != len(configs):
             bench_fn()
             return
 
         from triton._C.libtriton import get_cache_invalidating_env_vars
         from triton.compiler.compiler import make_backend, triton_key
-        from triton.runtime.cache import get_cache_manager
+        from triton.runtime.cache import get_cache_manager, get_tuning_database
         from triton.runtime.jit import JITFunction
 
         fn = self.fn
@@ -182,32 +281,61 @@ class Autotuner(KernelInterface):
             fn.cache_key,
             str(sorted(env_vars.items())),
             str(tuning_key),
+            driver.active.get_tuning_fingerprint(),
+            self.search,
         ] + [str(c) for c in configs]
         cache_key = hashlib.sha256("-".join(cache_key).encode("utf-8")).hexdigest()
         cache = get_cache_manager(cache_key)
         file_name = f"{fn.__name__[:150]}.autotune.json"
         path = cache.get_file(file_name)
+        data = None
         if path:
-            with open(path, "r") as cached_configs:
-                timings = json.load(cached_configs)["configs_timings"]
-                timings = {Config(**config): timing for config, timing in timings}
-                self.cache[tuning_key] = builtins.min(timings, key=timings.get)
-                self.configs_timings = timings
+            with open(path, "rb") as cached_configs:
+                data = cached_configs.read()
+        # Results missing from the local cache are read through the tuning database, so kernels are
+        # tuned once for all hosts with the same target and tuning fingerprint.
+        tuning_db = get_tuning_database(cache_key)
+        if data is None and tuning_db is not None:
+            try:
+                data = tuning_db.get([file_name]).get(file_name)
+            except Exception as e:
+                warnings.warn(f"Couldn't read autotuning results from the tuning database: {e}")
+            if data is not None:
+                cache.put(data, file_name)
+        if data is not None:
+            cached = json.loads(data)
+
+            def restore(fields):
+                return configs_by_fields.get(json.dumps(fields, sort_keys=True)) or Config(**fields)
+
+            timings = {restore(config): timing for config, timing in cached["configs_timings"]}
+            # Successive halving keeps timings of short rounds of pruned configs, so the best config
+            # is stored explicitly.
+            best = cached.get("best_config")
+            self.cache[tuning_key] = restore(best) if best else builtins.min(timings, key=timings.get)
+            self.configs_timings = timings
             return
 
         bench_fn()
-        cache.put(
-            json.dumps({
-                "key":
-                tuning_key,
-                "configs_timings":
-                [(config.__dict__, timings) for config, timings in self.configs_timings.items() if not config.pre_hook],
-            }), file_name, binary=False)
+        data = json.dumps({
+            "key":
+            tuning_key,
+            "configs_timings":
+            [(self._config_fields(config), timings) for config, timings in self.configs_timings.items()],
+            "best_config":
+            self._config_fields(self.cache[tuning_key]),
+        })
+        cache.put(data, file_name, binary=False)
+        if tuning_db is not None:
+            try:
+                tuning_db.put(file_name, data.encode("utf-8"))
+            except Exception as e:
+                warnings.warn(f"Couldn't write autotuning results to the tuning database: {e}")
 
     def run(self, *args, **kwargs):
         self.nargs = dict(zip(self.arg_names, args))
         used_cached_result = True
-        if len(self.configs) > 1:
+        if len(self.configs) > 1 or self.tune_launch:
             all_args = {**self.nargs, **kwargs}
             _args = {k: v for (k, v) in all_args.items() if k in self.arg_names}
             key = [_args[key] for key in self.keys if key in _args]
@@ -218,13 +346,34 @@ class Autotuner(KernelInterface):
             if key not in self.cache:
                 used_cached_result = False
                 pruned_configs = self.prune_configs(kwargs)
+                if self.tune_launch:
+                    pruned_configs = self._expand_launch_configs(pruned_configs)
 
                 def benchmark():
                     bench_start = time.time()
-                    timings = {config: self._bench(*args, config=config, **kwargs) for config in pruned_configs}
+                    fast_options = self._fast_compile_options(pruned_configs, kwargs)
+                    rank_kwargs = {**kwargs, **fast_options}
+                    self._precompile(pruned_configs, *args, **rank_kwargs)
+                    if self.search == "halving" and len(pruned_configs) > 1:
+                        self.cache[key], timings = self._successive_halving(pruned_configs, *args, **rank_kwargs)
+                    else:
+                        timings = {
+                            config: self._bench(*args, config=config, **rank_kwargs)
+                            for config in pruned_configs
+                        }
+                        self.cache[key] = builtins.min(timings, key=timings.get)
+                    if fast_options:
+                        # The winner of the fast tier is first, successive halving may have timed it in a
+                        # shorter round than other configs.
+                        ranked = sorted(timings, key=timings.get)
+                        ranked.remove(self.cache[key])
+                        finalists = [self.cache[key]] + ranked[:self.verify_top_k - 1]
+                        self._precompile(finalists, *args, **kwargs)
+                        full_timings = {config: self._bench(*args, config=config, **kwargs) for config in finalists}
+                        timings.update(full_timings)
+                        self.cache[key] = builtins.min(full_timings, key=full_timings.get)
                     bench_end = time.time()
                     self.bench_time = bench_end - bench_start
-                    self.cache[key] = builtins.min(timings, key=timings.get)
                     full_nargs = {**self.nargs, **kwargs, **self.cache[key].all_kwargs()}
                     self.pre_hook(full_nargs, reset_only=True)
                     self.configs_timings = timings
@@ -360,7 +509,8 @@ class Config:
 
 
 def autotune(configs, key, prune_configs_by=None, reset_to_zero=None, restore_value=None, pre_hook=None, post_hook=None,
-             warmup=None, rep=None, use_cuda_graph=False, do_bench=None, cache_results=False):
+             warmup=None, rep=None, use_cuda_graph=False, do_bench=None, cache_results=False, tune_launch=False,
+             search=None):
     """
     Decorator for auto-tuning a :code:`triton.jit`'d function.
 
@@ -394,6 +544,7 @@ def autotune(configs, key, prune_configs_by=None, reset_to_zero=None, restore_va
         'perf_model': performance model used to predicate running time with different configs, returns running time
         'top_k': number of configs to bench
         'early_config_prune'(optional): a function used to do early prune (eg, num_stages). It takes configs:List[Config] as its input, and returns pruned configs.
+        Defaults to the pruning function of the backend, if any, pass an empty dict to benchmark all configs.
     :param reset_to_zero: a list of argument names whose value will be reset to zero before evaluating any configs.
     :type reset_to_zero: list[str]
     :param restore_value: a list of argument names whose value will be restored after evaluating any configs.
@@ -416,12 +567,24 @@ def autotune(configs, key, prune_configs_by=None, reset_to_zero=None, restore_va
     :type do_bench: lambda fn, quantiles
     :param cache_results: whether to cache autotune timings to disk.  Defaults to False.
     "type cache_results: bool
+    :param tune_launch: whether to also tune launch options of the backend, e.g. the number of threads and the
+        schedule of CPU launches, by crossing each config with them. Options set by a config are kept. Results
+        are cached to disk, keyed by the host the kernel is tuned on.
+    :type tune_launch: bool
+    :param search: "exhaustive" benchmarks every config in full, "halving" benchmarks all configs briefly first
+        and keeps only the fastest third, and configs within 1.5x of the fastest, for each longer round, which
+        needs a do_bench taking warmup and rep. Defaults to "halving" with tune_launch, "exhaustive" otherwise.
+    :type search: str
+
+    Backends with a fast compile tier, e.g. O1 kernels of CPUs, rank configs with it when there are more than
+    three, and the three fastest ones are recompiled in full and benchmarked again to pick the best one.
     """
 
     def decorator(fn):
         return Autotuner(fn, fn.arg_names, configs, key, reset_to_zero, restore_value, pre_hook=pre_hook,
                          post_hook=post_hook, prune_configs_by=prune_configs_by, warmup=warmup, rep=rep,
-                         use_cuda_graph=use_cuda_graph, do_bench=do_bench, cache_results=cache_results)
+                         use_cuda_graph=use_cuda_graph, do_bench=do_bench, cache_results=cache_results,
+                         tune_launch=tune_launch, search=search)
 
     return decorator
 
@@ -175,6 +175,32 @@ class RedisRemoteCacheBackend(RemoteCacheBackend):
         self._redis.set(self._get_key(filename), data)
 
 
+class DirectoryRemoteCacheBackend(RemoteCacheBackend):
+    """
+    A remote cache in a directory shared between hosts, e.g. on NFS, pointed to by `TRITON_REMOTE_CACHE_DIR`.
+    """
+
+    def __init__(self, key):
+        self._dir = os.path.join(os.environ["TRITON_REMOTE_CACHE_DIR"], key)
+
+    def get(self, filenames: List[str]) -> Dict[str, bytes]:
+        results = {}
+        for filename in filenames:
+            try:
+                with open(os.path.join(self._dir, filename), "rb") as f:
+                    results[filename] = f.read()
+            except FileNotFoundError:
+                pass
+        return results
+
+    def put(self, filename: str, data: bytes):
+        os.makedirs(self._dir, exist_ok=True)
+        temp_path = os.path.join(self._dir, f"{filename}.tmp.pid_{os.getpid()}_{uuid.uuid4()}")
+        with open(temp_path, "wb") as f:
+            f.write(data)
+        os.replace(temp_path, os.path.join(self._dir, filename))
+
+
 class RemoteCacheManager(CacheManager):
 
     def __init__(self, key, override=False, dump=False):
@@ -277,6 +303,20 @@ def get_cache_manager(key) -> CacheManager:
     return __cache_cls(_base32(key))
 
 
+def get_tuning_database(key) -> Optional[RemoteCacheBackend]:
+    """
+    Return the store of autotuning results shared between processes and hosts, a `RemoteCacheBackend` pointed to
+    by `TRITON_TUNING_DB_BACKEND`, e.g. `triton.runtime.cache:RedisRemoteCacheBackend`, or None if it isn't set.
+    The autotuner reads results from it when they aren't in the local cache, and writes results it tunes to it.
+    """
+    tuning_db = os.environ.get("TRITON_TUNING_DB_BACKEND", None)
+    if not tuning_db:
+        return None
+    module_path, clz_nme = tuning_db.split(":")
+    module = importlib.import_module(module_path)
+    return getattr(module, clz_nme)(_base32(key))
+
+
 def get_override_manager(key) -> CacheManager:
     return __cache_cls(_base32(key), override=True)
 
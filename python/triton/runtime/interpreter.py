@@ -1,6 +1,10 @@
 import ast
+import itertools
+import os
 import textwrap
+import threading
 import inspect
+from concurrent.futures import ThreadPoolExecutor
 from typing import Tuple, List
 
 import math
@@ -279,6 +283,16 @@ class InterpreterBuilder:
         self.codegen_fns = {}
         self.codegen_fns["convert_custom_types"] = ExtraFunctions._convert_custom_types
         self.codegen_fns["min_dot_size"] = lambda lhsType, rhsType: (1, 1, 1)
+        # Programs may run on several threads, each with its own program id.
+        self._program = threading.local()
+
+    @property
+    def grid_idx(self):
+        return getattr(self._program, "grid_idx", None)
+
+    @grid_idx.setter
+    def grid_idx(self, grid_idx):
+        self._program.grid_idx = grid_idx
 
     def set_grid_idx(self, x, y, z):
         if not x < self.grid_dim[0]:
@@ -1135,6 +1149,17 @@ def _implicit_cvt(arg):
 
 interpreter_builder = InterpreterBuilder()
 
+# Patching and rewriting of functions called from programs running on several threads.
+_rewrite_lock = threading.RLock()
+
+
+def _get_num_threads():
+    # Programs run one after another by default, so they can be stepped through with pdb. With
+    # TRITON_INTERPRET_NUM_THREADS, they run in parallel, numpy and interpreter memory operations
+    # release the GIL.
+    num_threads = int(os.getenv("TRITON_INTERPRET_NUM_THREADS", "1"))
+    return num_threads if num_threads > 0 else os.cpu_count()
+
 
 def _unwrap_tensor(t):
     if isinstance(t, triton.runtime.jit.TensorWrapper):
@@ -1210,6 +1235,39 @@ class GridExecutor:
         for (arg_dev, arg_hst) in storages.values():
             arg_dev.copy_(arg_hst)
 
+    def _run_programs(self, grid, args):
+        num_programs = grid[0] * grid[1] * grid[2]
+        num_threads = min(_get_num_threads(), num_programs)
+        if num_threads <= 1:
+            for x in range(grid[0]):
+                for y in range(grid[1]):
+                    for z in range(grid[2]):
+                        interpreter_builder.set_grid_idx(x, y, z)
+                        self.fn(**args)
+            return
+
+        # Programs are taken one by one in the sequential order. Atomics of programs running
+        # concurrently are serialized by the interpreter. After a program fails, no new ones start.
+        next_program = itertools.count()
+        failed = threading.Event()
+
+        def run_programs():
+            while not failed.is_set():
+                i = next(next_program)
+                if i >= num_programs:
+                    return
+                interpreter_builder.set_grid_idx(i // (grid[1] * grid[2]), i // grid[2] % grid[1], i % grid[2])
+                try:
+                    self.fn(**args)
+                except BaseException:
+                    failed.set()
+                    raise
+
+        with ThreadPoolExecutor(num_threads, thread_name_prefix="triton-interpreter") as executor:
+            futures = [executor.submit(run_programs) for _ in range(num_threads)]
+        for future in futures:
+            future.result()
+
     def __call__(self, *args_dev, **kwargs):
         if kwargs.pop("warmup", False):
             return
@@ -1232,11 +1290,7 @@ class GridExecutor:
         grid = grid + (1, ) * (3 - len(grid))
         interpreter_builder.set_grid_dim(*grid)
         try:
-            for x in range(grid[0]):
-                for y in range(grid[1]):
-                    for z in range(grid[2]):
-                        interpreter_builder.set_grid_idx(x, y, z)
-                        self.fn(**args)
+            self._run_programs(grid, args)
         except Exception as e:
             raise InterpreterError(repr(e)) from e
         # copy arguments back to propagate side-effects
@@ -1350,9 +1404,10 @@ class InterpretedFunction:
         self.arg_names = [v.name for v in signature.parameters.values()]
 
     def rewrite(self):
-        if self.fn not in self.rewritten_fn:
-            self.rewritten_fn[self.fn] = self.rewriter.rewrite_ast()
-        return self.rewritten_fn[self.fn]
+        with _rewrite_lock:
+            if self.fn not in self.rewritten_fn:
+                self.rewritten_fn[self.fn] = self.rewriter.rewrite_ast()
+            return self.rewritten_fn[self.fn]
 
     @property
     def __name__(self):
@@ -1364,7 +1419,8 @@ class InterpretedFunction:
 
     def __call__(self, *args, **kwargs):
         # This is a device function call
-        _patch_lang(self.fn)
+        with _rewrite_lock:
+            _patch_lang(self.fn)
         fn = self.rewrite()
         try:
             return fn(*args, **kwargs)
@@ -300,6 +300,44 @@ dtype2str = {}
 specialize_impl_cache = []
 
 
+class _HostArray:
+    """A host array passed without data_ptr, e.g. a numpy array, an Arrow buffer or a DLPack tensor.
+
+    Arrays are viewed by numpy without copies, which gives their dtype and address for specialization.
+    Launchers read the same address from the array itself.
+    """
+
+    def __init__(self, array):
+        self.dtype = array.dtype
+        self._address = array.__array_interface__["data"][0]
+
+    def data_ptr(self):
+        return self._address
+
+
+def _as_host_array(arg):
+    try:
+        import numpy as np
+    except ImportError:
+        return None
+    # Scalars have the array interface too, but they are temporaries, not memory the kernel can point to.
+    if isinstance(arg, np.generic):
+        return None
+    try:
+        if hasattr(arg, "__array_interface__"):
+            array = np.asarray(arg)
+        elif hasattr(arg, "__dlpack__"):
+            array = np.from_dlpack(arg)
+        else:
+            array = np.asarray(memoryview(arg))
+    except (TypeError, ValueError, BufferError, RuntimeError):
+        return None
+    # Kernels may write to any pointer argument.
+    if not array.flags.writeable:
+        raise ValueError("Pointer arguments must be writable host arrays")
+    return _HostArray(array)
+
+
 def create_specialize_impl(specialize_extra):
 
     from ..language import constexpr
@@ -343,6 +381,8 @@ def create_specialize_impl(specialize_extra):
             tys = make_tuple([x[0] for x in spec])
             keys = make_tuple([x[1] for x in spec])
             return (tys, keys)
+        elif (array := _as_host_array(arg)) is not None:
+            return specialize_impl(array, is_const, specialize_value, align)
         else:
             raise TypeError("Unsupported type: %s" % type(arg))
 
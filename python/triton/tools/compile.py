@@ -1,14 +1,17 @@
 import binascii
 import hashlib
 import importlib.util
+import os
+import shutil
+import subprocess
 import sys
+import tempfile
 from argparse import ArgumentParser
 from pathlib import Path
 from typing import List
 
 import triton
 import triton.backends
-from triton.backends.nvidia.driver import ty_to_cpp
 
 desc = """
 Triton ahead-of-time compiler:
@@ -32,6 +35,15 @@ CUresult kernel_{specialization_suffix}(CUstream stream, unsigned gX, unsigned g
 
 Different such specialized entry points can be combined using the `linker.py` script.
 
+On the CPU backend, the kernel is compiled to assembly and the entry point is
+
+TritonCPUResult kernel_{specialization_suffix}(int32_t num_threads, float* arg0, int32_t arg1, int32_t arg2)
+
+It runs the grid on the thread pool of libTritonCPURuntime using num_threads
+threads (all of them if num_threads is 0). The launcher and the kernel are
+archived into a static library, which must be linked with TritonCPURuntime,
+sleef and m.
+
 NOTE: when resolving the scope of /path/to/kernel.py, the file will be executed from within its parent directory with the python interpreter
 used to run this `compile.py` script
 """
@@ -51,6 +63,8 @@ if __name__ == "__main__":
     parser.add_argument("--out-path", "-o", type=Path, default=None, help="Out filename")
     parser.add_argument("--signature", "-s", type=str, help="Signature of the kernel", required=True)
     parser.add_argument("--grid", "-g", type=str, help="Launch grid of the kernel", required=True)
+    parser.add_argument("--isa-variants", type=str, default=None,
+                        help="CPU backend: comma-separated ISA variants of the kernel, e.g. avx2,avx512")
     args = parser.parse_args()
 
     out_name = args.out_name if args.out_name else args.kernel_name
@@ -108,9 +122,19 @@ if __name__ == "__main__":
         assert h in [1, 16], f"Only 1 and 16 are valid hints, got {h}"
     attrs = {k: [["tt.divisibility", 16]] for k, v in hints.items() if v == 16}
     src = triton.compiler.ASTSource(fn=kernel, constexprs=constants, signature=signature, attrs=attrs)
+    target = triton.runtime.driver.active.get_current_target()
+    is_cpu = target.backend == "cpu"
+    if is_cpu:
+        from triton.backends.cpu.driver import ty_to_cpp
+    else:
+        from triton.backends.nvidia.driver import ty_to_cpp
     opts = {"num_warps": args.num_warps, "num_stages": args.num_stages}
-    ccinfo = triton.compile(src, options=opts)
-    if ccinfo.metadata.global_scratch_size > 0:
+    if args.isa_variants:
+        if not is_cpu:
+            raise ValueError("--isa-variants is only supported by the CPU backend")
+        opts["isa_variants"] = tuple(args.isa_variants.split(","))
+    ccinfo = triton.compile(src, target=target, options=opts)
+    if getattr(ccinfo.metadata, "global_scratch_size", 0) > 0:
         raise RuntimeError("AOT compiling kernels with global scratch requirements is not yet implemented")
 
     arg_names = []
@@ -136,27 +160,79 @@ if __name__ == "__main__":
         if hints.get((i, ), None) == 16:
             suffix += 'd'
     func_name = '_'.join([out_name, sig_hash, suffix])
-    asm = ccinfo.asm["cubin"]  # store binary data once
-    hex_ = str(binascii.hexlify(asm))[2:-1]
-    params = {
-        "kernel_name": func_name,
-        "triton_kernel_name": args.kernel_name,
-        "bin_size": len(asm),
-        "bin_data": ", ".join([f"0x{x}{y}" for x, y in zip(hex_[::2], hex_[1::2])]),
-        "signature": ", ".join([f"{ty_to_cpp(ty)} {name}" for name, ty in zip(arg_names_not_1, arg_types_not_1)]),
-        "full_signature": ", ".join([f"{ty_to_cpp(ty)} {name}" for name, ty in zip(arg_names, arg_types)]),
-        "arg_pointers": ", ".join([f"&{arg}" for arg in arg_names_not_1] + ["&global_scratch"]),
-        "num_args": len(arg_names_not_1) + 1,
-        "kernel_docstring": doc_string,
-        "shared": ccinfo.metadata.shared,
-        "num_warps": args.num_warps,
-        "algo_info": '_'.join([const_sig, meta_sig]),
-        "gridX": grid[0],
-        "gridY": grid[1],
-        "gridZ": grid[2],
-        "_placeholder": "",
-    }
-    for ext in ['h', 'c']:
-        template_path = Path(__file__).parent / "extra" / "cuda" / f"compile.{ext}"
-        with out_path.with_suffix(f".{sig_hash}_{suffix}.{ext}").open("w") as fp:
-            fp.write(Path(template_path).read_text().format(**params))
+    if is_cpu:
+        from triton._C.libtriton import cpu, llvm
+
+        # Give the kernel symbols a unique name, so specializations of the kernel can be linked together.
+        entry_name = f"{func_name}_kernel"
+        llir = cpu.rename_kernel(ccinfo.asm["llir"], ccinfo.metadata.name, entry_name)
+        asm = llvm.translate_to_host_asm(llir, ccinfo.metadata.enable_fp_fusion, ccinfo.metadata.enable_fast_math)
+        kernel_arg_types = [ty_to_cpp(ty) for ty in arg_types_not_1]
+        # The kernel is compiled assuming arguments hinted with 16 are multiples of 16, check them on launch.
+        arg_checks = ""
+        for i, arg_name in enumerate(kernel.arg_names):
+            if hints.get((i, ), None) == 16:
+                value = f"(uintptr_t){arg_name}" if signature[arg_name].startswith("*") else arg_name
+                arg_checks += f"  if ({value} % 16 != 0)\n    return TRITON_CPU_ERROR_INVALID_VALUE;\n"
+        params = {
+            "kernel_name": func_name,
+            "entry_name": entry_name,
+            "header_name": out_path.with_suffix(f".{sig_hash}_{suffix}.h").name,
+            "signature": ", ".join([f"{ty} {name}" for name, ty in zip(arg_names_not_1, kernel_arg_types)]),
+            "full_signature": ", ".join([f"{ty_to_cpp(ty)} {name}" for name, ty in zip(arg_names, arg_types)]),
+            "kernel_arg_types": "".join(f"{ty}, " for ty in kernel_arg_types),
+            "arg_fields": " ".join(f"{ty} {name};" for name, ty in zip(arg_names_not_1, kernel_arg_types)),
+            "arg_inits": "".join(f", {name}" for name in arg_names_not_1),
+            "call_args": "".join(f"args->{name}, " for name in arg_names_not_1),
+            "kernel_docstring": doc_string,
+            "arg_checks": arg_checks,
+            "num_threads": ccinfo.metadata.num_threads,
+            "schedule": 1 if ccinfo.metadata.schedule == "steal" else 0,
+            "program_align": max(getattr(ccinfo.metadata, "program_align", 1), 1),
+            "algo_info": '_'.join([const_sig, meta_sig]),
+            "gridX": grid[0],
+            "gridY": grid[1],
+            "gridZ": grid[2],
+            "_placeholder": "",
+        }
+        paths = {ext: out_path.with_suffix(f".{sig_hash}_{suffix}.{ext}") for ext in ['h', 'c', 's', 'a']}
+        for ext in ['h', 'c']:
+            template_path = Path(__file__).parent / "extra" / "cpu" / f"compile.{ext}"
+            paths[ext].write_text(template_path.read_text().format(**params))
+        paths['s'].write_text(asm)
+
+        # Archive the launcher and the kernel into a static library.
+        cc = os.environ.get("CC") or shutil.which("gcc") or shutil.which("clang")
+        if cc is None:
+            raise RuntimeError("Failed to find C compiler. Please specify via CC environment variable.")
+        with tempfile.TemporaryDirectory() as tmpdir:
+            objs = [os.path.join(tmpdir, "launcher.o"), os.path.join(tmpdir, "kernel.o")]
+            subprocess.check_call([cc, "-c", "-O3", "-fPIC", str(paths['c']), "-I", str(paths['h'].parent), "-o", objs[0]])
+            subprocess.check_call([cc, "-c", "-fPIC", str(paths['s']), "-o", objs[1]])
+            paths['a'].unlink(missing_ok=True)
+            subprocess.check_call(["ar", "rcs", str(paths['a']), *objs])
+    else:
+        asm = ccinfo.asm["cubin"]  # store binary data once
+        hex_ = str(binascii.hexlify(asm))[2:-1]
+        params = {
+            "kernel_name": func_name,
+            "triton_kernel_name": args.kernel_name,
+            "bin_size": len(asm),
+            "bin_data": ", ".join([f"0x{x}{y}" for x, y in zip(hex_[::2], hex_[1::2])]),
+            "signature": ", ".join([f"{ty_to_cpp(ty)} {name}" for name, ty in zip(arg_names_not_1, arg_types_not_1)]),
+            "full_signature": ", ".join([f"{ty_to_cpp(ty)} {name}" for name, ty in zip(arg_names, arg_types)]),
+            "arg_pointers": ", ".join([f"&{arg}" for arg in arg_names_not_1] + ["&global_scratch"]),
+            "num_args": len(arg_names_not_1) + 1,
+            "kernel_docstring": doc_string,
+            "shared": ccinfo.metadata.shared,
+            "num_warps": args.num_warps,
+            "algo_info": '_'.join([const_sig, meta_sig]),
+            "gridX": grid[0],
+            "gridY": grid[1],
+            "gridZ": grid[2],
+            "_placeholder": "",
+        }
+        for ext in ['h', 'c']:
+            template_path = Path(__file__).parent / "extra" / "cuda" / f"compile.{ext}"
+            with out_path.with_suffix(f".{sig_hash}_{suffix}.{ext}").open("w") as fp:
+                fp.write(Path(template_path).read_text().format(**params))
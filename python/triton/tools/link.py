@@ -13,6 +13,40 @@ class LinkerError(Exception):
     pass
 
 
+@dataclass
+class LinkerBackend:
+    """ C API of the launchers generated by compile.py for a backend """
+    includes: str
+    result: str
+    stream: str
+    stream_arg: str
+    invalid_value: str
+    extern_c: bool
+
+
+BACKENDS = {
+    "cuda":
+    LinkerBackend(includes="#include <cuda.h>\n", result="CUresult", stream="CUstream stream", stream_arg="stream",
+                  invalid_value="CUDA_ERROR_INVALID_VALUE", extern_c=False),
+    "cpu":
+    LinkerBackend(
+        includes="""#ifndef TT_KERNEL_INCLUDES
+#define TT_KERNEL_INCLUDES
+
+#include <inttypes.h>
+#include <stdint.h>
+
+// Status returned by launchers of ahead-of-time compiled CPU kernels.
+typedef int TritonCPUResult;
+#define TRITON_CPU_SUCCESS 0
+#define TRITON_CPU_ERROR_INVALID_VALUE 1
+
+#endif
+""", result="TritonCPUResult", stream="int32_t num_threads", stream_arg="num_threads",
+        invalid_value="TRITON_CPU_ERROR_INVALID_VALUE", extern_c=True),
+}
+
+
 @dataclass
 class KernelLinkerMeta:
     orig_kernel_name: str
@@ -36,13 +70,24 @@ class HeaderParser:
         # [name, hash, suffix]
         self.kernel_name = re.compile("^([\\w]+)_([\\w]+)_([\\w]+)$")
         # [(type, name)]
-        self.c_sig = re.compile("[\\s]*(\\w+)\\s(\\w+)[,]?")
+        self.c_sig = re.compile("[\\s]*([\\w\\*]+)\\s(\\w+)[,]?")
         # [d|c]
         self.arg_suffix = re.compile("[c,d]")
+        # [backend]
+        self.backend_directive = re.compile("//[\\s]*tt-linker-backend:[\\s]*([\\w]+)")
 
         self.kernels = defaultdict(list)
+        self.backend = None
 
     def extract_linker_meta(self, header: str):
+        # Headers without a backend directive are generated for CUDA.
+        m = self.backend_directive.search(header)
+        backend = m.group(1) if _exists(m) else "cuda"
+        if backend not in BACKENDS:
+            raise LinkerError(f"{backend} is not a supported backend")
+        if _exists(self.backend) and self.backend != backend:
+            raise LinkerError(f"Cannot link {backend} kernels with {self.backend} kernels")
+        self.backend = backend
         for ln in header.splitlines():
             if ln.startswith("//"):
                 m = self.linker_directives.match(ln)
@@ -131,40 +176,41 @@ def gen_signature(m):
 
 
 # generate declarations of kernels with meta-parameter and constant values
-def make_algo_decls(name: str, metas: Sequence[KernelLinkerMeta]) -> str:
+def make_algo_decls(name: str, metas: Sequence[KernelLinkerMeta], backend: LinkerBackend = BACKENDS["cuda"]) -> str:
     return f"""
-CUresult {name}(CUstream stream, {gen_signature_with_full_args(metas[-1])});
+{backend.result} {name}({backend.stream}, {gen_signature_with_full_args(metas[-1])});
 void load_{name}();
 void unload_{name}();
     """
 
 
 # generate declarations of kernels with meta-parameter and constant values
-def make_global_decl(meta: KernelLinkerMeta) -> str:
+def make_global_decl(meta: KernelLinkerMeta, backend: LinkerBackend = BACKENDS["cuda"]) -> str:
     return f"""
-CUresult {meta.orig_kernel_name}_default(CUstream stream, {gen_signature_with_full_args(meta)});
-CUresult {meta.orig_kernel_name}(CUstream stream, {gen_signature_with_full_args(meta)}, int algo_id);
+{backend.result} {meta.orig_kernel_name}_default({backend.stream}, {gen_signature_with_full_args(meta)});
+{backend.result} {meta.orig_kernel_name}({backend.stream}, {gen_signature_with_full_args(meta)}, int algo_id);
 void load_{meta.orig_kernel_name}();
 void unload_{meta.orig_kernel_name}();
     """
 
 
 # generate dispatcher function for kernels with different meta-parameter and constant values
-def make_default_algo_kernel(meta: KernelLinkerMeta) -> str:
-    src = f"CUresult {meta.orig_kernel_name}_default(CUstream stream, {gen_signature_with_full_args(meta)}){{\n"
-    src += (f"  return {meta.orig_kernel_name}(stream, {', '.join(meta.arg_names)}, 0);\n")
+def make_default_algo_kernel(meta: KernelLinkerMeta, backend: LinkerBackend = BACKENDS["cuda"]) -> str:
+    src = f"{backend.result} {meta.orig_kernel_name}_default({backend.stream}, {gen_signature_with_full_args(meta)}){{\n"
+    src += (f"  return {meta.orig_kernel_name}({backend.stream_arg}, {', '.join(meta.arg_names)}, 0);\n")
     src += "}\n"
     return src
 
 
 # generate dispatcher function for kernels with different integer value hints
-def make_kernel_hints_dispatcher(name: str, metas: Sequence[KernelLinkerMeta]) -> str:
+def make_kernel_hints_dispatcher(name: str, metas: Sequence[KernelLinkerMeta],
+                                 backend: LinkerBackend = BACKENDS["cuda"]) -> str:
     src = f"// launcher for: {name}\n"
     for meta in sorted(metas, key=lambda m: -m.num_specs):
-        src += f"CUresult {meta.orig_kernel_name}_{meta.sig_hash}_{meta.suffix}(CUstream stream, {gen_signature(meta)});\n"
+        src += f"{backend.result} {meta.orig_kernel_name}_{meta.sig_hash}_{meta.suffix}({backend.stream}, {gen_signature(meta)});\n"
     src += "\n"
 
-    src += (f"CUresult {name}(CUstream stream, {gen_signature_with_full_args(metas[-1])}){{")
+    src += (f"{backend.result} {name}({backend.stream}, {gen_signature_with_full_args(metas[-1])}){{")
     src += "\n"
     for meta in sorted(metas, key=lambda m: -m.num_specs):
         cond_fn = (  #
@@ -173,17 +219,18 @@ def make_kernel_hints_dispatcher(name: str, metas: Sequence[KernelLinkerMeta]) -
             else f"({val} == {hint})"  #
             if hint == 1  #
             else None)
+        # Pointers are checked for alignment as integers.
         conds = " && ".join([  #
-            cond_fn(val, hint)  #
-            for val, hint in zip(meta.arg_names, meta.sizes)  #
+            cond_fn(f"(uintptr_t){val}" if ty.endswith("*") else val, hint)  #
+            for val, ty, hint in zip(meta.arg_names, meta.arg_ctypes, meta.sizes)  #
             if hint is not None
         ])
         src += (f"  if ({conds})\n" if any(meta.sizes) else "if (1)\n"
                 )  # Edge case where no specializations hence no dispatching required
         arg_names = [arg for arg, hint in zip(meta.arg_names, meta.sizes) if hint != 1]
-        src += f"    return {meta.orig_kernel_name}_{meta.sig_hash}_{meta.suffix}(stream, {', '.join(arg_names)});\n"
+        src += f"    return {meta.orig_kernel_name}_{meta.sig_hash}_{meta.suffix}({backend.stream_arg}, {', '.join(arg_names)});\n"
     src += "\n"
-    src += "  return CUDA_ERROR_INVALID_VALUE;\n"
+    src += f"  return {backend.invalid_value};\n"
     src += "}\n"
 
     for mode in ["load", "unload"]:
@@ -199,18 +246,18 @@ def make_kernel_hints_dispatcher(name: str, metas: Sequence[KernelLinkerMeta]) -
 
 
 # generate dispatcher function for kernels with different meta-parameter and constant values
-def make_kernel_meta_const_dispatcher(meta: KernelLinkerMeta) -> str:
-    src = f"CUresult {meta.orig_kernel_name}(CUstream stream, {gen_signature_with_full_args(meta)}, int algo_id){{\n"
+def make_kernel_meta_const_dispatcher(meta: KernelLinkerMeta, backend: LinkerBackend = BACKENDS["cuda"]) -> str:
+    src = f"{backend.result} {meta.orig_kernel_name}({backend.stream}, {gen_signature_with_full_args(meta)}, int algo_id){{\n"
     src += f"  assert (algo_id < (int)sizeof({meta.orig_kernel_name}_kernels));\n"
-    src += f"  return {meta.orig_kernel_name}_kernels[algo_id](stream, {', '.join(meta.arg_names)});\n"
+    src += f"  return {meta.orig_kernel_name}_kernels[algo_id]({backend.stream_arg}, {', '.join(meta.arg_names)});\n"
     src += "}\n"
     return src
 
 
 # generate definition of function pointers of kernel dispatchers based on meta-parameter and constant values
-def make_func_pointers(names: str, meta: KernelLinkerMeta) -> str:
+def make_func_pointers(names: str, meta: KernelLinkerMeta, backend: LinkerBackend = BACKENDS["cuda"]) -> str:
     # the table of hint dispatchers
-    src = f"typedef CUresult (*kernel_func_t)(CUstream stream, {gen_signature_with_full_args(meta)});\n"
+    src = f"typedef {backend.result} (*kernel_func_t)({backend.stream}, {gen_signature_with_full_args(meta)});\n"
     src += f"kernel_func_t {meta.orig_kernel_name}_kernels[] = {{\n"
     for name in names:
         src += f"  {name},\n"
@@ -279,32 +326,38 @@ if __name__ == "__main__":
         includes.append(h_path.name)
         parser.extract_linker_meta(h_str)
 
+    backend = BACKENDS[parser.backend]
+    extern_c_begin = '#ifdef __cplusplus\nextern "C" {\n#endif\n' if backend.extern_c else ""
+    extern_c_end = '\n#ifdef __cplusplus\n}\n#endif\n' if backend.extern_c else ""
+
     # generate headers
-    algo_decls = [make_algo_decls(name, meta) for name, meta in parser.kernels.items()]
+    algo_decls = [make_algo_decls(name, meta, backend) for name, meta in parser.kernels.items()]
     meta_lists = [meta for name, meta in parser.kernels.items()]
     meta = meta_lists[0][0]
     get_num_algos_decl = make_get_num_algos_decl(meta)
-    global_decl = make_global_decl(meta)
+    global_decl = make_global_decl(meta, backend)
     with args.out.with_suffix(".h").open("w") as fp:
-        out = "#include <cuda.h>\n"
+        out = backend.includes
+        out += extern_c_begin
         out += "\n".join(algo_decls)
         out += "\n"
         out += get_num_algos_decl
         out += "\n"
         out += global_decl
+        out += extern_c_end
         fp.write(out)
 
     # generate source
-    defs = [make_kernel_hints_dispatcher(name, meta) for name, meta in parser.kernels.items()]
+    defs = [make_kernel_hints_dispatcher(name, meta, backend) for name, meta in parser.kernels.items()]
     names = [name for name in parser.kernels.keys()]
-    func_pointers_def = make_func_pointers(names, meta)
-    meta_const_def = make_kernel_meta_const_dispatcher(meta)
+    func_pointers_def = make_func_pointers(names, meta, backend)
+    meta_const_def = make_kernel_meta_const_dispatcher(meta, backend)
     load_unload_def = make_kernel_load_def(names, meta)
     get_num_algos_def = make_get_num_algos_def(meta)
-    default_algo_kernel = make_default_algo_kernel(meta)
+    default_algo_kernel = make_default_algo_kernel(meta, backend)
     with args.out.with_suffix(".c").open("w") as fp:
         out = ""
-        out += "#include <cuda.h>\n"
+        out += backend.includes
         out += "#include <stdint.h>\n"
         out += "#include <assert.h>\n"
         out += "\n"
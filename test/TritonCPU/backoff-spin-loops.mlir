@@ -0,0 +1,48 @@
+// RUN: triton-opt %s -split-input-file -triton-cpu-backoff-spin-loops | FileCheck %s
+
+// Spin loops on a compare-and-swap wait with backoff after failed attempts.
+
+// CHECK-LABEL: @spin_lock
+// CHECK:       scf.while (%[[ITER:.+]] = %{{.+}}) : (i32) -> i32 {
+// CHECK:         %[[OLD:.+]] = tt.atomic_cas acq_rel, gpu, %arg0, %{{.+}}, %{{.+}} : (!tt.ptr<i32>, i32, i32) -> i32
+// CHECK:         scf.condition(%{{.+}}) %[[ITER]] : i32
+// CHECK-NEXT:  } do {
+// CHECK-NEXT:  ^bb0(%[[BODY_ITER:.+]]: i32):
+// CHECK:         triton_cpu.spin_wait %arg0, %{{.+}}, %[[BODY_ITER]] : !tt.ptr<i32>, i32
+// CHECK:         %[[NEXT:.+]] = arith.addi %[[BODY_ITER]], %{{.+}} : i32
+// CHECK-NEXT:    scf.yield %[[NEXT]] : i32
+// CHECK-NEXT:  }
+// CHECK:       tt.atomic_rmw exch
+tt.func public @spin_lock(%arg0: !tt.ptr<i32>) {
+  %c0_i32 = arith.constant 0 : i32
+  %c1_i32 = arith.constant 1 : i32
+  scf.while : () -> () {
+    %0 = tt.atomic_cas acq_rel, gpu, %arg0, %c0_i32, %c1_i32 : (!tt.ptr<i32>, i32, i32) -> i32
+    %1 = arith.cmpi eq, %0, %c1_i32 : i32
+    scf.condition(%1)
+  } do {
+    scf.yield
+  }
+  %2 = tt.atomic_rmw exch, acq_rel, gpu, %arg0, %c0_i32 : (!tt.ptr<i32>, i32) -> i32
+  tt.return
+}
+
+// -----
+
+// Loops storing to memory between attempts are left as is.
+
+// CHECK-LABEL: @cas_loop_with_store
+// CHECK-NOT:   triton_cpu.spin_wait
+tt.func public @cas_loop_with_store(%arg0: !tt.ptr<i32>, %arg1: !tt.ptr<i32>) {
+  %c0_i32 = arith.constant 0 : i32
+  %c1_i32 = arith.constant 1 : i32
+  scf.while : () -> () {
+    %0 = tt.atomic_cas acq_rel, gpu, %arg0, %c0_i32, %c1_i32 : (!tt.ptr<i32>, i32, i32) -> i32
+    %1 = arith.cmpi eq, %0, %c1_i32 : i32
+    scf.condition(%1)
+  } do {
+    tt.store %arg1, %c1_i32 : !tt.ptr<i32>
+    scf.yield
+  }
+  tt.return
+}
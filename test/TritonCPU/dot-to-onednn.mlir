@@ -233,3 +233,58 @@ module {
     tt.return loc(#loc)
   } loc(#loc)
 } loc(#loc)
+
+// -----
+
+// Loop with an epilogue that is applied by the ukernel as post-ops writing
+// the final result directly.
+
+// CHECK-LABEL: @test_loop_acc_relu_downcast
+// CHECK:       %[[OUT_MEMREF:.+]] = triton_cpu.extract_memref %2 : <tensor<64x32xbf16>> -> memref<64x32xbf16, strided<[32, 1]>>
+// CHECK:       %[[OUT_SUBVIEW:.+]] = memref.subview %[[OUT_MEMREF]]
+// CHECK:       %[[NONE9:.+]], %[[NONE10:.+]], %[[NONE11:.+]]:2, %[[OUT_STRIDES:.+]]:2 = memref.extract_strided_metadata %[[OUT_SUBVIEW]]
+// CHECK:       %[[ONEDNN_HANDLE:.+]] = "triton_cpu.brgemm_create"({{.*}}, %[[OUT_STRIDES]]#0) <{dtypeA = vector<64x64xbf16>, dtypeB = vector<64x32xbf16>, dtypeC = f32, dtypeD = vector<64x32xbf16>, postOpAlphas = [0.000000e+00 : f32], postOpBetas = [0.000000e+00 : f32], postOps = ["relu"]}>
+// CHECK:       scf.if
+// CHECK-NEXT:    "triton_cpu.brgemm_execute"(%[[ONEDNN_HANDLE]], {{.*}}, %[[OUT_SUBVIEW]])
+// CHECK:       } else {
+// CHECK:         arith.maximumf
+// CHECK-NEXT:    arith.truncf
+// CHECK-NEXT:    vector.transfer_write
+// CHECK-NOT:   vector.transfer_write
+
+#loc = loc(unknown)
+module {
+  tt.func public @test_loop_acc_relu_downcast(%arg0: !tt.ptr<bf16> {tt.divisibility = 16 : i32} loc(unknown), %arg1: !tt.ptr<bf16> {tt.divisibility = 16 : i32} loc(unknown), %arg2: !tt.ptr<bf16> {tt.divisibility = 16 : i32} loc(unknown)) attributes {noinline = false} {
+    %cst = arith.constant 0.000000e+00 : bf16 loc(#loc)
+    %c2_i32 = arith.constant 2 : i32 loc(#loc)
+    %c1_i32 = arith.constant 1 : i32 loc(#loc)
+    %c64_i32 = arith.constant 64 : i32 loc(#loc)
+    %cst_0 = arith.constant dense<0.000000e+00> : vector<64x32xf32> loc(#loc)
+    %c32_i64 = arith.constant 32 : i64 loc(#loc)
+    %c64_i64 = arith.constant 64 : i64 loc(#loc)
+    %c128_i64 = arith.constant 128 : i64 loc(#loc)
+    %c1_i64 = arith.constant 1 : i64 loc(#loc)
+    %c0_i32 = arith.constant 0 : i32 loc(#loc)
+    %0 = tt.make_tensor_ptr %arg0, [%c64_i64, %c128_i64], [%c128_i64, %c1_i64], [%c0_i32, %c0_i32] {order = array<i32: 1, 0>} : <tensor<64x64xbf16>> loc(#loc)
+    %1 = tt.make_tensor_ptr %arg1, [%c128_i64, %c32_i64], [%c32_i64, %c1_i64], [%c0_i32, %c0_i32] {order = array<i32: 1, 0>} : <tensor<64x32xbf16>> loc(#loc)
+    %2 = tt.make_tensor_ptr %arg2, [%c64_i64, %c32_i64], [%c32_i64, %c1_i64], [%c0_i32, %c0_i32] {order = array<i32: 1, 0>} : <tensor<64x32xbf16>> loc(#loc)
+    %3:3 = scf.for %arg3 = %c0_i32 to %c2_i32 step %c1_i32 iter_args(%arg4 = %cst_0, %arg5 = %0, %arg6 = %1) -> (vector<64x32xf32>, !tt.ptr<tensor<64x64xbf16>>, !tt.ptr<tensor<64x32xbf16>>)  : i32 {
+      %8 = triton_cpu.extract_memref %arg5 : <tensor<64x64xbf16>> -> memref<64x128xbf16, strided<[128, 1]>> loc(#loc)
+      %9:2 = triton_cpu.extract_indices %arg5 : <tensor<64x64xbf16>> -> index, index loc(#loc)
+      %10 = vector.transfer_read %8[%9#0, %9#1], %cst {in_bounds = [true, true]} : memref<64x128xbf16, strided<[128, 1]>>, vector<64x64xbf16> loc(#loc)
+      %11 = triton_cpu.extract_memref %arg6 : <tensor<64x32xbf16>> -> memref<128x32xbf16, strided<[32, 1]>> loc(#loc)
+      %12:2 = triton_cpu.extract_indices %arg6 : <tensor<64x32xbf16>> -> index, index loc(#loc)
+      %13 = vector.transfer_read %11[%12#0, %12#1], %cst {in_bounds = [true, true]} : memref<128x32xbf16, strided<[32, 1]>>, vector<64x32xbf16> loc(#loc)
+      %14 = triton_cpu.dot %10, %13, %arg4, inputPrecision = ieee : vector<64x64xbf16> * vector<64x32xbf16> -> vector<64x32xf32> loc(#loc)
+      %15 = tt.advance %arg5, [%c0_i32, %c64_i32] : <tensor<64x64xbf16>> loc(#loc)
+      %16 = tt.advance %arg6, [%c64_i32, %c0_i32] : <tensor<64x32xbf16>> loc(#loc)
+      scf.yield %14, %15, %16 : vector<64x32xf32>, !tt.ptr<tensor<64x64xbf16>>, !tt.ptr<tensor<64x32xbf16>> loc(#loc)
+    } loc(#loc)
+    %4 = triton_cpu.extract_memref %2 : <tensor<64x32xbf16>> -> memref<64x32xbf16, strided<[32, 1]>> loc(#loc)
+    %5:2 = triton_cpu.extract_indices %2 : <tensor<64x32xbf16>> -> index, index loc(#loc)
+    %6 = arith.maximumf %3#0, %cst_0 : vector<64x32xf32> loc(#loc)
+    %7 = arith.truncf %6 : vector<64x32xf32> to vector<64x32xbf16> loc(#loc)
+    vector.transfer_write %7, %4[%5#0, %5#1] {in_bounds = [true, true]} : vector<64x32xbf16>, memref<64x32xbf16, strided<[32, 1]>> loc(#loc)
+    tt.return loc(#loc)
+  } loc(#loc)
+} loc(#loc)
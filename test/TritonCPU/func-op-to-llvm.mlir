@@ -0,0 +1,25 @@
+// RUN: triton-opt %s -triton-cpu-func-op-to-llvm | FileCheck %s
+
+// Check that kernels get a range entry point running a row of programs in a loop.
+
+// CHECK-LABEL: llvm.func @kernel
+// CHECK-SAME:  passthrough = ["alwaysinline"]
+// CHECK-LABEL: llvm.func @kernel_range
+// CHECK-SAME:  ([[PTR:%[^:]+]]: !llvm.ptr, [[N:%[^:]+]]: i32, [[XB:%[^:]+]]: i32, [[XE:%[^:]+]]: i32, [[Y:%[^:]+]]: i32, [[Z:%[^:]+]]: i32, [[GX:%[^:]+]]: i32, [[GY:%[^:]+]]: i32, [[GZ:%[^:]+]]: i32)
+// CHECK-SAME:  triton_cpu.kernel_entry
+// CHECK:       llvm.br ^[[COND:.+]]([[XB]] : i32)
+// CHECK:       ^[[COND]]([[X:%[^:]+]]: i32):
+// CHECK-NEXT:    [[IN_RANGE:%.+]] = llvm.icmp "ult" [[X]], [[XE]] : i32
+// CHECK-NEXT:    llvm.cond_br [[IN_RANGE]], ^[[LOOP:.+]], ^[[EXIT:.+]]
+// CHECK:       ^[[LOOP]]:
+// CHECK-NEXT:    llvm.call @kernel([[PTR]], [[N]], [[X]], [[Y]], [[Z]], [[GX]], [[GY]], [[GZ]])
+// CHECK:         [[NEXT:%.+]] = llvm.add [[X]], %{{.+}} : i32
+// CHECK-NEXT:    llvm.br ^[[COND]]([[NEXT]] : i32)
+// CHECK:       ^[[EXIT]]:
+// CHECK-NEXT:    llvm.return
+
+module {
+  tt.func public @kernel(%arg0: !tt.ptr<f32>, %arg1: i32) {
+    tt.return
+  }
+}
@@ -0,0 +1,65 @@
+// RUN: triton-opt %s -split-input-file -triton-cpu-hoist-grid-invariants | FileCheck %s
+
+// Values that don't depend on the x program id are computed by the range
+// entry point before its loop and passed to the kernel.
+
+// CHECK-LABEL: llvm.func @kernel(%arg0: !llvm.ptr, %arg1: i32, %arg2: !llvm.ptr, %arg3: i32,
+// CHECK-NOT:   llvm.mul
+// CHECK:       %[[PTR:.+]] = llvm.getelementptr %arg2[%arg3] : (!llvm.ptr, i32) -> !llvm.ptr, f32
+// CHECK:       llvm.store %{{.+}}, %[[PTR]] : f32, !llvm.ptr
+// CHECK-LABEL: llvm.func @kernel_range(
+// CHECK:       %[[OFFSET:.+]] = llvm.mul %arg4, %arg1 : i32
+// CHECK:       %[[ROW:.+]] = llvm.getelementptr %arg0[%[[OFFSET]]] : (!llvm.ptr, i32) -> !llvm.ptr, f32
+// CHECK:       llvm.br ^bb1
+// CHECK:       llvm.call @kernel(%arg0, %arg1, %[[ROW]], %{{.+}}, %arg4, %arg5, %arg6, %arg7, %arg8)
+module {
+  llvm.func @kernel(%arg0: !llvm.ptr, %arg1: i32, %arg2: i32, %arg3: i32, %arg4: i32, %arg5: i32, %arg6: i32, %arg7: i32) {
+    %cst = llvm.mlir.constant(1.000000e+00 : f32) : f32
+    %0 = llvm.mul %arg3, %arg1 : i32
+    %1 = llvm.getelementptr %arg0[%0] : (!llvm.ptr, i32) -> !llvm.ptr, f32
+    %2 = llvm.getelementptr %1[%arg2] : (!llvm.ptr, i32) -> !llvm.ptr, f32
+    llvm.store %cst, %2 : f32, !llvm.ptr
+    llvm.return
+  }
+  llvm.func @kernel_range(%arg0: !llvm.ptr, %arg1: i32, %arg2: i32, %arg3: i32, %arg4: i32, %arg5: i32, %arg6: i32, %arg7: i32, %arg8: i32) attributes {triton_cpu.kernel_entry} {
+    llvm.br ^bb1(%arg2 : i32)
+  ^bb1(%0: i32):
+    %1 = llvm.icmp "slt" %0, %arg3 : i32
+    llvm.cond_br %1, ^bb2, ^bb3
+  ^bb2:
+    llvm.call @kernel(%arg0, %arg1, %0, %arg4, %arg5, %arg6, %arg7, %arg8) : (!llvm.ptr, i32, i32, i32, i32, i32, i32, i32) -> ()
+    %2 = llvm.mlir.constant(1 : i32) : i32
+    %3 = llvm.add %0, %2 : i32
+    llvm.br ^bb1(%3 : i32)
+  ^bb3:
+    llvm.return
+  }
+}
+
+// -----
+
+// Kernels without invariant values are left as is.
+
+// CHECK-LABEL: llvm.func @kernel(%arg0: !llvm.ptr, %arg1: i32, %arg2: i32, %arg3: i32, %arg4: i32, %arg5: i32, %arg6: i32, %arg7: i32)
+// CHECK:       llvm.call @kernel(%arg0, %arg1, %0, %arg4, %arg5, %arg6, %arg7, %arg8)
+module {
+  llvm.func @kernel(%arg0: !llvm.ptr, %arg1: i32, %arg2: i32, %arg3: i32, %arg4: i32, %arg5: i32, %arg6: i32, %arg7: i32) {
+    %0 = llvm.mul %arg2, %arg1 : i32
+    %1 = llvm.getelementptr %arg0[%0] : (!llvm.ptr, i32) -> !llvm.ptr, i32
+    llvm.store %0, %1 : i32, !llvm.ptr
+    llvm.return
+  }
+  llvm.func @kernel_range(%arg0: !llvm.ptr, %arg1: i32, %arg2: i32, %arg3: i32, %arg4: i32, %arg5: i32, %arg6: i32, %arg7: i32, %arg8: i32) attributes {triton_cpu.kernel_entry} {
+    llvm.br ^bb1(%arg2 : i32)
+  ^bb1(%0: i32):
+    %1 = llvm.icmp "slt" %0, %arg3 : i32
+    llvm.cond_br %1, ^bb2, ^bb3
+  ^bb2:
+    llvm.call @kernel(%arg0, %arg1, %0, %arg4, %arg5, %arg6, %arg7, %arg8) : (!llvm.ptr, i32, i32, i32, i32, i32, i32, i32) -> ()
+    %2 = llvm.mlir.constant(1 : i32) : i32
+    %3 = llvm.add %0, %2 : i32
+    llvm.br ^bb1(%3 : i32)
+  ^bb3:
+    llvm.return
+  }
+}
@@ -0,0 +1,46 @@
+// RUN: triton-opt %s -split-input-file -triton-cpu-lower-transposes=vector-bits=128 | FileCheck %s
+
+// Square tiles of a register per row are transposed with log2(size) steps of
+// row shuffles.
+
+// CHECK-LABEL: @transpose_4x4
+// CHECK-NOT:   vector.transpose
+// CHECK-COUNT-4: vector.extract %{{.+}}[{{[0-3]}}] : vector<4xf32> from vector<4x4xf32>
+// CHECK:       vector.shuffle %{{.+}}, %{{.+}} [0, 4, 1, 5] : vector<4xf32>, vector<4xf32>
+// CHECK:       vector.shuffle %{{.+}}, %{{.+}} [2, 6, 3, 7] : vector<4xf32>, vector<4xf32>
+// CHECK-COUNT-6: vector.shuffle
+// CHECK-COUNT-4: vector.insert %{{.+}}, %{{.+}} [{{[0-3]}}] : vector<4xf32> into vector<4x4xf32>
+// CHECK-NOT:   vector.transpose
+tt.func @transpose_4x4(%arg0: vector<4x4xf32>) -> vector<4x4xf32> {
+  %0 = vector.transpose %arg0, [1, 0] : vector<4x4xf32> to vector<4x4xf32>
+  tt.return %0 : vector<4x4xf32>
+}
+
+// -----
+
+// Larger transposes are split into tiles moved as whole sub-rows.
+
+// CHECK-LABEL: @transpose_8x4
+// CHECK-NOT:   vector.transpose
+// CHECK:       vector.extract_strided_slice %arg0 {offsets = [0, 0], sizes = [4, 4], strides = [1, 1]} : vector<8x4xf32> to vector<4x4xf32>
+// CHECK:       vector.shuffle
+// CHECK:       vector.insert_strided_slice %{{.+}}, %{{.+}} {offsets = [0, 0], strides = [1, 1]} : vector<4x4xf32> into vector<4x8xf32>
+// CHECK:       vector.extract_strided_slice %arg0 {offsets = [4, 0], sizes = [4, 4], strides = [1, 1]} : vector<8x4xf32> to vector<4x4xf32>
+// CHECK:       vector.shuffle
+// CHECK:       vector.insert_strided_slice %{{.+}}, %{{.+}} {offsets = [0, 4], strides = [1, 1]} : vector<4x4xf32> into vector<4x8xf32>
+// CHECK-NOT:   vector.transpose
+tt.func @transpose_8x4(%arg0: vector<8x4xf32>) -> vector<4x8xf32> {
+  %0 = vector.transpose %arg0, [1, 0] : vector<8x4xf32> to vector<4x8xf32>
+  tt.return %0 : vector<4x8xf32>
+}
+
+// -----
+
+// Transposes of other ranks are left as is.
+
+// CHECK-LABEL: @transpose_3d
+// CHECK:       vector.transpose %arg0, [2, 1, 0]
+tt.func @transpose_3d(%arg0: vector<2x4x4xf32>) -> vector<4x4x2xf32> {
+  %0 = vector.transpose %arg0, [2, 1, 0] : vector<2x4x4xf32> to vector<4x4x2xf32>
+  tt.return %0 : vector<4x4x2xf32>
+}
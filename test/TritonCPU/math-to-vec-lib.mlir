@@ -6,6 +6,8 @@
 // RUN: triton-opt %s -split-input-file -triton-cpu-math-to-vec-lib="cpu_features=avx512f" | FileCheck %s --check-prefix=CHECK-AVX512F
 // RUN: triton-opt %s -split-input-file -triton-cpu-math-to-vec-lib="cpu_features=avx512f,avx" | FileCheck %s --check-prefix=CHECK-AVX512F
 // RUN: triton-opt %s -split-input-file -triton-cpu-math-to-vec-lib="cpu_features=avx512f,avx,sse" | FileCheck %s --check-prefix=CHECK-AVX512F
+// RUN: triton-opt %s -split-input-file -triton-cpu-math-to-vec-lib="cpu_features=v scalable-bits=128" | FileCheck %s --check-prefix=CHECK-RVV
+// RUN: triton-opt %s -split-input-file -triton-cpu-math-to-vec-lib="cpu_features=v scalable-bits=256" | FileCheck %s --check-prefix=CHECK-RVV256
 
 // Convert math ops to VecLib ops.
 
@@ -24,6 +26,13 @@
 // CHECK-AVX512F-NEXT: %[[CALLED:.*]] = func.call @Sleef_expf16_u10(%[[EXTRACTED]]) : (vector<16xf32>) -> vector<16xf32>
 // CHECK-AVX512F-NEXT: %[[INSERTED:.*]] = vector.insert %[[CALLED]], %{{.*}}[0] : vector<16xf32> into vector<64x16xf32>
 
+// CHECK-RVV-LABEL: @exp_kernel
+// CHECK-RVV: %[[EXTRACTED:.*]] = vector.extract %{{.*}}[0] : vector<4xf32> from vector<256x4xf32>
+// CHECK-RVV: %[[SCALABLE:.*]] = vector.scalable.insert %[[EXTRACTED]], %{{.*}}[0] : vector<4xf32> into vector<[2]xf32>
+// CHECK-RVV-NEXT: %[[CALLED:.*]] = func.call @Sleef_expfx_u10rvvm1(%[[SCALABLE]]) : (vector<[2]xf32>) -> vector<[2]xf32>
+// CHECK-RVV-NEXT: %[[RES:.*]] = vector.scalable.extract %[[CALLED]][0] : vector<4xf32> from vector<[2]xf32>
+// CHECK-RVV-NEXT: %[[INSERTED:.*]] = vector.insert %[[RES]], %{{.*}}[0] : vector<4xf32> into vector<256x4xf32>
+
 module {
   tt.func public @exp_kernel(%arg0: !tt.ptr<f32> {tt.divisibility = 16 : i32} , %arg1: !tt.ptr<f32> {tt.divisibility = 16 : i32} , %arg2: i32 {tt.divisibility = 16 : i32} ) attributes {noinline = false} {
     %c0 = arith.constant 0 : index
@@ -39,3 +48,27 @@ module {
     tt.return
   }
 }
+
+// -----
+
+// RVV builds of Sleef have no fixed-size variants, so vectors narrower than
+// registers are passed to scalable functions as well.
+
+// CHECK-RVV256-LABEL: @small_vec_kernel
+// CHECK-RVV256: %[[SCALABLE:.*]] = vector.scalable.insert %{{.*}}, %{{.*}}[0] : vector<4xf32> into vector<[2]xf32>
+// CHECK-RVV256-NEXT: %[[CALLED:.*]] = func.call @Sleef_expfx_u10rvvm1(%[[SCALABLE]]) : (vector<[2]xf32>) -> vector<[2]xf32>
+// CHECK-RVV256-NEXT: %{{.*}} = vector.scalable.extract %[[CALLED]][0] : vector<4xf32> from vector<[2]xf32>
+// CHECK-RVV256: func.call @Sleef_powfx_u10rvvm1(%{{.*}}, %{{.*}}) : (vector<[2]xf32>, vector<[2]xf32>) -> vector<[2]xf32>
+
+module {
+  tt.func public @small_vec_kernel(%arg0: !tt.ptr<f32> {tt.divisibility = 16 : i32} , %arg1: !tt.ptr<f32> {tt.divisibility = 16 : i32} ) attributes {noinline = false} {
+    %c0 = arith.constant 0 : index
+    %0 = triton_cpu.ptr_to_memref %arg1 : <f32> -> memref<4xf32>
+    %1 = vector.load %0[%c0] : memref<4xf32>, vector<4xf32>
+    %2 = math.exp %1 : vector<4xf32>
+    %3 = triton_cpu.extern_elementwise %2, %1 {pure = true, symbol = "Sleef_powf%(numel)_u10"} : (vector<4xf32>, vector<4xf32>) -> vector<4xf32>
+    %4 = triton_cpu.ptr_to_memref %arg0 : <f32> -> memref<4xf32>
+    vector.store %3, %4[%c0] : memref<4xf32>, vector<4xf32>
+    tt.return
+  }
+}
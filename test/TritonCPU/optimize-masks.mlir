@@ -91,3 +91,103 @@ module {
     tt.return
   }
 }
+
+// -----
+
+// Remove masks of full tiles of a loop over range(0, size // 16) with a size
+// not known to be divisible by 16.
+
+// CHECK-LABEL: @remove_masks_in_floor_div_loop
+// CHECK:       %[[VAL:.+]] = vector.load {{.+}} : memref<16xf32>, vector<16xf32>
+// CHECK:       vector.store %[[VAL]], {{.+}} : memref<16xf32>, vector<16xf32>
+
+module {
+  tt.func public @remove_masks_in_floor_div_loop(%arg0: !tt.ptr<f32> {tt.divisibility = 16 : i32}, %arg1: !tt.ptr<f32> {tt.divisibility = 16 : i32}, %arg2: i32) {
+    %c0 = arith.constant 0 : index
+    %cst = arith.constant dense<[0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15]> : vector<16xi32>
+    %c16_i32 = arith.constant 16 : i32
+    %c0_i32 = arith.constant 0 : i32
+    %c1_i32 = arith.constant 1 : i32
+    %cst_0 = arith.constant dense<0.000000e+00> : vector<16xf32>
+    %0 = arith.divsi %arg2, %c16_i32 : i32
+    %1 = vector.splat %arg2 : vector<16xi32>
+    scf.for %arg3 = %c0_i32 to %0 step %c1_i32  : i32 {
+      %2 = arith.muli %arg3, %c16_i32 : i32
+      %3 = vector.splat %2 : vector<16xi32>
+      %4 = arith.addi %3, %cst : vector<16xi32>
+      %5 = arith.cmpi slt, %4, %1 : vector<16xi32>
+      %6 = tt.addptr %arg0, %2 : !tt.ptr<f32>, i32
+      %7 = triton_cpu.ptr_to_memref %6 : <f32> -> memref<16xf32>
+      %8 = vector.maskedload %7[%c0], %5, %cst_0 : memref<16xf32>, vector<16xi1>, vector<16xf32> into vector<16xf32>
+      %9 = tt.addptr %arg1, %2 : !tt.ptr<f32>, i32
+      %10 = triton_cpu.ptr_to_memref %9 : <f32> -> memref<16xf32>
+      vector.maskedstore %10[%c0], %5, %8 : memref<16xf32>, vector<16xi1>, vector<16xf32>
+    }
+    tt.return
+  }
+}
+
+// -----
+
+// Remove masks proven all-ones by an assumed min size and drop accesses
+// whose masks are proven all-zeros by an assumed max size.
+
+// CHECK-LABEL: @optimize_masks_with_assumes
+// CHECK:       %[[VAL:.+]] = vector.load {{.+}} : memref<16xf32>, vector<16xf32>
+// CHECK:       vector.store %[[VAL]], {{.+}} : memref<16xf32>, vector<16xf32>
+// CHECK-NOT:   vector.maskedload
+// CHECK-NOT:   vector.maskedstore
+// CHECK:       tt.return
+
+module {
+  tt.func public @optimize_masks_with_assumes(%arg0: !tt.ptr<f32> {tt.divisibility = 16 : i32}, %arg1: !tt.ptr<f32> {tt.divisibility = 16 : i32}, %arg2: i32) {
+    %c0 = arith.constant 0 : index
+    %cst = arith.constant dense<[0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15]> : vector<16xi32>
+    %c16_i32 = arith.constant 16 : i32
+    %c32_i32 = arith.constant 32 : i32
+    %cst_0 = arith.constant dense<0.000000e+00> : vector<16xf32>
+    %0 = arith.cmpi sge, %arg2, %c16_i32 : i32
+    %1 = arith.cmpi sle, %arg2, %c32_i32 : i32
+    %2 = arith.andi %0, %1 : i1
+    llvm.intr.assume %2 : i1
+    %3 = vector.splat %arg2 : vector<16xi32>
+    %4 = arith.cmpi slt, %cst, %3 : vector<16xi32>
+    %5 = triton_cpu.ptr_to_memref %arg0 : <f32> -> memref<16xf32>
+    %6 = vector.maskedload %5[%c0], %4, %cst_0 : memref<16xf32>, vector<16xi1>, vector<16xf32> into vector<16xf32>
+    %7 = triton_cpu.ptr_to_memref %arg1 : <f32> -> memref<16xf32>
+    vector.maskedstore %7[%c0], %4, %6 : memref<16xf32>, vector<16xi1>, vector<16xf32>
+    %8 = vector.splat %c32_i32 : vector<16xi32>
+    %9 = arith.addi %8, %cst : vector<16xi32>
+    %10 = arith.cmpi slt, %9, %3 : vector<16xi32>
+    %11 = tt.addptr %arg1, %c32_i32 : !tt.ptr<f32>, i32
+    %12 = triton_cpu.ptr_to_memref %11 : <f32> -> memref<16xf32>
+    vector.maskedstore %12[%c0], %10, %6 : memref<16xf32>, vector<16xi1>, vector<16xf32>
+    tt.return
+  }
+}
+
+// -----
+
+// Keep masks of remainders whose dividend range ends at a multiple of the
+// divisor: x % 8 for x in [1, 16] takes values up to 7, not 16 % 8.
+
+// CHECK-LABEL: @keep_masks_of_remainders
+// CHECK:       vector.maskedload
+// CHECK:       vector.maskedstore
+
+module {
+  tt.func public @keep_masks_of_remainders(%arg0: !tt.ptr<f32> {tt.divisibility = 16 : i32}, %arg1: !tt.ptr<f32> {tt.divisibility = 16 : i32}) {
+    %c0 = arith.constant 0 : index
+    %cst = arith.constant dense<[1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16]> : vector<16xi32>
+    %cst_0 = arith.constant dense<8> : vector<16xi32>
+    %cst_1 = arith.constant dense<1> : vector<16xi32>
+    %cst_2 = arith.constant dense<0.000000e+00> : vector<16xf32>
+    %0 = arith.remui %cst, %cst_0 : vector<16xi32>
+    %1 = arith.cmpi slt, %0, %cst_1 : vector<16xi32>
+    %2 = triton_cpu.ptr_to_memref %arg0 : <f32> -> memref<16xf32>
+    %3 = vector.maskedload %2[%c0], %1, %cst_2 : memref<16xf32>, vector<16xi1>, vector<16xf32> into vector<16xf32>
+    %4 = triton_cpu.ptr_to_memref %arg1 : <f32> -> memref<16xf32>
+    vector.maskedstore %4[%c0], %1, %3 : memref<16xf32>, vector<16xi1>, vector<16xf32>
+    tt.return
+  }
+}
@@ -0,0 +1,72 @@
+"""Huge-page and NUMA-interleaved buffers for kernel inputs, outputs and scratch memory.
+
+Kernels streaming through tensors of hundreds of megabytes miss the TLB on most pages of 4K, which huge pages of 2M
+or 1G avoid. HugePageAllocator follows the allocator protocol of triton.runtime._allocation, so it can be passed to
+triton.set_allocator, and HugePageAllocator.empty allocates torch tensors backed by its buffers:
+
+    allocator = HugePageAllocator("1G", interleave=True)
+    x = allocator.empty((1 << 28, ), dtype=torch.float32)
+
+Buffers come from triton_cpu_alloc of libTritonCPURuntime, which also allocates scratch arenas of kernel threads,
+see TRITON_CPU_SCRATCH_ARENA_PAGE_SIZE. Huge pages are taken from the hugetlbfs pool when it has enough reserved
+pages, e.g. through /proc/sys/vm/nr_hugepages, and are transparent huge pages otherwise.
+"""
+import ctypes
+from typing import Optional
+
+from triton.backends.cpu.driver import CPUUtils, _parse_size
+
+
+class HugePageBuffer:
+    """A buffer allocated by HugePageAllocator, freed when it is garbage collected."""
+
+    def __init__(self, size, page_size, interleave):
+        self._runtime = CPUUtils()._get_runtime()
+        self._ptr = self._runtime.triton_cpu_alloc(size, page_size, interleave)
+        if not self._ptr:
+            raise MemoryError(f"Couldn't allocate {size} bytes with pages of {page_size} bytes")
+        self.size = size
+
+    def data_ptr(self):
+        return self._ptr
+
+    @property
+    def page_size(self):
+        """Size of hugetlbfs pages backing the buffer, or of base pages if it isn't backed by them."""
+        return self._runtime.triton_cpu_alloc_page_size(self._ptr)
+
+    def __del__(self):
+        if getattr(self, "_ptr", None):
+            self._runtime.triton_cpu_free(self._ptr)
+            self._ptr = None
+
+
+class HugePageAllocator:
+    """Allocate buffers backed by pages of page_size, "2M" or "1G" for huge pages or "4K" for base pages.
+
+    With interleave=True, pages are spread round-robin across NUMA nodes, so kernels running on threads of all
+    nodes use the memory bandwidth of all nodes instead of the node that first touched the buffer.
+    """
+
+    def __init__(self, page_size="2M", interleave=False):
+        self.page_size = _parse_size(page_size) if isinstance(page_size, str) else page_size
+        self.interleave = interleave
+
+    def __call__(self, size: int, alignment: int, stream: Optional[int]) -> HugePageBuffer:
+        # Buffers are aligned to pages, which is at least the alignment kernels ask for.
+        return HugePageBuffer(size, self.page_size, self.interleave)
+
+    def empty(self, shape, dtype):
+        """Return a zero-filled torch tensor of the shape and dtype in a buffer of the allocator."""
+        import torch
+        numel = 1
+        for dim in shape:
+            numel *= dim
+        size = numel * torch.empty((), dtype=dtype).element_size()
+        if size == 0:
+            return torch.empty(shape, dtype=dtype)
+        buffer = self(size, 0, None)
+        array = (ctypes.c_char * size).from_address(buffer.data_ptr())
+        # The ctypes array doesn't own the memory, so it keeps the buffer alive for the tensor.
+        array._buffer = buffer
+        return torch.frombuffer(array, dtype=torch.uint8, count=size).view(dtype).view(shape)
@@ -0,0 +1,182 @@
+"""Cache bundles of compiled kernels for fast cold starts, e.g. of containers.
+
+A bundle packs the files of a kernel cache, compiled libraries of kernels and launchers together with their
+metadata, into a single archive for a CPU fingerprint. It is shipped with an application and used instead of
+compiling kernels on first use by setting
+
+    TRITON_CACHE_MANAGER=triton.backends.cpu.cache_bundle:BundleCacheManager
+    TRITON_CPU_CACHE_BUNDLE=/path/to/kernels.bundle
+
+The bundle is mapped on first kernel use and files of a kernel are copied to the local cache when the kernel is
+looked up, so only kernels the process uses are read. Bundles for other CPUs are ignored. preload() copies all
+files on background threads at startup, so kernels used later are found in the local cache.
+
+The archive is the magic, the little-endian 64-bit size of the JSON index and the index, followed by file
+contents aligned to pages. The index holds the fingerprint and the offset and size of each file by its cache key
+and name.
+"""
+import concurrent.futures
+import hashlib
+import json
+import mmap
+import os
+import struct
+import threading
+import warnings
+
+from triton.runtime.cache import FileCacheManager, default_cache_dir
+
+_MAGIC = b"TRITONCPUBUNDLE\0"
+_ALIGN = mmap.PAGESIZE
+
+
+def cpu_fingerprint():
+    """Return the fingerprint of the host CPU and Triton version that compiled kernels depend on."""
+    import triton
+    from triton.backends.cpu.compiler import _get_host_cpu
+    cpu_arch, cpu_name, cpu_features = _get_host_cpu()
+    desc = f"{triton.__version__}-{cpu_arch}-{cpu_name}-{','.join(sorted(cpu_features))}"
+    return hashlib.sha256(desc.encode("utf-8")).hexdigest()
+
+
+def write_bundle(path, cache_dir=None):
+    """Pack the kernel cache, TRITON_CACHE_DIR by default, into a bundle for the host CPU at path."""
+    cache_dir = cache_dir or os.getenv("TRITON_CACHE_DIR", "").strip() or default_cache_dir()
+    files = []
+    for key in sorted(os.listdir(cache_dir)):
+        key_dir = os.path.join(cache_dir, key)
+        if not os.path.isdir(key_dir):
+            continue
+        for filename in sorted(os.listdir(key_dir)):
+            file_path = os.path.join(key_dir, filename)
+            if filename != "lock" and not filename.startswith("tmp.") and os.path.isfile(file_path):
+                files.append((f"{key}/{filename}", file_path))
+
+    # Offsets are relative to the end of the index, whose size depends on them.
+    index = {}
+    offset = 0
+    for name, file_path in files:
+        size = os.path.getsize(file_path)
+        index[name] = [offset, size]
+        offset += -(-size // _ALIGN) * _ALIGN
+    header = json.dumps({"fingerprint": cpu_fingerprint(), "files": index}).encode("utf-8")
+    data_start = -(-(len(_MAGIC) + 8 + len(header)) // _ALIGN) * _ALIGN
+
+    tmp_path = f"{path}.tmp.{os.getpid()}"
+    with open(tmp_path, "wb") as f:
+        f.write(_MAGIC + struct.pack("<Q", len(header)) + header)
+        for name, file_path in files:
+            f.seek(data_start + index[name][0])
+            with open(file_path, "rb") as src:
+                f.write(src.read())
+        f.truncate(data_start + offset)
+    os.replace(tmp_path, path)
+
+
+class CacheBundle:
+    """A bundle mapped into memory, see write_bundle."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self._map = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        if self._map[:len(_MAGIC)] != _MAGIC:
+            raise ValueError(f"{path} is not a kernel cache bundle")
+        header_size, = struct.unpack_from("<Q", self._map, len(_MAGIC))
+        header_start = len(_MAGIC) + 8
+        header = json.loads(self._map[header_start:header_start + header_size])
+        self.path = path
+        self.fingerprint = header["fingerprint"]
+        self.files = header["files"]
+        self._data_start = -(-(header_start + header_size) // _ALIGN) * _ALIGN
+
+    def keys(self):
+        return {name.split("/")[0] for name in self.files}
+
+    def get(self, key, filename):
+        """Return the contents of a file of the cache key, or None if the bundle doesn't have it."""
+        entry = self.files.get(f"{key}/{filename}")
+        if entry is None:
+            return None
+        start = self._data_start + entry[0]
+        return self._map[start:start + entry[1]]
+
+
+_bundles = None
+_bundles_lock = threading.Lock()
+
+
+def get_bundles():
+    """Return the bundles of TRITON_CPU_CACHE_BUNDLE, a list of paths separated by ':', that match the host CPU.
+
+    Bundles are mapped on the first call.
+    """
+    global _bundles
+    with _bundles_lock:
+        if _bundles is None:
+            _bundles = []
+            fingerprint = None
+            for path in filter(None, os.getenv("TRITON_CPU_CACHE_BUNDLE", "").split(":")):
+                try:
+                    bundle = CacheBundle(path)
+                except (OSError, ValueError) as e:
+                    warnings.warn(f"Couldn't load kernel cache bundle {path}: {e}")
+                    continue
+                fingerprint = fingerprint or cpu_fingerprint()
+                if bundle.fingerprint == fingerprint:
+                    _bundles.append(bundle)
+                else:
+                    warnings.warn(f"Kernel cache bundle {path} is for another CPU or Triton version, ignoring it")
+        return _bundles
+
+
+class BundleCacheManager(FileCacheManager):
+    """A file cache manager that copies files missing from the local cache from kernel cache bundles."""
+
+    def get_file(self, filename):
+        path = super().get_file(filename)
+        if path is None:
+            path = self._materialize(filename)
+        return path
+
+    def get_group(self, filename):
+        self.get_file(f"__grp__{filename}")
+        return super().get_group(filename)
+
+    def _materialize(self, filename):
+        for bundle in get_bundles():
+            data = bundle.get(self.key, filename)
+            if data is None:
+                continue
+            if not filename.startswith("__grp__"):
+                return self.put(data, filename)
+            # Groups refer to files by their paths in the cache the bundle was written from.
+            group = json.loads(data)
+            child_paths = {}
+            for child, child_path in group.get("child_paths", {}).items():
+                child_name = os.path.basename(child_path)
+                child_paths[child] = self.get_file(child_name) or self._make_path(child_name)
+            return self.put(json.dumps({"child_paths": child_paths}), filename, binary=False)
+        return None
+
+
+def preload(num_threads=4):
+    """Copy files of all matching bundles missing from the local cache on background threads.
+
+    Return futures of the copies, so startup code can go on and wait for them later, if at all.
+    """
+    keys = set()
+    for bundle in get_bundles():
+        keys |= bundle.keys()
+
+    def load(key):
+        manager = BundleCacheManager(key)
+        for bundle in get_bundles():
+            for name in bundle.files:
+                bundle_key, filename = name.split("/", 1)
+                if bundle_key == key:
+                    manager.get_file(filename)
+
+    executor = concurrent.futures.ThreadPoolExecutor(num_threads, thread_name_prefix="triton-cpu-preload")
+    futures = [executor.submit(load, key) for key in sorted(keys)]
+    executor.shutdown(wait=False)
+    return futures
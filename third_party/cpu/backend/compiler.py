@@ -1,16 +1,23 @@
 import functools
 import hashlib
+import json
+import math
 import os
+import sys
 import tempfile
+import threading
+import time
 from pathlib import Path
 
 from dataclasses import dataclass
 from types import ModuleType
 from typing import Any, Dict, Optional, Tuple
 
-from triton._C.libtriton import cpu, ir, llvm, passes
+from triton._C.libtriton import cpu, get_cache_invalidating_env_vars, ir, llvm, passes
 from triton.backends.compiler import BaseBackend, GPUTarget
 from triton.runtime.build import _build
+from triton.runtime.cache import get_cache_manager
+from triton.runtime.errors import OutOfResources
 import triton.backends.cpu.driver as cpu_driver
 
 
@@ -22,6 +29,120 @@ def min_dot_size(target: GPUTarget):
 VecLib = cpu.passes.ttcpuir.VecLib
 Ukernels = cpu.passes.ttcpuir.Ukernels
 
+_X86_64_V3_FEATURES = {
+    "sse", "sse2", "sse3", "ssse3", "sse4.1", "sse4.2", "popcnt", "avx", "avx2", "fma", "f16c", "bmi", "bmi2",
+    "lzcnt", "movbe"
+}
+_X86_64_V4_FEATURES = _X86_64_V3_FEATURES | {"avx512f", "avx512bw", "avx512cd", "avx512dq", "avx512vl"}
+
+# ISA levels kernels can be compiled for with the isa_variants option, from the worst to the best one
+# of each architecture: (architecture, LLVM target CPU, features). A variant runs on hosts with all of
+# its features, passes are gated on them like on host features.
+ISA_VARIANTS = {
+    "avx2": ("x86_64", "x86-64-v3", _X86_64_V3_FEATURES),
+    "avx512": ("x86_64", "x86-64-v4", _X86_64_V4_FEATURES),
+    "amx": ("x86_64", "sapphirerapids",
+            _X86_64_V4_FEATURES | {"avx512bf16", "avx512vnni", "amx-tile", "amx-int8", "amx-bf16"}),
+    "neon": ("aarch64", "generic", {"neon", "fp-armv8"}),
+    "sve": ("aarch64", "neoverse-v1", {"neon", "fp-armv8", "sve", "bf16", "i8mm", "dotprod"}),
+    "rvv": ("riscv64", "generic-rv64", {"m", "a", "f", "d", "v"}),
+}
+
+# Metadata the shared stages read besides their input IR, see share_stages.
+_SHARED_STAGE_INPUTS = {"llir": ("num_warps", "vector_unroll_limit"), "so": ("name", )}
+
+# Granularity of coherence between cores. Programs storing outputs smaller than a line are split between threads at
+# multiples of the number of programs filling a line, see align_output_lines.
+CACHE_LINE_BYTES = 64
+
+# Target CPUs of the code choosing ISA variants, it must run on any host of the architecture.
+_BASELINE_CPUS = {"x86_64": "x86-64", "aarch64": "generic", "riscv64": "generic-rv64"}
+
+_host_cpu_lock = threading.Lock()
+_host_cpu = None
+
+
+def _get_host_cpu():
+    # A backend is created for every compilation, possibly from several threads when autotuner configs are compiled
+    # in parallel, so the host is queried and AMX is enabled once per process.
+    global _host_cpu
+    with _host_cpu_lock:
+        if _host_cpu is None:
+            cpu_arch = llvm.get_cpu_tripple().split("-")[0]
+            cpu_features = llvm.get_cpu_features()
+            if 'amx-tile' in cpu_features and not cpu.enable_amx():
+                import warnings
+                warnings.warn("Warning! Couldn't enable AMX for the process. AMX optimizations are disabled.")
+                cpu_features -= {'amx-tile', 'amx-int8', 'amx-fp16', 'amx-bf16', 'amx-fp8'}
+            if cpu_arch.startswith("riscv") and 'v' in cpu_features:
+                # Host features of RISC-V don't include the size of RVV registers, which is added as the
+                # zvl<VLEN>b feature, so LLVM lowers fixed vectors to whole registers.
+                cpu_features.add(f"zvl{cpu.get_rvv_vector_bits()}b")
+            _host_cpu = (cpu_arch, llvm.get_cpu_name(), frozenset(cpu_features))
+        return _host_cpu
+
+
+def _get_sve_vector_bits():
+    # Size of SVE registers of the process, or 0 if it's unknown.
+    try:
+        import ctypes
+        vl = ctypes.CDLL(None).prctl(51, 0, 0, 0, 0)  # PR_SVE_GET_VL
+    except (OSError, AttributeError):
+        return 0
+    return (vl & 0xffff) * 8 if vl > 0 else 0
+
+
+def _get_rvv_vector_bits(cpu_features):
+    # Size of RVV registers guaranteed by zvl<N>b features, or 0 without the V extension.
+    if 'v' not in cpu_features:
+        return 0
+    sizes = [int(f[3:-1]) for f in cpu_features if f.startswith("zvl") and f.endswith("b") and f[3:-1].isdigit()]
+    # The V extension implies registers of at least 128 bits.
+    return max(sizes + [128])
+
+
+def _run_passes(pm, mod, metadata, options):
+    if not options.profile_compile:
+        pm.run(mod)
+        return
+    pass_profile = cpu.add_pass_profile(pm)
+    pm.run(mod)
+    profile = metadata["compile_profile"]
+    # Passes are attributed to the running stage, e.g. all passes of ISA variants belong to llir.
+    stage = profile["stages"][-1][0]
+    profile["passes"].extend([stage, name, ms, ops] for name, ms, ops in pass_profile.records())
+
+
+def _record_machine_stats(stats, metadata):
+    # Report the codegen stats of the kernel like n_spills of GPU kernels, e.g. for prune functions of the
+    # autotuner. Entry points and ISA variants of the kernel are named after it, and the largest values of
+    # them are reported.
+    name = metadata["name"]
+    kernel_stats = [fn_stats for fn, fn_stats in stats.items() if fn.startswith(name)]
+    for key in ("stack_size", "n_spills", "n_reloads", "n_instructions", "code_size"):
+        metadata[key] = max((fn_stats[key] for fn_stats in kernel_stats), default=0)
+
+
+def _record_step(name, start, ops, metadata, options):
+    # Record a step of a stage that isn't an MLIR pass, e.g. LLVM optimization. ops is the number of
+    # LLVM instructions after the step, or None if it doesn't produce IR.
+    if options.profile_compile:
+        profile = metadata["compile_profile"]
+        profile["passes"].append([profile["stages"][-1][0], name, (time.perf_counter() - start) * 1e3, ops])
+
+
+def format_compile_profile(profile):
+    # Format the compile_profile metadata of a kernel as a table of passes with per-stage totals. The
+    # total time of a stage also includes the time spent between passes, e.g. on printing IR.
+    lines = [f"{'stage':<8} {'pass':<40} {'time (ms)':>10} {'ops':>10}"]
+    for stage, stage_ms in profile["stages"]:
+        for pass_stage, name, ms, ops in profile["passes"]:
+            if pass_stage == stage:
+                lines.append(f"{stage:<8} {name:<40} {ms:>10.2f} {'-' if ops is None else ops:>10}")
+        lines.append(f"{stage:<8} {'total':<40} {stage_ms:>10.2f}")
+    lines.append(f"{'':<8} {'total':<40} {sum(ms for _, ms in profile['stages']):>10.2f}")
+    return "\n".join(lines)
+
 
 @dataclass(frozen=True)
 class CPUOptions:
@@ -30,12 +151,83 @@ class CPUOptions:
     backend_name: str = "cpu"
     # These options provide compatibility with GPU kernel calls.
     # All of them are ignored.
+    num_ctas: int = 0
+    # Size of the team of threads the work of a program can be split between, so kernels with few large programs
+    # tuned for GPUs scale with threads. It is the default of split_k: programs accumulating dots or sums of tiles in a
+    # loop are split between up to num_warps threads, but only in launches with fewer programs than threads. Launches
+    # filling all threads run as before.
     num_warps: int = 0
+    # Number of software pipeline stages of loops computing dots. Loads of
+    # operands are issued num_stages - 1 iterations ahead, values below 2
+    # disable pipelining.
     num_stages: int = 0
-    num_ctas: int = 0
     # Max number of threads to be used for a kernel call.
     # Zero value is used to utilize all available CPU cores.
     num_threads: int = 0
+    # With num_threads=0, choose the number of threads of each launch from the
+    # grid size, so that every thread gets enough work to amortize waking it
+    # up. The program cost is program_cost_ns if it is positive, otherwise it
+    # is measured on previous launches of the kernel.
+    adaptive_num_threads: bool = True
+    program_cost_ns: int = 0
+    # Threading runtime used by the launcher to run kernel programs in parallel:
+    # "pool" uses the persistent thread pool of libTritonCPURuntime,
+    # "omp" uses OpenMP parallel regions.
+    launch_runtime: str = "pool"
+    # Launches submitted concurrently from several threads share a single
+    # thread budget. When it is exhausted, launches with a higher priority
+    # get threads first.
+    launch_priority: int = 0
+    # Distribution of kernel programs between threads:
+    # "static" gives each thread a single contiguous range of programs,
+    # "steal" lets threads that finished their range steal work from others.
+    schedule: str = "static"
+    # Split programs between threads at multiples of the number of programs whose outputs fill a cache line,
+    # when each program stores less than a line outside of loops, e.g. a scalar per row of a reduction. Neighbouring
+    # outputs are then written by a single core instead of bouncing their line between cores. Only applies to the
+    # linear program order.
+    align_output_lines: bool = True
+    # Order in which programs are traversed:
+    # "linear" iterates over X first, then Y, then Z,
+    # "tiled" iterates over bands of program_tile_size Y rows, column by column
+    # within a band, so that programs sharing operand tiles run close in time,
+    # "hilbert" follows a generalized Hilbert curve over each XY plane, which
+    # keeps both X and Y ids of consecutive programs close at any tile size.
+    program_order: str = "linear"
+    program_tile_size: int = 8
+    # Bind pool workers to NUMA nodes and split the grid between nodes in
+    # contiguous ranges. When numa_placement_arg is an index of a pointer
+    # argument, the launch runs on the node holding that argument.
+    # Ignored by the OpenMP runtime.
+    numa: bool = False
+    numa_placement_arg: int = -1
+    # Restrict pool workers to a set of cores given in the Linux cpulist
+    # format, e.g. "0-7,16". Kernels then run on these cores only.
+    cpu_mask: Optional[str] = None
+    # Pinning of pool workers to the selected cores: None leaves workers
+    # unpinned within the core set, "compact" fills cores and sockets one by
+    # one, "scatter" spreads workers across sockets and cores.
+    thread_placement: Optional[str] = None
+    # Use a single hardware thread of each physical core.
+    one_thread_per_core: bool = False
+    # Restrict pool workers to "performance" or "efficiency" cores of hybrid
+    # CPUs, e.g. to run latency-critical kernels on P-cores only. On CPUs
+    # that aren't hybrid, all cores are performance cores. When workers are
+    # pinned to cores of different types by thread_placement, the static
+    # schedule gives faster cores proportionally more programs.
+    core_type: Optional[str] = None
+    # Run persistent kernels, which loop over tiles with a stride of tl.num_programs(0), with one
+    # program per worker thread. The launch grid is replaced with (workers, 1, 1), where workers is
+    # num_threads or the size of the thread pool (multiprocessor_count of device properties), and
+    # programs are statically given one per worker, so the tile loop of the kernel controls the order
+    # of tiles instead of the launch schedule.
+    persistent: bool = False
+    # Run the grid in this many consecutive slices of programs, e.g. over memory-mapped inputs larger than RAM.
+    # All threads work on the same slice while a helper thread reads ahead the matching byte range of pointer
+    # arguments for the next slice and marks ranges of finished slices to be reclaimed first, so pages are read
+    # sequentially instead of being faulted in at random offsets. Assumes programs traverse arguments linearly,
+    # as elementwise and row-reduction kernels do. Zero or one runs the grid at once.
+    out_of_core_slices: int = 0
     cluster_dims: tuple = (1, 1, 1)
     extern_libs: dict = None
     debug: bool = False
@@ -48,15 +240,197 @@ class CPUOptions:
     launch_cooperative_grid: bool = False
     max_num_imprecise_acc_default: int = 0
     enable_fast_math: bool = True
+    # Flush denormal results to zero and treat denormal inputs as zero, i.e. set FTZ and DAZ of MXCSR on x86
+    # and FZ of FPCR on AArch64, on each thread while it runs programs of the kernel, and restore its previous
+    # mode afterwards. Operations on denormals otherwise take microcode assists that can slow kernels down by
+    # 10-100x. Defaults to enable_fast_math.
+    flush_denormals: Optional[bool] = None
     vec_lib: Optional[str] = 'libsleef'
+    # Expand FP32 exp, log, tanh and other transcendental functions with polynomial approximations
+    # to inline code instead of calling vec_lib functions. Inline expansions are within a few ULPs
+    # instead of 1 ULP of Sleef, but are fused with surrounding code, e.g. exp of softmax loops, and
+    # don't spill registers around calls. Sigmoid is expanded through exp.
+    inline_math: bool = False
+    # LLVM bitcode libraries linked into kernels before optimization, e.g. Sleef built with
+    # SLEEF_ENABLE_LLVM_BITCODE or runtime helpers compiled with clang -emit-llvm. Only functions
+    # used by kernels are linked in and they become internal, so LLVM inlines and specializes them
+    # in hot loops instead of calling into shared libraries. Kernels are cached by paths, not by
+    # contents of the libraries.
+    bitcode_libs: Optional[Tuple[str]] = None
     # TODO: Try to enable it.
     sanitize_overflow: bool = False
 
     # TODO: We may introduce CPU-specific options like # of cores.
     ukernels: str = None
+    # Compile the kernel for several ISA levels from ISA_VARIANTS instead of the host CPU. Variants
+    # are packed into a single library, which selects the best one supported by the host on load.
+    isa_variants: Optional[Tuple[str]] = None
+    # Prefetch blocks loaded in loops from block pointers or tensors of pointers advanced by a
+    # loop-invariant step, e.g. operand tiles of GEMM K-loops, this number of iterations before
+    # they are loaded. Zero disables prefetching ahead. Cache hints of loads pick the cache levels of
+    # prefetches: loads with eviction_policy="evict_first" or cache_modifier=".cs" are streamed through
+    # non-temporal prefetches, which they also use with a zero distance, and ".cg" loads skip L1.
+    prefetch_distance: int = 0
+    # Max number of 1-D vectors a vector transfer is fully unrolled into when it is lowered. Larger
+    # transfers, e.g. loads of 128x128 blocks, keep loops over their outer dimensions instead, which
+    # trades some speed for code size and compile time. Zero unrolls all transfers.
+    vector_unroll_limit: int = 0
+    # Max number of operations blocks of a kernel are estimated to be unrolled into before it is lowered,
+    # which bounds compile time and memory of huge blocks, e.g. of a bad autotuner config. Kernels above it
+    # lower vector transfers to loops, see vector_unroll_limit, and kernels whose atomics, histograms or
+    # prints alone are above it, which have no loop lowerings, fail with OutOfResources, so that autotuning
+    # skips their configs. Zero disables the limit.
+    max_unrolled_ops: int = 1 << 18
+    # Width in bits of the widest vectors kernels are compiled to, 128, 256 or 512, which caps vector math
+    # functions, FMA dot blocking and LLVM vector widths. E.g. 256 keeps AVX-512 cores from dropping their
+    # frequency for heavy 512-bit code, which often costs mixed workloads more than narrower vectors. Zero
+    # uses the widest vector registers of the target.
+    prefer_vector_width: int = 0
+    # Choose how loads and stores of tensors of pointers that aren't contiguous are lowered, i.e. to
+    # gathers and scatters, scalar accesses or strided vector accesses with shuffles, using a cost model
+    # of the host CPU. When disabled, gathers and scatters are always used where possible.
+    memory_access_cost_model: bool = True
+    # Version masked loads and stores outside of loops, e.g. of programs over offs < n for offs of
+    # pid * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE), into unmasked accesses of full tiles and masked ones of
+    # the tail tile. Integer arguments are only specialized on their divisibility, so kernels run unmasked
+    # code for most programs of any size without compiling a variant per shape.
+    version_masked_tiles: bool = True
+    # Max number of independent accumulators of loop-carried reductions, e.g. acc += x of row sums over
+    # chunks, which are combined after the loop. Each accumulator takes an unrolled iteration of the loop,
+    # so reductions aren't bound by the latency of their ops. FP sums and products are only split with
+    # enable_fast_math or reassociation allowed by their ops. Values below 2 disable the splitting.
+    reduction_accumulators: int = 4
+    # Compute offsets of pointers to tensors of less than 2GB in 32 bits, e.g. pid * BLOCK + tl.arange
+    # offsets promoted to int64 or int64 gather indices, so that index math takes half the vector
+    # registers and gathers use 32-bit indices. Offsets that would leave the tensor are undefined
+    # anyway, so narrowing them is exact for valid accesses.
+    narrow_offsets: bool = True
+    # Compile at a low-cost tier, LLVM O1 without loop unrolling, interleaving and the SLP vectorizer,
+    # which the autotuner uses to rank configs before it recompiles and benchmarks the best ones in full,
+    # see CPUDriver.get_fast_compile_options. Kernels compiled this way run slower than O3 ones.
+    fast_compile: bool = False
+    # Kernel stack buffers of at least this many bytes, e.g. temporary buffers of large blocks, are
+    # taken from a huge-page backed scratch arena of the executing thread instead of its stack, see
+    # triton_cpu_scratch_arena. Zero keeps all buffers on the stack.
+    scratch_arena_min_size: int = 65536
+    # Unmasked copies and fills of contiguous blocks of at least this many bytes, e.g. of pure copy, concat
+    # or zero-init kernels, call runtime routines that move memory with rep movsb, memset or non-temporal
+    # stores chosen by the size, instead of a chain of vector loads and stores. Copies with dtype
+    # conversions keep vector code. Zero disables the conversion.
+    bulk_memory_min_size: int = 4096
+    # Back off between attempts of spin loops on tl.atomic_cas, e.g. locks of split reductions: threads pause
+    # for exponentially more cycles after each failed attempt and then sleep in short waits until the lock
+    # looks free, instead of saturating the interconnect with retried atomics, see triton_cpu_spin_wait.
+    spin_backoff: bool = True
+    # Copy dot operand tiles that are reused by loops but read with non-contiguous or cache-conflicting
+    # rows, e.g. tiles of transposed matrices, into contiguous buffers once before the loops.
+    pack_dot_operands: bool = True
+    # Accumulator blocking of dots lowered to AMX as (M, N) numbers of 16x16 accumulator tiles, and of
+    # dots lowered to FMAs as (rows, vectors per row). Blocks are kept on tile or vector registers
+    # while K is reduced. None chooses them with a built-in cost model, so these are only needed when
+    # searched by the autotuner. AMX blocks that don't fit tile registers are ignored.
+    amx_acc_block: Optional[Tuple[int, int]] = None
+    fma_acc_block: Optional[Tuple[int, int]] = None
+    # Max number of programs the K loop of a dot or sum kernel is split between when its grid has fewer
+    # programs than threads. The launcher picks the number of splits of each launch from the grid
+    # size and the number of threads, and the last split of each output tile reduces partial
+    # accumulators and runs the rest of the kernel. One disables splitting.
+    split_k: int = 1
+    # Run whole launches of kernels that are recognizably a plain tiled GEMM, like the tutorial matmul with
+    # pointer tiles, as a single oneDNN matmul, which does its own threading, packing and blocking, instead
+    # of the launch grid. Kernels may convert the accumulator to the type of C or apply a ReLU before the
+    # store. Launches whose grid doesn't have a program per output tile, and all launches when oneDNN
+    # isn't available, run the compiled kernel. Offloaded launches ignore threading options.
+    gemm_offload: bool = False
+    # Skip loads and dots of blocks masked off as a whole by scalar flags, e.g. empty blocks of block-sparse
+    # operands selected by a block mask. Skipped dots are under conditions, so AMX and FMA lowerings keep their
+    # accumulators in memory instead of registers between iterations, which only pays off for sparse operands.
+    skip_empty_dots: bool = False
+    # Accumulate atomic adds to scalar pointer arguments, e.g. grid-level sums, into per-thread
+    # partials that the launcher adds to the targets after the launch, instead of contending for
+    # the target line. Targets may only be updated by such atomics with unused results, whose
+    # ordering guarantees are relaxed, see the DeferScalarAtomics pass.
+    defer_scalar_atomics: bool = False
+    # Make results bitwise reproducible regardless of num_threads and the schedule. Scalar atomic sums
+    # are deferred like with defer_scalar_atomics, but to a slot per program, which the launcher adds up
+    # in program id order after the launch, and split_k picks the number of splits from the grid only.
+    # Kernels with other float atomic adds, whose sums depend on the order programs run in, run on a
+    # single thread. Can't be combined with persistent, whose grid is the number of threads.
+    deterministic: bool = False
+    # Mark pointer arguments noalias, like restrict in C, so LLVM can hoist and reorder loads and stores
+    # through different arguments, e.g. in K loops. The launcher checks that tensors passed to pointer
+    # arguments don't overlap and refuses to launch otherwise, also when overlapping tensors are only read.
+    noalias: bool = False
+    # Share the llir and so stages of specializations compiled to the same IR, e.g. whose constexprs are unused
+    # or whose divisibility hints don't change any access. Results of the stages are cached by the hash of their
+    # input IR, so such specializations are lowered and linked once and load the same library. Stages of kernels
+    # compiled with profile_compile or TRITON_ALWAYS_COMPILE aren't shared.
+    share_stages: bool = True
+    # Record wall time and IR size of each pass and stage into the compile_profile metadata and print
+    # them as a table when the kernel is compiled, see format_compile_profile.
+    profile_compile: bool = False
+    # Profile-guided optimization of hot kernels. With pgo_warmup set, kernels are first compiled with
+    # counters of executed blocks, and the launcher recompiles them with a profile of the counters after
+    # this many launches, which drives branch layout, inlining and unrolling of masked and branchy code.
+    # Profiles are cached, so kernels are only profiled once, see _PGOProfiler. pgo_profile is the path of
+    # the profile kernels are compiled with, which is set by the launcher.
+    pgo_warmup: int = 0
+    pgo_profile: Optional[str] = None
 
     def __post_init__(self):
-        pass
+        if self.launch_runtime not in ("pool", "omp"):
+            raise ValueError(f"Unexpected value for launch_runtime: {self.launch_runtime}, should be one of {{pool, omp}}")
+        if self.schedule not in ("static", "steal"):
+            raise ValueError(f"Unexpected value for schedule: {self.schedule}, should be one of {{static, steal}}")
+        if self.program_order not in ("linear", "tiled", "hilbert"):
+            raise ValueError(
+                f"Unexpected value for program_order: {self.program_order}, should be one of {{linear, tiled, hilbert}}")
+        if self.thread_placement not in (None, "compact", "scatter"):
+            raise ValueError(
+                f"Unexpected value for thread_placement: {self.thread_placement}, should be one of {{compact, scatter}}")
+        if self.core_type not in (None, "performance", "efficiency"):
+            raise ValueError(
+                f"Unexpected value for core_type: {self.core_type}, should be one of {{performance, efficiency}}")
+        if self.program_cost_ns < 0:
+            raise ValueError(f"program_cost_ns should be non-negative, got {self.program_cost_ns}")
+        if self.prefetch_distance < 0:
+            raise ValueError(f"prefetch_distance should be non-negative, got {self.prefetch_distance}")
+        if self.vector_unroll_limit < 0:
+            raise ValueError(f"vector_unroll_limit should be non-negative, got {self.vector_unroll_limit}")
+        if self.max_unrolled_ops < 0:
+            raise ValueError(f"max_unrolled_ops should be non-negative, got {self.max_unrolled_ops}")
+        if self.prefer_vector_width not in (0, 128, 256, 512):
+            raise ValueError(f"Unexpected value for prefer_vector_width: {self.prefer_vector_width}, "
+                             "should be one of {0, 128, 256, 512}")
+        if self.scratch_arena_min_size < 0:
+            raise ValueError(f"scratch_arena_min_size should be non-negative, got {self.scratch_arena_min_size}")
+        if self.bulk_memory_min_size < 0:
+            raise ValueError(f"bulk_memory_min_size should be non-negative, got {self.bulk_memory_min_size}")
+        if self.out_of_core_slices < 0:
+            raise ValueError(f"out_of_core_slices should be non-negative, got {self.out_of_core_slices}")
+        if self.split_k <= 0:
+            raise ValueError(f"split_k should be positive, got {self.split_k}")
+        if self.program_tile_size <= 0:
+            raise ValueError(f"program_tile_size should be positive, got {self.program_tile_size}")
+        if self.deterministic and self.persistent:
+            raise ValueError("deterministic can't be used with persistent")
+        if self.pgo_warmup < 0:
+            raise ValueError(f"pgo_warmup should be non-negative, got {self.pgo_warmup}")
+        if (self.pgo_warmup or self.pgo_profile) and self.isa_variants:
+            raise ValueError("pgo_warmup and pgo_profile can't be used with isa_variants")
+        if self.pgo_profile is not None and not os.path.isfile(self.pgo_profile):
+            raise ValueError(f"Profile {self.pgo_profile} doesn't exist")
+        for name in ("amx_acc_block", "fma_acc_block"):
+            block = getattr(self, name)
+            if block is not None and (len(block) != 2 or any(size <= 0 for size in block)):
+                raise ValueError(f"{name} should be a pair of positive sizes, got {block}")
+        for path in self.bitcode_libs or ():
+            if not os.path.isfile(path):
+                raise ValueError(f"Bitcode library {path} doesn't exist")
+        for isa in self.isa_variants or ():
+            if isa not in ISA_VARIANTS:
+                raise ValueError(
+                    f"Unexpected value in isa_variants: {isa}, should be one of {{{', '.join(ISA_VARIANTS)}}}")
 
     def hash(self):
         hash_dict = dict(self.__dict__)
@@ -115,22 +489,105 @@ class CPUBackend(BaseBackend):
     def __init__(self, target: tuple) -> None:
         super().__init__(target)
         self.binary_ext = "so"
-        self.cpu_arch = llvm.get_cpu_tripple().split("-")[0]
-        self.cpu_name = llvm.get_cpu_name()
-        self.cpu_features = llvm.get_cpu_features()
-        if 'amx-tile' in self.cpu_features:
-            if not cpu.enable_amx():
-                import warnings
-                warnings.warn("Warning! Couldn't enable AMX for the process. AMX optimizations are disabled.")
-                self.cpu_features.discard('amx-tile')
-                self.cpu_features.discard('amx-int8')
-                self.cpu_features.discard('amx-fp16')
-                self.cpu_features.discard('amx-bf16')
+        # Stages only read the backend state, so a backend can compile several kernels concurrently.
+        self.cpu_arch, self.cpu_name, self.cpu_features = _get_host_cpu()
+        self.sve_bits = _get_sve_vector_bits() if 'sve' in self.cpu_features else 0
+
+    # Divisibility levels specialized for integer arguments and pointer addresses, the largest first. 64-byte
+    # aligned pointers let AVX512 loads and stores of whole blocks use aligned cache lines, and sizes divisible
+    # by common block sizes let OptimizeMasks remove masks of full blocks. Stride arguments equal to 1 are
+    # already specialized as constants by the frontend.
+    INT_DIVISIBILITY = (256, 64, 16)
+    PTR_DIVISIBILITY = (64, 16)
+
+    @staticmethod
+    def parse_attr(desc):
+        assert isinstance(desc, str)
+        # "D" is 16 as on GPUs, larger divisibilities are encoded as "D<n>". Pointers to tensors of less
+        # than 2GB are suffixed by "S", as on AMD, which lets NarrowOffsets compute their offsets in 32 bits.
+        ret = []
+        if "S" in desc:
+            ret.append(["tt.pointer_range", 32])
+            desc = desc.replace("S", "")
+        if desc.startswith("D"):
+            ret.append(["tt.divisibility", int(desc[1:] or 16)])
+        return ret
+
+    @staticmethod
+    def is_within_2gb(arg):
+        storage = getattr(arg, "untyped_storage", None)
+        return storage is not None and storage().nbytes() <= 2**31 - 1
+
+    @staticmethod
+    def get_arg_specialization(arg, ty, **kwargs):
+        if not kwargs.get("align", False):
+            return ""
+        if ty == "int":
+            value, levels = arg, CPUBackend.INT_DIVISIBILITY
+        elif ty == "tensor":
+            value, levels = arg.data_ptr(), CPUBackend.PTR_DIVISIBILITY
+        else:
+            return ""
+        spec = ""
+        for level in levels:
+            if value % level == 0:
+                spec = "D" if level == 16 else f"D{level}"
+                break
+        if ty == "tensor" and CPUBackend.is_within_2gb(arg):
+            spec += "S"
+        return spec
 
     def parse_options(self, opts) -> Any:
         args = {k: opts[k] for k in CPUOptions.__dataclass_fields__.keys() if k in opts}
         if "enable_fast_math" not in args:
             args["enable_fast_math"] = os.getenv("TRITON_CPU_FAST_MATH", "1") != "0"
+        if args.get("flush_denormals") is None:
+            default = "1" if args["enable_fast_math"] else "0"
+            args["flush_denormals"] = os.getenv("TRITON_CPU_FLUSH_DENORMALS", default) != "0"
+        if "launch_runtime" not in args:
+            args["launch_runtime"] = os.getenv("TRITON_CPU_LAUNCH_RUNTIME", "pool")
+        if "prefetch_distance" not in args:
+            args["prefetch_distance"] = int(os.getenv("TRITON_CPU_PREFETCH_DISTANCE", "0"))
+        if "vector_unroll_limit" not in args:
+            args["vector_unroll_limit"] = int(os.getenv("TRITON_CPU_VECTOR_UNROLL_LIMIT", "0"))
+        if "max_unrolled_ops" not in args:
+            args["max_unrolled_ops"] = int(os.getenv("TRITON_CPU_MAX_UNROLLED_OPS", str(1 << 18)))
+        if "prefer_vector_width" not in args:
+            args["prefer_vector_width"] = int(os.getenv("TRITON_CPU_PREFER_VECTOR_WIDTH", "0"))
+        if "memory_access_cost_model" not in args:
+            args["memory_access_cost_model"] = os.getenv("TRITON_CPU_MEMORY_ACCESS_COST_MODEL", "1") != "0"
+        if "version_masked_tiles" not in args:
+            args["version_masked_tiles"] = os.getenv("TRITON_CPU_VERSION_MASKED_TILES", "1") != "0"
+        if "reduction_accumulators" not in args:
+            args["reduction_accumulators"] = int(os.getenv("TRITON_CPU_REDUCTION_ACCUMULATORS", "4"))
+        if "narrow_offsets" not in args:
+            args["narrow_offsets"] = os.getenv("TRITON_CPU_NARROW_OFFSETS", "1") != "0"
+        if "scratch_arena_min_size" not in args:
+            args["scratch_arena_min_size"] = int(os.getenv("TRITON_CPU_SCRATCH_ARENA_MIN_SIZE", "65536"))
+        if "bulk_memory_min_size" not in args:
+            args["bulk_memory_min_size"] = int(os.getenv("TRITON_CPU_BULK_MEMORY_MIN_SIZE", "4096"))
+        if "bitcode_libs" not in args and (bitcode_libs := os.getenv("TRITON_CPU_BITCODE_LIBS")):
+            args["bitcode_libs"] = bitcode_libs.split(os.pathsep)
+        if args.get("bitcode_libs"):
+            args["bitcode_libs"] = tuple(args["bitcode_libs"])
+        if "inline_math" not in args:
+            args["inline_math"] = os.getenv("TRITON_CPU_INLINE_MATH", "0") != "0"
+        if "pack_dot_operands" not in args:
+            args["pack_dot_operands"] = os.getenv("TRITON_CPU_PACK_DOT_OPERANDS", "1") != "0"
+        if "split_k" not in args and args.get("num_warps", 0) > 1:
+            args["split_k"] = args["num_warps"]
+        if "noalias" not in args:
+            args["noalias"] = os.getenv("TRITON_CPU_NOALIAS", "0") == "1"
+        if "profile_compile" not in args:
+            args["profile_compile"] = os.getenv("TRITON_CPU_PROFILE_COMPILE", "0") == "1"
+        if "pgo_warmup" not in args:
+            args["pgo_warmup"] = int(os.getenv("TRITON_CPU_PGO_WARMUP", "0"))
+        if "isa_variants" not in args and (isa_variants := os.getenv("TRITON_CPU_ISA_VARIANTS")):
+            args["isa_variants"] = isa_variants.split(",")
+        if args.get("isa_variants"):
+            # Keep options hashable and independent of the order of variants.
+            order = list(ISA_VARIANTS)
+            args["isa_variants"] = tuple(sorted(set(args["isa_variants"]), key=order.index))
         if "supported_fp8_dtypes" not in args:
             supported_fp8_dtypes = set(CPUOptions.supported_fp8_dtypes)
             args["supported_fp8_dtypes"] = tuple(sorted(supported_fp8_dtypes))
@@ -162,21 +619,45 @@ class CPUBackend(BaseBackend):
         passes.common.add_cse(pm)
         passes.common.add_licm(pm)
         passes.common.add_symbol_dce(pm)
-        pm.run(mod)
+        _run_passes(pm, mod, metadata, opt)
         return mod
 
-    @staticmethod
-    def make_ttcir(mod, metadata, opt):
+    def make_ttcir(self, mod, metadata, opt):
         # TTIR -> TTCIR
+        metadata["vector_unroll_limit"] = self._check_unrolled_size(mod, opt)
         pm = ir.pass_manager(mod.context)
         pm.enable_debug()
-        cpu.passes.ttcpuir.add_scalarize(pm, True)
-        cpu.passes.ttcpuir.add_convert_memory_ops(pm, True)
+        if opt.gemm_offload and cpu.onednn_available():
+            cpu.passes.ttcpuir.add_match_gemm_kernels(pm)
+        cpu.passes.ttcpuir.add_decompose_scaled_dot(pm)
+        cpu.passes.ttcpuir.add_forward_stores(pm, opt.noalias)
+        # Selects are folded into unmasked stores only on targets with masked stores, others scalarize them.
+        cpu.passes.ttcpuir.add_fold_selects(pm, self._memory_access_target(opt)[3])
+        if opt.split_k > 1:
+            cpu.passes.ttcpuir.add_split_k(pm)
+        if opt.defer_scalar_atomics or opt.deterministic:
+            cpu.passes.ttcpuir.add_defer_scalar_atomics(pm, opt.deterministic)
+        if opt.skip_empty_dots:
+            cpu.passes.ttcpuir.add_skip_empty_dots(pm)
+        if opt.narrow_offsets:
+            cpu.passes.ttcpuir.add_narrow_offsets(pm)
+        cpu.passes.ttcpuir.add_insert_prefetches(pm, opt.prefetch_distance)
+        cpu.passes.ttcpuir.add_carry_ptr_offsets(pm)
+        if opt.memory_access_cost_model:
+            # TTCIR is shared by ISA variants, so the cost model always describes the host CPU.
+            vector_bytes, native_gather, native_scatter, native_masked_store = self._memory_access_target(opt)
+            cpu.passes.ttcpuir.add_scalarize_cost_model(pm, True, vector_bytes, native_gather, native_scatter)
+            cpu.passes.ttcpuir.add_convert_memory_ops_cost_model(pm, True, vector_bytes, native_gather, native_scatter,
+                                                                 native_masked_store)
+        else:
+            cpu.passes.ttcpuir.add_scalarize(pm, True)
+            cpu.passes.ttcpuir.add_convert_memory_ops(pm, True)
         cpu.passes.ttcpuir.add_convert_ptr_ops(pm)
         cpu.passes.ttcpuir.add_convert_elementwise_ops(pm)
         cpu.passes.ttcpuir.add_convert_elem_manip_ops(pm)
         cpu.passes.ttcpuir.add_convert_dot_op(pm)
         cpu.passes.ttcpuir.add_convert_histogram_op(pm)
+        cpu.passes.ttcpuir.add_convert_gather_op(pm)
         cpu.passes.ttcpuir.add_convert_reduction_op(pm, True, False)
         cpu.passes.ttcpuir.add_convert_scan_op(pm)
         cpu.passes.ttcpuir.add_convert_cf_ops(pm)
@@ -185,17 +666,75 @@ class CPUBackend(BaseBackend):
         passes.common.add_cse(pm)
         passes.common.add_symbol_dce(pm)
         passes.common.add_canonicalizer(pm)
-        pm.run(mod)
+        _run_passes(pm, mod, metadata, opt)
         metadata["cluster_dims"] = (opt.cluster_dims[0], opt.cluster_dims[1], opt.cluster_dims[2])
+        metadata["split_k_slot_size"] = mod.get_int_attr("triton_cpu.split_k_slot_size") or 0
+        metadata["thread_partials"] = mod.get_str_attr("triton_cpu.thread_partials") or ""
+        metadata["gemm"] = mod.get_str_attr("triton_cpu.gemm") or ""
+        if opt.deterministic and mod.get_bool_attr("triton_cpu.unordered_atomics"):
+            metadata["num_threads"] = 1
         return mod
 
-    def make_tttcir(self, mod, metadata, opt):
+    # Max number of 1-D vectors transfers are unrolled into by kernels above max_unrolled_ops.
+    FALLBACK_VECTOR_UNROLL_LIMIT = 16
+
+    def _check_unrolled_size(self, mod, opt):
+        # Return the vector_unroll_limit to lower the kernel with, or raise OutOfResources if blocks of the
+        # kernel are too large to be compiled.
+        if not opt.max_unrolled_ops:
+            return opt.vector_unroll_limit
+        size = cpu.estimate_unrolled_size(mod, self._vector_bits(self.cpu_features, opt.prefer_vector_width))
+        if size["element_ops"] > opt.max_unrolled_ops:
+            raise OutOfResources(size["element_ops"], opt.max_unrolled_ops,
+                                 "unrolled elements of atomics, histograms and prints (max_unrolled_ops)")
+        if size["vector_ops"] + size["element_ops"] > opt.max_unrolled_ops and not opt.vector_unroll_limit:
+            return self.FALLBACK_VECTOR_UNROLL_LIMIT
+        return opt.vector_unroll_limit
+
+    @staticmethod
+    def _vector_bits(cpu_features, prefer_vector_width=0):
+        # Width of the widest vector registers, or of the preferred vectors if they are narrower.
+        if 'avx512f' in cpu_features:
+            bits = 512
+        elif 'avx' in cpu_features:
+            bits = 256
+        elif 'v' in cpu_features:
+            bits = _get_rvv_vector_bits(cpu_features)
+        else:
+            bits = 128
+        return min(bits, prefer_vector_width) if prefer_vector_width else bits
+
+    def _memory_access_target(self, opt):
+        # Vector register size in bytes and support of hardware gathers, scatters and masked stores.
+        features = self.cpu_features
+        vector_bytes = self._vector_bits(features, opt.prefer_vector_width) // 8
+        # SVE and RVV have gathers, scatters and masked stores of any vector.
+        scalable = 'sve' in features or 'v' in features
+        native_gather = 'avx2' in features or scalable
+        native_scatter = 'avx512f' in features or scalable
+        native_masked_store = 'avx' in features or scalable
+        return vector_bytes, native_gather, native_scatter, native_masked_store
+
+    def make_tttcir(self, mod, metadata, opt, cpu_features=None):
         # TTCIR -> Target TTCIR
+        if cpu_features is None:
+            cpu_features = self.cpu_features
+        vector_bits = self._vector_bits(cpu_features, opt.prefer_vector_width)
         pm = ir.pass_manager(mod.context)
         pm.enable_debug()
         cpu.passes.ttcpuir.add_triton_cpu_canonicalizer(pm)
-        cpu.passes.ttcpuir.add_optimize_masks(pm)
+        cpu.passes.ttcpuir.add_optimize_masks(pm, opt.version_masked_tiles)
         passes.common.add_canonicalizer(pm)
+        if opt.bulk_memory_min_size > 0:
+            cpu.passes.ttcpuir.add_convert_to_bulk_memory_ops(pm, opt.bulk_memory_min_size)
+        if opt.spin_backoff:
+            cpu.passes.ttcpuir.add_backoff_spin_loops(pm)
+        cpu.passes.ttcpuir.add_reduce_int_divisions(pm)
+        cpu.passes.ttcpuir.add_convert_if_to_selects(pm, vector_bits, 32)
+        # Dot lowerings below handle 2D dots only.
+        cpu.passes.ttcpuir.add_split_batched_dots(pm)
+        if opt.pack_dot_operands:
+            cpu.passes.ttcpuir.add_pack_dot_operands(pm)
         if (ukernels := opt.get_ukernels()):
             # For further analysis simplification
             cpu.passes.ttcpuir.add_loop_invariant_code_motion(pm)
@@ -203,37 +742,96 @@ class CPUBackend(BaseBackend):
             passes.common.add_canonicalizer(pm)
             passes.common.add_cse(pm)
         convert_bf16_dot_product = ((self.cpu_arch == "aarch64" or self.cpu_arch == "armv8")
-                                    and 'fp-armv8' in self.cpu_features and 'neon' in self.cpu_features)
+                                    and 'fp-armv8' in cpu_features and 'neon' in cpu_features)
         if convert_bf16_dot_product:
             use_horizontal_sum = os.getenv("TRITON_CPU_DOT_PROD_HORIZ_SUM", "1") == "1"
             cpu.passes.ttcpuir.add_convert_dot_product(pm, use_horizontal_sum)
-        if 'amx-tile' in self.cpu_features:
-            amx_int8 = 'amx-int8' in self.cpu_features
-            # amx_fp16 = 'amx-fp16' in self.cpu_features
-            # FP16 support is not in AMX dialect yet
-            amx_fp16 = False
-            amx_bf16 = 'amx-bf16' in self.cpu_features
-            cpu.passes.ttcpuir.add_convert_dot_to_amx(pm, amx_int8, amx_fp16, amx_bf16)
-        if 'avx512f' in self.cpu_features:
-            cpu.passes.ttcpuir.add_convert_dot_to_fma(pm)
+        if 'amx-tile' in cpu_features:
+            amx_int8 = 'amx-int8' in cpu_features
+            amx_fp16 = 'amx-fp16' in cpu_features
+            amx_bf16 = 'amx-bf16' in cpu_features
+            amx_fp8 = 'amx-fp8' in cpu_features
+            amx_acc_block = opt.amx_acc_block or (0, 0)
+            cpu.passes.ttcpuir.add_convert_dot_to_amx(pm, amx_int8, amx_fp16, amx_bf16, amx_fp8, *amx_acc_block)
+        if self.cpu_arch == "aarch64" and {'i8mm', 'dotprod', 'bf16'} & cpu_features:
+            cpu.passes.ttcpuir.add_convert_dot_to_mmla(pm, 'i8mm' in cpu_features, 'dotprod' in cpu_features,
+                                                       'bf16' in cpu_features)
+        if 'avx512vnni' in cpu_features or 'avxvnni' in cpu_features:
+            cpu.passes.ttcpuir.add_convert_dot_to_vnni(pm, 'avx512vnni' in cpu_features and vector_bits == 512)
+        fma_acc_block = opt.fma_acc_block or (0, 0)
+        if 'avx512f' in cpu_features:
+            # Narrower vectors still have the 32 registers of AVX-512.
+            cpu.passes.ttcpuir.add_convert_dot_to_fma(pm, vector_bits, 32, *fma_acc_block)
+        elif 'avx2' in cpu_features and 'fma' in cpu_features:
+            cpu.passes.ttcpuir.add_convert_dot_to_fma(pm, vector_bits, 16, *fma_acc_block)
+        elif self.cpu_arch == "aarch64" and 'neon' in cpu_features:
+            cpu.passes.ttcpuir.add_convert_dot_to_fma(pm, 128, 32, *fma_acc_block)
+        elif 'v' in cpu_features:
+            # RVV has 32 vector registers of the host vector size.
+            cpu.passes.ttcpuir.add_convert_dot_to_fma(pm, vector_bits, 32, *fma_acc_block)
         cpu.passes.ttcpuir.add_convert_dot_generic(pm)
-        promote_bf16_to_fp32 = self.cpu_arch == "x86_64" and "avx512bf16" not in self.cpu_features
-        # We don't have any lowering for mixed precision matmuls, so always use casts for now
+        if opt.num_stages > 1:
+            # Loads of the next iterations are kept in at most a quarter of the vector registers.
+            num_vec_regs = 32 if {'avx512f', 'v'} & cpu_features or self.cpu_arch == "aarch64" else 16
+            max_stage_bytes = num_vec_regs // 4 * vector_bits // 8
+            cpu.passes.ttcpuir.add_pipeline_loads(pm, opt.num_stages, max_stage_bytes)
+        promote_bf16_to_fp32 = self.cpu_arch == "x86_64" and "avx512bf16" not in cpu_features
+        # The FMA and generic outer product lowerings convert mixed precision inputs in registers.
+        # Other dots are lowered to contractions that are computed in a common type.
         convert_mixed_precision_matmul = True
         # We don't have math lib functions for FP8, FP16, BF16. Promote such operations to FP32.
         promote_lib_math_to_fp32 = True
+        # Except for correctly rounded FP16 operations on targets with FP16 arithmetic.
+        native_fp16_math = 'avx512fp16' in cpu_features or 'fullfp16' in cpu_features
         cpu.passes.ttcpuir.add_convert_unsupported_ops(pm, promote_bf16_to_fp32, convert_mixed_precision_matmul,
-                                                       promote_lib_math_to_fp32)
-        decompose_bf16_conv = self.cpu_arch == "x86_64" and "avx512bf16" not in self.cpu_features
+                                                       promote_lib_math_to_fp32, native_fp16_math)
+        decompose_bf16_conv = self.cpu_arch == "x86_64" and "avx512bf16" not in cpu_features
         decompose_fp8_conv = True
-        cpu.passes.ttcpuir.add_decompose_fp_conversions(pm, decompose_bf16_conv, decompose_fp8_conv)
+        # FP8 is decoded with byte table lookups where vector permutes can index 128-entry tables.
+        if 'avx512vbmi' in cpu_features and vector_bits == 512:
+            fp8_lookup_bits = 512
+        elif self.cpu_arch == "aarch64" and 'neon' in cpu_features:
+            fp8_lookup_bits = 128
+        else:
+            fp8_lookup_bits = 0
+        cpu.passes.ttcpuir.add_decompose_fp_conversions(pm, decompose_bf16_conv, decompose_fp8_conv, fp8_lookup_bits)
+        # Gathers from small tables, e.g. of tt.gather, are replaced with permutes of tables held in registers.
+        if 'avx512f' in cpu_features and vector_bits == 512:
+            gather_lookup_bits = 512
+        elif 'avx2' in cpu_features and vector_bits >= 256:
+            gather_lookup_bits = 256
+        elif self.cpu_arch == "aarch64" and 'neon' in cpu_features:
+            gather_lookup_bits = 128
+        else:
+            gather_lookup_bits = 0
+        cpu.passes.ttcpuir.add_convert_gathers_to_permutes(pm, gather_lookup_bits)
         passes.common.add_cse(pm)
+        if opt.reduction_accumulators > 1:
+            # Two FP adds of 4 cycles issue per cycle, so 8 independent vector updates keep them busy.
+            cpu.passes.ttcpuir.add_interleave_reductions(pm, vector_bits, opt.reduction_accumulators, 8,
+                                                         opt.enable_fast_math)
+        # Chains of ops on blocks of more than 16 vector registers run on sub-blocks of 4 registers.
+        cpu.passes.ttcpuir.add_strip_mine_vectors(pm, vector_bits, 4, 16, opt.noalias)
         passes.common.add_symbol_dce(pm)
         passes.common.add_canonicalizer(pm)
-        pm.run(mod)
+        _run_passes(pm, mod, metadata, opt)
+        # Static per-program cost, used to report achieved throughput against machine peaks.
+        kernel_names = cpu.find_kernel_names(mod)
+        if len(kernel_names) == 1:
+            cost = cpu.estimate_kernel_cost(mod, kernel_names[0])
+            metadata["program_flops"] = cost["flops"]
+            metadata["program_bytes"] = cost["bytes"]
+            metadata["program_cost_exact"] = cost["exact"]
+            store_bytes = cost["min_store_bytes"]
+            if opt.align_output_lines and opt.program_order == "linear" and 0 < store_bytes < CACHE_LINE_BYTES:
+                metadata["program_align"] = CACHE_LINE_BYTES // math.gcd(CACHE_LINE_BYTES, store_bytes)
         return mod
 
-    def make_llir(self, src, metadata, options):
+    def make_llir(self, src, metadata, options, cpu_features=None, target_cpu=None):
+        # target_cpu is used instead of the host CPU to compile an ISA variant with cpu_features.
+        if cpu_features is None:
+            cpu_features = self.cpu_features
+        vector_bits = self._vector_bits(cpu_features, options.prefer_vector_width)
         # warp-specialization mutates num_warps
         num_warp_groups = src.get_int_attr("triton_gpu.num-warp-groups-per-cta")
         if num_warp_groups is not None:
@@ -247,24 +845,37 @@ class CPUBackend(BaseBackend):
             cpu.passes.ttcpuir.add_ukernels_to_onednn_llvmir(pm)
         if options.get_ukernels() == Ukernels.XSMM:
             cpu.passes.ttcpuir.add_ukernels_to_xsmm_llvmir(pm)
-        cpu.passes.ttcpuir.add_lower_vector_multi_dim(pm)
+        if options.scratch_arena_min_size > 0:
+            cpu.passes.ttcpuir.add_allocate_scratch_arena(pm, options.scratch_arena_min_size)
+        cpu.passes.ttcpuir.add_lower_vector_multi_dim(pm, vector_bits)
         cpu.passes.ttcpuir.add_expand_strided_metadata(pm)
-        cpu.passes.ttcpuir.add_vector_to_scf(pm, True, 1, False)
+        vector_unroll_limit = metadata.get("vector_unroll_limit", options.vector_unroll_limit)
+        cpu.passes.ttcpuir.add_vector_to_scf_size_aware(pm, 1, vector_unroll_limit)
+        # Reductions along outer dimensions and transfers with permutation maps are lowered with transposes.
+        cpu.passes.ttcpuir.add_lower_transposes(pm, vector_bits, 'avx2' in cpu_features)
         cpu.passes.ttcpuir.add_lower_affine(pm)
         passes.convert.add_scf_to_cf(pm)
         passes.convert.add_index_to_llvmir(pm)
-        cpu.passes.ttcpuir.add_func_op_to_llvmir(pm)
+        cpu.passes.ttcpuir.add_func_op_to_llvmir(pm, options.noalias)
         cpu.passes.ttcpuir.add_program_id_to_llvmir(pm)
         cpu.passes.ttcpuir.add_memory_op_to_llvmir(pm)
         cpu.passes.ttcpuir.add_atomic_ops_to_llvmir(pm)
         cpu.passes.ttcpuir.add_debug_ops_to_llvmir(pm)
+        cpu.passes.ttcpuir.add_record_op_to_llvmir(pm)
 
+        if options.inline_math:
+            cpu.passes.ttcpuir.add_math_to_polynomials(pm, 'avx2' in cpu_features)
         vec_lib_requirements = {
-            VecLib.libsleef: {"neon", "sse", "avx"},
-            VecLib.libmvec: {"avx512f"},
+            VecLib.libsleef: {"neon", "sse", "avx", "v"},
+            VecLib.libmvec: {"avx512f", "avx2"},
         }
-        if (vec_lib := options.get_vec_lib()) and vec_lib_requirements[vec_lib] & self.cpu_features:
-            cpu.passes.ttcpuir.add_math_to_vec_lib(pm, vec_lib, self.cpu_features)
+        if (vec_lib := options.get_vec_lib()) and vec_lib_requirements[vec_lib] & cpu_features:
+            # The SVE register size is only known for the host, ISA variants use NEON functions. RVV functions
+            # work with registers of any size, so the size guaranteed by the features is used.
+            scalable_bits = self.sve_bits if cpu_features == self.cpu_features else 0
+            scalable_bits = scalable_bits or _get_rvv_vector_bits(cpu_features)
+            cpu.passes.ttcpuir.add_math_to_vec_lib(pm, vec_lib, cpu_features, scalable_bits,
+                                                   options.prefer_vector_width)
 
         passes.convert.add_math_to_llvmir(pm)
         cpu.passes.ttcpuir.add_math_to_libm(pm)
@@ -275,34 +886,72 @@ class CPUBackend(BaseBackend):
         # passes.convert.add_cf_to_llvmir(pm)
         cpu.passes.ttcpuir.add_func_to_llvmir(pm)
         cpu.passes.ttcpuir.add_ub_to_llvmir(pm)
+        cpu.passes.ttcpuir.add_hoist_grid_invariants(pm)
         passes.common.add_canonicalizer(pm)
         passes.common.add_cse(pm)
         passes.common.add_symbol_dce(pm)
         if os.environ.get("TRITON_DISABLE_LINE_INFO", "0") == "0":
             passes.llvmir.add_di_scope(pm)
-        pm.run(mod)
+        _run_passes(pm, mod, metadata, options)
+        metadata["scratch_arena_size"] = mod.get_int_attr("triton_cpu.scratch_arena_size") or 0
 
-        # Find kernel fn
+        # Modules compiled from TTIR may hold several kernels, each gets its entry points. Metadata and the
+        # launcher describe the first one, see build_kernel_bundle for loading many kernels from one library.
         kernel_names = cpu.find_kernel_names(mod)
-        assert len(kernel_names) == 1, f"expected exactly 1 kernel in a module, got {kernel_names}"
+        assert kernel_names, "expected a kernel in a module"
 
         # LLVM-IR (MLIR) -> LLVM-IR (LLVM)
-        llvm.init_targets()
-        context = llvm.context()
-        llvm_mod = llvm.to_module(mod, context)
-        if llvm_mod is None:
-            raise RuntimeError("Failed to convert to LLVM IR")
-        llvm.set_host_target(llvm_mod)
-        #if options.extern_libs:
-        #    paths = [path for (name, path) in options.extern_libs]
-        #   llvm.link_extern_libs(llvm_mod, paths)
-        llvm.optimize_module(llvm_mod, llvm.OPTIMIZE_O3)
-        # Get some metadata
-        metadata["shared"] = 0
-        metadata["name"] = kernel_names[0]
-        ret = str(llvm_mod)
-        del llvm_mod
-        del context
+        # Kernels are compiled for the host only, so other targets aren't initialized.
+        llvm.init_native_target()
+        # Contexts are reused across kernels, see TRITON_CONTEXT_REUSE.
+        context = llvm.acquire_context()
+        llvm_mod = None
+        try:
+            start = time.perf_counter()
+            llvm_mod = llvm.to_module(mod, context)
+            if llvm_mod is None:
+                raise RuntimeError("Failed to convert to LLVM IR")
+            _record_step("mlir-to-llvmir", start, cpu.count_llvm_instructions(llvm_mod), metadata, options)
+            llvm.set_host_target(llvm_mod)
+            if target_cpu is None and self.cpu_arch.startswith("riscv"):
+                # The name of RISC-V CPUs doesn't imply their extensions, so host features are set on functions
+                # like for ISA variants, otherwise kernels are compiled for the base ISA without vectors.
+                target_cpu = self.cpu_name
+            if target_cpu is not None:
+                target_features = ",".join(f"+{feature}" for feature in sorted(cpu_features))
+                cpu.set_target_attributes(llvm_mod, target_cpu, target_features)
+            if options.bitcode_libs:
+                start = time.perf_counter()
+                llvm.link_extern_libs(llvm_mod, list(options.bitcode_libs))
+                _record_step("link-bitcode", start, cpu.count_llvm_instructions(llvm_mod), metadata, options)
+            if options.prefer_vector_width:
+                cpu.set_prefer_vector_width(llvm_mod, vector_bits)
+            if 'v' in cpu_features:
+                # Tail masks become vector lengths set with vsetvl.
+                cpu.convert_prefix_masks_to_vector_length(llvm_mod)
+            pgo_instrument = options.pgo_warmup > 0 and options.pgo_profile is None
+            opt_level, step = (llvm.OPTIMIZE_O1, "llvm-O1") if options.fast_compile else (llvm.OPTIMIZE_O3, "llvm-O3")
+            start = time.perf_counter()
+            llvm.optimize_module(llvm_mod, opt_level, pgo_instrument=pgo_instrument,
+                                 pgo_profile=options.pgo_profile or "", loop_unrolling=not options.fast_compile,
+                                 slp_vectorization=not options.fast_compile)
+            _record_step(step, start, cpu.count_llvm_instructions(llvm_mod), metadata, options)
+            if pgo_instrument:
+                # Counters are read by the launcher through exported symbols, see _PGOProfiler.
+                metadata["pgo_counters"] = cpu.export_pgo_counters(llvm_mod)
+            # Added after optimization, so the kernel isn't inlined into it.
+            for name in kernel_names:
+                cpu.add_packed_entry(llvm_mod, name)
+            if target_cpu is not None:
+                cpu.set_target_attributes(llvm_mod, target_cpu, target_features)
+            # Get some metadata
+            metadata["shared"] = 0
+            metadata["name"] = kernel_names[0]
+            ret = str(llvm_mod)
+        finally:
+            # Modules are freed before their contexts are reused.
+            llvm_mod = None
+            llvm.release_context(context)
         return ret
 
     @staticmethod
@@ -311,27 +960,108 @@ class CPUBackend(BaseBackend):
 
     @staticmethod
     def make_so(src, metadata, options):
+        # The object file is emitted in-process, so the compiler only links it, see get_lazy_irs for the assembly.
         with tempfile.TemporaryDirectory() as tmpdir:
-            asm_path = os.path.join(tmpdir, "kernel.s")
-            Path(asm_path).write_text(src)
+            obj_path = os.path.join(tmpdir, "kernel.o")
+            start = time.perf_counter()
+            stats = {}
+            Path(obj_path).write_bytes(
+                llvm.translate_to_host_object(src, options.enable_fp_fusion, options.enable_fast_math, stats))
+            _record_step("llvmir-to-object", start, None, metadata, options)
+            _record_machine_stats(stats, metadata)
             lib_dirs = cpu_driver.library_dirs
             libs = ["m", "TritonCPURuntime", "sleef"]
-            so = _build("kernel", asm_path, tmpdir, lib_dirs, cpu_driver.include_dirs, libs)
+            start = time.perf_counter()
+            so = _build("kernel", obj_path, tmpdir, lib_dirs, cpu_driver.include_dirs, libs)
+            _record_step("link", start, None, metadata, options)
             with open(so, "rb") as f:
                 return f.read()
 
+    def make_isa_variants_llir(self, src, metadata, options):
+        # TTCIR -> LLVM-IR with a variant of the kernel for each ISA level, see link_isa_variants.
+        if len(cpu.find_kernel_names(src)) > 1:
+            raise ValueError("ISA variants are only supported for modules with a single kernel")
+        variants = []
+        with tempfile.TemporaryDirectory() as tmpdir:
+            ttcir_path = os.path.join(tmpdir, "kernel.ttcir")
+            Path(ttcir_path).write_text(str(src))
+            for isa in reversed(options.isa_variants):
+                arch, target_cpu, features = ISA_VARIANTS[isa]
+                if arch != self.cpu_arch:
+                    raise ValueError(f"ISA variant {isa} is for {arch}, can't compile it on {self.cpu_arch}")
+                mod = ir.parse_mlir_module(ttcir_path, src.context)
+                mod.context = src.context
+                mod = self.make_tttcir(mod, metadata, options, cpu_features=set(features))
+                llir = self.make_llir(mod, metadata, options, cpu_features=set(features), target_cpu=target_cpu)
+                variants.append((llir, isa, ",".join(sorted(features))))
+        metadata["isa_variants"] = list(options.isa_variants)
+        return cpu.link_isa_variants(metadata["name"], variants, _BASELINE_CPUS[self.cpu_arch])
+
     def add_stages(self, stages, options):
         stages["ttir"] = lambda src, metadata: self.make_ttir(src, metadata, options)
         stages["ttcir"] = lambda src, metadata: self.make_ttcir(src, metadata, options)
-        stages["tttcir"] = lambda src, metadata: self.make_tttcir(src, metadata, options)
-        stages["llir"] = lambda src, metadata: self.make_llir(src, metadata, options)
-        stages["asm"] = lambda src, metadata: self.make_asm(src, metadata, options)
+        if options.isa_variants:
+            stages["llir"] = lambda src, metadata: self.make_isa_variants_llir(src, metadata, options)
+        else:
+            stages["tttcir"] = lambda src, metadata: self.make_tttcir(src, metadata, options)
+            stages["llir"] = lambda src, metadata: self.make_llir(src, metadata, options)
         stages["so"] = lambda src, metadata: self.make_so(src, metadata, options)
+        always_compile = os.environ.get("TRITON_ALWAYS_COMPILE", "0") == "1"
+        if options.share_stages and not options.profile_compile and not always_compile:
+            for name in ("llir", "so"):
+                stages[name] = functools.partial(self._shared_stage, name, stages[name], options)
+        if options.profile_compile:
+            for name, stage in stages.items():
+                stages[name] = functools.partial(self._profile_stage, name, stage, last=name == "so")
+
+    def _shared_stage(self, name, stage, options, src, metadata):
+        # Run a stage or reuse its result for the same input IR, together with the metadata the stage recorded.
+        from triton.compiler.compiler import triton_key
+        inputs = [metadata.get(key) for key in _SHARED_STAGE_INPUTS[name]]
+        env_vars = sorted(get_cache_invalidating_env_vars().items())
+        src_hash = hashlib.sha256(str(src).encode("utf-8")).hexdigest()
+        key = f"{name}-{triton_key()}-{self.hash()}-{options.hash()}-{env_vars}-{inputs}-{src_hash}"
+        cache = get_cache_manager(hashlib.sha256(key.encode("utf-8")).hexdigest())
+        filename = f"kernel.{name}"
+        # The metadata is written last, so the result is complete when it exists.
+        metadata_path = cache.get_file("metadata.json")
+        result_path = cache.get_file(filename) if metadata_path else None
+        if result_path is not None:
+            metadata.update(json.loads(Path(metadata_path).read_text()))
+            return Path(result_path).read_bytes() if name == "so" else Path(result_path).read_text()
+        before = dict(metadata)
+        res = stage(src, metadata)
+        recorded = {key: value for key, value in metadata.items() if key not in before or before[key] != value}
+        try:
+            cache.put(res, filename, binary=isinstance(res, bytes))
+            cache.put(json.dumps(recorded, default=vars), "metadata.json", binary=False)
+        except (OSError, RuntimeError):
+            pass
+        return res
+
+    @staticmethod
+    def _profile_stage(name, stage, src, metadata, last):
+        profile = metadata.setdefault("compile_profile", {"passes": [], "stages": []})
+        profile["stages"].append([name, None])
+        start = time.perf_counter()
+        res = stage(src, metadata)
+        profile["stages"][-1][1] = (time.perf_counter() - start) * 1e3
+        if last:
+            print(f"Compile profile of {metadata['name']}:\n{format_compile_profile(profile)}", file=sys.stderr)
+        return res
+
+    def get_lazy_irs(self, metadata):
+        # Assembly is generated from LLVM IR only when it is requested.
+        return {"asm": lambda asm: self.make_asm(asm["llir"], None, metadata)}
 
     @functools.lru_cache()
     def hash(self):
-        # TODO: Get more detailed CPU info like raw brand name with supported ISAs.
-        # Right now it would only return a simple string like "x86_64" or "aarch64".
-        import platform
-
-        return f"{platform.machine()}"
+        # Kernels are compiled for the host CPU, so the hash includes the CPU name, which selects the LLVM
+        # target, and the features passes are gated on. Features are taken after AMX ones are dropped for
+        # processes that can't use AMX, so those kernels don't share cache entries with AMX ones. The
+        # readable prefix allows to partition shared caches by CPU.
+        features = ",".join(sorted(self.cpu_features))
+        if self.sve_bits:
+            features += f",sve-bits={self.sve_bits}"
+        features_hash = hashlib.sha256(features.encode("utf-8")).hexdigest()[:16]
+        return f"{self.cpu_arch}-{self.cpu_name}-{features_hash}"
@@ -1,9 +1,15 @@
+import contextlib
+import ctypes
+import functools
 import os
 import hashlib
 import importlib
 import importlib.resources
+import struct
 import tempfile
+import threading
 import time
+import weakref
 
 import triton
 import triton._C
@@ -12,6 +18,7 @@ from triton.runtime.cache import get_cache_manager
 from triton.backends.driver import DriverBase
 from triton.backends.compiler import GPUTarget
 
+from dataclasses import dataclass
 from pathlib import Path
 from triton._C.libtriton import llvm
 
@@ -25,7 +32,7 @@ except AttributeError:
 
 include_dirs = []
 library_dirs = [_triton_C_dir]
-libraries = ["stdc++"]
+libraries = ["stdc++", "TritonCPURuntime"]
 
 # Skip non-existent paths
 sys_include_dir = os.path.join(_dirname, "include")
@@ -61,6 +68,125 @@ def compile_module_from_src(src, name):
 # ------------------------
 
 
+_SYSFS_CPU = "/sys/devices/system/cpu"
+
+
+def _read_sysfs(path, default=None):
+    try:
+        with open(path) as f:
+            return f.read().strip()
+    except OSError:
+        return default
+
+
+def _parse_cpu_list(cpu_list):
+    """Parse a CPU list in the Linux sysfs format, e.g. "0-3,8,10-11"."""
+    res = []
+    for item in cpu_list.split(","):
+        if not item:
+            continue
+        first, _, last = item.partition("-")
+        res.extend(range(int(first), int(last or first) + 1))
+    return res
+
+
+def _parse_size(size):
+    units = {"K": 1 << 10, "M": 1 << 20, "G": 1 << 30}
+    return int(size[:-1]) * units[size[-1]] if size[-1] in units else int(size)
+
+
+@functools.lru_cache()
+def _read_caches():
+    """Return data and unified caches of CPU 0 from sysfs."""
+    res = []
+    base = os.path.join(_SYSFS_CPU, "cpu0", "cache")
+    try:
+        indices = sorted(name for name in os.listdir(base) if name.startswith("index"))
+    except OSError:
+        return res
+    for index in indices:
+        path = os.path.join(base, index)
+        cache_type = _read_sysfs(os.path.join(path, "type"), "")
+        size = _read_sysfs(os.path.join(path, "size"))
+        if cache_type == "Instruction" or not size:
+            continue
+        res.append({
+            "level": int(_read_sysfs(os.path.join(path, "level"), "0")),
+            "size": _parse_size(size),
+            "line_size": int(_read_sysfs(os.path.join(path, "coherency_line_size"), "64")),
+            "num_sharing_cpus": len(_parse_cpu_list(_read_sysfs(os.path.join(path, "shared_cpu_list"), "0"))),
+        })
+    return res
+
+
+def _simd_width(features):
+    """Return the widest vector register size in bits supported by the host features."""
+    for feature, width in [("avx512f", 512), ("avx", 256), ("sse2", 128), ("neon", 128), ("sve", 128)]:
+        if feature in features:
+            return width
+    return 0
+
+
+@functools.lru_cache()
+def _read_device_properties():
+    cpus = _parse_cpu_list(_read_sysfs(os.path.join(_SYSFS_CPU, "online"), f"0-{os.cpu_count() - 1}"))
+    cores = set()
+    packages = set()
+    for cpu in cpus:
+        topology = os.path.join(_SYSFS_CPU, f"cpu{cpu}", "topology")
+        package = _read_sysfs(os.path.join(topology, "physical_package_id"), "0")
+        packages.add(package)
+        cores.add((package, _read_sysfs(os.path.join(topology, "core_id"), str(cpu))))
+    numa_nodes = []
+    while (node_cpus := _read_sysfs(f"/sys/devices/system/node/node{len(numa_nodes)}/cpulist")) is not None:
+        numa_nodes.append(_parse_cpu_list(node_cpus))
+
+    features = llvm.get_cpu_features()
+    # AMX can only be used if the process is allowed to extend its XSTATE, the backend drops
+    # AMX features otherwise.
+    amx = "amx-tile" in features and triton._C.libtriton.cpu.enable_amx()
+    caches = {f"l{cache['level']}_cache_size": cache["size"] for cache in _read_caches()}
+    res = {
+        "max_shared_mem": 0,
+        "cpu_name": llvm.get_cpu_name(),
+        "cpu_arch": llvm.get_cpu_tripple().split("-")[0],
+        "cpu_features": sorted(features),
+        "num_cpus": len(cpus),
+        "num_available_cpus": len(os.sched_getaffinity(0)) if hasattr(os, "sched_getaffinity") else len(cpus),
+        # Number of workers of the thread pool, which is the number of programs of persistent launches.
+        "multiprocessor_count": CPUUtils()._get_runtime().triton_cpu_get_num_threads(),
+        "num_cores": len(cores),
+        "num_packages": len(packages),
+        "num_numa_nodes": max(len(numa_nodes), 1),
+        "numa_nodes": numa_nodes,
+        "is_hybrid": bool(CPUUtils()._get_runtime().triton_cpu_is_hybrid()),
+        "l1_cache_size": 0,
+        "l2_cache_size": 0,
+        "l3_cache_size": 0,
+        **caches,
+        "llc_size": _llc_size() or 0,
+        "cache_line_size": _read_caches()[0]["line_size"] if _read_caches() else 64,
+        "simd_width": _simd_width(features),
+        "amx": amx,
+        "amx_bf16": amx and "amx-bf16" in features,
+        "amx_fp16": amx and "amx-fp16" in features,
+        "amx_fp8": amx and "amx-fp8" in features,
+        "amx_int8": amx and "amx-int8" in features,
+    }
+    return res
+
+
+class UkernelCacheStats(ctypes.Structure):
+    # Keep in sync with UkernelCacheStats in runtime_onednn.cpp.
+    _fields_ = [
+        ("hits", ctypes.c_uint64),
+        ("misses", ctypes.c_uint64),
+        ("evictions", ctypes.c_uint64),
+        ("entries", ctypes.c_uint64),
+        ("capacity", ctypes.c_int64),
+    ]
+
+
 class CPUUtils(object):
 
     def __new__(cls):
@@ -71,18 +197,1023 @@ class CPUUtils(object):
     def __init__(self):
         pass
 
+    # Loaded kernel libraries keyed by the hash of their contents. Identical
+    # kernels share a single handle.
+    _libs = {}
+    _libs_lock = threading.Lock()
+
+    # Kernels of loaded bundles keyed by the hash of their own library, with
+    # the bundle library and the symbol name of the kernel in it.
+    _bundled = {}
+
+    # Libraries of loaded kernels keyed by their entry points, see _PGOProfiler.
+    _function_libs = {}
+
+    # Names of loaded kernels keyed by their entry points, see stats.py.
+    _function_names = {}
+
     def load_binary(self, name, kernel, shared_mem, device):
-        with tempfile.NamedTemporaryFile(mode="wb", suffix=".so") as f:
-            f.write(kernel)
-            f.flush()
-            import ctypes
-            lib = ctypes.cdll.LoadLibrary(f.name)
-            fn_ptr = getattr(lib, name)
-            fn_ptr_as_void_p = ctypes.cast(fn_ptr, ctypes.c_void_p).value
-            return (lib, fn_ptr_as_void_p, 0, 0)
+        key = hashlib.sha256(kernel).hexdigest()
+        with self._libs_lock:
+            lib, symbol = self._bundled.get(key, (None, name))
+            if lib is None:
+                lib = self._libs.get(key)
+            if lib is None:
+                lib = self._load_library(key, f"{name}.so", kernel)
+                self._libs[key] = lib
+                _register_jit_symbols(lib, kernel)
+        # Launchers call the range entry point of the kernel, the generic
+        # launcher calls its packed version.
+        fn_ptr = getattr(lib, f"{symbol}_packed" if use_generic_launcher() else f"{symbol}_range")
+        fn_ptr_as_void_p = ctypes.cast(fn_ptr, ctypes.c_void_p).value
+        self._function_libs[fn_ptr_as_void_p] = lib
+        self._function_names[fn_ptr_as_void_p] = name
+        return (lib, fn_ptr_as_void_p, 0, 0)
+
+    def _load_library(self, key, filename, kernel):
+        # Load the library from a content-addressed file in the cache, so the
+        # file is written once and has a stable path for profilers.
+        try:
+            cache = get_cache_manager(key)
+            path = cache.get_file(filename) or cache.put(kernel, filename, binary=True)
+        except (OSError, RuntimeError):
+            path = None
+        if path is not None:
+            return ctypes.CDLL(path)
+        # The cache isn't writable, load the library from memory.
+        fd = os.memfd_create(filename)
+        try:
+            os.write(fd, kernel)
+            return ctypes.CDLL(f"/proc/self/fd/{fd}")
+        finally:
+            os.close(fd)
+
+    def build_kernel_bundle(self, kernels):
+        """Link compiled kernels, e.g. those returned by launches, into a single shared object and return its image.
+
+        A model with many specialized kernels otherwise loads a library per kernel, each with its own relocations,
+        pages and dlopen at startup. The image is loaded with load_kernel_bundle, and can be saved to a file and
+        loaded by later processes, whose kernels compiled or loaded from the cache are then launched from the
+        bundle. Kernels have to share enable_fp_fusion and enable_fast_math, which apply to the whole object.
+        """
+        from triton._C.libtriton import cpu
+        irs, manifest, flags, keys = [], [], set(), set()
+        for kernel in kernels:
+            key = hashlib.sha256(kernel.asm["so"]).hexdigest()
+            if key in keys:
+                continue
+            keys.add(key)
+            # Specializations of a kernel share its name, so symbols are made unique by the library hash.
+            symbol = f"{kernel.metadata.name}_{key[:16]}"
+            irs.append(cpu.rename_kernel(kernel.asm["llir"], kernel.metadata.name, symbol))
+            manifest.append(f"{key} {symbol}")
+            flags.add((kernel.metadata.enable_fp_fusion, kernel.metadata.enable_fast_math))
+        if len(flags) > 1:
+            raise ValueError("Bundled kernels should have the same enable_fp_fusion and enable_fast_math")
+        if not irs:
+            raise ValueError("No kernels to bundle")
+        fp_fusion, fast_math = flags.pop()
+        llir = cpu.link_kernel_bundle(irs, "\n".join(manifest))
+        with tempfile.TemporaryDirectory() as tmpdir:
+            obj_path = os.path.join(tmpdir, "kernel_bundle.o")
+            Path(obj_path).write_bytes(llvm.translate_to_host_object(llir, fp_fusion, fast_math))
+            libs = ["m", "TritonCPURuntime", "sleef"]
+            so = _build("kernel_bundle", obj_path, tmpdir, library_dirs, include_dirs, libs)
+            return Path(so).read_bytes()
+
+    def load_kernel_bundle(self, image):
+        """Load a shared object built by build_kernel_bundle and return its handle.
+
+        Kernels of the bundle are launched from it from then on, including kernels that are already loaded from
+        their own libraries once they are compiled or loaded from the cache again.
+        """
+        key = hashlib.sha256(image).hexdigest()
+        with self._libs_lock:
+            lib = self._libs.get(key)
+            if lib is None:
+                lib = self._load_library(key, "kernel_bundle.so", image)
+                self._libs[key] = lib
+                _register_jit_symbols(lib, image)
+            manifest = ctypes.string_at(ctypes.addressof(ctypes.c_char.in_dll(lib, "triton_cpu_bundle_manifest")))
+            for line in manifest.decode().splitlines():
+                kernel_key, symbol = line.split()
+                self._bundled[kernel_key] = (lib, symbol)
+        return lib
+
+    def numa_first_touch(self, tensor):
+        """Touch pages of a freshly allocated tensor from the threads that would write
+        them in a NUMA launch to place them on the corresponding NUMA nodes."""
+        runtime = self._get_runtime()
+        runtime.triton_cpu_numa_first_touch(ctypes.c_void_p(tensor.data_ptr()),
+                                            ctypes.c_size_t(tensor.numel() * tensor.element_size()))
+
+    def get_ukernel_cache_stats(self):
+        """Return statistics of the oneDNN ukernel handle cache, or None when the runtime is
+        built without oneDNN."""
+        runtime = self._get_runtime()
+        if not hasattr(runtime, "triton_cpu_ukernel_cache_stats"):
+            return None
+        stats = UkernelCacheStats()
+        runtime.triton_cpu_ukernel_cache_stats(ctypes.byref(stats))
+        return {name: getattr(stats, name) for name, _ in UkernelCacheStats._fields_}
+
+    def set_ukernel_cache_capacity(self, capacity):
+        """Set the maximum number of oneDNN ukernels with generated code kept in the cache,
+        0 means unbounded. The default is TRITON_CPU_UKERNEL_CACHE_CAPACITY or 1024."""
+        runtime = self._get_runtime()
+        if hasattr(runtime, "triton_cpu_ukernel_cache_set_capacity"):
+            runtime.triton_cpu_ukernel_cache_set_capacity(ctypes.c_int64(capacity))
+
+    def get_shared_pool_stats(self):
+        """Return the number of cores shared with other processes, the number of them leased by launches and the
+        number of processes with running launches, or None when the process doesn't share cores.
+
+        Processes started with the same TRITON_CPU_SHARED_POOL name divide TRITON_CPU_SHARED_POOL_SIZE cores (all
+        cores of the host by default) between launches of their thread pools, so that together they don't
+        oversubscribe the host. Cores are leased for the duration of a launch only, so idle processes yield their
+        cores to busy ones."""
+        runtime = self._get_runtime()
+        if not runtime.triton_cpu_shared_pool_enabled():
+            return None
+        capacity, leased, active = ctypes.c_int32(), ctypes.c_int32(), ctypes.c_int32()
+        runtime.triton_cpu_shared_pool_stats(ctypes.byref(capacity), ctypes.byref(leased), ctypes.byref(active))
+        return {"capacity": capacity.value, "leased": leased.value, "active": active.value}
+
+    def _get_runtime(self):
+        if not hasattr(self, "_runtime"):
+            runtime = ctypes.CDLL(os.path.join(_triton_C_dir, "libTritonCPURuntime.so"))
+            runtime.triton_cpu_stream_create.restype = ctypes.c_void_p
+            runtime.triton_cpu_stream_query.restype = ctypes.c_bool
+            runtime.triton_cpu_graph_create.restype = ctypes.c_void_p
+            runtime.triton_cpu_graph_size.restype = ctypes.c_int64
+            runtime.triton_cpu_range_dep_create.restype = ctypes.c_void_p
+            runtime.triton_cpu_range_dep_set_current.argtypes = [
+                ctypes.c_void_p, ctypes.c_int64, ctypes.c_void_p, ctypes.c_int64
+            ]
+            runtime.triton_cpu_launch_trace_enabled.restype = ctypes.c_bool
+            runtime.triton_cpu_launch_trace_now.restype = ctypes.c_int64
+            runtime.triton_cpu_launch_trace_position.restype = ctypes.c_uint64
+            runtime.triton_cpu_launch_trace_read.restype = ctypes.c_size_t
+            runtime.triton_cpu_launch_trace_size.restype = ctypes.c_size_t
+            runtime.triton_cpu_timeline_read.restype = ctypes.c_size_t
+            runtime.triton_cpu_stats_read_kernels.restype = ctypes.c_size_t
+            runtime.triton_cpu_stats_counter_name.restype = ctypes.c_char_p
+            runtime.triton_cpu_perf_enabled.restype = ctypes.c_bool
+            runtime.triton_cpu_perf_num_counters.restype = ctypes.c_int32
+            runtime.triton_cpu_perf_max_counters.restype = ctypes.c_int32
+            runtime.triton_cpu_perf_counter_name.restype = ctypes.c_char_p
+            runtime.triton_cpu_proton_record_read.restype = ctypes.c_size_t
+            runtime.triton_cpu_proton_record_dropped.restype = ctypes.c_uint64
+            runtime.triton_cpu_proton_record_frequency.restype = ctypes.c_double
+            runtime.triton_cpu_flush_cache.restype = ctypes.c_bool
+            runtime.triton_cpu_is_hybrid.restype = ctypes.c_bool
+            runtime.triton_cpu_shared_pool_enabled.restype = ctypes.c_bool
+            runtime.triton_cpu_alloc.restype = ctypes.c_void_p
+            runtime.triton_cpu_alloc.argtypes = [ctypes.c_size_t, ctypes.c_size_t, ctypes.c_bool]
+            runtime.triton_cpu_free.argtypes = [ctypes.c_void_p]
+            runtime.triton_cpu_alloc_page_size.restype = ctypes.c_size_t
+            runtime.triton_cpu_alloc_page_size.argtypes = [ctypes.c_void_p]
+            self._runtime = runtime
+        return self._runtime
 
     def get_device_properties(self, *args):
-        return {"max_shared_mem": 0}
+        """Return properties of the host CPU used by heuristics and autotuning.
+
+        Besides max_shared_mem, which is always 0, they include the CPU name and features, the
+        number of CPUs, physical cores, packages and NUMA nodes, sizes of data caches per level
+        (of the caches of CPU 0, shared caches are reported at their full size), the widest SIMD
+        register width in bits and availability of AMX.
+        """
+        return dict(_read_device_properties())
+
+
+# ------------------------
+# Profiler symbols
+# ------------------------
+
+# ELF constants used to find function symbols of kernel libraries.
+_SHT_SYMTAB = 2
+_SHT_DYNSYM = 11
+_STT_FUNC = 2
+_SHN_UNDEF = 0
+
+
+def _elf_function_symbols(image):
+    """Return (name, value, size) of functions defined in a 64-bit little-endian ELF image."""
+    if image[:4] != b"\x7fELF" or image[4] != 2 or image[5] != 1:
+        return []
+    shoff, = struct.unpack_from("<Q", image, 0x28)
+    shentsize, shnum = struct.unpack_from("<HH", image, 0x3a)
+    sections = [struct.unpack_from("<IIQQQQIIQQ", image, shoff + i * shentsize) for i in range(shnum)]
+    # Prefer the full symbol table, stripped libraries only have dynamic symbols.
+    for sh_type in (_SHT_SYMTAB, _SHT_DYNSYM):
+        symtabs = [sec for sec in sections if sec[1] == sh_type]
+        if symtabs:
+            break
+    else:
+        return []
+    _, _, _, _, offset, size, link, _, _, entsize = symtabs[0]
+    strtab_offset = sections[link][4]
+    res = []
+    for sym_offset in range(offset, offset + size, entsize):
+        st_name, st_info, _, st_shndx, st_value, st_size = struct.unpack_from("<IBBHQQ", image, sym_offset)
+        if (st_info & 0xf) != _STT_FUNC or st_shndx == _SHN_UNDEF or st_size == 0:
+            continue
+        name_end = image.index(b"\0", strtab_offset + st_name)
+        res.append((image[strtab_offset + st_name:name_end].decode(), st_value, st_size))
+    return res
+
+
+class _IttMethodLoad(ctypes.Structure):
+    # iJIT_Method_Load of the Intel ITT JIT profiling API, see jitprofiling.h.
+    _fields_ = [
+        ("method_id", ctypes.c_uint),
+        ("method_name", ctypes.c_char_p),
+        ("method_load_address", ctypes.c_void_p),
+        ("method_size", ctypes.c_uint),
+        ("line_number_size", ctypes.c_uint),
+        ("line_number_table", ctypes.c_void_p),
+        ("class_id", ctypes.c_uint),
+        ("class_file_name", ctypes.c_char_p),
+        ("source_file_name", ctypes.c_char_p),
+    ]
+
+
+# iJVM_EVENT_TYPE_METHOD_LOAD_FINISHED of the ITT JIT profiling API.
+_ITT_METHOD_LOAD_FINISHED = 13
+
+
+@functools.lru_cache()
+def _get_itt_notify_event():
+    # VTune sets INTEL_JIT_PROFILER64 to its JIT collector library when it
+    # profiles JIT code.
+    path = os.getenv("INTEL_JIT_PROFILER64")
+    if not path:
+        return None
+    try:
+        collector = ctypes.CDLL(path)
+        notify_event = collector.NotifyEvent
+    except (OSError, AttributeError):
+        return None
+    notify_event.argtypes = [ctypes.c_int, ctypes.c_void_p]
+    notify_event.restype = ctypes.c_int
+    return notify_event
+
+
+_jit_symbols_lock = threading.Lock()
+_next_itt_method_id = 1
+
+
+def _register_jit_symbols(lib, image):
+    """Report functions of a loaded kernel library to profilers.
+
+    Kernel libraries loaded from the cache are symbolized by perf and VTune from their files,
+    including source lines of the debug info. Libraries loaded from memory when the cache isn't
+    writable are not, so their functions can be written to the perf map, /tmp/perf-<pid>.map,
+    by setting TRITON_CPU_PERF_MAP=1 and are registered with the ITT JIT profiling API while
+    VTune is profiling.
+    """
+    global _next_itt_method_id
+    write_perf_map = os.getenv("TRITON_CPU_PERF_MAP", "0") == "1"
+    notify_event = _get_itt_notify_event()
+    if not write_perf_map and notify_event is None:
+        return
+    symbols = _elf_function_symbols(image)
+    # Find the load address from any exported function.
+    base = None
+    for name, value, _ in symbols:
+        try:
+            base = ctypes.cast(lib[name], ctypes.c_void_p).value - value
+            break
+        except AttributeError:
+            continue
+    if base is None:
+        return
+    with _jit_symbols_lock:
+        if write_perf_map:
+            with open(f"/tmp/perf-{os.getpid()}.map", "a") as f:
+                for name, value, size in symbols:
+                    f.write(f"{base + value:x} {size:x} {name}\n")
+        if notify_event is not None:
+            for name, value, size in symbols:
+                method = _IttMethodLoad(method_id=_next_itt_method_id, method_name=name.encode(),
+                                        method_load_address=base + value, method_size=size)
+                _next_itt_method_id += 1
+                notify_event(_ITT_METHOD_LOAD_FINISHED, ctypes.addressof(method))
+
+
+# ------------------------
+# Streams
+# ------------------------
+
+_thread_local = threading.local()
+
+
+class CPUStream:
+    """An in-order queue of kernel launches run asynchronously by the CPU runtime.
+
+    Launches on a stream return as soon as they are queued, so kernel arguments
+    must be kept alive until the stream is synchronized.
+    """
+
+    _streams = weakref.WeakSet()
+
+    def __init__(self):
+        self._runtime = CPUUtils()._get_runtime()
+        self.handle = self._runtime.triton_cpu_stream_create()
+        CPUStream._streams.add(self)
+
+    def synchronize(self):
+        self._runtime.triton_cpu_stream_synchronize(ctypes.c_void_p(self.handle))
+
+    def query(self):
+        return self._runtime.triton_cpu_stream_query(ctypes.c_void_p(self.handle))
+
+    def __del__(self):
+        if getattr(self, "handle", None):
+            self._runtime.triton_cpu_stream_destroy(ctypes.c_void_p(self.handle))
+            self.handle = None
+
+
+def current_stream():
+    """Return the stream used for launches from the current thread or None for synchronous launches."""
+    return getattr(_thread_local, "stream", None)
+
+
+@contextlib.contextmanager
+def stream(s):
+    """Make launches from the current thread run on the stream `s`."""
+    prev = current_stream()
+    _thread_local.stream = s
+    try:
+        yield s
+    finally:
+        _thread_local.stream = prev
+
+
+class CPUGraph:
+    """A recorded sequence of kernel launches that can be replayed with low overhead.
+
+    Launches are captured with their arguments, so replays read and write the same
+    buffers the kernels were captured with:
+
+        g = CPUGraph()
+        with g.capture():
+            kernel[grid](x, y)
+        g.replay()
+    """
+
+    def __init__(self):
+        self._runtime = CPUUtils()._get_runtime()
+        self.handle = self._runtime.triton_cpu_graph_create()
+
+    @contextlib.contextmanager
+    def capture(self):
+        capture_stream = CPUStream()
+        self._runtime.triton_cpu_stream_begin_capture(ctypes.c_void_p(capture_stream.handle),
+                                                      ctypes.c_void_p(self.handle))
+        try:
+            with stream(capture_stream):
+                yield self
+        finally:
+            self._runtime.triton_cpu_stream_end_capture(ctypes.c_void_p(capture_stream.handle))
+
+    def replay(self, stream=None):
+        """Run the captured launches synchronously or, if `stream` is given, asynchronously on it."""
+        self._stream = stream
+        self._runtime.triton_cpu_graph_launch(ctypes.c_void_p(self.handle),
+                                              ctypes.c_void_p(stream.handle if stream is not None else None))
+
+    def __len__(self):
+        return self._runtime.triton_cpu_graph_size(ctypes.c_void_p(self.handle))
+
+    def __del__(self):
+        if getattr(self, "handle", None):
+            # Replays on a stream refer to the graph.
+            if getattr(self, "_stream", None) is not None:
+                self._stream.synchronize()
+            self._runtime.triton_cpu_graph_destroy(ctypes.c_void_p(self.handle))
+            self.handle = None
+
+
+class CPURangeDependency:
+    """A dependency of programs of consumer launches on chunks of programs of producer launches.
+
+    Producer programs are split into chunks of consecutive linear program ids, and each consumer program
+    waits only for the chunk it reads instead of the whole producer launch, so it reads the chunk while it
+    is still in the cache. The consumer has to run on another stream than the producer:
+
+        dep = CPURangeDependency()
+        with stream(s1), dep.produce(programs_per_chunk=4):
+            producer[(64, )](x, y)
+        with stream(s2), dep.consume(programs_per_chunk=2):
+            consumer[(32, )](y, z)  # program i waits for producer programs [i // 2 * 4, i // 2 * 4 + 4)
+
+    The r-th producer launch is paired with the r-th consumer launch in the order they run on their streams,
+    so the pair can be launched repeatedly, e.g. for double-buffered pipelines, with the same producer grid.
+    A consumer launch waits until its producer launch runs, so the producer must be launched too. Like kernel
+    arguments, the dependency must be kept alive until the streams are synchronized. Batches of launches don't
+    track dependencies, and producers ignore out_of_core_slices.
+    """
+
+    def __init__(self):
+        self._runtime = CPUUtils()._get_runtime()
+        self.handle = self._runtime.triton_cpu_range_dep_create()
+
+    @staticmethod
+    def _set_current(deps):
+        _thread_local.range_deps = deps
+        (producer, producer_chunk), (consumer, consumer_chunk) = deps
+        CPUUtils()._get_runtime().triton_cpu_range_dep_set_current(
+            producer.handle if producer else None, producer_chunk, consumer.handle if consumer else None,
+            consumer_chunk)
+
+    @contextlib.contextmanager
+    def _use(self, idx, programs_per_chunk):
+        if programs_per_chunk <= 0:
+            raise ValueError(f"programs_per_chunk should be positive, got {programs_per_chunk}")
+        prev = getattr(_thread_local, "range_deps", ((None, 0), (None, 0)))
+        deps = list(prev)
+        deps[idx] = (self, programs_per_chunk)
+        CPURangeDependency._set_current(tuple(deps))
+        try:
+            yield self
+        finally:
+            CPURangeDependency._set_current(prev)
+
+    def produce(self, programs_per_chunk):
+        """Make launches from the current thread publish chunks of `programs_per_chunk` programs."""
+        return self._use(0, programs_per_chunk)
+
+    def consume(self, programs_per_chunk):
+        """Make programs of launches from the current thread wait for their producer chunk, taking
+        `programs_per_chunk` consecutive programs per chunk."""
+        return self._use(1, programs_per_chunk)
+
+    def __del__(self):
+        if getattr(self, "handle", None):
+            self._runtime.triton_cpu_range_dep_destroy(ctypes.c_void_p(self.handle))
+            self.handle = None
+
+
+# ------------------------
+# Launch trace
+# ------------------------
+
+
+class LaunchRecord(ctypes.Structure):
+    # Keep in sync with LaunchRecord in runtime_launch_trace.cpp.
+    _fields_ = [
+        ("kernel", ctypes.c_void_p),
+        ("correlation_id", ctypes.c_uint64),
+        ("start_ns", ctypes.c_int64),
+        ("end_ns", ctypes.c_int64),
+        ("num_programs", ctypes.c_uint64),
+        ("grid_x", ctypes.c_uint32),
+        ("grid_y", ctypes.c_uint32),
+        ("grid_z", ctypes.c_uint32),
+        ("num_threads", ctypes.c_int32),
+        ("num_counters", ctypes.c_int32),
+        ("counters", ctypes.c_uint64 * 8),
+    ]
+
+
+class CPULaunchTrace:
+    """A reader of the launch trace, a ring buffer of launch timestamps recorded by launchers.
+
+    While the trace is enabled, every launch records its kernel pointer, start and end
+    steady clock timestamps in nanoseconds, grid, number of programs and number of threads.
+    Each reader has its own cursor and only sees launches recorded after it was created.
+    The buffer keeps the last TRITON_CPU_LAUNCH_TRACE_SIZE launches, so read it often
+    enough to not miss records.
+
+    While hardware event counting is enabled with enable_counters, thread pool launches
+    also record event counts summed over their threads, see counter_names for the events.
+    Counts are unavailable for OpenMP launches and when perf events are restricted.
+    """
+
+    _read_chunk = 256
+
+    def __init__(self):
+        self._runtime = CPUUtils()._get_runtime()
+        # Records embed counter buffers of the runtime's capacity.
+        assert len(LaunchRecord().counters) == self._runtime.triton_cpu_perf_max_counters()
+        self._cursor = ctypes.c_uint64(self._runtime.triton_cpu_launch_trace_position())
+
+    @staticmethod
+    def enable(enable=True):
+        CPUUtils()._get_runtime().triton_cpu_launch_trace_enable(ctypes.c_bool(enable))
+
+    @staticmethod
+    def enable_counters(enable=True):
+        CPUUtils()._get_runtime().triton_cpu_perf_enable(ctypes.c_bool(enable))
+
+    @staticmethod
+    def counter_names():
+        """Return names of hardware events counted for launches, in the order of LaunchRecord.counters."""
+        runtime = CPUUtils()._get_runtime()
+        return [runtime.triton_cpu_perf_counter_name(i).decode() for i in range(runtime.triton_cpu_perf_num_counters())]
+
+    @staticmethod
+    def counters(record):
+        """Return a dict of hardware event counts of a launch record."""
+        names = CPULaunchTrace.counter_names()
+        return {names[i]: record.counters[i] for i in range(min(record.num_counters, len(names)))}
+
+    def read(self):
+        """Return records of launches completed since the previous read."""
+        res = []
+        buf = (LaunchRecord * self._read_chunk)()
+        while True:
+            count = self._runtime.triton_cpu_launch_trace_read(ctypes.byref(self._cursor), buf,
+                                                               ctypes.c_size_t(self._read_chunk))
+            res.extend(LaunchRecord.from_buffer_copy(rec) for rec in buf[:count])
+            if count < self._read_chunk:
+                return res
+
+
+class TimelineEvent(ctypes.Structure):
+    # Keep in sync with TimelineEvent in runtime_thread_pool.cpp.
+    _fields_ = [
+        ("job", ctypes.c_uint64),
+        ("thread", ctypes.c_int64),
+        ("cpu", ctypes.c_int32),
+        ("begin", ctypes.c_uint64),
+        ("end", ctypes.c_uint64),
+        ("start_ns", ctypes.c_int64),
+        ("end_ns", ctypes.c_int64),
+    ]
+
+
+class CPUTimeline:
+    """A per-thread timeline of program ranges executed by the thread pool.
+
+    While recording, every chunk of programs run by a pool or submitting thread is
+    timestamped, which shows stragglers and idle time within launches. Programs are
+    numbered in the traversal order of the launch, see program_order:
+
+        timeline = CPUTimeline()
+        with timeline.record():
+            kernel[grid](x, y)
+        timeline.save_chrome_trace("trace.json")
+    """
+
+    _read_chunk = 1024
+
+    def __init__(self):
+        self._runtime = CPUUtils()._get_runtime()
+        self.events = []
+
+    @contextlib.contextmanager
+    def record(self):
+        self._read()
+        self._runtime.triton_cpu_timeline_enable(ctypes.c_bool(True))
+        try:
+            yield self
+        finally:
+            self._runtime.triton_cpu_timeline_enable(ctypes.c_bool(False))
+            self.events.extend(self._read())
+
+    def _read(self):
+        res = []
+        buf = (TimelineEvent * self._read_chunk)()
+        while True:
+            count = self._runtime.triton_cpu_timeline_read(buf, ctypes.c_size_t(self._read_chunk))
+            res.extend(TimelineEvent.from_buffer_copy(event) for event in buf[:count])
+            if count < self._read_chunk:
+                return res
+
+    def to_chrome_trace(self):
+        """Return the events in the Chrome trace event format, which Perfetto can load too."""
+        if not self.events:
+            return {"traceEvents": []}
+        origin = min(event.start_ns for event in self.events)
+        pid = os.getpid()
+        trace_events = [{
+            "name": f"job {event.job}",
+            "ph": "X",
+            "pid": pid,
+            "tid": event.thread,
+            "ts": (event.start_ns - origin) / 1000,
+            "dur": (event.end_ns - event.start_ns) / 1000,
+            "args": {"programs": [event.begin, event.end], "cpu": event.cpu},
+        } for event in self.events]
+        return {"traceEvents": trace_events, "displayTimeUnit": "ns"}
+
+    def save_chrome_trace(self, path):
+        import json
+        with open(path, "w") as f:
+            json.dump(self.to_chrome_trace(), f)
+
+
+class RecordEvent(ctypes.Structure):
+    # Keep in sync with RecordEvent in runtime_proton_record.cpp.
+    _fields_ = [
+        ("kernel", ctypes.c_char_p),
+        ("region_id", ctypes.c_int32),
+        ("is_start", ctypes.c_int32),
+        ("pid_x", ctypes.c_uint32),
+        ("pid_y", ctypes.c_uint32),
+        ("pid_z", ctypes.c_uint32),
+        ("thread", ctypes.c_int64),
+        ("counter", ctypes.c_uint64),
+    ]
+
+
+class CPURegionRecords:
+    """A reader of events of proton.record ops executed by kernels.
+
+    Kernels record the cycle counter (rdtsc on x86, cntvct on AArch64) at each
+    proton.record op into a buffer of the executing thread. Start and end events of a
+    region are paired per kernel, region and program to measure phases of a kernel, e.g.
+    loads, dots and the epilogue:
+
+        records = CPURegionRecords()
+        kernel[grid](x, y)  # calls pl.record(True, 0) ... pl.record(False, 0)
+        print(records.region_times_ns())
+
+    Each thread keeps up to TRITON_CPU_PROTON_RECORD_SIZE events, later events are dropped
+    until clear() is called.
+    """
+
+    _read_chunk = 4096
+
+    def __init__(self):
+        self._runtime = CPUUtils()._get_runtime()
+        self._runtime.triton_cpu_proton_record_clear()
+
+    def read(self):
+        """Return events recorded since the previous read."""
+        res = []
+        buf = (RecordEvent * self._read_chunk)()
+        while True:
+            count = self._runtime.triton_cpu_proton_record_read(buf, ctypes.c_size_t(self._read_chunk))
+            res.extend(RecordEvent.from_buffer_copy(event) for event in buf[:count])
+            if count < self._read_chunk:
+                return res
+
+    def clear(self):
+        """Discard all recorded events. It must not be called while kernels run."""
+        self._runtime.triton_cpu_proton_record_clear()
+
+    @property
+    def dropped(self):
+        return self._runtime.triton_cpu_proton_record_dropped()
+
+    @property
+    def frequency(self):
+        """Counter ticks per second."""
+        return self._runtime.triton_cpu_proton_record_frequency()
+
+    def region_times_ns(self, events=None):
+        """Return the total time in nanoseconds spent in each region, keyed by (kernel, region_id).
+
+        Regions are summed over all programs and nested regions are counted in each enclosing region.
+        """
+        if events is None:
+            events = self.read()
+        open_events = {}
+        totals = {}
+        for event in events:
+            key = (event.kernel.decode(), event.region_id)
+            program = (event.thread, event.pid_x, event.pid_y, event.pid_z)
+            if event.is_start:
+                open_events[key + program] = event.counter
+            elif key + program in open_events:
+                ticks = event.counter - open_events.pop(key + program)
+                totals[key] = totals.get(key, 0) + ticks
+        return {key: ticks * 1e9 / self.frequency for key, ticks in totals.items()}
+
+
+class CPURoofline:
+    """Achieved throughput of kernels against peaks of the machine.
+
+    The compiler estimates FLOPs and global memory bytes of a program from TTCIR, see
+    program_flops and program_bytes in the kernel metadata. Combined with a measured
+    time they give the achieved GFLOP/s and GB/s and tell whether a kernel is
+    compute-bound or bandwidth-bound:
+
+        kernel = add_kernel[grid](x, y, out, n, BLOCK_SIZE=1024)
+        ms = triton.testing.do_bench(lambda: add_kernel[grid](x, y, out, n, BLOCK_SIZE=1024))
+        print(CPURoofline().report(kernel, grid, ms))
+
+    Peaks are given by TRITON_CPU_PEAK_GFLOPS and TRITON_CPU_PEAK_GBPS, otherwise they
+    are measured once with a large fp32 matmul and a large copy in torch. Costs of loops
+    with unknown trip counts are counted for a single iteration, such reports are marked
+    as estimates.
+    """
+
+    _measured_peaks = None
+
+    def __init__(self, peak_gflops=None, peak_gbps=None):
+        if peak_gflops is None and (env := os.getenv("TRITON_CPU_PEAK_GFLOPS")):
+            peak_gflops = float(env)
+        if peak_gbps is None and (env := os.getenv("TRITON_CPU_PEAK_GBPS")):
+            peak_gbps = float(env)
+        if peak_gflops is None or peak_gbps is None:
+            measured_gflops, measured_gbps = self._measure_peaks()
+            peak_gflops = measured_gflops if peak_gflops is None else peak_gflops
+            peak_gbps = measured_gbps if peak_gbps is None else peak_gbps
+        self.peak_gflops = peak_gflops
+        self.peak_gbps = peak_gbps
+
+    @classmethod
+    def _measure_peaks(cls):
+        if cls._measured_peaks is None:
+            import torch
+
+            def best_time(fn, reps=5):
+                fn()
+                times = []
+                for _ in range(reps):
+                    start = time.perf_counter()
+                    fn()
+                    times.append(time.perf_counter() - start)
+                return min(times)
+
+            n = 2048
+            a = torch.rand((n, n), dtype=torch.float32)
+            b = torch.rand((n, n), dtype=torch.float32)
+            gflops = 2 * n**3 / best_time(lambda: torch.mm(a, b)) * 1e-9
+            # Much larger than LLC, so the copy is bound by DRAM bandwidth.
+            src = torch.empty(64 * 1024 * 1024, dtype=torch.float32)
+            dst = torch.empty_like(src)
+            gbps = 2 * src.numel() * src.element_size() / best_time(lambda: dst.copy_(src)) * 1e-9
+            cls._measured_peaks = (gflops, gbps)
+        return cls._measured_peaks
+
+    def report(self, kernel, grid, ms):
+        """Return the throughput of a launch of a compiled kernel over the grid taking ms milliseconds."""
+        grid = tuple(grid) + (1, ) * (3 - len(grid))
+        num_programs = grid[0] * grid[1] * grid[2]
+        metadata = kernel.metadata
+        flops = getattr(metadata, "program_flops", 0) * num_programs
+        nbytes = getattr(metadata, "program_bytes", 0) * num_programs
+        seconds = ms * 1e-3
+        gflops = flops / seconds * 1e-9 if seconds > 0 else 0.0
+        gbps = nbytes / seconds * 1e-9 if seconds > 0 else 0.0
+        intensity = flops / nbytes if nbytes else float("inf")
+        # The ridge point separates bandwidth-bound and compute-bound intensities.
+        ridge = self.peak_gflops / self.peak_gbps
+        return CPURooflineReport(name=metadata.name, flops=flops, bytes=nbytes, ms=ms, gflops=gflops, gbps=gbps,
+                                 intensity=intensity, bound="compute" if intensity >= ridge else "memory",
+                                 peak_gflops=self.peak_gflops, peak_gbps=self.peak_gbps,
+                                 exact=getattr(metadata, "program_cost_exact", False))
+
+
+@dataclass
+class CPURooflineReport:
+    name: str
+    flops: float
+    bytes: float
+    ms: float
+    gflops: float
+    gbps: float
+    intensity: float
+    bound: str
+    peak_gflops: float
+    peak_gbps: float
+    exact: bool
+
+    def __str__(self):
+        estimate = "" if self.exact else " (estimate)"
+        return (f"{self.name}: {self.ms:.3f} ms, {self.gflops:.1f} GFLOP/s ({self.gflops / self.peak_gflops:.1%} "
+                f"of {self.peak_gflops:.0f}), {self.gbps:.1f} GB/s ({self.gbps / self.peak_gbps:.1%} of "
+                f"{self.peak_gbps:.0f}), {self.intensity:.2f} FLOP/byte, {self.bound}-bound{estimate}")
+
+
+# ------------------------
+# Autotuning
+# ------------------------
+
+
+def _gemm_blocks(kwargs):
+    """Return the (M, N, K) block sizes of a GEMM config, or None if the config doesn't have them."""
+    blocks = []
+    for dim in "MNK":
+        block = next((kwargs[name] for name in (f"BLOCK_SIZE_{dim}", f"BLOCK_{dim}") if name in kwargs), None)
+        if not isinstance(block, int):
+            return None
+        blocks.append(block)
+    return tuple(blocks)
+
+
+def prune_configs_by_cache_model(configs, nargs, **kwargs):
+    """Discard GEMM configs that can't perform well on the host CPU before they are benchmarked.
+
+    This is the default early_config_prune of autotuned kernels. Configs are GEMM ones if they have
+    BLOCK_SIZE_{M,N,K} or BLOCK_{M,N,K} meta-parameters, others are kept. The dtype is the dtype of the
+    first tensor argument. A GEMM config is discarded when:
+      * the working set of its A, B and fp32 C tiles doesn't fit the L2 cache of a core,
+      * the host has AMX for the dtype, other configs have blocks of whole AMX tiles and it doesn't,
+      * one of its blocks is larger than the problem size rounded up to a power of two, which other
+        configs cover with less padding, if the problem has M, N and K arguments.
+    Rules are skipped when they would discard all GEMM configs, except that configs with the smallest
+    working set are kept when none fits the cache.
+    """
+    gemm_configs = [(config, _gemm_blocks(config.kwargs)) for config in configs]
+    if all(blocks is None for _, blocks in gemm_configs):
+        return configs
+    nargs = {**nargs, **kwargs}
+    tensor = next((arg for arg in nargs.values() if hasattr(arg, "element_size") and hasattr(arg, "dtype")), None)
+    if tensor is None:
+        return configs
+    elem_size = tensor.element_size()
+    dtype = str(tensor.dtype).split(".")[-1]
+    props = _read_device_properties()
+
+    def working_set(blocks):
+        m, n, k = blocks
+        return (m * k + k * n) * elem_size + m * n * 4
+
+    def fits_cache(blocks):
+        return not props["l2_cache_size"] or working_set(blocks) <= props["l2_cache_size"]
+
+    amx = {"bfloat16": props["amx_bf16"], "float16": props["amx_fp16"], "int8": props["amx_int8"]}.get(dtype, False)
+
+    def fits_amx(blocks):
+        # Tiles are 16 rows of 64 bytes, i.e. 16 x 16 C tiles and 16 x (64 / elem_size) A tiles.
+        m, n, k = blocks
+        return m % 16 == 0 and n % 16 == 0 and k % (64 // elem_size) == 0
+
+    sizes = [nargs.get(dim) for dim in "MNK"]
+
+    def fits_problem(blocks):
+        if not all(isinstance(size, int) and size > 0 for size in sizes):
+            return True
+        return all(block <= triton.next_power_of_2(size) for block, size in zip(blocks, sizes))
+
+    gemms = [blocks for _, blocks in gemm_configs if blocks is not None]
+    if not any(fits_cache(blocks) for blocks in gemms):
+        smallest = min(working_set(blocks) for blocks in gemms)
+        rules = [lambda blocks: working_set(blocks) == smallest]
+    else:
+        rules = [fits_cache]
+    if amx:
+        rules.append(fits_amx)
+    rules.append(fits_problem)
+    kept = gemm_configs
+    for rule in rules:
+        passed = [(config, blocks) for config, blocks in kept if blocks is None or rule(blocks)]
+        if any(blocks is not None for _, blocks in passed):
+            kept = passed
+    kept = {id(config) for config, _ in kept}
+    return [config for config in configs if id(config) in kept]
+
+
+# ------------------------
+# Benchmarking
+# ------------------------
+
+
+def _llc_size():
+    """Return the size of the largest cache of the machine in bytes, or None if it's unknown."""
+    sizes = [cache["size"] for cache in _read_caches()]
+    return max(sizes) if sizes else None
+
+
+def _tensor_span(tensor):
+    """Return the address and the size in bytes of the memory spanned by a tensor."""
+    nbytes = tensor.element_size()
+    for size, stride in zip(tensor.shape, tensor.stride()):
+        if size == 0:
+            return tensor.data_ptr(), 0
+        nbytes += (size - 1) * abs(stride) * tensor.element_size()
+    return tensor.data_ptr(), nbytes
+
+
+class CPUBenchmarker:
+    """A benchmarker of CPU kernels with targeted cache flushing and stable statistics.
+
+    Compared to triton.testing.do_bench it
+      * flushes only the memory of the given tensors with clflush (dc civac on AArch64) when
+        flush is a list of tensors, instead of overwriting a buffer larger than the LLC;
+      * keeps warming up after the warmup time while the median time of consecutive windows
+        of runs changes by more than settle_tolerance, e.g. while the core frequency ramps up;
+      * runs a sweep over thread counts when num_threads is given, fn is then called with
+        the num_threads keyword and results are keyed by the number of threads:
+
+            bench = CPUBenchmarker()
+            bench.do_bench(lambda: kernel[grid](x, y), flush=[x, y], return_mode="stats")
+            bench.do_bench(lambda num_threads: kernel[grid](x, y, num_threads=num_threads),
+                           num_threads=[1, 2, 4, 8])
+
+    return_mode "stats" returns a dict with the median, the mean, the standard deviation and
+    percentiles of times in ms.
+    """
+
+    _stats_quantiles = {"p10": 0.1, "p25": 0.25, "p75": 0.75, "p90": 0.9}
+
+    def __init__(self, measure_time_with_hooks=True, settle_tolerance=0.02, settle_window=10, max_warmup_ms=2000):
+        self.measure_time_with_hooks = measure_time_with_hooks
+        self.settle_tolerance = settle_tolerance
+        self.settle_window = settle_window
+        self.max_warmup_ms = max_warmup_ms
+
+    def flush(self, tensors):
+        """Evict memory of tensors from caches, return False if the target can't flush caches."""
+        runtime = CPUUtils()._get_runtime()
+        res = True
+        for tensor in tensors:
+            ptr, nbytes = _tensor_span(tensor)
+            res = runtime.triton_cpu_flush_cache(ctypes.c_void_p(ptr), ctypes.c_size_t(nbytes)) and res
+        return res
+
+    def do_bench(self, fn, warmup=25, rep=100, grad_to_none=None, quantiles=None, return_mode="median", flush=True,
+                 num_threads=None, measure_time_with_hooks=None):
+        """Benchmark fn and return its time in ms like triton.testing.do_bench.
+
+        flush is True to evict caches with a buffer larger than the LLC before each run, a list of
+        tensors to flush only their memory, or False to measure with warm caches.
+        """
+        assert return_mode in ["min", "max", "mean", "median", "all", "stats"]
+        if num_threads is not None:
+            return {
+                n: self.do_bench(functools.partial(fn, num_threads=n), warmup, rep, grad_to_none, quantiles,
+                                 return_mode, flush, None, measure_time_with_hooks)
+                for n in num_threads
+            }
+        if measure_time_with_hooks is None:
+            measure_time_with_hooks = self.measure_time_with_hooks
+        driver = triton.runtime.driver.active
+        di = driver.get_device_interface()
+
+        if flush is True:
+            cache = driver.get_empty_cache_for_benchmark()
+            clear_cache = lambda: driver.clear_cache(cache)
+        elif flush:
+            tensors = list(flush)
+            clear_cache = lambda: self.flush(tensors)
+        else:
+            clear_cache = lambda: None
+
+        fn()
+        di.synchronize()
+        start = time.perf_counter()
+        for _ in range(5):
+            fn()
+        di.synchronize()
+        estimate_ms = max((time.perf_counter() - start) * 1000 / 5, 1e-6)
+
+        self._warmup(fn, di, warmup, estimate_ms, window=max(3, min(self.settle_window, int(rep / estimate_ms))))
+        if measure_time_with_hooks:
+            di.enable_hook_timing()
+
+        n_repeat = max(1, int(rep / estimate_ms))
+        start_event = [di.Event(enable_timing=True) for _ in range(n_repeat)]
+        end_event = [di.Event(enable_timing=True) for _ in range(n_repeat)]
+        for i in range(n_repeat):
+            if grad_to_none is not None:
+                for x in grad_to_none:
+                    x.grad = None
+            clear_cache()
+            start_event[i].record()
+            fn()
+            end_event[i].record()
+        di.synchronize()
+        times = [s.elapsed_time(e) for s, e in zip(start_event, end_event)]
+        if return_mode == "stats" and quantiles is None:
+            return self._stats(times)
+        from triton.testing import _summarize_statistics
+        return _summarize_statistics(times, quantiles, return_mode)
+
+    def _warmup(self, fn, di, warmup, estimate_ms, window):
+        import statistics
+
+        def run_window():
+            times = []
+            for _ in range(window):
+                start = time.perf_counter()
+                fn()
+                di.synchronize()
+                times.append(time.perf_counter() - start)
+            return statistics.median(times)
+
+        for _ in range(max(1, int(warmup / estimate_ms))):
+            fn()
+        di.synchronize()
+        # Frequency transitions take milliseconds, run windows until their times settle.
+        deadline = time.perf_counter() + self.max_warmup_ms * 1e-3
+        prev = run_window()
+        while time.perf_counter() < deadline:
+            cur = run_window()
+            if abs(cur - prev) <= self.settle_tolerance * prev:
+                break
+            prev = cur
+
+    def _stats(self, times):
+        import statistics
+        from triton.testing import _quantile
+        res = {
+            "median": statistics.median(times),
+            "mean": statistics.mean(times),
+            "std": statistics.pstdev(times),
+            "min": min(times),
+            "max": max(times),
+            "n": len(times),
+        }
+        res.update(zip(self._stats_quantiles, _quantile(times, list(self._stats_quantiles.values()))))
+        return res
 
 
 # ------------------------
@@ -112,67 +1243,21 @@ def ty_to_cpp(ty):
     }[ty]
 
 
-def make_launcher(constants, signature, ids):
-    # Record the end of regular arguments;
-    # subsequent arguments are architecture-specific descriptors.
-    def _serialize_signature(sig):
-        if isinstance(sig, tuple):
-            return ','.join(map(_serialize_signature, sig))
-        return sig
-
-    def _extracted_type(ty):
-        if isinstance(ty, tuple):
-            val = ','.join(map(_extracted_type, ty))
-            return f"[{val}]"
-        if ty[0] == '*':
-            return "PyObject*"
-        if ty in ("constexpr"):
-            return "PyObject*"
-        return ty_to_cpp(ty)
-
-    def format_of(ty):
-        if isinstance(ty, tuple):
-            val = ''.join(map(format_of, ty))
-            return f"({val})"
-        if ty[0] == '*':
-            return "O"
-        if ty in ("constexpr"):
-            return "O"
-        return {
-            "float": "f",
-            "double": "d",
-            "long": "l",
-            "int8_t": "b",
-            "int16_t": "h",
-            "int32_t": "i",
-            "int64_t": "L",
-            "uint8_t": "B",
-            "uint16_t": "H",
-            "uint32_t": "I",
-            "uint64_t": "K",
-        }[ty_to_cpp(ty)]
-
-    args_format = ''.join([format_of(ty) for ty in signature.values()])
-    format = "iiiOKOOOO" + args_format
-
-    signature = ','.join(map(_serialize_signature, signature.values()))
-    signature = list(filter(bool, signature.split(',')))
-    signature = {i: s for i, s in enumerate(signature)}
-
-    arg_decls = ', '.join(f"{ty_to_cpp(ty)} arg{i}" for i, ty in signature.items() if ty != "constexpr")
-
-    arg_ptrs_list = ', '.join(f"&arg{i}" for i in signature.keys())
-    kernel_fn_args = [i for i, ty in signature.items() if i not in constants and ty != "constexpr"]
-    signature_without_constexprs = {i: ty for i, ty in signature.items() if ty != "constexpr"}
-    kernel_fn_args_list = ', '.join(f"arg{i}" for i in kernel_fn_args)
-    kernel_fn_arg_types = ', '.join([f"{ty_to_cpp(signature[i])}" for i in kernel_fn_args] + ["uint32_t"] * 6)
-
-    # generate glue code
-    src = f"""
+def _make_launcher_src(kernel_fn_arg_types, kernel_call_arg_fields, kernel_call_args_list, launch_src,
+                       extra_methods=""):
+    # Sources shared by the specialized and the generic launchers. The
+    # launcher provides the kernel arguments part of the kernel pointer type,
+    # the fields holding the kernel arguments in KernelCallArgs, the kernel
+    # arguments of a kernel call, the launch entry point and entries of
+    # additional module methods.
+    max_perf_counters = CPUUtils()._get_runtime().triton_cpu_perf_max_counters()
+    return f"""
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #ifdef _OPENMP
@@ -182,6 +1267,7 @@ def make_launcher(constants, signature, ids):
 #include <stdio.h>
 #include <string>
 #include <memory>
+#include <vector>
 
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <Python.h>
@@ -206,13 +1292,224 @@ inline std::optional<int64_t> getIntEnv(const std::string &env) {{
   return result;
 }}
 
-using kernel_ptr_t = void(*)({kernel_fn_arg_types});
+// Kernel range entry point, it runs programs [x_begin, x_end) x y x z.
+// Arguments after the kernel arguments: x_begin, x_end, y, z, gridX, gridY, gridZ.
+using kernel_ptr_t = void(*)({kernel_fn_arg_types + ', ' if kernel_fn_arg_types else ''}uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+
+// Persistent thread pool provided by libTritonCPURuntime.
+extern "C" void triton_cpu_parallel_for(size_t n, int32_t num_threads, int32_t schedule, int32_t align,
+                                        int32_t numa_node, int32_t priority, void (*fn)(void *, size_t, size_t),
+                                        void *ctx);
+extern "C" int32_t triton_cpu_acquire_threads(int32_t num_threads, int32_t priority);
+extern "C" void triton_cpu_release_threads(int32_t num_threads);
+extern "C" int32_t triton_cpu_get_numa_node(const void *ptr);
+extern "C" void triton_cpu_set_affinity(const char *cpu_mask, int32_t placement, bool one_thread_per_core,
+                                        int32_t core_type);
+extern "C" int32_t triton_cpu_get_adaptive_num_threads(const void *kernel, size_t n, int32_t max_threads,
+                                                       int64_t cost_ns);
+extern "C" void triton_cpu_record_launch_time(const void *kernel, size_t n, int32_t num_threads, int64_t ns);
+extern "C" bool triton_cpu_launch_trace_enabled();
+extern "C" uint64_t triton_cpu_launch_trace_get_correlation_id();
+extern "C" void triton_cpu_launch_trace_record(const void *kernel, uint64_t correlation_id, int64_t start_ns,
+                                               int64_t end_ns, uint32_t grid_x, uint32_t grid_y, uint32_t grid_z,
+                                               int32_t num_threads, const uint64_t *counters, int32_t num_counters);
+extern "C" int32_t triton_cpu_perf_get_last_job(uint64_t *values);
+extern "C" void triton_cpu_stats_record_launch(const void *kernel, uint64_t num_programs, int64_t ns);
+extern "C" void triton_cpu_stream_enqueue(void *stream, void (*fn)(void *), void *ctx, void (*destroy)(void *));
+extern "C" void triton_cpu_range_dep_get_current(void **producer, int64_t *producer_chunk, void **consumer,
+                                                 int64_t *consumer_chunk);
+extern "C" uint64_t triton_cpu_range_dep_begin_producer(void *dep, size_t num_programs, size_t chunk);
+extern "C" void triton_cpu_range_dep_mark_started(void *dep, uint64_t round);
+extern "C" void triton_cpu_range_dep_signal(void *dep, size_t begin, size_t end);
+extern "C" uint64_t triton_cpu_range_dep_begin_consumer(void *dep);
+extern "C" void triton_cpu_range_dep_wait(void *dep, uint64_t round, size_t begin, size_t end, size_t chunk);
+extern "C" void *triton_cpu_slice_advisor_create(const void *const *ptrs, const size_t *sizes, int32_t num_regions,
+                                                 size_t num_slices);
+extern "C" void triton_cpu_slice_advisor_begin(void *advisor, size_t slice);
+extern "C" void triton_cpu_slice_advisor_destroy(void *advisor);
+extern "C" void triton_cpu_print_flush();
+extern "C" uint64_t triton_cpu_flush_denormals();
+extern "C" void triton_cpu_restore_fp_env(uint64_t state);
+
+// Keep in sync with runtime_thread_pool.cpp.
+constexpr int32_t NUMA_DISABLED = -2;
+constexpr int32_t NUMA_ANY_NODE = -1;
+// Capacity of counter buffers of the runtime, see runtime_perf_counters.h.
+constexpr int MAX_PERF_COUNTERS = {max_perf_counters};
+
+// Keep in sync with Schedule in runtime_thread_pool.cpp.
+enum class Schedule : int32_t {{
+  Static = 0,
+  Steal = 1,
+}};
+
+// Keep in sync with Placement in runtime_thread_pool.cpp.
+enum class Placement : int32_t {{
+  None = 0,
+  Compact = 1,
+  Scatter = 2,
+}};
+
+// Keep in sync with CoreType in runtime_thread_pool.cpp.
+enum class CoreType : int32_t {{
+  Any = 0,
+  Performance = 1,
+  Efficiency = 2,
+}};
+
+// Memory of a pointer argument of an out-of-core launch.
+struct MemoryRegion {{
+  const void *ptr;
+  size_t size;
+}};
+
+struct LaunchConfig {{
+  int num_threads = 0;
+  // Choose the number of threads from the grid size when num_threads is 0.
+  // The program cost is program_cost_ns if positive, otherwise it is
+  // measured by the runtime.
+  bool adaptive_num_threads = false;
+  int64_t program_cost_ns = 0;
+  bool use_omp = false;
+  // Launches with a higher priority get threads first when the pool is busy.
+  int32_t priority = 0;
+  // Correlation id of the launch in the launch trace, taken from the
+  // submitting thread.
+  uint64_t correlation_id = 0;
+  Schedule schedule = Schedule::Static;
+  // Programs are split between threads at multiples of program_align, so
+  // outputs of neighbouring programs sharing a cache line are written by a
+  // single thread, see align_output_lines in compiler.py.
+  int32_t program_align = 1;
+  // When non-zero, programs of each XY plane are traversed in bands of
+  // program_tile rows, column by column within a band. Consecutive programs
+  // then share the same X and neighbouring Y ids, which improves reuse of
+  // operand tiles in matmul-like kernels.
+  uint32_t program_tile = 0;
+  // When set, programs of each XY plane are traversed along a generalized
+  // Hilbert curve, so that programs running close in time on a thread have
+  // neighbouring X and Y ids in both directions.
+  bool hilbert_order = false;
+  // Flush denormals to zero on the threads running the programs, see
+  // flush_denormals in compiler.py.
+  bool flush_denormals = false;
+  // NUMA node to run the launch on, NUMA_ANY_NODE to spread it across
+  // all nodes, or NUMA_DISABLED to ignore the topology.
+  int32_t numa_node = NUMA_DISABLED;
+  // CPUs the pool workers are restricted to, in the Linux cpulist format.
+  const char *cpu_mask = nullptr;
+  Placement placement = Placement::None;
+  bool one_thread_per_core = false;
+  // Type of cores of hybrid CPUs the pool workers are restricted to.
+  CoreType core_type = CoreType::Any;
+  // When non-zero, the grid runs in this many consecutive slices of programs,
+  // while the runtime reads ahead the matching slice of memory_regions for
+  // the next one, see triton_cpu_slice_advisor_begin.
+  int out_of_core_slices = 0;
+  std::vector<MemoryRegion> memory_regions;
+}};
 
 typedef struct _DevicePtrInfo {{
   void* dev_ptr;
   bool valid;
 }} DevicePtrInfo;
 
+// DLPack structs, see dlpack.h.
+typedef struct {{
+  int32_t device_type;
+  int32_t device_id;
+}} DLDevice;
+
+typedef struct {{
+  uint8_t code;
+  uint8_t bits;
+  uint16_t lanes;
+}} DLDataType;
+
+typedef struct {{
+  void *data;
+  DLDevice device;
+  int32_t ndim;
+  DLDataType dtype;
+  int64_t *shape;
+  int64_t *strides;
+  uint64_t byte_offset;
+}} DLTensor;
+
+typedef struct DLManagedTensor {{
+  DLTensor dl_tensor;
+  void *manager_ctx;
+  void (*deleter)(struct DLManagedTensor *self);
+}} DLManagedTensor;
+
+// Device types of DLPack tensors in host memory: CPU, CUDA host and CUDA
+// managed memory.
+static inline bool isHostDLDevice(int32_t device_type) {{
+  return device_type == 1 || device_type == 3 || device_type == 13;
+}}
+
+// Read the address of a DLPack capsule, which isn't consumed, so the producer
+// keeps owning the memory.
+static bool getDLPackPointer(PyObject *capsule, void *&ptr) {{
+  auto *tensor = static_cast<DLManagedTensor *>(PyCapsule_GetPointer(capsule, "dltensor"));
+  if (!tensor)
+    return false;
+  if (!isHostDLDevice(tensor->dl_tensor.device.device_type)) {{
+    PyErr_SetString(PyExc_ValueError, "DLPack pointer arguments must be in host memory");
+    return false;
+  }}
+  ptr = static_cast<char *>(tensor->dl_tensor.data) + tensor->dl_tensor.byte_offset;
+  return true;
+}}
+
+// Address of a host array given by the array interface, DLPack or the buffer
+// protocol. Returns false, with a Python error set on failures of supported
+// objects. Kernels may write to any pointer argument, so read-only arrays are
+// rejected.
+static bool getHostArrayPointer(PyObject *obj, void *&ptr) {{
+  static const char *readOnlyError = "Pointer arguments must be writable host arrays";
+  if (PyObject *iface = PyObject_GetAttrString(obj, "__array_interface__")) {{
+    PyObject *data = PyDict_Check(iface) ? PyDict_GetItemString(iface, "data") : NULL;
+    bool ok = data && PyTuple_Check(data) && PyTuple_GET_SIZE(data) > 1;
+    if (ok) {{
+      ptr = PyLong_AsVoidPtr(PyTuple_GET_ITEM(data, 0));
+      int readOnly = PyObject_IsTrue(PyTuple_GET_ITEM(data, 1));
+      if (readOnly > 0)
+        PyErr_SetString(PyExc_ValueError, readOnlyError);
+      ok = readOnly == 0;
+    }} else {{
+      PyErr_SetString(PyExc_TypeError, "__array_interface__ must have a (pointer, read-only) data tuple");
+    }}
+    Py_DECREF(iface);
+    return ok && !PyErr_Occurred();
+  }}
+  PyErr_Clear();
+  if (PyCapsule_CheckExact(obj))
+    return getDLPackPointer(obj, ptr);
+  if (PyObject *dlpack = PyObject_GetAttrString(obj, "__dlpack__")) {{
+    PyObject *capsule = PyObject_CallNoArgs(dlpack);
+    Py_DECREF(dlpack);
+    if (!capsule)
+      return false;
+    bool ok = getDLPackPointer(capsule, ptr);
+    Py_DECREF(capsule);
+    return ok;
+  }}
+  PyErr_Clear();
+  if (PyObject_CheckBuffer(obj)) {{
+    Py_buffer view;
+    if (PyObject_GetBuffer(obj, &view, PyBUF_STRIDED_RO) != 0)
+      return false;
+    ptr = view.buf;
+    bool readOnly = view.readonly;
+    PyBuffer_Release(&view);
+    if (readOnly)
+      PyErr_SetString(PyExc_ValueError, readOnlyError);
+    return !readOnly;
+  }}
+  return false;
+}}
+
 static inline DevicePtrInfo getPointer(PyObject *obj, int idx) {{
   DevicePtrInfo ptr_info;
   ptr_info.dev_ptr = 0;
@@ -243,60 +1540,629 @@ static inline DevicePtrInfo getPointer(PyObject *obj, int idx) {{
     Py_DECREF(ret);  // Thanks ChatGPT!
     return ptr_info;
   }}
-  PyErr_SetString(PyExc_TypeError, "Pointer argument must be either uint64 or have data_ptr method");
+  PyErr_Clear();
+  // Host arrays without data_ptr, e.g. numpy arrays and Arrow buffers, are
+  // passed without copies through the array interface, DLPack or the buffer
+  // protocol. Their address is the same as the one specialized on, see
+  // _HostArray in jit.py.
+  if (getHostArrayPointer(obj, ptr_info.dev_ptr))
+    return ptr_info;
+  if (!PyErr_Occurred())
+    PyErr_SetString(PyExc_TypeError, "Pointer argument must be either uint64, have data_ptr method or be a host array");
   ptr_info.valid = false;
   return ptr_info;
 }}
 
-static std::unique_ptr<uint32_t[][3]> get_all_grids(uint32_t gridX, uint32_t gridY, uint32_t gridZ) {{
-  std::unique_ptr<uint32_t[][3]> grids(new uint32_t[gridX * gridY * gridZ][3]);
-  // TODO: which order would be more effective for cache locality?
-  for (uint32_t z = 0; z < gridZ; ++z) {{
-    for (uint32_t y = 0; y < gridY; ++y) {{
-      for (uint32_t x = 0; x < gridX; ++x) {{
-        grids[z * gridY * gridX + y * gridX + x][0] = x;
-        grids[z * gridY * gridX + y * gridX + x][1] = y;
-        grids[z * gridY * gridX + y * gridX + x][2] = z;
+// Floor division, like // in Python, for splits of negative extents.
+static inline int64_t floor_div2(int64_t value) {{
+  return value >= 0 ? value / 2 : -((1 - value) / 2);
+}}
+
+static inline int64_t sign(int64_t value) {{
+  return (value > 0) - (value < 0);
+}}
+
+// Find the idx-th point of the generalized Hilbert curve ("gilbert2d")
+// filling a width x height rectangle. The curve splits the rectangle into
+// two or three sub-rectangles traversed one after another, so the point is
+// found by descending into the sub-rectangle holding it, which takes a
+// logarithmic number of steps in the rectangle size. Unlike the Hilbert
+// curve, it fills rectangles of any size and stays continuous except for
+// rare diagonal steps.
+static void hilbert_point(int64_t width, int64_t height, size_t idx, uint32_t &px, uint32_t &py) {{
+  // The rectangle at (x, y) spanned by the major axis a and the minor
+  // axis b.
+  int64_t x = 0, y = 0, ax = width, ay = 0, bx = 0, by = height;
+  if (width < height) {{
+    ax = 0;
+    ay = height;
+    bx = width;
+    by = 0;
+  }}
+  while (true) {{
+    int64_t w = std::abs(ax + ay), h = std::abs(bx + by);
+    int64_t dax = sign(ax), day = sign(ay), dbx = sign(bx), dby = sign(by);
+    if (h == 1 || w == 1) {{
+      int64_t step = static_cast<int64_t>(idx);
+      px = static_cast<uint32_t>(h == 1 ? x + dax * step : x + dbx * step);
+      py = static_cast<uint32_t>(h == 1 ? y + day * step : y + dby * step);
+      return;
+    }}
+    int64_t ax2 = floor_div2(ax), ay2 = floor_div2(ay);
+    int64_t bx2 = floor_div2(bx), by2 = floor_div2(by);
+    int64_t w2 = std::abs(ax2 + ay2), h2 = std::abs(bx2 + by2);
+    // Sub-rectangles of the split as (x, y, ax, ay, bx, by).
+    int64_t parts[3][6];
+    int num_parts;
+    if (2 * w > 3 * h) {{
+      // Split long rectangles in two along the major axis, preferring even
+      // widths.
+      if ((w2 % 2) && w > 2) {{
+        ax2 += dax;
+        ay2 += day;
+      }}
+      int64_t first[6] = {{x, y, ax2, ay2, bx, by}};
+      int64_t second[6] = {{x + ax2, y + ay2, ax - ax2, ay - ay2, bx, by}};
+      std::copy(first, first + 6, parts[0]);
+      std::copy(second, second + 6, parts[1]);
+      num_parts = 2;
+    }} else {{
+      // Go up the minor axis, along the major one and back down.
+      if ((h2 % 2) && h > 2) {{
+        bx2 += dbx;
+        by2 += dby;
+      }}
+      int64_t first[6] = {{x, y, bx2, by2, ax2, ay2}};
+      int64_t second[6] = {{x + bx2, y + by2, ax, ay, bx - bx2, by - by2}};
+      int64_t third[6] = {{x + (ax - dax) + (bx2 - dbx), y + (ay - day) + (by2 - dby), -bx2, -by2,
+                          -(ax - ax2), -(ay - ay2)}};
+      std::copy(first, first + 6, parts[0]);
+      std::copy(second, second + 6, parts[1]);
+      std::copy(third, third + 6, parts[2]);
+      num_parts = 3;
+    }}
+    for (int i = 0; i < num_parts; ++i) {{
+      const int64_t *part = parts[i];
+      size_t size = static_cast<size_t>(std::abs(part[2] + part[3])) * std::abs(part[4] + part[5]);
+      if (idx < size || i == num_parts - 1) {{
+        x = part[0];
+        y = part[1];
+        ax = part[2];
+        ay = part[3];
+        bx = part[4];
+        by = part[5];
+        break;
       }}
+      idx -= size;
     }}
   }}
-  return grids;
 }}
 
-static void run_omp_kernels(uint32_t gridX, uint32_t gridY, uint32_t gridZ, int num_threads, kernel_ptr_t kernel_ptr {(', ' + arg_decls) if len(arg_decls) > 0 else ''}) {{
-  // TODO: Consider using omp collapse(3) clause for simplicity?
-  size_t N = gridX * gridY * gridZ;
-  if (N == 1) {{
-      (*kernel_ptr)({kernel_fn_args_list + ', ' if len(kernel_fn_args) > 0 else ''} 0, 0, 0, 1, 1, 1);
+// Iterates over program ids in the traversal order of a launch. Program ids
+// are computed on the fly, so launch overhead doesn't depend on the grid size.
+class ProgramIdIterator {{
+public:
+  ProgramIdIterator(uint32_t gridX, uint32_t gridY, uint32_t gridZ, uint32_t tile, bool hilbert, size_t idx)
+      : gridX(gridX), gridY(gridY), tile(tile), hilbert(hilbert) {{
+    size_t plane_size = static_cast<size_t>(gridX) * gridY;
+    z = idx / plane_size;
+    size_t plane_idx = idx % plane_size;
+    if (hilbert) {{
+      this->plane_idx = plane_idx;
+      hilbert_point(gridX, gridY, plane_idx, x, y);
+      return;
+    }}
+    if (tile == 0) {{
+      y = plane_idx / gridX;
+      x = plane_idx % gridX;
+      return;
+    }}
+    band = plane_idx / (static_cast<size_t>(tile) * gridX) * tile;
+    band_end = std::min(band + tile, gridY);
+    size_t band_idx = plane_idx - static_cast<size_t>(band) * gridX;
+    x = band_idx / (band_end - band);
+    y = band + band_idx % (band_end - band);
+  }}
+
+  void next() {{
+    if (hilbert) {{
+      if (++plane_idx == static_cast<size_t>(gridX) * gridY) {{
+        plane_idx = 0;
+        ++z;
+      }}
+      hilbert_point(gridX, gridY, plane_idx, x, y);
+      return;
+    }}
+    if (tile == 0) {{
+      if (++x < gridX)
+        return;
+      x = 0;
+      if (++y < gridY)
+        return;
+      y = 0;
+      ++z;
+      return;
+    }}
+    if (++y < band_end)
       return;
+    y = band;
+    if (++x < gridX)
+      return;
+    x = 0;
+    band = band_end < gridY ? band_end : 0;
+    band_end = std::min(band + tile, gridY);
+    y = band;
+    if (band == 0)
+      ++z;
+  }}
+
+  // Number of the following programs, up to n, that have consecutive X ids
+  // and can run in a single kernel call.
+  uint32_t row_length(size_t n) const {{
+    return tile == 0 && !hilbert ? std::min<size_t>(gridX - x, n) : 1;
+  }}
+
+  // Advance past a row of programs of the given length.
+  void next_row(uint32_t length) {{
+    x += length - 1;
+    next();
+  }}
+
+  uint32_t x = 0, y = 0, z = 0;
+
+private:
+  uint32_t gridX, gridY, tile;
+  bool hilbert;
+  uint32_t band = 0, band_end = 0;
+  size_t plane_idx = 0;
+}};
+
+// Range dependencies of a launch, see RangeDependency in driver.py. The
+// launch publishes completion of chunks of producer_chunk programs to the
+// producer dependency, and its programs wait for chunks of the consumer
+// dependency, consumer_chunk programs per chunk. Rounds are assigned when
+// the launch runs.
+struct RangeDeps {{
+  void *producer = nullptr;
+  size_t producer_chunk = 0;
+  uint64_t producer_round = 0;
+  void *consumer = nullptr;
+  size_t consumer_chunk = 0;
+  uint64_t consumer_round = 0;
+}};
+
+struct KernelCallArgs {{
+  kernel_ptr_t kernel_ptr;
+  uint32_t gridX, gridY, gridZ;
+  uint32_t program_tile;
+  bool hilbert_order;
+  bool flush_denormals;
+  {kernel_call_arg_fields}
+  RangeDeps range_deps;
+}};
+
+static void run_kernel_range(void *ctx, size_t begin, size_t end) {{
+  const auto *call_args = static_cast<const KernelCallArgs *>(ctx);
+  // Denormals are only flushed while the programs run, so threads keep their
+  // floating-point environment for other launches and for the caller.
+  uint64_t fp_env = call_args->flush_denormals ? triton_cpu_flush_denormals() : 0;
+  ProgramIdIterator pid(call_args->gridX, call_args->gridY, call_args->gridZ, call_args->program_tile,
+                        call_args->hilbert_order, begin);
+  const RangeDeps &deps = call_args->range_deps;
+  if (deps.producer)
+    triton_cpu_range_dep_mark_started(deps.producer, deps.producer_round);
+  for (size_t i = begin; i < end;) {{
+    uint32_t length = pid.row_length(end - i);
+    // Dependencies are tracked by linear program ids, which don't depend on
+    // the traversal order. Programs of a row have consecutive ids.
+    size_t program = pid.x + static_cast<size_t>(call_args->gridX) * (pid.y + static_cast<size_t>(call_args->gridY) * pid.z);
+    if (deps.consumer)
+      triton_cpu_range_dep_wait(deps.consumer, deps.consumer_round, program, program + length, deps.consumer_chunk);
+    (*call_args->kernel_ptr)({kernel_call_args_list + ', ' if kernel_call_args_list else ''}pid.x, pid.x + length, pid.y, pid.z,
+                             call_args->gridX, call_args->gridY, call_args->gridZ);
+    if (deps.producer)
+      triton_cpu_range_dep_signal(deps.producer, program, program + length);
+    i += length;
+    pid.next_row(length);
+  }}
+  if (call_args->flush_denormals)
+    triton_cpu_restore_fp_env(fp_env);
+}}
+
+using program_range_fn_t = void (*)(void *, size_t, size_t);
+
+static void dispatch_programs(program_range_fn_t fn, void *ctx, const LaunchConfig &config, int num_threads,
+                              size_t N) {{
+  // The pool decides whether the calling thread can run the programs, so
+  // always go through it, even for a single program.
+  if (!config.use_omp) {{
+    triton_cpu_set_affinity(config.cpu_mask, static_cast<int32_t>(config.placement), config.one_thread_per_core,
+                            static_cast<int32_t>(config.core_type));
+    triton_cpu_parallel_for(N, num_threads, static_cast<int32_t>(config.schedule), config.program_align,
+                            config.numa_node, config.priority, fn, ctx);
+    return;
+  }}
+
+  if (N == 1) {{
+    fn(ctx, 0, 1);
+    return;
   }}
 
-  auto all_grids = get_all_grids(gridX, gridY, gridZ);
   int omp_max_threads = 1;
   #ifdef _OPENMP
   omp_max_threads = omp_get_max_threads();
   #endif // _OPENMP
   int max_threads = (num_threads > 0) ? num_threads : omp_max_threads;
+  max_threads = static_cast<int>(std::min<size_t>(max_threads, N));
 
   // Don't pay OMP overhead price when a single thread is used.
   if (max_threads == 1) {{
-    for (size_t i = 0; i < N; ++i) {{
-      const auto [x, y, z] = all_grids[i];
-      (*kernel_ptr)({kernel_fn_args_list + ', ' if len(kernel_fn_args) > 0 else ''} x, y, z, gridX, gridY, gridZ);
-    }}
+    fn(ctx, 0, N);
     return;
   }}
 
-  // For now, use the default chunk size, total iterations / max_threads.
+  // OpenMP threads share the thread budget with the pool, so concurrent
+  // launches don't oversubscribe the CPU.
+  max_threads = triton_cpu_acquire_threads(max_threads, config.priority);
+  if (max_threads == 1) {{
+    fn(ctx, 0, N);
+    triton_cpu_release_threads(max_threads);
+    return;
+  }}
+
+  // Static scheduling uses the default chunk size, total iterations / max_threads,
+  // rounded up to a multiple of program_align. There is no work stealing in OpenMP,
+  // use dynamic scheduling instead.
 #ifdef _OPENMP
-#pragma omp parallel for schedule(static) num_threads(max_threads)
+  size_t align = static_cast<size_t>(std::max(config.program_align, 1));
+  if (config.schedule == Schedule::Steal)
+    omp_set_schedule(omp_sched_dynamic, static_cast<int>(align));
+  else if (align > 1)
+    omp_set_schedule(omp_sched_static, static_cast<int>((N + max_threads * align - 1) / (max_threads * align) * align));
+  else
+    omp_set_schedule(omp_sched_static, 0);
+#pragma omp parallel for schedule(runtime) num_threads(max_threads)
 #endif // _OPENMP
-  for (size_t i = 0; i < N; ++i) {{
-    const auto [x, y, z] = all_grids[i];
-    (*kernel_ptr)({kernel_fn_args_list + ', ' if len(kernel_fn_args) > 0 else ''} x, y, z, gridX, gridY, gridZ);
+  for (size_t i = 0; i < N; ++i)
+    fn(ctx, i, i + 1);
+  triton_cpu_release_threads(max_threads);
+}}
+
+// Run programs [0, N) with fn(ctx, begin, end) in parallel. Device prints of
+// the programs are buffered by their threads and written once they are done.
+static void run_programs(program_range_fn_t fn, void *ctx, const LaunchConfig &config, int num_threads, size_t N) {{
+  dispatch_programs(fn, ctx, config, num_threads, N);
+  triton_cpu_print_flush();
+}}
+
+// Programs of a slice of an out-of-core launch, numbered from the beginning of
+// the slice.
+struct ProgramSlice {{
+  program_range_fn_t fn;
+  void *ctx;
+  size_t offset;
+}};
+
+static void run_slice_range(void *ctx, size_t begin, size_t end) {{
+  const auto *slice = static_cast<const ProgramSlice *>(ctx);
+  slice->fn(slice->ctx, slice->offset + begin, slice->offset + end);
+}}
+
+// Run programs [0, N) in consecutive slices, all threads working on the same
+// slice, so memory-mapped arguments larger than RAM are read in order instead
+// of faulting pages in across the whole range.
+static void run_out_of_core(program_range_fn_t fn, void *ctx, const LaunchConfig &config, int num_threads,
+                            size_t N) {{
+  size_t num_slices = std::min<size_t>(config.out_of_core_slices, N);
+  std::vector<const void *> ptrs;
+  std::vector<size_t> sizes;
+  for (const MemoryRegion &region : config.memory_regions) {{
+    ptrs.push_back(region.ptr);
+    sizes.push_back(region.size);
+  }}
+  void *advisor = triton_cpu_slice_advisor_create(ptrs.data(), sizes.data(), static_cast<int32_t>(ptrs.size()),
+                                                  num_slices);
+  for (size_t i = 0; i < num_slices; ++i) {{
+    triton_cpu_slice_advisor_begin(advisor, i);
+    ProgramSlice slice{{fn, ctx, N * i / num_slices}};
+    run_programs(run_slice_range, &slice, config, num_threads, N * (i + 1) / num_slices - slice.offset);
+  }}
+  triton_cpu_slice_advisor_begin(advisor, num_slices);
+  triton_cpu_slice_advisor_destroy(advisor);
+}}
+
+static void run_kernels(KernelCallArgs &call_args, const LaunchConfig &config, int num_threads, size_t N) {{
+  // Slices of out-of-core launches take pool threads one after another, so a
+  // producer would wait for threads held by its consumers.
+  if (config.out_of_core_slices > 1 && !config.memory_regions.empty() && N > 1 && !call_args.range_deps.producer) {{
+    run_out_of_core(run_kernel_range, &call_args, config, num_threads, N);
+    return;
+  }}
+  run_programs(run_kernel_range, &call_args, config, num_threads, N);
+}}
+
+static int64_t now_ns() {{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}}
+
+static void run_kernels(KernelCallArgs &call_args, const LaunchConfig &config) {{
+  size_t N = static_cast<size_t>(call_args.gridX) * call_args.gridY * call_args.gridZ;
+  // Rounds advance for empty grids as well, so that later launches stay
+  // paired.
+  RangeDeps &deps = call_args.range_deps;
+  if (deps.consumer)
+    deps.consumer_round = triton_cpu_range_dep_begin_consumer(deps.consumer);
+  if (deps.producer) {{
+    deps.producer_round = triton_cpu_range_dep_begin_producer(deps.producer, N, deps.producer_chunk);
+    if (N == 0)
+      triton_cpu_range_dep_mark_started(deps.producer, deps.producer_round);
+  }}
+  if (N == 0)
+    return;
+
+  const void *kernel = reinterpret_cast<const void *>(call_args.kernel_ptr);
+  int num_threads = config.num_threads;
+  bool measure_cost = false;
+  if (num_threads <= 0 && config.adaptive_num_threads) {{
+    int max_threads = 0;
+    #ifdef _OPENMP
+    if (config.use_omp)
+      max_threads = omp_get_max_threads();
+    #endif // _OPENMP
+    num_threads = triton_cpu_get_adaptive_num_threads(kernel, N, max_threads, config.program_cost_ns);
+    measure_cost = config.program_cost_ns <= 0;
+  }}
+  bool trace = triton_cpu_launch_trace_enabled();
+  int64_t start = now_ns();
+  run_kernels(call_args, config, num_threads, N);
+  int64_t end = now_ns();
+  triton_cpu_stats_record_launch(kernel, N, end - start);
+  if (measure_cost)
+    triton_cpu_record_launch_time(kernel, N, num_threads, end - start);
+  if (trace) {{
+    // Only the pool counts hardware events of launches.
+    uint64_t counters[MAX_PERF_COUNTERS];
+    int32_t num_counters = config.use_omp ? 0 : triton_cpu_perf_get_last_job(counters);
+    triton_cpu_launch_trace_record(kernel, config.correlation_id, start, end, call_args.gridX, call_args.gridY,
+                                   call_args.gridZ, num_threads, counters, num_counters);
+  }}
+}}
+
+// A launch submitted to a stream. It owns copies of the kernel arguments and
+// the launch configuration. The stream destroys it once the launch is
+// complete, or when its graph is destroyed if the stream is being captured.
+struct LaunchTask {{
+  KernelCallArgs call_args;
+  LaunchConfig config;
+  std::string cpu_mask;
+}};
+
+static void run_launch_task(void *ctx) {{
+  auto *task = static_cast<LaunchTask *>(ctx);
+  run_kernels(task->call_args, task->config);
+}}
+
+static void destroy_launch_task(void *ctx) {{
+  delete static_cast<LaunchTask *>(ctx);
+}}
+
+// Run the launch on the calling thread or, if pStream is set, submit it to
+// the stream.
+static void submit_launch(KernelCallArgs &call_args, LaunchConfig config, void *pStream) {{
+  // Enter hooks of profilers may set the correlation id.
+  config.correlation_id = triton_cpu_launch_trace_get_correlation_id();
+  RangeDeps &deps = call_args.range_deps;
+  int64_t producer_chunk, consumer_chunk;
+  triton_cpu_range_dep_get_current(&deps.producer, &producer_chunk, &deps.consumer, &consumer_chunk);
+  deps.producer_chunk = static_cast<size_t>(std::max<int64_t>(producer_chunk, 1));
+  deps.consumer_chunk = static_cast<size_t>(std::max<int64_t>(consumer_chunk, 1));
+  if (pStream) {{
+    // Stream-ordered launch, the stream runs it asynchronously. Arguments
+    // must stay alive until the stream is synchronized.
+    auto *task = new LaunchTask{{call_args, config, config.cpu_mask ? config.cpu_mask : ""}};
+    task->config.cpu_mask = config.cpu_mask ? task->cpu_mask.c_str() : nullptr;
+    triton_cpu_stream_enqueue(pStream, run_launch_task, task, destroy_launch_task);
+    return;
+  }}
+  // Kernels don't touch Python objects, so let other Python threads run.
+  Py_BEGIN_ALLOW_THREADS;
+  run_kernels(call_args, config);
+  Py_END_ALLOW_THREADS;
+}}
+
+static int getIntMetadata(PyObject *metadata, const char *name, int default_value) {{
+  int res = default_value;
+  PyObject *attr = PyObject_GetAttrString(metadata, name);
+  if (attr && PyLong_Check(attr))
+    res = PyLong_AsLong(attr);
+  if (!attr)
+    PyErr_Clear();
+  Py_XDECREF(attr);
+  return res;
+}}
+
+static bool isStrMetadata(PyObject *metadata, const char *name, const char *value) {{
+  bool res = false;
+  PyObject *attr = PyObject_GetAttrString(metadata, name);
+  if (attr && PyUnicode_Check(attr))
+    res = PyUnicode_CompareWithASCIIString(attr, value) == 0;
+  if (!attr)
+    PyErr_Clear();
+  Py_XDECREF(attr);
+  return res;
+}}
+
+// Return the string value of a metadata attribute or nullptr if it isn't a
+// string. The string is owned by the metadata object.
+static const char *getStrMetadata(PyObject *metadata, const char *name) {{
+  const char *res = nullptr;
+  PyObject *attr = PyObject_GetAttrString(metadata, name);
+  if (attr && PyUnicode_Check(attr))
+    res = PyUnicode_AsUTF8(attr);
+  if (!attr)
+    PyErr_Clear();
+  Py_XDECREF(attr);
+  return res;
+}}
+
+// Extract the launch configuration from the kernel metadata. The NUMA node
+// and memory regions depend on the kernel arguments and are set by the
+// launcher.
+static LaunchConfig getLaunchConfig(PyObject *kernel_metadata) {{
+  LaunchConfig config;
+  config.num_threads = getIntMetadata(kernel_metadata, "num_threads", 0);
+  config.adaptive_num_threads = getIntMetadata(kernel_metadata, "adaptive_num_threads", 0);
+  config.program_cost_ns = getIntMetadata(kernel_metadata, "program_cost_ns", 0);
+  config.use_omp = isStrMetadata(kernel_metadata, "launch_runtime", "omp");
+  config.priority = getIntMetadata(kernel_metadata, "launch_priority", 0);
+  if (isStrMetadata(kernel_metadata, "schedule", "steal"))
+    config.schedule = Schedule::Steal;
+  if (isStrMetadata(kernel_metadata, "program_order", "tiled"))
+    config.program_tile = std::max(getIntMetadata(kernel_metadata, "program_tile_size", 0), 0);
+  config.hilbert_order = isStrMetadata(kernel_metadata, "program_order", "hilbert");
+  config.flush_denormals = getIntMetadata(kernel_metadata, "flush_denormals", 0);
+  config.program_align = std::max(getIntMetadata(kernel_metadata, "program_align", 1), 1);
+  // Persistent launches have a program per worker, so the number of threads
+  // isn't adapted and each worker gets a single program.
+  config.out_of_core_slices = std::max(getIntMetadata(kernel_metadata, "out_of_core_slices", 0), 0);
+  if (getIntMetadata(kernel_metadata, "persistent", 0)) {{
+    config.adaptive_num_threads = false;
+    config.schedule = Schedule::Static;
+    config.program_align = 1;
+    config.program_tile = 0;
+    config.hilbert_order = false;
+    config.out_of_core_slices = 0;
+  }}
+  config.cpu_mask = getStrMetadata(kernel_metadata, "cpu_mask");
+  if (isStrMetadata(kernel_metadata, "thread_placement", "compact"))
+    config.placement = Placement::Compact;
+  else if (isStrMetadata(kernel_metadata, "thread_placement", "scatter"))
+    config.placement = Placement::Scatter;
+  config.one_thread_per_core = getIntMetadata(kernel_metadata, "one_thread_per_core", 0);
+  if (isStrMetadata(kernel_metadata, "core_type", "performance"))
+    config.core_type = CoreType::Performance;
+  else if (isStrMetadata(kernel_metadata, "core_type", "efficiency"))
+    config.core_type = CoreType::Efficiency;
+  return config;
+}}
+
+// Record the memory of a pointer argument of an out-of-core launch. Its size
+// is the nbytes attribute of numpy arrays, tensors and memoryviews. Arguments
+// without it aren't read ahead.
+static void addMemoryRegion(LaunchConfig &config, PyObject *obj, const void *ptr) {{
+  if (config.out_of_core_slices <= 1)
+    return;
+  PyObject *nbytes = PyObject_GetAttrString(obj, "nbytes");
+  if (nbytes && PyLong_Check(nbytes)) {{
+    size_t size = PyLong_AsSize_t(nbytes);
+    if (size != static_cast<size_t>(-1) && size > 0)
+      config.memory_regions.push_back({{ptr, size}});
+  }}
+  PyErr_Clear();
+  Py_XDECREF(nbytes);
+}}
+
+// Return the NUMA node to run a NUMA launch on. placement_ptr is the value of
+// the placement argument, or nullptr if there is none.
+static int32_t getNumaNode(const void *placement_ptr) {{
+  return placement_ptr ? triton_cpu_get_numa_node(placement_ptr) : NUMA_ANY_NODE;
+}}
+
+static bool callLaunchHook(PyObject *hook, PyObject *launch_metadata) {{
+  if (hook == Py_None)
+    return true;
+  PyObject* args = Py_BuildValue("(O)", launch_metadata);
+  PyObject* ret = PyObject_CallObject(hook, args);
+  Py_DECREF(args);
+  Py_XDECREF(ret);
+  return ret != NULL;
+}}
+
+{launch_src}
+
+static PyMethodDef ModuleMethods[] = {{
+  {{"launch", launch, METH_VARARGS, "Entry point for all kernels with this signature"}},{extra_methods}
+  {{NULL, NULL, 0, NULL}} // sentinel
+}};
+
+static struct PyModuleDef ModuleDef = {{
+  PyModuleDef_HEAD_INIT,
+  \"__triton_cpu_launcher\",
+  NULL, //documentation
+  -1, //size
+  ModuleMethods
+}};
+
+PyMODINIT_FUNC PyInit___triton_cpu_launcher(void) {{
+  PyObject *m = PyModule_Create(&ModuleDef);
+  if(m == NULL) {{
+    return NULL;
   }}
+  PyModule_AddFunctions(m, ModuleMethods);
+  return m;
 }}
+"""
+
+
+def make_launcher(constants, signature, ids):
+    # Record the end of regular arguments;
+    # subsequent arguments are architecture-specific descriptors.
+    def _serialize_signature(sig):
+        if isinstance(sig, tuple):
+            return ','.join(map(_serialize_signature, sig))
+        return sig
+
+    def _extracted_type(ty):
+        if isinstance(ty, tuple):
+            val = ','.join(map(_extracted_type, ty))
+            return f"[{val}]"
+        if ty[0] == '*':
+            return "PyObject*"
+        if ty in ("constexpr"):
+            return "PyObject*"
+        return ty_to_cpp(ty)
+
+    def format_of(ty):
+        if isinstance(ty, tuple):
+            val = ''.join(map(format_of, ty))
+            return f"({val})"
+        if ty[0] == '*':
+            return "O"
+        if ty in ("constexpr"):
+            return "O"
+        return {
+            "float": "f",
+            "double": "d",
+            "long": "l",
+            "int8_t": "b",
+            "int16_t": "h",
+            "int32_t": "i",
+            "int64_t": "L",
+            "uint8_t": "B",
+            "uint16_t": "H",
+            "uint32_t": "I",
+            "uint64_t": "K",
+        }[ty_to_cpp(ty)]
+
+    args_format = ''.join([format_of(ty) for ty in signature.values()])
+    format = "iiiOKOOOO" + args_format
+
+    signature = ','.join(map(_serialize_signature, signature.values()))
+    signature = list(filter(bool, signature.split(',')))
+    signature = {i: s for i, s in enumerate(signature)}
+
+    arg_ptrs_list = ', '.join(f"&arg{i}" for i in signature.keys())
+    kernel_fn_args = [i for i, ty in signature.items() if i not in constants and ty != "constexpr"]
+    signature_without_constexprs = {i: ty for i, ty in signature.items() if ty != "constexpr"}
+    kernel_fn_arg_types = ', '.join(f"{ty_to_cpp(signature[i])}" for i in kernel_fn_args)
+    kernel_call_arg_fields = ' '.join(f"{ty_to_cpp(signature[i])} arg{i};" for i in kernel_fn_args)
+    kernel_call_args_init = ', '.join(f"ptr_info{i}.dev_ptr" if signature[i][0] == "*" else f"arg{i}"
+                                      for i in kernel_fn_args)
+    kernel_call_args_list = ', '.join(f"call_args->arg{i}" for i in kernel_fn_args)
 
+    # generate glue code
+    launch_src = f"""
 static PyObject* launch(PyObject* self, PyObject* args) {{
   int gridX, gridY, gridZ;
   PyObject *launch_enter_hook = NULL;
@@ -315,33 +2181,31 @@ static PyObject* launch(PyObject* self, PyObject* args) {{
 
   void *pStream = PyLong_AsVoidPtr(py_obj_stream);
   kernel_ptr_t kernel_ptr = reinterpret_cast<kernel_ptr_t>(pKrnl);
+  LaunchConfig config = getLaunchConfig(kernel_metadata);
 
-  // Extract num_threads metadata.
-  int num_threads = 0;
-  PyObject *num_threads_attr = PyObject_GetAttrString(kernel_metadata, "num_threads");
-  if (num_threads_attr && PyLong_Check(num_threads_attr))
-    num_threads = PyLong_AsLong(num_threads_attr);
-
-  // extract launch metadata
-  if (launch_enter_hook != Py_None){{
-    PyObject* args = Py_BuildValue("(O)", launch_metadata);
-    PyObject* ret = PyObject_CallObject(launch_enter_hook, args);
-    Py_DECREF(args);
-    if (!ret)
-      return NULL;
-  }}
+  if (!callLaunchHook(launch_enter_hook, launch_metadata))
+    return NULL;
 
   {"; ".join([f"DevicePtrInfo ptr_info{i} = getPointer(arg{i}, {i}); if (!ptr_info{i}.valid) return NULL;" if ty[0] == "*" else "" for i, ty in signature_without_constexprs.items()])};
-  run_omp_kernels(gridX, gridY, gridZ, num_threads, kernel_ptr {(', ' + ', '.join(f"ptr_info{i}.dev_ptr" if ty[0]=="*" else f"arg{i}" for i, ty in signature_without_constexprs.items())) if len(signature_without_constexprs) > 0 else ''});
-
-  if(launch_exit_hook != Py_None){{
-    PyObject* args = Py_BuildValue("(O)", launch_metadata);
-    PyObject* ret = PyObject_CallObject(launch_exit_hook, args);
-    Py_DECREF(args);
-    if (!ret)
-      return NULL;
+  {" ".join(f"addMemoryRegion(config, arg{i}, ptr_info{i}.dev_ptr);" for i, ty in signature_without_constexprs.items() if ty[0] == "*")}
+
+  // Run the launch on the NUMA node holding the placement argument, if any.
+  if (getIntMetadata(kernel_metadata, "numa", 0)) {{
+    const void *placement_ptr = nullptr;
+    switch (getIntMetadata(kernel_metadata, "numa_placement_arg", -1)) {{
+      {' '.join(f"case {i}: placement_ptr = ptr_info{i}.dev_ptr; break;" for i, ty in signature_without_constexprs.items() if ty[0] == "*")}
+      default: break;
+    }}
+    config.numa_node = getNumaNode(placement_ptr);
   }}
 
+  KernelCallArgs call_args{{kernel_ptr, static_cast<uint32_t>(gridX), static_cast<uint32_t>(gridY), static_cast<uint32_t>(gridZ),
+                           config.program_tile, config.hilbert_order, config.flush_denormals{', ' + kernel_call_args_init if len(kernel_fn_args) > 0 else ''}}};
+  submit_launch(call_args, config, pStream);
+
+  if (!callLaunchHook(launch_exit_hook, launch_metadata))
+    return NULL;
+
   if (PyErr_Occurred()) {{
     return NULL;
   }}
@@ -350,30 +2214,826 @@ static PyObject* launch(PyObject* self, PyObject* args) {{
   Py_INCREF(Py_None);
   return Py_None;
 }}
+"""
+    return _make_launcher_src(kernel_fn_arg_types, kernel_call_arg_fields, kernel_call_args_list, launch_src)
+
+
+# Argument codes of the generic launcher signature descriptor. Constants and
+# constexprs are not passed to the kernel and are marked with "x", tuples are
+# enclosed in parentheses.
+_generic_arg_codes = {
+    "i1": "?",
+    "u1": "?",
+    "i8": "b",
+    "i16": "h",
+    "i32": "i",
+    "i64": "L",
+    "u8": "B",
+    "u16": "H",
+    "u32": "I",
+    "u64": "K",
+    "fp16": "e",
+    "bf16": "E",
+    "fp32": "f",
+    "f32": "f",
+    "fp64": "d",
+}
+
+
+def make_signature_descriptor(constants, signature):
+    # Arguments are numbered like in the specialized launcher, i.e. in the
+    # flattened signature.
+    idx = 0
+
+    def code_of(ty):
+        nonlocal idx
+        if isinstance(ty, tuple):
+            return "(" + "".join(map(code_of, ty)) + ")"
+        i = idx
+        idx += 1
+        if ty == "constexpr" or i in constants:
+            return "x"
+        if ty[0] == "*":
+            return "P"
+        return _generic_arg_codes[ty]
+
+    return "".join(map(code_of, signature.values())).encode()
+
+
+def make_generic_launcher():
+    # The generic launcher calls the packed entry point of a kernel, see
+    # add_packed_entry in triton_cpu.cc. Its first argument is the signature
+    # descriptor of the kernel and the kernel arguments are packed into 8-byte
+    # slots according to it.
+    launch_src = """
+// Packs kernel arguments into 8-byte slots following the signature
+// descriptor. Returns false and sets a Python error on failure.
+class ArgPacker {
+public:
+  ArgPacker(std::vector<uint64_t> &slots, int placement_arg, LaunchConfig &config)
+      : slots(slots), placement_arg(placement_arg), config(config) {}
+
+  bool pack(const char *&desc, PyObject *obj) {
+    char code = *desc++;
+    if (code == '(') {
+      if (!PyTuple_Check(obj)) {
+        PyErr_SetString(PyExc_TypeError, "tuple argument expected");
+        return false;
+      }
+      Py_ssize_t size = PyTuple_GET_SIZE(obj);
+      for (Py_ssize_t i = 0; i < size; ++i) {
+        if (*desc == ')') {
+          PyErr_SetString(PyExc_TypeError, "too many tuple elements");
+          return false;
+        }
+        if (!pack(desc, PyTuple_GET_ITEM(obj, i)))
+          return false;
+      }
+      if (*desc++ != ')') {
+        PyErr_SetString(PyExc_TypeError, "too few tuple elements");
+        return false;
+      }
+      return true;
+    }
+
+    int idx = arg_idx++;
+    switch (code) {
+    case 'x':
+      return true;
+    case 'P': {
+      DevicePtrInfo ptr_info = getPointer(obj, idx);
+      if (!ptr_info.valid)
+        return false;
+      if (idx == placement_arg)
+        placement_ptr = ptr_info.dev_ptr;
+      addMemoryRegion(config, obj, ptr_info.dev_ptr);
+      return store(ptr_info.dev_ptr);
+    }
+    case '?': {
+      int value = PyObject_IsTrue(obj);
+      return value >= 0 && store<uint8_t>(value);
+    }
+    case 'b': return storeInt<int8_t>(PyLong_AsLongLong(obj));
+    case 'h': return storeInt<int16_t>(PyLong_AsLongLong(obj));
+    case 'i': return storeInt<int32_t>(PyLong_AsLongLong(obj));
+    case 'L': return storeInt<int64_t>(PyLong_AsLongLong(obj));
+    case 'B': return storeInt<uint8_t>(PyLong_AsUnsignedLongLongMask(obj));
+    case 'H': return storeInt<uint16_t>(PyLong_AsUnsignedLongLongMask(obj));
+    case 'I': return storeInt<uint32_t>(PyLong_AsUnsignedLongLongMask(obj));
+    case 'K': return storeInt<uint64_t>(PyLong_AsUnsignedLongLongMask(obj));
+    case 'e': {
+      double value = PyFloat_AsDouble(obj);
+      if (value == -1.0 && PyErr_Occurred())
+        return false;
+      uint16_t bits;
+#if PY_VERSION_HEX >= 0x030B0000
+      PyFloat_Pack2(value, reinterpret_cast<char *>(&bits), 1);
+#else
+      _PyFloat_Pack2(value, reinterpret_cast<unsigned char *>(&bits), 1);
+#endif
+      return store(bits);
+    }
+    case 'E': {
+      float value = PyFloat_AsDouble(obj);
+      if (value == -1.0f && PyErr_Occurred())
+        return false;
+      // Round to nearest even.
+      uint32_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      bits += 0x7fff + ((bits >> 16) & 1);
+      return store(static_cast<uint16_t>(bits >> 16));
+    }
+    case 'f': {
+      float value = PyFloat_AsDouble(obj);
+      return !PyErr_Occurred() && store(value);
+    }
+    case 'd': {
+      double value = PyFloat_AsDouble(obj);
+      return !PyErr_Occurred() && store(value);
+    }
+    default:
+      PyErr_Format(PyExc_ValueError, "invalid signature descriptor code '%c'", code);
+      return false;
+    }
+  }
+
+  const void *placement_ptr = nullptr;
+
+private:
+  template <typename T> bool store(T value) {
+    uint64_t slot = 0;
+    std::memcpy(&slot, &value, sizeof(T));
+    slots.push_back(slot);
+    return true;
+  }
+
+  template <typename T, typename V> bool storeInt(V value) {
+    if (value == static_cast<V>(-1) && PyErr_Occurred())
+      return false;
+    return store(static_cast<T>(value));
+  }
+
+  std::vector<uint64_t> &slots;
+  int placement_arg;
+  LaunchConfig &config;
+  int arg_idx = 0;
+};
+
+// Fill call_args and the launch configuration of a kernel with the
+// signature descriptor py_signature. Kernel arguments are items [first, end)
+// of the args tuple. Returns false and sets a Python error on failure.
+static bool prepareLaunch(KernelCallArgs &call_args, LaunchConfig &config, PyObject *py_signature, int gridX,
+                          int gridY, int gridZ, void *pKrnl, PyObject *kernel_metadata, PyObject *args,
+                          Py_ssize_t first) {
+  if (!PyBytes_Check(py_signature)) {
+    PyErr_SetString(PyExc_TypeError, "signature descriptor must be bytes");
+    return false;
+  }
+  config = getLaunchConfig(kernel_metadata);
+  call_args.kernel_ptr = reinterpret_cast<kernel_ptr_t>(pKrnl);
+  call_args.gridX = static_cast<uint32_t>(gridX);
+  call_args.gridY = static_cast<uint32_t>(gridY);
+  call_args.gridZ = static_cast<uint32_t>(gridZ);
+  call_args.program_tile = config.program_tile;
+  call_args.hilbert_order = config.hilbert_order;
+  call_args.flush_denormals = config.flush_denormals;
+  call_args.range_deps = RangeDeps();
+  call_args.args.clear();
+
+  bool numa = getIntMetadata(kernel_metadata, "numa", 0);
+  ArgPacker packer(call_args.args, numa ? getIntMetadata(kernel_metadata, "numa_placement_arg", -1) : -1, config);
+  const char *desc = PyBytes_AS_STRING(py_signature);
+  Py_ssize_t nargs = PyTuple_GET_SIZE(args);
+  for (Py_ssize_t i = first; i < nargs; ++i) {
+    if (*desc == '\\0') {
+      PyErr_SetString(PyExc_TypeError, "launch() got too many kernel arguments");
+      return false;
+    }
+    if (!packer.pack(desc, PyTuple_GET_ITEM(args, i)))
+      return false;
+  }
+  if (*desc != '\\0') {
+    PyErr_SetString(PyExc_TypeError, "launch() missing kernel arguments");
+    return false;
+  }
+
+  // Run the launch on the NUMA node holding the placement argument, if any.
+  if (numa)
+    config.numa_node = getNumaNode(packer.placement_ptr);
+  return true;
+}
+
+// Number of launch arguments preceding the kernel arguments.
+constexpr Py_ssize_t NUM_LAUNCH_ARGS = 10;
+
+static PyObject* launch(PyObject* self, PyObject* args) {
+  Py_ssize_t nargs = PyTuple_GET_SIZE(args);
+  if (nargs < NUM_LAUNCH_ARGS) {
+    PyErr_SetString(PyExc_TypeError, "launch() missing launch arguments");
+    return NULL;
+  }
+  PyObject *py_signature = PyTuple_GET_ITEM(args, 0);
+  int gridX = PyLong_AsLong(PyTuple_GET_ITEM(args, 1));
+  int gridY = PyLong_AsLong(PyTuple_GET_ITEM(args, 2));
+  int gridZ = PyLong_AsLong(PyTuple_GET_ITEM(args, 3));
+  void *pStream = PyLong_AsVoidPtr(PyTuple_GET_ITEM(args, 4));
+  void *pKrnl = PyLong_AsVoidPtr(PyTuple_GET_ITEM(args, 5));
+  PyObject *kernel_metadata = PyTuple_GET_ITEM(args, 6);
+  PyObject *launch_metadata = PyTuple_GET_ITEM(args, 7);
+  PyObject *launch_enter_hook = PyTuple_GET_ITEM(args, 8);
+  PyObject *launch_exit_hook = PyTuple_GET_ITEM(args, 9);
+  if (PyErr_Occurred())
+    return NULL;
 
-static PyMethodDef ModuleMethods[] = {{
-  {{"launch", launch, METH_VARARGS, "Entry point for all kernels with this signature"}},
-  {{NULL, NULL, 0, NULL}} // sentinel
-}};
+  if (!callLaunchHook(launch_enter_hook, launch_metadata))
+    return NULL;
 
-static struct PyModuleDef ModuleDef = {{
-  PyModuleDef_HEAD_INIT,
-  \"__triton_cpu_launcher\",
-  NULL, //documentation
-  -1, //size
-  ModuleMethods
-}};
+  // The call arguments are reused by launches of the thread to avoid
+  // allocating slots on every launch.
+  static thread_local KernelCallArgs call_args;
+  LaunchConfig config;
+  if (!prepareLaunch(call_args, config, py_signature, gridX, gridY, gridZ, pKrnl, kernel_metadata, args,
+                     NUM_LAUNCH_ARGS))
+    return NULL;
 
-PyMODINIT_FUNC PyInit___triton_cpu_launcher(void) {{
-  PyObject *m = PyModule_Create(&ModuleDef);
-  if(m == NULL) {{
+  submit_launch(call_args, config, pStream);
+
+  if (!callLaunchHook(launch_exit_hook, launch_metadata))
     return NULL;
-  }}
-  PyModule_AddFunctions(m, ModuleMethods);
-  return m;
-}}
+
+  if (PyErr_Occurred()) {
+    return NULL;
+  }
+
+  // return None
+  Py_INCREF(Py_None);
+  return Py_None;
+}
+
+// Launches run as a single parallel region. Programs of all launches form a
+// single iteration space, programs of launch i start at offsets[i].
+struct LaunchBatch {
+  std::vector<KernelCallArgs> launches;
+  std::vector<size_t> offsets;
+  LaunchConfig config;
+  std::string cpu_mask;
+};
+
+static void run_batch_range(void *ctx, size_t begin, size_t end) {
+  auto *batch = static_cast<LaunchBatch *>(ctx);
+  const std::vector<size_t> &offsets = batch->offsets;
+  size_t i = std::upper_bound(offsets.begin(), offsets.end(), begin) - offsets.begin() - 1;
+  while (begin < end) {
+    size_t launch_end = std::min(end, offsets[i + 1]);
+    // Skip launches with empty grids.
+    if (begin < launch_end)
+      run_kernel_range(&batch->launches[i], begin - offsets[i], launch_end - offsets[i]);
+    begin = launch_end;
+    ++i;
+  }
+}
+
+static void run_batch(void *ctx) {
+  auto *batch = static_cast<LaunchBatch *>(ctx);
+  size_t N = batch->offsets.back();
+  if (N == 0)
+    return;
+  int64_t start = now_ns();
+  run_programs(run_batch_range, batch, batch->config, batch->config.num_threads, N);
+  int64_t end = now_ns();
+  // Launches of the batch share its time in proportion to their programs.
+  for (size_t i = 0; i < batch->launches.size(); ++i) {
+    size_t programs = batch->offsets[i + 1] - batch->offsets[i];
+    if (programs > 0)
+      triton_cpu_stats_record_launch(reinterpret_cast<const void *>(batch->launches[i].kernel_ptr), programs,
+                                     static_cast<int64_t>((end - start) * (static_cast<double>(programs) / N)));
+  }
+  if (!triton_cpu_launch_trace_enabled())
+    return;
+  // The batch is traced as a single launch without a kernel.
+  uint64_t counters[MAX_PERF_COUNTERS];
+  int32_t num_counters = batch->config.use_omp ? 0 : triton_cpu_perf_get_last_job(counters);
+  triton_cpu_launch_trace_record(nullptr, batch->config.correlation_id, start, end, static_cast<uint32_t>(N), 1, 1,
+                                 batch->config.num_threads, counters, num_counters);
+}
+
+static void destroy_batch(void *ctx) {
+  delete static_cast<LaunchBatch *>(ctx);
+}
+
+// Number of items of a batch entry preceding the kernel arguments.
+constexpr Py_ssize_t NUM_BATCH_ENTRY_ARGS = 7;
+
+// launch_batch(stream, launches, launch_enter_hook, launch_exit_hook) runs
+// each launch given as a (signature, gridX, gridY, gridZ, kernel,
+// kernel_metadata, launch_metadata, *args) tuple. Threading options of the
+// first launch apply to the whole batch, and the batch uses all threads
+// allowed by any of its launches. NUMA placement is ignored.
+static PyObject* launch_batch(PyObject* self, PyObject* args) {
+  PyObject *py_stream, *py_launches, *launch_enter_hook, *launch_exit_hook;
+  if (!PyArg_ParseTuple(args, "OOOO", &py_stream, &py_launches, &launch_enter_hook, &launch_exit_hook))
+    return NULL;
+  void *pStream = PyLong_AsVoidPtr(py_stream);
+  if (PyErr_Occurred())
+    return NULL;
+  PyObject *launches = PySequence_Fast(py_launches, "launches must be a sequence");
+  if (!launches)
+    return NULL;
+  Py_ssize_t num_launches = PySequence_Fast_GET_SIZE(launches);
+
+  // Reused by batches of the thread, see launch.
+  static thread_local LaunchBatch batch;
+  batch.launches.resize(num_launches);
+  batch.offsets.assign(1, 0);
+  int num_threads = 0;
+  bool ok = true;
+  for (Py_ssize_t i = 0; i < num_launches && ok; ++i) {
+    PyObject *entry = PySequence_Fast_GET_ITEM(launches, i);
+    if (!PyTuple_Check(entry) || PyTuple_GET_SIZE(entry) < NUM_BATCH_ENTRY_ARGS) {
+      PyErr_SetString(PyExc_TypeError, "launch_batch() expects tuples of launch arguments");
+      ok = false;
+      break;
+    }
+    int gridX = PyLong_AsLong(PyTuple_GET_ITEM(entry, 1));
+    int gridY = PyLong_AsLong(PyTuple_GET_ITEM(entry, 2));
+    int gridZ = PyLong_AsLong(PyTuple_GET_ITEM(entry, 3));
+    void *pKrnl = PyLong_AsVoidPtr(PyTuple_GET_ITEM(entry, 4));
+    if (PyErr_Occurred()) {
+      ok = false;
+      break;
+    }
+    LaunchConfig config;
+    ok = prepareLaunch(batch.launches[i], config, PyTuple_GET_ITEM(entry, 0), gridX, gridY, gridZ, pKrnl,
+                       PyTuple_GET_ITEM(entry, 5), entry, NUM_BATCH_ENTRY_ARGS);
+    if (i == 0)
+      batch.config = config;
+    num_threads = (i == 0 || (num_threads > 0 && config.num_threads > 0)) ?
+                  std::max(num_threads, config.num_threads) : 0;
+    batch.offsets.push_back(batch.offsets.back() + static_cast<size_t>(gridX) * gridY * gridZ);
+  }
+  if (ok) {
+    batch.config.num_threads = num_threads;
+    batch.config.numa_node = NUMA_DISABLED;
+    for (Py_ssize_t i = 0; i < num_launches && ok; ++i) {
+      PyObject *entry = PySequence_Fast_GET_ITEM(launches, i);
+      ok = callLaunchHook(launch_enter_hook, PyTuple_GET_ITEM(entry, 6));
+    }
+  }
+  if (ok) {
+    batch.config.correlation_id = triton_cpu_launch_trace_get_correlation_id();
+    if (pStream) {
+      // The stream owns a copy of the batch, see submit_launch.
+      auto *task = new LaunchBatch(batch);
+      task->cpu_mask = batch.config.cpu_mask ? batch.config.cpu_mask : "";
+      task->config.cpu_mask = batch.config.cpu_mask ? task->cpu_mask.c_str() : nullptr;
+      triton_cpu_stream_enqueue(pStream, run_batch, task, destroy_batch);
+    } else {
+      Py_BEGIN_ALLOW_THREADS;
+      run_batch(&batch);
+      Py_END_ALLOW_THREADS;
+    }
+    for (Py_ssize_t i = 0; i < num_launches && ok; ++i) {
+      PyObject *entry = PySequence_Fast_GET_ITEM(launches, i);
+      ok = callLaunchHook(launch_exit_hook, PyTuple_GET_ITEM(entry, 6));
+    }
+  }
+  Py_DECREF(launches);
+  if (!ok || PyErr_Occurred())
+    return NULL;
+
+  // return None
+  Py_INCREF(Py_None);
+  return Py_None;
+}
+
+// Divisibility level of a value like CPUBackend.get_arg_specialization: 3 for
+// multiples of 256, 2 for 64 and 1 for 16, pointers stop at 64.
+static long divisibilityLevel(uint64_t value, bool ptr) {
+  if (!ptr && value % 256 == 0)
+    return 3;
+  if (value % 64 == 0)
+    return 2;
+  return value % 16 == 0 ? 1 : 0;
+}
+
+// Return 1 if the storage of the tensor has less than 2GB, as checked by
+// CPUBackend.is_within_2gb, 0 if not or -1 on errors.
+static int isWithin2GB(PyObject *obj) {
+  PyObject *storageFn = PyObject_GetAttrString(obj, "untyped_storage");
+  if (!storageFn) {
+    PyErr_Clear();
+    return 0;
+  }
+  PyObject *storage = PyObject_CallNoArgs(storageFn);
+  Py_DECREF(storageFn);
+  if (!storage)
+    return -1;
+  PyObject *nbytes = PyObject_CallMethod(storage, "nbytes", NULL);
+  Py_DECREF(storage);
+  if (!nbytes)
+    return -1;
+  long long size = PyLong_AsLongLong(nbytes);
+  Py_DECREF(nbytes);
+  if (size == -1 && PyErr_Occurred())
+    return -1;
+  return size <= INT32_MAX;
+}
+
+// Key item of an argument that identifies its specialization, see
+// specialization_key.
+static PyObject *specializationItem(PyObject *obj, char mode) {
+  if (mode == 'c' || obj == Py_None) {
+    Py_INCREF(obj);
+    return obj;
+  }
+  if (PyBool_Check(obj))
+    return PyLong_FromLong(1);
+  if (PyFloat_Check(obj))
+    return PyLong_FromLong(2);
+  if (PyLong_Check(obj)) {
+    int overflow;
+    long long value = PyLong_AsLongLongAndOverflow(obj, &overflow);
+    if (overflow > 0) {
+      uint64_t bits = PyLong_AsUnsignedLongLongMask(obj);
+      return PyLong_FromLong(20 + (mode == 's' ? divisibilityLevel(bits, false) : 0));
+    }
+    if (overflow < 0 || value < INT32_MIN || value > INT32_MAX)
+      return PyLong_FromLong(30 + (mode == 's' ? divisibilityLevel(value, false) : 0));
+    if (value == 1 && mode != 'n')
+      return PyLong_FromLong(9);
+    return PyLong_FromLong(10 + (mode == 's' ? divisibilityLevel(value, false) : 0));
+  }
+  if (PyTuple_Check(obj)) {
+    PyErr_SetString(PyExc_TypeError, "tuple arguments aren't supported by bound kernels");
+    return NULL;
+  }
+  uint64_t value;
+  PyObject *dtype;
+  PyObject *data_ptr = PyObject_GetAttrString(obj, "data_ptr");
+  if (!data_ptr)
+    PyErr_Clear();
+  if (data_ptr) {
+    PyObject *ptr = PyObject_CallNoArgs(data_ptr);
+    Py_DECREF(data_ptr);
+    if (!ptr)
+      return NULL;
+    value = PyLong_AsUnsignedLongLongMask(ptr);
+    Py_DECREF(ptr);
+    dtype = PyObject_GetAttrString(obj, "dtype");
+    if (!dtype)
+      return NULL;
+    // Tensors of less than 2GB are specialized as CPUBackend.is_within_2gb.
+    if (mode == 's') {
+      int small = isWithin2GB(obj);
+      if (small < 0) {
+        Py_DECREF(dtype);
+        return NULL;
+      }
+      long level = divisibilityLevel(value, true) + (small ? 10 : 0);
+      return Py_BuildValue("(Nl)", dtype, level);
+    }
+  } else if (PyObject_HasAttrString(obj, "dtype") || PyObject_CheckBuffer(obj)) {
+    // Host arrays are keyed by their dtype, or the format of their buffer.
+    void *ptr;
+    if (!getHostArrayPointer(obj, ptr)) {
+      if (!PyErr_Occurred())
+        PyErr_SetString(PyExc_TypeError, "Pointer argument must be a host array");
+      return NULL;
+    }
+    value = reinterpret_cast<uint64_t>(ptr);
+    if (PyObject_HasAttrString(obj, "dtype")) {
+      dtype = PyObject_GetAttrString(obj, "dtype");
+    } else {
+      Py_buffer view;
+      if (PyObject_GetBuffer(obj, &view, PyBUF_STRIDED_RO | PyBUF_FORMAT) != 0)
+        return NULL;
+      dtype = PyUnicode_FromString(view.format ? view.format : "B");
+      PyBuffer_Release(&view);
+    }
+    if (!dtype)
+      return NULL;
+  } else {
+    // Constexprs and functions are keyed by themselves.
+    Py_INCREF(obj);
+    return obj;
+  }
+  long level = mode == 's' ? divisibilityLevel(value, true) : 0;
+  return Py_BuildValue("(Nl)", dtype, level);
+}
+
+// specialization_key(args, modes) returns a tuple identifying the kernel
+// specialization for args, computed without Python code. modes has a
+// character per argument: 'c' for constexprs, which are keyed by value, 's'
+// for specialized arguments, 'a' for arguments that aren't specialized on
+// alignment and 'n' for arguments that aren't specialized.
+static PyObject* specialization_key(PyObject* self, PyObject* args) {
+  PyObject *py_args;
+  const char *modes;
+  Py_ssize_t num_modes;
+  if (!PyArg_ParseTuple(args, "O!y#", &PyTuple_Type, &py_args, &modes, &num_modes))
+    return NULL;
+  Py_ssize_t nargs = PyTuple_GET_SIZE(py_args);
+  if (nargs != num_modes) {
+    PyErr_Format(PyExc_TypeError, "expected %zd arguments, got %zd", num_modes, nargs);
+    return NULL;
+  }
+  PyObject *key = PyTuple_New(nargs);
+  if (!key)
+    return NULL;
+  for (Py_ssize_t i = 0; i < nargs; ++i) {
+    PyObject *item = specializationItem(PyTuple_GET_ITEM(py_args, i), modes[i]);
+    if (!item) {
+      Py_DECREF(key);
+      return NULL;
+    }
+    PyTuple_SET_ITEM(key, i, item);
+  }
+  return key;
+}
 """
-    return src
+    extra_methods = """
+  {"launch_batch", launch_batch, METH_VARARGS, "Run several launches as a single parallel region"},
+  {"specialization_key", specialization_key, METH_VARARGS, "Return the specialization key of kernel arguments"},"""
+    return _make_launcher_src("const uint64_t *", "std::vector<uint64_t> args;", "call_args->args.data()",
+                              launch_src, extra_methods)
+
+
+def use_generic_launcher():
+    # The generic launcher is compiled once for all signatures. Set
+    # TRITON_CPU_GENERIC_LAUNCHER=0 to compile a launcher per signature.
+    return os.environ.get("TRITON_CPU_GENERIC_LAUNCHER", "1") != "0"
+
+
+@functools.lru_cache()
+def get_generic_launcher():
+    return compile_module_from_src(make_generic_launcher(), "__triton_cpu_launcher")
+
+
+class _SplitKBuffers:
+    """Scratch slots and tile counters of split-K launches, see the SplitK pass.
+
+    Buffers are kept per stream, or per thread for launches without a stream, as launches of
+    a stream run one after another. They are only grown and never freed while the launcher is
+    alive, because captured graphs keep their addresses. Counters are zero-initialized and left
+    zeroed by the kernel.
+    """
+
+    # Number of threads deterministic launches are split for, so that the number of splits, and
+    # the order partial accumulators are reduced in, only depends on the grid.
+    DETERMINISTIC_NUM_THREADS = 64
+
+    def __init__(self, slot_size, max_splits, num_threads, deterministic=False):
+        self.slot_size = slot_size
+        self.max_splits = max_splits
+        if deterministic:
+            self.num_threads = self.DETERMINISTIC_NUM_THREADS
+        else:
+            self.num_threads = num_threads or _read_device_properties()["num_available_cpus"]
+        self.buffers = {}
+        self.allocations = []
+        self.lock = threading.Lock()
+
+    def num_splits(self, num_programs):
+        # Only split launches that leave threads idle.
+        if num_programs == 0 or num_programs >= self.num_threads:
+            return 1
+        return max(1, min(self.max_splits, self.num_threads // num_programs))
+
+    def get(self, num_programs, num_splits, stream):
+        if num_splits == 1:
+            return 0, 0
+        key = stream if stream else threading.get_ident()
+        scratch_size = num_programs * num_splits * self.slot_size
+        counters_size = num_programs * 4
+        with self.lock:
+            scratch, counters = self.buffers.get(key, (None, None))
+            if scratch is None or len(scratch) < scratch_size:
+                scratch = ctypes.create_string_buffer(scratch_size)
+                self.allocations.append(scratch)
+            if counters is None or len(counters) < counters_size:
+                counters = ctypes.create_string_buffer(counters_size)
+                self.allocations.append(counters)
+            self.buffers[key] = (scratch, counters)
+        return ctypes.addressof(scratch), ctypes.addressof(counters)
+
+    def expand(self, grid, stream, args):
+        """Return the grid and kernel arguments of a split launch."""
+        num_programs = grid[0] * grid[1] * grid[2]
+        num_splits = self.num_splits(num_programs)
+        scratch, counters = self.get(num_programs, num_splits, stream)
+        return (grid[0], grid[1], grid[2] * num_splits), (*args, num_splits, scratch, counters)
+
+
+class _ThreadPartials:
+    """Per-thread partials of scalar atomics deferred by the DeferScalarAtomics pass.
+
+    Each target gets a buffer of cache-line slots, one per thread, which kernels update instead
+    of the target. After a launch, the runtime adds the slots to the targets and zeroes them, on
+    the stream of the launch if any. Buffers are kept per stream, or per thread for launches
+    without a stream, and never freed while the launcher is alive, like split-K buffers.
+
+    Deterministic kernels have a slot per program instead, so buffers are sized for the grid of
+    each launch and slots are added up in program id order.
+    """
+
+    SLOT_SIZE = 64
+    TYPES = {"i32": 0, "i64": 1, "fp32": 2, "fp64": 3}
+
+    def __init__(self, types, num_threads, per_program=False):
+        self.types = [self.TYPES[ty] for ty in types]
+        self.per_program = per_program
+        # The thread launching the kernel may run programs along with the pool workers.
+        self.num_slots = (num_threads or _read_device_properties()["num_available_cpus"]) + 1
+        self.buffers = {}
+        self.launch_slots = {}
+        self.allocations = []
+        self.lock = threading.Lock()
+
+    def get(self, stream, num_slots):
+        key = stream if stream else threading.get_ident()
+        with self.lock:
+            buffers = self.buffers.get(key)
+            if buffers is None or len(buffers[0]) < num_slots * self.SLOT_SIZE:
+                buffers = [ctypes.create_string_buffer(num_slots * self.SLOT_SIZE) for _ in self.types]
+                self.allocations.extend(buffers)
+                self.buffers[key] = buffers
+            self.launch_slots[key] = num_slots
+        return [ctypes.addressof(buf) for buf in buffers]
+
+    def expand(self, grid, stream, args):
+        """Return kernel arguments with slot buffers of the stream appended."""
+        num_slots = grid[0] * grid[1] * grid[2] if self.per_program else self.num_slots
+        return (*args, num_slots, *self.get(stream, max(num_slots, 1)))
+
+    def combine(self, stream):
+        """Add partials of the last launch on the stream to their targets."""
+        runtime = CPUUtils()._get_runtime()
+        key = stream if stream else threading.get_ident()
+        num_slots = self.launch_slots[key]
+        for ty, slots in zip(self.types, self.get(stream, num_slots)):
+            runtime.triton_cpu_combine_thread_partials(ctypes.c_void_p(stream), ctypes.c_void_p(slots),
+                                                       ctypes.c_int32(num_slots), ctypes.c_int32(ty))
+
+
+class _GemmOffload:
+    """Whole launches of a GEMM kernel recognized by the MatchGemmKernels pass, see CPUOptions.gemm_offload.
+
+    The GEMM descriptor refers to arguments of the compiled kernel as $<index>, which are mapped to arguments
+    of the launch. A launch runs as a single triton_cpu_gemm call of the runtime if its grid has a program per
+    output tile in the tile order of the kernel and, unless the kernel masks loads along K, K is a multiple of
+    the K block, i.e. if the grid computes all of C. Other launches, and GEMMs oneDNN doesn't support, run the
+    kernel.
+    """
+
+    TYPES = {"fp32": 0, "fp16": 1, "bf16": 2}
+    STRIDES = ("stride_am", "stride_ak", "stride_bk", "stride_bn", "stride_cm", "stride_cn")
+
+    def __init__(self, desc, arg_positions):
+        self.fields = dict(field.split("=") for field in desc.split(","))
+        self.arg_positions = arg_positions
+        self.runtime = CPUUtils()._get_runtime()
+        self.available = hasattr(self.runtime, "triton_cpu_gemm_supported")
+
+    def _value(self, name, args):
+        value = self.fields[name]
+        if not value.startswith("$"):
+            return int(value)
+        arg = args[self.arg_positions[int(value[1:])]]
+        return arg.data_ptr() if hasattr(arg, "data_ptr") else int(arg)
+
+    def get_call_args(self, grid, args):
+        """Return triton_cpu_gemm arguments computing the launch, or None if the kernel has to run instead."""
+        if not self.available:
+            return None
+        M, N, K = (self._value(name, args) for name in ("m", "n", "k"))
+        block_m, block_n, block_k = (int(self.fields[name]) for name in ("block_m", "block_n", "block_k"))
+        tiles_m, tiles_n = triton.cdiv(M, block_m), triton.cdiv(N, block_n)
+        # Program ids of the kernel pick tiles along X and Y, or the linear program id along X picks them in
+        # row-major order.
+        tile_grid = {"xy": (tiles_m, tiles_n, 1), "yx": (tiles_n, tiles_m, 1), "linear": (tiles_m * tiles_n, 1, 1)}
+        if min(M, N, K) <= 0 or tuple(grid) != tile_grid[self.fields["tiles"]]:
+            return None
+        if self.fields["k_masked"] == "0" and K % block_k:
+            return None
+        ptrs = [ctypes.c_void_p(self._value(name, args)) for name in ("a", "b", "c")]
+        dims = [ctypes.c_int64(val) for val in (M, N, K, *(self._value(name, args) for name in self.STRIDES))]
+        types = [ctypes.c_int32(self.TYPES[self.fields[name]]) for name in ("ab_type", "c_type")]
+        return (*ptrs, *dims, *types, ctypes.c_int32(int(self.fields["relu"])))
+
+    def supported(self, call_args):
+        """Return True if oneDNN supports the GEMM of the call arguments."""
+        # Pointers of A, B and C come first.
+        return self.runtime.triton_cpu_gemm_supported(*call_args[3:]) == 0
+
+    def run(self, stream, call_args):
+        """Submit the GEMM, which has to be supported, to the stream."""
+        if self.runtime.triton_cpu_gemm(ctypes.c_void_p(stream), *call_args) != 0:
+            raise RuntimeError("oneDNN failed to create a supported GEMM")
+
+
+def _tensor_extent(arg):
+    """Return the byte range [start, end) spanned by the elements of a tensor."""
+    arg = getattr(arg, "base", arg)  # TensorWrapper
+    start = arg.data_ptr()
+    if arg.numel() == 0:
+        return start, start
+    span = sum((size - 1) * stride for size, stride in zip(arg.shape, arg.stride())) + 1
+    return start, start + span * arg.element_size()
+
+
+def _array_extent(arg):
+    """Return the byte range [start, end) spanned by the elements of an array with the array interface."""
+    iface = arg.__array_interface__
+    start = iface["data"][0]
+    shape = iface["shape"]
+    if 0 in shape:
+        return start, start
+    itemsize = int(iface["typestr"][2:])
+    strides = iface.get("strides")
+    if strides is None:
+        strides, stride = [], itemsize
+        for size in reversed(shape):
+            strides.insert(0, stride)
+            stride *= size
+    offsets = [(size - 1) * stride for size, stride in zip(shape, strides)]
+    return start + sum(o for o in offsets if o < 0), start + sum(o for o in offsets if o > 0) + itemsize
+
+
+def check_no_overlap(args):
+    """Raise ValueError if tensors passed to a kernel compiled with noalias overlap in memory.
+
+    Ranges spanned by tensors are compared, so views of interleaved elements of the same storage
+    are rejected too. Host arrays are checked if they have the array interface.
+    """
+    extents = sorted(
+        _tensor_extent(arg) if hasattr(arg, "data_ptr") else _array_extent(arg)
+        for arg in args
+        if hasattr(arg, "data_ptr") or hasattr(arg, "__array_interface__"))
+    max_end = None
+    for start, end in extents:
+        if start == end:
+            continue
+        if max_end is not None and start < max_end:
+            raise ValueError("Kernel compiled with noalias got tensor arguments overlapping in memory, "
+                             "launch it with noalias=False instead")
+        max_end = end if max_end is None else max(max_end, end)
+
+
+class _PGOProfiler:
+    """Profile-guided recompilation of a kernel compiled with pgo_warmup, see CPUOptions.
+
+    The kernel is compiled with counters of executed blocks. After pgo_warmup launches, the counters are
+    written to a profile and the kernel is recompiled with it, and later launches run the recompiled kernel.
+    Profiles are cached under the hash of their contents, so the recompiled kernel is cached by its profile
+    through pgo_profile, and under the hash of the instrumented kernel, so other processes don't profile it
+    again. Counters of warmup launches still running on streams may be partial, which only skews the profile.
+    """
+
+    def __init__(self, src, metadata):
+        self.src = src
+        self.metadata = metadata
+        self.filename = f"{metadata.name}.profdata"
+        self.cache = get_cache_manager(metadata.hash)
+        self.launches = 0
+        self.kernel = None
+        self.lock = threading.Lock()
+
+    def get_kernel(self, function):
+        """Return the kernel recompiled with the profile, or None while the kernel is profiled."""
+        if self.kernel is not None:
+            return self.kernel
+        with self.lock:
+            if self.kernel is None and self.launches == 0:
+                path = self.cache.get_file(self.filename)
+                if path is not None:
+                    self.kernel = self._recompile(Path(path).read_bytes())
+            elif self.kernel is None and self.launches >= self.metadata.pgo_warmup:
+                profile = self._read_profile(function)
+                self.cache.put(profile, self.filename, binary=True)
+                self.kernel = self._recompile(profile)
+            return self.kernel
+
+    def record_launch(self):
+        with self.lock:
+            self.launches += 1
+
+    def _read_profile(self, function):
+        from triton._C.libtriton import cpu
+        lib = CPUUtils()._function_libs[function]
+        records = []
+        for name, func_hash, symbol, num_counters in self.metadata.pgo_counters:
+            counters = (ctypes.c_uint64 * num_counters).in_dll(lib, symbol)
+            records.append((name, func_hash, list(counters)))
+        return cpu.write_pgo_profile(records)
+
+    def _recompile(self, profile):
+        cache = get_cache_manager(hashlib.sha256(profile).hexdigest())
+        path = cache.get_file(self.filename) or cache.put(profile, self.filename, binary=True)
+        # Metadata holds all options of the kernel, other fields are ignored by parse_options.
+        options = dict(self.metadata._asdict(), pgo_warmup=0, pgo_profile=path)
+        kernel = triton.compile(self.src, target=self.metadata.target, options=options)
+        kernel._init_handles()
+        return kernel
 
 
 class CPULauncher(object):
@@ -384,17 +3044,98 @@ class CPULauncher(object):
         cst_key = lambda i: src.fn.arg_names.index(i) if isinstance(i, str) else i
         constants = {cst_key(key): value for key, value in constants.items()}
         signature = {cst_key(key): value for key, value in src.signature.items()}
+        self.gemm = None
+        gemm = getattr(metadata, "gemm", "")
+        if gemm and not any(isinstance(ty, tuple) for ty in signature.values()):
+            # Arguments of the compiled kernel are the launch arguments that aren't constexprs.
+            positions = [i for i, ty in sorted(signature.items()) if ty != "constexpr" and i not in constants]
+            self.gemm = _GemmOffload(gemm, positions)
+        self.split_k = None
+        deterministic = getattr(metadata, "deterministic", False)
+        slot_size = getattr(metadata, "split_k_slot_size", 0)
+        if slot_size:
+            # Kernels with split K loops take the number of splits, scratch slots and tile
+            # counters as trailing arguments.
+            self.split_k = _SplitKBuffers(slot_size, metadata.split_k, metadata.num_threads, deterministic)
+            num_args = max(signature.keys(), default=-1) + 1
+            signature.update({num_args: "i32", num_args + 1: "*fp32", num_args + 2: "*i32"})
+        self.partials = None
+        partials = getattr(metadata, "thread_partials", "")
+        if partials:
+            # Kernels with deferred atomics take the number of slots and a slot buffer per target
+            # after the split-K arguments.
+            types = partials.split(",")
+            self.partials = _ThreadPartials(types, metadata.num_threads, deterministic)
+            num_args = max(signature.keys(), default=-1) + 1
+            signature.update({num_args: "i32"})
+            signature.update({num_args + 1 + i: "*" + ty for i, ty in enumerate(types)})
+        self.noalias = getattr(metadata, "noalias", False)
+        self.persistent = getattr(metadata, "persistent", False)
+        self.num_threads = metadata.num_threads
+        self.pgo = _PGOProfiler(src, metadata) if getattr(metadata, "pgo_counters", None) else None
+        self.signature_descriptor = None
+        if use_generic_launcher():
+            # The kernel pointer is the packed entry point, see load_binary.
+            self.signature_descriptor = make_signature_descriptor(constants, signature)
+            self.launch = functools.partial(get_generic_launcher().launch, self.signature_descriptor)
+            return
         src = make_launcher(constants, signature, ids)
         mod = compile_module_from_src(src, "__triton_cpu_launcher")
         self.launch = mod.launch
 
-    def __call__(self, *args, **kwargs):
-        self.launch(*args, **kwargs)
+    def expand_args(self, grid, stream, args):
+        """Return the grid and kernel arguments to launch the kernel with."""
+        if self.split_k is not None:
+            grid, args = self.split_k.expand(grid, stream, args)
+        if self.partials is not None:
+            args = self.partials.expand(grid, stream, args)
+        return grid, args
+
+    def finish(self, stream):
+        """Complete a launch of the kernel submitted to the stream."""
+        if self.partials is not None:
+            self.partials.combine(stream)
+
+    def _offload_gemm(self, grid, stream, args):
+        # Kernel arguments follow the function, metadata and hooks.
+        call_args = self.gemm.get_call_args(grid, args[5:])
+        # Launches running the kernel call the hooks themselves.
+        if call_args is None or not self.gemm.supported(call_args):
+            return False
+        launch_metadata, enter_hook, exit_hook = args[2:5]
+        if enter_hook is not None:
+            enter_hook(launch_metadata)
+        self.gemm.run(stream, call_args)
+        if exit_hook is not None:
+            exit_hook(launch_metadata)
+        return True
+
+    def __call__(self, gridX, gridY, gridZ, stream, *args, **kwargs):
+        if self.pgo is not None and (kernel := self.pgo.get_kernel(args[0])) is not None:
+            # Launch the kernel recompiled with the profile with the metadata and hooks of this launch.
+            kernel.run(gridX, gridY, gridZ, stream, kernel.function, kernel.packed_metadata, *args[2:], **kwargs)
+            return
+        if self.gemm is not None and self._offload_gemm((gridX, gridY, gridZ), stream, args):
+            return
+        if self.persistent:
+            # A program per worker, which the launcher gives a single program each.
+            gridX, gridY, gridZ = self.num_threads or _read_device_properties()["multiprocessor_count"], 1, 1
+        if self.noalias:
+            # Kernel arguments follow the function, metadata and hooks.
+            check_no_overlap(args[5:])
+        if self.split_k is not None or self.partials is not None:
+            # Kernel arguments follow the function, metadata and hooks.
+            (gridX, gridY, gridZ), kernel_args = self.expand_args((gridX, gridY, gridZ), stream, args[5:])
+            args = (*args[:5], *kernel_args)
+        self.launch(gridX, gridY, gridZ, stream, *args, **kwargs)
+        self.finish(stream)
+        if self.pgo is not None:
+            self.pgo.record_launch()
 
 
 class CPUDeviceInterface:
 
-    class HooksTimeAccessor:
+    class TraceTimeAccessor:
 
         def __init__(self, di):
             self.di = di
@@ -407,6 +3148,7 @@ class CPUDeviceInterface:
             return total_time * 1000
 
         def record(self):
+            self.di._read_trace()
             self.record_idx = len(self.di.kernel_times)
 
     class TimerEvent:
@@ -422,31 +3164,96 @@ class CPUDeviceInterface:
 
     def __init__(self):
         self.kernel_times = []
-        self.last_start = 0
-        self.use_hooks = False
-        triton.compiler.CompiledKernel.launch_enter_hook = None
-        triton.compiler.CompiledKernel.launch_exit_hook = None
+        self.trace = None
 
     def enable_hook_timing(self):
-        self.use_hooks = True
-        triton.compiler.CompiledKernel.launch_enter_hook = lambda arg: self._enter_hook()
-        triton.compiler.CompiledKernel.launch_exit_hook = lambda arg: self._exit_hook()
+        # Launchers record kernel times natively, which doesn't add Python
+        # overhead to the measured time.
+        if self.trace is None:
+            self.trace = CPULaunchTrace()
+            CPULaunchTrace.enable()
+
+    Stream = CPUStream
+    Graph = CPUGraph
+    RangeDependency = CPURangeDependency
+    LaunchTrace = CPULaunchTrace
+    Timeline = CPUTimeline
+    RegionRecords = CPURegionRecords
+    Roofline = CPURoofline
+    Benchmarker = CPUBenchmarker
+
+    def stream(self, s):
+        return stream(s)
+
+    def current_stream(self):
+        return current_stream()
 
     def synchronize(self):
-        pass
+        for s in list(CPUStream._streams):
+            s.synchronize()
 
-    def _enter_hook(self):
-        self.last_start = time.perf_counter()
-
-    def _exit_hook(self):
-        self.kernel_times.append(time.perf_counter() - self.last_start)
+    def _read_trace(self):
+        self.kernel_times.extend((rec.end_ns - rec.start_ns) * 1e-9 for rec in self.trace.read())
 
     def Event(self, enable_timing=True):
-        if self.use_hooks:
-            return CPUDeviceInterface.HooksTimeAccessor(self)
+        if self.trace is not None:
+            return CPUDeviceInterface.TraceTimeAccessor(self)
         return CPUDeviceInterface.TimerEvent()
 
 
+class CPUBoundKernel:
+    """A kernel bound to a launch site with its grid and options, which is launched with low overhead.
+
+    JITFunction.run binds arguments, computes the specialization and options keys and looks up the kernel in
+    Python on every launch, which can take longer than small kernels run. A bound kernel computes the
+    specialization key of its arguments natively and calls the launcher of the kernel compiled for it directly:
+
+        add = triton.runtime.driver.active.bind(add_kernel, grid, num_threads=4)
+        for x, y, out in batches:
+            add(x, y, out, n, BLOCK_SIZE)
+
+    All kernel arguments are passed positionally, including constexprs and arguments with defaults. The first
+    launch of each specialization and launches with launch hooks go through JITFunction.run. Pre-run hooks and
+    changes of global variables used by the kernel are only checked by those launches.
+    """
+
+    def __init__(self, fn, grid, **options):
+        self.fn = fn
+        self.grid = grid
+        self.options = options
+        modes = []
+        for kp in fn.params:
+            ty = kp.annotation_type
+            if kp.is_constexpr:
+                modes.append("c")
+            elif kp.do_not_specialize or (isinstance(ty, str) and (ty == "u1" or ty[:2] in ("fp", "bf"))):
+                modes.append("n")
+            elif kp.do_not_specialize_on_alignment:
+                modes.append("a")
+            else:
+                modes.append("s")
+        self._modes = "".join(modes).encode()
+        self._specialization_key = get_generic_launcher().specialization_key
+        # (kernel, launcher, function, metadata) by specialization key.
+        self._kernels = {}
+
+    def __call__(self, *args):
+        key = self._specialization_key(args, self._modes)
+        entry = self._kernels.get(key)
+        hooks = triton.compiler.CompiledKernel
+        if entry is None or hooks.launch_enter_hook is not None or hooks.launch_exit_hook is not None:
+            kernel = self.fn.run(*args, grid=self.grid, warmup=False, **self.options)
+            self._kernels[key] = (kernel, kernel.run, kernel.function, kernel.packed_metadata)
+            return kernel
+        kernel, run, function, metadata = entry
+        grid = self.grid(dict(zip(self.fn.arg_names, args))) if callable(self.grid) else self.grid
+        grid_size = len(grid)
+        s = current_stream()
+        run(grid[0], grid[1] if grid_size > 1 else 1, grid[2] if grid_size > 2 else 1, s.handle if s else 0,
+            function, metadata, None, None, None, *args)
+        return kernel
+
+
 class CPUDriver(DriverBase):
 
     def __init__(self):
@@ -462,7 +3269,39 @@ class CPUDriver(DriverBase):
         return torch.device("cpu", self.get_current_device())
 
     def get_current_stream(self, device):
-        return 0
+        s = current_stream()
+        return s.handle if s is not None else 0
+
+    def launch_batch(self, launches, stream=None):
+        """Run (compiled kernel, grid, args) launches as a single parallel region.
+
+        Programs of all launches are distributed across the pool at once, so
+        the synchronization cost is paid once per batch instead of once per
+        launch. Launches of a batch must be independent. Threading options of
+        the first kernel apply to the whole batch.
+        """
+        if stream is None:
+            stream = self.get_current_stream(None)
+        entries = []
+        for kernel, grid, args in launches:
+            grid = tuple(grid) + (1, ) * (3 - len(grid))
+            launcher = kernel.run
+            if launcher.signature_descriptor is None or launcher.partials is not None or launcher.gemm is not None:
+                # Per-signature launchers can't be batched, programs of batched launches would
+                # share per-thread partials, and GEMM launches don't run programs, so launch
+                # one by one.
+                kernel[grid](*args, stream=stream)
+                continue
+            launch_metadata = kernel.launch_metadata(grid, stream, *args)
+            grid, args = launcher.expand_args(grid, stream, args)
+            entries.append((launcher.signature_descriptor, *grid, kernel.function, kernel.packed_metadata,
+                            launch_metadata, *args))
+        hooks = triton.compiler.CompiledKernel
+        get_generic_launcher().launch_batch(stream, entries, hooks.launch_enter_hook, hooks.launch_exit_hook)
+
+    def bind(self, fn, grid, **options):
+        """Return fn bound to grid and options for launches with low overhead, see CPUBoundKernel."""
+        return CPUBoundKernel(fn, grid, **options)
 
     def get_current_target(self):
         # Capability and warp size are zeros for CPU.
@@ -478,20 +3317,46 @@ class CPUDriver(DriverBase):
         return True
 
     def get_benchmarker(self):
-        from triton.testing import do_bench
-
-        def do_bench_cpu(*args, **kwargs):
-            if not 'measure_time_with_hooks' in kwargs:
-                kwargs['measure_time_with_hooks'] = True
-            return do_bench(*args, **kwargs)
-
-        return do_bench_cpu
+        return CPUBenchmarker().do_bench
+
+    def get_num_compile_threads(self):
+        # Compilation stages release the GIL, so configs are compiled in parallel on all cores by default.
+        num_threads = int(os.getenv("TRITON_CPU_COMPILE_THREADS", "0"))
+        return num_threads if num_threads > 0 else os.cpu_count()
+
+    def get_default_config_prune(self):
+        return prune_configs_by_cache_model
+
+    def get_launch_tuning_space(self):
+        # Powers of two up to the pool size, and the pool size, with both schedules of multi-threaded launches.
+        max_threads = _read_device_properties()["multiprocessor_count"]
+        counts = sorted({2**i for i in range(max_threads.bit_length()) if 2**i < max_threads} | {max_threads})
+        return [{"num_threads": n, "schedule": schedule}
+                for n in counts
+                for schedule in (("static", "steal") if n > 1 else ("static", ))]
+
+    def get_fast_compile_options(self):
+        # Configs are ranked with O1 kernels, which compile several times faster than O3 ones, unless
+        # TRITON_CPU_AUTOTUNE_FAST_COMPILE=0.
+        if os.getenv("TRITON_CPU_AUTOTUNE_FAST_COMPILE", "1") == "0":
+            return {}
+        return {"fast_compile": True}
+
+    def get_tuning_fingerprint(self):
+        # The backend hash covers the CPU model and features, thread counts and schedules also depend on the
+        # topology the process runs on.
+        props = _read_device_properties()
+        keys = ("num_available_cpus", "multiprocessor_count", "num_cores", "num_packages", "num_numa_nodes",
+                "is_hybrid", "l2_cache_size", "l3_cache_size")
+        return "-".join(f"{key}={props[key]}" for key in keys)
 
     def get_empty_cache_for_benchmark(self):
         import torch
 
-        # A typical LLC size for high-end server CPUs are ~400MB.
-        cache_size = 512 * 1024 * 1024
+        # Twice the LLC size evicts caches, fall back to 512MB, typical LLC sizes for
+        # high-end server CPUs are ~400MB.
+        llc_size = _llc_size()
+        cache_size = 2 * llc_size if llc_size else 512 * 1024 * 1024
         return torch.empty(int(cache_size // 4), dtype=torch.int, device='cpu')
 
     # TODO maybe CPU should do anything here
@@ -0,0 +1,123 @@
+"""Always-on counters of the CPU runtime for production monitoring.
+
+libTritonCPURuntime counts launches and time of each kernel, busy and wall time of thread pool jobs, the latency of
+waking up workers, waits of submissions for free threads and lookups of oneDNN ukernels. Counters are kept per thread
+without atomic read-modify-write operations, so they are cheap enough to stay enabled, and they only grow, so a
+monitoring system can export snapshots and compute rates and ratios of their deltas:
+
+    from triton.backends.cpu import stats
+    before = stats.get_stats()
+    ...
+    interval = stats.diff(stats.get_stats(), before)
+    if interval["parallel_efficiency"] < 0.5:
+        ...
+"""
+import ctypes
+
+from triton.backends.cpu.driver import CPUUtils
+
+_KERNEL_FIELDS = ["launches", "programs", "ns"]
+
+
+class KernelStats(ctypes.Structure):
+    # Keep in sync with KernelStats in runtime_stats.cpp.
+    _fields_ = [
+        ("kernel", ctypes.c_void_p),
+        ("launches", ctypes.c_uint64),
+        ("programs", ctypes.c_uint64),
+        ("ns", ctypes.c_uint64),
+    ]
+
+
+def _counter_names(runtime):
+    """Return names of raw counters in the order of StatCounter in runtime_stats.h."""
+    names = []
+    while (name := runtime.triton_cpu_stats_counter_name(len(names))) is not None:
+        names.append(name.decode())
+    return names
+
+
+def _read_kernels(runtime):
+    count = 64
+    while True:
+        buf = (KernelStats * count)()
+        total = runtime.triton_cpu_stats_read_kernels(buf, ctypes.c_size_t(count))
+        if total <= count:
+            return buf[:total]
+        count = total
+
+
+def get_kernel_stats():
+    """Return launches, programs and wall time in nanoseconds of launched kernels by their names.
+
+    Specializations of a kernel are summed. Programs of batched launches share the time of the batch in proportion to
+    their numbers of programs. GEMM launches offloaded to oneDNN aren't counted.
+    """
+    runtime = CPUUtils()._get_runtime()
+    names = CPUUtils._function_names
+    res = {}
+    for rec in _read_kernels(runtime):
+        name = names.get(rec.kernel, hex(rec.kernel or 0))
+        stats = res.setdefault(name, dict.fromkeys(_KERNEL_FIELDS, 0))
+        for field in _KERNEL_FIELDS:
+            stats[field] += getattr(rec, field)
+    return res
+
+
+def _derive(stats):
+    """Add ratios of raw counters to stats."""
+
+    def ratio(num, den):
+        return num / den if den else None
+
+    stats["parallel_efficiency"] = ratio(stats["pool_busy_ns"], stats["pool_thread_ns"])
+    stats["avg_dispatch_ns"] = ratio(stats["pool_dispatch_ns"], stats["pool_dispatches"])
+    stats["avg_slot_wait_ns"] = ratio(stats["pool_slot_wait_ns"], stats["pool_slot_waits"])
+    stats["brgemm_hit_rate"] = ratio(stats["brgemm_hits"], stats["brgemm_hits"] + stats["brgemm_misses"])
+    return stats
+
+
+def get_stats():
+    """Return a snapshot of runtime counters since the start of the process.
+
+    Raw counters are:
+      - launches, kernel_ns: launches of all kernels and their wall time, see get_kernel_stats for "kernels"
+      - pool_jobs, pool_thread_ns: jobs of the thread pool and the sum of their wall times multiplied by their numbers
+        of threads
+      - pool_busy_ns: time threads of pool jobs spent running programs
+      - pool_dispatches, pool_dispatch_ns: jobs taken by pool workers and the time from submission to their start
+      - pool_slot_waits, pool_slot_wait_ns: launches that waited for threads held by concurrent launches
+      - brgemm_lookups: create_brgemm calls, most of which hit thread caches of ukernel handles
+      - brgemm_hits, brgemm_misses: lookups of the shared ukernel cache that found generated code and those that
+        generated it
+
+    Ratios computed from them are parallel_efficiency (busy time over threads times wall time), avg_dispatch_ns,
+    avg_slot_wait_ns and brgemm_hit_rate. They are None when their counters are zero.
+    """
+    runtime = CPUUtils()._get_runtime()
+    names = _counter_names(runtime)
+    values = (ctypes.c_uint64 * len(names))()
+    runtime.triton_cpu_stats_read(values)
+    kernels = get_kernel_stats()
+    res = {
+        "launches": sum(kernel["launches"] for kernel in kernels.values()),
+        "kernel_ns": sum(kernel["ns"] for kernel in kernels.values()),
+        **dict(zip(names, values)),
+    }
+    ukernel_cache = CPUUtils().get_ukernel_cache_stats()
+    res["brgemm_hits"] = ukernel_cache["hits"] if ukernel_cache else 0
+    res["brgemm_misses"] = ukernel_cache["misses"] if ukernel_cache else 0
+    res["kernels"] = kernels
+    return _derive(res)
+
+
+def diff(after, before):
+    """Return counters of the interval between two snapshots of get_stats with ratios of the interval."""
+    res = {name: value - before.get(name, 0) for name, value in after.items() if isinstance(value, int)}
+    res["kernels"] = {}
+    for name, kernel in after["kernels"].items():
+        prev = before["kernels"].get(name, {})
+        delta = {field: kernel[field] - prev.get(field, 0) for field in _KERNEL_FIELDS}
+        if delta["launches"]:
+            res["kernels"][name] = delta
+    return _derive(res)
@@ -0,0 +1,520 @@
+"""
+Benchmark suite of CPU kernels with regression tracking.
+
+Runs a fixed set of kernels (GEMM, GEMV, softmax, layernorm, attention, reductions, scans and
+elementwise ops) and writes a JSON file keyed by the CPU model and the commit:
+
+    python third_party/cpu/benchmarks/bench_cpu.py --output-dir bench-results
+    python third_party/cpu/benchmarks/bench_cpu.py --filter gemm --baseline bench-results/<cpu>/<commit>.json
+
+With --baseline, cases that got slower than --threshold relative to the baseline are reported and the
+script exits with a non-zero code, so a regression in passes like ConvertDotToAMX or OptimizeMasks fails
+the run. GEMM cases cover the dot lowerings selected by CPU features (AMX, FMA, generic) and the ukernel
+libraries the build supports.
+"""
+
+import argparse
+import dataclasses
+import datetime
+import json
+import os
+import platform
+import re
+import subprocess
+import sys
+from typing import Callable, Dict, List
+
+import torch
+
+import triton
+import triton.language as tl
+from triton._C.libtriton import llvm
+
+# ------------------------
+# Kernels
+# ------------------------
+
+
+@triton.jit
+def matmul_kernel(a_ptr, b_ptr, c_ptr, M, N, K, BLOCK_SIZE_M: tl.constexpr, BLOCK_SIZE_N: tl.constexpr,
+                  BLOCK_SIZE_K: tl.constexpr, GROUP_SIZE_M: tl.constexpr, ACC_TYPE: tl.constexpr):
+    pid = tl.program_id(axis=0)
+    num_pid_m = tl.cdiv(M, BLOCK_SIZE_M)
+    num_pid_n = tl.cdiv(N, BLOCK_SIZE_N)
+    num_pid_in_group = GROUP_SIZE_M * num_pid_n
+    group_id = pid // num_pid_in_group
+    first_pid_m = group_id * GROUP_SIZE_M
+    group_size_m = min(num_pid_m - first_pid_m, GROUP_SIZE_M)
+    pid_m = first_pid_m + (pid % group_size_m)
+    pid_n = (pid % num_pid_in_group) // group_size_m
+
+    a_tile_ptr = tl.make_block_ptr(base=a_ptr, shape=(M, K), strides=(K, 1), offsets=(pid_m * BLOCK_SIZE_M, 0),
+                                   block_shape=(BLOCK_SIZE_M, BLOCK_SIZE_K), order=(1, 0))
+    b_tile_ptr = tl.make_block_ptr(base=b_ptr, shape=(K, N), strides=(N, 1), offsets=(0, pid_n * BLOCK_SIZE_N),
+                                   block_shape=(BLOCK_SIZE_K, BLOCK_SIZE_N), order=(1, 0))
+    acc = tl.zeros((BLOCK_SIZE_M, BLOCK_SIZE_N), dtype=ACC_TYPE)
+    for _ in range(0, tl.cdiv(K, BLOCK_SIZE_K)):
+        a = tl.load(a_tile_ptr)
+        b = tl.load(b_tile_ptr)
+        acc = tl.dot(a, b, acc, out_dtype=ACC_TYPE)
+        a_tile_ptr = tl.advance(a_tile_ptr, [0, BLOCK_SIZE_K])
+        b_tile_ptr = tl.advance(b_tile_ptr, [BLOCK_SIZE_K, 0])
+
+    c_tile_ptr = tl.make_block_ptr(base=c_ptr, shape=(M, N), strides=(N, 1),
+                                   offsets=(pid_m * BLOCK_SIZE_M, pid_n * BLOCK_SIZE_N),
+                                   block_shape=(BLOCK_SIZE_M, BLOCK_SIZE_N), order=(1, 0))
+    tl.store(c_tile_ptr, acc)
+
+
+@triton.jit
+def gemv_kernel(y_ptr, a_ptr, x_ptr, M, N, BLOCK_SIZE_M: tl.constexpr, BLOCK_SIZE_N: tl.constexpr):
+    rm = tl.program_id(0) * BLOCK_SIZE_M + tl.arange(0, BLOCK_SIZE_M)
+    rn = tl.arange(0, BLOCK_SIZE_N)
+    a_ptrs = a_ptr + rm[:, None] * N + rn[None, :]
+    x_ptrs = x_ptr + rn
+    acc = tl.zeros((BLOCK_SIZE_M, ), dtype=tl.float32)
+    for _ in range(0, N, BLOCK_SIZE_N):
+        a = tl.load(a_ptrs).to(tl.float32)
+        x = tl.load(x_ptrs).to(tl.float32)
+        acc += tl.sum(a * x[None, :], axis=1)
+        a_ptrs += BLOCK_SIZE_N
+        x_ptrs += BLOCK_SIZE_N
+    tl.store(y_ptr + rm, acc.to(y_ptr.dtype.element_ty))
+
+
+@triton.jit
+def softmax_kernel(out_ptr, in_ptr, n_cols, BLOCK_SIZE: tl.constexpr):
+    row = tl.program_id(0)
+    offs = tl.arange(0, BLOCK_SIZE)
+    mask = offs < n_cols
+    x = tl.load(in_ptr + row * n_cols + offs, mask=mask, other=-float('inf'))
+    num = tl.exp(x - tl.max(x, axis=0))
+    tl.store(out_ptr + row * n_cols + offs, num / tl.sum(num, axis=0), mask=mask)
+
+
+@triton.jit
+def layernorm_kernel(out_ptr, in_ptr, w_ptr, b_ptr, n_cols, eps, BLOCK_SIZE: tl.constexpr):
+    row = tl.program_id(0)
+    offs = tl.arange(0, BLOCK_SIZE)
+    mask = offs < n_cols
+    x = tl.load(in_ptr + row * n_cols + offs, mask=mask, other=0.0)
+    mean = tl.sum(x, axis=0) / n_cols
+    diff = tl.where(mask, x - mean, 0.0)
+    rstd = 1 / tl.sqrt(tl.sum(diff * diff, axis=0) / n_cols + eps)
+    w = tl.load(w_ptr + offs, mask=mask)
+    b = tl.load(b_ptr + offs, mask=mask)
+    tl.store(out_ptr + row * n_cols + offs, diff * rstd * w + b, mask=mask)
+
+
+@triton.jit
+def attention_kernel(out_ptr, q_ptr, k_ptr, v_ptr, seq_len, sm_scale, HEAD_DIM: tl.constexpr,
+                     BLOCK_SIZE_M: tl.constexpr, BLOCK_SIZE_N: tl.constexpr):
+    # Forward pass of a single head with the online softmax, one block of queries per program.
+    start_m = tl.program_id(0) * BLOCK_SIZE_M
+    head = tl.program_id(1) * seq_len * HEAD_DIM
+    offs_m = start_m + tl.arange(0, BLOCK_SIZE_M)
+    offs_n = tl.arange(0, BLOCK_SIZE_N)
+    offs_d = tl.arange(0, HEAD_DIM)
+    q = tl.load(q_ptr + head + offs_m[:, None] * HEAD_DIM + offs_d[None, :])
+    m_i = tl.full((BLOCK_SIZE_M, ), -float('inf'), dtype=tl.float32)
+    l_i = tl.zeros((BLOCK_SIZE_M, ), dtype=tl.float32)
+    acc = tl.zeros((BLOCK_SIZE_M, HEAD_DIM), dtype=tl.float32)
+    for start_n in range(0, seq_len, BLOCK_SIZE_N):
+        kv_offs = head + (start_n + offs_n)[:, None] * HEAD_DIM + offs_d[None, :]
+        k = tl.load(k_ptr + kv_offs)
+        qk = tl.dot(q, tl.trans(k)) * sm_scale
+        m_ij = tl.maximum(m_i, tl.max(qk, axis=1))
+        p = tl.exp(qk - m_ij[:, None])
+        alpha = tl.exp(m_i - m_ij)
+        l_i = l_i * alpha + tl.sum(p, axis=1)
+        v = tl.load(v_ptr + kv_offs)
+        acc = acc * alpha[:, None] + tl.dot(p.to(v.dtype), v)
+        m_i = m_ij
+    acc = acc / l_i[:, None]
+    tl.store(out_ptr + head + offs_m[:, None] * HEAD_DIM + offs_d[None, :], acc.to(out_ptr.dtype.element_ty))
+
+
+@triton.jit
+def row_sum_kernel(out_ptr, in_ptr, n_cols, BLOCK_SIZE_M: tl.constexpr, BLOCK_SIZE_N: tl.constexpr):
+    rm = tl.program_id(0) * BLOCK_SIZE_M + tl.arange(0, BLOCK_SIZE_M)
+    rn = tl.arange(0, BLOCK_SIZE_N)
+    acc = tl.zeros((BLOCK_SIZE_M, ), dtype=tl.float32)
+    for start_n in range(0, n_cols, BLOCK_SIZE_N):
+        acc += tl.sum(tl.load(in_ptr + rm[:, None] * n_cols + (start_n + rn)[None, :]), axis=1)
+    tl.store(out_ptr + rm, acc)
+
+
+@triton.jit
+def row_max_kernel(out_ptr, in_ptr, n_cols, BLOCK_SIZE_M: tl.constexpr, BLOCK_SIZE_N: tl.constexpr):
+    rm = tl.program_id(0) * BLOCK_SIZE_M + tl.arange(0, BLOCK_SIZE_M)
+    rn = tl.arange(0, BLOCK_SIZE_N)
+    acc = tl.full((BLOCK_SIZE_M, ), -float('inf'), dtype=tl.float32)
+    for start_n in range(0, n_cols, BLOCK_SIZE_N):
+        block = tl.load(in_ptr + rm[:, None] * n_cols + (start_n + rn)[None, :])
+        acc = tl.maximum(acc, tl.max(block, axis=1))
+    tl.store(out_ptr + rm, acc)
+
+
+@triton.jit
+def cumsum_kernel(out_ptr, in_ptr, n_cols, BLOCK_SIZE: tl.constexpr):
+    row = tl.program_id(0)
+    offs = tl.arange(0, BLOCK_SIZE)
+    mask = offs < n_cols
+    x = tl.load(in_ptr + row * n_cols + offs, mask=mask, other=0.0)
+    tl.store(out_ptr + row * n_cols + offs, tl.cumsum(x, axis=0), mask=mask)
+
+
+@triton.jit
+def add_kernel(out_ptr, x_ptr, y_ptr, n_elements, BLOCK_SIZE: tl.constexpr):
+    offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+    mask = offs < n_elements
+    x = tl.load(x_ptr + offs, mask=mask)
+    y = tl.load(y_ptr + offs, mask=mask)
+    tl.store(out_ptr + offs, x + y, mask=mask)
+
+
+@triton.jit
+def gelu_kernel(out_ptr, x_ptr, n_elements, BLOCK_SIZE: tl.constexpr):
+    offs = tl.program_id(0) * BLOCK_SIZE + tl.arange(0, BLOCK_SIZE)
+    mask = offs < n_elements
+    x = tl.load(x_ptr + offs, mask=mask)
+    # tanh approximation, tanh(a) = 2 * sigmoid(2a) - 1.
+    inner = 0.7978845608 * (x + 0.044715 * x * x * x)
+    tl.store(out_ptr + offs, x * tl.sigmoid(2 * inner), mask=mask)
+
+
+# ------------------------
+# Cases
+# ------------------------
+
+
+@dataclasses.dataclass
+class BenchCase:
+    # Unique name of the case, results are keyed by it.
+    name: str
+    # Returns the function to benchmark and a function checking its results, called once before timing.
+    setup: Callable
+    flops: float
+    bytes: float
+
+
+CASES: List[BenchCase] = []
+
+
+def _case(name, flops, nbytes):
+
+    def wrap(setup):
+        CASES.append(BenchCase(name, setup, flops, nbytes))
+        return setup
+
+    return wrap
+
+
+DTYPES = {"fp32": torch.float32, "bf16": torch.bfloat16, "int8": torch.int8}
+
+
+def _available_ukernels():
+    from triton._C.libtriton import cpu
+    res = [None]
+    if cpu.onednn_available():
+        res.append("OneDNN")
+    if cpu.xsmm_available():
+        res.append("XSMM")
+    return res
+
+
+def _register_gemm_cases():
+    for dtype in DTYPES:
+        for ukernels in _available_ukernels():
+            for M, N, K in [(512, 512, 512), (1024, 1024, 1024), (128, 4096, 4096)]:
+                in_ty = DTYPES[dtype]
+                elem = torch.empty((), dtype=in_ty).element_size()
+                acc_size = 4
+                path = ukernels.lower() if ukernels else "native"
+
+                def setup(M=M, N=N, K=K, in_ty=in_ty, ukernels=ukernels):
+                    if in_ty == torch.int8:
+                        a = torch.randint(-8, 8, (M, K), dtype=in_ty)
+                        b = torch.randint(-8, 8, (K, N), dtype=in_ty)
+                        c = torch.empty((M, N), dtype=torch.int32)
+                        acc_ty, ref = tl.int32, lambda: a.to(torch.int32) @ b.to(torch.int32)
+                        block_m, block_n, block_k = 32, 32, 64
+                    else:
+                        a = torch.randn((M, K), dtype=in_ty)
+                        b = torch.randn((K, N), dtype=in_ty)
+                        c = torch.empty((M, N), dtype=torch.float32)
+                        acc_ty, ref = tl.float32, lambda: a.float() @ b.float()
+                        block_m, block_n, block_k = (8, 32, 8) if in_ty == torch.float32 else (32, 32, 32)
+                    grid = (triton.cdiv(M, block_m) * triton.cdiv(N, block_n), )
+                    kwargs = dict(BLOCK_SIZE_M=block_m, BLOCK_SIZE_N=block_n, BLOCK_SIZE_K=block_k, GROUP_SIZE_M=8,
+                                  ACC_TYPE=acc_ty)
+                    if ukernels:
+                        kwargs["ukernels"] = ukernels
+
+                    def check():
+                        torch.testing.assert_close(c.float(), ref().float(), rtol=1e-2, atol=1e-1 * K**0.5)
+
+                    return lambda: matmul_kernel[grid](a, b, c, M, N, K, **kwargs), check
+
+                _case(f"gemm_{dtype}_{path}_{M}x{N}x{K}", 2.0 * M * N * K,
+                      (M * K + K * N) * elem + M * N * acc_size)(setup)
+
+
+def _register_gemv_cases():
+    for dtype in ("fp32", "bf16"):
+        for M, N in [(4096, 4096), (11008, 4096)]:
+            elem = torch.empty((), dtype=DTYPES[dtype]).element_size()
+
+            def setup(M=M, N=N, dtype=DTYPES[dtype]):
+                a = torch.randn((M, N), dtype=dtype)
+                x = torch.randn((N, ), dtype=dtype)
+                y = torch.empty((M, ), dtype=dtype)
+                grid = (M // 16, )
+
+                def check():
+                    torch.testing.assert_close(y.float(), a.float() @ x.float(), rtol=2e-2, atol=1e-1 * N**0.5)
+
+                return lambda: gemv_kernel[grid](y, a, x, M, N, BLOCK_SIZE_M=16, BLOCK_SIZE_N=64), check
+
+            _case(f"gemv_{dtype}_{M}x{N}", 2.0 * M * N, (M * N + N + M) * elem)(setup)
+
+
+def _register_row_cases():
+    for M, N in [(4096, 1024), (1024, 8192)]:
+        size = M * N
+
+        def softmax_setup(M=M, N=N):
+            x = torch.randn((M, N))
+            y = torch.empty_like(x)
+
+            def check():
+                torch.testing.assert_close(y, torch.softmax(x, dim=-1))
+
+            return lambda: softmax_kernel[(M, )](y, x, N, BLOCK_SIZE=triton.next_power_of_2(N)), check
+
+        _case(f"softmax_{M}x{N}", 4.0 * size, 8.0 * size)(softmax_setup)
+
+        def layernorm_setup(M=M, N=N):
+            x = torch.randn((M, N))
+            w = torch.randn((N, ))
+            b = torch.randn((N, ))
+            y = torch.empty_like(x)
+
+            def check():
+                torch.testing.assert_close(y, torch.nn.functional.layer_norm(x, (N, ), w, b, 1e-5), rtol=1e-4,
+                                           atol=1e-4)
+
+            return lambda: layernorm_kernel[(M, )](y, x, w, b, N, 1e-5, BLOCK_SIZE=triton.next_power_of_2(N)), check
+
+        _case(f"layernorm_{M}x{N}", 8.0 * size, 8.0 * size + 8.0 * N)(layernorm_setup)
+
+        def cumsum_setup(M=M, N=N):
+            x = torch.randn((M, N))
+            y = torch.empty_like(x)
+
+            def check():
+                torch.testing.assert_close(y, torch.cumsum(x, dim=-1), rtol=1e-3, atol=1e-2 * N**0.5)
+
+            return lambda: cumsum_kernel[(M, )](y, x, N, BLOCK_SIZE=triton.next_power_of_2(N)), check
+
+        _case(f"cumsum_{M}x{N}", 1.0 * size, 8.0 * size)(cumsum_setup)
+
+        for op, kernel, ref in [("sum", row_sum_kernel, lambda x: x.sum(dim=-1)),
+                                ("max", row_max_kernel, lambda x: x.amax(dim=-1))]:
+
+            def reduce_setup(M=M, N=N, kernel=kernel, ref=ref):
+                x = torch.randn((M, N))
+                y = torch.empty((M, ))
+
+                def check():
+                    torch.testing.assert_close(y, ref(x), rtol=1e-4, atol=1e-3 * N**0.5)
+
+                return lambda: kernel[(M // 8, )](y, x, N, BLOCK_SIZE_M=8, BLOCK_SIZE_N=256), check
+
+            _case(f"reduce_{op}_{M}x{N}", 1.0 * size, 4.0 * (size + M))(reduce_setup)
+
+
+def _register_attention_cases():
+    for dtype in ("fp32", "bf16"):
+        for heads, seq_len, head_dim in [(16, 1024, 64), (8, 2048, 128)]:
+            elem = torch.empty((), dtype=DTYPES[dtype]).element_size()
+
+            def setup(heads=heads, seq_len=seq_len, head_dim=head_dim, dtype=DTYPES[dtype]):
+                q, k, v = (torch.randn((heads, seq_len, head_dim), dtype=dtype) for _ in range(3))
+                out = torch.empty_like(q)
+                sm_scale = head_dim**-0.5
+                block_m = 32
+                grid = (seq_len // block_m, heads)
+
+                def check():
+                    ref = torch.nn.functional.scaled_dot_product_attention(q.float(), k.float(), v.float())
+                    torch.testing.assert_close(out.float(), ref, rtol=2e-2, atol=2e-2)
+
+                return lambda: attention_kernel[grid](out, q, k, v, seq_len, sm_scale, HEAD_DIM=head_dim,
+                                                      BLOCK_SIZE_M=block_m, BLOCK_SIZE_N=64), check
+
+            # Two seq_len x seq_len x head_dim products per head, K and V are read once per query block.
+            flops = 4.0 * heads * seq_len * seq_len * head_dim
+            nbytes = elem * heads * seq_len * head_dim * (2 + 2 * seq_len // 32)
+            _case(f"attention_{dtype}_{heads}x{seq_len}x{head_dim}", flops, nbytes)(setup)
+
+
+def _register_elementwise_cases():
+    for n in [1 << 20, 1 << 24]:
+
+        def add_setup(n=n):
+            x = torch.randn((n, ))
+            y = torch.randn((n, ))
+            out = torch.empty_like(x)
+            grid = (triton.cdiv(n, 4096), )
+
+            def check():
+                torch.testing.assert_close(out, x + y)
+
+            return lambda: add_kernel[grid](out, x, y, n, BLOCK_SIZE=4096), check
+
+        _case(f"add_{n}", 1.0 * n, 12.0 * n)(add_setup)
+
+        def gelu_setup(n=n):
+            x = torch.randn((n, ))
+            out = torch.empty_like(x)
+            grid = (triton.cdiv(n, 4096), )
+
+            def check():
+                torch.testing.assert_close(out, torch.nn.functional.gelu(x, approximate="tanh"), rtol=1e-4,
+                                           atol=1e-4)
+
+            return lambda: gelu_kernel[grid](out, x, n, BLOCK_SIZE=4096), check
+
+        _case(f"gelu_{n}", 10.0 * n, 8.0 * n)(gelu_setup)
+
+
+def register_cases():
+    if not CASES:
+        _register_gemm_cases()
+        _register_gemv_cases()
+        _register_row_cases()
+        _register_attention_cases()
+        _register_elementwise_cases()
+    return CASES
+
+
+# ------------------------
+# Results
+# ------------------------
+
+
+def cpu_model():
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name") or line.startswith("Model"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor() or llvm.get_cpu_name()
+
+
+def git_commit():
+    try:
+        return subprocess.check_output(["git", "rev-parse", "HEAD"], cwd=os.path.dirname(os.path.abspath(__file__)),
+                                       stderr=subprocess.DEVNULL, text=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def machine_info():
+    return {
+        "cpu_model": cpu_model(),
+        "cpu_name": llvm.get_cpu_name(),
+        "cpu_features": sorted(llvm.get_cpu_features()),
+        "num_cpus": os.cpu_count(),
+        "max_threads": os.getenv("TRITON_CPU_MAX_THREADS"),
+    }
+
+
+def run_cases(cases, warmup, rep) -> Dict[str, dict]:
+    do_bench = triton.runtime.driver.active.get_benchmarker()
+    results = {}
+    for case in cases:
+        fn, check = case.setup()
+        fn()
+        check()
+        ms, min_ms, max_ms = do_bench(fn, warmup=warmup, rep=rep, quantiles=[0.5, 0.2, 0.8])
+        results[case.name] = {
+            "ms": ms,
+            "min_ms": min_ms,
+            "max_ms": max_ms,
+            "gflops": case.flops / (ms * 1e-3) * 1e-9,
+            "gbps": case.bytes / (ms * 1e-3) * 1e-9,
+        }
+        print(f"{case.name:48} {ms:10.4f} ms {results[case.name]['gflops']:10.1f} GFLOP/s "
+              f"{results[case.name]['gbps']:10.1f} GB/s", flush=True)
+    return results
+
+
+def compare(results, baseline, threshold):
+    """Return names of cases that are slower than in the baseline by more than threshold."""
+    regressions = []
+    for name, res in sorted(results.items()):
+        if name not in baseline:
+            continue
+        ratio = res["ms"] / baseline[name]["ms"]
+        if ratio > 1 + threshold:
+            regressions.append(name)
+        mark = " REGRESSION" if ratio > 1 + threshold else ""
+        print(f"{name:48} {baseline[name]['ms']:10.4f} -> {res['ms']:10.4f} ms ({ratio - 1:+.1%}){mark}")
+    return regressions
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--filter", default=None, help="regular expression selecting cases by name")
+    parser.add_argument("--list", action="store_true", help="list cases and exit")
+    parser.add_argument("--output-dir", default=None,
+                        help="write results to <dir>/<cpu model>/<commit>.json, so runs of machines and commits "
+                        "don't overwrite each other")
+    parser.add_argument("--baseline", default=None, help="results file to compare with")
+    parser.add_argument("--threshold", type=float, default=0.05,
+                        help="relative slowdown against the baseline reported as a regression")
+    parser.add_argument("--warmup", type=int, default=25, help="warmup time in ms")
+    parser.add_argument("--rep", type=int, default=100, help="measurement time in ms")
+    args = parser.parse_args(argv)
+
+    cases = register_cases()
+    if args.filter:
+        cases = [case for case in cases if re.search(args.filter, case.name)]
+    if args.list:
+        for case in cases:
+            print(case.name)
+        return 0
+
+    report = {
+        "machine": machine_info(),
+        "commit": git_commit(),
+        "triton_version": triton.__version__,
+        "timestamp": datetime.datetime.now(datetime.timezone.utc).isoformat(),
+        "results": run_cases(cases, args.warmup, args.rep),
+    }
+    if args.output_dir:
+        model = re.sub(r"[^A-Za-z0-9]+", "_", report["machine"]["cpu_model"]).strip("_")
+        path = os.path.join(args.output_dir, model, f"{report['commit']}.json")
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        with open(path, "w") as f:
+            json.dump(report, f, indent=2)
+        print(f"Results written to {path}")
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if baseline["machine"]["cpu_model"] != report["machine"]["cpu_model"]:
+            print(f"Warning: the baseline was measured on {baseline['machine']['cpu_model']}", file=sys.stderr)
+        regressions = compare(report["results"], baseline["results"], args.threshold)
+        if regressions:
+            print(f"{len(regressions)} regression(s): {', '.join(regressions)}", file=sys.stderr)
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,48 @@
+#ifndef TRITON_CPU_ANALYSIS_KERNELCOST_H
+#define TRITON_CPU_ANALYSIS_KERNELCOST_H
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Support/LLVM.h"
+
+namespace mlir::triton::cpu {
+
+// Static estimate of the work of a single program of a kernel.
+struct KernelCost {
+  // Floating point operations of contractions and elementwise ops, including
+  // integer operations of dots. A multiply-add counts as two operations.
+  double flops = 0;
+  // Bytes moved between registers and memory that wasn't allocated by the
+  // kernel itself, i.e. loads, stores, gathers and scatters of global memory.
+  double bytes = 0;
+  // False if some loops have unknown trip counts, or the cost depends on
+  // taken branches. Bodies of such loops are counted once and the most
+  // expensive branch is counted.
+  bool exact = true;
+  // Smallest number of bytes of global memory written by a store executed
+  // once per program, i.e. outside of loops, or zero if there are none.
+  // Programs storing less than a cache line, e.g. a scalar per row, share
+  // output lines with their neighbours.
+  int64_t minStoreBytes = 0;
+
+  KernelCost &operator+=(const KernelCost &other) {
+    flops += other.flops;
+    bytes += other.bytes;
+    exact = exact && other.exact;
+    addStore(other.minStoreBytes);
+    return *this;
+  }
+
+  void addStore(int64_t storeBytes) {
+    if (storeBytes > 0 && (minStoreBytes == 0 || storeBytes < minStoreBytes))
+      minStoreBytes = storeBytes;
+  }
+};
+
+// Estimate the cost of a program of the kernel function in a TTCIR module.
+// Loops with constant trip counts are scaled by their trip counts, calls are
+// counted by the cost of their callees.
+KernelCost estimateKernelCost(ModuleOp mod, StringRef kernelName);
+
+} // namespace mlir::triton::cpu
+
+#endif
@@ -102,6 +102,18 @@ private:
   void update(CallOpInterface callOp, FunctionOpInterface funcOp);
 };
 
+// Range [lo, hi] of offsets a tensor pointer can have along a dimension.
+// Offsets are followed through tt.advance and through scf.for loops with
+// constant bounds, which advance loop-carried pointers or build them from
+// the induction variable. std::nullopt is returned if the range is unknown.
+std::optional<std::pair<int64_t, int64_t>>
+getTensorPtrOffsetRange(Value ptr, unsigned dim);
+
+// Return true if the block of a tensor pointer provably stays within the
+// tensor shape along a dimension, so its boundary check can be dropped.
+bool isTensorPtrInBounds(Value ptr, const TensorPtrShapeInfo &shapeInfo,
+                         unsigned dim);
+
 } // namespace mlir::triton::cpu
 
 #endif // TRITON_CPU_ANALYSIS_TENSORPTRSHAPEINFO_H
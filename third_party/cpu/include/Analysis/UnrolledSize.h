@@ -0,0 +1,28 @@
+#ifndef TRITON_CPU_ANALYSIS_UNROLLEDSIZE_H
+#define TRITON_CPU_ANALYSIS_UNROLLEDSIZE_H
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Support/LLVM.h"
+
+namespace mlir::triton::cpu {
+
+// Static estimate of the number of operations a TTIR module is unrolled into
+// when its tensors are lowered to vectors of the target and to scalars. Loops
+// are counted once, since only their bodies are unrolled.
+struct UnrolledSize {
+  // Operations on vectors of the target, into which ops on blocks are split,
+  // e.g. loads and stores whose vector transfers are fully unrolled unless
+  // they are lowered to loops, see vector_unroll_limit.
+  int64_t vectorOps = 0;
+  // Operations on single elements of blocks, which have no loop lowering,
+  // i.e. of atomics, histograms and prints.
+  int64_t elementOps = 0;
+};
+
+// Estimate the unrolled size of all functions of a TTIR module for vectors
+// of vectorBits.
+UnrolledSize estimateUnrolledSize(ModuleOp mod, unsigned vectorBits);
+
+} // namespace mlir::triton::cpu
+
+#endif
@@ -5,6 +5,7 @@
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/DialectConversion.h"
 
+#include "third_party/proton/dialect/include/Dialect/Proton/IR/Dialect.h"
 #include "triton/Dialect/Triton/IR/Dialect.h"
 
 #include <memory>
@@ -17,6 +18,10 @@ template <typename T> class OperationPass;
 namespace triton {
 namespace cpu {
 
+// Marks entry points added to kernels by FuncOpToLLVM, e.g. the one running
+// a range of programs, which are not kernels on their own.
+constexpr static char AttrKernelEntryName[] = "triton_cpu.kernel_entry";
+
 enum class VecLib {
   Mvec,
   Sleef,
@@ -26,16 +31,31 @@ enum class VecLib {
 #include "cpu/include/TritonCPUToLLVM/Passes.h.inc"
 
 std::unique_ptr<OperationPass<ModuleOp>> createFuncOpToLLVMPass();
+std::unique_ptr<OperationPass<ModuleOp>> createFuncOpToLLVMPass(bool noalias);
 std::unique_ptr<OperationPass<ModuleOp>> createMemoryOpToLLVMPass();
 std::unique_ptr<OperationPass<ModuleOp>> createGetProgramIdOpToLLVMPass();
+std::unique_ptr<OperationPass<ModuleOp>> createHoistGridInvariantsPass();
 std::unique_ptr<OperationPass<triton::FuncOp>> createLowerMultiReductionPass();
+std::unique_ptr<OperationPass<triton::FuncOp>>
+createLowerMultiReductionPass(unsigned vectorBits);
+std::unique_ptr<OperationPass<ModuleOp>> createLowerTransposesPass();
+std::unique_ptr<OperationPass<ModuleOp>>
+createLowerTransposesPass(unsigned vectorBits, bool enableAvx2);
 std::unique_ptr<OperationPass<ModuleOp>> createAtomicOpsToLLVMPass();
 std::unique_ptr<OperationPass<ModuleOp>> createDebugOpsToLLVMPass();
+std::unique_ptr<OperationPass<ModuleOp>> createRecordOpToLLVMPass();
 std::unique_ptr<OperationPass<ModuleOp>> createUkernelOpsToOneDNNLLVMPass();
 std::unique_ptr<OperationPass<ModuleOp>> createUkernelOpsToXSMMLLVMPass();
+std::unique_ptr<OperationPass<ModuleOp>> createVectorToSCFPass();
+std::unique_ptr<OperationPass<ModuleOp>>
+createVectorToSCFPass(unsigned targetRank, unsigned maxUnrolledSlices);
+std::unique_ptr<OperationPass<ModuleOp>> createMathToPolynomialsPass();
+std::unique_ptr<OperationPass<ModuleOp>>
+createMathToPolynomialsPass(bool enableAvx2);
 std::unique_ptr<OperationPass<ModuleOp>>
 createMathToVecLibPass(VecLib lib = VecLib::Sleef,
-                       std::set<std::string> cpu_features = {});
+                       std::set<std::string> cpu_features = {},
+                       size_t scalable_bits = 0, size_t max_vec_bits = 0);
 
 #define GEN_PASS_REGISTRATION
 #include "cpu/include/TritonCPUToLLVM/Passes.h.inc"
@@ -120,6 +120,41 @@ inline Value shapeCast(Location loc, Value in,
   return shapeCast(loc, in, outTy, rewriter);
 }
 
+// High half of unsigned multiplication. Extended multiplication of i32
+// vectors is lowered by LLVM to widening of both operands and shuffles that
+// pack high halves of products. Instead, view vectors as i64 lanes holding
+// pairs of elements, multiply even and odd elements separately with
+// 32x32->64 multiplications (vpmuludq on x86) and blend high halves of the
+// products in place.
+inline Value mulhiUI(Location loc, Value lhs, Value rhs,
+                     PatternRewriter &rewriter) {
+  auto vecTy = dyn_cast<VectorType>(lhs.getType());
+  if (!vecTy || !vecTy.getElementType().isInteger(32) ||
+      vecTy.getShape().back() % 2 != 0 || vecTy.isScalable())
+    return rewriter.create<arith::MulUIExtendedOp>(loc, lhs, rhs).getHigh();
+
+  SmallVector<int64_t> shape(vecTy.getShape());
+  shape.back() /= 2;
+  auto pairsTy = VectorType::get(shape, rewriter.getI64Type());
+  Value lhsPairs = rewriter.create<vector::BitCastOp>(loc, pairsTy, lhs);
+  Value rhsPairs = rewriter.create<vector::BitCastOp>(loc, pairsTy, rhs);
+  Value loMask = intCst(loc, pairsTy, 0xffffffffLL, rewriter);
+  Value hiMask = intCst(loc, pairsTy, ~0xffffffffLL, rewriter);
+  Value shift = intCst(loc, pairsTy, 32, rewriter);
+
+  // Elements at even positions are in low halves of pairs.
+  Value evenProd = rewriter.create<arith::MulIOp>(
+      loc, rewriter.create<arith::AndIOp>(loc, lhsPairs, loMask),
+      rewriter.create<arith::AndIOp>(loc, rhsPairs, loMask));
+  Value oddProd = rewriter.create<arith::MulIOp>(
+      loc, rewriter.create<arith::ShRUIOp>(loc, lhsPairs, shift),
+      rewriter.create<arith::ShRUIOp>(loc, rhsPairs, shift));
+  Value res = rewriter.create<arith::OrIOp>(
+      loc, rewriter.create<arith::ShRUIOp>(loc, evenProd, shift),
+      rewriter.create<arith::AndIOp>(loc, oddProd, hiMask));
+  return rewriter.create<vector::BitCastOp>(loc, vecTy, res);
+}
+
 } // namespace cpu
 } // namespace triton
 } // namespace mlir
@@ -144,6 +179,7 @@ inline Value shapeCast(Location loc, Value in,
 #define op_sext(ty, val) rewriter.create<arith::ExtSIOp>(loc, ty, val)
 #define op_and(lhs, rhs) rewriter.create<arith::AndIOp>(loc, lhs, rhs)
 #define op_or(lhs, rhs) rewriter.create<arith::OrIOp>(loc, lhs, rhs)
+#define op_xor(lhs, rhs) rewriter.create<arith::XOrIOp>(loc, lhs, rhs)
 #define op_minui(lhs, rhs) rewriter.create<arith::MinUIOp>(loc, lhs, rhs)
 #define op_maxui(lhs, rhs) rewriter.create<arith::MaxUIOp>(loc, lhs, rhs)
 #define op_select(cond, val, other)                                            \
@@ -27,12 +27,46 @@ std::unique_ptr<OperationPass<ModuleOp>> createConvertUnsupportedOps();
 std::unique_ptr<OperationPass<ModuleOp>>
 createConvertUnsupportedOps(bool promoteBf16ToFp32,
                             bool convertMixedPrecisionMatmul,
-                            bool promoteLibMathToFp32);
+                            bool promoteLibMathToFp32, bool nativeFp16Math);
 std::unique_ptr<OperationPass<ModuleOp>> createDecomposeFpConversions();
 std::unique_ptr<OperationPass<ModuleOp>>
 createDecomposeFpConversions(bool decomposeBf16Conversions,
-                             bool decomposeFp8Conversions);
+                             bool decomposeFp8Conversions,
+                             unsigned fp8LookupBits);
 std::unique_ptr<OperationPass<ModuleOp>> createOptimizeMasks();
+std::unique_ptr<OperationPass<ModuleOp>> createOptimizeMasks(bool versionTiles);
+std::unique_ptr<OperationPass<ModuleOp>> createReduceIntDivisions();
+std::unique_ptr<OperationPass<ModuleOp>> createConvertIfToSelects();
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertIfToSelects(unsigned vectorBits, int64_t maxCost);
+std::unique_ptr<OperationPass<ModuleOp>> createConvertGathersToPermutes();
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertGathersToPermutes(unsigned lookupBits);
+std::unique_ptr<OperationPass<ModuleOp>> createInterleaveReductions();
+std::unique_ptr<OperationPass<ModuleOp>>
+createInterleaveReductions(unsigned vectorBits, unsigned maxAccumulators,
+                           unsigned minInFlightVectors, bool reassociateFp);
+std::unique_ptr<OperationPass<ModuleOp>> createStripMineVectors();
+std::unique_ptr<OperationPass<ModuleOp>>
+createStripMineVectors(unsigned vectorBits, unsigned subBlockVectors,
+                       unsigned minVectors, bool noalias);
+std::unique_ptr<OperationPass<ModuleOp>> createFoldSelects();
+std::unique_ptr<OperationPass<ModuleOp>>
+createFoldSelects(bool nativeMaskedStore);
+std::unique_ptr<OperationPass<ModuleOp>> createInsertPrefetches();
+std::unique_ptr<OperationPass<ModuleOp>>
+createInsertPrefetches(unsigned distance);
+std::unique_ptr<OperationPass<ModuleOp>> createPipelineLoads();
+std::unique_ptr<OperationPass<ModuleOp>>
+createPipelineLoads(unsigned numStages, unsigned maxStageBytes);
+std::unique_ptr<OperationPass<ModuleOp>> createPackDotOperands();
+std::unique_ptr<OperationPass<ModuleOp>> createAllocateScratchArena();
+std::unique_ptr<OperationPass<ModuleOp>>
+createAllocateScratchArena(int64_t minSize);
+std::unique_ptr<OperationPass<ModuleOp>> createConvertToBulkMemoryOps();
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertToBulkMemoryOps(int64_t minSize);
+std::unique_ptr<OperationPass<ModuleOp>> createBackoffSpinLoops();
 
 std::unique_ptr<OperationPass<ModuleOp>> createConvertDotProduct();
 std::unique_ptr<OperationPass<ModuleOp>>
@@ -40,8 +74,20 @@ createConvertDotProduct(bool useHorizontalSum);
 
 std::unique_ptr<OperationPass<ModuleOp>> createConvertDotToAMX();
 std::unique_ptr<OperationPass<ModuleOp>>
-createConvertDotToAMX(bool convertInt8, bool convertFp16, bool convertBf16);
+createConvertDotToAMX(bool convertInt8, bool convertFp16, bool convertBf16,
+                      bool convertFp8, int64_t accBlockM, int64_t accBlockN);
 std::unique_ptr<OperationPass<ModuleOp>> createConvertDotToFMA();
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertDotToFMA(unsigned vectorBits, unsigned numVecRegs,
+                      int64_t blockM, int64_t blockN);
+std::unique_ptr<OperationPass<ModuleOp>> createConvertDotToMMLA();
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertDotToMMLA(bool convertInt8, bool convertInt8Sdot,
+                       bool convertBf16);
+std::unique_ptr<OperationPass<ModuleOp>> createConvertDotToVNNI();
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertDotToVNNI(bool useAvx512);
+std::unique_ptr<OperationPass<ModuleOp>> createSplitBatchedDots();
 std::unique_ptr<OperationPass<ModuleOp>> createConvertDotGeneric();
 std::unique_ptr<OperationPass<ModuleOp>> createCanonicalize();
 
@@ -2,6 +2,8 @@
 #define TRITONTOTRITONCPU_CONVERSION_PASSES_H
 
 #include "mlir/Conversion/LLVMCommon/TypeConverter.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/IR/Matchers.h"
 #include "mlir/IR/Types.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/DialectConversion.h"
@@ -26,10 +28,26 @@ std::unique_ptr<OperationPass<ModuleOp>> createConvertElemManipOps();
 std::unique_ptr<OperationPass<ModuleOp>> createConvertMemoryOps();
 std::unique_ptr<OperationPass<ModuleOp>>
 createConvertMemoryOps(bool useGatherScatter);
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertMemoryOps(bool useGatherScatter, unsigned vectorBytes,
+                       bool nativeGather, bool nativeScatter,
+                       bool nativeMaskedStore);
 std::unique_ptr<OperationPass<ModuleOp>> createConvertPtrOps();
+std::unique_ptr<OperationPass<ModuleOp>> createCarryPtrOffsets();
+std::unique_ptr<OperationPass<ModuleOp>> createNarrowOffsets();
 std::unique_ptr<OperationPass<ModuleOp>> createConvertDotOp();
+std::unique_ptr<OperationPass<ModuleOp>> createDecomposeScaledDot();
+std::unique_ptr<OperationPass<ModuleOp>> createSplitK();
+std::unique_ptr<OperationPass<ModuleOp>> createMatchGemmKernels();
+std::unique_ptr<OperationPass<ModuleOp>> createDeferScalarAtomics();
+std::unique_ptr<OperationPass<ModuleOp>>
+createDeferScalarAtomics(bool perProgram);
+std::unique_ptr<OperationPass<ModuleOp>> createSkipEmptyDots();
+std::unique_ptr<OperationPass<ModuleOp>> createForwardStores();
+std::unique_ptr<OperationPass<ModuleOp>> createForwardStores(bool noalias);
 std::unique_ptr<OperationPass<ModuleOp>> createConvertControlFlowOps();
 std::unique_ptr<OperationPass<ModuleOp>> createConvertHistogramOp();
+std::unique_ptr<OperationPass<ModuleOp>> createConvertGatherOp();
 std::unique_ptr<OperationPass<ModuleOp>> createConvertReductionOp();
 std::unique_ptr<OperationPass<ModuleOp>>
 createConvertReductionOp(bool useReductionOp, bool useMultiDimReductionOp);
@@ -40,6 +58,9 @@ std::unique_ptr<OperationPass<ModuleOp>> createConvertDebugOps();
 std::unique_ptr<OperationPass<ModuleOp>> createScalarizeUsingForOpPass();
 std::unique_ptr<OperationPass<ModuleOp>>
 createScalarizeUsingForOpPass(bool skipGatherScatter);
+std::unique_ptr<OperationPass<ModuleOp>>
+createScalarizeUsingForOpPass(bool skipGatherScatter, unsigned vectorBytes,
+                              bool nativeGather, bool nativeScatter);
 
 #define GEN_PASS_REGISTRATION
 #include "cpu/include/TritonToTritonCPU/Passes.h.inc"
@@ -120,6 +141,105 @@ std::tuple<Value, Value> getMemoryBaseOffset(OpTy op) {
   return std::make_tuple(basePtr, offset);
 }
 
+// Get the constant distance in elements between consecutive values of rows
+// of an integer or pointer tensor built of row-constant and contiguous values
+// by additions and multiplications by constants.
+inline std::optional<int64_t>
+getConstantValueStride(ModuleAxisInfoAnalysis &axisAnalysis, Value val,
+                       int64_t rowSize) {
+  auto info = axisAnalysis.getAxisInfo(val);
+  if (info && info->getConstancy().back() == rowSize)
+    return 0;
+  if (info && info->getContiguity().back() == rowSize)
+    return 1;
+
+  auto getSumStride = [&](Value lhs, Value rhs) -> std::optional<int64_t> {
+    auto lhsStride = getConstantValueStride(axisAnalysis, lhs, rowSize);
+    auto rhsStride = getConstantValueStride(axisAnalysis, rhs, rowSize);
+    if (!lhsStride || !rhsStride)
+      return std::nullopt;
+    return *lhsStride + *rhsStride;
+  };
+
+  Operation *def = val.getDefiningOp();
+  if (auto broadcastOp = dyn_cast_or_null<triton::BroadcastOp>(def)) {
+    auto srcTy = cast<RankedTensorType>(broadcastOp.getSrc().getType());
+    if (srcTy.getShape().back() != rowSize)
+      return std::nullopt;
+    return getConstantValueStride(axisAnalysis, broadcastOp.getSrc(), rowSize);
+  }
+  if (auto addPtrOp = dyn_cast_or_null<triton::AddPtrOp>(def))
+    return getSumStride(addPtrOp.getPtr(), addPtrOp.getOffset());
+  if (auto addOp = dyn_cast_or_null<arith::AddIOp>(def))
+    return getSumStride(addOp.getLhs(), addOp.getRhs());
+  if (auto mulOp = dyn_cast_or_null<arith::MulIOp>(def)) {
+    for (auto [vals, scale] :
+         {std::make_pair(mulOp.getLhs(), mulOp.getRhs()),
+          std::make_pair(mulOp.getRhs(), mulOp.getLhs())}) {
+      APInt scaleVal;
+      if (!matchPattern(scale, m_ConstantInt(&scaleVal)))
+        continue;
+      if (auto stride = getConstantValueStride(axisAnalysis, vals, rowSize))
+        return *stride * scaleVal.getSExtValue();
+      return std::nullopt;
+    }
+  }
+  return std::nullopt;
+}
+
+// Get the constant distance in elements between consecutive pointers of rows
+// of a pointer tensor if it is greater than one, e.g. for accesses to
+// interleaved complex numbers or RGB pixels.
+inline std::optional<int64_t>
+getConstantRowStride(ModuleAxisInfoAnalysis &axisAnalysis, Value ptr) {
+  auto tensorTy = dyn_cast<RankedTensorType>(ptr.getType());
+  if (!tensorTy || tensorTy.getShape().back() <= 1)
+    return std::nullopt;
+  auto stride =
+      getConstantValueStride(axisAnalysis, ptr, tensorTy.getShape().back());
+  if (!stride || *stride <= 1)
+    return std::nullopt;
+  return stride;
+}
+
+// Get the number of trailing dimensions a tensor has the same value along.
+inline int64_t getNumUniformDims(ModuleAxisInfoAnalysis &axisAnalysis,
+                                 Value vals) {
+  auto shape = cast<RankedTensorType>(vals.getType()).getShape();
+  int64_t rank = shape.size();
+  SplatElementsAttr splatAttr;
+  if (vals.getDefiningOp<triton::SplatOp>() ||
+      matchPattern(vals, m_Constant(&splatAttr)))
+    return rank;
+  auto *axisInfo = axisAnalysis.getAxisInfo(vals);
+  if (!axisInfo)
+    return 0;
+  int64_t dims = 0;
+  while (dims < rank &&
+         axisInfo->getConstancy(rank - dims - 1) >= shape[rank - dims - 1])
+    ++dims;
+  return dims;
+}
+
+// Get the number of trailing dimensions the pointers, the mask and the other
+// value of a load by a tensor of pointers are all uniform along, which memory
+// ops conversion loads with a scalar load per row, or zero if rows of such
+// dimensions have a single element.
+inline int64_t getUniformLoadDims(ModuleAxisInfoAnalysis &axisAnalysis,
+                                  triton::LoadOp loadOp) {
+  auto tensorTy = dyn_cast<RankedTensorType>(loadOp.getType());
+  if (!tensorTy || loadOp.getIsVolatile() ||
+      triton::isTensorPointerType(loadOp.getPtr().getType()))
+    return 0;
+  int64_t dims = getNumUniformDims(axisAnalysis, loadOp.getPtr());
+  for (Value val : {Value(loadOp.getMask()), Value(loadOp.getOther())})
+    if (val)
+      dims = std::min(dims, getNumUniformDims(axisAnalysis, val));
+  if (ShapedType::getNumElements(tensorTy.getShape().take_back(dims)) == 1)
+    return 0;
+  return dims;
+}
+
 } // namespace cpu
 } // namespace triton
 
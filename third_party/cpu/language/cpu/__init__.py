@@ -1,3 +1,11 @@
-from .utils import vnni_decode
+from .device import get_device_properties
+from .extern import vector_abi_name, vector_extern_elementwise
+from .fusion import fuse_elementwise
+from .scan import exclusive_block_prefix, scan_block_id
+from .sort import sort, topk
+from .utils import load_prepacked, prepack, vnni_decode, vnni_encode
 
-__all__ = ["vnni_decode"]
+__all__ = [
+    "exclusive_block_prefix", "fuse_elementwise", "get_device_properties", "load_prepacked", "prepack", "scan_block_id",
+    "sort", "topk", "vector_abi_name", "vector_extern_elementwise", "vnni_decode", "vnni_encode"
+]
@@ -0,0 +1,16 @@
+import functools
+
+
+@functools.lru_cache()
+def get_device_properties():
+    """Return properties of the host CPU, e.g. cache sizes, the number of cores and the SIMD width.
+
+    The result is the same as triton.runtime.driver.active.utils.get_device_properties() with the CPU
+    driver active, see CPUUtils.get_device_properties. It is meant for heuristics picking meta-parameters
+    on the host, e.g. in autotuner prune functions:
+
+        props = get_device_properties()
+        BLOCK_SIZE = props["l1_cache_size"] // (2 * x.element_size())
+    """
+    from triton.backends.cpu.driver import CPUUtils
+    return CPUUtils().get_device_properties()
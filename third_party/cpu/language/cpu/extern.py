@@ -0,0 +1,32 @@
+from triton.language import core
+
+
+def vector_abi_name(name: str, isa: str, numel: int, num_args: int = 1) -> str:
+    """Return the name of a vector variant of name in the vector function ABI of glibc and Sleef.
+
+    isa is 'b' (SSE), 'c' (AVX), 'd' (AVX2) or 'e' (AVX512) on x86 and 'n' (NEON) on AArch64, e.g.
+    vector_abi_name("sinf", "d", 8) is "_ZGVdN8v_sinf".
+    """
+    return f"_ZGV{isa}N{numel}{'v' * num_args}_{name}"
+
+
+@core.builtin
+def vector_extern_elementwise(args: list, arg_type_symbol_dict: dict, is_pure: bool = True, _builder=None):
+    """Dispatch an elementwise function with vector variants, like tl.extern_elementwise.
+
+    arg_type_symbol_dict maps argument types to tuples of the scalar function, a dict of its vector
+    variants by their numbers of elements and the return type. Tensors are processed in chunks of
+    the widest variant fitting into native vectors instead of calling the scalar function per
+    element, e.g. for a function compiled with `#pragma omp declare simd`:
+
+        @core.extern
+        def my_fn(x, _builder=None):
+            variants = {n: tl.extra.cpu.vector_abi_name("my_fn", isa, n) for isa, n in (("b", 4), ("d", 8))}
+            return tl.extra.cpu.vector_extern_elementwise([x], {(core.float32, ): ("my_fn", variants, core.float32)},
+                                                          _builder=_builder)
+    """
+    symbol_dict = {}
+    for arg_types, (symbol, variants, ret_type) in arg_type_symbol_dict.items():
+        names = [symbol] + [f"{numel}:{name}" for numel, name in sorted(variants.items())]
+        symbol_dict[arg_types] = ("|".join(names), ret_type)
+    return core.extern_elementwise("", "", args, symbol_dict, is_pure, _builder=_builder)
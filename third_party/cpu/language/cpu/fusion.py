@@ -0,0 +1,60 @@
+import functools
+import itertools
+import linecache
+
+import triton.language as tl
+from triton import jit
+from triton.runtime.jit import JITFunction
+
+_fused_ids = itertools.count()
+
+
+def fuse_elementwise(*stages):
+    """Return a kernel running elementwise kernels launched with the same grid one after another in each program.
+
+    Each stage is a kernel, or a pair of a kernel and a dict renaming its parameters to parameters of the fused
+    kernel, which takes the union of the renamed parameters in the order they first appear. Parameters that aren't
+    renamed keep their names. Kernels are inlined into the fused one, so intermediates that a stage stores and a
+    later stage loads with the same offsets and mask are kept in registers instead of being read back:
+
+        fused = fuse_elementwise((add_kernel, dict(out_ptr="tmp_ptr")), (gelu_kernel, dict(x_ptr="tmp_ptr")))
+        fused[grid](x, y, tmp, out, n, BLOCK_SIZE=1024)
+
+    Stores of intermediates are kept, unless an intermediate is bound to the parameter of the final output, e.g.
+    out_ptr above, so the final store overwrites it. Stores followed by loads of other inputs are only dropped with
+    noalias=True, which lets the compiler assume that the loads don't read the stored memory. Fused kernels are
+    cached by their stages and bindings.
+    """
+    key = []
+    for stage in stages:
+        kernel, binding = stage if isinstance(stage, tuple) else (stage, {})
+        if not isinstance(kernel, JITFunction):
+            raise TypeError(f"Expected a @triton.jit kernel, got {kernel!r}")
+        key.append((kernel, tuple(sorted(binding.items()))))
+    return _fuse(tuple(key))
+
+
+@functools.lru_cache()
+def _fuse(stages):
+    params = {}
+    scope = {"tl": tl, "__name__": __name__}
+    calls = []
+    for i, (kernel, binding) in enumerate(stages):
+        binding = dict(binding)
+        args = []
+        for param in kernel.params:
+            name = binding.get(param.name, param.name)
+            if params.setdefault(name, param.is_constexpr) != param.is_constexpr:
+                raise ValueError(f"Parameter {name} is bound to both constexpr and runtime parameters")
+            args.append(name)
+        scope[f"_stage{i}"] = kernel
+        calls.append(f"    _stage{i}({', '.join(args)})\n")
+
+    name = "fused_" + "_".join(kernel.__name__ for kernel, _ in stages)
+    signature = ", ".join(f"{p}: tl.constexpr" if constexpr else p for p, constexpr in params.items())
+    src = f"def {name}({signature}):\n" + "".join(calls)
+    # JITFunction reads the source through inspect, which finds it in linecache.
+    filename = f"<triton-cpu-fused-{next(_fused_ids)}>"
+    linecache.cache[filename] = (len(src), None, src.splitlines(True), filename)
+    exec(compile(src, filename, "exec"), scope)
+    return jit(scope[name])
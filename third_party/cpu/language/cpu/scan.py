@@ -0,0 +1,67 @@
+from triton import jit
+import triton.language as tl
+
+# Flags of block states in the upper half of status words, the lower half holds the value.
+_AGGREGATE = tl.constexpr(1)
+_PREFIX = tl.constexpr(2)
+
+
+@jit
+def _pack_status(flag, value):
+    bits = value.to(tl.int32, bitcast=True).to(tl.uint32, bitcast=True).to(tl.int64)
+    return bits | (tl.cast(flag, tl.int64) << 32)
+
+
+@jit
+def scan_block_id(status_ptr):
+    """Return the id of the block the program computes in a single-pass scan, see exclusive_block_prefix.
+
+    Ids are tickets of a counter in the first word of the status array, so blocks are numbered in the order programs
+    start. Each block then only waits for blocks of programs that started before it and run on other threads, while
+    program ids of blocks before it may be queued behind it on the same thread.
+    """
+    return tl.atomic_add(status_ptr, 1, sem="relaxed").to(tl.int32)
+
+
+@jit
+def exclusive_block_prefix(status_ptr, block_id, aggregate):
+    """Return the sum of aggregates of blocks before block_id in a single-pass scan.
+
+    Each program takes the id of its block from scan_block_id and publishes the aggregate of the
+    block, e.g. tl.sum of its part of the input, to an int64 status word of a zero-initialized
+    array with a ticket counter followed by a word per block. It then looks back at preceding
+    blocks until it finds one with a published inclusive prefix (decoupled look-back). The
+    inclusive prefix of the block is then published for blocks after it. This lets a single
+    kernel compute prefix sums across programs, e.g. cumsum of a large tensor:
+
+        block_id = tl.extra.cpu.scan_block_id(status_ptr)
+        offs = block_id * BLOCK + tl.arange(0, BLOCK)
+        x = tl.load(x_ptr + offs)
+        prefix = tl.extra.cpu.exclusive_block_prefix(status_ptr, block_id, tl.sum(x))
+        tl.store(out_ptr + offs, tl.cumsum(x) + prefix)
+
+    Aggregates must be 32-bit scalars. Programs spin while a preceding block hasn't published
+    its aggregate, which is why block ids must come from scan_block_id: blocks before a block
+    are then computed by programs that already run, regardless of the schedule.
+    """
+    tl.static_assert(aggregate.dtype.primitive_bitwidth == 32, "Expected a 32-bit aggregate")
+    # Status words of blocks follow the ticket counter.
+    status_ptr += 1
+    is_first = block_id == 0
+    flag = tl.where(is_first, _PREFIX, _AGGREGATE)
+    tl.atomic_xchg(status_ptr + block_id, _pack_status(flag, aggregate), sem="release")
+
+    prefix = tl.full((), 0, aggregate.dtype)
+    done = is_first
+    idx = block_id - 1
+    while not done:
+        status = tl.atomic_add(status_ptr + idx, 0, sem="acquire")
+        status_flag = (status >> 32).to(tl.int32)
+        value = status.to(tl.int32).to(aggregate.dtype, bitcast=True)
+        prefix += tl.where(status_flag != 0, value, 0)
+        done = status_flag == _PREFIX
+        idx -= tl.where(status_flag == _AGGREGATE, 1, 0)
+
+    if not is_first:
+        tl.atomic_xchg(status_ptr + block_id, _pack_status(_PREFIX, prefix + aggregate), sem="release")
+    return prefix
@@ -0,0 +1,72 @@
+from triton import jit
+import triton.language as tl
+from triton.language.standard import _log2
+
+# Bitonic networks of tl.sort select the halves of compare-and-swap pairs by multiplying with masks
+# and summing, which turns into multiplies and reductions on CPU. The networks below split pairs
+# with permutes, so each step is a compare and a blend of whole vectors.
+
+
+@jit
+def _compare_and_swap(x, order: tl.constexpr, stage: tl.constexpr, i: tl.constexpr, n_dims: tl.constexpr):
+    # Pairs are 2**(n_dims - i - 1) elements apart along the last dimension.
+    outer: tl.constexpr = (x.numel >> n_dims) * 2**i
+    inner: tl.constexpr = 2**(n_dims - i - 1)
+    left, right = tl.split(tl.permute(tl.reshape(x, [outer, 2, inner]), (0, 2, 1)))
+    if order == 2:
+        # Sequences of 2**stage elements are sorted in alternating orders.
+        flip = ((tl.arange(0, outer)[:, None] >> (stage - n_dims + i)) & 1) != 0
+        swap = (left > right) != flip
+    elif order == 1:
+        swap = right > left
+    else:
+        swap = left > right
+    new_left = tl.where(swap, right, left)
+    new_right = tl.where(swap, left, right)
+    return tl.reshape(tl.permute(tl.join(new_left, new_right), (0, 2, 1)), x.shape)
+
+
+@jit
+def _bitonic_merge(x, stage: tl.constexpr, order: tl.constexpr, n_dims: tl.constexpr):
+    # Order 0 is ascending, 1 is descending and 2 is alternating.
+    for i in tl.static_range(stage):
+        x = _compare_and_swap(x, order, stage, i + (n_dims - stage), n_dims)
+    return x
+
+
+@jit
+def sort(x, descending: tl.constexpr = False):
+    """Sort a tensor along its last dimension, like tl.sort, with compare-and-blend steps."""
+    n_dims: tl.constexpr = _log2(x.shape[len(x.shape) - 1])
+    for stage in tl.static_range(1, n_dims + 1):
+        x = _bitonic_merge(x, stage, 2 if stage < n_dims else (1 if descending else 0), n_dims)
+    return x
+
+
+@jit
+def topk(x, k: tl.constexpr):
+    """Return the k largest values along the last dimension of a 2D tensor in descending order.
+
+    Rows are sorted in chunks of k elements of alternating orders. Pairs of chunks are then merged
+    by taking their elementwise maximum, which holds the k largest values of both chunks as a
+    bitonic sequence, and sorting it with a single bitonic merge. Each of the log(n / k) rounds
+    halves the row, so the work is O(n log(k)^2) instead of O(n log(n)^2) of a full sort, e.g. for
+    top-k sampling over large vocabularies:
+
+        logits = tl.load(logits_ptr + offs)  # [BLOCK_M, VOCAB]
+        top = tl.extra.cpu.topk(logits, 64)  # [BLOCK_M, 64]
+    """
+    tl.static_assert(len(x.shape) == 2, "Expected a 2D tensor")
+    rows: tl.constexpr = x.shape[0]
+    n: tl.constexpr = x.shape[1]
+    n_dims: tl.constexpr = _log2(n)
+    k_dims: tl.constexpr = _log2(k)
+    tl.static_assert(k <= n, "Expected k not to exceed the size of the last dimension")
+    for stage in tl.static_range(1, k_dims + 1):
+        x = _bitonic_merge(x, stage, 2 if (stage < k_dims or k < n) else 1, n_dims)
+    for r in tl.static_range(n_dims - k_dims):
+        # Chunks 2j are ascending and chunks 2j + 1 descending.
+        lo, hi = tl.split(tl.permute(tl.reshape(x, [rows * (n >> (r + k_dims + 1)), 2, k]), (0, 2, 1)))
+        x = tl.reshape(tl.where(lo > hi, lo, hi), [rows, n >> (r + 1)])
+        x = _bitonic_merge(x, k_dims, 2 if r + 1 < n_dims - k_dims else 1, n_dims - r - 1)
+    return x
@@ -20,3 +20,114 @@ def vnni_decode(arg0, _builder=None, _generator=None):
     if bitwidth == 8:
         decoded = _generator.call_JitFunction(_vnni_decode, (decoded, ), kwargs={})
     return decoded
+
+
+# Packed copies of tensors by vnni_encode and prepack, with the version of the tensor they were made from
+# and the packing parameters. Tensors are keyed by identity, see _get_vnni_cache.
+_vnni_cache = None
+
+
+def _get_vnni_cache():
+    global _vnni_cache
+    if _vnni_cache is None:
+        # Tensors compare elementwise, so weakref.WeakKeyDictionary can't look them up.
+        from torch.utils.weak import WeakTensorKeyDictionary
+        _vnni_cache = WeakTensorKeyDictionary()
+    return _vnni_cache
+
+
+def _cached_pack(tensor, params, pack, cache):
+    if cache and (cached := _get_vnni_cache().get(tensor)) is not None and cached[:2] == (tensor._version, params):
+        return cached[2]
+    packed = pack()
+    if cache:
+        _get_vnni_cache()[tensor] = (tensor._version, params, packed)
+    return packed
+
+
+def _check_vnni_encodable(tensor, rows_multiple, fn):
+    if tensor.dim() != 2 or tensor.element_size() != 2:
+        # vnni_decode of 8-bit values is two 16-bit decodes, which isn't the inverse of the
+        # VNNI layout AMX uses for them.
+        raise ValueError(f"Expected a 2D tensor of 16-bit values for {fn}")
+    if tensor.shape[0] % rows_multiple:
+        raise ValueError(f"Expected a multiple of {rows_multiple} rows for {fn}, got {tensor.shape[0]}")
+
+
+def vnni_encode(tensor, cache=True):
+    """Return a copy of a [K, N] tensor of 16-bit values in the VNNI layout [K // 2, N * 2].
+
+    Pairs of subsequent rows are interleaved, so that vnni_decode of a loaded block of the result
+    gives back the original block, and AMX tile loads read the block directly without repacking
+    it in every program. This is meant for operands reused by many launches, e.g. static weights
+    of inference GEMMs:
+
+        w_packed = vnni_encode(w)
+        ...
+        b = tl.extra.cpu.vnni_decode(tl.load(w_block_ptr))
+        acc = tl.dot(a, b, acc)
+
+    With cache set, the copy is kept until the tensor is released or modified in place, so
+    repeated calls pack it once.
+    """
+    _check_vnni_encodable(tensor, 2, "vnni_encode")
+    rows, cols = tensor.shape
+    return _cached_pack(
+        tensor, None,
+        lambda: tensor.reshape(rows // 2, 2, cols).transpose(1, 2).reshape(rows // 2, cols * 2).contiguous(), cache)
+
+
+def prepack(tensor, block_k, block_n, vnni=None, cache=True):
+    """Return a copy of a [K, N] weight tensor split into contiguous [block_k, block_n] blocks.
+
+    The result has the shape [K // block_k, N // block_n, block_k // p, block_n * p], where blocks
+    follow each other along N, and p is 2 for blocks in the VNNI layout of vnni_encode and 1
+    otherwise. Each block then fits a few pages and is read by rows of block_n * p elements, and
+    with VNNI blocks, AMX and oneDNN ukernel lowerings of dots take them as is instead of
+    transforming B in every program. vnni defaults to True for 16-bit values. Blocks are loaded in
+    kernels with load_prepacked:
+
+        w_packed = prepack(w, BLOCK_K, BLOCK_N)
+        ...
+        b = tl.extra.cpu.load_prepacked(w_ptr, k, pid_n, N // BLOCK_N, BLOCK_K, BLOCK_N, VNNI=True)
+        acc = tl.dot(a, b, acc)
+
+    With cache set, the copy is kept until the tensor is released or modified in place, so
+    repeated calls pack it once.
+    """
+    if vnni is None:
+        vnni = tensor.dim() == 2 and tensor.element_size() == 2
+    if vnni:
+        _check_vnni_encodable(tensor, 2, "prepack")
+    elif tensor.dim() != 2:
+        raise ValueError("Expected a 2D tensor for prepack")
+    rows, cols = tensor.shape
+    if rows % block_k or cols % block_n or (vnni and block_k % 2):
+        raise ValueError(f"Expected a [{rows}, {cols}] tensor to be split into whole "
+                         f"{'even ' if vnni else ''}[{block_k}, {block_n}] blocks")
+
+    def pack():
+        pack_num = 2 if vnni else 1
+        blocks = tensor.reshape(rows // block_k, block_k // pack_num, pack_num, cols // block_n, block_n)
+        blocks = blocks.permute(0, 3, 1, 4, 2)
+        return blocks.reshape(rows // block_k, cols // block_n, block_k // pack_num, block_n * pack_num).contiguous()
+
+    return _cached_pack(tensor, (block_k, block_n, vnni), pack, cache)
+
+
+@jit
+def load_prepacked(ptr, block_k, block_n, num_blocks_n, BLOCK_K: tl.constexpr, BLOCK_N: tl.constexpr,
+                   VNNI: tl.constexpr):
+    """Load the [BLOCK_K, BLOCK_N] block at (block_k, block_n) of a weight packed by prepack.
+
+    A VNNI block is decoded right after the load, so dot lowerings find the packed block in memory
+    and skip the transformation of B.
+    """
+    PACK_NUM: tl.constexpr = 2 if VNNI else 1
+    base = ptr + (block_k * num_blocks_n + block_n) * (BLOCK_K * BLOCK_N)
+    block_ptr = tl.make_block_ptr(base, (BLOCK_K // PACK_NUM, BLOCK_N * PACK_NUM), (BLOCK_N * PACK_NUM, 1), (0, 0),
+                                  (BLOCK_K // PACK_NUM, BLOCK_N * PACK_NUM), (1, 0))
+    block = tl.load(block_ptr)
+    if VNNI:
+        block = vnni_decode(block)
+    return block
@@ -0,0 +1,298 @@
+#include "cpu/include/Analysis/KernelCost.h"
+
+#include "mlir/Dialect/AMX/AMXDialect.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/Math/IR/Math.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/Interfaces/ViewLikeInterface.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+
+namespace mlir::triton::cpu {
+
+namespace {
+
+int64_t getNumElements(Type type) {
+  if (auto shapedTy = dyn_cast<ShapedType>(type))
+    return shapedTy.hasStaticShape() ? shapedTy.getNumElements() : 1;
+  return 1;
+}
+
+int64_t getElementBytes(Type type) {
+  Type elemTy = getElementTypeOrSelf(type);
+  if (elemTy.isIntOrFloat())
+    return std::max<int64_t>(elemTy.getIntOrFloatBitWidth() / 8, 1);
+  // Pointers and indices.
+  return 8;
+}
+
+int64_t getBytes(Type type) {
+  return getNumElements(type) * getElementBytes(type);
+}
+
+bool isFloat(Type type) { return isa<FloatType>(getElementTypeOrSelf(type)); }
+
+// Return true if the memref doesn't come from a buffer allocated by the
+// kernel, e.g. a temporary buffer of dot operands.
+bool isGlobalMemory(Value memref) {
+  while (Operation *defOp = memref.getDefiningOp()) {
+    if (isa<memref::AllocOp, memref::AllocaOp>(defOp))
+      return false;
+    if (auto viewOp = dyn_cast<ViewLikeOpInterface>(defOp)) {
+      memref = viewOp.getViewSource();
+      continue;
+    }
+    if (auto castOp = dyn_cast<memref::CastOp>(defOp)) {
+      memref = castOp.getSource();
+      continue;
+    }
+    break;
+  }
+  return true;
+}
+
+std::optional<int64_t> getConstant(Value value) {
+  return getConstantIntValue(getAsOpFoldResult(value));
+}
+
+// Return the number of operations of dot-like ops.
+std::optional<double> getDotFlops(Operation *op) {
+  if (auto contractOp = dyn_cast<vector::ContractionOp>(op)) {
+    SmallVector<int64_t> bounds;
+    contractOp.getIterationBounds(bounds);
+    double res = 2;
+    for (int64_t bound : bounds)
+      res *= bound;
+    return res;
+  }
+  if (auto dotOp = dyn_cast<triton::cpu::DotOp>(op)) {
+    auto aTy = cast<VectorType>(dotOp.getA().getType());
+    return 2.0 * getNumElements(dotOp.getD().getType()) * aTy.getShape().back();
+  }
+  if (isa<vector::FMAOp, math::FmaOp>(op))
+    return 2.0 * getNumElements(op->getResult(0).getType());
+  if (auto outerOp = dyn_cast<vector::OuterProductOp>(op))
+    return 2.0 * getNumElements(outerOp.getResult().getType());
+  if (isa<amx::TileMulFOp, amx::TileMulIOp>(op)) {
+    // An MxK by KxN tile product, K of the lhs tile is measured in elements
+    // of the lhs type.
+    auto lhsTy = cast<VectorType>(op->getOperand(0).getType());
+    return 2.0 * getNumElements(op->getResult(0).getType()) *
+           lhsTy.getShape().back();
+  }
+  if (auto intrOp = dyn_cast<LLVM::CallIntrinsicOp>(op)) {
+    // Each lane of bfdot accumulates a product of two pairs of bf16 values.
+    if (intrOp.getIntrin().contains("bfdot"))
+      return 4.0 * getNumElements(op->getResult(0).getType());
+    return 0.0;
+  }
+  return std::nullopt;
+}
+
+bool isElementwiseFloatOp(Operation *op) {
+  if (op->getNumResults() != 1 || !isFloat(op->getResult(0).getType()))
+    return false;
+  if (isa<math::MathDialect>(op->getDialect()))
+    return true;
+  return isa<arith::AddFOp, arith::SubFOp, arith::MulFOp, arith::DivFOp,
+             arith::RemFOp, arith::NegFOp, arith::MaximumFOp,
+             arith::MinimumFOp, arith::MaxNumFOp, arith::MinNumFOp>(op);
+}
+
+// Return the number of bytes of global memory accessed by memory ops.
+std::optional<double> getMemoryBytes(Operation *op) {
+  auto global = [](Value memref, Type type) -> double {
+    return isGlobalMemory(memref) ? getBytes(type) : 0.0;
+  };
+  if (auto readOp = dyn_cast<vector::TransferReadOp>(op))
+    return global(op->getOperand(0), readOp.getVectorType());
+  if (auto writeOp = dyn_cast<vector::TransferWriteOp>(op))
+    return global(op->getOperand(1), writeOp.getVectorType());
+  if (auto loadOp = dyn_cast<vector::LoadOp>(op))
+    return global(loadOp.getBase(), loadOp.getVectorType());
+  if (auto storeOp = dyn_cast<vector::StoreOp>(op))
+    return global(storeOp.getBase(), storeOp.getVectorType());
+  if (auto loadOp = dyn_cast<vector::MaskedLoadOp>(op))
+    return global(loadOp.getBase(), loadOp.getVectorType());
+  if (auto storeOp = dyn_cast<vector::MaskedStoreOp>(op))
+    return global(storeOp.getBase(), storeOp.getVectorType());
+  if (auto gatherOp = dyn_cast<vector::GatherOp>(op))
+    return global(gatherOp.getBase(), gatherOp.getVectorType());
+  if (auto scatterOp = dyn_cast<vector::ScatterOp>(op))
+    return global(scatterOp.getBase(), scatterOp.getVectorType());
+  if (auto loadOp = dyn_cast<memref::LoadOp>(op))
+    return global(loadOp.getMemRef(), loadOp.getResult().getType());
+  if (auto storeOp = dyn_cast<memref::StoreOp>(op))
+    return global(storeOp.getMemRef(), storeOp.getValueToStore().getType());
+  if (auto loadOp = dyn_cast<triton::cpu::LoadOp>(op))
+    return global(loadOp.getSrc(), loadOp.getResult().getType());
+  if (auto storeOp = dyn_cast<triton::cpu::StoreOp>(op))
+    return global(storeOp.getDst(), storeOp.getSrc().getType());
+  if (auto loadOp = dyn_cast<triton::LoadOp>(op))
+    return static_cast<double>(getBytes(loadOp.getResult().getType()));
+  if (auto storeOp = dyn_cast<triton::StoreOp>(op))
+    return static_cast<double>(getBytes(storeOp.getValue().getType()));
+  if (auto copyOp = dyn_cast<triton::cpu::BulkCopyOp>(op))
+    return 2.0 * copyOp.getSize();
+  if (auto fillOp = dyn_cast<triton::cpu::BulkFillOp>(op))
+    return static_cast<double>(fillOp.getCount() *
+                               getBytes(fillOp.getValue().getType()));
+  if (isa<amx::TileLoadOp>(op))
+    return global(op->getOperand(0), op->getResult(0).getType());
+  if (isa<amx::TileStoreOp>(op))
+    return global(op->getOperand(0), op->getOperands().back().getType());
+  return std::nullopt;
+}
+
+// Return the number of bytes of global memory written by store ops.
+std::optional<int64_t> getStoreBytes(Operation *op) {
+  auto global = [](Value memref, Type type) -> int64_t {
+    return isGlobalMemory(memref) ? getBytes(type) : 0;
+  };
+  if (auto writeOp = dyn_cast<vector::TransferWriteOp>(op))
+    return global(op->getOperand(1), writeOp.getVectorType());
+  if (auto storeOp = dyn_cast<vector::StoreOp>(op))
+    return global(storeOp.getBase(), storeOp.getVectorType());
+  if (auto storeOp = dyn_cast<vector::MaskedStoreOp>(op))
+    return global(storeOp.getBase(), storeOp.getVectorType());
+  if (auto storeOp = dyn_cast<memref::StoreOp>(op))
+    return global(storeOp.getMemRef(), storeOp.getValueToStore().getType());
+  if (auto storeOp = dyn_cast<triton::cpu::StoreOp>(op))
+    return global(storeOp.getDst(), storeOp.getSrc().getType());
+  if (auto storeOp = dyn_cast<triton::StoreOp>(op))
+    return getBytes(storeOp.getValue().getType());
+  if (auto copyOp = dyn_cast<triton::cpu::BulkCopyOp>(op))
+    return copyOp.getSize();
+  if (auto fillOp = dyn_cast<triton::cpu::BulkFillOp>(op))
+    return fillOp.getCount() * getBytes(fillOp.getValue().getType());
+  return std::nullopt;
+}
+
+class KernelCostEstimator {
+public:
+  explicit KernelCostEstimator(ModuleOp mod) : mod(mod) {}
+
+  KernelCost estimateRegion(Region &region) {
+    KernelCost res;
+    for (Block &block : region)
+      for (Operation &op : block)
+        res += estimateOp(&op);
+    return res;
+  }
+
+private:
+  KernelCost estimateOp(Operation *op) {
+    KernelCost res;
+    if (auto forOp = dyn_cast<scf::ForOp>(op)) {
+      KernelCost body = estimateRegion(forOp.getRegion());
+      auto lb = getConstant(forOp.getLowerBound());
+      auto ub = getConstant(forOp.getUpperBound());
+      auto step = getConstant(forOp.getStep());
+      if (lb && ub && step && *step > 0) {
+        double tripCount = *ub > *lb ? (*ub - *lb + *step - 1) / *step : 0;
+        body.flops *= tripCount;
+        body.bytes *= tripCount;
+        if (tripCount != 1)
+          body.minStoreBytes = 0;
+      } else {
+        body.exact = false;
+        body.minStoreBytes = 0;
+      }
+      return body;
+    }
+    if (auto ifOp = dyn_cast<scf::IfOp>(op)) {
+      KernelCost thenCost = estimateRegion(ifOp.getThenRegion());
+      KernelCost elseCost = estimateRegion(ifOp.getElseRegion());
+      res = thenCost.flops + thenCost.bytes >= elseCost.flops + elseCost.bytes
+                ? thenCost
+                : elseCost;
+      res.addStore(thenCost.minStoreBytes);
+      res.addStore(elseCost.minStoreBytes);
+      res.exact = false;
+      return res;
+    }
+    if (isa<scf::WhileOp>(op))
+      res.exact = false;
+    if (auto callOp = dyn_cast<triton::CallOp>(op)) {
+      auto callee = mod.lookupSymbol<triton::FuncOp>(callOp.getCallee());
+      if (callee && visiting.insert(callee).second) {
+        res += estimateRegion(callee.getBody());
+        visiting.erase(callee);
+      }
+      return res;
+    }
+    if (auto executeOp = dyn_cast<triton::cpu::BrgemmExecute>(op))
+      return estimateBrgemm(executeOp);
+    for (Region &region : op->getRegions())
+      res += estimateRegion(region);
+
+    if (auto flops = getDotFlops(op)) {
+      res.flops += *flops;
+    } else if (auto bytes = getMemoryBytes(op)) {
+      res.bytes += *bytes;
+      if (auto storeBytes = getStoreBytes(op))
+        res.addStore(*storeBytes);
+    } else if (isElementwiseFloatOp(op)) {
+      res.flops += getNumElements(op->getResult(0).getType());
+    } else if (auto reductionOp = dyn_cast<vector::ReductionOp>(op)) {
+      if (isFloat(reductionOp.getVector().getType()))
+        res.flops += getNumElements(reductionOp.getVector().getType());
+    } else if (auto reductionOp = dyn_cast<vector::MultiDimReductionOp>(op)) {
+      if (isFloat(reductionOp.getSource().getType()))
+        res.flops += getNumElements(reductionOp.getSource().getType());
+    }
+    return res;
+  }
+
+  // Ukernel calls run numBatches MxKxN products with sizes given on the
+  // creation of the ukernel.
+  KernelCost estimateBrgemm(triton::cpu::BrgemmExecute executeOp) {
+    KernelCost res;
+    auto createOp = executeOp.getBrgemmKernelHash()
+                        .getDefiningOp<triton::cpu::BrgemmCreate>();
+    if (!createOp) {
+      res.exact = false;
+      return res;
+    }
+    auto m = getConstant(createOp.getM());
+    auto n = getConstant(createOp.getN());
+    auto k = getConstant(createOp.getKK());
+    auto batches = getConstant(executeOp.getNumBatches());
+    if (!m || !n || !k || !batches) {
+      res.exact = false;
+      return res;
+    }
+    double mk = static_cast<double>(*m) * *k * *batches;
+    double kn = static_cast<double>(*k) * *n * *batches;
+    double mn = static_cast<double>(*m) * *n;
+    res.flops = 2.0 * mn * *k * *batches;
+    if (isGlobalMemory(executeOp.getAPtr()))
+      res.bytes += mk * getElementBytes(createOp.getDtypeA());
+    if (isGlobalMemory(executeOp.getBPtr()))
+      res.bytes += kn * getElementBytes(createOp.getDtypeB());
+    if (isGlobalMemory(executeOp.getCPtr()))
+      res.bytes += mn * getElementBytes(createOp.getDtypeC());
+    return res;
+  }
+
+  ModuleOp mod;
+  llvm::SmallPtrSet<Operation *, 4> visiting;
+};
+
+} // namespace
+
+KernelCost estimateKernelCost(ModuleOp mod, StringRef kernelName) {
+  auto funcOp = mod.lookupSymbol<triton::FuncOp>(kernelName);
+  if (!funcOp)
+    return KernelCost{0, 0, false};
+  return KernelCostEstimator(mod).estimateRegion(funcOp.getBody());
+}
+
+} // namespace mlir::triton::cpu
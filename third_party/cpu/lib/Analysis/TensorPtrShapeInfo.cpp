@@ -1,5 +1,8 @@
 #include "cpu/include/Analysis/TensorPtrShapeInfo.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
 
 namespace mlir::triton::cpu {
 
@@ -25,6 +28,88 @@ TensorPtrShapeInfo TensorPtrShapeInfo::join(const TensorPtrShapeInfo &lhs,
 
 namespace {
 
+using OffsetRange = std::pair<int64_t, int64_t>;
+
+// Sign extensions and index casts keep the value of an integer, so
+// shapes, strides and offsets are looked up through them.
+Value skipIntCasts(Value val) {
+  while (Operation *def = val.getDefiningOp()) {
+    if (!isa<arith::ExtSIOp, arith::IndexCastOp>(def))
+      break;
+    val = def->getOperand(0);
+  }
+  return val;
+}
+
+std::optional<int64_t> getConstantInt(Value val) {
+  val = skipIntCasts(val);
+  if (auto cst = getConstantIntValue(val))
+    return cst;
+  // Products and sums of constants, e.g. strides of flattened dimensions
+  // that are not folded yet.
+  if (auto mulOp = val.getDefiningOp<arith::MulIOp>()) {
+    auto lhs = getConstantInt(mulOp.getLhs());
+    auto rhs = getConstantInt(mulOp.getRhs());
+    if (lhs && rhs)
+      return *lhs * *rhs;
+  } else if (auto addOp = val.getDefiningOp<arith::AddIOp>()) {
+    auto lhs = getConstantInt(addOp.getLhs());
+    auto rhs = getConstantInt(addOp.getRhs());
+    if (lhs && rhs)
+      return *lhs + *rhs;
+  }
+  return std::nullopt;
+}
+
+std::optional<int64_t> getTripCount(scf::ForOp forOp) {
+  auto lb = getConstantInt(forOp.getLowerBound());
+  auto ub = getConstantInt(forOp.getUpperBound());
+  auto step = getConstantInt(forOp.getStep());
+  if (!lb || !ub || !step || *step <= 0)
+    return std::nullopt;
+  if (*ub <= *lb)
+    return 0;
+  return (*ub - *lb + *step - 1) / *step;
+}
+
+// Range of values an integer can take, for constants and affine functions
+// of loop induction variables.
+std::optional<OffsetRange> getIntRange(Value val) {
+  if (auto cst = getConstantInt(val))
+    return OffsetRange(*cst, *cst);
+  val = skipIntCasts(val);
+  if (auto iv = dyn_cast<BlockArgument>(val)) {
+    auto forOp = dyn_cast<scf::ForOp>(iv.getOwner()->getParentOp());
+    if (!forOp || iv != forOp.getInductionVar())
+      return std::nullopt;
+    auto tripCount = getTripCount(forOp);
+    if (!tripCount || *tripCount == 0)
+      return std::nullopt;
+    int64_t lb = *getConstantInt(forOp.getLowerBound());
+    int64_t step = *getConstantInt(forOp.getStep());
+    return OffsetRange(lb, lb + (*tripCount - 1) * step);
+  }
+  if (auto addOp = val.getDefiningOp<arith::AddIOp>()) {
+    auto lhs = getIntRange(addOp.getLhs());
+    auto rhs = getIntRange(addOp.getRhs());
+    if (lhs && rhs)
+      return OffsetRange(lhs->first + rhs->first, lhs->second + rhs->second);
+  } else if (auto mulOp = val.getDefiningOp<arith::MulIOp>()) {
+    auto range = getIntRange(mulOp.getLhs());
+    auto scale = getConstantInt(mulOp.getRhs());
+    if (!scale) {
+      range = getIntRange(mulOp.getRhs());
+      scale = getConstantInt(mulOp.getLhs());
+    }
+    if (range && scale) {
+      if (*scale >= 0)
+        return OffsetRange(range->first * *scale, range->second * *scale);
+      return OffsetRange(range->second * *scale, range->first * *scale);
+    }
+  }
+  return std::nullopt;
+}
+
 template <class T>
 void initPessimisticStateFromFunc(int argNumber, T funcOp,
                                   SmallVectorImpl<int64_t> &shape,
@@ -113,15 +198,8 @@ ShapeInfoAnalysis::ShapeInfoAnalysis(DataFlowSolver &solver)
 
 SmallVector<int64_t> copyConstOrDynamic(OperandRange ops) {
   SmallVector<int64_t> res;
-  for (auto op : ops) {
-    if (auto cstOp = op.getDefiningOp<arith::ConstantOp>()) {
-      auto intAttr = dyn_cast<IntegerAttr>(cstOp.getValue());
-      assert(intAttr);
-      res.push_back(intAttr.getInt());
-    } else {
-      res.push_back(ShapedType::kDynamic);
-    }
-  }
+  for (auto op : ops)
+    res.push_back(getConstantInt(op).value_or(ShapedType::kDynamic));
   return res;
 }
 
@@ -216,4 +294,61 @@ void ModuleTensorPtrShapeInfoAnalysis::update(CallOpInterface callOp,
   }
 }
 
+std::optional<std::pair<int64_t, int64_t>>
+getTensorPtrOffsetRange(Value ptr, unsigned dim) {
+  if (auto makePtrOp = ptr.getDefiningOp<MakeTensorPtrOp>())
+    return getIntRange(makePtrOp.getOffsets()[dim]);
+
+  if (auto advOp = ptr.getDefiningOp<AdvanceOp>()) {
+    auto base = getTensorPtrOffsetRange(advOp.getPtr(), dim);
+    auto delta = getIntRange(advOp.getOffsets()[dim]);
+    if (!base || !delta)
+      return std::nullopt;
+    return OffsetRange(base->first + delta->first,
+                       base->second + delta->second);
+  }
+
+  // A loop-carried pointer advanced by a constant step on each iteration
+  // covers offsets from its initial value to the one of the last iteration.
+  auto arg = dyn_cast<BlockArgument>(ptr);
+  if (!arg)
+    return std::nullopt;
+  auto forOp = dyn_cast<scf::ForOp>(arg.getOwner()->getParentOp());
+  if (!forOp || arg == forOp.getInductionVar())
+    return std::nullopt;
+  unsigned idx = arg.getArgNumber() - forOp.getNumInductionVars();
+  Value yielded = forOp.getBody()->getTerminator()->getOperand(idx);
+  int64_t step = 0;
+  while (yielded != arg) {
+    auto advOp = yielded.getDefiningOp<AdvanceOp>();
+    if (!advOp)
+      return std::nullopt;
+    auto delta = getConstantInt(advOp.getOffsets()[dim]);
+    if (!delta)
+      return std::nullopt;
+    step += *delta;
+    yielded = advOp.getPtr();
+  }
+  auto init = getTensorPtrOffsetRange(forOp.getInitArgs()[idx], dim);
+  auto tripCount = getTripCount(forOp);
+  if (!init || !tripCount || *tripCount == 0)
+    return std::nullopt;
+  int64_t span = (*tripCount - 1) * step;
+  if (span >= 0)
+    return OffsetRange(init->first, init->second + span);
+  return OffsetRange(init->first + span, init->second);
+}
+
+bool isTensorPtrInBounds(Value ptr, const TensorPtrShapeInfo &shapeInfo,
+                         unsigned dim) {
+  if (!shapeInfo.getRank() || shapeInfo.getSize(dim) == ShapedType::kDynamic)
+    return false;
+  auto range = getTensorPtrOffsetRange(ptr, dim);
+  if (!range)
+    return false;
+  auto blockTy = cast<RankedTensorType>(getPointeeType(ptr.getType()));
+  return range->first >= 0 &&
+         range->second + blockTy.getDimSize(dim) <= shapeInfo.getSize(dim);
+}
+
 } // namespace mlir::triton::cpu
@@ -0,0 +1,68 @@
+#include "cpu/include/Analysis/UnrolledSize.h"
+
+#include "mlir/IR/TypeUtilities.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+
+namespace mlir::triton::cpu {
+
+namespace {
+
+int64_t getNumElements(Type type) {
+  if (auto shapedTy = dyn_cast<ShapedType>(type))
+    return shapedTy.hasStaticShape() ? shapedTy.getNumElements() : 1;
+  return 1;
+}
+
+int64_t getElementBits(Type type) {
+  Type elemTy = getElementTypeOrSelf(type);
+  if (elemTy.isIntOrFloat())
+    return std::max<int64_t>(elemTy.getIntOrFloatBitWidth(), 8);
+  // Pointers and indices.
+  return 64;
+}
+
+// Number of target vectors a block of the type is split into.
+int64_t getNumVectors(Type type, unsigned vectorBits) {
+  if (!isa<RankedTensorType>(type))
+    return 0;
+  int64_t bits = getNumElements(type) * getElementBits(type);
+  return std::max<int64_t>((bits + vectorBits - 1) / vectorBits, 1);
+}
+
+// Number of elements of blocks an op is unrolled into element by element.
+int64_t getNumUnrolledElements(Operation *op) {
+  if (isa<triton::AtomicRMWOp, triton::AtomicCASOp>(op))
+    return getNumElements(op->getOperand(0).getType());
+  if (auto histogramOp = dyn_cast<triton::HistogramOp>(op))
+    return getNumElements(histogramOp.getSrc().getType());
+  if (isa<triton::PrintOp>(op)) {
+    int64_t res = 0;
+    for (Value operand : op->getOperands())
+      res += getNumElements(operand.getType());
+    return res;
+  }
+  return 0;
+}
+
+} // namespace
+
+UnrolledSize estimateUnrolledSize(ModuleOp mod, unsigned vectorBits) {
+  UnrolledSize res;
+  mod.walk([&](Operation *op) {
+    if (int64_t numElements = getNumUnrolledElements(op)) {
+      res.elementOps += numElements;
+      return;
+    }
+    // Stores have no results, so blocks of operands are counted for them.
+    int64_t numVectors = 0;
+    for (Type type : op->getResultTypes())
+      numVectors = std::max(numVectors, getNumVectors(type, vectorBits));
+    for (Type type : op->getOperandTypes())
+      numVectors = std::max(numVectors, getNumVectors(type, vectorBits));
+    res.vectorOps += numVectors;
+  });
+  return res;
+}
+
+} // namespace mlir::triton::cpu
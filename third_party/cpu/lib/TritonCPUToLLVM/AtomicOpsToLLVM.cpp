@@ -116,6 +116,48 @@ struct AtomicCASOpConversion : public OpConversionPattern<AtomicCASOp> {
   }
 };
 
+// Lower triton_cpu.spin_wait to a call of triton_cpu_spin_wait, which takes
+// the expected value extended to 64 bits and its size in bytes.
+struct SpinWaitOpConversion : public OpConversionPattern<SpinWaitOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult
+  matchAndRewrite(SpinWaitOp op, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto loc = op.getLoc();
+    auto b = TritonLLVMOpBuilder(loc, rewriter);
+    Value expected = adaptor.getExpected();
+    unsigned bits = expected.getType().getIntOrFloatBitWidth();
+    if (bits < 64)
+      expected = rewriter.create<LLVM::SExtOp>(loc, i64_ty, expected);
+    b.call(getSpinWaitFuncDecl(rewriter),
+           ValueRange{adaptor.getPtr(), expected, b.i32_val(bits / 8),
+                      adaptor.getIteration()});
+    rewriter.eraseOp(op);
+    return success();
+  }
+
+  static LLVM::LLVMFuncOp
+  getSpinWaitFuncDecl(ConversionPatternRewriter &rewriter) {
+    auto moduleOp =
+        rewriter.getBlock()->getParent()->getParentOfType<ModuleOp>();
+    StringRef funcName = "triton_cpu_spin_wait";
+    Operation *funcOp = moduleOp.lookupSymbol(funcName);
+    if (funcOp)
+      return cast<LLVM::LLVMFuncOp>(*funcOp);
+
+    auto *ctx = rewriter.getContext();
+    auto funcType = LLVM::LLVMFunctionType::get(
+        void_ty(ctx), {ptr_ty(ctx), i64_ty, i32_ty, i32_ty});
+
+    ConversionPatternRewriter::InsertionGuard guard(rewriter);
+    rewriter.setInsertionPointToStart(moduleOp.getBody());
+
+    return rewriter.create<LLVM::LLVMFuncOp>(UnknownLoc::get(ctx), funcName,
+                                             funcType);
+  }
+};
+
 struct AtomicOpsToLLVM
     : public triton::impl::AtomicOpsToLLVMBase<AtomicOpsToLLVM> {
   using AtomicOpsToLLVMBase::AtomicOpsToLLVMBase;
@@ -133,6 +175,7 @@ struct AtomicOpsToLLVM
     RewritePatternSet patterns(context);
     patterns.add<AtomicRMWOpConversion>(typeConverter, context);
     patterns.add<AtomicCASOpConversion>(typeConverter, context);
+    patterns.add<SpinWaitOpConversion>(typeConverter, context);
 
     if (failed(applyPartialConversion(mod, convTarget, std::move(patterns))))
       return signalPassFailure();
@@ -89,24 +89,31 @@ Value printfPromoteValue(RewriterBase &rewriter, Value value) {
   return value;
 }
 
-LLVM::LLVMFuncOp getOrAddPrintFuncDecl(ConversionPatternRewriter &rewriter,
-                                       bool printf) {
+// Keep in sync with PrintValueKind in cpu_runtime.cpp.
+enum class PrintValueKind : int32_t {
+  None = 0,
+  Int32 = 1,
+  Int64 = 2,
+  Double = 3,
+  Pointer = 4,
+};
+
+LLVM::LLVMFuncOp
+getOrAddPrintScalarFuncDecl(ConversionPatternRewriter &rewriter) {
   auto moduleOp = rewriter.getBlock()->getParent()->getParentOfType<ModuleOp>();
-  StringRef funcName = printf ? "printf" : "triton_vector_print";
+  StringRef funcName = "triton_print_scalar";
   Operation *funcOp = moduleOp.lookupSymbol(funcName);
   if (funcOp)
     return cast<LLVM::LLVMFuncOp>(*funcOp);
 
   auto *ctx = rewriter.getContext();
-  SmallVector<Type> argsType;
-  if (printf)
-    argsType = {ptr_ty(ctx)};
-  else
-    argsType = {i32_ty, i32_ty, i32_ty, ptr_ty(ctx), ptr_ty(ctx),
-                i32_ty, i32_ty, i32_ty, i64_ty,      i32_ty};
-
-  auto funcType =
-      LLVM::LLVMFunctionType::get(i32_ty, argsType, /*isVarArg*/ printf);
+  SmallVector<Type> argsType{/*pid serialization*/ i32_ty,
+                             i32_ty,
+                             i32_ty, /*end pids*/
+                             ptr_ty(ctx),
+                             /*value and its kind*/ i64_ty,
+                             i32_ty};
+  auto funcType = LLVM::LLVMFunctionType::get(void_ty(ctx), argsType);
 
   ConversionPatternRewriter::InsertionGuard guard(rewriter);
   rewriter.setInsertionPointToStart(moduleOp.getBody());
@@ -177,12 +184,32 @@ void createRuntimePrintScalarCall(ConversionPatternRewriter &rewriter,
   Value formatStrValue =
       LLVM::addStringToModule(loc, rewriter, "printfFormat_", formatStrNewline);
 
-  SmallVector<Value> allArgs{formatStrValue};
-  for (auto elem : pid)
-    allArgs.push_back(elem);
-  if (arg.has_value())
-    allArgs.push_back(printfPromoteValue(rewriter, arg.value()));
-  b.call(getOrAddPrintFuncDecl(rewriter, true), allArgs);
+  // The runtime buffers the format and the promoted value as raw bits, and
+  // formats them with printf when the launch flushes its prints.
+  Value value = b.i64_val(0);
+  PrintValueKind kind = PrintValueKind::None;
+  if (arg.has_value()) {
+    value = printfPromoteValue(rewriter, arg.value());
+    Type type = value.getType();
+    if (isa<LLVM::LLVMPointerType>(type)) {
+      value = b.ptrtoint(i64_ty, value);
+      kind = PrintValueKind::Pointer;
+    } else if (type.isF64()) {
+      value = b.bitcast(value, i64_ty);
+      kind = PrintValueKind::Double;
+    } else if (type.getIntOrFloatBitWidth() == 64) {
+      kind = PrintValueKind::Int64;
+    } else {
+      value = b.zext(i64_ty, value);
+      kind = PrintValueKind::Int32;
+    }
+  }
+
+  SmallVector<Value> allArgs(pid.begin(), pid.end());
+  allArgs.push_back(formatStrValue);
+  allArgs.push_back(value);
+  allArgs.push_back(b.i32_val(static_cast<int32_t>(kind)));
+  b.call(getOrAddPrintScalarFuncDecl(rewriter), allArgs);
 }
 
 void createRuntimePrintCall(ConversionPatternRewriter &rewriter,
@@ -271,6 +298,25 @@ struct AssertOpConversion
     auto ctx = rewriter.getContext();
     auto b = TritonLLVMOpBuilder(loc, rewriter);
     auto typeConverter = getTypeConverter();
+
+    // Only a failed assert calls the runtime, from a block outlined from the
+    // hot path, so passing asserts cost a branch on the reduced condition.
+    // #prevBlock
+    //   cond_br %condition, #thenBlock, #failBlock
+    // #failBlock
+    //   triton_assert(pids, false, message, ...)
+    //   br #thenBlock
+    // #thenBlock
+    Block *prevBlock = op->getBlock();
+    Block *failBlock = rewriter.splitBlock(prevBlock, op->getIterator());
+    Block *thenBlock =
+        rewriter.splitBlock(failBlock, std::next(op->getIterator()));
+    rewriter.setInsertionPointToEnd(prevBlock);
+    rewriter.create<LLVM::CondBrOp>(
+        loc, adaptor.getCondition(), thenBlock, ValueRange(), failBlock,
+        ValueRange(), std::make_pair(ASSERT_PASS_WEIGHT, 1u));
+    rewriter.setInsertionPoint(op);
+
     Value message =
         LLVM::addStringToModule(loc, rewriter, "assertMessage_",
                                 makeNullTerminatedString(adaptor.getMessage()));
@@ -294,14 +340,19 @@ struct AssertOpConversion
                                          makeNullTerminatedString(fileStr));
     Value func = LLVM::addStringToModule(loc, rewriter, "assertFunc_",
                                          makeNullTerminatedString(funcStr));
-    SmallVector<Value> args{getPid(op, 0),     getPid(op, 1), getPid(op, 2),
-                            op.getCondition(), message,       file,
-                            b.i32_val(line),   func};
+    SmallVector<Value> args{getPid(op, 0),   getPid(op, 1), getPid(op, 2),
+                            b.int_val(1, 0), message,       file,
+                            b.i32_val(line), func};
     b.call(getAssertFuncDecl(rewriter), args);
+    rewriter.setInsertionPointToEnd(failBlock);
+    rewriter.create<LLVM::BrOp>(loc, thenBlock);
     rewriter.eraseOp(op);
     return success();
   }
 
+  // Branch weight of passing asserts against a weight of 1 for failing ones.
+  static constexpr uint32_t ASSERT_PASS_WEIGHT = 1u << 20;
+
   static LLVM::LLVMFuncOp
   getAssertFuncDecl(ConversionPatternRewriter &rewriter) {
     auto moduleOp =
@@ -320,8 +371,12 @@ struct AssertOpConversion
     ConversionPatternRewriter::InsertionGuard guard(rewriter);
     rewriter.setInsertionPointToStart(moduleOp.getBody());
 
-    return rewriter.create<LLVM::LLVMFuncOp>(UnknownLoc::get(ctx), funcName,
-                                             funcType);
+    auto funcOp = rewriter.create<LLVM::LLVMFuncOp>(UnknownLoc::get(ctx),
+                                                    funcName, funcType);
+    // Keeps code of failure blocks out of the way of hot loops.
+    funcOp.setPassthroughAttr(
+        rewriter.getArrayAttr({rewriter.getStringAttr("cold")}));
+    return funcOp;
   }
 };
 
@@ -246,11 +246,110 @@ private:
   }
 };
 
+// Add the "<name>_range" entry point to a lowered kernel. It takes the kernel
+// arguments, X program id range [xBegin, xEnd), Y and Z program ids and the
+// grid size and runs the programs in a loop. The kernel is inlined into the
+// loop, so program-invariant code is hoisted out of it and a launch makes a
+// single call per row of programs. With noalias, pointer arguments of the
+// kernel and the entry point are marked noalias, which the launcher checks
+// holds for the tensors it is called with.
+static void addRangeEntry(LLVM::LLVMFuncOp kernel, bool noalias) {
+  MLIRContext *ctx = kernel.getContext();
+  Location loc = kernel.getLoc();
+  OpBuilder b(ctx);
+  b.setInsertionPointAfter(kernel);
+
+  auto kernelTy = kernel.getFunctionType();
+  unsigned numArgs = kernelTy.getNumParams() - 6;
+  Type i32Ty = b.getI32Type();
+  SmallVector<Type> argTys(kernelTy.getParams().take_front(numArgs));
+  // xBegin, xEnd, y, z, gridX, gridY, gridZ
+  argTys.append(7, i32Ty);
+  auto entryTy =
+      LLVM::LLVMFunctionType::get(LLVM::LLVMVoidType::get(ctx), argTys);
+  auto entry = b.create<LLVM::LLVMFuncOp>(
+      loc, (kernel.getName() + "_range").str(), entryTy);
+  entry->setAttr(cpu::AttrKernelEntryName, b.getUnitAttr());
+  kernel.setPassthroughAttr(
+      b.getArrayAttr({b.getStringAttr("alwaysinline")}));
+
+  Block *entryBlock = entry.addEntryBlock(b);
+  Region &body = entry.getBody();
+  Block *condBlock = b.createBlock(&body, body.end(), {i32Ty}, {loc});
+  Block *loopBlock = b.createBlock(&body, body.end());
+  Block *exitBlock = b.createBlock(&body, body.end());
+  auto args = entryBlock->getArguments();
+
+  if (noalias) {
+    for (unsigned i = 0; i < numArgs; ++i) {
+      if (!isa<LLVM::LLVMPointerType>(args[i].getType()))
+        continue;
+      kernel.setArgAttr(i, LLVM::LLVMDialect::getNoAliasAttrName(),
+                        b.getUnitAttr());
+      entry.setArgAttr(i, LLVM::LLVMDialect::getNoAliasAttrName(),
+                       b.getUnitAttr());
+    }
+  }
+
+  b.setInsertionPointToEnd(entryBlock);
+  // Divisibility of arguments specialized by the runtime, e.g. alignment of
+  // pointers, is passed to LLVM as assumptions, which unlike parameter
+  // attributes are kept when the entry point is inlined.
+  for (unsigned i = 0; i < numArgs; ++i) {
+    auto divisibility =
+        kernel.getArgAttrOfType<IntegerAttr>(i, "tt.divisibility");
+    if (!divisibility || divisibility.getInt() <= 1 ||
+        !llvm::isPowerOf2_64(divisibility.getInt()))
+      continue;
+    Value arg = args[i];
+    Type intTy = arg.getType();
+    if (isa<LLVM::LLVMPointerType>(intTy)) {
+      entry.setArgAttr(i, LLVM::LLVMDialect::getAlignAttrName(),
+                       b.getI64IntegerAttr(divisibility.getInt()));
+      intTy = b.getI64Type();
+      arg = b.create<LLVM::PtrToIntOp>(loc, intTy, arg);
+    } else if (!isa<IntegerType>(intTy)) {
+      continue;
+    }
+    Value lowBits = b.create<LLVM::ConstantOp>(
+        loc, intTy, b.getIntegerAttr(intTy, divisibility.getInt() - 1));
+    Value zero =
+        b.create<LLVM::ConstantOp>(loc, intTy, b.getIntegerAttr(intTy, 0));
+    Value rem = b.create<LLVM::AndOp>(loc, arg, lowBits);
+    Value isDivisible =
+        b.create<LLVM::ICmpOp>(loc, LLVM::ICmpPredicate::eq, rem, zero);
+    b.create<LLVM::AssumeOp>(loc, isDivisible);
+  }
+  b.create<LLVM::BrOp>(loc, ValueRange{args[numArgs]}, condBlock);
+
+  b.setInsertionPointToEnd(condBlock);
+  Value x = condBlock->getArgument(0);
+  Value inRange = b.create<LLVM::ICmpOp>(loc, LLVM::ICmpPredicate::ult, x,
+                                         args[numArgs + 1]);
+  b.create<LLVM::CondBrOp>(loc, inRange, loopBlock, exitBlock);
+
+  b.setInsertionPointToEnd(loopBlock);
+  SmallVector<Value> callArgs(args.take_front(numArgs));
+  callArgs.push_back(x);
+  callArgs.append(args.begin() + numArgs + 2, args.end());
+  b.create<LLVM::CallOp>(loc, kernel, callArgs);
+  Value one = b.create<LLVM::ConstantOp>(loc, i32Ty, b.getI32IntegerAttr(1));
+  Value nextX = b.create<LLVM::AddOp>(loc, x, one);
+  b.create<LLVM::BrOp>(loc, ValueRange{nextX}, condBlock);
+
+  b.setInsertionPointToEnd(exitBlock);
+  b.create<LLVM::ReturnOp>(loc, ValueRange{});
+}
+
 struct FuncOpToLLVM : public triton::impl::FuncOpToLLVMBase<FuncOpToLLVM> {
   using FuncOpToLLVMBase::FuncOpToLLVMBase;
 
   FuncOpToLLVM() : FuncOpToLLVMBase() {}
 
+  FuncOpToLLVM(bool noalias) : FuncOpToLLVMBase() {
+    this->noalias = noalias;
+  }
+
   void runOnOperation() override {
     MLIRContext *context = &getContext();
     ModuleOp mod = getOperation();
@@ -259,6 +358,12 @@ struct FuncOpToLLVM : public triton::impl::FuncOpToLLVMBase<FuncOpToLLVM> {
     TritonCPUToLLVMTypeConverter typeConverter(context, option);
     TritonLLVMConversionTarget convTarget(*context);
 
+    SmallVector<std::string> kernelNames;
+    mod.walk([&](triton::FuncOp funcOp) {
+      if (LLVM::isKernel(funcOp))
+        kernelNames.push_back(funcOp.getName().str());
+    });
+
     // Lower tt.func
     RewritePatternSet funcPatterns(context);
     funcPatterns.add<FuncOpConversion>(typeConverter,
@@ -276,6 +381,9 @@ struct FuncOpToLLVM : public triton::impl::FuncOpToLLVMBase<FuncOpToLLVM> {
     patterns.add<CallOpConversion>(typeConverter, benefit);
     if (failed(applyPartialConversion(mod, convTarget, std::move(patterns))))
       return signalPassFailure();
+
+    for (auto &name : kernelNames)
+      addRangeEntry(mod.lookupSymbol<LLVM::LLVMFuncOp>(name), noalias);
   }
 };
 
@@ -289,6 +397,10 @@ std::unique_ptr<OperationPass<ModuleOp>> createFuncOpToLLVMPass() {
   return std::make_unique<FuncOpToLLVM>();
 }
 
+std::unique_ptr<OperationPass<ModuleOp>> createFuncOpToLLVMPass(bool noalias) {
+  return std::make_unique<FuncOpToLLVM>(noalias);
+}
+
 } // namespace cpu
 } // namespace triton
 } // namespace mlir
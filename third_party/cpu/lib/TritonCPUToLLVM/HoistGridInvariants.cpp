@@ -0,0 +1,142 @@
+#include "Utility.h"
+
+#include "cpu/include/TritonCPUToLLVM/Passes.h"
+
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_HOISTGRIDINVARIANTS
+#include "cpu/include/TritonCPUToLLVM/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// The only call of a kernel from its range entry point.
+LLVM::CallOp getKernelCall(LLVM::LLVMFuncOp entry, ModuleOp mod,
+                           LLVM::LLVMFuncOp &kernel) {
+  LLVM::CallOp call;
+  entry.walk([&](LLVM::CallOp op) {
+    if (op.getCallee())
+      call = op;
+  });
+  if (!call)
+    return nullptr;
+  kernel = mod.lookupSymbol<LLVM::LLVMFuncOp>(*call.getCallee());
+  if (!kernel || kernel.isExternal())
+    return nullptr;
+  auto uses = SymbolTable::getSymbolUses(kernel, mod);
+  if (!uses || !llvm::hasSingleElement(*uses))
+    return nullptr;
+  return call;
+}
+
+// Move computations of the kernel that don't depend on the x program id to
+// its range entry point, ahead of the loop over programs. Only pure ops of
+// the kernel entry block are moved, so they are executed by every program
+// anyway. Results used by the rest of the kernel are passed as arguments
+// inserted before the program id and grid size ones, which become values
+// computed once per range after the kernel is inlined.
+void hoistGridInvariants(LLVM::LLVMFuncOp entry, ModuleOp mod) {
+  LLVM::LLVMFuncOp kernel;
+  LLVM::CallOp call = getKernelCall(entry, mod, kernel);
+  if (!call)
+    return;
+
+  Block &kernelBlock = kernel.getBody().front();
+  Value pidX = getProgramId(kernel, 0);
+  DenseSet<Value> invariants;
+  for (Value arg : kernelBlock.getArguments())
+    if (arg != pidX)
+      invariants.insert(arg);
+
+  SmallVector<Operation *> hoisted;
+  DenseSet<Operation *> hoistedSet;
+  for (Operation &op : kernelBlock.without_terminator()) {
+    if (op.getNumRegions() || !isMemoryEffectFree(&op) ||
+        !isSpeculatable(&op) ||
+        !llvm::all_of(op.getOperands(),
+                      [&](Value val) { return invariants.contains(val); }))
+      continue;
+    hoisted.push_back(&op);
+    hoistedSet.insert(&op);
+    invariants.insert(op.getResults().begin(), op.getResults().end());
+  }
+
+  // Constants are cheaper to rematerialize than to pass.
+  SmallVector<Value> liveOuts;
+  for (Operation *op : hoisted) {
+    if (op->hasTrait<OpTrait::ConstantLike>())
+      continue;
+    for (Value res : op->getResults())
+      if (llvm::any_of(res.getUsers(), [&](Operation *user) {
+            return !hoistedSet.contains(user);
+          }))
+        liveOuts.push_back(res);
+  }
+  if (liveOuts.empty())
+    return;
+
+  OpBuilder b(call);
+  b.setInsertionPoint(entry.getBody().front().getTerminator());
+  IRMapping mapping;
+  mapping.map(kernelBlock.getArguments(), call.getArgOperands());
+  // Clones that end up unused are removed by the canonicalizer.
+  for (Operation *op : hoisted)
+    b.clone(*op, mapping);
+
+  SmallVector<Value> callArgs(call.getArgOperands());
+  for (Value val : liveOuts) {
+    unsigned idx = kernel.getNumArguments() - 6;
+    kernel.insertArgument(idx, val.getType(), {}, val.getLoc());
+    val.replaceAllUsesWith(kernelBlock.getArgument(idx));
+    callArgs.insert(callArgs.begin() + idx, mapping.lookup(val));
+  }
+  for (Operation *op : llvm::reverse(hoisted))
+    if (op->use_empty())
+      op->erase();
+
+  b.setInsertionPoint(call);
+  b.create<LLVM::CallOp>(call.getLoc(), kernel, callArgs);
+  call.erase();
+}
+
+struct HoistGridInvariants
+    : public triton::cpu::impl::HoistGridInvariantsBase<HoistGridInvariants> {
+  using HoistGridInvariantsBase::HoistGridInvariantsBase;
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+    SmallVector<LLVM::LLVMFuncOp> entries;
+    mod.walk([&](LLVM::LLVMFuncOp funcOp) {
+      if (funcOp->hasAttr(AttrKernelEntryName))
+        entries.push_back(funcOp);
+    });
+    for (auto entry : entries)
+      hoistGridInvariants(entry, mod);
+  }
+};
+
+} // anonymous namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createHoistGridInvariantsPass() {
+  return std::make_unique<HoistGridInvariants>();
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -23,6 +23,89 @@ using namespace mlir::triton::cpu;
 
 namespace {
 
+// Reduce a single dimension of multi-dimensional reductions with a tree of
+// elementwise ops over halves of the reduced dimension. Halves wider than a
+// vector register are combined vertically, which keeps partial vectors
+// instead of reducing each register horizontally. Integer reductions along
+// the innermost dimension stop at a register of partials that is left to a
+// single horizontal reduction, which LLVM lowers with target-specific
+// sequences. Float reductions are ordered in LLVM unless reassociation is
+// allowed, so they are reduced down to a single element with shuffle trees.
+// Reductions along outer dimensions need no horizontal operations at all.
+struct SplitMultiReduction
+    : public OpRewritePattern<vector::MultiDimReductionOp> {
+  SplitMultiReduction(MLIRContext *context, unsigned vectorBits)
+      : OpRewritePattern(context), vectorBits(vectorBits) {}
+
+  LogicalResult matchAndRewrite(vector::MultiDimReductionOp op,
+                                PatternRewriter &rewriter) const override {
+    if (isa<vector::MaskOp>(op->getParentOp()))
+      return failure();
+    SmallVector<bool> reductionMask = op.getReductionMask();
+    if (llvm::count(reductionMask, true) != 1)
+      return failure();
+
+    Location loc = op.getLoc();
+    VectorType srcTy = op.getSourceVectorType();
+    int64_t rank = srcTy.getRank();
+    int64_t dim = llvm::find(reductionMask, true) - reductionMask.begin();
+    bool isInner = dim == rank - 1;
+    bool isFloat = isa<FloatType>(srcTy.getElementType());
+    int64_t lanes = std::max<int64_t>(
+        vectorBits / srcTy.getElementTypeBitWidth(), 1);
+    int64_t targetSize = isInner && !isFloat ? lanes : 1;
+    SmallVector<int64_t> shape(srcTy.getShape());
+    if (!llvm::isPowerOf2_64(shape[dim]) || shape[dim] <= targetSize)
+      return failure();
+
+    vector::CombiningKind kind = op.getKind();
+    Value src = op.getSource();
+    SmallVector<int64_t> strides(dim + 1, 1);
+    while (shape[dim] > targetSize) {
+      shape[dim] /= 2;
+      SmallVector<int64_t> sizes(shape.begin(), shape.begin() + dim + 1);
+      SmallVector<int64_t> loOffsets(dim + 1, 0);
+      SmallVector<int64_t> hiOffsets = loOffsets;
+      hiOffsets[dim] = shape[dim];
+      Value lo = rewriter.create<vector::ExtractStridedSliceOp>(
+          loc, src, loOffsets, sizes, strides);
+      Value hi = rewriter.create<vector::ExtractStridedSliceOp>(
+          loc, src, hiOffsets, sizes, strides);
+      src = vector::makeArithReduction(rewriter, loc, kind, lo, hi);
+    }
+
+    if (shape[dim] > 1) {
+      rewriter.replaceOpWithNewOp<vector::MultiDimReductionOp>(
+          op, src, op.getAcc(), reductionMask, kind);
+      return success();
+    }
+    Value res;
+    if (rank == 1)
+      res = rewriter.create<vector::ExtractOp>(loc, src, ArrayRef<int64_t>{0});
+    else
+      res = rewriter.create<vector::ShapeCastOp>(loc, op.getAcc().getType(),
+                                                 src);
+    rewriter.replaceOp(
+        op, vector::makeArithReduction(rewriter, loc, kind, res, op.getAcc()));
+    return success();
+  }
+
+private:
+  unsigned vectorBits;
+};
+
+// Check if all reduced dimensions of a reduction are outer to its other
+// dimensions, e.g. the rows of a column sum, whose slices along the reduced
+// dimensions are then combined elementwise.
+bool reducesOuterDims(vector::MultiDimReductionOp op) {
+  SmallVector<bool> reductionMask = op.getReductionMask();
+  auto firstParallel = llvm::find(reductionMask, false);
+  return firstParallel != reductionMask.begin() &&
+         firstParallel != reductionMask.end() &&
+         std::find(firstParallel, reductionMask.end(), true) ==
+             reductionMask.end();
+}
+
 // This pass exists because LowerVectorMultiReductionPass can be run on
 // func::FuncOp only and we translate triton::FuncOp directly into llvm::FuncOp.
 // So we run the same set of patterns on triton::FuncOp.
@@ -30,16 +113,44 @@ struct LowerMultiReduction
     : public mlir::triton::impl::LowerMultiReductionBase<LowerMultiReduction> {
   using LowerMultiReductionBase::LowerMultiReductionBase;
 
+  LowerMultiReduction() = default;
+
+  LowerMultiReduction(unsigned vectorBits) { this->vectorBits = vectorBits; }
+
   void runOnOperation() override {
     Operation *op = getOperation();
     MLIRContext *context = op->getContext();
 
+    if (vectorBits) {
+      RewritePatternSet splitPatterns(context);
+      splitPatterns.add<SplitMultiReduction>(context, vectorBits);
+      if (failed(applyPatternsGreedily(op, std::move(splitPatterns))))
+        return signalPassFailure();
+    }
+
+    // The strategy is chosen by the reduced dimensions, so no reduction is
+    // transposed first. Reductions along outer dimensions are lowered to
+    // elementwise ops over their inner vectors. Other ones are lowered to
+    // horizontal reductions of inner vectors. The rewrite of outer ones is
+    // restricted to them and the ops it creates.
+    SmallVector<Operation *> outerOps;
+    op->walk([&](vector::MultiDimReductionOp reductionOp) {
+      if (reducesOuterDims(reductionOp))
+        outerOps.push_back(reductionOp);
+    });
+    if (!outerOps.empty()) {
+      RewritePatternSet outerPatterns(context);
+      vector::populateVectorMultiReductionLoweringPatterns(
+          outerPatterns, vector::VectorMultiReductionLowering::InnerParallel);
+      GreedyRewriteConfig config;
+      config.strictMode = GreedyRewriteStrictness::ExistingAndNewOps;
+      (void)applyOpPatternsGreedily(outerOps, std::move(outerPatterns),
+                                    config);
+    }
+
     RewritePatternSet loweringPatterns(context);
-    // The default lowering option is InnerParallel
-    vector::VectorMultiReductionLowering options =
-        vector::VectorMultiReductionLowering::InnerReduction;
-    vector::populateVectorMultiReductionLoweringPatterns(loweringPatterns,
-                                                         options);
+    vector::populateVectorMultiReductionLoweringPatterns(
+        loweringPatterns, vector::VectorMultiReductionLowering::InnerReduction);
 
     if (failed(applyPatternsGreedily(op, std::move(loweringPatterns))))
       signalPassFailure();
@@ -56,6 +167,11 @@ std::unique_ptr<OperationPass<triton::FuncOp>> createLowerMultiReductionPass() {
   return std::make_unique<LowerMultiReduction>();
 }
 
+std::unique_ptr<OperationPass<triton::FuncOp>>
+createLowerMultiReductionPass(unsigned vectorBits) {
+  return std::make_unique<LowerMultiReduction>(vectorBits);
+}
+
 } // namespace cpu
 } // namespace triton
 } // namespace mlir
@@ -0,0 +1,184 @@
+#include "cpu/include/TritonCPUToLLVM/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/Dialect/X86Vector/Transforms.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_LOWERTRANSPOSES
+#include "cpu/include/TritonCPUToLLVM/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+bool is2DTranspose(vector::TransposeOp op) {
+  return op.getSourceVectorType().getRank() == 2 &&
+         op.getPermutation() == ArrayRef<int64_t>{1, 0};
+}
+
+// Split a 2D transpose into transposes of square tiles of a register row
+// each. Rows of the result are assembled from rows of tile transposes, so
+// only whole sub-rows are moved between tiles.
+struct TileTranspose : public OpRewritePattern<vector::TransposeOp> {
+  TileTranspose(MLIRContext *context, unsigned vectorBits)
+      : OpRewritePattern(context), vectorBits(vectorBits) {}
+
+  LogicalResult matchAndRewrite(vector::TransposeOp op,
+                                PatternRewriter &rewriter) const override {
+    if (!is2DTranspose(op))
+      return failure();
+    VectorType srcTy = op.getSourceVectorType();
+    int64_t rows = srcTy.getDimSize(0);
+    int64_t cols = srcTy.getDimSize(1);
+    int64_t tile = getTileSize(srcTy, vectorBits);
+    if (tile < 2 || (rows == tile && cols == tile))
+      return failure();
+
+    Location loc = op.getLoc();
+    Type elemTy = srcTy.getElementType();
+    VectorType resTy = op.getResultVectorType();
+    VectorType tileTy = VectorType::get({tile, tile}, elemTy);
+    Value res = rewriter.create<arith::ConstantOp>(
+        loc, resTy, rewriter.getZeroAttr(resTy));
+    for (int64_t i = 0; i < rows; i += tile) {
+      for (int64_t j = 0; j < cols; j += tile) {
+        Value block = rewriter.create<vector::ExtractStridedSliceOp>(
+            loc, op.getVector(), ArrayRef<int64_t>{i, j},
+            ArrayRef<int64_t>{tile, tile}, ArrayRef<int64_t>{1, 1});
+        Value trans = rewriter.create<vector::TransposeOp>(
+            loc, tileTy, block, ArrayRef<int64_t>{1, 0});
+        res = rewriter.create<vector::InsertStridedSliceOp>(
+            loc, trans, res, ArrayRef<int64_t>{j, i}, ArrayRef<int64_t>{1, 1});
+      }
+    }
+    rewriter.replaceOp(op, res);
+    return success();
+  }
+
+  // The largest power of two dividing both dimensions that fits a square
+  // tile with a register per row.
+  static int64_t getTileSize(VectorType ty, unsigned vectorBits) {
+    if (!ty.getElementType().isIntOrFloat())
+      return 0;
+    int64_t lanes = vectorBits / ty.getElementTypeBitWidth();
+    int64_t rows = ty.getDimSize(0);
+    int64_t cols = ty.getDimSize(1);
+    return std::min({lanes, rows & -rows, cols & -cols});
+  }
+
+private:
+  unsigned vectorBits;
+};
+
+// Transpose a square tile with power-of-two sides in log2(size) steps, each
+// interleaving halves of row pairs i and i + size / 2 into rows 2i and
+// 2i + 1. Every step is a two-input shuffle per row, which maps to unpack
+// and permute instructions, instead of an extract and an insert per element.
+struct ShuffleTranspose : public OpRewritePattern<vector::TransposeOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(vector::TransposeOp op,
+                                PatternRewriter &rewriter) const override {
+    if (!is2DTranspose(op))
+      return failure();
+    VectorType srcTy = op.getSourceVectorType();
+    int64_t size = srcTy.getDimSize(0);
+    if (size != srcTy.getDimSize(1) || size < 2 || !llvm::isPowerOf2_64(size))
+      return failure();
+
+    Location loc = op.getLoc();
+    SmallVector<Value> rows;
+    for (int64_t i = 0; i < size; ++i)
+      rows.push_back(rewriter.create<vector::ExtractOp>(loc, op.getVector(),
+                                                        ArrayRef<int64_t>{i}));
+
+    int64_t half = size / 2;
+    SmallVector<int64_t> loMask;
+    SmallVector<int64_t> hiMask;
+    for (int64_t k = 0; k < half; ++k) {
+      loMask.append({k, size + k});
+      hiMask.append({half + k, size + half + k});
+    }
+    for (int64_t step = 1; step < size; step *= 2) {
+      SmallVector<Value> next(size);
+      for (int64_t i = 0; i < half; ++i) {
+        next[2 * i] = rewriter.create<vector::ShuffleOp>(
+            loc, rows[i], rows[i + half], loMask);
+        next[2 * i + 1] = rewriter.create<vector::ShuffleOp>(
+            loc, rows[i], rows[i + half], hiMask);
+      }
+      rows = std::move(next);
+    }
+
+    VectorType resTy = op.getResultVectorType();
+    Value res = rewriter.create<arith::ConstantOp>(
+        loc, resTy, rewriter.getZeroAttr(resTy));
+    for (int64_t i = 0; i < size; ++i)
+      res = rewriter.create<vector::InsertOp>(loc, rows[i], res,
+                                              ArrayRef<int64_t>{i});
+    rewriter.replaceOp(op, res);
+    return success();
+  }
+};
+
+struct LowerTransposes
+    : public triton::cpu::impl::LowerTransposesBase<LowerTransposes> {
+  LowerTransposes() = default;
+
+  LowerTransposes(unsigned vectorBits, bool enableAvx2) {
+    this->vectorBits = vectorBits;
+    this->enableAvx2 = enableAvx2;
+  }
+
+  void runOnOperation() override {
+    if (!vectorBits)
+      return;
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    RewritePatternSet patterns(context);
+    patterns.add<TileTranspose>(context, vectorBits);
+    patterns.add<ShuffleTranspose>(context);
+    // 8x8 f32 tiles have a dedicated AVX2 kernel blending with immediates.
+    if (enableAvx2) {
+      auto options = x86vector::avx2::LoweringOptions().setTransposeOptions(
+          x86vector::avx2::TransposeLoweringOptions().lower8x8xf32());
+      x86vector::avx2::populateSpecializedTransposeLoweringPatterns(patterns,
+                                                                    options);
+    }
+    if (failed(mlir::applyPatternsGreedily(mod, std::move(patterns))))
+      return signalPassFailure();
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createLowerTransposesPass() {
+  return std::make_unique<LowerTransposes>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createLowerTransposesPass(unsigned vectorBits, bool enableAvx2) {
+  return std::make_unique<LowerTransposes>(vectorBits, enableAvx2);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
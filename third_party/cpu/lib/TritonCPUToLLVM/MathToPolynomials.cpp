@@ -0,0 +1,77 @@
+#include "cpu/include/TritonCPUToLLVM/Passes.h"
+
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/Math/IR/Math.h"
+#include "mlir/Dialect/Math/Transforms/Approximation.h"
+#include "mlir/Dialect/Math/Transforms/Passes.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/Dialect/X86Vector/X86VectorDialect.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_MATHTOPOLYNOMIALS
+#include "cpu/include/TritonCPUToLLVM/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Expand FP32 transcendental functions to inline polynomials of upstream
+// MLIR before MathToVecLib turns them into calls. Expanded functions are
+// scheduled and fused with surrounding arithmetic by LLVM, e.g. in softmax
+// loops, at the cost of accuracy: results are within a few ULPs of FP32
+// for exp, log, log2, log1p, expm1 and tanh, while the default Sleef calls
+// are within 1 ULP. Functions without expansions still get vector calls.
+struct MathToPolynomials
+    : public mlir::triton::cpu::impl::MathToPolynomialsBase<
+          MathToPolynomials> {
+  using MathToPolynomialsBase::MathToPolynomialsBase;
+
+  MathToPolynomials() = default;
+
+  explicit MathToPolynomials(bool enableAvx2) {
+    this->enableAvx2 = enableAvx2;
+  }
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+
+    RewritePatternSet patterns(&getContext());
+    MathPolynomialApproximationOptions options;
+    options.enableAvx2 = enableAvx2;
+    populateMathPolynomialApproximationPatterns(patterns, options);
+
+    if (failed(applyPatternsGreedily(mod, std::move(patterns))))
+      return signalPassFailure();
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createMathToPolynomialsPass() {
+  return std::make_unique<MathToPolynomials>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createMathToPolynomialsPass(bool enableAvx2) {
+  return std::make_unique<MathToPolynomials>(enableAvx2);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
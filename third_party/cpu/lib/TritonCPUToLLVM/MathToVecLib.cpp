@@ -32,7 +32,11 @@ template <typename OpT> struct VecOpToFp32 : public OpRewritePattern<OpT> {
 public:
   using OpRewritePattern<OpT>::OpRewritePattern;
 
-  VecOpToFp32(MLIRContext *context) : OpRewritePattern<OpT>(context) {}
+  // Keep FP16 operations, which are lowered to native instructions.
+  bool keepFp16;
+
+  VecOpToFp32(MLIRContext *context, bool keepFp16 = false)
+      : OpRewritePattern<OpT>(context), keepFp16(keepFp16) {}
 
   LogicalResult matchAndRewrite(OpT op, PatternRewriter &rewriter) const {
     Location loc = op.getLoc();
@@ -43,6 +47,8 @@ public:
     Type elemTy = vecTy.getElementType();
     if (!elemTy.isBF16() && !elemTy.isF16())
       return failure();
+    if (keepFp16 && elemTy.isF16())
+      return failure();
 
     Type fp32VecTy = vecTy.cloneWith(std::nullopt, rewriter.getF32Type());
     SmallVector<Value> fp32Ops;
@@ -56,7 +62,7 @@ public:
 };
 
 // Decompose vector operation to single-dimensional vector operations
-// with a AVX512 for x86 or NEON for ARM.
+// with a native vector size, e.g. of AVX2, AVX512, NEON, SVE or RVV.
 template <typename OpT>
 struct DecomposeToNativeVecs : public OpRewritePattern<OpT> {
 public:
@@ -144,8 +150,10 @@ public:
 using ExternElementwiseOp = triton::cpu::ExternElementwiseOp;
 
 /*
- * libsleef does not contain implementations for 2-element vectors, so we pad
- * any such vectors to size 4 instead.
+ * libsleef does not contain implementations for vectors smaller than 128
+ * bits, so we pad any such vectors to 128 bits instead, i.e. 4 FP32 or 2 FP64
+ * elements. FP64 vectors aren't padded to 256 bits because NEON only has
+ * 2-element FP64 variants.
  */
 struct PadSmallVecsForSleef : public OpRewritePattern<ExternElementwiseOp> {
 public:
@@ -167,7 +175,8 @@ public:
       return failure();
 
     int64_t numElems = vecTy.getNumElements();
-    if (numElems >= 4)
+    int64_t paddedNumElems = 128 / elemTy.getIntOrFloatBitWidth();
+    if (numElems >= paddedNumElems)
       return failure();
 
     // Create a single-element vector for shuffle to use
@@ -175,8 +184,8 @@ public:
         loc, b.undef(elemTy), VectorType::get({1}, elemTy));
     // Assign indices such that shuffle will pad the original vector with
     // elements from the paddingVec
-    SmallVector<int64_t> indices(4);
-    for (int i = 0; i < 4; ++i) {
+    SmallVector<int64_t> indices(paddedNumElems);
+    for (int i = 0; i < paddedNumElems; ++i) {
       if (i < numElems)
         indices[i] = i;
       else
@@ -189,7 +198,7 @@ public:
       newOperands.push_back(shuf.getResult());
     }
     // Update return type of extern call
-    auto newVecTy = VectorType::get({4}, elemTy);
+    auto newVecTy = VectorType::get({paddedNumElems}, elemTy);
     auto extern_elem = rewriter.create<ExternElementwiseOp>(
         loc, newVecTy, newOperands, op.getSymbol(), op.getPure());
     indices.resize(numElems);
@@ -203,9 +212,71 @@ public:
 using GetVecFnNameFn = std::function<std::string(
     unsigned /*bitwidth*/, unsigned /*numel*/, ValueRange /*operands*/)>;
 
+// Native vector size and ISA extensions vector functions can be chosen for.
+struct VecLibTarget {
+  // Default to 128-bit if no features are specified.
+  size_t vecBits = 128;
+  // 256-bit libmvec variants are 'd' (AVX2) instead of 'c' (AVX).
+  bool hasAVX2 = false;
+  // Size of scalable SVE or RVV registers, when it's known, to call scalable
+  // variants of Sleef functions on vectors of this size.
+  size_t scalableBits = 0;
+  // Sleef suffix of scalable variants and the number of bits scalable vector
+  // types are measured in, e.g. <vscale x 4 x f32> of SVE holds 128-bit
+  // blocks, while the vfloat32m1_t of RVV is <vscale x 2 x f32>.
+  StringRef scalableIsa = "sve";
+  size_t scalableBlockBits = 128;
+  // RVV builds of Sleef have no fixed-size variants, so narrower vectors are
+  // passed to scalable functions as well. SVE ones use NEON variants instead.
+  bool scalableOnly = false;
+  // FP16 arithmetic instructions of AVX512-FP16 or Arm FP16.
+  bool hasFp16 = false;
+};
+
+VecLibTarget getVecLibTarget(VecLib lib,
+                             const std::set<std::string> &cpu_features,
+                             size_t scalableBits, size_t maxVecBits) {
+  VecLibTarget target;
+  target.hasAVX2 = cpu_features.count("avx2");
+  target.hasFp16 =
+      cpu_features.count("avx512fp16") || cpu_features.count("fullfp16");
+  if (cpu_features.count("avx512f"))
+    target.vecBits = 512;
+  else if (cpu_features.count("avx"))
+    target.vecBits = 256;
+  // SVE and RVV are vector length agnostic, so vectors are decomposed to the
+  // register size of the host. libmvec has no scalable variants, NEON is used
+  // instead of SVE. RVV functions of LMUL 1 take a single register.
+  if (lib == VecLib::Sleef && scalableBits >= 128) {
+    if (cpu_features.count("sve")) {
+      target.vecBits = scalableBits;
+      target.scalableBits = scalableBits;
+    } else if (cpu_features.count("v")) {
+      target.vecBits = scalableBits;
+      target.scalableBits = scalableBits;
+      target.scalableIsa = "rvvm1";
+      target.scalableBlockBits = 64;
+      target.scalableOnly = true;
+    }
+  }
+  // Narrower vectors are preferred, e.g. to avoid frequency drops of 512-bit
+  // code. SVE registers that are too wide aren't used, NEON is used instead.
+  // RVV has no fixed-size Sleef variants, so vectors are decomposed to the
+  // preferred size and passed to scalable functions with a shorter length.
+  if (maxVecBits && target.vecBits > maxVecBits) {
+    target.vecBits = std::max<size_t>(maxVecBits, 128);
+    if (target.scalableIsa == "sve")
+      target.scalableBits = 0;
+    else
+      target.scalableBits = target.vecBits;
+  }
+  return target;
+}
+
 class MvecNameGenerator {
 public:
-  explicit MvecNameGenerator(StringRef baseName) : baseName(baseName) {}
+  MvecNameGenerator(StringRef baseName, const VecLibTarget &target)
+      : baseName(baseName), hasAVX2(target.hasAVX2) {}
 
   std::string operator()(unsigned bitwidth, unsigned numel,
                          ValueRange operands) const {
@@ -216,7 +287,7 @@ public:
     if (vecSize == 128) {
       isaPrefix = "b";
     } else if (vecSize == 256) {
-      isaPrefix = "d";
+      isaPrefix = hasAVX2 ? "d" : "c";
     } else if (vecSize == 512) {
       isaPrefix = "e";
     } else {
@@ -230,12 +301,16 @@ public:
 
 private:
   std::string baseName;
+  bool hasAVX2;
 };
 
 class SleefNameGenerator {
 public:
-  SleefNameGenerator(StringRef baseName, unsigned ulp = 10)
-      : baseName(baseName), ulpSuffix(4, '\0') {
+  SleefNameGenerator(StringRef baseName, const VecLibTarget &target,
+                     unsigned ulp = 10)
+      : baseName(baseName), ulpSuffix(4, '\0'),
+        scalableBits(target.scalableBits), scalableIsa(target.scalableIsa),
+        scalableOnly(target.scalableOnly) {
     if (ulp == 0) {
       ulpSuffix = "";
     } else {
@@ -252,6 +327,13 @@ public:
     unsigned vecSize = numel * bitwidth;
     if (vecSize < 128)
       return "";
+    // Scalable variants, e.g. Sleef_expfx_u10sve or Sleef_floorfx_rvvm1, are
+    // used for vectors of the scalable register size, and for all vectors
+    // fitting into it on RVV.
+    if (scalableBits &&
+        (vecSize == scalableBits || (scalableOnly && vecSize < scalableBits)))
+      return "Sleef_" + baseName + (bitwidth == 32 ? "f" : "d") + "x" +
+             (ulpSuffix.empty() ? "_" : ulpSuffix) + scalableIsa.str();
     return "Sleef_" + baseName + (bitwidth == 32 ? "f" : "d") +
            std::to_string(numel) + ulpSuffix;
   }
@@ -259,16 +341,74 @@ public:
 private:
   std::string baseName;
   std::string ulpSuffix;
+  size_t scalableBits;
+  StringRef scalableIsa;
+  bool scalableOnly;
 };
 
+// SVE and RVV functions take and return scalable vectors, fixed vectors of
+// the register size, or narrower ones on RVV, are inserted into them and
+// extracted back. Lanes past the fixed vector are undefined and their
+// results are dropped.
+Value toScalable(Location loc, Value val, size_t blockBits,
+                 PatternRewriter &rewriter) {
+  auto vecTy = cast<VectorType>(val.getType());
+  int64_t minNumElems = blockBits / vecTy.getElementTypeBitWidth();
+  auto scalableTy =
+      VectorType::get({minNumElems}, vecTy.getElementType(), {true});
+  Value undef = rewriter.create<LLVM::UndefOp>(loc, scalableTy);
+  return rewriter.create<vector::ScalableInsertOp>(loc, val, undef, 0);
+}
+
+// Call a function from the module of op, declaring it on the first call.
+Value createFnCall(Operation *op, StringRef fnName, ValueRange operands,
+                   Type resTy, bool readnone, PatternRewriter &rewriter) {
+  auto module = SymbolTable::getNearestSymbolTable(op);
+  auto opFunc = dyn_cast_or_null<SymbolOpInterface>(
+      SymbolTable::lookupSymbolIn(module, fnName));
+  // Generate function declaration if it doesn't exists yet.
+  if (!opFunc) {
+    OpBuilder::InsertionGuard guard(rewriter);
+    rewriter.setInsertionPointToStart(&module->getRegion(0).front());
+    auto fnTy =
+        FunctionType::get(rewriter.getContext(), operands.getTypes(), resTy);
+    opFunc =
+        rewriter.create<func::FuncOp>(rewriter.getUnknownLoc(), fnName, fnTy);
+    opFunc.setPrivate();
+    if (readnone)
+      opFunc->setAttr(LLVM::LLVMDialect::getReadnoneAttrName(),
+                      UnitAttr::get(rewriter.getContext()));
+  }
+  return rewriter.create<func::CallOp>(op->getLoc(), fnName, resTy, operands)
+      .getResult(0);
+}
+
 template <typename OpT>
 struct OpToVecLibConversion : public OpRewritePattern<OpT> {
 public:
-  using OpRewritePattern<OpT>::OpRewritePattern;
+  // Size of vectors passed to scalable functions, 0 if there are none, the
+  // size of blocks of scalable types and whether narrower vectors are passed
+  // to scalable functions too.
+  size_t scalableBits;
+  size_t scalableBlockBits;
+  bool scalableOnly;
+
+  OpToVecLibConversion(MLIRContext *context, size_t scalableBits = 0,
+                       size_t scalableBlockBits = 128,
+                       bool scalableOnly = false)
+      : OpRewritePattern<OpT>(context), scalableBits(scalableBits),
+        scalableBlockBits(scalableBlockBits), scalableOnly(scalableOnly) {}
 
   virtual std::string getVecFnName(OpT op, unsigned bitwidth,
                                    unsigned numel) const = 0;
 
+  // Check if the function called for op takes scalable vectors. Keep in sync
+  // with SleefNameGenerator.
+  virtual bool isScalableCall(OpT op, size_t vecBits) const {
+    return scalableBits && (vecBits == scalableBits ||
+                            (scalableOnly && vecBits < scalableBits));
+  }
+
   LogicalResult matchAndRewrite(OpT op, PatternRewriter &rewriter) const {
     VectorType vecTy = dyn_cast<VectorType>(op.getType());
     if (!vecTy || vecTy.getRank() > 1)
@@ -279,24 +419,22 @@ public:
     if (fnName.empty())
       return failure();
 
-    auto module = SymbolTable::getNearestSymbolTable(op);
-    auto opFunc = dyn_cast_or_null<SymbolOpInterface>(
-        SymbolTable::lookupSymbolIn(module, fnName));
-    // Generate function declaration if it doesn't exists yet.
-    if (!opFunc) {
-      OpBuilder::InsertionGuard guard(rewriter);
-      rewriter.setInsertionPointToStart(&module->getRegion(0).front());
-      auto fnTy = FunctionType::get(
-          rewriter.getContext(), op->getOperandTypes(), op->getResultTypes());
-      opFunc =
-          rewriter.create<func::FuncOp>(rewriter.getUnknownLoc(), fnName, fnTy);
-      opFunc.setPrivate();
-      opFunc->setAttr(LLVM::LLVMDialect::getReadnoneAttrName(),
-                      UnitAttr::get(rewriter.getContext()));
+    Location loc = op.getLoc();
+    size_t vecBits = vecTy.getNumElements() * vecTy.getElementTypeBitWidth();
+    bool isScalable = isScalableCall(op, vecBits);
+    SmallVector<Value> operands(op->getOperands());
+    SmallVector<Type> resTypes(op->getResultTypes());
+    if (isScalable) {
+      for (Value &operand : operands)
+        operand = toScalable(loc, operand, scalableBlockBits, rewriter);
+      resTypes = {operands.front().getType()};
     }
 
-    rewriter.replaceOpWithNewOp<func::CallOp>(op, fnName, op.getType(),
-                                              op->getOperands());
+    Value res = createFnCall(op, fnName, operands, resTypes[0],
+                             /*readnone=*/true, rewriter);
+    if (isScalable)
+      res = rewriter.create<vector::ScalableExtractOp>(loc, vecTy, res, 0);
+    rewriter.replaceOp(op, res);
     return success();
   }
 };
@@ -304,8 +442,12 @@ public:
 template <typename OpT>
 struct VecOpToVecLibConversion : public OpToVecLibConversion<OpT> {
 public:
-  VecOpToVecLibConversion(MLIRContext *context, GetVecFnNameFn getVecFnName)
-      : OpToVecLibConversion<OpT>(context), getVecFnNameImpl(getVecFnName) {}
+  VecOpToVecLibConversion(MLIRContext *context, GetVecFnNameFn getVecFnName,
+                          const VecLibTarget &target)
+      : OpToVecLibConversion<OpT>(context, target.scalableBits,
+                                  target.scalableBlockBits,
+                                  target.scalableOnly),
+        getVecFnNameImpl(getVecFnName) {}
 
   std::string getVecFnName(OpT op, unsigned bitwidth,
                            unsigned numel) const override {
@@ -316,9 +458,28 @@ private:
   GetVecFnNameFn getVecFnNameImpl;
 };
 
+// Sleef functions of libdevice, e.g. Sleef_powf%(numel)_u10, are called like
+// math ops by SleefNameGenerator, other symbols get the number of elements.
 struct ExternElementwiseOpConversion
     : public OpToVecLibConversion<triton::cpu::ExternElementwiseOp> {
-  using OpToVecLibConversion::OpToVecLibConversion;
+  ExternElementwiseOpConversion(MLIRContext *context,
+                                const VecLibTarget &target)
+      // Only RVV needs scalable variants, vectors passed to external
+      // functions are 128-bit on SVE hosts, see MathToVecLibPass.
+      : OpToVecLibConversion(context,
+                             target.scalableOnly ? target.scalableBits : 0,
+                             target.scalableBlockBits, target.scalableOnly),
+        scalableIsa(target.scalableIsa) {}
+
+  static bool isSleefFn(triton::cpu::ExternElementwiseOp op) {
+    return op.getSymbol().starts_with("Sleef_") &&
+           op.getSymbol().contains("%(numel)");
+  }
+
+  bool isScalableCall(triton::cpu::ExternElementwiseOp op,
+                      size_t vecBits) const override {
+    return isSleefFn(op) && OpToVecLibConversion::isScalableCall(op, vecBits);
+  }
 
   std::string getVecFnName(triton::cpu::ExternElementwiseOp op,
                            unsigned bitwidth, unsigned numel) const override {
@@ -326,52 +487,172 @@ struct ExternElementwiseOpConversion
     auto numelIdx = fnName.find("%(numel)");
     if (numelIdx == StringRef::npos)
       return fnName.str();
-    return (fnName.take_front(numelIdx) + Twine(numel) +
-            fnName.drop_front(numelIdx + 8))
-        .str();
+    StringRef prefix = fnName.take_front(numelIdx);
+    StringRef suffix = fnName.drop_front(numelIdx + 8);
+    // E.g. Sleef_powfx_u10rvvm1 or Sleef_fmodfx_rvvm1.
+    if (isScalableCall(op, numel * bitwidth))
+      return (prefix + "x" + (suffix.empty() ? "_" : suffix) + scalableIsa)
+          .str();
+    return (prefix + Twine(numel) + suffix).str();
+  }
+
+private:
+  StringRef scalableIsa;
+};
+
+// Scalar function and its vector variants of a symbol of the form
+// "name|4:name4|8:name8", see tl.extra.cpu.vector_extern_elementwise.
+struct ExternVariants {
+  StringRef scalarName;
+  // Names of vector variants sorted by the number of elements.
+  SmallVector<std::pair<int64_t, StringRef>> vecNames;
+};
+
+std::optional<ExternVariants> parseExternVariants(StringRef symbol) {
+  if (!symbol.contains('|'))
+    return std::nullopt;
+  SmallVector<StringRef> parts;
+  symbol.split(parts, '|');
+  ExternVariants variants;
+  variants.scalarName = parts.front();
+  for (StringRef part : llvm::drop_begin(parts)) {
+    auto [numelStr, name] = part.split(':');
+    int64_t numel;
+    if (numelStr.getAsInteger(10, numel) || numel <= 0 || name.empty())
+      return std::nullopt;
+    variants.vecNames.emplace_back(numel, name);
+  }
+  llvm::sort(variants.vecNames, llvm::less_first());
+  return variants;
+}
+
+// Call vector variants of external functions on chunks of their width. The
+// widest variant that fits into native vectors is used, the last chunk is
+// padded with zeros when there are fewer elements left. Elements are passed
+// to the scalar function one by one if no variant fits.
+struct ExternVariantsConversion
+    : public OpRewritePattern<ExternElementwiseOp> {
+public:
+  size_t vecBits;
+
+  ExternVariantsConversion(MLIRContext *context, size_t vecBits)
+      // Variants are called instead of decomposing and padding vectors for
+      // Sleef functions.
+      : OpRewritePattern<ExternElementwiseOp>(context, /*benefit=*/2),
+        vecBits(vecBits) {}
+
+  LogicalResult matchAndRewrite(ExternElementwiseOp op,
+                                PatternRewriter &rewriter) const {
+    auto variants = parseExternVariants(op.getSymbol());
+    if (!variants)
+      return failure();
+
+    Location loc = op.getLoc();
+    VectorType vecTy = dyn_cast<VectorType>(op.getType());
+    if (!vecTy) {
+      rewriter.replaceOp(op, createFnCall(op, variants->scalarName,
+                                          op.getOperands(), op.getType(),
+                                          op.getPure(), rewriter));
+      return success();
+    }
+
+    Type elemTy = vecTy.getElementType();
+    if (!elemTy.isIntOrFloat())
+      return failure();
+
+    int64_t numElems = vecTy.getNumElements();
+    int64_t maxWidth = vecBits / elemTy.getIntOrFloatBitWidth();
+    int64_t width = 1;
+    StringRef fnName = variants->scalarName;
+    for (auto [numel, name] : variants->vecNames) {
+      if (numel > maxWidth || (width > 1 && width >= numElems))
+        break;
+      width = numel;
+      fnName = name;
+    }
+
+    SmallVector<Value> flatOperands;
+    for (Value operand : op.getOperands()) {
+      auto operandTy = cast<VectorType>(operand.getType());
+      flatOperands.push_back(rewriter.create<vector::ShapeCastOp>(
+          loc, VectorType::get(numElems, operandTy.getElementType()),
+          operand));
+    }
+
+    auto flatTy = VectorType::get(numElems, elemTy);
+    Value res = rewriter.create<arith::ConstantOp>(
+        loc, flatTy, rewriter.getZeroAttr(flatTy));
+    for (int64_t idx = 0; idx < numElems; idx += width) {
+      int64_t size = std::min(width, numElems - idx);
+      SmallVector<Value> chunkOperands;
+      for (Value operand : flatOperands)
+        chunkOperands.push_back(
+            extractChunk(loc, operand, idx, size, width, rewriter));
+      Type chunkTy = width == 1 ? elemTy : VectorType::get(width, elemTy);
+      Value chunkRes = createFnCall(op, fnName, chunkOperands, chunkTy,
+                                    op.getPure(), rewriter);
+      if (width == 1) {
+        res = rewriter.create<vector::InsertOp>(loc, chunkRes, res,
+                                                ArrayRef<int64_t>{idx});
+        continue;
+      }
+      if (size < width)
+        chunkRes = rewriter.create<vector::ExtractStridedSliceOp>(
+            loc, chunkRes, ArrayRef<int64_t>{0}, ArrayRef<int64_t>{size},
+            ArrayRef<int64_t>{1});
+      res = rewriter.create<vector::InsertStridedSliceOp>(
+          loc, chunkRes, res, ArrayRef<int64_t>{idx}, ArrayRef<int64_t>{1});
+    }
+    rewriter.replaceOpWithNewOp<vector::ShapeCastOp>(op, vecTy, res);
+    return success();
+  }
+
+private:
+  // Extract size elements at offset, padded to width elements. A single
+  // element is extracted as a scalar.
+  Value extractChunk(Location loc, Value vec, int64_t offset, int64_t size,
+                     int64_t width, PatternRewriter &rewriter) const {
+    if (width == 1)
+      return rewriter.create<vector::ExtractOp>(loc, vec,
+                                                ArrayRef<int64_t>{offset});
+    Value chunk = rewriter.create<vector::ExtractStridedSliceOp>(
+        loc, vec, ArrayRef<int64_t>{offset}, ArrayRef<int64_t>{size},
+        ArrayRef<int64_t>{1});
+    if (size == width)
+      return chunk;
+    auto paddedTy = VectorType::get(
+        width, cast<VectorType>(vec.getType()).getElementType());
+    Value zeros = rewriter.create<arith::ConstantOp>(
+        loc, paddedTy, rewriter.getZeroAttr(paddedTy));
+    return rewriter.create<vector::InsertStridedSliceOp>(
+        loc, chunk, zeros, ArrayRef<int64_t>{0}, ArrayRef<int64_t>{1});
   }
 };
 
 template <typename OpTy>
 void populatePatternsForOp(RewritePatternSet &patterns,
                            GetVecFnNameFn getVecFnName,
-                           size_t vec_size_in_bits = 512) {
-  patterns.add<VecOpToFp32<OpTy>>(patterns.getContext());
+                           const VecLibTarget &target,
+                           bool nativeFp16 = false) {
+  patterns.add<VecOpToFp32<OpTy>>(patterns.getContext(),
+                                  nativeFp16 && target.hasFp16);
   patterns.add<DecomposeToNativeVecs<OpTy>>(patterns.getContext(),
-                                            vec_size_in_bits);
+                                            target.vecBits);
   patterns.add<VecOpToVecLibConversion<OpTy>>(patterns.getContext(),
-                                              getVecFnName);
+                                              getVecFnName, target);
 }
 
 struct MathToVecLibPass
     : public mlir::triton::cpu::impl::MathToVecLibBase<MathToVecLibPass> {
   MathToVecLibPass() = default;
-  // Default to 128-bit if no features are specified.
-  size_t vec_size_in_bits = 128;
 
-  explicit MathToVecLibPass(VecLib lib, std::set<std::string> cpu_features) {
+  explicit MathToVecLibPass(VecLib lib, std::set<std::string> cpu_features,
+                            size_t scalable_bits, size_t max_vec_bits) {
     this->lib = lib;
-    update_vec_size(cpu_features);
-  }
-
-  void update_vec_size(std::set<std::string> &cpu_features) {
-    // TODO:
-    //  Refactor this as an independent function.
-    //  And improve this to support other x86 SIMD ISAs and also for arm SVE
-    //  (VLA)
-    for (auto feature : cpu_features) {
-      if (feature == "avx512f") {
-        vec_size_in_bits = std::max<size_t>(vec_size_in_bits, 512);
-      } else if (feature == "avx") {
-        vec_size_in_bits = std::max<size_t>(vec_size_in_bits, 256);
-      } else if (feature == "sse") {
-        vec_size_in_bits = std::max<size_t>(vec_size_in_bits, 128);
-      } else if (feature == "neon") {
-        // Arm NEON is fixed 128-bit SIMD ISA.
-        vec_size_in_bits = 128;
-        break;
-      }
-    }
+    this->cpu_features = SmallVector<std::string>(cpu_features.begin(),
+                                                  cpu_features.end());
+    this->scalable_bits = scalable_bits;
+    this->max_vec_bits = max_vec_bits;
   }
 
   void runOnOperation() override {
@@ -380,82 +661,88 @@ struct MathToVecLibPass
 
     RewritePatternSet patterns(context);
 
-    if (!cpu_features.empty()) {
-      std::set<std::string> cpu_features_set{cpu_features.begin(),
-                                             cpu_features.end()};
-      update_vec_size(cpu_features_set);
-    }
+    VecLibTarget target =
+        getVecLibTarget(lib, {cpu_features.begin(), cpu_features.end()},
+                        scalable_bits, max_vec_bits);
 
     switch (lib) {
     case VecLib::Mvec: {
-      populateCommonPatterns<MvecNameGenerator>(patterns);
+      populateCommonPatterns<MvecNameGenerator>(patterns, target);
       break;
     }
     case VecLib::Sleef: {
-      populateCommonPatterns<SleefNameGenerator>(patterns);
+      populateCommonPatterns<SleefNameGenerator>(patterns, target);
       populatePatternsForOp<math::ExpM1Op>(
-          patterns, SleefNameGenerator("expm1"), vec_size_in_bits);
+          patterns, SleefNameGenerator("expm1", target), target);
       populatePatternsForOp<math::FloorOp>(
-          patterns, SleefNameGenerator("floor", /*ulp=*/0), vec_size_in_bits);
+          patterns, SleefNameGenerator("floor", target, /*ulp=*/0), target,
+          /*nativeFp16=*/true);
       populatePatternsForOp<math::SqrtOp>(
-          patterns, SleefNameGenerator("sqrt", /*ulp=*/5), vec_size_in_bits);
+          patterns, SleefNameGenerator("sqrt", target, /*ulp=*/5), target,
+          /*nativeFp16=*/true);
       populatePatternsForOp<math::TruncOp>(
-          patterns, SleefNameGenerator("trunc", /*ulp=*/0), vec_size_in_bits);
+          patterns, SleefNameGenerator("trunc", target, /*ulp=*/0), target,
+          /*nativeFp16=*/true);
       break;
     }
     }
 
+    // Names of external functions are fixed-width, so they don't use scalable
+    // vectors.
     patterns.add<DecomposeToNativeVecs<ExternElementwiseOp>>(
-        patterns.getContext(), vec_size_in_bits);
+        patterns.getContext(), target.scalableBits ? 128 : target.vecBits);
     patterns.add<PadSmallVecsForSleef>(patterns.getContext());
-    patterns.add<ExternElementwiseOpConversion>(patterns.getContext());
+    patterns.add<ExternElementwiseOpConversion>(patterns.getContext(), target);
+    patterns.add<ExternVariantsConversion>(
+        patterns.getContext(), target.scalableBits ? 128 : target.vecBits);
 
     if (failed(applyPatternsGreedily(op, std::move(patterns))))
       signalPassFailure();
   }
 
   template <typename VecFnNameGenerator>
-  void populateCommonPatterns(RewritePatternSet &patterns) const {
-    populatePatternsForOp<math::AcosOp>(patterns, VecFnNameGenerator("acos"),
-                                        vec_size_in_bits);
-    populatePatternsForOp<math::AcoshOp>(patterns, VecFnNameGenerator("acosh"),
-                                         vec_size_in_bits);
-    populatePatternsForOp<math::AsinOp>(patterns, VecFnNameGenerator("asin"),
-                                        vec_size_in_bits);
-    populatePatternsForOp<math::AsinhOp>(patterns, VecFnNameGenerator("asinh"),
-                                         vec_size_in_bits);
-    populatePatternsForOp<math::AtanOp>(patterns, VecFnNameGenerator("atan"),
-                                        vec_size_in_bits);
-    populatePatternsForOp<math::AtanhOp>(patterns, VecFnNameGenerator("atanh"),
-                                         vec_size_in_bits);
-    populatePatternsForOp<math::CbrtOp>(patterns, VecFnNameGenerator("cbrt"),
-                                        vec_size_in_bits);
-    populatePatternsForOp<math::CosOp>(patterns, VecFnNameGenerator("cos"),
-                                       vec_size_in_bits);
-    populatePatternsForOp<math::CoshOp>(patterns, VecFnNameGenerator("cosh"),
-                                        vec_size_in_bits);
-    populatePatternsForOp<math::ErfOp>(patterns, VecFnNameGenerator("erf"),
-                                       vec_size_in_bits);
-    populatePatternsForOp<math::ExpOp>(patterns, VecFnNameGenerator("exp"),
-                                       vec_size_in_bits);
-    populatePatternsForOp<math::Exp2Op>(patterns, VecFnNameGenerator("exp2"),
-                                        vec_size_in_bits);
-    populatePatternsForOp<math::LogOp>(patterns, VecFnNameGenerator("log"),
-                                       vec_size_in_bits);
-    populatePatternsForOp<math::Log2Op>(patterns, VecFnNameGenerator("log2"),
-                                        vec_size_in_bits);
-    populatePatternsForOp<math::Log10Op>(patterns, VecFnNameGenerator("log10"),
-                                         vec_size_in_bits);
-    populatePatternsForOp<math::Log1pOp>(patterns, VecFnNameGenerator("log1p"),
-                                         vec_size_in_bits);
-    populatePatternsForOp<math::SinOp>(patterns, VecFnNameGenerator("sin"),
-                                       vec_size_in_bits);
-    populatePatternsForOp<math::SinhOp>(patterns, VecFnNameGenerator("sinh"),
-                                        vec_size_in_bits);
-    populatePatternsForOp<math::TanOp>(patterns, VecFnNameGenerator("tan"),
-                                       vec_size_in_bits);
-    populatePatternsForOp<math::TanhOp>(patterns, VecFnNameGenerator("tanh"),
-                                        vec_size_in_bits);
+  void populateCommonPatterns(RewritePatternSet &patterns,
+                              const VecLibTarget &target) const {
+    populatePatternsForOp<math::AcosOp>(
+        patterns, VecFnNameGenerator("acos", target), target);
+    populatePatternsForOp<math::AcoshOp>(
+        patterns, VecFnNameGenerator("acosh", target), target);
+    populatePatternsForOp<math::AsinOp>(
+        patterns, VecFnNameGenerator("asin", target), target);
+    populatePatternsForOp<math::AsinhOp>(
+        patterns, VecFnNameGenerator("asinh", target), target);
+    populatePatternsForOp<math::AtanOp>(
+        patterns, VecFnNameGenerator("atan", target), target);
+    populatePatternsForOp<math::AtanhOp>(
+        patterns, VecFnNameGenerator("atanh", target), target);
+    populatePatternsForOp<math::CbrtOp>(
+        patterns, VecFnNameGenerator("cbrt", target), target);
+    populatePatternsForOp<math::CosOp>(
+        patterns, VecFnNameGenerator("cos", target), target);
+    populatePatternsForOp<math::CoshOp>(
+        patterns, VecFnNameGenerator("cosh", target), target);
+    populatePatternsForOp<math::ErfOp>(
+        patterns, VecFnNameGenerator("erf", target), target);
+    populatePatternsForOp<math::ExpOp>(
+        patterns, VecFnNameGenerator("exp", target), target);
+    populatePatternsForOp<math::Exp2Op>(
+        patterns, VecFnNameGenerator("exp2", target), target);
+    populatePatternsForOp<math::LogOp>(
+        patterns, VecFnNameGenerator("log", target), target);
+    populatePatternsForOp<math::Log2Op>(
+        patterns, VecFnNameGenerator("log2", target), target);
+    populatePatternsForOp<math::Log10Op>(
+        patterns, VecFnNameGenerator("log10", target), target);
+    populatePatternsForOp<math::Log1pOp>(
+        patterns, VecFnNameGenerator("log1p", target), target);
+    populatePatternsForOp<math::SinOp>(
+        patterns, VecFnNameGenerator("sin", target), target);
+    populatePatternsForOp<math::SinhOp>(
+        patterns, VecFnNameGenerator("sinh", target), target);
+    populatePatternsForOp<math::TanOp>(
+        patterns, VecFnNameGenerator("tan", target), target);
+    populatePatternsForOp<math::TanhOp>(
+        patterns, VecFnNameGenerator("tanh", target), target);
   }
 };
 
@@ -466,8 +753,10 @@ namespace triton {
 namespace cpu {
 
 std::unique_ptr<OperationPass<ModuleOp>>
-createMathToVecLibPass(VecLib lib, std::set<std::string> cpu_features) {
-  return std::make_unique<MathToVecLibPass>(lib, cpu_features);
+createMathToVecLibPass(VecLib lib, std::set<std::string> cpu_features,
+                       size_t scalable_bits, size_t max_vec_bits) {
+  return std::make_unique<MathToVecLibPass>(lib, cpu_features, scalable_bits,
+                                            max_vec_bits);
 }
 
 } // namespace cpu
@@ -305,6 +305,144 @@ struct PtrSelectConversion : public OpConversionPattern<arith::SelectOp> {
   }
 };
 
+// Lower triton_cpu.scratch_arena to a call of triton_cpu_scratch_arena, which
+// returns the arena of the executing thread and grows it if necessary.
+struct ScratchArenaOpConversion : public OpConversionPattern<ScratchArenaOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult
+  matchAndRewrite(ScratchArenaOp op, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto loc = op.getLoc();
+    auto b = TritonLLVMOpBuilder(loc, rewriter);
+    Value size = b.i64_val(op.getSize());
+    auto callOp = b.call(getScratchArenaFuncDecl(rewriter), ValueRange{size});
+    rewriter.replaceOp(op, callOp.getResult());
+    return success();
+  }
+
+  static LLVM::LLVMFuncOp
+  getScratchArenaFuncDecl(ConversionPatternRewriter &rewriter) {
+    auto moduleOp =
+        rewriter.getBlock()->getParent()->getParentOfType<ModuleOp>();
+    StringRef funcName = "triton_cpu_scratch_arena";
+    Operation *funcOp = moduleOp.lookupSymbol(funcName);
+    if (funcOp)
+      return cast<LLVM::LLVMFuncOp>(*funcOp);
+
+    auto *ctx = rewriter.getContext();
+    auto funcType = LLVM::LLVMFunctionType::get(ptr_ty(ctx), {i64_ty});
+
+    ConversionPatternRewriter::InsertionGuard guard(rewriter);
+    rewriter.setInsertionPointToStart(moduleOp.getBody());
+
+    return rewriter.create<LLVM::LLVMFuncOp>(UnknownLoc::get(ctx), funcName,
+                                             funcType);
+  }
+};
+
+// Lower triton_cpu.thread_slot to a call of triton_cpu_thread_slot.
+struct ThreadSlotOpConversion : public OpConversionPattern<ThreadSlotOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult
+  matchAndRewrite(ThreadSlotOp op, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto loc = op.getLoc();
+    auto b = TritonLLVMOpBuilder(loc, rewriter);
+    auto callOp = b.call(getThreadSlotFuncDecl(rewriter),
+                         ValueRange{adaptor.getNumSlots()});
+    rewriter.replaceOp(op, callOp.getResult());
+    return success();
+  }
+
+  static LLVM::LLVMFuncOp
+  getThreadSlotFuncDecl(ConversionPatternRewriter &rewriter) {
+    auto moduleOp =
+        rewriter.getBlock()->getParent()->getParentOfType<ModuleOp>();
+    StringRef funcName = "triton_cpu_thread_slot";
+    Operation *funcOp = moduleOp.lookupSymbol(funcName);
+    if (funcOp)
+      return cast<LLVM::LLVMFuncOp>(*funcOp);
+
+    auto *ctx = rewriter.getContext();
+    auto funcType = LLVM::LLVMFunctionType::get(i32_ty, {i32_ty});
+
+    ConversionPatternRewriter::InsertionGuard guard(rewriter);
+    rewriter.setInsertionPointToStart(moduleOp.getBody());
+
+    return rewriter.create<LLVM::LLVMFuncOp>(UnknownLoc::get(ctx), funcName,
+                                             funcType);
+  }
+};
+
+static LLVM::LLVMFuncOp
+getBulkMemoryFuncDecl(ConversionPatternRewriter &rewriter, StringRef funcName,
+                      ArrayRef<Type> argTypes) {
+  auto moduleOp = rewriter.getBlock()->getParent()->getParentOfType<ModuleOp>();
+  Operation *funcOp = moduleOp.lookupSymbol(funcName);
+  if (funcOp)
+    return cast<LLVM::LLVMFuncOp>(*funcOp);
+
+  auto *ctx = rewriter.getContext();
+  auto funcType = LLVM::LLVMFunctionType::get(void_ty(ctx), argTypes);
+
+  ConversionPatternRewriter::InsertionGuard guard(rewriter);
+  rewriter.setInsertionPointToStart(moduleOp.getBody());
+
+  return rewriter.create<LLVM::LLVMFuncOp>(UnknownLoc::get(ctx), funcName,
+                                           funcType);
+}
+
+// Lower triton_cpu.bulk_copy to a call of triton_cpu_bulk_copy.
+struct BulkCopyOpConversion : public OpConversionPattern<BulkCopyOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult
+  matchAndRewrite(BulkCopyOp op, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto loc = op.getLoc();
+    auto b = TritonLLVMOpBuilder(loc, rewriter);
+    auto *ctx = rewriter.getContext();
+    auto funcOp = getBulkMemoryFuncDecl(rewriter, "triton_cpu_bulk_copy",
+                                        {ptr_ty(ctx), ptr_ty(ctx), i64_ty,
+                                         i32_ty});
+    b.call(funcOp, ValueRange{adaptor.getDst(), adaptor.getSrc(),
+                              b.i64_val(op.getSize()),
+                              b.i32_val(op.getNontemporal())});
+    rewriter.eraseOp(op);
+    return success();
+  }
+};
+
+// Lower triton_cpu.bulk_fill to a call of triton_cpu_bulk_fill, which takes
+// the bits of the value zero-extended to i64 and the size of elements.
+struct BulkFillOpConversion : public OpConversionPattern<BulkFillOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult
+  matchAndRewrite(BulkFillOp op, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto loc = op.getLoc();
+    auto b = TritonLLVMOpBuilder(loc, rewriter);
+    auto *ctx = rewriter.getContext();
+    Value value = adaptor.getValue();
+    unsigned bits = value.getType().getIntOrFloatBitWidth();
+    if (!isa<IntegerType>(value.getType()))
+      value = b.bitcast(value, int_ty(bits));
+    if (bits < 64)
+      value = b.zext(i64_ty, value);
+    auto funcOp = getBulkMemoryFuncDecl(rewriter, "triton_cpu_bulk_fill",
+                                        {ptr_ty(ctx), i64_ty, i32_ty, i64_ty,
+                                         i32_ty});
+    b.call(funcOp, ValueRange{adaptor.getDst(), value, b.i32_val(bits / 8),
+                              b.i64_val(op.getCount()),
+                              b.i32_val(op.getNontemporal())});
+    rewriter.eraseOp(op);
+    return success();
+  }
+};
+
 struct MemoryOpToLLVM
     : public triton::impl::MemoryOpToLLVMBase<MemoryOpToLLVM> {
   using MemoryOpToLLVMBase::MemoryOpToLLVMBase;
@@ -332,6 +470,10 @@ struct MemoryOpToLLVM
     patterns.add<AddPtrOpConversion>(typeConverter, context);
     patterns.add<PtrBitcastConversion>(typeConverter, context);
     patterns.add<PtrSelectConversion>(typeConverter, context);
+    patterns.add<ScratchArenaOpConversion>(typeConverter, context);
+    patterns.add<ThreadSlotOpConversion>(typeConverter, context);
+    patterns.add<BulkCopyOpConversion>(typeConverter, context);
+    patterns.add<BulkFillOpConversion>(typeConverter, context);
 
     if (failed(applyPartialConversion(mod, convTarget, std::move(patterns))))
       return signalPassFailure();
@@ -0,0 +1,119 @@
+#include "TypeConverter.h"
+#include "Utility.h"
+
+#include "cpu/include/TritonCPUToLLVM/Passes.h"
+
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Pass/Pass.h"
+
+#include "third_party/proton/dialect/include/Dialect/Proton/IR/Dialect.h"
+#include "triton/Conversion/TritonGPUToLLVM/Utility.h"
+#include "triton/Dialect/Triton/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+#define GEN_PASS_DEF_RECORDOPTOLLVM
+#include "cpu/include/TritonCPUToLLVM/Passes.h.inc"
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+class TritonLLVMConversionTarget : public ConversionTarget {
+public:
+  explicit TritonLLVMConversionTarget(MLIRContext &ctx)
+      : ConversionTarget(ctx) {
+    addLegalDialect<LLVM::LLVMDialect>();
+    addLegalOp<mlir::UnrealizedConversionCastOp>();
+  }
+};
+
+// Lower proton.record to a call of triton_cpu_proton_record, which reads the
+// cycle counter (rdtsc on x86, cntvct on AArch64) and appends the event to a
+// buffer of the executing thread. Events are tagged with the kernel name and
+// the program id, so start and end events of a region can be paired.
+struct RecordOpConversion
+    : public ConvertOpToLLVMPattern<triton::proton::RecordOp> {
+  using ConvertOpToLLVMPattern<
+      triton::proton::RecordOp>::ConvertOpToLLVMPattern;
+
+  LogicalResult
+  matchAndRewrite(triton::proton::RecordOp op, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto loc = op.getLoc();
+    auto b = TritonLLVMOpBuilder(loc, rewriter);
+    auto funcOp = op->getParentOfType<LLVM::LLVMFuncOp>();
+    assert(funcOp && "expected LLVM::FuncOp as a parent of RecordOp");
+
+    llvm::SmallString<64> kernelName(funcOp.getName());
+    kernelName.push_back('\0');
+    Value kernel = LLVM::addStringToModule(loc, rewriter, "protonKernelName_",
+                                           kernelName);
+    SmallVector<Value> args{kernel,
+                            b.i32_val(op.getRegionId()),
+                            b.i1_val(op.getIsStart()),
+                            getProgramId(funcOp, 0),
+                            getProgramId(funcOp, 1),
+                            getProgramId(funcOp, 2)};
+    b.call(getRecordFuncDecl(rewriter), args);
+    rewriter.eraseOp(op);
+    return success();
+  }
+
+  static LLVM::LLVMFuncOp
+  getRecordFuncDecl(ConversionPatternRewriter &rewriter) {
+    auto moduleOp =
+        rewriter.getBlock()->getParent()->getParentOfType<ModuleOp>();
+    StringRef funcName = "triton_cpu_proton_record";
+    Operation *funcOp = moduleOp.lookupSymbol(funcName);
+    if (funcOp)
+      return cast<LLVM::LLVMFuncOp>(*funcOp);
+
+    auto *ctx = rewriter.getContext();
+    SmallVector<Type> argsType{ptr_ty(ctx), i32_ty, i1_ty,
+                               i32_ty,      i32_ty, i32_ty};
+    auto funcType = LLVM::LLVMFunctionType::get(void_ty(ctx), argsType);
+
+    ConversionPatternRewriter::InsertionGuard guard(rewriter);
+    rewriter.setInsertionPointToStart(moduleOp.getBody());
+
+    return rewriter.create<LLVM::LLVMFuncOp>(UnknownLoc::get(ctx), funcName,
+                                             funcType);
+  }
+};
+
+struct RecordOpToLLVM
+    : public triton::impl::RecordOpToLLVMBase<RecordOpToLLVM> {
+  using RecordOpToLLVMBase::RecordOpToLLVMBase;
+
+  RecordOpToLLVM() : RecordOpToLLVMBase() {}
+
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    mlir::LowerToLLVMOptions option(context);
+    TritonCPUToLLVMTypeConverter typeConverter(context, option);
+    TritonLLVMConversionTarget convTarget(*context);
+
+    RewritePatternSet patterns(context);
+    patterns.add<RecordOpConversion>(typeConverter);
+
+    if (failed(applyPartialConversion(mod, convTarget, std::move(patterns))))
+      return signalPassFailure();
+  }
+};
+
+} // anonymous namespace
+
+namespace mlir::triton::cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createRecordOpToLLVMPass() {
+  return std::make_unique<RecordOpToLLVM>();
+}
+
+} // namespace mlir::triton::cpu
@@ -2,6 +2,7 @@
 #include "Utility.h"
 
 #include "cpu/include/TritonCPUToLLVM/Passes.h"
+#include "cpu/runtime/runtime_onednn.h"
 
 #include "mlir/Conversion/ArithToLLVM/ArithToLLVM.h"
 #include "mlir/Conversion/LLVMCommon/LoweringOptions.h"
@@ -58,11 +59,32 @@ static inline int64_t getDnnlDataTypeVal(Type ty) {
     return static_cast<int64_t>(dnnl_bf16);
   if (ty.isF16())
     return static_cast<int64_t>(dnnl_f16);
+  if (ty.isInteger(8))
+    return static_cast<int64_t>(dnnl_s8);
+  if (ty.isInteger(32))
+    return static_cast<int64_t>(dnnl_s32);
+  if (isa<Float8E4M3FNType>(ty))
+    return static_cast<int64_t>(dnnl_f8_e4m3);
+  if (isa<Float8E5M2Type>(ty))
+    return static_cast<int64_t>(dnnl_f8_e5m2);
 #endif
   assert_on_onednn_missing();
   llvm_unreachable("Unexpected type for conversion to DNNL type.");
 }
 
+static inline int64_t getDnnlPostOpAlgVal(StringRef postOp) {
+#if defined(DNNL_EXPERIMENTAL_UKERNEL)
+  if (postOp == "linear")
+    return static_cast<int64_t>(dnnl_eltwise_linear);
+  if (postOp == "relu")
+    return static_cast<int64_t>(dnnl_eltwise_relu);
+  if (postOp == "swish")
+    return static_cast<int64_t>(dnnl_eltwise_swish);
+#endif
+  assert_on_onednn_missing();
+  llvm_unreachable("Unexpected post-op for conversion to DNNL algorithm.");
+}
+
 class TritonLLVMConversionTarget : public ConversionTarget {
 public:
   explicit TritonLLVMConversionTarget(MLIRContext &ctx)
@@ -123,14 +145,47 @@ struct BrgemmCreateConversion : public ConvertOpToLLVMPattern<BrgemmCreate> {
                                      i64_ty, i64_ty, i64_ty, i64_ty,
                                      i64_ty, i64_ty, i1_ty};
 
-    auto dispatched = LLVM::createLLVMCallOp(
-        rewriter, loc,
-        getFuncDecl(
-            rewriter, dispatchName, brgemmArgTypes,
-            getTypeConverter()->convertType(brgemmOp.getResult().getType())),
-        brgemmArgs);
-
-    rewriter.replaceOp(brgemmOp, dispatched.getResult());
+    // Post-processed result buffer and post-ops. Unused post-op slots are
+    // passed as dnnl_alg_kind_undef (0), and alpha and beta are passed as
+    // bits of f32 values.
+    SmallVector<int64_t> postOpArgs(3 * BRGEMM_MAX_POST_OPS, 0);
+    if (auto postOps = brgemmOp.getPostOps()) {
+      if (postOps->size() > BRGEMM_MAX_POST_OPS)
+        return rewriter.notifyMatchFailure(brgemmOp, "too many post-ops");
+      ArrayAttr alphas = *brgemmOp.getPostOpAlphas();
+      ArrayAttr betas = *brgemmOp.getPostOpBetas();
+      auto getParamBits = [](Attribute attr) -> int64_t {
+        float val = cast<FloatAttr>(attr).getValue().convertToFloat();
+        return llvm::bit_cast<uint32_t>(val);
+      };
+      for (auto [idx, postOp] :
+           llvm::enumerate(postOps->getAsValueRange<StringAttr>())) {
+        postOpArgs[3 * idx] = getDnnlPostOpAlgVal(postOp);
+        postOpArgs[3 * idx + 1] = getParamBits(alphas[idx]);
+        postOpArgs[3 * idx + 2] = getParamBits(betas[idx]);
+      }
+    }
+    brgemmArgs.push_back(adaptor.getLdd() ? adaptor.getLdd()
+                                          : adaptor.getLdc());
+    brgemmArgs.push_back(b.i64_val(
+        brgemmOp.getDtypeD() ? getDnnlDataTypeVal(*brgemmOp.getDtypeD()) : 0));
+    for (int64_t arg : postOpArgs)
+      brgemmArgs.push_back(b.i64_val(arg));
+    brgemmArgTypes.append(2 + postOpArgs.size(), i64_ty);
+
+    auto createHandle = [&]() -> Value {
+      return LLVM::createLLVMCallOp(
+                 rewriter, loc,
+                 getFuncDecl(rewriter, dispatchName, brgemmArgTypes,
+                             getTypeConverter()->convertType(
+                                 brgemmOp.getResult().getType())),
+                 brgemmArgs)
+          .getResult();
+    };
+    Value handle = getCachedUkernelHandle(loc, dispatchName, brgemmArgs,
+                                          createHandle, rewriter);
+
+    rewriter.replaceOp(brgemmOp, handle);
     return success();
   };
 };
@@ -167,10 +222,18 @@ struct BrgemmExecuteConversion : public ConvertOpToLLVMPattern<BrgemmExecute> {
         adaptor.getBlockedBsize(),
         adaptor.getNumBatches(),
         adaptor.getSkipPacking()};
+    // The post-processed result buffer is optional.
+    if (brgemmOp.getDPtr())
+      brgemmArgs.push_back(MemRefDescriptor(adaptor.getDPtr())
+                               .bufferPtr(rewriter, loc, *getTypeConverter(),
+                                          cast<MemRefType>(
+                                              brgemmOp.getDPtr().getType())));
+    else
+      brgemmArgs.push_back(rewriter.create<LLVM::ZeroOp>(loc, ptr_ty(ctx)));
 
     auto brgemmArgTypes = SmallVector<Type>{
         ptr_ty(ctx), ptr_ty(ctx), ptr_ty(ctx), ptr_ty(ctx), i64_ty,
-        i64_ty,      i64_ty,      i64_ty,      i1_ty};
+        i64_ty,      i64_ty,      i64_ty,      i1_ty,       ptr_ty(ctx)};
 
     auto dispatched = LLVM::createLLVMCallOp(
         rewriter, loc,
@@ -54,6 +54,16 @@ static inline int64_t getXSMMDataTypeVal(Type ty) {
     return static_cast<int64_t>(LIBXSMM_DATATYPE_BF16);
   if (ty.isF16())
     return static_cast<int64_t>(LIBXSMM_DATATYPE_F16);
+  if (isa<Float8E4M3FNType>(ty))
+    return static_cast<int64_t>(LIBXSMM_DATATYPE_HF8);
+  if (isa<Float8E5M2Type>(ty))
+    return static_cast<int64_t>(LIBXSMM_DATATYPE_BF8);
+
+  // Integer types
+  if (ty.isInteger(8))
+    return static_cast<int64_t>(LIBXSMM_DATATYPE_I8);
+  if (ty.isInteger(32))
+    return static_cast<int64_t>(LIBXSMM_DATATYPE_I32);
 #endif
   assert_on_xsmm_missing();
   llvm_unreachable("Unexpected type for conversion to XSMM type.");
@@ -105,6 +115,10 @@ struct BrgemmCreateConversion : public ConvertOpToLLVMPattern<BrgemmCreate> {
       return rewriter.notifyMatchFailure(
           brgemmOp, "expects the same element type for input operands");
 
+    if (brgemmOp.getLdd() || brgemmOp.getPostOps())
+      return rewriter.notifyMatchFailure(brgemmOp,
+                                         "post-ops are not supported");
+
     auto inXsmmType = b.i64_val(getXSMMDataTypeVal(adaptor.getDtypeA()));
     auto outXsmmType = b.i64_val(getXSMMDataTypeVal(adaptor.getDtypeC()));
 
@@ -116,14 +130,19 @@ struct BrgemmCreateConversion : public ConvertOpToLLVMPattern<BrgemmCreate> {
     SmallVector<Type> brgemmArgTypes{i64_ty, i64_ty, i64_ty, i64_ty, i64_ty,
                                      i64_ty, i64_ty, i64_ty, i64_ty, i64_ty};
 
-    auto dispatched = LLVM::createLLVMCallOp(
-        rewriter, loc,
-        getFuncDecl(
-            rewriter, dispatchName, brgemmArgTypes,
-            getTypeConverter()->convertType(brgemmOp.getResult().getType())),
-        brgemmArgs);
-
-    rewriter.replaceOp(brgemmOp, dispatched.getResult());
+    auto createHandle = [&]() -> Value {
+      return LLVM::createLLVMCallOp(
+                 rewriter, loc,
+                 getFuncDecl(rewriter, dispatchName, brgemmArgTypes,
+                             getTypeConverter()->convertType(
+                                 brgemmOp.getResult().getType())),
+                 brgemmArgs)
+          .getResult();
+    };
+    Value handle = getCachedUkernelHandle(loc, dispatchName, brgemmArgs,
+                                          createHandle, rewriter);
+
+    rewriter.replaceOp(brgemmOp, handle);
     return success();
   };
 };
@@ -140,6 +159,10 @@ struct BrgemmExecuteConversion : public ConvertOpToLLVMPattern<BrgemmExecute> {
 
     std::string invokeName = "xsmm_brgemm_invoke";
 
+    if (brgemmOp.getDPtr())
+      return rewriter.notifyMatchFailure(brgemmOp,
+                                         "post-ops are not supported");
+
     auto brgemm_kernel_hash_ptr = rewriter.create<LLVM::IntToPtrOp>(
         loc, ptr_ty(ctx), adaptor.getBrgemmKernelHash());
 
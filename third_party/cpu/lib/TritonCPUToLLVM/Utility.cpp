@@ -1,5 +1,7 @@
 #include "Utility.h"
 
+#include "mlir/Dialect/SCF/IR/SCF.h"
+
 using namespace mlir;
 using namespace mlir::triton;
 
@@ -29,4 +31,74 @@ Value getNumPrograms(mlir::FunctionOpInterface funcOp, int axis) {
   return args[argIdx];
 }
 
+Value getCachedUkernelHandle(Location loc, StringRef cacheName,
+                             ValueRange keyArgs,
+                             function_ref<Value()> createHandle,
+                             ConversionPatternRewriter &rewriter) {
+  MLIRContext *ctx = rewriter.getContext();
+  auto i64Ty = IntegerType::get(ctx, 64);
+  auto ptrTy = LLVM::LLVMPointerType::get(ctx);
+  auto mod =
+      rewriter.getInsertionBlock()->getParentOp()->getParentOfType<ModuleOp>();
+
+  // The cache holds the handle followed by key arguments it was created for.
+  // A zero handle means the cache is empty.
+  std::string name;
+  for (unsigned idx = 0; name.empty() || mod.lookupSymbol(name); ++idx)
+    name = (cacheName + "_cache_" + Twine(idx)).str();
+  auto cacheTy = LLVM::LLVMArrayType::get(i64Ty, keyArgs.size() + 1);
+  {
+    OpBuilder::InsertionGuard g(rewriter);
+    rewriter.setInsertionPointToStart(mod.getBody());
+    auto global = rewriter.create<LLVM::GlobalOp>(
+        loc, cacheTy, /*isConstant=*/false, LLVM::Linkage::Internal, name,
+        /*value=*/Attribute(), /*alignment=*/0, /*addrSpace=*/0,
+        /*dsoLocal=*/true, /*threadLocal=*/true);
+    rewriter.createBlock(&global.getInitializerRegion());
+    Value zero = rewriter.create<LLVM::ZeroOp>(loc, cacheTy);
+    rewriter.create<LLVM::ReturnOp>(loc, zero);
+  }
+
+  Value cache = rewriter.create<LLVM::AddressOfOp>(loc, ptrTy, name);
+  auto getSlotPtr = [&](int32_t idx) -> Value {
+    return rewriter.create<LLVM::GEPOp>(loc, ptrTy, cacheTy, cache,
+                                        ArrayRef<LLVM::GEPArg>{0, idx});
+  };
+
+  SmallVector<Value> keys;
+  for (Value arg : keyArgs) {
+    if (arg.getType() != i64Ty)
+      arg = rewriter.create<LLVM::ZExtOp>(loc, i64Ty, arg);
+    keys.push_back(arg);
+  }
+
+  Value cached = rewriter.create<LLVM::LoadOp>(loc, i64Ty, getSlotPtr(0));
+  Value zero = rewriter.create<LLVM::ConstantOp>(loc, i64Ty, 0);
+  Value hit = rewriter.create<LLVM::ICmpOp>(loc, LLVM::ICmpPredicate::ne,
+                                            cached, zero);
+  for (auto [idx, key] : llvm::enumerate(keys)) {
+    Value cachedKey =
+        rewriter.create<LLVM::LoadOp>(loc, i64Ty, getSlotPtr(idx + 1));
+    Value eq = rewriter.create<LLVM::ICmpOp>(loc, LLVM::ICmpPredicate::eq,
+                                             cachedKey, key);
+    hit = rewriter.create<LLVM::AndOp>(loc, hit, eq);
+  }
+
+  auto ifOp = rewriter.create<scf::IfOp>(loc, TypeRange{i64Ty}, hit,
+                                         /*withElseRegion=*/true);
+  OpBuilder::InsertionGuard g(rewriter);
+  rewriter.setInsertionPointToStart(ifOp.thenBlock());
+  rewriter.create<scf::YieldOp>(loc, cached);
+
+  rewriter.setInsertionPointToStart(ifOp.elseBlock());
+  Value handle = createHandle();
+  assert(handle.getType() == i64Ty && "unexpected handle type");
+  rewriter.create<LLVM::StoreOp>(loc, handle, getSlotPtr(0));
+  for (auto [idx, key] : llvm::enumerate(keys))
+    rewriter.create<LLVM::StoreOp>(loc, key, getSlotPtr(idx + 1));
+  rewriter.create<scf::YieldOp>(loc, handle);
+
+  return ifOp.getResult(0);
+}
+
 } // namespace mlir::triton::cpu
@@ -3,12 +3,23 @@
 
 #include "mlir/Analysis/DataFlowFramework.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Transforms/DialectConversion.h"
 
 namespace mlir::triton::cpu {
 
 Value getProgramId(mlir::FunctionOpInterface funcOp, int axis);
 Value getNumPrograms(mlir::FunctionOpInterface funcOp, int axis);
 
+// Get an i64 ukernel handle for keyArgs through a thread-local cache of the
+// call site. createHandle is only called when the cached handle was created
+// for different keyArgs, so programs of a kernel using the same ukernel skip
+// runtime handle lookups. The cache check is emitted as scf.if, so it must be
+// done before SCF lowering.
+Value getCachedUkernelHandle(Location loc, StringRef cacheName,
+                             ValueRange keyArgs,
+                             function_ref<Value()> createHandle,
+                             ConversionPatternRewriter &rewriter);
+
 } // namespace mlir::triton::cpu
 
 #endif
@@ -0,0 +1,103 @@
+#include "cpu/include/TritonCPUToLLVM/Passes.h"
+
+#include "mlir/Conversion/VectorToSCF/VectorToSCF.h"
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/Dialect/Vector/Transforms/LoweringPatterns.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_VECTORTOSCF
+#include "cpu/include/TritonCPUToLLVM/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Number of target-rank vectors a transfer is split into by the lowering.
+int64_t getNumSlices(VectorTransferOpInterface op, unsigned targetRank) {
+  VectorType vecTy = op.getVectorType();
+  if (vecTy.getRank() <= static_cast<int64_t>(targetRank))
+    return 1;
+  int64_t res = 1;
+  for (int64_t dim : vecTy.getShape().drop_back(targetRank))
+    res *= dim;
+  return res;
+}
+
+struct VectorToSCF
+    : public mlir::triton::cpu::impl::VectorToSCFBase<VectorToSCF> {
+  VectorToSCF() = default;
+
+  VectorToSCF(unsigned targetRank, unsigned maxUnrolledSlices) {
+    this->targetRank = targetRank;
+    this->maxUnrolledSlices = maxUnrolledSlices;
+  }
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+    MLIRContext *context = &getContext();
+
+    // Lower permutation maps first. Like convert-vector-to-scf, rewrites
+    // don't have to converge.
+    RewritePatternSet permutationPatterns(context);
+    vector::populateVectorTransferPermutationMapLoweringPatterns(
+        permutationPatterns);
+    (void)applyPatternsGreedily(mod, std::move(permutationPatterns));
+
+    VectorTransferToSCFOptions opts;
+    opts.setTargetRank(targetRank);
+
+    // Large transfers are lowered to loops over their outer dimensions. The
+    // rewrite is restricted to these transfers and the ops it creates, so the
+    // remaining transfers can be unrolled below.
+    SmallVector<Operation *> largeOps;
+    if (maxUnrolledSlices > 0) {
+      mod.walk([&](VectorTransferOpInterface op) {
+        if (getNumSlices(op, targetRank) > maxUnrolledSlices)
+          largeOps.push_back(op);
+      });
+    }
+    if (!largeOps.empty()) {
+      RewritePatternSet loopPatterns(context);
+      populateVectorToSCFConversionPatterns(loopPatterns, opts);
+      GreedyRewriteConfig config;
+      config.strictMode = GreedyRewriteStrictness::ExistingAndNewOps;
+      (void)applyOpPatternsGreedily(largeOps, std::move(loopPatterns), config);
+    }
+
+    RewritePatternSet unrollPatterns(context);
+    populateVectorToSCFConversionPatterns(unrollPatterns,
+                                          opts.enableFullUnroll());
+    (void)applyPatternsGreedily(mod, std::move(unrollPatterns));
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createVectorToSCFPass() {
+  return std::make_unique<VectorToSCF>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createVectorToSCFPass(unsigned targetRank, unsigned maxUnrolledSlices) {
+  return std::make_unique<VectorToSCF>(targetRank, maxUnrolledSlices);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
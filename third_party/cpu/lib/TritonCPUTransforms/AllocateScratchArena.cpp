@@ -0,0 +1,122 @@
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_ALLOCATESCRATCHARENA
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Alignment of buffers in the arena, the arena itself is aligned to
+// huge pages.
+constexpr int64_t bufferAlignment = 64;
+
+// Get the size in bytes of a buffer that can be taken from the arena. Return
+// std::nullopt for buffers with dynamic shapes, layouts and element types
+// that aren't plain integers or floats.
+std::optional<int64_t> getArenaBufferSize(memref::AllocaOp allocaOp) {
+  MemRefType memRefTy = allocaOp.getType();
+  Type elemTy = memRefTy.getElementType();
+  if (!memRefTy.hasStaticShape() || !memRefTy.getLayout().isIdentity() ||
+      memRefTy.getMemorySpace() || !elemTy.isIntOrFloat())
+    return std::nullopt;
+  int64_t elemBytes = std::max(elemTy.getIntOrFloatBitWidth() / 8, 1u);
+  return memRefTy.getNumElements() * elemBytes;
+}
+
+struct AllocateScratchArena
+    : public triton::cpu::impl::AllocateScratchArenaBase<
+          AllocateScratchArena> {
+  AllocateScratchArena() = default;
+
+  AllocateScratchArena(int64_t minSize) { this->minSize = minSize; }
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+    MLIRContext *ctx = &getContext();
+
+    int64_t maxArenaSize = 0;
+    mod.walk([&](triton::FuncOp funcOp) {
+      // Buffers of other functions would overlap with buffers of the kernels
+      // calling them.
+      if (!funcOp.isPublic())
+        return;
+
+      // Only buffers allocated at the top level of the kernel are live until
+      // the kernel returns and can get disjoint parts of the arena.
+      SmallVector<std::pair<memref::AllocaOp, int64_t>> buffers;
+      int64_t arenaSize = 0;
+      for (auto allocaOp : funcOp.getBody().getOps<memref::AllocaOp>()) {
+        auto size = getArenaBufferSize(allocaOp);
+        if (!size || *size < minSize)
+          continue;
+        buffers.emplace_back(allocaOp, arenaSize);
+        arenaSize += llvm::alignTo(*size, bufferAlignment);
+      }
+      if (buffers.empty())
+        return;
+
+      OpBuilder builder(ctx);
+      builder.setInsertionPointToStart(&funcOp.getBody().front());
+      Type bytePtrTy = PointerType::get(builder.getI8Type(), 1);
+      Value arena = builder.create<ScratchArenaOp>(
+          funcOp.getLoc(), bytePtrTy, builder.getI64IntegerAttr(arenaSize));
+      for (auto [allocaOp, offset] : buffers) {
+        Location loc = allocaOp.getLoc();
+        MemRefType memRefTy = allocaOp.getType();
+        builder.setInsertionPoint(allocaOp);
+        Value ptr = arena;
+        if (offset) {
+          Value offsetVal = builder.create<arith::ConstantOp>(
+              loc, builder.getI64IntegerAttr(offset));
+          ptr = builder.create<AddPtrOp>(loc, bytePtrTy, ptr, offsetVal);
+        }
+        ptr = builder.create<BitcastOp>(
+            loc, PointerType::get(memRefTy.getElementType(), 1), ptr);
+        Value memRef = builder.create<PtrToMemRefOp>(loc, memRefTy, ptr);
+        allocaOp.replaceAllUsesWith(memRef);
+        allocaOp.erase();
+      }
+      maxArenaSize = std::max(maxArenaSize, arenaSize);
+    });
+
+    if (maxArenaSize)
+      mod->setAttr("triton_cpu.scratch_arena_size",
+                   IntegerAttr::get(IntegerType::get(ctx, 64), maxArenaSize));
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createAllocateScratchArena() {
+  return std::make_unique<AllocateScratchArena>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createAllocateScratchArena(int64_t minSize) {
+  return std::make_unique<AllocateScratchArena>(minSize);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
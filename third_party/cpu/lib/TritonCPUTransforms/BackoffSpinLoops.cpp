@@ -0,0 +1,145 @@
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "triton-cpu-backoff-spin-loops"
+#define DBGS() (llvm::dbgs() << "[" DEBUG_TYPE "]: ")
+#define LDBG(X) LLVM_DEBUG(DBGS() << X << "\n")
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_BACKOFFSPINLOOPS
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Return the compare-and-swap a while loop spins on, i.e. the only atomic
+// of its condition region, which decides whether to retry, with a body
+// that doesn't touch memory, e.g.
+//   while tl.atomic_cas(lock, 0, 1) == 1:
+//       pass
+// Return null for other loops.
+triton::AtomicCASOp getSpinCAS(scf::WhileOp whileOp) {
+  triton::AtomicCASOp casOp;
+  for (Operation &op : whileOp.getBefore().front()) {
+    if (auto cas = dyn_cast<triton::AtomicCASOp>(op)) {
+      if (casOp)
+        return nullptr;
+      casOp = cas;
+    } else if (!isMemoryEffectFree(&op) && !isa<scf::ConditionOp>(op)) {
+      return nullptr;
+    }
+  }
+  if (!casOp ||
+      (!casOp.getType().isInteger(32) && !casOp.getType().isInteger(64)))
+    return nullptr;
+
+  auto cmpOp =
+      whileOp.getConditionOp().getCondition().getDefiningOp<arith::CmpIOp>();
+  if (!cmpOp || (cmpOp.getLhs() != casOp && cmpOp.getRhs() != casOp))
+    return nullptr;
+
+  for (Operation &op : whileOp.getAfter().front())
+    if (!isMemoryEffectFree(&op))
+      return nullptr;
+  return casOp;
+}
+
+// Return the value available in the body of the loop, constants of the
+// condition region are cloned.
+Value getValueInBody(Value value, scf::WhileOp whileOp, OpBuilder &b) {
+  if (whileOp.isDefinedOutsideOfLoop(value))
+    return value;
+  return b.clone(*value.getDefiningOp())->getResult(0);
+}
+
+// Give the loop a counter of failed attempts and wait with
+// triton_cpu.spin_wait at the end of its body, i.e. after each failed
+// attempt, until the lock looks free.
+void insertBackoff(scf::WhileOp whileOp, triton::AtomicCASOp casOp) {
+  OpBuilder b(whileOp);
+  Location loc = whileOp.getLoc();
+  Type i32Ty = b.getI32Type();
+
+  SmallVector<Value> inits(whileOp.getInits());
+  inits.push_back(b.create<arith::ConstantIntOp>(loc, 0, 32));
+  SmallVector<Type> resultTypes(whileOp.getResultTypes());
+  resultTypes.push_back(i32Ty);
+  auto newOp = b.create<scf::WhileOp>(loc, resultTypes, inits);
+  newOp.getBefore().takeBody(whileOp.getBefore());
+  newOp.getAfter().takeBody(whileOp.getAfter());
+
+  Value beforeIter = newOp.getBefore().front().addArgument(i32Ty, loc);
+  newOp.getConditionOp().getArgsMutable().append(beforeIter);
+
+  Value afterIter = newOp.getAfter().front().addArgument(i32Ty, loc);
+  scf::YieldOp yieldOp = newOp.getYieldOp();
+  b.setInsertionPoint(yieldOp);
+  Value expected = getValueInBody(casOp.getCmp(), newOp, b);
+  b.create<cpu::SpinWaitOp>(loc, casOp.getPtr(), expected, afterIter);
+  Value nextIter = b.create<arith::AddIOp>(
+      loc, afterIter, b.create<arith::ConstantIntOp>(loc, 1, 32));
+  yieldOp.getResultsMutable().append(nextIter);
+
+  whileOp.replaceAllUsesWith(
+      newOp.getResults().take_front(whileOp.getNumResults()));
+  whileOp.erase();
+}
+
+struct BackoffSpinLoops
+    : public triton::cpu::impl::BackoffSpinLoopsBase<BackoffSpinLoops> {
+  BackoffSpinLoops() = default;
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+
+    SmallVector<std::pair<scf::WhileOp, triton::AtomicCASOp>> loops;
+    mod.walk([&](scf::WhileOp whileOp) {
+      triton::AtomicCASOp casOp = getSpinCAS(whileOp);
+      if (!casOp || !whileOp.isDefinedOutsideOfLoop(casOp.getPtr()))
+        return;
+      Value cmp = casOp.getCmp();
+      if (!whileOp.isDefinedOutsideOfLoop(cmp) &&
+          !matchPattern(cmp, m_Constant()))
+        return;
+      loops.emplace_back(whileOp, casOp);
+    });
+
+    for (auto [whileOp, casOp] : loops) {
+      LDBG("Adding backoff to spin loop: " << whileOp);
+      insertBackoff(whileOp, casOp);
+    }
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createBackoffSpinLoops() {
+  return std::make_unique<BackoffSpinLoops>();
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -80,6 +80,95 @@ struct FoldReadShapeCast : public OpRewritePattern<vector::TransferReadOp> {
   }
 };
 
+// Fold a transpose of a transfer read into the permutation map of the read,
+// so the transposed tile is read from memory directly. Transposes feeding
+// dots are kept for dot lowerings, which check their operands' layouts.
+struct FoldTransposeIntoRead : public OpRewritePattern<vector::TransposeOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(vector::TransposeOp op,
+                                PatternRewriter &rewriter) const override {
+    auto read = op.getVector().getDefiningOp<vector::TransferReadOp>();
+    if (!read || !read->hasOneUse() || read.getMask() ||
+        !read.getPermutationMap().isMinorIdentity())
+      return failure();
+    if (llvm::any_of(op->getUsers(),
+                     [](Operation *user) { return isa<triton::DotOp>(user); }))
+      return failure();
+
+    AffineMap permMap = read.getPermutationMap();
+    ArrayRef<int64_t> perm = op.getPermutation();
+    SmallVector<AffineExpr> results;
+    SmallVector<Attribute> inBounds;
+    for (int64_t dim : perm) {
+      results.push_back(permMap.getResult(dim));
+      inBounds.push_back(read.getInBounds()[dim]);
+    }
+    auto newPermMap =
+        AffineMap::get(permMap.getNumDims(), 0, results, getContext());
+    rewriter.replaceOpWithNewOp<vector::TransferReadOp>(
+        op, op.getResultVectorType(), read.getSource(), read.getIndices(),
+        newPermMap, read.getPadding(), Value(),
+        rewriter.getArrayAttr(inBounds));
+    rewriter.eraseOp(read);
+    return success();
+  }
+};
+
+// Replace a transpose of a broadcast with a broadcast of the source, when the
+// transpose only moves broadcast dimensions around the source ones, e.g. a
+// transposed row broadcast becomes a column broadcast. The tile is then never
+// materialized and shuffled.
+struct FoldTransposeOfBroadcast
+    : public OpRewritePattern<vector::TransposeOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(vector::TransposeOp op,
+                                PatternRewriter &rewriter) const override {
+    auto bcast = op.getVector().getDefiningOp<vector::BroadcastOp>();
+    if (!bcast)
+      return failure();
+
+    Location loc = op.getLoc();
+    VectorType resTy = op.getResultVectorType();
+    Value src = bcast.getSource();
+    auto srcTy = dyn_cast<VectorType>(src.getType());
+    if (!srcTy) {
+      rewriter.replaceOpWithNewOp<vector::BroadcastOp>(op, resTy, src);
+      return success();
+    }
+
+    // Align source dimensions with the broadcast result and check source
+    // dimensions that aren't broadcast keep their order.
+    int64_t rank = resTy.getRank();
+    SmallVector<int64_t> srcShape(rank - srcTy.getRank(), 1);
+    llvm::append_range(srcShape, srcTy.getShape());
+    ArrayRef<int64_t> bcastShape = bcast.getResultVectorType().getShape();
+    SmallVector<int64_t> newSrcShape;
+    int64_t lastSrcDim = -1;
+    for (int64_t dim : op.getPermutation()) {
+      newSrcShape.push_back(srcShape[dim]);
+      if (srcShape[dim] != bcastShape[dim] || srcShape[dim] == 1)
+        continue;
+      if (dim < lastSrcDim)
+        return failure();
+      lastSrcDim = dim;
+    }
+
+    // Unit dimensions are moved with a shape cast through a 1D vector, which
+    // keeps the order of elements.
+    Type elemTy = srcTy.getElementType();
+    if (srcTy.getRank() > 1 && srcTy.getShape() != ArrayRef(newSrcShape))
+      src = rewriter.create<vector::ShapeCastOp>(
+          loc, VectorType::get({srcTy.getNumElements()}, elemTy), src);
+    if (cast<VectorType>(src.getType()).getShape() != ArrayRef(newSrcShape))
+      src = rewriter.create<vector::ShapeCastOp>(
+          loc, VectorType::get(newSrcShape, elemTy), src);
+    rewriter.replaceOpWithNewOp<vector::BroadcastOp>(op, resTy, src);
+    return success();
+  }
+};
+
 struct Canonicalize : public triton::cpu::impl::CanonicalizeBase<Canonicalize> {
   Canonicalize() = default;
 
@@ -89,6 +178,8 @@ struct Canonicalize : public triton::cpu::impl::CanonicalizeBase<Canonicalize> {
 
     RewritePatternSet patterns(context);
     patterns.add<FoldReadShapeCast>(context);
+    patterns.add<FoldTransposeIntoRead>(context);
+    patterns.add<FoldTransposeOfBroadcast>(context);
 
     if (failed(mlir::applyPatternsGreedily(mod, std::move(patterns))))
       return signalPassFailure();
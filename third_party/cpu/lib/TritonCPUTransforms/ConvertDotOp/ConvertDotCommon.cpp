@@ -207,18 +207,24 @@ MemBuffer findInputBuffer(Value val, bool allowTransposed, bool allowVnni) {
 
 Value maybeCast(Location loc, Value val, Type dstElemTy,
                 PatternRewriter &rewriter) {
-  VectorType srcTy = cast<VectorType>(val.getType());
-  if (srcTy.getElementType() == dstElemTy)
+  Type srcElemTy = getElementTypeOrSelf(val.getType());
+  if (srcElemTy == dstElemTy)
     return val;
 
-  VectorType dstTy = srcTy.cloneWith(std::nullopt, dstElemTy);
-  if (srcTy.getElementType().isInteger()) {
-    if (srcTy.getElementTypeBitWidth() < dstTy.getElementTypeBitWidth())
+  Type dstTy = dstElemTy;
+  if (auto srcTy = dyn_cast<VectorType>(val.getType()))
+    dstTy = srcTy.cloneWith(std::nullopt, dstElemTy);
+  unsigned srcBits = srcElemTy.getIntOrFloatBitWidth();
+  unsigned dstBits = dstElemTy.getIntOrFloatBitWidth();
+  if (srcElemTy.isInteger()) {
+    if (!dstElemTy.isInteger())
+      return rewriter.create<arith::SIToFPOp>(loc, dstTy, val);
+    if (srcBits < dstBits)
       return rewriter.create<arith::ExtSIOp>(loc, dstTy, val);
     return rewriter.create<arith::TruncIOp>(loc, dstTy, val);
   }
 
-  if (srcTy.getElementTypeBitWidth() < dstTy.getElementTypeBitWidth())
+  if (srcBits < dstBits)
     return rewriter.create<arith::ExtFOp>(loc, dstTy, val);
   return rewriter.create<arith::TruncFOp>(loc, dstTy, val);
 }
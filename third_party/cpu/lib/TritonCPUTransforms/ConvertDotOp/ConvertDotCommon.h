@@ -66,9 +66,9 @@ template <typename T> bool hasMaskOrBoundsCheck(T op) {
 MemBuffer findInputBuffer(Value val, bool allowTransposed = false,
                           bool allowVnni = false);
 
-// Cast vector to a specified element type using ext or trunc
-// operations. Return the original value if it already matches
-// the required element type.
+// Cast vector or scalar to a specified element type using ext, trunc,
+// or int to float conversion operations. Return the original value if it
+// already matches the required element type.
 Value maybeCast(Location loc, Value val, Type dstElemTy,
                 PatternRewriter &rewriter);
 
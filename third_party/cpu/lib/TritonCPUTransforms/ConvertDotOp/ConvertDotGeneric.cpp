@@ -1,4 +1,4 @@
-#include "cpu/include/TritonCPUTransforms/OptCommon.h"
+#include "ConvertDotCommon.h"
 
 #include "cpu/include/TritonCPUTransforms/Passes.h"
 
@@ -27,6 +27,113 @@ using namespace mlir::triton::cpu;
 
 namespace {
 
+// Maximum number of broadcasted LHS elements, i.e. M * K, for which dots are
+// lowered to outer products. Bigger dots are left to the default contraction
+// lowering to limit the generated code size.
+constexpr int64_t maxOuterProductSteps = 4096;
+
+// Outer products are computed in the accumulator type, so smaller float
+// accumulators are left to contractions computed in a common type.
+bool isOuterProductCandidate(cpu::DotOp op) {
+  VectorType lhsTy = op.getA().getType();
+  Type accElemTy = op.getC().getType().getElementType();
+  if (lhsTy.getRank() != 2 ||
+      !(accElemTy.isInteger() || accElemTy.isF32() || accElemTy.isF64()))
+    return false;
+  return lhsTy.getNumElements() <= maxOuterProductSteps;
+}
+
+SmallVector<Value> extractRows(Location loc, Value vec,
+                               PatternRewriter &rewriter) {
+  SmallVector<Value> res;
+  for (int64_t m = 0; m < cast<VectorType>(vec.getType()).getDimSize(0); ++m)
+    res.push_back(rewriter.create<vector::ExtractOp>(
+        loc, vec, SmallVector<int64_t>({m})));
+  return res;
+}
+
+Value mergeRows(Location loc, VectorType resTy, ValueRange rows,
+                PatternRewriter &rewriter) {
+  Value res =
+      rewriter.create<arith::ConstantOp>(loc, rewriter.getZeroAttr(resTy));
+  for (auto [m, row] : llvm::enumerate(rows))
+    res = rewriter.create<vector::InsertOp>(
+        loc, row, res, SmallVector<int64_t>({static_cast<int64_t>(m)}));
+  return res;
+}
+
+// Lower the dot to a sequence of outer products. Each accumulator row is
+// updated with RHS rows multiplied by broadcasted LHS elements, so all
+// computations are done on N-element vectors in the accumulator type. If
+// the accumulator is carried by a loop, then its rows are kept on registers
+// for the whole loop, similar to the FMA lowering.
+void convertToOuterProducts(cpu::DotOp op, PatternRewriter &rewriter) {
+  Location loc = op.getLoc();
+  VectorType lhsTy = op.getA().getType();
+  VectorType accTy = op.getC().getType();
+  Type accElemTy = accTy.getElementType();
+  bool isInteger = accElemTy.isInteger();
+  VectorType rowTy = VectorType::get(accTy.getDimSize(1), accElemTy);
+
+  Value acc = op.getC();
+  bool keepAccOnRegs = isLoopCarriedAcc(acc);
+  scf::ForOp forOp;
+  SmallVector<Value> accInitRows;
+  SmallVector<Value> accRows;
+  if (keepAccOnRegs) {
+    forOp = cast<scf::ForOp>(op->getParentOp());
+    OpBuilder::InsertionGuard g(rewriter);
+    rewriter.setInsertionPoint(forOp);
+    LDBG("Loading accumulator rows before the loop.");
+    accInitRows = extractRows(loc, getInitAccValue(acc), rewriter);
+    accRows = accInitRows;
+  } else {
+    accRows = extractRows(loc, acc, rewriter);
+  }
+
+  Value lhs = maybeCast(loc, op.getA(), accElemTy, rewriter);
+  Value rhs = maybeCast(loc, op.getB(), accElemTy, rewriter);
+  for (int64_t k = 0; k < lhsTy.getDimSize(1); ++k) {
+    Value rhsRow = rewriter.create<vector::ExtractOp>(
+        loc, rhs, SmallVector<int64_t>({k}));
+    for (int64_t m = 0; m < lhsTy.getDimSize(0); ++m) {
+      Value lhsElem = rewriter.create<vector::ExtractOp>(
+          loc, lhs, SmallVector<int64_t>({m, k}));
+      Value lhsBroadcasted =
+          rewriter.create<vector::BroadcastOp>(loc, rowTy, lhsElem);
+      if (isInteger)
+        accRows[m] = rewriter.create<arith::AddIOp>(
+            loc, accRows[m],
+            rewriter.create<arith::MulIOp>(loc, lhsBroadcasted, rhsRow));
+      else
+        accRows[m] = rewriter.create<vector::FMAOp>(loc, lhsBroadcasted,
+                                                    rhsRow, accRows[m]);
+    }
+  }
+
+  if (!keepAccOnRegs) {
+    rewriter.replaceOp(op, mergeRows(loc, accTy, accRows, rewriter));
+    return;
+  }
+
+  // Directly yield the original accumulator, it would be later removed as
+  // unused, and add loop carried dependencies for accumulator rows.
+  int64_t origResIdx = op.getResult().getUses().begin()->getOperandNumber();
+  rewriter.replaceOp(op, op.getC());
+  auto newForOp = cast<scf::ForOp>(*forOp.replaceWithAdditionalYields(
+      rewriter, accInitRows, true,
+      [&accRows](OpBuilder &b, Location loc,
+                 ArrayRef<BlockArgument> newBBArgs) { return accRows; }));
+
+  OpBuilder::InsertionGuard g(rewriter);
+  rewriter.setInsertionPointAfter(newForOp);
+  LDBG("Merging resulting rows to replace loop result.");
+  Value newVal =
+      mergeRows(loc, accTy, newForOp.getResults().take_back(accRows.size()),
+                rewriter);
+  rewriter.replaceAllUsesWith(newForOp.getResult(origResIdx), newVal);
+}
+
 class DotConversionTarget : public ConversionTarget {
 public:
   explicit DotConversionTarget(MLIRContext &ctx) : ConversionTarget(ctx) {
@@ -108,6 +215,18 @@ struct ConvertDotGeneric
     MLIRContext *context = &getContext();
     ModuleOp mod = getOperation();
 
+    SmallVector<cpu::DotOp> outerProductCandidates;
+    mod->walk([&](cpu::DotOp op) {
+      if (isOuterProductCandidate(op))
+        outerProductCandidates.push_back(op);
+    });
+    for (auto op : outerProductCandidates) {
+      LDBG("Lowering to outer products: " << op);
+      PatternRewriter rewriter(context);
+      rewriter.setInsertionPoint(op);
+      convertToOuterProducts(op, rewriter);
+    }
+
     DotConversionTarget convTarget(*context);
     RewritePatternSet patterns(context);
     patterns.add<DotOpConversion>(context);
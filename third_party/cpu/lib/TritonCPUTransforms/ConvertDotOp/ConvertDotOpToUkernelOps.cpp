@@ -1,9 +1,14 @@
 #include "ConvertDotCommon.h"
 
 #include "cpu/include/TritonCPUTransforms/Passes.h"
+#include "cpu/runtime/runtime_onednn.h"
 
 #include "cpu/include/Analysis/TensorPtrShapeInfo.h"
 #include "mlir/Dialect/Index/IR/IndexDialect.h"
+#include "mlir/Dialect/Math/IR/Math.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 
@@ -45,6 +50,14 @@ static inline dnnl::memory::data_type getDnnlDataTypeVal(Type ty) {
     return dnnl::memory::data_type::bf16;
   if (ty.isF16())
     return dnnl::memory::data_type::f16;
+  if (ty.isInteger(8))
+    return dnnl::memory::data_type::s8;
+  if (ty.isInteger(32))
+    return dnnl::memory::data_type::s32;
+  if (isa<Float8E4M3FNType>(ty))
+    return dnnl::memory::data_type::f8_e4m3;
+  if (isa<Float8E5M2Type>(ty))
+    return dnnl::memory::data_type::f8_e5m2;
   llvm_unreachable("Unexpected type for conversion to DNNL type.");
 }
 #endif
@@ -67,6 +80,20 @@ bool isPackingExpected(Type dtypeA, Type dtypeB, Ukernels ukernel) {
   return false;
 }
 
+// Elementwise epilogue applied to a fused dot loop result before it is
+// stored to memory. OneDNN ukernels can apply it as post-ops and write
+// the final result directly, without reading the accumulator back.
+struct UkernelEpilogue {
+  // Operations computing the stored value in the order of their execution.
+  SmallVector<Operation *> ops;
+  // Post-ops matching the epilogue, see BrgemmCreate for their semantics.
+  SmallVector<StringRef> postOps;
+  SmallVector<float> alphas;
+  SmallVector<float> betas;
+  // The final store. Null if there is no epilogue to fuse.
+  vector::TransferWriteOp store = nullptr;
+};
+
 // This structure is used to hold candidates for conversion to ukernel calls.
 struct DotOpCandidate {
   // Operation to convert.
@@ -85,6 +112,9 @@ struct DotOpCandidate {
   // If input data is available in memory then input buffers hold it.
   MemBuffer lhsBuf;
   MemBuffer rhsBuf;
+
+  // Epilogue to fuse into the ukernel call.
+  UkernelEpilogue epilogue;
 };
 
 bool isLoopInvariant(SmallVector<Value> vals, LoopLikeOpInterface loopLike) {
@@ -98,20 +128,36 @@ bool isLoopInvariant(SmallVector<Value> vals, LoopLikeOpInterface loopLike) {
   return true;
 }
 
+// Integer inputs are supported as s8 x s8 -> s32. Signless integers of
+// the dot are signed, so unsigned inputs are never used.
+bool isInt8Dot(Type lhsElemTy, Type rhsElemTy, Type accElemTy,
+               Type resElemTy) {
+  return lhsElemTy.isInteger(8) && rhsElemTy.isInteger(8) &&
+         accElemTy.isInteger(32) && resElemTy.isInteger(32);
+}
+
+// FP8 inputs of the same type are supported with FP32 accumulation.
+bool isFp8Dot(Type lhsElemTy, Type rhsElemTy, Type accElemTy,
+              Type resElemTy) {
+  return isa<Float8E4M3FNType, Float8E5M2Type>(lhsElemTy) &&
+         lhsElemTy == rhsElemTy && accElemTy.isF32() && resElemTy.isF32();
+}
+
 bool checkElemTypesOneDNN(Type lhsElemTy, Type rhsElemTy, Type accElemTy,
                           Type resElemTy) {
-  // Integer types are not supported yet.
+  if (isInt8Dot(lhsElemTy, rhsElemTy, accElemTy, resElemTy) ||
+      isFp8Dot(lhsElemTy, rhsElemTy, accElemTy, resElemTy))
+    return true;
+
   if (lhsElemTy.isInteger() || rhsElemTy.isInteger() || resElemTy.isInteger()) {
-    // Should be also lhs = [u8, s8] rhs = [u8, s8] res = [s32]
-    // but there is an assertion if res not f32 TODO - verify.
-    LDBG("Drop candidate. Integer types are not supported.");
+    LDBG("Drop candidate. Only s8 x s8 -> s32 integer dot is supported.");
     return false;
   }
 
-  // FP8 input is not supported yet.
+  // Other FP8 inputs are not supported.
   if (lhsElemTy.getIntOrFloatBitWidth() == 8 ||
       rhsElemTy.getIntOrFloatBitWidth() == 8) {
-    LDBG("Drop candidate. FP8 input is not supported.");
+    LDBG("Drop candidate. Unsupported FP8 input.");
     return false;
   }
 
@@ -127,10 +173,12 @@ bool checkElemTypesOneDNN(Type lhsElemTy, Type rhsElemTy, Type accElemTy,
 
 bool checkElemTypesXSMM(Type lhsElemTy, Type rhsElemTy, Type accElemTy,
                         Type resElemTy) {
-  // Integer types are not supported yet.
+  if (isInt8Dot(lhsElemTy, rhsElemTy, accElemTy, resElemTy) ||
+      isFp8Dot(lhsElemTy, rhsElemTy, accElemTy, resElemTy))
+    return true;
+
   if (lhsElemTy.isInteger() || rhsElemTy.isInteger() || resElemTy.isInteger()) {
-    // TODO: Add integer support.
-    LDBG("Drop candidate. Integer types are not supported.");
+    LDBG("Drop candidate. Only s8 x s8 -> s32 integer dot is supported.");
     return false;
   }
 
@@ -147,11 +195,10 @@ bool checkElemTypesXSMM(Type lhsElemTy, Type rhsElemTy, Type accElemTy,
     return false;
   }
 
-  // FP8 input is not supported yet.
-  // TODO: Enable 8-bit support
+  // Other FP8 inputs are not supported.
   if (lhsElemTy.getIntOrFloatBitWidth() == 8 ||
       rhsElemTy.getIntOrFloatBitWidth() == 8) {
-    LDBG("Drop candidate. FP8 input is not supported.");
+    LDBG("Drop candidate. Unsupported FP8 input.");
     return false;
   }
 
@@ -208,6 +255,157 @@ bool checkInputShapes(VectorType lhsTy, VectorType resTy,
   return false;
 }
 
+// Get the value of a floating point splat constant.
+std::optional<float> getSplatFloat(Value val) {
+  DenseElementsAttr attr;
+  if (!getElementTypeOrSelf(val).isF32() ||
+      !matchPattern(val, m_Constant(&attr)) || !attr.isSplat())
+    return std::nullopt;
+  return attr.getSplatValue<APFloat>().convertToFloat();
+}
+
+bool isSplatFloat(Value val, float expected) {
+  auto splat = getSplatFloat(val);
+  return splat && *splat == expected;
+}
+
+// Get the operand of a binary operation other than val.
+Value getOtherOperand(Operation *op, Value val) {
+  return op->getOperand(0) == val ? op->getOperand(1) : op->getOperand(0);
+}
+
+Operation *getSingleUser(Value val) {
+  return val.hasOneUse() ? *val.getUsers().begin() : nullptr;
+}
+
+// Match x * (1 / (1 + exp(-x))), which is how x * tl.sigmoid(x) reaches
+// this pass. Return the final multiplication and add matched operations
+// to ops.
+Operation *matchSilu(Value x, SmallVectorImpl<Operation *> &ops) {
+  if (!llvm::hasNItems(x.getUses(), 2))
+    return nullptr;
+
+  Operation *negOp = nullptr;
+  Operation *mulOp = nullptr;
+  for (Operation *user : x.getUsers()) {
+    if (isa<arith::NegFOp>(user) ||
+        (isa<arith::SubFOp>(user) && user->getOperand(1) == x &&
+         isSplatFloat(user->getOperand(0), 0.0f)))
+      negOp = user;
+    else if (isa<arith::MulFOp>(user))
+      mulOp = user;
+  }
+  if (!negOp || !mulOp)
+    return nullptr;
+
+  auto expOp =
+      dyn_cast_or_null<math::ExpOp>(getSingleUser(negOp->getResult(0)));
+  if (!expOp)
+    return nullptr;
+  auto addOp =
+      dyn_cast_or_null<arith::AddFOp>(getSingleUser(expOp.getResult()));
+  if (!addOp || !isSplatFloat(getOtherOperand(addOp, expOp.getResult()), 1.0f))
+    return nullptr;
+  auto divOp =
+      dyn_cast_or_null<arith::DivFOp>(getSingleUser(addOp.getResult()));
+  if (!divOp || divOp.getRhs() != addOp.getResult() ||
+      !isSplatFloat(divOp.getLhs(), 1.0f) ||
+      getSingleUser(divOp.getResult()) != mulOp)
+    return nullptr;
+
+  ops.append({negOp, expOp, addOp, divOp, mulOp});
+  return mulOp;
+}
+
+// Check if the loop result is only used by a chain of elementwise operations
+// that can be applied as ukernel post-ops and the final unmasked store.
+bool findEpilogue(Value val, UkernelEpilogue &epilogue) {
+  if (!getElementTypeOrSelf(val).isF32())
+    return false;
+
+  bool truncated = false;
+  while (true) {
+    if (!truncated && epilogue.postOps.size() < BRGEMM_MAX_POST_OPS) {
+      if (Operation *mulOp = matchSilu(val, epilogue.ops)) {
+        LDBG("  Found swish post-op.");
+        epilogue.postOps.push_back("swish");
+        epilogue.alphas.push_back(1.0f);
+        epilogue.betas.push_back(0.0f);
+        val = mulOp->getResult(0);
+        continue;
+      }
+    }
+
+    Operation *user = getSingleUser(val);
+    if (!user)
+      return false;
+
+    if (auto store = dyn_cast<vector::TransferWriteOp>(user)) {
+      if (store.getVector() != val || hasMaskOrBoundsCheck(store) ||
+          !isa<MemRefType>(store.getShapedType()) ||
+          !store.getPermutationMap().isMinorIdentity())
+        return false;
+      // Nothing to fuse into a plain store of the accumulator.
+      if (epilogue.ops.empty())
+        return false;
+      epilogue.store = store;
+      return true;
+    }
+
+    // Only the final store can follow the downcast.
+    if (truncated)
+      return false;
+
+    if (auto truncOp = dyn_cast<arith::TruncFOp>(user)) {
+      Type elemTy = getElementTypeOrSelf(truncOp.getType());
+      if (!elemTy.isBF16() && !elemTy.isF16())
+        return false;
+      LDBG("  Found result downcast to " << elemTy);
+      truncated = true;
+    } else {
+      if (epilogue.postOps.size() == BRGEMM_MAX_POST_OPS)
+        return false;
+
+      Value other = getOtherOperand(user, val);
+      if (isa<arith::MulFOp>(user) && getSplatFloat(other)) {
+        LDBG("  Found scaling post-op.");
+        epilogue.postOps.push_back("linear");
+        epilogue.alphas.push_back(*getSplatFloat(other));
+        epilogue.betas.push_back(0.0f);
+      } else if (isa<arith::AddFOp>(user) && getSplatFloat(other)) {
+        LDBG("  Found shift post-op.");
+        epilogue.postOps.push_back("linear");
+        epilogue.alphas.push_back(1.0f);
+        epilogue.betas.push_back(*getSplatFloat(other));
+      } else if (isa<arith::MaximumFOp, arith::MaxNumFOp>(user) &&
+                 isSplatFloat(other, 0.0f)) {
+        LDBG("  Found relu post-op.");
+        epilogue.postOps.push_back("relu");
+        epilogue.alphas.push_back(0.0f);
+        epilogue.betas.push_back(0.0f);
+      } else {
+        return false;
+      }
+    }
+
+    epilogue.ops.push_back(user);
+    val = user->getResult(0);
+  }
+}
+
+// Check if the loop computing the dot can be moved to the store of its
+// post-processed result.
+bool canMoveLoopToStore(scf::ForOp forOp, Operation *store) {
+  if (store->getBlock() != forOp->getBlock())
+    return false;
+  for (Operation *op = forOp->getNextNode(); op != store;
+       op = op->getNextNode()) {
+    if (!isMemoryEffectFree(op))
+      return false;
+  }
+  return true;
+}
+
 // Check if specified ContractionOp can be lowered to a ukernel operations.
 // If conversion is possible, then true is returned and candidate
 // structure is filled with detailed transformation info.
@@ -254,6 +452,16 @@ bool isUkernelsCandidate(triton::cpu::DotOp op, DotOpCandidate &candidate,
     auto forOp = dyn_cast<scf::ForOp>(op->getParentOp());
     candidate.canFuseLoop = isLoopInvariant(valsToCheckInvariance, forOp);
   }
+
+  // Post-ops are only supported by OneDNN ukernels.
+  if (candidate.canFuseLoop && ukernel == Ukernels::OneDNN) {
+    auto forOp = cast<scf::ForOp>(op->getParentOp());
+    int64_t resIdx = op.getResult().getUses().begin()->getOperandNumber();
+    UkernelEpilogue epilogue;
+    if (findEpilogue(forOp.getResult(resIdx), epilogue) &&
+        canMoveLoopToStore(forOp, epilogue.store))
+      candidate.epilogue = epilogue;
+  }
   return true;
 }
 
@@ -377,6 +585,10 @@ convertCandidate(DotOpCandidate &candidate, Ukernels ukernels,
   Location loc = op.getLoc();
   VectorType resTy = cast<VectorType>(op.getResult().getType());
   Type resElemTy = resTy.getElementType();
+  // Integer dots accumulate in INT32, others in FP32.
+  Type accElemTy =
+      resElemTy.isInteger() ? rewriter.getI32Type() : rewriter.getF32Type();
+  auto accBufTy = resTy.cloneWith(std::nullopt, accElemTy);
 
   scf::ForOp forOp = dyn_cast<scf::ForOp>(op->getParentOp());
   Value numBatches = index_cst(1);
@@ -387,7 +599,11 @@ convertCandidate(DotOpCandidate &candidate, Ukernels ukernels,
     // used within the loop. Later, new iter values will be added to
     // add loop carried-dependencies for accumulator tiles and accInitTiles
     // will be used as initializers for them.
-    rewriter.setInsertionPoint(forOp);
+    // With a fused epilogue, the ukernel call replaces the final store.
+    if (candidate.epilogue.store)
+      rewriter.setInsertionPoint(candidate.epilogue.store);
+    else
+      rewriter.setInsertionPoint(forOp);
     auto memrefsFromBlockPtr =
         extractBufferFromBlockPtr(candidate.lhsBuf.origBlockPtr, candidate.op,
                                   shapeInfoAnalysis, rewriter);
@@ -441,8 +657,7 @@ convertCandidate(DotOpCandidate &candidate, Ukernels ukernels,
       LDBG("String Setting insertion op to forOp. (accBuf)");
       rewriter.setInsertionPoint(forOp);
     }
-    // Currently, acc always needs to be FP32.
-    accToStore = maybeCast(loc, accToStore, rewriter.getF32Type(), rewriter);
+    accToStore = maybeCast(loc, accToStore, accElemTy, rewriter);
     accBuf = storeToTmpBuffer(loc, accToStore, allocaPoint, rewriter);
   }
   bool isPackingRequired =
@@ -481,10 +696,33 @@ convertCandidate(DotOpCandidate &candidate, Ukernels ukernels,
   bool skipPacking = !isPackingRequired || candidate.rhsBuf.vnni;
   auto skipPack = int_cst(rewriter.getI1Type(), skipPacking);
 
+  const UkernelEpilogue &epilogue = candidate.epilogue;
+  Value dSubView;
+  Value ldd;
+  TypeAttr dtypeD;
+  ArrayAttr postOps;
+  ArrayAttr postOpAlphas;
+  ArrayAttr postOpBetas;
+  if (epilogue.store) {
+    auto dVecTy = epilogue.store.getVectorType();
+    dSubView = addMemrefSubView(rewriter, loc, dVecTy,
+                                epilogue.store.getIndices(),
+                                epilogue.store.getSource());
+    auto metadataD =
+        rewriter.create<memref::ExtractStridedMetadataOp>(loc, dSubView);
+    ldd = metadataD.getStrides()[metadataD.getStrides().size() - 2];
+    dtypeD = TypeAttr::get(dVecTy);
+    postOps = rewriter.getStrArrayAttr(epilogue.postOps);
+    postOpAlphas = rewriter.getF32ArrayAttr(epilogue.alphas);
+    postOpBetas = rewriter.getF32ArrayAttr(epilogue.betas);
+  }
+
   Value brgemm = rewriter.create<triton::cpu::BrgemmCreate>(
       loc, rewriter.getIndexType(), blockM, blockN, blockK, numBatches, lda,
-      ldb, ldc, lhsStepInBytes, rhsStepInBytes, op.getA().getType(),
-      op.getB().getType(), rewriter.getF32Type(), skipPack);
+      ldb, ldc, lhsStepInBytes, rhsStepInBytes,
+      TypeAttr::get(op.getA().getType()), TypeAttr::get(op.getB().getType()),
+      TypeAttr::get(accElemTy), skipPack, ldd, dtypeD, postOps,
+      postOpAlphas, postOpBetas);
   auto rhsTypeSize = int_cst(rewriter.getI64Type(),
                              op.getB().getType().getElementTypeBitWidth() / 8);
   Value rhsBlockSizeInBytes = op_muli(op_muli(blockN, blockK), rhsTypeSize);
@@ -503,14 +741,45 @@ convertCandidate(DotOpCandidate &candidate, Ukernels ukernels,
        << "          blockptr " << candidate.rhsBuf.origBlockPtr << "\n"
        << "        transposed " << candidate.rhsBuf.transposed << "\n} \n");
 
-  rewriter.create<triton::cpu::BrgemmExecute>(
-      loc, brgemm, lhsSubView, rhsSubView, accBuf.memRef, lhsStepInBytes,
-      rhsStepInBytes, rhsBlockSizeInBytes, numBatches, skipPack);
+  if (epilogue.store) {
+    // Post-ops are applied by the ukernel to the final accumulator only, so
+    // the epilogue is still applied here when the loop has no iterations.
+    Value hasBatches = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::sgt, numBatches, index_cst(0));
+    auto ifOp = rewriter.create<scf::IfOp>(loc, hasBatches,
+                                           /*withElseRegion=*/true);
+    {
+      OpBuilder::InsertionGuard g(rewriter);
+      rewriter.setInsertionPointToStart(ifOp.thenBlock());
+      rewriter.create<triton::cpu::BrgemmExecute>(
+          loc, brgemm, lhsSubView, rhsSubView, accBuf.memRef, lhsStepInBytes,
+          rhsStepInBytes, rhsBlockSizeInBytes, numBatches, skipPack,
+          dSubView);
+
+      rewriter.setInsertionPointToStart(ifOp.elseBlock());
+      Value initAcc = op_read(accBufTy, accBuf.memRef, accBuf.indices);
+      int64_t resIdx = op.getResult().getUses().begin()->getOperandNumber();
+      IRMapping mapping;
+      mapping.map(forOp.getResult(resIdx), initAcc);
+      for (Operation *epilogueOp : epilogue.ops)
+        rewriter.clone(*epilogueOp, mapping);
+      rewriter.clone(*epilogue.store, mapping);
+    }
+    rewriter.setInsertionPointAfter(ifOp);
+
+    rewriter.eraseOp(epilogue.store);
+    for (Operation *epilogueOp : llvm::reverse(epilogue.ops))
+      rewriter.eraseOp(epilogueOp);
+  } else {
+    rewriter.create<triton::cpu::BrgemmExecute>(
+        loc, brgemm, lhsSubView, rhsSubView, accBuf.memRef, lhsStepInBytes,
+        rhsStepInBytes, rhsBlockSizeInBytes, numBatches, skipPack,
+        /*D_ptr=*/Value());
+  }
 
   if (candidate.isAccLoopCarried && candidate.canFuseLoop) {
     LDBG("Loading the result to a vector to replace orig op result.");
-    Value newVal =
-        op_read(cast<VectorType>(toFp32(resTy)), accBuf.memRef, accBuf.indices);
+    Value newVal = op_read(accBufTy, accBuf.memRef, accBuf.indices);
 
     // Hope that dead code elemination do the rest.
     rewriter.replaceOp(candidate.op, candidate.op.getC());
@@ -527,8 +796,7 @@ convertCandidate(DotOpCandidate &candidate, Ukernels ukernels,
     rewriter.setInsertionPointAfter(forOp);
     auto rank = dyn_cast<MemRefType>(accBuf.memRef.getType()).getRank();
     SmallVector<bool, 4> inBounds(rank, false);
-    Value newVal =
-        op_read(cast<VectorType>(toFp32(resTy)), accBuf.memRef, accBuf.indices);
+    Value newVal = op_read(accBufTy, accBuf.memRef, accBuf.indices);
     // We might need to cast back to the original type.
     newVal = maybeCast(loc, newVal, resElemTy, rewriter);
     int resIdx = op.getResult().getUses().begin()->getOperandNumber();
@@ -538,8 +806,9 @@ convertCandidate(DotOpCandidate &candidate, Ukernels ukernels,
     return success();
   }
   LDBG("Loading the result to a vector to replace orig op result.");
-  Value newVal = rewriter.create<vector::TransferReadOp>(
-      loc, cast<VectorType>(toFp32(resTy)), accBuf.memRef, accBuf.indices);
+  Value newVal = rewriter.create<vector::TransferReadOp>(loc, accBufTy,
+                                                        accBuf.memRef,
+                                                        accBuf.indices);
   // We might need to cast back to the original type.
   newVal = maybeCast(loc, newVal, resElemTy, rewriter);
   op.getResult().replaceAllUsesWith(newVal);
@@ -557,8 +826,6 @@ struct ConvertDotOpToUkernelOps
     MLIRContext *context = &getContext();
     ModuleOp mod = getOperation();
 
-    ModuleTensorPtrShapeInfoAnalysis shapeInfoAnalysis(mod);
-
     SmallVector<DotOpCandidate, 2> candidates;
     mod->walk([&candidates, this](triton::cpu::DotOp op) {
       DotOpCandidate candidate;
@@ -577,6 +844,14 @@ struct ConvertDotOpToUkernelOps
       return WalkResult::advance();
     });
 
+    // Kernels without candidates are left unchanged, so the shape analysis
+    // is only computed when there is something to convert.
+    if (candidates.empty()) {
+      markAllAnalysesPreserved();
+      return;
+    }
+
+    auto &shapeInfoAnalysis = getAnalysis<ModuleTensorPtrShapeInfoAnalysis>();
     for (auto &candidate : candidates) {
       LDBG("Starting conversion of candidate: " << candidate.op);
       PatternRewriter rewriter(context);
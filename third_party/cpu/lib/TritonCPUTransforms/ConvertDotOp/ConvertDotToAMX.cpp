@@ -12,6 +12,7 @@
 #include "include/triton/Analysis/Utility.h"
 #include "triton/Dialect/Triton/IR/Dialect.h"
 #include "triton/Dialect/TritonCPU/IR/Dialect.h"
+#include "llvm/ADT/MapVector.h"
 #include <iostream>
 #include <utility>
 
@@ -68,13 +69,24 @@ struct AmxDotOpCandidate {
   Operation *origStore = nullptr;
 };
 
+// FP8 formats multiplied by AMX-FP8: bf8 (E5M2) and hf8 (E4M3).
+bool isAmxFp8Type(Type elemTy) {
+  return isa<Float8E5M2Type, Float8E4M3FNType>(elemTy);
+}
+
+// AMX-FP8 tiles hold raw bytes of FP8 inputs.
+bool isFp8Tile(Type tileElemTy, Type elemTy) {
+  return tileElemTy.isInteger(8) && isa<FloatType>(elemTy);
+}
+
 // Check if input and output types can be handled by AMX (possibly, using
 // additional casts for input/output). Returns true if AMX usage is possible.
 // In this case, tile element type fields of the candidate structure are
 // filled with actual types to be used in lowering.
 bool checkElemTypes(Type lhsElemTy, Type rhsElemTy, Type accElemTy,
                     Type resElemTy, bool supportInt8, bool supportFp16,
-                    bool supportBf16, AmxDotOpCandidate &candidate) {
+                    bool supportBf16, bool supportFp8,
+                    AmxDotOpCandidate &candidate) {
   MLIRContext *ctx = lhsElemTy.getContext();
   if (lhsElemTy.isInteger()) {
     if (!supportInt8) {
@@ -108,6 +120,16 @@ bool checkElemTypes(Type lhsElemTy, Type rhsElemTy, Type accElemTy,
     return false;
   }
 
+  // AMX-FP8 multiplies FP8 tiles directly into FP32 accumulators, the
+  // instruction picks the FP8 formats of the inputs.
+  if (supportFp8 && isAmxFp8Type(lhsElemTy) && isAmxFp8Type(rhsElemTy) &&
+      accElemTy.isF32()) {
+    candidate.lhsTileElemTy = IntegerType::get(ctx, 8);
+    candidate.rhsTileElemTy = IntegerType::get(ctx, 8);
+    candidate.accTileElemTy = Float32Type::get(ctx);
+    return true;
+  }
+
   // For fp case LHS and RHS types should match and can be either FP16 or
   // BF16.
   if (lhsElemTy.getIntOrFloatBitWidth() > 16 ||
@@ -116,8 +138,8 @@ bool checkElemTypes(Type lhsElemTy, Type rhsElemTy, Type accElemTy,
     return false;
   }
 
-  // Try to find a common input type. There is currently no support
-  // for FP8 types, so promote them to FP16/BF16.
+  // Try to find a common input type. Other FP8 inputs are promoted to
+  // FP16/BF16.
   Type commonInputElemTy;
   if (lhsElemTy.getIntOrFloatBitWidth() == 16) {
     commonInputElemTy = lhsElemTy;
@@ -179,12 +201,30 @@ Value getResValueForLoopCarriedAcc(cpu::DotOp op) {
   return forOp.getResult(use.getOperandNumber());
 }
 
+// Number of tiles used to multiply an accumulator block of the specified size
+// with a preloaded smaller side of input blocks.
+int64_t getUsedTiles(int64_t tilesInBlockM, int64_t tilesInBlockN) {
+  return tilesInBlockM * tilesInBlockN +
+         std::min(tilesInBlockM, tilesInBlockN) + 1;
+}
+
+// Check if the accumulator block fits into tile registers and evenly splits
+// the accumulator.
+bool isValidAccBlock(int64_t tilesInBlockM, int64_t tilesInBlockN,
+                     int64_t accTilesM, int64_t accTilesN) {
+  constexpr int64_t numTileRegs = 8;
+  return tilesInBlockM > 0 && tilesInBlockN > 0 &&
+         accTilesM % tilesInBlockM == 0 && accTilesN % tilesInBlockN == 0 &&
+         getUsedTiles(tilesInBlockM, tilesInBlockN) <= numTileRegs;
+}
+
 // Choose tile and block sizes for the candidate. Tile sizes are determined
-// by input shapes and types. Block sizes are chosen to minimize number of
-// tile loads/stores including tile register spills.
+// by input shapes and types. Unless block sizes are specified, they are
+// chosen to minimize number of tile loads/stores including tile register
+// spills.
 void setupBlockAndTileSizes(ArrayRef<int64_t> lhsShape,
-                            ArrayRef<int64_t> resShape,
-                            AmxDotOpCandidate &candidate) {
+                            ArrayRef<int64_t> resShape, int64_t accBlockM,
+                            int64_t accBlockN, AmxDotOpCandidate &candidate) {
   int64_t m = resShape[0];
   int64_t n = resShape[1];
   int64_t k = lhsShape[1];
@@ -193,24 +233,44 @@ void setupBlockAndTileSizes(ArrayRef<int64_t> lhsShape,
   int64_t tileK = std::min(
       k, (int64_t)512 / candidate.lhsTileElemTy.getIntOrFloatBitWidth());
 
-  int64_t accBlocksM = m / tileM;
-  int64_t accBlocksN = n / tileN;
-
-  // All these sizes are power of 2. We have 8 tile registers and
-  // cannot use them all for accumulator. So, we will use up to 4
-  // tiles for accumulator in a single block.
-  while (accBlocksM * accBlocksN > 4) {
-    if (accBlocksM > accBlocksN)
-      accBlocksM /= 2;
-    else
-      accBlocksN /= 2;
-  }
+  int64_t accTilesM = m / tileM;
+  int64_t accTilesN = n / tileN;
 
   candidate.tileM = tileM;
   candidate.tileN = tileN;
   candidate.tileK = tileK;
-  candidate.tilesInBlockM = accBlocksM;
-  candidate.tilesInBlockN = accBlocksN;
+
+  if (accBlockM || accBlockN) {
+    if (isValidAccBlock(accBlockM, accBlockN, accTilesM, accTilesN)) {
+      candidate.tilesInBlockM = accBlockM;
+      candidate.tilesInBlockN = accBlockN;
+      return;
+    }
+    LDBG("Ignore accumulator block " << accBlockM << "x" << accBlockN
+                                     << " that doesn't fit tiles.");
+  }
+
+  // All these sizes are power of 2. Each block reloads input tiles for the
+  // whole K dimension, so the number of tile loads is proportional to
+  // 1 / tilesInBlockM + 1 / tilesInBlockN. Prefer blocks covering the whole
+  // accumulator on ties as they can keep it on tiles in loops.
+  candidate.tilesInBlockM = 1;
+  candidate.tilesInBlockN = 1;
+  double bestCost = 2.0;
+  for (int64_t blockM = 1; blockM <= accTilesM; blockM *= 2) {
+    for (int64_t blockN = 1; blockN <= accTilesN; blockN *= 2) {
+      if (!isValidAccBlock(blockM, blockN, accTilesM, accTilesN))
+        continue;
+      double cost = 1.0 / blockM + 1.0 / blockN;
+      if (cost < bestCost ||
+          (cost == bestCost && blockM * blockN > candidate.tilesInBlockM *
+                                                     candidate.tilesInBlockN)) {
+        bestCost = cost;
+        candidate.tilesInBlockM = blockM;
+        candidate.tilesInBlockN = blockN;
+      }
+    }
+  }
 }
 
 // Check if a value is used only for a store and that this store can be
@@ -225,11 +285,41 @@ void findOutputBuffer(Value val, AmxDotOpCandidate &candidate) {
   }
 }
 
+// Choose where the accumulator lives between iterations of the loop carrying
+// it. Depends on the chosen block sizes.
+void setupAccPlacement(AmxDotOpCandidate &candidate) {
+  cpu::DotOp op = candidate.op;
+  VectorType resTy = cast<VectorType>(op.getType());
+  candidate.keepAccOnTiles = isLoopCarriedAcc(op.getC());
+  candidate.keepAccInBuf = false;
+  candidate.outBuf = MemBuffer();
+  candidate.origStore = nullptr;
+
+  // Can't keep acc in a tile the whole loop right now:
+  // https://github.com/llvm/llvm-project/issues/109481
+  if (candidate.keepAccOnTiles) {
+    // We might not have enough tiles to hold the whole accumulator. If we
+    // have more than one block, keep it in a bufffer.
+    if (candidate.tilesInBlockM * candidate.tileM < resTy.getDimSize(0) ||
+        candidate.tilesInBlockN * candidate.tileN < resTy.getDimSize(1)) {
+      LDBG("Accumulator is too big to keep on tiles. Keep it bufferized "
+           "insterad.");
+      candidate.keepAccOnTiles = false;
+      candidate.keepAccInBuf = true;
+    } else {
+      findOutputBuffer(getResValueForLoopCarriedAcc(op), candidate);
+    }
+  } else {
+    findOutputBuffer(op.getResult(), candidate);
+  }
+}
+
 // Check if specified ContractionOp can be lowered to AMX operations.
 // If conversion is possible, then true is returned and candidate
 // structure is filled with detailed transformation info.
 bool isAmxCandidate(cpu::DotOp op, bool supportInt8, bool supportFp16,
-                    bool supportBf16, AmxDotOpCandidate &candidate) {
+                    bool supportBf16, bool supportFp8, int64_t accBlockM,
+                    int64_t accBlockN, AmxDotOpCandidate &candidate) {
   MLIRContext *ctx = op.getContext();
   VectorType lhsTy = cast<VectorType>(op.getA().getType());
   VectorType rhsTy = cast<VectorType>(op.getB().getType());
@@ -243,36 +333,104 @@ bool isAmxCandidate(cpu::DotOp op, bool supportInt8, bool supportFp16,
   // to use in AMX operations.
   if (!checkElemTypes(lhsTy.getElementType(), rhsTy.getElementType(),
                       accTy.getElementType(), resTy.getElementType(),
-                      supportInt8, supportFp16, supportBf16, candidate))
+                      supportInt8, supportFp16, supportBf16, supportFp8,
+                      candidate))
     return false;
 
+  // FP8 tiles are copied from memory as raw bytes, so both inputs have to be
+  // read from memory. Otherwise, they are promoted to BF16/FP16.
+  if (isFp8Tile(candidate.lhsTileElemTy, lhsTy.getElementType()) &&
+      (findInputBuffer(op.getA()).empty() ||
+       findInputBuffer(op.getB()).empty())) {
+    LDBG("Promote FP8 inputs that aren't read from memory.");
+    if (!checkElemTypes(lhsTy.getElementType(), rhsTy.getElementType(),
+                        accTy.getElementType(), resTy.getElementType(),
+                        supportInt8, supportFp16, supportBf16, false,
+                        candidate))
+      return false;
+  }
+
   // Check input shapes.
   if (!checkInputShapes(lhsTy, resTy))
     return false;
 
   candidate.op = op;
-  setupBlockAndTileSizes(lhsTy.getShape(), resTy.getShape(), candidate);
-  candidate.keepAccOnTiles = isLoopCarriedAcc(op.getC());
+  setupBlockAndTileSizes(lhsTy.getShape(), resTy.getShape(), accBlockM,
+                         accBlockN, candidate);
+  setupAccPlacement(candidate);
 
-  // Can't keep acc in a tile the whole loop right now:
-  // https://github.com/llvm/llvm-project/issues/109481
-  if (candidate.keepAccOnTiles) {
-    // We might not have enough tiles to hold the whole accumulator. If we
-    // have more than one block, keep it in a bufffer.
-    if (candidate.tilesInBlockM * candidate.tileM < resTy.getDimSize(0) ||
-        candidate.tilesInBlockN * candidate.tileN < resTy.getDimSize(1)) {
-      LDBG("Accumulator is too big to keep on tiles. Keep it bufferized "
-           "insterad.");
-      candidate.keepAccOnTiles = false;
-      candidate.keepAccInBuf = true;
-    } else {
-      findOutputBuffer(getResValueForLoopCarriedAcc(op), candidate);
-    }
-  } else {
-    findOutputBuffer(op.getResult(), candidate);
+  return true;
+}
+
+// AMX tile configuration entry, i.e. the number of rows and the number of
+// bytes in a row.
+using TileShape = std::pair<int64_t, int64_t>;
+
+// Count tile registers simultaneously used by the candidate for each tile
+// shape.
+void getUsedTileShapes(const AmxDotOpCandidate &candidate,
+                       DenseMap<TileShape, int64_t> &res) {
+  int64_t lhsBits = candidate.lhsTileElemTy.getIntOrFloatBitWidth();
+  int64_t rhsBits = candidate.rhsTileElemTy.getIntOrFloatBitWidth();
+  TileShape lhsShape{candidate.tileM, candidate.tileK * lhsBits / 8};
+  TileShape rhsShape{candidate.tileK * rhsBits / 32, candidate.tileN * 4};
+  TileShape accShape{candidate.tileM, candidate.tileN * 4};
+  int64_t blockM = candidate.tilesInBlockM;
+  int64_t blockN = candidate.tilesInBlockN;
+  res[accShape] += blockM * blockN;
+  res[lhsShape] += blockM <= blockN ? blockM : 1;
+  res[rhsShape] += blockM <= blockN ? 1 : blockN;
+}
+
+int64_t getUsedTileRegs(ArrayRef<AmxDotOpCandidate *> candidates) {
+  DenseMap<TileShape, int64_t> maxUsed;
+  for (auto *candidate : candidates) {
+    DenseMap<TileShape, int64_t> used;
+    getUsedTileShapes(*candidate, used);
+    for (auto &entry : used)
+      maxUsed[entry.first] = std::max(maxUsed[entry.first], entry.second);
   }
+  int64_t res = 0;
+  for (auto &entry : maxUsed)
+    res += entry.second;
+  return res;
+}
 
-  return true;
+// The tile configuration is loaded once per function by the X86 backend and
+// it binds each tile register to a single shape. Dot regions using the same
+// tile shapes share registers, while registers used for different shapes
+// are not interchangeable. If the function as a whole needs more registers
+// than available, the backend would spill tiles and reload the configuration
+// between regions. Avoid it by shrinking the largest accumulator blocks
+// until all regions fit a single configuration.
+void shareTileConfig(ArrayRef<AmxDotOpCandidate *> candidates) {
+  constexpr int64_t numTileRegs = 8;
+  int64_t usedRegs = getUsedTileRegs(candidates);
+  while (usedRegs > numTileRegs) {
+    AmxDotOpCandidate *largest = nullptr;
+    for (auto *candidate : candidates) {
+      int64_t blockSize = candidate->tilesInBlockM * candidate->tilesInBlockN;
+      if (blockSize > 1 &&
+          (!largest ||
+           blockSize > largest->tilesInBlockM * largest->tilesInBlockN))
+        largest = candidate;
+    }
+    if (!largest) {
+      LDBG("Cannot fit " << usedRegs << " tile registers in one config.");
+      return;
+    }
+    // Block sizes are powers of 2 here, so halved blocks still evenly split
+    // the accumulator.
+    if (largest->tilesInBlockM >= largest->tilesInBlockN)
+      largest->tilesInBlockM /= 2;
+    else
+      largest->tilesInBlockN /= 2;
+    LDBG("Shrink accumulator block to "
+         << largest->tilesInBlockM << "x" << largest->tilesInBlockN
+         << " to share tile config: " << largest->op);
+    setupAccPlacement(*largest);
+    usedRegs = getUsedTileRegs(candidates);
+  }
 }
 
 // In AMX, element values shoud be packed to 32-bit groups that would be
@@ -420,6 +578,44 @@ MemBuffer prepareTensorBuffer(Location loc, Value val, bool interleave,
   return buf;
 }
 
+// Memory input tiles are loaded from. Tiles of FP8 inputs read from memory
+// are converted row by row in vector registers and written to a tile-sized
+// staging buffer right before each tile load, so the input is never
+// converted or repacked as a whole.
+struct TileInput {
+  MemBuffer buf;
+  // Staging buffer for converted tiles, if any.
+  MemBuffer staging;
+  // Element type of the input in memory.
+  Type elemTy;
+  bool interleave = false;
+};
+
+TileInput prepareTileInput(Location loc, Value val, amx::TileType tileTy,
+                           bool interleave, Operation *allocaPoint,
+                           PatternRewriter &rewriter) {
+  Type elemTy = getElementTypeOrSelf(val.getType());
+  TileInput input{{}, {}, elemTy, interleave};
+  if (elemTy.getIntOrFloatBitWidth() == 8 && isa<FloatType>(elemTy)) {
+    MemBuffer src = findInputBuffer(val);
+    if (!src.empty()) {
+      LDBG("Converting FP8 tiles from the original memref: " << src.memRef);
+      input.buf = src;
+      input.staging = allocateTmpBufferStack(
+          loc, VectorType::get(tileTy.getShape(), tileTy.getElementType()),
+          allocaPoint, rewriter);
+      return input;
+    }
+  }
+
+  // Cast input data if required and prepare input buffer. It might be a
+  // temporary buffer with stored vectors or the original input memory.
+  Value casted = maybeCast(loc, val, tileTy.getElementType(), rewriter);
+  input.buf = prepareTensorBuffer(loc, casted, interleave, false, true,
+                                  allocaPoint, rewriter);
+  return input;
+}
+
 // Return a buffer where the final result should be stored. If result can
 // be directly stored to the output memory, then it is used as an output
 // buffer. Otherwise, re-use accumulator buffer or create a new one.
@@ -476,6 +672,60 @@ void storeTile(Location loc, amx::TileType tileTy, Value val,
   rewriter.create<amx::TileStoreOp>(loc, buf.memRef, indices, val);
 }
 
+// Load an input tile. Tiles with a staging buffer are read from the original
+// memory row by row, converted to the tile element type and, for RHS, packed
+// like in interleaveAndStore.
+Value loadInputTile(Location loc, amx::TileType tileTy, const TileInput &input,
+                    int64_t tilesInBlockM, int64_t tilesInBlockN,
+                    int64_t blockM, int64_t blockN, int64_t tileM,
+                    int64_t tileN, PatternRewriter &rewriter) {
+  if (input.staging.empty())
+    return loadTile(loc, tileTy, input.buf, tilesInBlockM, tilesInBlockN,
+                    blockM, blockN, tileM, tileN, rewriter);
+
+  // Shape of the tile in the original memory.
+  Type tileElemTy = tileTy.getElementType();
+  int64_t rowsPerGroup =
+      input.interleave ? 32 / tileElemTy.getIntOrFloatBitWidth() : 1;
+  int64_t rows = tileTy.getDimSize(0) * rowsPerGroup;
+  int64_t cols = tileTy.getDimSize(1) / rowsPerGroup;
+  auto srcTileTy =
+      amx::TileType::get(SmallVector<int64_t>({rows, cols}), tileElemTy);
+  auto indices =
+      shiftIndices(loc, input.buf.indices, srcTileTy, tilesInBlockM,
+                   tilesInBlockN, blockM, blockN, tileM, tileN, rewriter);
+
+  auto srcRowTy = VectorType::get({cols}, input.elemTy);
+  auto rowTy = VectorType::get({cols}, tileElemTy);
+  auto readRow = [&](int64_t row) -> Value {
+    SmallVector<Value> rowIndices = indices;
+    Value &rowIdx = rowIndices[rowIndices.size() - 2];
+    rowIdx = shiftIndex(loc, rowIdx, row, rewriter);
+    Value val = op_read(srcRowTy, input.buf.memRef, rowIndices);
+    if (isFp8Tile(tileElemTy, input.elemTy))
+      return op_bitcast(rowTy, val);
+    return maybeCast(loc, val, tileElemTy, rewriter);
+  };
+
+  Value zeroIdx = index_cst(0);
+  for (int64_t row = 0; row < rows; row += rowsPerGroup) {
+    Value packed;
+    if (rowsPerGroup == 1) {
+      packed = readRow(row);
+    } else if (rowsPerGroup == 2) {
+      packed = op_interleave(readRow(row), readRow(row + 1));
+    } else {
+      Value row1 = op_interleave(readRow(row), readRow(row + 2));
+      Value row2 = op_interleave(readRow(row + 1), readRow(row + 3));
+      packed = op_interleave(row1, row2);
+    }
+    Value idx = index_cst(row / rowsPerGroup);
+    op_store(packed, input.staging.memRef, SmallVector<Value>({idx, zeroIdx}));
+  }
+  return rewriter.create<amx::TileLoadOp>(loc, tileTy, input.staging.memRef,
+                                          input.staging.indices);
+}
+
 SmallVector<SmallVector<Value>>
 loadBlockTiles(Location loc, amx::TileType tileTy, const MemBuffer &buf,
                int64_t tilesInBlockM, int64_t tilesInBlockN, int64_t blockM,
@@ -507,34 +757,91 @@ void storeBlockTiles(Location loc, amx::TileType tileTy, const MemBuffer &buf,
   }
 }
 
+// AMX-FP8 intrinsic multiplying tiles of the FP8 formats of LHS and RHS.
+StringRef getAmxFp8Intrinsic(Type lhsElemTy, Type rhsElemTy) {
+  bool lhsBf8 = isa<Float8E5M2Type>(lhsElemTy);
+  bool rhsBf8 = isa<Float8E5M2Type>(rhsElemTy);
+  if (lhsBf8)
+    return rhsBf8 ? "llvm.x86.tdpbf8ps.internal"
+                  : "llvm.x86.tdpbhf8ps.internal";
+  return rhsBf8 ? "llvm.x86.tdphbf8ps.internal" : "llvm.x86.tdphf8ps.internal";
+}
+
+// Multiply FP tiles and add the result to the accumulator tile. AMX dialect
+// lowers BF16 multiplication only, so FP16 and FP8 tiles are passed to the
+// AMX-FP16 and AMX-FP8 intrinsics directly with the same tile shape arguments
+// AMX dialect uses. The intrinsic for FP8 tiles is chosen by element types
+// of the inputs in memory.
+Value multiplyFpTiles(Location loc, amx::TileType accTileTy, Value lhsTile,
+                      Value rhsTile, Value accTile, Type lhsElemTy,
+                      Type rhsElemTy, PatternRewriter &rewriter) {
+  auto lhsTileTy = cast<amx::TileType>(lhsTile.getType());
+  Type tileElemTy = lhsTileTy.getElementType();
+  if (tileElemTy.isBF16())
+    return rewriter.create<amx::TileMulFOp>(loc, accTileTy, lhsTile, rhsTile,
+                                            accTile);
+
+  MLIRContext *ctx = rewriter.getContext();
+  Type amxTy = LLVM::LLVMX86AMXType::get(ctx);
+  auto toAmx = [&](Value tile) {
+    return rewriter.create<UnrealizedConversionCastOp>(loc, amxTy, tile)
+        .getResult(0);
+  };
+  auto i16Val = [&](int64_t val) -> Value {
+    return rewriter.create<LLVM::ConstantOp>(loc, rewriter.getI16Type(),
+                                             rewriter.getI16IntegerAttr(val));
+  };
+  // Rows of the accumulator and row sizes in bytes of the accumulator and
+  // LHS.
+  SmallVector<Value> args = {
+      i16Val(accTileTy.getDimSize(0)),
+      i16Val(accTileTy.getDimSize(1) * 4),
+      i16Val(lhsTileTy.getDimSize(1) * tileElemTy.getIntOrFloatBitWidth() / 8),
+      toAmx(accTile),
+      toAmx(lhsTile),
+      toAmx(rhsTile)};
+  auto intrinsic = StringAttr::get(
+      ctx, tileElemTy.isF16() ? StringRef("llvm.x86.tdpfp16ps.internal")
+                              : getAmxFp8Intrinsic(lhsElemTy, rhsElemTy));
+  auto callIntrOp = rewriter.create<LLVM::CallIntrinsicOp>(
+      loc, TypeRange{amxTy}, intrinsic, args,
+      LLVM::FastmathFlagsAttr::get(ctx, LLVM::FastmathFlags::none));
+  return rewriter
+      .create<UnrealizedConversionCastOp>(loc, accTileTy,
+                                          callIntrOp.getResult(0))
+      .getResult(0);
+}
+
 // Multiply two blocks. LHS block is preloaded to tiles with the following
 // iteration over RHS. Accumulator values are updated in accTiles.
 // Optionally, results can also be stored to accBuf.
 void multiplyBlocksPreloadLhs(Location loc, amx::TileType lhsTileTy,
                               amx::TileType rhsTileTy, amx::TileType accTileTy,
-                              const MemBuffer &lhsBuf, const MemBuffer &rhsBuf,
+                              const TileInput &lhs, const TileInput &rhs,
                               const MemBuffer &accBuf, int64_t blockM,
                               int64_t blockN, int64_t blockK,
                               int64_t tilesInBlockM, int64_t tilesInBlockN,
                               SmallVector<SmallVector<Value>> &accTiles,
                               bool storeResult, PatternRewriter &rewriter) {
   bool isInteger = accTileTy.getElementType().isInteger();
-  SmallVector<SmallVector<Value>> lhsTiles = loadBlockTiles(
-      loc, lhsTileTy, lhsBuf, tilesInBlockM, 1, blockM, blockK, rewriter);
+  SmallVector<Value> lhsTiles;
+  for (int64_t tileM = 0; tileM < tilesInBlockM; ++tileM)
+    lhsTiles.push_back(loadInputTile(loc, lhsTileTy, lhs, tilesInBlockM, 1,
+                                     blockM, blockK, tileM, 0, rewriter));
 
   for (int64_t tileN = 0; tileN < tilesInBlockN; ++tileN) {
-    Value rhsTile = loadTile(loc, rhsTileTy, rhsBuf, 1, tilesInBlockN, blockK,
-                             blockN, 0, tileN, rewriter);
+    Value rhsTile = loadInputTile(loc, rhsTileTy, rhs, 1, tilesInBlockN,
+                                  blockK, blockN, 0, tileN, rewriter);
 
     for (int64_t tileM = 0; tileM < tilesInBlockM; ++tileM) {
       if (isInteger)
         accTiles[tileM][tileN] =
-            rewriter.create<amx::TileMulIOp>(loc, accTileTy, lhsTiles[tileM][0],
+            rewriter.create<amx::TileMulIOp>(loc, accTileTy, lhsTiles[tileM],
                                              rhsTile, accTiles[tileM][tileN]);
       else
-        accTiles[tileM][tileN] =
-            rewriter.create<amx::TileMulFOp>(loc, accTileTy, lhsTiles[tileM][0],
-                                             rhsTile, accTiles[tileM][tileN]);
+        accTiles[tileM][tileN] = multiplyFpTiles(
+            loc, accTileTy, lhsTiles[tileM], rhsTile, accTiles[tileM][tileN],
+            lhs.elemTy, rhs.elemTy, rewriter);
 
       // Insert store here to better mix stores with multiplications.
       if (storeResult) {
@@ -548,29 +855,30 @@ void multiplyBlocksPreloadLhs(Location loc, amx::TileType lhsTileTy,
 // Similar to multiplyBlocksPreloadLhs but here RHS is preloaded to tiles.
 void multiplyBlocksPreloadRhs(Location loc, amx::TileType lhsTileTy,
                               amx::TileType rhsTileTy, amx::TileType accTileTy,
-                              const MemBuffer &lhsBuf, const MemBuffer &rhsBuf,
+                              const TileInput &lhs, const TileInput &rhs,
                               const MemBuffer &accBuf, int64_t blockM,
                               int64_t blockN, int64_t blockK,
                               int64_t tilesInBlockM, int64_t tilesInBlockN,
                               SmallVector<SmallVector<Value>> &accTiles,
                               bool storeResult, PatternRewriter &rewriter) {
   bool isInteger = accTileTy.getElementType().isInteger();
-  SmallVector<SmallVector<Value>> rhsTiles = loadBlockTiles(
-      loc, rhsTileTy, rhsBuf, 1, tilesInBlockN, blockK, blockN, rewriter);
+  SmallVector<Value> rhsTiles;
+  for (int64_t tileN = 0; tileN < tilesInBlockN; ++tileN)
+    rhsTiles.push_back(loadInputTile(loc, rhsTileTy, rhs, 1, tilesInBlockN,
+                                     blockK, blockN, 0, tileN, rewriter));
 
   for (int64_t tileM = 0; tileM < tilesInBlockM; ++tileM) {
-    Value lhsTile = loadTile(loc, lhsTileTy, lhsBuf, tilesInBlockM, 1, blockM,
-                             blockK, tileM, 0, rewriter);
+    Value lhsTile = loadInputTile(loc, lhsTileTy, lhs, tilesInBlockM, 1,
+                                  blockM, blockK, tileM, 0, rewriter);
 
     for (int64_t tileN = 0; tileN < tilesInBlockN; ++tileN) {
       if (isInteger)
         accTiles[tileM][tileN] = rewriter.create<amx::TileMulIOp>(
-            loc, accTileTy, lhsTile, rhsTiles[0][tileN],
-            accTiles[tileM][tileN]);
+            loc, accTileTy, lhsTile, rhsTiles[tileN], accTiles[tileM][tileN]);
       else
-        accTiles[tileM][tileN] = rewriter.create<amx::TileMulFOp>(
-            loc, accTileTy, lhsTile, rhsTiles[0][tileN],
-            accTiles[tileM][tileN]);
+        accTiles[tileM][tileN] = multiplyFpTiles(
+            loc, accTileTy, lhsTile, rhsTiles[tileN], accTiles[tileM][tileN],
+            lhs.elemTy, rhs.elemTy, rewriter);
 
       // Insert store here to better mix stores with multiplications.
       if (storeResult) {
@@ -610,15 +918,10 @@ LogicalResult convertCandidate(AmxDotOpCandidate &candidate,
   while (!isa<triton::FuncOp>(allocaPoint->getParentOp()))
     allocaPoint = allocaPoint->getParentOp();
 
-  // Cast input data if required and prepare input buffer. It might be temporary
-  // buffers with stored vectors or the original input memory.
-  Value lhs = maybeCast(loc, op.getA(), candidate.lhsTileElemTy, rewriter);
-  MemBuffer lhsBuf =
-      prepareTensorBuffer(loc, lhs, false, false, true, allocaPoint, rewriter);
-
-  Value rhs = maybeCast(loc, op.getB(), candidate.rhsTileElemTy, rewriter);
-  MemBuffer rhsBuf =
-      prepareTensorBuffer(loc, rhs, true, false, true, allocaPoint, rewriter);
+  TileInput lhs =
+      prepareTileInput(loc, op.getA(), lhsTileTy, false, allocaPoint, rewriter);
+  TileInput rhs =
+      prepareTileInput(loc, op.getB(), rhsTileTy, true, allocaPoint, rewriter);
 
   Value acc = maybeCast(loc, op.getC(), candidate.accTileElemTy, rewriter);
   Value accToStore = acc;
@@ -683,12 +986,12 @@ LogicalResult convertCandidate(AmxDotOpCandidate &candidate,
         // the smallest block on tiles.
         if (candidate.tilesInBlockM <= candidate.tilesInBlockN)
           multiplyBlocksPreloadLhs(
-              loc, lhsTileTy, rhsTileTy, accTileTy, lhsBuf, rhsBuf, resBuf,
+              loc, lhsTileTy, rhsTileTy, accTileTy, lhs, rhs, resBuf,
               blockM, blockN, blocK, candidate.tilesInBlockM,
               candidate.tilesInBlockN, accTiles, storeAcc, rewriter);
         else
           multiplyBlocksPreloadRhs(
-              loc, lhsTileTy, rhsTileTy, accTileTy, lhsBuf, rhsBuf, resBuf,
+              loc, lhsTileTy, rhsTileTy, accTileTy, lhs, rhs, resBuf,
               blockM, blockN, blocK, candidate.tilesInBlockM,
               candidate.tilesInBlockN, accTiles, storeAcc, rewriter);
       }
@@ -796,14 +1099,18 @@ LogicalResult convertCandidate(AmxDotOpCandidate &candidate,
 struct ConvertDotToAMX
     : public triton::cpu::impl::ConvertDotToAMXBase<ConvertDotToAMX> {
   ConvertDotToAMX() = default;
-  ConvertDotToAMX(bool convertInt8, bool convertFp16, bool convertBf16) {
+  ConvertDotToAMX(bool convertInt8, bool convertFp16, bool convertBf16,
+                  bool convertFp8, int64_t accBlockM, int64_t accBlockN) {
     this->convertInt8 = convertInt8;
     this->convertFp16 = convertFp16;
     this->convertBf16 = convertBf16;
+    this->convertFp8 = convertFp8;
+    this->accBlockM = accBlockM;
+    this->accBlockN = accBlockN;
   }
 
   void runOnOperation() override {
-    if (!convertInt8 && !convertFp16 && !convertBf16)
+    if (!convertInt8 && !convertFp16 && !convertBf16 && !convertFp8)
       return;
 
     MLIRContext *context = &getContext();
@@ -813,7 +1120,7 @@ struct ConvertDotToAMX
     mod->walk([this, &candidates](cpu::DotOp op) {
       AmxDotOpCandidate candidate;
       if (isAmxCandidate(op, convertInt8, convertFp16, convertBf16,
-                         candidate)) {
+                         convertFp8, accBlockM, accBlockN, candidate)) {
         LLVM_DEBUG({
           LDBG("Found AMX candidate");
           LDBG("  Op: " << candidate.op);
@@ -834,6 +1141,16 @@ struct ConvertDotToAMX
       return WalkResult::advance();
     });
 
+    // Explicitly requested block sizes are used as is.
+    if (!accBlockM && !accBlockN) {
+      llvm::MapVector<Operation *, SmallVector<AmxDotOpCandidate *>> funcs;
+      for (auto &candidate : candidates)
+        funcs[candidate.op->getParentOfType<triton::FuncOp>()].push_back(
+            &candidate);
+      for (auto &[func, funcCandidates] : funcs)
+        shareTileConfig(funcCandidates);
+    }
+
     for (auto &candidate : candidates) {
       LDBG("Starting conversion of candidate: " << candidate.op);
       PatternRewriter rewriter(context);
@@ -858,9 +1175,10 @@ std::unique_ptr<OperationPass<ModuleOp>> createConvertDotToAMX() {
 }
 
 std::unique_ptr<OperationPass<ModuleOp>>
-createConvertDotToAMX(bool convertInt8, bool convertFp16, bool convertBf16) {
-  return std::make_unique<ConvertDotToAMX>(convertInt8, convertFp16,
-                                           convertBf16);
+createConvertDotToAMX(bool convertInt8, bool convertFp16, bool convertBf16,
+                      bool convertFp8, int64_t accBlockM, int64_t accBlockN) {
+  return std::make_unique<ConvertDotToAMX>(
+      convertInt8, convertFp16, convertBf16, convertFp8, accBlockM, accBlockN);
 }
 
 } // namespace cpu
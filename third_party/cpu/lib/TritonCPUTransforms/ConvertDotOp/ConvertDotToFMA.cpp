@@ -3,9 +3,13 @@
 #include "cpu/include/TritonCPUTransforms/Passes.h"
 
 #include "mlir/Dialect/Index/IR/IndexDialect.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
 #include <utility>
 
@@ -24,6 +28,22 @@ using namespace mlir::triton::cpu;
 
 namespace {
 
+// Maximum number of elementwise ops fused into input loads.
+constexpr int64_t maxFusedInputOps = 16;
+
+// This structure describes an input computed by elementwise ops, e.g.
+// dequantization of weights, from values loaded from memory and other
+// values. Such ops are applied to each loaded row or element in registers
+// instead of writing the whole computed input to a temporary buffer.
+struct FusedInput {
+  // Elementwise ops computing the input in topological order.
+  SmallVector<Operation *> ops;
+  // Values loaded from memory used by ops with buffers holding them.
+  SmallVector<std::pair<Value, MemBuffer>> memLeaves;
+
+  bool empty() const { return ops.empty(); }
+};
+
 // This structure is used to hold candidates for conversion to FMA operations.
 struct FmaDotOpCandidate {
   // Operation to convert.
@@ -33,18 +53,34 @@ struct FmaDotOpCandidate {
   Type lhsElemTy;
   Type rhsElemTy;
   Type accElemTy;
-  // Accumulator size.
+  // Accumulator size. Accumulator rows are split into accVecsPerRow vectors
+  // of accVecSize elements.
   int64_t accVecSize;
+  int64_t accVecsPerRow;
   int64_t accRows;
+  // Accumulator is computed in blocks of blockM rows and blockN vectors per
+  // row, so that a block is kept on registers for the whole K dimension.
+  int64_t blockM;
+  int64_t blockN;
   // If accumulator is updated in a loop, then this flag indicates if we
   // should keep it in registers the whole loop.
   bool keepAccOnRegs = false;
   // Memory buffer holding LHS. Can be empty if LHS is not a result of a
-  // simple load.
+  // simple load. Buffer elements might have a different type, in this case
+  // they are converted after loading.
   MemBuffer lhsBuf;
   // Memory buffer holding RHS. Can be empty if RHS is not a result of a
-  // simple load.
+  // simple load. Buffer elements might have a different type, in this case
+  // they are converted after loading.
   MemBuffer rhsBuf;
+  // Memory buffers holding LHS rows loaded one by one, e.g. rows of implicit
+  // GEMM convolution operands addressing a pixel each. Used when LHS buffer
+  // is empty.
+  SmallVector<MemBuffer> lhsRows;
+  // Elementwise computations of LHS and RHS fused into loads. Used when
+  // the corresponding buffer is empty.
+  FusedInput lhsFused;
+  FusedInput rhsFused;
 };
 
 // Check if input and output types can be handled by FMA (possibly, using
@@ -54,7 +90,7 @@ struct FmaDotOpCandidate {
 bool checkElemTypes(Type lhsElemTy, Type rhsElemTy, Type accElemTy,
                     Type resElemTy, FmaDotOpCandidate &candidate) {
   MLIRContext *ctx = lhsElemTy.getContext();
-  if (lhsElemTy.isInteger() || rhsElemTy.isInteger() || resElemTy.isInteger()) {
+  if (accElemTy.isInteger() || resElemTy.isInteger()) {
     LDBG("Drop candidate because int types are not supported.");
     return false;
   }
@@ -76,21 +112,159 @@ bool checkElemTypes(Type lhsElemTy, Type rhsElemTy, Type accElemTy,
 }
 
 // Check input shapes. Currently, support only 2D cases and ignore small
-// inputs.
-bool checkInputShapes(VectorType lhsTy, VectorType resTy) {
+// inputs, i.e. rows narrower than 8 elements unless they fill a whole target
+// vector, as FP64 rows do on narrow targets.
+bool checkInputShapes(VectorType lhsTy, VectorType resTy, Type accElemTy,
+                      unsigned vectorBits) {
   if (lhsTy.getRank() != 2)
     return false;
 
-  if (resTy.getDimSize(1) < 8)
+  int64_t lanes = vectorBits / accElemTy.getIntOrFloatBitWidth();
+  if (resTy.getDimSize(1) < std::min<int64_t>(8, lanes))
     return false;
 
   return true;
 }
 
+// Choose vector size and block sizes for the accumulator. Vectors match the
+// target vector width when possible, and unless block sizes are specified,
+// a block with RHS vectors and broadcasted LHS values used to compute it fits
+// into vector registers.
+void setBlocking(Type accElemTy, int64_t accRows, int64_t n,
+                 unsigned vectorBits, unsigned numVecRegs, int64_t blockM,
+                 int64_t blockN, FmaDotOpCandidate &candidate) {
+  int64_t lanes = vectorBits / accElemTy.getIntOrFloatBitWidth();
+  candidate.accVecSize = (n % lanes == 0) ? lanes : n;
+  candidate.accVecsPerRow = n / candidate.accVecSize;
+  candidate.accRows = accRows;
+
+  // Registers for RHS vectors and for currently used and prefetched LHS
+  // broadcasts.
+  candidate.blockN = std::min<int64_t>(candidate.accVecsPerRow, 2);
+  int64_t reservedRegs = candidate.blockN + 2;
+  candidate.blockM = std::clamp<int64_t>(
+      (numVecRegs - reservedRegs) / candidate.blockN, 1, accRows);
+
+  if (blockN > 0)
+    candidate.blockN = std::min(blockN, candidate.accVecsPerRow);
+  if (blockM > 0)
+    candidate.blockM = std::min(blockM, accRows);
+}
+
+// Check if loaded values of the type can be converted to the type used for
+// computations without additional decomposition of conversions.
+bool isConvertibleInRegs(Type elemTy) {
+  return elemTy.isF16() || elemTy.isBF16() || elemTy.isF32() ||
+         elemTy.isF64() || elemTy.isInteger(8) || elemTy.isInteger(16) ||
+         elemTy.isInteger(32);
+}
+
+// If val is computed by a widening conversion to the element type used for
+// computations, then return the conversion input. Inputs are then read from
+// their original buffers and converted in registers instead of converting
+// the whole input to a temporary buffer.
+Value getConvertedSrc(Value val, Type computeElemTy) {
+  if (getElementTypeOrSelf(val.getType()) != computeElemTy)
+    return val;
+  Value src;
+  if (auto extOp = val.getDefiningOp<arith::ExtFOp>())
+    src = extOp.getIn();
+  else if (auto castOp = val.getDefiningOp<arith::SIToFPOp>())
+    src = castOp.getIn();
+  if (!src || !isConvertibleInRegs(getElementTypeOrSelf(src.getType())))
+    return val;
+  return src;
+}
+
+// Check if op is an elementwise op that can be computed for a row or an
+// element of the input instead of the whole input.
+bool isFusibleElementwiseOp(Operation *op, VectorType inputTy) {
+  if (!op || op->getNumResults() != 1 || op->getNumRegions() ||
+      !op->hasTrait<OpTrait::Elementwise>() || !isMemoryEffectFree(op))
+    return false;
+  auto shapeMatches = [&](Type ty) {
+    auto vecTy = dyn_cast<VectorType>(ty);
+    return vecTy && vecTy.getShape() == inputTy.getShape();
+  };
+  return shapeMatches(op->getResult(0).getType()) &&
+         llvm::all_of(op->getOperandTypes(), shapeMatches);
+}
+
+// Collect elementwise ops computing the input from loaded values. Return
+// an empty structure if there are no such ops, or no operands are loaded
+// from memory.
+FusedInput findFusedInput(Value input, bool allowTransposed) {
+  FusedInput res;
+  auto inputTy = cast<VectorType>(input.getType());
+  DenseSet<Value> visited;
+  bool failed = false;
+  std::function<void(Value)> visit = [&](Value val) {
+    if (failed || !visited.insert(val).second)
+      return;
+    Operation *defOp = val.getDefiningOp();
+    if (isFusibleElementwiseOp(defOp, inputTy) &&
+        (val == input || defOp->hasOneUse())) {
+      for (Value operand : defOp->getOperands())
+        visit(operand);
+      res.ops.push_back(defOp);
+      failed |= static_cast<int64_t>(res.ops.size()) > maxFusedInputOps;
+      return;
+    }
+    MemBuffer buf = findInputBuffer(val, allowTransposed);
+    if (!buf.empty() && isConvertibleInRegs(getElementTypeOrSelf(val)))
+      res.memLeaves.emplace_back(val, buf);
+  };
+  visit(input);
+  if (failed || res.ops.empty() || res.memLeaves.empty())
+    return FusedInput();
+  return res;
+}
+
+// Find buffers of rows of the input if each of its rows is loaded by an
+// unmasked vector load and inserted into the input, as for tensors of
+// pointers with contiguous rows at different addresses. Elements of such
+// rows are read directly from memory instead of storing the whole input to
+// a temporary buffer first.
+SmallVector<MemBuffer> findRowBuffers(Value input, int64_t numRows) {
+  SmallVector<MemBuffer> rows(numRows);
+  Value val = input;
+  while (auto insertOp = val.getDefiningOp<vector::InsertOp>()) {
+    ArrayRef<int64_t> pos = insertOp.getStaticPosition();
+    if (pos.size() != 1 || pos[0] < 0 || pos[0] >= numRows)
+      return {};
+    // Rows inserted later override earlier ones.
+    if (rows[pos[0]].empty()) {
+      auto loadOp = insertOp->getOperand(0).getDefiningOp<vector::LoadOp>();
+      if (!loadOp || loadOp.getMemRefType().getRank() != 1)
+        return {};
+      rows[pos[0]].memRef = loadOp.getBase();
+      rows[pos[0]].indices = loadOp.getIndices();
+    }
+    val = insertOp.getDest();
+  }
+  if (llvm::any_of(rows, [](const MemBuffer &row) { return row.empty(); }))
+    return {};
+  LDBG("Found row buffers of input: " << input);
+  return rows;
+}
+
+// Check if the input is computed by elementwise ops in registers, e.g.
+// probabilities of an online softmax computed from the result of a previous
+// dot. Elements of such inputs are broadcasted from registers instead of
+// storing the whole input to a temporary buffer and loading it back, so the
+// result of the first dot feeds the second one without leaving registers.
+bool isComputedInRegs(Value val) {
+  Operation *defOp = val.getDefiningOp();
+  return defOp && defOp->hasTrait<OpTrait::Elementwise>() &&
+         isMemoryEffectFree(defOp);
+}
+
 // Check if specified ContractionOp can be lowered to FMA operations.
 // If conversion is possible, then true is returned and candidate
 // structure is filled with detailed transformation info.
-bool isFmaCandidate(cpu::DotOp op, FmaDotOpCandidate &candidate) {
+bool isFmaCandidate(cpu::DotOp op, unsigned vectorBits, unsigned numVecRegs,
+                    int64_t blockM, int64_t blockN,
+                    FmaDotOpCandidate &candidate) {
   MLIRContext *ctx = op.getContext();
   VectorType lhsTy = op.getA().getType();
   VectorType rhsTy = op.getB().getType();
@@ -108,18 +282,28 @@ bool isFmaCandidate(cpu::DotOp op, FmaDotOpCandidate &candidate) {
     return false;
 
   // Check input shapes.
-  if (!checkInputShapes(lhsTy, resTy))
+  if (!checkInputShapes(lhsTy, resTy, candidate.accElemTy, vectorBits))
     return false;
 
   candidate.op = op;
-  candidate.accVecSize = resTy.getDimSize(1);
-  candidate.accRows = resTy.getDimSize(0);
+  setBlocking(candidate.accElemTy, resTy.getDimSize(0), resTy.getDimSize(1),
+              vectorBits, numVecRegs, blockM, blockN, candidate);
   candidate.keepAccOnRegs = isLoopCarriedAcc(op.getC());
 
-  if (lhsTy.getElementType() == candidate.lhsElemTy)
-    candidate.lhsBuf = findInputBuffer(op.getA(), true);
-  if (rhsTy.getElementType() == candidate.rhsElemTy)
-    candidate.rhsBuf = findInputBuffer(op.getB(), false);
+  if (isConvertibleInRegs(lhsTy.getElementType()))
+    candidate.lhsBuf =
+        findInputBuffer(getConvertedSrc(op.getA(), candidate.lhsElemTy), true);
+  if (isConvertibleInRegs(rhsTy.getElementType()))
+    candidate.rhsBuf = findInputBuffer(
+        getConvertedSrc(op.getB(), candidate.rhsElemTy), false);
+  if (candidate.lhsBuf.empty() && isConvertibleInRegs(lhsTy.getElementType()))
+    candidate.lhsRows =
+        findRowBuffers(getConvertedSrc(op.getA(), candidate.lhsElemTy),
+                       lhsTy.getDimSize(0));
+  if (candidate.lhsBuf.empty() && candidate.lhsRows.empty())
+    candidate.lhsFused = findFusedInput(op.getA(), true);
+  if (candidate.rhsBuf.empty())
+    candidate.rhsFused = findFusedInput(op.getB(), false);
 
   return true;
 }
@@ -141,12 +325,13 @@ SmallVector<Value> shiftIndices(Location loc, const MemBuffer &buf, int64_t m,
 }
 
 Value loadRow(Location loc, VectorType resTy, const MemBuffer &buf, int64_t m,
-              PatternRewriter &rewriter) {
+              int64_t n, PatternRewriter &rewriter) {
   assert(!buf.empty());
-  SmallVector<Value> indices = buf.indices;
-  indices[indices.size() - 2] =
-      shiftIndex(loc, indices[indices.size() - 2], m, rewriter);
-  return rewriter.create<vector::LoadOp>(loc, resTy, buf.memRef, indices);
+  SmallVector<Value> indices = shiftIndices(loc, buf, m, n, rewriter);
+  Type bufElemTy = cast<MemRefType>(buf.memRef.getType()).getElementType();
+  Value vec = rewriter.create<vector::LoadOp>(
+      loc, resTy.cloneWith(std::nullopt, bufElemTy), buf.memRef, indices);
+  return maybeCast(loc, vec, resTy.getElementType(), rewriter);
 }
 
 void storeRow(Location loc, const MemBuffer &buf, int64_t rowIdx, Value vec,
@@ -164,25 +349,49 @@ void storeRows(Location loc, const MemBuffer &buf,
     storeRow(loc, buf, m, vecs[m], rewriter);
 }
 
-SmallVector<Value> extractRows(Location loc, Value vec,
-                               PatternRewriter &rewriter) {
+// Split rows of a 2D vector into vectors of vecSize elements.
+SmallVector<SmallVector<Value>> extractRowVecs(Location loc, Value vec,
+                                               int64_t vecSize,
+                                               PatternRewriter &rewriter) {
   VectorType vecTy = cast<VectorType>(vec.getType());
-  SmallVector<Value> res;
+  SmallVector<SmallVector<Value>> res;
   for (int64_t m = 0; m < vecTy.getDimSize(0); ++m) {
-    auto row =
+    Value row =
         rewriter.create<vector::ExtractOp>(loc, vec, SmallVector<int64_t>({m}));
-    res.push_back(row);
+    res.emplace_back();
+    if (vecSize == vecTy.getDimSize(1)) {
+      res.back().push_back(row);
+      continue;
+    }
+    for (int64_t n = 0; n < vecTy.getDimSize(1); n += vecSize)
+      res.back().push_back(rewriter.create<vector::ExtractStridedSliceOp>(
+          loc, row, ArrayRef<int64_t>{n}, ArrayRef<int64_t>{vecSize},
+          ArrayRef<int64_t>{1}));
   }
   return res;
 }
 
-Value mergeRows(Location loc, VectorType resTy, const SmallVector<Value> &tiles,
-                PatternRewriter &rewriter) {
+Value mergeRowVecs(Location loc, VectorType resTy,
+                   const SmallVector<SmallVector<Value>> &vecs,
+                   PatternRewriter &rewriter) {
   Value res =
       rewriter.create<arith::ConstantOp>(loc, rewriter.getZeroAttr(resTy));
-  for (int64_t m = 0; m < tiles.size(); ++m)
-    res = rewriter.create<vector::InsertOp>(loc, tiles[m], res,
+  VectorType rowTy =
+      VectorType::get(resTy.getDimSize(1), resTy.getElementType());
+  for (int64_t m = 0; m < vecs.size(); ++m) {
+    Value row = vecs[m][0];
+    if (vecs[m].size() > 1) {
+      row = rewriter.create<arith::ConstantOp>(loc,
+                                               rewriter.getZeroAttr(rowTy));
+      int64_t vecSize = cast<VectorType>(vecs[m][0].getType()).getDimSize(0);
+      for (int64_t n = 0; n < vecs[m].size(); ++n)
+        row = rewriter.create<vector::InsertStridedSliceOp>(
+            loc, vecs[m][n], row, ArrayRef<int64_t>{n * vecSize},
+            ArrayRef<int64_t>{1});
+    }
+    res = rewriter.create<vector::InsertOp>(loc, row, res,
                                             SmallVector<int64_t>({m}));
+  }
   return res;
 }
 
@@ -190,9 +399,57 @@ Value broadcastElem(Location loc, VectorType tileTy, const MemBuffer &buf,
                     int64_t m, int64_t n, PatternRewriter &rewriter) {
   SmallVector<Value> indices = shiftIndices(loc, buf, m, n, rewriter);
   Value scalar = rewriter.create<memref::LoadOp>(loc, buf.memRef, indices);
+  scalar = maybeCast(loc, scalar, tileTy.getElementType(), rewriter);
   return rewriter.create<vector::BroadcastOp>(loc, tileTy, scalar);
 }
 
+// Compute a part of a fused input: a row slice of size vecSize at [m, n]
+// or, if vecSize is 0, an element at [m, n]. Loaded values are read from
+// their buffers, other values used by fused ops are extracted from vectors.
+Value computeFused(Location loc, const FusedInput &input, int64_t m,
+                   int64_t n, int64_t vecSize, PatternRewriter &rewriter) {
+  auto getPartTy = [&](Type ty) -> Type {
+    Type elemTy = getElementTypeOrSelf(ty);
+    return vecSize ? VectorType::get(vecSize, elemTy) : elemTy;
+  };
+
+  IRMapping mapping;
+  for (auto &[val, buf] : input.memLeaves) {
+    SmallVector<Value> indices = shiftIndices(loc, buf, m, n, rewriter);
+    Value part;
+    if (vecSize)
+      part = rewriter.create<vector::LoadOp>(
+          loc, cast<VectorType>(getPartTy(val.getType())), buf.memRef,
+          indices);
+    else
+      part = rewriter.create<memref::LoadOp>(loc, buf.memRef, indices);
+    mapping.map(val, part);
+  }
+
+  for (Operation *op : input.ops) {
+    for (Value operand : op->getOperands()) {
+      if (mapping.contains(operand))
+        continue;
+      Value part;
+      if (vecSize) {
+        Value row = rewriter.create<vector::ExtractOp>(
+            loc, operand, SmallVector<int64_t>({m}));
+        part = rewriter.create<vector::ExtractStridedSliceOp>(
+            loc, row, ArrayRef<int64_t>{n}, ArrayRef<int64_t>{vecSize},
+            ArrayRef<int64_t>{1});
+      } else {
+        part = rewriter.create<vector::ExtractOp>(
+            loc, operand, SmallVector<int64_t>({m, n}));
+      }
+      mapping.map(operand, part);
+    }
+    Operation *newOp = rewriter.clone(*op, mapping);
+    newOp->getResult(0).setType(getPartTy(op->getResult(0).getType()));
+  }
+
+  return mapping.lookup(input.ops.back()->getResult(0));
+}
+
 SmallVector<Value> computePrefetchIndices(Location loc, const MemBuffer &buf,
                                           int64_t iters,
                                           PatternRewriter &rewriter) {
@@ -252,13 +509,20 @@ LogicalResult convertCandidate(FmaDotOpCandidate &candidate,
   // Cast input data if required and prepare input buffer. It might be temporary
   // buffers with stored vectors or the original input memory.
   MemBuffer lhsBuf = candidate.lhsBuf;
-  if (lhsBuf.empty()) {
+  ArrayRef<MemBuffer> lhsRows = candidate.lhsRows;
+  const FusedInput &lhsFused = candidate.lhsFused;
+  Value lhsVec;
+  if (lhsBuf.empty() && lhsRows.empty() && lhsFused.empty()) {
     Value lhs = maybeCast(loc, op.getA(), candidate.lhsElemTy, rewriter);
-    lhsBuf = storeToTmpBuffer(loc, lhs, allocaPoint, rewriter);
+    if (isComputedInRegs(op.getA()))
+      lhsVec = lhs;
+    else
+      lhsBuf = storeToTmpBuffer(loc, lhs, allocaPoint, rewriter);
   }
 
   MemBuffer rhsBuf = candidate.rhsBuf;
-  if (rhsBuf.empty()) {
+  const FusedInput &rhsFused = candidate.rhsFused;
+  if (rhsBuf.empty() && rhsFused.empty()) {
     Value rhs = maybeCast(loc, op.getB(), candidate.rhsElemTy, rewriter);
     rhsBuf = storeToTmpBuffer(loc, rhs, allocaPoint, rewriter);
   }
@@ -271,8 +535,8 @@ LogicalResult convertCandidate(FmaDotOpCandidate &candidate,
     accToStore = getInitAccValue(acc);
   }
 
-  SmallVector<Value> accVecs;
-  SmallVector<Value> accInitVecs;
+  SmallVector<SmallVector<Value>> accVecs;
+  SmallVector<SmallVector<Value>> accInitVecs;
   if (candidate.keepAccOnRegs) {
     // Initial tile values are loaded before the loop and then directly
     // used within the loop. Later, new iter values will be added to
@@ -281,10 +545,11 @@ LogicalResult convertCandidate(FmaDotOpCandidate &candidate,
     OpBuilder::InsertionGuard g(rewriter);
     rewriter.setInsertionPoint(forOp);
     LDBG("Loading accumulator to tiles before the loop.");
-    accInitVecs = extractRows(loc, accToStore, rewriter);
+    accInitVecs =
+        extractRowVecs(loc, accToStore, candidate.accVecSize, rewriter);
     accVecs = accInitVecs;
   } else {
-    accVecs = extractRows(loc, acc, rewriter);
+    accVecs = extractRowVecs(loc, acc, candidate.accVecSize, rewriter);
   }
 
   // Compute indices to be used by prefetch.
@@ -296,38 +561,90 @@ LogicalResult convertCandidate(FmaDotOpCandidate &candidate,
       std::max(int64_t(128) / rhsTy.getNumElements(), int64_t(1));
   auto rhsPrefetchIndices =
       computePrefetchIndices(loc, candidate.rhsBuf, rhsPrefetchIters, rewriter);
-  Value nextRhsVec = loadRow(loc, rhsVecTy, rhsBuf, 0, rewriter);
-  for (int64_t k = 0; k < lhsTy.getDimSize(1); ++k) {
-    Value rhsVec = nextRhsVec;
 
-    // Load next vector in advance to hide load latency.
-    if (k != lhsTy.getDimSize(1) - 1)
-      nextRhsVec = loadRow(loc, rhsVecTy, rhsBuf, k + 1, rewriter);
+  // The accumulator is computed block by block. Each block is kept on
+  // registers while iterating over K.
+  int64_t vecSize = candidate.accVecSize;
+  for (int64_t startM = 0; startM < candidate.accRows;
+       startM += candidate.blockM) {
+    int64_t endM = std::min(startM + candidate.blockM, candidate.accRows);
+    for (int64_t startN = 0; startN < candidate.accVecsPerRow;
+         startN += candidate.blockN) {
+      int64_t endN =
+          std::min(startN + candidate.blockN, candidate.accVecsPerRow);
+      // Prefetches are issued once, together with the first block.
+      bool firstBlock = startM == 0 && startN == 0;
+      bool firstBlockN = startN == 0;
+
+      auto loadRhsVecs = [&](int64_t k) {
+        SmallVector<Value> vecs;
+        for (int64_t n = startN; n < endN; ++n) {
+          if (rhsBuf.empty())
+            vecs.push_back(maybeCast(
+                loc,
+                computeFused(loc, rhsFused, k, n * vecSize, vecSize, rewriter),
+                candidate.rhsElemTy, rewriter));
+          else
+            vecs.push_back(
+                loadRow(loc, rhsVecTy, rhsBuf, k, n * vecSize, rewriter));
+        }
+        return vecs;
+      };
+      auto loadLhsElem = [&](int64_t m, int64_t k) -> Value {
+        if (!lhsBuf.empty())
+          return broadcastElem(loc, accVecTy, lhsBuf, m, k, rewriter);
+        if (!lhsRows.empty()) {
+          const MemBuffer &row = lhsRows[m];
+          Value idx = shiftIndex(loc, row.indices[0], k, rewriter);
+          Value elem =
+              rewriter.create<memref::LoadOp>(loc, row.memRef, ValueRange{idx});
+          elem = maybeCast(loc, elem, accVecTy.getElementType(), rewriter);
+          return rewriter.create<vector::BroadcastOp>(loc, accVecTy, elem);
+        }
+        if (lhsVec) {
+          Value elem = rewriter.create<vector::ExtractOp>(
+              loc, lhsVec, SmallVector<int64_t>({m, k}));
+          return rewriter.create<vector::BroadcastOp>(loc, accVecTy, elem);
+        }
+        Value elem = computeFused(loc, lhsFused, m, k, 0, rewriter);
+        elem = maybeCast(loc, elem, candidate.lhsElemTy, rewriter);
+        return rewriter.create<vector::BroadcastOp>(loc, accVecTy, elem);
+      };
+
+      SmallVector<Value> nextRhsVecs = loadRhsVecs(0);
+      for (int64_t k = 0; k < lhsTy.getDimSize(1); ++k) {
+        SmallVector<Value> rhsVecs = nextRhsVecs;
+
+        // Load next vectors in advance to hide load latency.
+        if (k != lhsTy.getDimSize(1) - 1)
+          nextRhsVecs = loadRhsVecs(k + 1);
+
+        // Prefetch RHS to LLC cache.
+        if (firstBlock && !rhsPrefetchIndices.empty())
+          prefetch(loc, candidate.rhsBuf, k, 0, rhsPrefetchIndices, 1,
+                   rewriter);
+
+        Value nextLhsBroadcasted = loadLhsElem(startM, k);
+        for (int64_t m = startM; m < endM; ++m) {
+          Value lhsBroadcasted = nextLhsBroadcasted;
 
-    // Prefetch RHS to LLC cache.
-    if (!rhsPrefetchIndices.empty())
-      prefetch(loc, candidate.rhsBuf, k, 0, rhsPrefetchIndices, 1, rewriter);
+          // Load next value in advance to hide load latency.
+          if (m != endM - 1)
+            nextLhsBroadcasted = loadLhsElem(m + 1, k);
 
-    Value nextLhsBroadcasted =
-        broadcastElem(loc, accVecTy, lhsBuf, 0, k, rewriter);
-    for (int64_t m = 0; m < candidate.accRows; ++m) {
-      Value lhsBroadcasted = nextLhsBroadcasted;
-
-      // Load next value in advance to hide load latency.
-      if (m != candidate.accRows - 1)
-        nextLhsBroadcasted =
-            broadcastElem(loc, accVecTy, lhsBuf, m + 1, k, rewriter);
-
-      // Prefetch LHS to L1 cache.
-      if (!lhsPrefetchIndices.empty()) {
-        if ((candidate.lhsBuf.transposed && (m % 8 == 0)) ||
-            (!candidate.lhsBuf.transposed && (k % 8 == 0)))
-          prefetch(loc, candidate.lhsBuf, m, k, lhsPrefetchIndices, 3,
-                   rewriter);
-      }
+          // Prefetch LHS to L1 cache.
+          if (firstBlockN && !lhsPrefetchIndices.empty()) {
+            if ((candidate.lhsBuf.transposed && (m % 8 == 0)) ||
+                (!candidate.lhsBuf.transposed && (k % 8 == 0)))
+              prefetch(loc, candidate.lhsBuf, m, k, lhsPrefetchIndices, 3,
+                       rewriter);
+          }
 
-      accVecs[m] = rewriter.create<vector::FMAOp>(loc, rhsVec, lhsBroadcasted,
-                                                  accVecs[m]);
+          for (int64_t n = startN; n < endN; ++n)
+            accVecs[m][n] = rewriter.create<vector::FMAOp>(
+                loc, rhsVecs[n - startN], lhsBroadcasted, accVecs[m][n]);
+        }
+      }
     }
   }
 
@@ -350,10 +667,13 @@ LogicalResult convertCandidate(FmaDotOpCandidate &candidate,
     SmallVector<Value> newInitOperands;
     SmallVector<Value> newYieldedValues;
     for (int64_t m = 0; m < candidate.accRows; ++m) {
-      LDBG("Initial value\n  " << accInitVecs[m] << "\nis combined with\n  "
-                               << accVecs[m]);
-      newInitOperands.push_back(accInitVecs[m]);
-      newYieldedValues.push_back(accVecs[m]);
+      for (int64_t n = 0; n < candidate.accVecsPerRow; ++n) {
+        LDBG("Initial value\n  " << accInitVecs[m][n]
+                                 << "\nis combined with\n  "
+                                 << accVecs[m][n]);
+        newInitOperands.push_back(accInitVecs[m][n]);
+        newYieldedValues.push_back(accVecs[m][n]);
+      }
     }
     auto newForOp = cast<scf::ForOp>(*forOp.replaceWithAdditionalYields(
         rewriter, newInitOperands, true,
@@ -365,14 +685,15 @@ LogicalResult convertCandidate(FmaDotOpCandidate &candidate,
     // The resulting tiles are now in the new loop results.
     auto resVecs = newForOp.getResults().take_back(newYieldedValues.size());
     for (int64_t m = 0; m < candidate.accRows; ++m)
-      accVecs[m] = resVecs[m];
+      for (int64_t n = 0; n < candidate.accVecsPerRow; ++n)
+        accVecs[m][n] = resVecs[m * candidate.accVecsPerRow + n];
 
     OpBuilder::InsertionGuard g(rewriter);
     rewriter.setInsertionPointAfter(newForOp);
     // Collect all results into a single vector.
     LDBG("Merging resulting rows to replace loop result.");
     VectorType resTy = accTy.cloneWith(std::nullopt, candidate.accElemTy);
-    Value newVal = mergeRows(loc, resTy, accVecs, rewriter);
+    Value newVal = mergeRowVecs(loc, resTy, accVecs, rewriter);
     // We might need to cast back to the original type.
     newVal = maybeCast(loc, newVal, accTy.getElementType(), rewriter);
     rewriter.replaceAllUsesWith(newForOp.getResult(origResIdx), newVal);
@@ -381,7 +702,7 @@ LogicalResult convertCandidate(FmaDotOpCandidate &candidate,
     // constraction result.
     LDBG("Merging resulting rows to replace orig op result.");
     VectorType resTy = accTy.cloneWith(std::nullopt, candidate.accElemTy);
-    Value newVal = mergeRows(loc, resTy, accVecs, rewriter);
+    Value newVal = mergeRowVecs(loc, resTy, accVecs, rewriter);
     // We might need to cast back to the original type.
     newVal = maybeCast(loc, newVal, accTy.getElementType(), rewriter);
     rewriter.replaceOp(op, newVal);
@@ -390,18 +711,164 @@ LogicalResult convertCandidate(FmaDotOpCandidate &candidate,
   return success();
 }
 
+// Maximum number of LHS rows handled by the small M lowering.
+constexpr int64_t maxSmallM = 8;
+
+// This structure is used to hold candidates for the small M lowering. Such
+// dots multiply a few LHS rows by RHS stored transposed, i.e. both inputs
+// are contiguous along K. Each output element is computed with FMAs over
+// K vectors followed by a horizontal reduction, so RHS is streamed from
+// memory once.
+struct SmallMDotOpCandidate {
+  cpu::DotOp op;
+  // Element type used for computations.
+  Type elemTy;
+  // Number of K elements in vectors.
+  int64_t kVecSize;
+  // Number of RHS columns processed together.
+  int64_t blockN;
+  // Memory buffer holding LHS. Can be empty, in this case LHS rows are
+  // extracted from the LHS vector.
+  MemBuffer lhsBuf;
+  // Memory buffer holding transposed RHS.
+  MemBuffer rhsBuf;
+};
+
+bool isSmallMCandidate(cpu::DotOp op, unsigned vectorBits,
+                       unsigned numVecRegs, SmallMDotOpCandidate &candidate) {
+  VectorType lhsTy = op.getA().getType();
+  VectorType rhsTy = op.getB().getType();
+  VectorType accTy = op.getC().getType();
+  Type accElemTy = accTy.getElementType();
+  if (lhsTy.getRank() != 2 || lhsTy.getDimSize(0) > maxSmallM ||
+      !(accElemTy.isF32() || accElemTy.isF64()) ||
+      !isConvertibleInRegs(lhsTy.getElementType()) ||
+      !isConvertibleInRegs(rhsTy.getElementType()) ||
+      getElementTypeOrSelf(op.getType()) != accElemTy)
+    return false;
+
+  int64_t k = lhsTy.getDimSize(1);
+  int64_t lanes = vectorBits / accElemTy.getIntOrFloatBitWidth();
+  if (k % lanes != 0)
+    return false;
+
+  candidate.rhsBuf = findInputBuffer(op.getB(), true);
+  if (candidate.rhsBuf.empty() || !candidate.rhsBuf.transposed)
+    return false;
+
+  int64_t m = lhsTy.getDimSize(0);
+  candidate.op = op;
+  candidate.elemTy = accElemTy;
+  candidate.kVecSize = lanes;
+  // Keep accumulators for a block of columns of all rows plus LHS and RHS
+  // vectors on registers.
+  candidate.blockN = std::clamp<int64_t>((numVecRegs - m) / (m + 1), 1,
+                                         rhsTy.getDimSize(1));
+  candidate.lhsBuf = findInputBuffer(op.getA(), false);
+  return true;
+}
+
+// Load vecSize elements of a row of the input starting from column k. If
+// the buffer is empty, then the row part is extracted from val.
+Value loadRowPart(Location loc, VectorType resTy, Value val,
+                  const MemBuffer &buf, int64_t row, int64_t k,
+                  PatternRewriter &rewriter) {
+  Value res;
+  if (buf.empty()) {
+    Value rowVec = rewriter.create<vector::ExtractOp>(
+        loc, val, SmallVector<int64_t>({row}));
+    res = rewriter.create<vector::ExtractStridedSliceOp>(
+        loc, rowVec, ArrayRef<int64_t>{k},
+        ArrayRef<int64_t>{resTy.getDimSize(0)}, ArrayRef<int64_t>{1});
+  } else {
+    // For transposed buffers, shiftIndices swaps offsets.
+    SmallVector<Value> indices =
+        buf.transposed ? shiftIndices(loc, buf, k, row, rewriter)
+                       : shiftIndices(loc, buf, row, k, rewriter);
+    Type bufElemTy = cast<MemRefType>(buf.memRef.getType()).getElementType();
+    res = rewriter.create<vector::LoadOp>(
+        loc, resTy.cloneWith(std::nullopt, bufElemTy), buf.memRef, indices);
+  }
+  return maybeCast(loc, res, resTy.getElementType(), rewriter);
+}
+
+LogicalResult convertSmallMCandidate(SmallMDotOpCandidate &candidate,
+                                     PatternRewriter &rewriter) {
+  cpu::DotOp op = candidate.op;
+  Location loc = op.getLoc();
+  VectorType lhsTy = op.getA().getType();
+  VectorType resTy = op.getType();
+  int64_t m = lhsTy.getDimSize(0);
+  int64_t n = resTy.getDimSize(1);
+  int64_t k = lhsTy.getDimSize(1);
+  VectorType kVecTy = VectorType::get(candidate.kVecSize, candidate.elemTy);
+  Value zero =
+      rewriter.create<arith::ConstantOp>(loc, rewriter.getZeroAttr(kVecTy));
+
+  Value res = op.getC();
+  for (int64_t startN = 0; startN < n; startN += candidate.blockN) {
+    int64_t endN = std::min(startN + candidate.blockN, n);
+    SmallVector<SmallVector<Value>> accVecs(
+        m, SmallVector<Value>(endN - startN, zero));
+    for (int64_t kk = 0; kk < k; kk += candidate.kVecSize) {
+      SmallVector<Value> rhsVecs;
+      for (int64_t col = startN; col < endN; ++col)
+        rhsVecs.push_back(loadRowPart(loc, kVecTy, op.getB(),
+                                      candidate.rhsBuf, col, kk, rewriter));
+      for (int64_t row = 0; row < m; ++row) {
+        Value lhsVec = loadRowPart(loc, kVecTy, op.getA(), candidate.lhsBuf,
+                                   row, kk, rewriter);
+        for (int64_t col = startN; col < endN; ++col)
+          accVecs[row][col - startN] = rewriter.create<vector::FMAOp>(
+              loc, lhsVec, rhsVecs[col - startN], accVecs[row][col - startN]);
+      }
+    }
+
+    // Reduce accumulated vectors and add them to the accumulator.
+    for (int64_t row = 0; row < m; ++row) {
+      for (int64_t col = startN; col < endN; ++col) {
+        SmallVector<int64_t> pos({row, col});
+        Value acc = rewriter.create<vector::ExtractOp>(loc, res, pos);
+        Value sum = rewriter.create<vector::ReductionOp>(
+            loc, vector::CombiningKind::ADD, accVecs[row][col - startN], acc,
+            arith::FastMathFlags::reassoc);
+        res = rewriter.create<vector::InsertOp>(loc, sum, res, pos);
+      }
+    }
+  }
+
+  rewriter.replaceOp(op, res);
+  return success();
+}
+
 struct ConvertDotToFMA
     : public triton::cpu::impl::ConvertDotToFMABase<ConvertDotToFMA> {
   ConvertDotToFMA() = default;
+  ConvertDotToFMA(unsigned vectorBits, unsigned numVecRegs, int64_t blockM,
+                  int64_t blockN) {
+    this->vectorBits = vectorBits;
+    this->numVecRegs = numVecRegs;
+    this->blockM = blockM;
+    this->blockN = blockN;
+  }
 
   void runOnOperation() override {
     MLIRContext *context = &getContext();
     ModuleOp mod = getOperation();
 
     SmallVector<FmaDotOpCandidate, 1> candidates;
-    mod->walk([this, &candidates](cpu::DotOp op) {
+    SmallVector<SmallMDotOpCandidate, 1> smallMCandidates;
+    mod->walk([this, &candidates, &smallMCandidates](cpu::DotOp op) {
+      SmallMDotOpCandidate smallMCandidate;
+      if (isSmallMCandidate(op, vectorBits, numVecRegs, smallMCandidate)) {
+        LDBG("Found small M candidate: " << op);
+        smallMCandidates.push_back(smallMCandidate);
+        return WalkResult::advance();
+      }
+
       FmaDotOpCandidate candidate;
-      if (isFmaCandidate(op, candidate)) {
+      if (isFmaCandidate(op, vectorBits, numVecRegs, blockM, blockN,
+                         candidate)) {
         LLVM_DEBUG({
           LDBG("Found FMA candidate");
           LDBG("  Op: " << candidate.op);
@@ -409,7 +876,10 @@ struct ConvertDotToFMA
           LDBG("  RhsElemTy: " << candidate.rhsElemTy);
           LDBG("  AccElemTy: " << candidate.accElemTy);
           LDBG("  AccVecSize: " << candidate.accVecSize);
+          LDBG("  AccVecsPerRow: " << candidate.accVecsPerRow);
           LDBG("  AccRows: " << candidate.accRows);
+          LDBG("  BlockM: " << candidate.blockM);
+          LDBG("  BlockN: " << candidate.blockN);
           LDBG("  KeepAccOnRegs: " << candidate.keepAccOnRegs);
           if (!candidate.lhsBuf.empty()) {
             LDBG("  LhsBuf: " << candidate.lhsBuf.memRef);
@@ -425,6 +895,14 @@ struct ConvertDotToFMA
       return WalkResult::advance();
     });
 
+    for (auto &candidate : smallMCandidates) {
+      LDBG("Starting conversion of small M candidate: " << candidate.op);
+      PatternRewriter rewriter(context);
+      rewriter.setInsertionPoint(candidate.op);
+      if (failed(convertSmallMCandidate(candidate, rewriter)))
+        LDBG("Conversion failed!");
+    }
+
     for (auto &candidate : candidates) {
       LDBG("Starting conversion of candidate: " << candidate.op);
       PatternRewriter rewriter(context);
@@ -448,6 +926,13 @@ std::unique_ptr<OperationPass<ModuleOp>> createConvertDotToFMA() {
   return std::make_unique<ConvertDotToFMA>();
 }
 
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertDotToFMA(unsigned vectorBits, unsigned numVecRegs,
+                      int64_t blockM, int64_t blockN) {
+  return std::make_unique<ConvertDotToFMA>(vectorBits, numVecRegs, blockM,
+                                           blockN);
+}
+
 } // namespace cpu
 } // namespace triton
 } // namespace mlir
@@ -0,0 +1,460 @@
+#include "ConvertDotCommon.h"
+
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_CONVERTDOTTOMMLA
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Each MMLA instruction multiplies a 2xK tile of LHS by a Kx2 tile of RHS and
+// adds the product to a 2x2 accumulator tile held in a single 128-bit
+// register.
+constexpr int64_t tileSize = 2;
+
+// Number of accumulator tiles in each dimension of a block. Accumulator,
+// LHS and RHS registers of a block fit into 32 vector registers.
+constexpr int64_t blockTiles = 4;
+
+// SDOT accumulates groups of 4 bytes to 32-bit lanes of a 128-bit register.
+// Blocks hold up to sdotBlockN vectors per row and sdotBlockM rows.
+constexpr int64_t sdotLanes = 4;
+constexpr int64_t sdotBlockN = 4;
+constexpr int64_t sdotBlockM = 6;
+
+// This structure is used to hold candidates for conversion to MMLA
+// instructions.
+struct MmlaDotOpCandidate {
+  // Operation to convert.
+  cpu::DotOp op;
+  // Use SDOT instead of SMMLA. In this case accumulator rows are split into
+  // 4-lane vectors and tilesM and tilesN hold the number of rows and vectors
+  // per row.
+  bool useSdot = false;
+  // Number of K elements processed by a single instruction: 8 for SMMLA and
+  // 4 for BFMMLA and SDOT.
+  int64_t tileK;
+  // Number of accumulator tiles.
+  int64_t tilesM;
+  int64_t tilesN;
+  // If accumulator is updated in a loop, then this flag indicates if we
+  // should keep it in registers the whole loop.
+  bool keepAccOnRegs = false;
+};
+
+// Check if specified DotOp can be lowered to MMLA instructions. Signed
+// i8 inputs with i32 accumulator use SMMLA, or SDOT if only it is supported,
+// and BF16 inputs with FP32 accumulator use BFMMLA.
+bool isMmlaCandidate(cpu::DotOp op, bool supportInt8, bool supportSdot,
+                     bool supportBf16, MmlaDotOpCandidate &candidate) {
+  VectorType lhsTy = op.getA().getType();
+  VectorType rhsTy = op.getB().getType();
+  VectorType accTy = op.getC().getType();
+  VectorType resTy = op.getType();
+
+  LDBG("Considering candidate op: " << op);
+
+  Type elemTy = lhsTy.getElementType();
+  Type accElemTy = accTy.getElementType();
+  if (elemTy != rhsTy.getElementType() || accElemTy != resTy.getElementType())
+    return false;
+  if (supportInt8 && elemTy.isInteger(8) && accElemTy.isInteger(32)) {
+    candidate.tileK = 8;
+  } else if (supportSdot && elemTy.isInteger(8) && accElemTy.isInteger(32)) {
+    candidate.useSdot = true;
+    candidate.tileK = 4;
+  } else if (supportBf16 && elemTy.isBF16() && accElemTy.isF32()) {
+    candidate.tileK = 4;
+  } else {
+    LDBG("Drop candidate because of unsupported types.");
+    return false;
+  }
+
+  if (lhsTy.getRank() != 2)
+    return false;
+
+  if (candidate.useSdot) {
+    if (resTy.getDimSize(1) % sdotLanes != 0 ||
+        lhsTy.getDimSize(1) % candidate.tileK != 0) {
+      LDBG("Drop candidate because shape is not a multiple of SDOT groups.");
+      return false;
+    }
+    candidate.op = op;
+    candidate.tilesM = resTy.getDimSize(0);
+    candidate.tilesN = resTy.getDimSize(1) / sdotLanes;
+    candidate.keepAccOnRegs = isLoopCarriedAcc(op.getC());
+    return true;
+  }
+
+  if (resTy.getDimSize(0) % tileSize != 0 ||
+      resTy.getDimSize(1) % tileSize != 0 ||
+      lhsTy.getDimSize(1) % candidate.tileK != 0) {
+    LDBG("Drop candidate because shape is not a multiple of the tile shape.");
+    return false;
+  }
+
+  candidate.op = op;
+  candidate.tilesM = resTy.getDimSize(0) / tileSize;
+  candidate.tilesN = resTy.getDimSize(1) / tileSize;
+  candidate.keepAccOnRegs = isLoopCarriedAcc(op.getC());
+
+  return true;
+}
+
+Value callIntrinsic(Location loc, StringRef name, Value acc, Value lhs,
+                    Value rhs, PatternRewriter &rewriter) {
+  MLIRContext *ctx = rewriter.getContext();
+  auto intrinsic = StringAttr::get(ctx, name);
+  auto callIntrOp = rewriter.create<LLVM::CallIntrinsicOp>(
+      loc, TypeRange{acc.getType()}, intrinsic, ValueRange{acc, lhs, rhs},
+      LLVM::FastmathFlagsAttr::get(ctx, LLVM::FastmathFlags::none));
+  return callIntrOp.getResult(0);
+}
+
+Value mmla(Location loc, Value acc, Value lhs, Value rhs,
+           PatternRewriter &rewriter) {
+  bool isInteger = getElementTypeOrSelf(acc.getType()).isInteger();
+  return callIntrinsic(loc,
+                       isInteger ? "llvm.aarch64.neon.smmla"
+                                 : "llvm.aarch64.neon.bfmmla",
+                       acc, lhs, rhs, rewriter);
+}
+
+Value sdot(Location loc, Value acc, Value lhs, Value rhs,
+           PatternRewriter &rewriter) {
+  return callIntrinsic(loc, "llvm.aarch64.neon.sdot", acc, lhs, rhs, rewriter);
+}
+
+// Rearrange [R, K] vector to [R / 2, K / tileK, 2 * tileK] holding rows of
+// each pair in a single vector per each tileK elements of K.
+Value packRowPairs(Location loc, Value val, int64_t tileK,
+                   PatternRewriter &rewriter) {
+  auto valTy = cast<VectorType>(val.getType());
+  int64_t rows = valTy.getDimSize(0);
+  int64_t k = valTy.getDimSize(1);
+  Type elemTy = valTy.getElementType();
+  Value res = rewriter.create<vector::ShapeCastOp>(
+      loc,
+      VectorType::get({rows / tileSize, tileSize, k / tileK, tileK}, elemTy),
+      val);
+  res = rewriter.create<vector::TransposeOp>(loc, res,
+                                             ArrayRef<int64_t>{0, 2, 1, 3});
+  return rewriter.create<vector::ShapeCastOp>(
+      loc,
+      VectorType::get({rows / tileSize, k / tileK, tileSize * tileK}, elemTy),
+      res);
+}
+
+// Swap the second and the third dimension of [A, B, C, D] vector with
+// reshapes from and to the specified type.
+Value swapTileDims(Location loc, Value val, ArrayRef<int64_t> shape,
+                   VectorType resTy, PatternRewriter &rewriter) {
+  auto valTy = cast<VectorType>(val.getType());
+  Value res = rewriter.create<vector::ShapeCastOp>(
+      loc, valTy.cloneWith(shape, valTy.getElementType()), val);
+  res = rewriter.create<vector::TransposeOp>(loc, res,
+                                             ArrayRef<int64_t>{0, 2, 1, 3});
+  return rewriter.create<vector::ShapeCastOp>(loc, resTy, res);
+}
+
+// Split [M, N] accumulator into row-major 2x2 tiles, or into 4-lane row
+// vectors for SDOT.
+SmallVector<SmallVector<Value>> extractAccTiles(Location loc, Value acc,
+                                                bool useSdot,
+                                                PatternRewriter &rewriter) {
+  auto accTy = cast<VectorType>(acc.getType());
+  Type elemTy = accTy.getElementType();
+  int64_t tilesM, tilesN;
+  Value tiles;
+  if (useSdot) {
+    tilesM = accTy.getDimSize(0);
+    tilesN = accTy.getDimSize(1) / sdotLanes;
+    tiles = rewriter.create<vector::ShapeCastOp>(
+        loc, VectorType::get({tilesM, tilesN, sdotLanes}, elemTy), acc);
+  } else {
+    tilesM = accTy.getDimSize(0) / tileSize;
+    tilesN = accTy.getDimSize(1) / tileSize;
+    tiles = swapTileDims(
+        loc, acc, {tilesM, tileSize, tilesN, tileSize},
+        VectorType::get({tilesM, tilesN, tileSize * tileSize}, elemTy),
+        rewriter);
+  }
+  SmallVector<SmallVector<Value>> res(tilesM);
+  for (int64_t m = 0; m < tilesM; ++m)
+    for (int64_t n = 0; n < tilesN; ++n)
+      res[m].push_back(rewriter.create<vector::ExtractOp>(
+          loc, tiles, ArrayRef<int64_t>{m, n}));
+  return res;
+}
+
+Value mergeAccTiles(Location loc, VectorType resTy,
+                    const SmallVector<SmallVector<Value>> &tiles, bool useSdot,
+                    PatternRewriter &rewriter) {
+  int64_t tilesM = tiles.size();
+  int64_t tilesN = tiles[0].size();
+  int64_t tileElems = useSdot ? sdotLanes : tileSize * tileSize;
+  VectorType tilesTy =
+      VectorType::get({tilesM, tilesN, tileElems}, resTy.getElementType());
+  Value res =
+      rewriter.create<arith::ConstantOp>(loc, rewriter.getZeroAttr(tilesTy));
+  for (int64_t m = 0; m < tilesM; ++m)
+    for (int64_t n = 0; n < tilesN; ++n)
+      res = rewriter.create<vector::InsertOp>(loc, tiles[m][n], res,
+                                              ArrayRef<int64_t>{m, n});
+  if (useSdot)
+    return rewriter.create<vector::ShapeCastOp>(loc, resTy, res);
+  return swapTileDims(loc, res, {tilesM, tilesN, tileSize, tileSize}, resTy,
+                      rewriter);
+}
+
+// Multiply tiles of a block with MMLA instructions over the whole K.
+void multiplyBlockMmla(Location loc, Value lhs, Value rhs, int64_t groups,
+                       int64_t startM, int64_t endM, int64_t startN,
+                       int64_t endN, SmallVector<SmallVector<Value>> &accTiles,
+                       PatternRewriter &rewriter) {
+  for (int64_t k = 0; k < groups; ++k) {
+    SmallVector<Value> rhsVecs;
+    for (int64_t n = startN; n < endN; ++n)
+      rhsVecs.push_back(rewriter.create<vector::ExtractOp>(
+          loc, rhs, ArrayRef<int64_t>{n, k}));
+    for (int64_t m = startM; m < endM; ++m) {
+      Value lhsVec = rewriter.create<vector::ExtractOp>(
+          loc, lhs, ArrayRef<int64_t>{m, k});
+      for (int64_t n = startN; n < endN; ++n)
+        accTiles[m][n] = mmla(loc, accTiles[m][n], lhsVec,
+                              rhsVecs[n - startN], rewriter);
+    }
+  }
+}
+
+// Multiply rows of a block with SDOT instructions over the whole K. RHS
+// vectors are reused for all rows and a broadcasted group of 4 LHS bytes is
+// reused for all vectors of a row.
+void multiplyBlockSdot(Location loc, Value lhs, Value rhs, int64_t groups,
+                       int64_t startM, int64_t endM, int64_t startN,
+                       int64_t endN, SmallVector<SmallVector<Value>> &accVecs,
+                       PatternRewriter &rewriter) {
+  VectorType groupTy = VectorType::get(sdotLanes, rewriter.getI32Type());
+  VectorType bytesTy = VectorType::get(sdotLanes * 4, rewriter.getI8Type());
+  for (int64_t k = 0; k < groups; ++k) {
+    SmallVector<Value> rhsVecs;
+    for (int64_t n = startN; n < endN; ++n)
+      rhsVecs.push_back(rewriter.create<vector::ExtractOp>(
+          loc, rhs, ArrayRef<int64_t>{k, n}));
+    for (int64_t m = startM; m < endM; ++m) {
+      Value lhsGroup = rewriter.create<vector::ExtractOp>(
+          loc, lhs, ArrayRef<int64_t>{m, k});
+      Value lhsVec = rewriter.create<vector::BroadcastOp>(loc, groupTy,
+                                                          lhsGroup);
+      lhsVec = rewriter.create<vector::BitCastOp>(loc, bytesTy, lhsVec);
+      for (int64_t n = startN; n < endN; ++n)
+        accVecs[m][n] = sdot(loc, accVecs[m][n], lhsVec, rhsVecs[n - startN],
+                             rewriter);
+    }
+  }
+}
+
+LogicalResult convertCandidate(MmlaDotOpCandidate &candidate,
+                               PatternRewriter &rewriter) {
+  cpu::DotOp op = candidate.op;
+  Location loc = op.getLoc();
+  VectorType lhsTy = op.getA().getType();
+  VectorType rhsTy = op.getB().getType();
+  VectorType accTy = op.getC().getType();
+  int64_t groups = lhsTy.getDimSize(1) / candidate.tileK;
+  bool useSdot = candidate.useSdot;
+
+  Value lhs;
+  Value rhs;
+  if (useSdot) {
+    // Each i32 element of LHS holds a group of 4 K elements of a row. RHS
+    // is rearranged to [K / 4, N / 4, 16] holding groups of 4 K elements for
+    // 4 subsequent columns.
+    int64_t n = rhsTy.getDimSize(1);
+    Type i8Ty = rewriter.getI8Type();
+    lhs = rewriter.create<vector::BitCastOp>(
+        loc,
+        VectorType::get({lhsTy.getDimSize(0), groups}, rewriter.getI32Type()),
+        op.getA());
+    rhs = rewriter.create<vector::ShapeCastOp>(
+        loc, VectorType::get({groups, candidate.tileK, n}, i8Ty), op.getB());
+    rhs = rewriter.create<vector::TransposeOp>(loc, rhs,
+                                               ArrayRef<int64_t>{0, 2, 1});
+    rhs = rewriter.create<vector::ShapeCastOp>(
+        loc, VectorType::get({groups, n / sdotLanes, sdotLanes * 4}, i8Ty),
+        rhs);
+  } else {
+    // Both LHS and RHS registers hold two K-contiguous rows, so RHS is
+    // transposed first.
+    lhs = packRowPairs(loc, op.getA(), candidate.tileK, rewriter);
+    rhs = rewriter.create<vector::TransposeOp>(loc, op.getB(),
+                                               ArrayRef<int64_t>{1, 0});
+    rhs = packRowPairs(loc, rhs, candidate.tileK, rewriter);
+  }
+
+  Value acc = op.getC();
+  scf::ForOp forOp;
+  SmallVector<SmallVector<Value>> accTiles;
+  SmallVector<SmallVector<Value>> accInitTiles;
+  if (candidate.keepAccOnRegs) {
+    // Initial tile values are extracted before the loop and then directly
+    // used within the loop. Later, new iter values will be added to add
+    // loop carried-dependencies for accumulator tiles.
+    forOp = cast<scf::ForOp>(op->getParentOp());
+    OpBuilder::InsertionGuard g(rewriter);
+    rewriter.setInsertionPoint(forOp);
+    LDBG("Extracting accumulator tiles before the loop.");
+    accInitTiles =
+        extractAccTiles(loc, getInitAccValue(acc), useSdot, rewriter);
+    accTiles = accInitTiles;
+  } else {
+    accTiles = extractAccTiles(loc, acc, useSdot, rewriter);
+  }
+
+  // The accumulator is computed block by block. Each block is kept on
+  // registers while iterating over K.
+  int64_t blockM = useSdot ? sdotBlockM : blockTiles;
+  int64_t blockN = useSdot ? sdotBlockN : blockTiles;
+  for (int64_t startM = 0; startM < candidate.tilesM; startM += blockM) {
+    int64_t endM = std::min(startM + blockM, candidate.tilesM);
+    for (int64_t startN = 0; startN < candidate.tilesN; startN += blockN) {
+      int64_t endN = std::min(startN + blockN, candidate.tilesN);
+      if (useSdot)
+        multiplyBlockSdot(loc, lhs, rhs, groups, startM, endM, startN, endN,
+                          accTiles, rewriter);
+      else
+        multiplyBlockMmla(loc, lhs, rhs, groups, startM, endM, startN, endN,
+                          accTiles, rewriter);
+    }
+  }
+
+  if (candidate.keepAccOnRegs) {
+    // We don't need the original accumulator and dot op anymore. Directly
+    // yield orig accumulator value, so it would be later removed as unused.
+    int64_t origResIdx = op.getResult().getUses().begin()->getOperandNumber();
+    rewriter.replaceOp(op, op.getC());
+
+    // Replace the loop with a new one to add loop carried dependency for
+    // accumulator tiles.
+    LDBG("Rewrite loop to introduce loop carried dependencies for accumulator "
+         "tiles.");
+    SmallVector<Value> newInitOperands;
+    SmallVector<Value> newYieldedValues;
+    for (int64_t m = 0; m < candidate.tilesM; ++m) {
+      for (int64_t n = 0; n < candidate.tilesN; ++n) {
+        newInitOperands.push_back(accInitTiles[m][n]);
+        newYieldedValues.push_back(accTiles[m][n]);
+      }
+    }
+    auto newForOp = cast<scf::ForOp>(*forOp.replaceWithAdditionalYields(
+        rewriter, newInitOperands, true,
+        [&newYieldedValues](OpBuilder &b, Location loc,
+                            ArrayRef<BlockArgument> newBBArgs) {
+          return newYieldedValues;
+        }));
+
+    // The resulting tiles are now in the new loop results.
+    auto resTiles = newForOp.getResults().take_back(newYieldedValues.size());
+    for (int64_t m = 0; m < candidate.tilesM; ++m)
+      for (int64_t n = 0; n < candidate.tilesN; ++n)
+        accTiles[m][n] = resTiles[m * candidate.tilesN + n];
+
+    OpBuilder::InsertionGuard g(rewriter);
+    rewriter.setInsertionPointAfter(newForOp);
+    LDBG("Merging resulting tiles to replace loop result.");
+    Value newVal = mergeAccTiles(loc, accTy, accTiles, useSdot, rewriter);
+    rewriter.replaceAllUsesWith(newForOp.getResult(origResIdx), newVal);
+  } else {
+    LDBG("Merging resulting tiles to replace orig op result.");
+    Value newVal = mergeAccTiles(loc, accTy, accTiles, useSdot, rewriter);
+    rewriter.replaceOp(op, newVal);
+  }
+
+  return success();
+}
+
+struct ConvertDotToMMLA
+    : public triton::cpu::impl::ConvertDotToMMLABase<ConvertDotToMMLA> {
+  ConvertDotToMMLA() = default;
+  ConvertDotToMMLA(bool convertInt8, bool convertInt8Sdot, bool convertBf16) {
+    this->convertInt8 = convertInt8;
+    this->convertInt8Sdot = convertInt8Sdot;
+    this->convertBf16 = convertBf16;
+  }
+
+  void runOnOperation() override {
+    if (!convertInt8 && !convertInt8Sdot && !convertBf16)
+      return;
+
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    SmallVector<MmlaDotOpCandidate, 1> candidates;
+    mod->walk([this, &candidates](cpu::DotOp op) {
+      MmlaDotOpCandidate candidate;
+      if (isMmlaCandidate(op, convertInt8, convertInt8Sdot, convertBf16,
+                          candidate)) {
+        LLVM_DEBUG({
+          LDBG("Found MMLA candidate");
+          LDBG("  Op: " << candidate.op);
+          LDBG("  UseSdot: " << candidate.useSdot);
+          LDBG("  TileK: " << candidate.tileK);
+          LDBG("  TilesM: " << candidate.tilesM);
+          LDBG("  TilesN: " << candidate.tilesN);
+          LDBG("  KeepAccOnRegs: " << candidate.keepAccOnRegs);
+        });
+        candidates.push_back(candidate);
+      }
+      return WalkResult::advance();
+    });
+
+    for (auto &candidate : candidates) {
+      LDBG("Starting conversion of candidate: " << candidate.op);
+      PatternRewriter rewriter(context);
+      rewriter.setInsertionPoint(candidate.op);
+      if (succeeded(convertCandidate(candidate, rewriter))) {
+        LDBG("Conversion succeeded!");
+      } else {
+        LDBG("Conversion failed!");
+      }
+    }
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createConvertDotToMMLA() {
+  return std::make_unique<ConvertDotToMMLA>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertDotToMMLA(bool convertInt8, bool convertInt8Sdot,
+                       bool convertBf16) {
+  return std::make_unique<ConvertDotToMMLA>(convertInt8, convertInt8Sdot,
+                                            convertBf16);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -0,0 +1,356 @@
+#include "ConvertDotCommon.h"
+
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_CONVERTDOTTOVNNI
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// This structure is used to hold candidates for conversion to VNNI dot
+// product instructions.
+struct VnniDotOpCandidate {
+  // Operation to convert.
+  cpu::DotOp op;
+  // Number of K elements multiplied and added to a single 32-bit
+  // accumulator element by one instruction: 4 for i8 and 2 for i16.
+  int64_t groupSize;
+  // Number of 32-bit elements in vectors used for computations.
+  int64_t vecSize;
+  // Accumulator rows and vectors per row.
+  int64_t accRows;
+  int64_t accVecsPerRow;
+  // If accumulator is updated in a loop, then this flag indicates if we
+  // should keep it in registers the whole loop.
+  bool keepAccOnRegs = false;
+};
+
+// Check if specified DotOp can be lowered to VNNI instructions. Signed i8
+// and i16 inputs with i32 accumulator are supported. If conversion is
+// possible, then true is returned and candidate structure is filled with
+// detailed transformation info.
+bool isVnniCandidate(cpu::DotOp op, bool useAvx512,
+                     VnniDotOpCandidate &candidate) {
+  VectorType lhsTy = op.getA().getType();
+  VectorType rhsTy = op.getB().getType();
+  VectorType accTy = op.getC().getType();
+  VectorType resTy = op.getType();
+
+  LDBG("Considering candidate op: " << op);
+
+  Type elemTy = lhsTy.getElementType();
+  if (elemTy != rhsTy.getElementType() ||
+      !(elemTy.isInteger(8) || elemTy.isInteger(16))) {
+    LDBG("Drop candidate because of unsupported input types.");
+    return false;
+  }
+  if (!accTy.getElementType().isInteger(32) ||
+      !resTy.getElementType().isInteger(32)) {
+    LDBG("Drop candidate because of unsupported accumulator type.");
+    return false;
+  }
+
+  if (lhsTy.getRank() != 2)
+    return false;
+
+  candidate.groupSize = 32 / elemTy.getIntOrFloatBitWidth();
+  if (lhsTy.getDimSize(1) % candidate.groupSize != 0) {
+    LDBG("Drop candidate because K is not a multiple of the group size.");
+    return false;
+  }
+
+  // Use 512-bit vectors when available and fall back to 256-bit ones for
+  // narrow results.
+  int64_t n = resTy.getDimSize(1);
+  candidate.vecSize = (useAvx512 && n % 16 == 0) ? 16 : 8;
+  if (n % candidate.vecSize != 0) {
+    LDBG("Drop candidate because N is not a multiple of the vector size.");
+    return false;
+  }
+
+  candidate.op = op;
+  candidate.accRows = resTy.getDimSize(0);
+  candidate.accVecsPerRow = n / candidate.vecSize;
+  candidate.keepAccOnRegs = isLoopCarriedAcc(op.getC());
+
+  return true;
+}
+
+// Multiply groups of lhs and rhs elements and add them to the accumulator
+// using vpdpbusd for i8 and vpdpwssd for i16 inputs. All vectors hold i32
+// elements, inputs are bitcasted groups.
+Value vnniDot(Location loc, int64_t groupSize, Value acc, Value lhs, Value rhs,
+              PatternRewriter &rewriter) {
+  MLIRContext *ctx = rewriter.getContext();
+  auto vecTy = cast<VectorType>(acc.getType());
+  std::string intrinsic = groupSize == 4 ? "llvm.x86.avx512.vpdpbusd."
+                                         : "llvm.x86.avx512.vpdpwssd.";
+  intrinsic += std::to_string(vecTy.getNumElements() * 32);
+  auto callIntrOp = rewriter.create<LLVM::CallIntrinsicOp>(
+      loc, TypeRange{vecTy}, StringAttr::get(ctx, intrinsic),
+      ValueRange{acc, lhs, rhs},
+      LLVM::FastmathFlagsAttr::get(ctx, LLVM::FastmathFlags::none));
+  return callIntrOp.getResult(0);
+}
+
+// Rearrange RHS [K, N] to [K / groupSize, N] where each i32 element holds
+// groupSize subsequent K elements of a column.
+Value packRhs(Location loc, Value rhs, int64_t groupSize,
+              PatternRewriter &rewriter) {
+  auto rhsTy = cast<VectorType>(rhs.getType());
+  int64_t k = rhsTy.getDimSize(0);
+  int64_t n = rhsTy.getDimSize(1);
+  Type elemTy = rhsTy.getElementType();
+  Value res = rewriter.create<vector::ShapeCastOp>(
+      loc, VectorType::get({k / groupSize, groupSize, n}, elemTy), rhs);
+  res = rewriter.create<vector::TransposeOp>(loc, res,
+                                             ArrayRef<int64_t>{0, 2, 1});
+  res = rewriter.create<vector::ShapeCastOp>(
+      loc, VectorType::get({k / groupSize, n * groupSize}, elemTy), res);
+  return rewriter.create<vector::BitCastOp>(
+      loc, VectorType::get({k / groupSize, n}, rewriter.getI32Type()), res);
+}
+
+// Split rows of a 2D vector into vectors of vecSize elements.
+SmallVector<SmallVector<Value>> extractVecs(Location loc, Value val,
+                                            int64_t vecSize,
+                                            PatternRewriter &rewriter) {
+  auto valTy = cast<VectorType>(val.getType());
+  SmallVector<SmallVector<Value>> res;
+  for (int64_t m = 0; m < valTy.getDimSize(0); ++m) {
+    Value row = rewriter.create<vector::ExtractOp>(loc, val, m);
+    res.emplace_back();
+    for (int64_t n = 0; n < valTy.getDimSize(1); n += vecSize)
+      res.back().push_back(rewriter.create<vector::ExtractStridedSliceOp>(
+          loc, row, ArrayRef<int64_t>{n}, ArrayRef<int64_t>{vecSize},
+          ArrayRef<int64_t>{1}));
+  }
+  return res;
+}
+
+Value mergeVecs(Location loc, VectorType resTy,
+                const SmallVector<SmallVector<Value>> &vecs,
+                PatternRewriter &rewriter) {
+  Value res =
+      rewriter.create<arith::ConstantOp>(loc, rewriter.getZeroAttr(resTy));
+  VectorType rowTy =
+      VectorType::get(resTy.getDimSize(1), resTy.getElementType());
+  for (int64_t m = 0; m < vecs.size(); ++m) {
+    Value row =
+        rewriter.create<arith::ConstantOp>(loc, rewriter.getZeroAttr(rowTy));
+    int64_t vecSize = cast<VectorType>(vecs[m][0].getType()).getDimSize(0);
+    for (int64_t i = 0; i < vecs[m].size(); ++i)
+      row = rewriter.create<vector::InsertStridedSliceOp>(
+          loc, vecs[m][i], row, ArrayRef<int64_t>{i * vecSize},
+          ArrayRef<int64_t>{1});
+    res = rewriter.create<vector::InsertOp>(loc, row, res, m);
+  }
+  return res;
+}
+
+LogicalResult convertCandidate(VnniDotOpCandidate &candidate,
+                               PatternRewriter &rewriter) {
+  cpu::DotOp op = candidate.op;
+  Location loc = op.getLoc();
+  VectorType lhsTy = op.getA().getType();
+  VectorType accTy = op.getC().getType();
+  int64_t groupSize = candidate.groupSize;
+  int64_t vecSize = candidate.vecSize;
+  int64_t groups = lhsTy.getDimSize(1) / groupSize;
+  VectorType i32VecTy = VectorType::get(vecSize, rewriter.getI32Type());
+
+  // vpdpbusd multiplies unsigned LHS bytes by signed RHS bytes. Signed LHS
+  // is biased by 128 to get unsigned values and the product of the bias and
+  // RHS is subtracted from the result.
+  Value lhs = op.getA();
+  bool biasLhs = groupSize == 4;
+  if (biasLhs) {
+    Value bias = rewriter.create<arith::ConstantOp>(
+        loc, DenseElementsAttr::get(
+                 lhsTy, rewriter.getIntegerAttr(lhsTy.getElementType(), -128)));
+    lhs = rewriter.create<arith::XOrIOp>(loc, lhs, bias);
+  }
+  // Each i32 element of LHS holds a group of K elements for a single row.
+  lhs = rewriter.create<vector::BitCastOp>(
+      loc,
+      VectorType::get({lhsTy.getDimSize(0), groups}, rewriter.getI32Type()),
+      lhs);
+  Value rhs = packRhs(loc, op.getB(), groupSize, rewriter);
+  SmallVector<SmallVector<Value>> rhsVecs =
+      extractVecs(loc, rhs, vecSize, rewriter);
+
+  Value acc = op.getC();
+  scf::ForOp forOp;
+  SmallVector<SmallVector<Value>> accVecs;
+  SmallVector<SmallVector<Value>> accInitVecs;
+  if (candidate.keepAccOnRegs) {
+    // Initial accumulator vectors are extracted before the loop and then
+    // directly used within the loop. Later, new iter values will be added to
+    // add loop carried-dependencies for accumulator vectors.
+    forOp = cast<scf::ForOp>(op->getParentOp());
+    OpBuilder::InsertionGuard g(rewriter);
+    rewriter.setInsertionPoint(forOp);
+    LDBG("Extracting accumulator vectors before the loop.");
+    accInitVecs = extractVecs(loc, getInitAccValue(acc), vecSize, rewriter);
+    accVecs = accInitVecs;
+  } else {
+    accVecs = extractVecs(loc, acc, vecSize, rewriter);
+  }
+
+  SmallVector<Value> biasVecs;
+  Value biasGroup;
+  if (biasLhs) {
+    // Four bytes of 128 each.
+    auto biasGroupAttr = rewriter.getI32IntegerAttr(
+        static_cast<int32_t>(0x80808080));
+    biasGroup = rewriter.create<arith::ConstantOp>(
+        loc, DenseElementsAttr::get(i32VecTy, biasGroupAttr));
+    Value zero =
+        rewriter.create<arith::ConstantOp>(loc, rewriter.getZeroAttr(i32VecTy));
+    biasVecs.assign(candidate.accVecsPerRow, zero);
+  }
+
+  // Each RHS vector is reused for all rows, and each broadcasted LHS group
+  // is reused for all vectors in a row.
+  for (int64_t k = 0; k < groups; ++k) {
+    for (int64_t n = 0; n < candidate.accVecsPerRow && biasLhs; ++n)
+      biasVecs[n] = vnniDot(loc, groupSize, biasVecs[n], biasGroup,
+                            rhsVecs[k][n], rewriter);
+    for (int64_t m = 0; m < candidate.accRows; ++m) {
+      Value lhsGroup = rewriter.create<vector::ExtractOp>(
+          loc, lhs, ArrayRef<int64_t>{m, k});
+      Value lhsBroadcasted =
+          rewriter.create<vector::BroadcastOp>(loc, i32VecTy, lhsGroup);
+      for (int64_t n = 0; n < candidate.accVecsPerRow; ++n)
+        accVecs[m][n] = vnniDot(loc, groupSize, accVecs[m][n], lhsBroadcasted,
+                                rhsVecs[k][n], rewriter);
+    }
+  }
+
+  if (biasLhs) {
+    for (int64_t m = 0; m < candidate.accRows; ++m)
+      for (int64_t n = 0; n < candidate.accVecsPerRow; ++n)
+        accVecs[m][n] =
+            rewriter.create<arith::SubIOp>(loc, accVecs[m][n], biasVecs[n]);
+  }
+
+  if (candidate.keepAccOnRegs) {
+    // We don't need the original accumulator and dot op anymore. Directly
+    // yield orig accumulator value, so it would be later removed as unused.
+    int64_t origResIdx = op.getResult().getUses().begin()->getOperandNumber();
+    rewriter.replaceOp(op, op.getC());
+
+    // Replace the loop with a new one to add loop carried dependency for
+    // accumulator vectors.
+    LDBG("Rewrite loop to introduce loop carried dependencies for accumulator "
+         "vectors.");
+    SmallVector<Value> newInitOperands;
+    SmallVector<Value> newYieldedValues;
+    for (int64_t m = 0; m < candidate.accRows; ++m) {
+      for (int64_t n = 0; n < candidate.accVecsPerRow; ++n) {
+        newInitOperands.push_back(accInitVecs[m][n]);
+        newYieldedValues.push_back(accVecs[m][n]);
+      }
+    }
+    auto newForOp = cast<scf::ForOp>(*forOp.replaceWithAdditionalYields(
+        rewriter, newInitOperands, true,
+        [&newYieldedValues](OpBuilder &b, Location loc,
+                            ArrayRef<BlockArgument> newBBArgs) {
+          return newYieldedValues;
+        }));
+
+    // The resulting vectors are now in the new loop results.
+    auto resVecs = newForOp.getResults().take_back(newYieldedValues.size());
+    for (int64_t m = 0; m < candidate.accRows; ++m)
+      for (int64_t n = 0; n < candidate.accVecsPerRow; ++n)
+        accVecs[m][n] = resVecs[m * candidate.accVecsPerRow + n];
+
+    OpBuilder::InsertionGuard g(rewriter);
+    rewriter.setInsertionPointAfter(newForOp);
+    LDBG("Merging resulting vectors to replace loop result.");
+    Value newVal = mergeVecs(loc, accTy, accVecs, rewriter);
+    rewriter.replaceAllUsesWith(newForOp.getResult(origResIdx), newVal);
+  } else {
+    LDBG("Merging resulting vectors to replace orig op result.");
+    Value newVal = mergeVecs(loc, accTy, accVecs, rewriter);
+    rewriter.replaceOp(op, newVal);
+  }
+
+  return success();
+}
+
+struct ConvertDotToVNNI
+    : public triton::cpu::impl::ConvertDotToVNNIBase<ConvertDotToVNNI> {
+  ConvertDotToVNNI() = default;
+  ConvertDotToVNNI(bool useAvx512) { this->useAvx512 = useAvx512; }
+
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    SmallVector<VnniDotOpCandidate, 1> candidates;
+    mod->walk([this, &candidates](cpu::DotOp op) {
+      VnniDotOpCandidate candidate;
+      if (isVnniCandidate(op, useAvx512, candidate)) {
+        LLVM_DEBUG({
+          LDBG("Found VNNI candidate");
+          LDBG("  Op: " << candidate.op);
+          LDBG("  GroupSize: " << candidate.groupSize);
+          LDBG("  VecSize: " << candidate.vecSize);
+          LDBG("  AccRows: " << candidate.accRows);
+          LDBG("  AccVecsPerRow: " << candidate.accVecsPerRow);
+          LDBG("  KeepAccOnRegs: " << candidate.keepAccOnRegs);
+        });
+        candidates.push_back(candidate);
+      }
+      return WalkResult::advance();
+    });
+
+    for (auto &candidate : candidates) {
+      LDBG("Starting conversion of candidate: " << candidate.op);
+      PatternRewriter rewriter(context);
+      rewriter.setInsertionPoint(candidate.op);
+      if (succeeded(convertCandidate(candidate, rewriter))) {
+        LDBG("Conversion succeeded!");
+      } else {
+        LDBG("Conversion failed!");
+      }
+    }
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createConvertDotToVNNI() {
+  return std::make_unique<ConvertDotToVNNI>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertDotToVNNI(bool useAvx512) {
+  return std::make_unique<ConvertDotToVNNI>(useAvx512);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
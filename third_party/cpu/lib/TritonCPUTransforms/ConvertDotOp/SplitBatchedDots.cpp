@@ -0,0 +1,213 @@
+#include "ConvertDotCommon.h"
+
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Pass/Pass.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_SPLITBATCHEDDOTS
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Check if the batched value is read from memory with a single read that
+// can be split into rank-reducing reads of its batch slices.
+vector::TransferReadOp getSplittableRead(Value val) {
+  auto readOp = val.getDefiningOp<vector::TransferReadOp>();
+  if (!readOp || hasMaskOrBoundsCheck(readOp) ||
+      !isa<MemRefType>(readOp.getShapedType()) ||
+      !readOp.getPermutationMap().isMinorIdentity())
+    return nullptr;
+  return readOp;
+}
+
+// Check if the batched value is only written to memory with a single write
+// that can be split into rank-reducing writes of its batch slices.
+vector::TransferWriteOp getSplittableWrite(Value val) {
+  if (!val.hasOneUse())
+    return nullptr;
+  auto writeOp = dyn_cast<vector::TransferWriteOp>(*val.getUsers().begin());
+  if (!writeOp || hasMaskOrBoundsCheck(writeOp) ||
+      !isa<MemRefType>(writeOp.getShapedType()) ||
+      !writeOp.getPermutationMap().isMinorIdentity())
+    return nullptr;
+  return writeOp;
+}
+
+// Get indices of the batch slice idx in memory accessed with the specified
+// indices. The batch dimension is the third innermost one.
+SmallVector<Value> getSliceIndices(Location loc, ValueRange indices,
+                                   int64_t idx, PatternRewriter &rewriter) {
+  SmallVector<Value> res(indices.begin(), indices.end());
+  int64_t batchDim = res.size() - 3;
+  res[batchDim] = shiftIndex(loc, res[batchDim], idx, rewriter);
+  return res;
+}
+
+// Get the batch slice idx of a dot operand. Reads from memory, including
+// transposed ones, are split into reads of the same memory, so that dot
+// lowerings can still find the input buffers. Other values are sliced in
+// registers.
+Value getBatchSlice(Location loc, Value val, int64_t idx,
+                    PatternRewriter &rewriter) {
+  Value src = val;
+  bool transposed = false;
+  if (auto transposeOp = val.getDefiningOp<vector::TransposeOp>()) {
+    if (llvm::equal(transposeOp.getPermutation(),
+                    ArrayRef<int64_t>{0, 2, 1})) {
+      src = transposeOp.getVector();
+      transposed = true;
+    }
+  }
+
+  auto readOp = getSplittableRead(src);
+  if (!readOp)
+    return op_extract(val, idx);
+
+  VectorType srcTy = readOp.getVectorType();
+  auto sliceTy =
+      VectorType::get(srcTy.getShape().drop_front(), srcTy.getElementType());
+  SmallVector<Value> indices =
+      getSliceIndices(loc, readOp.getIndices(), idx, rewriter);
+  Value slice = op_read(sliceTy, readOp.getSource(), indices);
+  if (transposed)
+    slice = rewriter.create<vector::TransposeOp>(loc, slice,
+                                                 ArrayRef<int64_t>{1, 0});
+  return slice;
+}
+
+// Collect 2D batch slices into a batched vector.
+Value mergeBatchSlices(Location loc, VectorType resTy, ValueRange slices,
+                       PatternRewriter &rewriter) {
+  Value res = rewriter.create<arith::ConstantOp>(loc, resTy,
+                                                 rewriter.getZeroAttr(resTy));
+  for (auto [idx, slice] : llvm::enumerate(slices))
+    res = rewriter.create<vector::InsertOp>(loc, slice, res, idx);
+  return res;
+}
+
+// Replace a 3D dot with 2D dots of its batch slices.
+void splitBatchedDot(cpu::DotOp op, PatternRewriter &rewriter) {
+  Location loc = op.getLoc();
+  Value acc = op.getC();
+  auto accTy = cast<VectorType>(acc.getType());
+  int64_t batchSize = accTy.getDimSize(0);
+
+  SmallVector<Value> lhsSlices;
+  SmallVector<Value> rhsSlices;
+  for (int64_t idx = 0; idx < batchSize; ++idx) {
+    lhsSlices.push_back(getBatchSlice(loc, op.getA(), idx, rewriter));
+    rhsSlices.push_back(getBatchSlice(loc, op.getB(), idx, rewriter));
+  }
+
+  auto createDot = [&](OpBuilder &b, int64_t idx, Value accSlice) {
+    return b
+        .create<cpu::DotOp>(loc, lhsSlices[idx], rhsSlices[idx], accSlice,
+                            op.getInputPrecision(), op.getMaxNumImpreciseAcc())
+        .getResult();
+  };
+
+  if (isLoopCarriedAcc(acc)) {
+    // Carry accumulator slices through the loop separately, so that 2D dot
+    // lowerings can keep them in registers or tiles.
+    auto forOp = cast<scf::ForOp>(op->getParentOp());
+    SmallVector<Value> initSlices;
+    {
+      OpBuilder::InsertionGuard g(rewriter);
+      rewriter.setInsertionPoint(forOp);
+      Value init = getInitAccValue(acc);
+      for (int64_t idx = 0; idx < batchSize; ++idx)
+        initSlices.push_back(op_extract(init, idx));
+    }
+
+    // Directly yield the original accumulator, so it would be later removed
+    // as unused.
+    int64_t origResIdx = op.getResult().getUses().begin()->getOperandNumber();
+    rewriter.replaceOp(op, acc);
+
+    auto newForOp = cast<scf::ForOp>(*forOp.replaceWithAdditionalYields(
+        rewriter, initSlices, true,
+        [&](OpBuilder &b, Location loc, ArrayRef<BlockArgument> newBBArgs) {
+          SmallVector<Value> resSlices;
+          for (int64_t idx = 0; idx < batchSize; ++idx)
+            resSlices.push_back(createDot(b, idx, newBBArgs[idx]));
+          return resSlices;
+        }));
+
+    OpBuilder::InsertionGuard g(rewriter);
+    rewriter.setInsertionPointAfter(newForOp);
+    Value res = mergeBatchSlices(loc, accTy,
+                                 newForOp.getResults().take_back(batchSize),
+                                 rewriter);
+    rewriter.replaceAllUsesWith(newForOp.getResult(origResIdx), res);
+    return;
+  }
+
+  SmallVector<Value> resSlices;
+  for (int64_t idx = 0; idx < batchSize; ++idx)
+    resSlices.push_back(
+        createDot(rewriter, idx, getBatchSlice(loc, acc, idx, rewriter)));
+
+  // Store result slices directly to memory, so that dot lowerings can use
+  // it as the output buffer.
+  if (auto writeOp = getSplittableWrite(op.getResult())) {
+    rewriter.setInsertionPoint(writeOp);
+    for (auto [idx, slice] : llvm::enumerate(resSlices)) {
+      SmallVector<Value> indices =
+          getSliceIndices(loc, writeOp.getIndices(), idx, rewriter);
+      op_write(slice, writeOp.getSource(), indices);
+    }
+    rewriter.eraseOp(writeOp);
+    rewriter.eraseOp(op);
+    return;
+  }
+
+  rewriter.replaceOp(op, mergeBatchSlices(loc, accTy, resSlices, rewriter));
+}
+
+struct SplitBatchedDots
+    : public mlir::triton::cpu::impl::SplitBatchedDotsBase<SplitBatchedDots> {
+  SplitBatchedDots() = default;
+
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    SmallVector<cpu::DotOp> batchedDots;
+    mod->walk([&batchedDots](cpu::DotOp op) {
+      if (cast<VectorType>(op.getC().getType()).getRank() == 3)
+        batchedDots.push_back(op);
+    });
+
+    for (auto op : batchedDots) {
+      LDBG("Splitting batched dot: " << op);
+      PatternRewriter rewriter(context);
+      rewriter.setInsertionPoint(op);
+      splitBatchedDot(op, rewriter);
+    }
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createSplitBatchedDots() {
+  return std::make_unique<SplitBatchedDots>();
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
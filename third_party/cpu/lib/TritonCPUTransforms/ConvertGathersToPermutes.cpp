@@ -0,0 +1,224 @@
+#include "cpu/include/TritonCPUTransforms/OptCommon.h"
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_CONVERTGATHERSTOPERMUTES
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+Value callIntrinsic(Location loc, StringRef name, Type resTy,
+                    ValueRange args, PatternRewriter &rewriter) {
+  MLIRContext *ctx = rewriter.getContext();
+  return rewriter
+      .create<LLVM::CallIntrinsicOp>(
+          loc, TypeRange{resTy}, StringAttr::get(ctx, name), args,
+          LLVM::FastmathFlagsAttr::get(ctx, LLVM::FastmathFlags::none))
+      .getResult(0);
+}
+
+// Return the vector stored to the whole buffer by its only store, if the
+// buffer is otherwise only read by gathers and the store precedes the
+// gather in its block.
+Value getStoredTable(vector::GatherOp op) {
+  auto alloca = op.getBase().getDefiningOp<memref::AllocaOp>();
+  if (!alloca || alloca.getType().getRank() != 1 ||
+      !alloca.getType().hasStaticShape())
+    return nullptr;
+  vector::StoreOp store;
+  for (Operation *user : alloca->getUsers()) {
+    if (isa<vector::GatherOp>(user))
+      continue;
+    auto userStore = dyn_cast<vector::StoreOp>(user);
+    if (!userStore || store)
+      return nullptr;
+    store = userStore;
+  }
+  if (!store || store->getBlock() != op->getBlock() ||
+      !store->isBeforeInBlock(op) ||
+      !matchPattern(store.getIndices()[0], m_Zero()) ||
+      store.getVectorType().getNumElements() !=
+          alloca.getType().getNumElements())
+    return nullptr;
+  return store.getValueToStore();
+}
+
+// Replace gathers of 32-bit elements from small tables stored to temporary
+// buffers, e.g. by tt.gather lowering, with permutes of the table held in
+// registers: vpermd or vpermi2d of AVX512 for up to 32 entries, vpermd of
+// AVX2 for up to 8 entries, or NEON tbl of 32-bit lanes split into bytes for
+// up to 16 entries. Indices are processed a register at a time.
+struct GatherToPermutes : public OpRewritePattern<vector::GatherOp> {
+  GatherToPermutes(MLIRContext *context, unsigned lookupBits)
+      : OpRewritePattern(context), lookupBits(lookupBits) {}
+
+  LogicalResult matchAndRewrite(vector::GatherOp op,
+                                PatternRewriter &rewriter) const override {
+    Location loc = op.getLoc();
+    VectorType resTy = op.getVectorType();
+    VectorType idxTy = op.getIndexVectorType();
+    if (resTy.getRank() != 1 || resTy.getElementTypeBitWidth() != 32 ||
+        !idxTy.getElementType().isInteger(32) ||
+        !matchPattern(op.getMask(), m_One()) ||
+        !matchPattern(op.getIndices()[0], m_Zero()))
+      return failure();
+
+    Value table = getStoredTable(op);
+    if (!table)
+      return failure();
+    int64_t tableSize = cast<VectorType>(table.getType()).getNumElements();
+    if (tableSize > getMaxTableSize())
+      return failure();
+
+    int64_t lanes = lookupBits / 32;
+    auto regTy = VectorType::get(lanes, rewriter.getI32Type());
+    Value intTable = op_bitcast(toInt32(table.getType()), table);
+    SmallVector<Value> tableRegs;
+    for (int64_t offs = 0; offs < tableSize; offs += lanes)
+      tableRegs.push_back(getPadded(loc, intTable, offs, regTy, rewriter));
+
+    int64_t numElems = resTy.getNumElements();
+    int64_t paddedElems = llvm::alignTo(numElems, lanes);
+    auto paddedTy = VectorType::get(paddedElems, rewriter.getI32Type());
+    Value res = rewriter.create<arith::ConstantOp>(
+        loc, paddedTy, rewriter.getZeroAttr(paddedTy));
+    for (int64_t offs = 0; offs < numElems; offs += lanes) {
+      Value idx = getPadded(loc, op.getIndexVec(), offs, regTy, rewriter);
+      Value chunk = lookup(loc, tableRegs, idx, rewriter);
+      res = rewriter.create<vector::InsertStridedSliceOp>(
+          loc, chunk, res, ArrayRef<int64_t>{offs}, ArrayRef<int64_t>{1});
+    }
+    if (paddedElems != numElems)
+      res = rewriter.create<vector::ExtractStridedSliceOp>(
+          loc, res, ArrayRef<int64_t>{0}, ArrayRef<int64_t>{numElems},
+          ArrayRef<int64_t>{1});
+    Value alloca = op.getBase();
+    rewriter.replaceOp(op, op_bitcast(resTy, res));
+
+    // Drop the buffer once the last gather from it is replaced.
+    if (alloca.hasOneUse()) {
+      rewriter.eraseOp(*alloca.user_begin());
+      rewriter.eraseOp(alloca.getDefiningOp());
+    }
+    return success();
+  }
+
+  int64_t getMaxTableSize() const {
+    if (lookupBits == 512)
+      return 32;
+    if (lookupBits == 256)
+      return 8;
+    return 16;
+  }
+
+  // Slice of a register size starting at offs, padded with zeros.
+  Value getPadded(Location loc, Value vec, int64_t offs, VectorType regTy,
+                  PatternRewriter &rewriter) const {
+    int64_t numElems = cast<VectorType>(vec.getType()).getNumElements();
+    int64_t lanes = regTy.getNumElements();
+    if (offs == 0 && numElems == lanes)
+      return vec;
+    int64_t size = std::min(lanes, numElems - offs);
+    Value slice = rewriter.create<vector::ExtractStridedSliceOp>(
+        loc, vec, ArrayRef<int64_t>{offs}, ArrayRef<int64_t>{size},
+        ArrayRef<int64_t>{1});
+    if (size == lanes)
+      return slice;
+    Value zeros = rewriter.create<arith::ConstantOp>(
+        loc, regTy, rewriter.getZeroAttr(regTy));
+    return rewriter.create<vector::InsertStridedSliceOp>(
+        loc, slice, zeros, ArrayRef<int64_t>{0}, ArrayRef<int64_t>{1});
+  }
+
+  Value lookup(Location loc, ArrayRef<Value> tableRegs, Value idx,
+               PatternRewriter &rewriter) const {
+    Type regTy = idx.getType();
+    if (lookupBits == 512) {
+      if (tableRegs.size() == 1)
+        return callIntrinsic(loc, "llvm.x86.avx512.permvar.si.512", regTy,
+                             ValueRange{tableRegs[0], idx}, rewriter);
+      return callIntrinsic(loc, "llvm.x86.avx512.vpermi2var.d.512", regTy,
+                           ValueRange{tableRegs[0], idx, tableRegs[1]},
+                           rewriter);
+    }
+    if (lookupBits == 256)
+      return callIntrinsic(loc, "llvm.x86.avx2.permd", regTy,
+                           ValueRange{tableRegs[0], idx}, rewriter);
+
+    // Bytes of lane i are looked up at 4 * idx[i] + {0, 1, 2, 3}.
+    auto bytesTy = VectorType::get(16, rewriter.getI8Type());
+    Value byteIdx = op_addi(op_muli(idx, cst_like(idx, 0x04040404)),
+                            cst_like(idx, 0x03020100));
+    SmallVector<Value> args;
+    for (Value reg : tableRegs)
+      args.push_back(op_bitcast(bytesTy, reg));
+    args.push_back(op_bitcast(bytesTy, byteIdx));
+    std::string name =
+        "llvm.aarch64.neon.tbl" + std::to_string(tableRegs.size()) + ".v16i8";
+    Value res = callIntrinsic(loc, name, bytesTy, args, rewriter);
+    return op_bitcast(regTy, res);
+  }
+
+private:
+  unsigned lookupBits;
+};
+
+struct ConvertGathersToPermutes
+    : public triton::cpu::impl::ConvertGathersToPermutesBase<
+          ConvertGathersToPermutes> {
+  ConvertGathersToPermutes() = default;
+
+  ConvertGathersToPermutes(unsigned lookupBits) {
+    this->lookupBits = lookupBits;
+  }
+
+  void runOnOperation() override {
+    if (lookupBits != 512 && lookupBits != 256 && lookupBits != 128)
+      return;
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    RewritePatternSet patterns(context);
+    patterns.add<GatherToPermutes>(context, lookupBits);
+    if (failed(mlir::applyPatternsGreedily(mod, std::move(patterns))))
+      return signalPassFailure();
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createConvertGathersToPermutes() {
+  return std::make_unique<ConvertGathersToPermutes>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertGathersToPermutes(unsigned lookupBits) {
+  return std::make_unique<ConvertGathersToPermutes>(lookupBits);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -0,0 +1,139 @@
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_CONVERTIFTOSELECTS
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Cost of executing the ops of a block unconditionally, or nullopt if some of
+// them have side effects, may trap, e.g. divisions by non-constant values, or
+// have regions. Constants are free, other ops cost a unit per native vector
+// of their results.
+std::optional<int64_t> getSpeculationCost(Block *block, unsigned vectorBits) {
+  int64_t cost = 0;
+  for (Operation &op : block->without_terminator()) {
+    if (op.getNumRegions() || !isMemoryEffectFree(&op) || !isSpeculatable(&op))
+      return std::nullopt;
+    if (op.hasTrait<OpTrait::ConstantLike>())
+      continue;
+    for (Type ty : op.getResultTypes()) {
+      auto vecTy = dyn_cast<VectorType>(ty);
+      if (!vecTy) {
+        ++cost;
+        continue;
+      }
+      Type elemTy = vecTy.getElementType();
+      int64_t elemBits = elemTy.isIntOrFloat() ? elemTy.getIntOrFloatBitWidth()
+                                               : 64;
+      cost += std::max<int64_t>(
+          llvm::divideCeil(vecTy.getNumElements() * elemBits, vectorBits), 1);
+    }
+  }
+  return cost;
+}
+
+// Replace an scf.if with vector results and cheap regions with both regions
+// followed by selects of their results. Conditions computed per element,
+// e.g. causal masks of attention blocks, would otherwise mispredict and
+// split vector code at the join.
+struct ConvertIfToSelect : public OpRewritePattern<scf::IfOp> {
+  ConvertIfToSelect(MLIRContext *context, unsigned vectorBits, int64_t maxCost)
+      : OpRewritePattern<scf::IfOp>(context), vectorBits(vectorBits),
+        maxCost(maxCost) {}
+
+  LogicalResult matchAndRewrite(scf::IfOp ifOp,
+                                PatternRewriter &rewriter) const override {
+    if (!ifOp.elseBlock() ||
+        llvm::none_of(ifOp.getResultTypes(),
+                      [](Type ty) { return isa<VectorType>(ty); }))
+      return failure();
+
+    auto thenCost = getSpeculationCost(ifOp.thenBlock(), vectorBits);
+    auto elseCost = getSpeculationCost(ifOp.elseBlock(), vectorBits);
+    if (!thenCost || !elseCost || *thenCost + *elseCost > maxCost)
+      return failure();
+
+    Operation *thenYield = ifOp.thenYield();
+    Operation *elseYield = ifOp.elseYield();
+    SmallVector<Value> thenVals(thenYield->getOperands());
+    SmallVector<Value> elseVals(elseYield->getOperands());
+    rewriter.inlineBlockBefore(ifOp.thenBlock(), ifOp);
+    rewriter.inlineBlockBefore(ifOp.elseBlock(), ifOp);
+    rewriter.eraseOp(thenYield);
+    rewriter.eraseOp(elseYield);
+
+    Location loc = ifOp.getLoc();
+    SmallVector<Value> results;
+    for (auto [thenVal, elseVal] : llvm::zip(thenVals, elseVals)) {
+      if (thenVal == elseVal)
+        results.push_back(thenVal);
+      else
+        results.push_back(rewriter.create<arith::SelectOp>(
+            loc, ifOp.getCondition(), thenVal, elseVal));
+    }
+    rewriter.replaceOp(ifOp, results);
+    return success();
+  }
+
+private:
+  unsigned vectorBits;
+  int64_t maxCost;
+};
+
+struct ConvertIfToSelects
+    : public triton::cpu::impl::ConvertIfToSelectsBase<ConvertIfToSelects> {
+  ConvertIfToSelects() = default;
+
+  ConvertIfToSelects(unsigned vectorBits, int64_t maxCost) {
+    this->vectorBits = vectorBits;
+    this->maxCost = maxCost;
+  }
+
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    RewritePatternSet patterns(context);
+    patterns.add<ConvertIfToSelect>(context, vectorBits, maxCost);
+    if (failed(mlir::applyPatternsGreedily(mod, std::move(patterns))))
+      return signalPassFailure();
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createConvertIfToSelects() {
+  return std::make_unique<ConvertIfToSelects>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertIfToSelects(unsigned vectorBits, int64_t maxCost) {
+  return std::make_unique<ConvertIfToSelects>(vectorBits, maxCost);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
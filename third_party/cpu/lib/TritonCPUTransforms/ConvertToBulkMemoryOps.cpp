@@ -0,0 +1,162 @@
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "triton-cpu-convert-to-bulk-memory-ops"
+#define DBGS() (llvm::dbgs() << "[" DEBUG_TYPE "]: ")
+#define LDBG(X) LLVM_DEBUG(DBGS() << X << "\n")
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_CONVERTTOBULKMEMORYOPS
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Return the pointer a 1-D vector access covers the whole memref from, i.e.
+// a contiguous block lowered by ConvertMemoryOps, or null otherwise.
+Value getBlockPtr(Value memref, ValueRange indices, VectorType vecTy) {
+  auto ptrToMemRefOp = memref.getDefiningOp<PtrToMemRefOp>();
+  auto memRefTy = cast<MemRefType>(memref.getType());
+  if (!ptrToMemRefOp || vecTy.getRank() != 1 || memRefTy.getRank() != 1 ||
+      !memRefTy.getLayout().isIdentity() ||
+      memRefTy.getShape() != vecTy.getShape() || indices.size() != 1 ||
+      !matchPattern(indices[0], m_Zero()))
+    return Value();
+  return ptrToMemRefOp.getSrc();
+}
+
+// Return true if no op between the load and the store may write memory.
+bool isMemoryUnchangedBetween(vector::LoadOp loadOp, vector::StoreOp storeOp) {
+  if (loadOp->getBlock() != storeOp->getBlock() ||
+      !loadOp->isBeforeInBlock(storeOp))
+    return false;
+  for (Operation *op = loadOp->getNextNode(); op != storeOp;
+       op = op->getNextNode()) {
+    auto memInterface = dyn_cast<MemoryEffectOpInterface>(op);
+    if (memInterface ? memInterface.hasEffect<MemoryEffects::Write>()
+                     : !isMemoryEffectFree(op))
+      return false;
+  }
+  return true;
+}
+
+// Return the scalar all elements of the vector are equal to, or null.
+Value getSplatScalar(PatternRewriter &rewriter, Location loc, Value vec) {
+  if (auto broadcastOp = vec.getDefiningOp<vector::BroadcastOp>())
+    return isa<VectorType>(broadcastOp.getSourceType())
+               ? Value()
+               : broadcastOp.getSource();
+  if (auto splatOp = vec.getDefiningOp<vector::SplatOp>())
+    return splatOp.getInput();
+  SplatElementsAttr splatAttr;
+  if (!matchPattern(vec, m_Constant(&splatAttr)))
+    return Value();
+  return rewriter.create<arith::ConstantOp>(
+      loc, splatAttr.getSplatValue<TypedAttr>());
+}
+
+// Turn stores of whole contiguous blocks that are loaded from other
+// pointers, or that hold a single value, into calls of bulk memory routines:
+//   store(dst, load(src)) -> bulk_copy(dst, src)
+//   store(dst, splat(x)) -> bulk_fill(dst, x)
+// Copy and fill kernels then move data with rep movsb or non-temporal
+// stores chosen by the size at run time, instead of a chain of vector
+// registers, which pays off for blocks of several pages.
+struct ConvertStoreToBulkOp : public OpRewritePattern<vector::StoreOp> {
+  ConvertStoreToBulkOp(MLIRContext *context, int64_t minSize)
+      : OpRewritePattern<vector::StoreOp>(context), minSize(minSize) {}
+
+  LogicalResult matchAndRewrite(vector::StoreOp op,
+                                PatternRewriter &rewriter) const override {
+    VectorType vecTy = op.getVectorType();
+    Value dst = getBlockPtr(op.getBase(), op.getIndices(), vecTy);
+    unsigned elemBits = vecTy.getElementTypeBitWidth();
+    if (!dst || elemBits % 8 != 0 ||
+        vecTy.getNumElements() * (elemBits / 8) < minSize)
+      return failure();
+
+    Location loc = op.getLoc();
+    bool nontemporal = op.getNontemporal();
+    if (auto loadOp = op.getValueToStore().getDefiningOp<vector::LoadOp>()) {
+      Value src = getBlockPtr(loadOp.getBase(), loadOp.getIndices(), vecTy);
+      if (!src || !loadOp->hasOneUse() || !isMemoryUnchangedBetween(loadOp, op))
+        return failure();
+      LDBG("Converting to bulk copy: " << op);
+      int64_t size = vecTy.getNumElements() * (elemBits / 8);
+      auto copyOp = rewriter.create<BulkCopyOp>(loc, dst, src, size);
+      copyOp.setNontemporal(nontemporal);
+      rewriter.eraseOp(op);
+      rewriter.eraseOp(loadOp);
+      return success();
+    }
+
+    Value value = getSplatScalar(rewriter, loc, op.getValueToStore());
+    if (!value)
+      return failure();
+    LDBG("Converting to bulk fill: " << op);
+    auto fillOp =
+        rewriter.create<BulkFillOp>(loc, dst, value, vecTy.getNumElements());
+    fillOp.setNontemporal(nontemporal);
+    rewriter.eraseOp(op);
+    return success();
+  }
+
+  int64_t minSize;
+};
+
+struct ConvertToBulkMemoryOps
+    : public triton::cpu::impl::ConvertToBulkMemoryOpsBase<
+          ConvertToBulkMemoryOps> {
+  ConvertToBulkMemoryOps() = default;
+
+  ConvertToBulkMemoryOps(int64_t minSize) { this->minSize = minSize; }
+
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    RewritePatternSet patterns(context);
+    patterns.add<ConvertStoreToBulkOp>(context, minSize);
+    if (failed(mlir::applyPatternsGreedily(mod, std::move(patterns))))
+      return signalPassFailure();
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createConvertToBulkMemoryOps() {
+  return std::make_unique<ConvertToBulkMemoryOps>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertToBulkMemoryOps(int64_t minSize) {
+  return std::make_unique<ConvertToBulkMemoryOps>(minSize);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
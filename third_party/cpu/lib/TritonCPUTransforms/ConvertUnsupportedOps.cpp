@@ -349,7 +349,11 @@ template <typename OpT> struct PromoteOpToFp32 : public OpRewritePattern<OpT> {
 public:
   using OpRewritePattern<OpT>::OpRewritePattern;
 
-  PromoteOpToFp32(MLIRContext *context) : OpRewritePattern<OpT>(context) {}
+  // Keep FP16 operations for targets with native FP16 instructions.
+  bool keepFp16;
+
+  PromoteOpToFp32(MLIRContext *context, bool keepFp16 = false)
+      : OpRewritePattern<OpT>(context), keepFp16(keepFp16) {}
 
   LogicalResult matchAndRewrite(OpT op, PatternRewriter &rewriter) const {
     Location loc = op.getLoc();
@@ -357,6 +361,8 @@ public:
 
     if (!isFp8(opTy) && !isFp16(opTy) && !isBf16(opTy))
       return failure();
+    if (keepFp16 && isFp16(opTy))
+      return failure();
 
     Type fp32Ty = toFp32(opTy);
     SmallVector<Value> fp32Ops;
@@ -375,10 +381,11 @@ struct ConvertUnsupportedOps
 
   ConvertUnsupportedOps(bool promoteBf16ToFp32,
                         bool convertMixedPrecisionMatmul,
-                        bool promoteLibMathToFp32) {
+                        bool promoteLibMathToFp32, bool nativeFp16Math) {
     this->promoteBf16ToFp32 = promoteBf16ToFp32;
     this->convertMixedPrecisionMatmul = convertMixedPrecisionMatmul;
     this->promoteLibMathToFp32 = promoteLibMathToFp32;
+    this->nativeFp16Math = nativeFp16Math;
   }
 
   void runOnOperation() override {
@@ -405,6 +412,9 @@ struct ConvertUnsupportedOps
       patterns.add<ConvertMixedPrecisionMatmul>(context);
     }
     if (promoteLibMathToFp32) {
+      // Rounding, square roots and FMAs are correctly rounded, so native FP16
+      // instructions give the same results as FP32 ones at the doubled SIMD
+      // width. Transcendental functions keep FP32 for accuracy.
       patterns.add<PromoteOpToFp32<math::AcosOp>>(context);
       patterns.add<PromoteOpToFp32<math::AcoshOp>>(context);
       patterns.add<PromoteOpToFp32<math::AsinOp>>(context);
@@ -413,15 +423,15 @@ struct ConvertUnsupportedOps
       patterns.add<PromoteOpToFp32<math::AtanOp>>(context);
       patterns.add<PromoteOpToFp32<math::AtanhOp>>(context);
       patterns.add<PromoteOpToFp32<math::CbrtOp>>(context);
-      patterns.add<PromoteOpToFp32<math::CeilOp>>(context);
+      patterns.add<PromoteOpToFp32<math::CeilOp>>(context, nativeFp16Math);
       patterns.add<PromoteOpToFp32<math::CosOp>>(context);
       patterns.add<PromoteOpToFp32<math::CoshOp>>(context);
       patterns.add<PromoteOpToFp32<math::ErfOp>>(context);
       patterns.add<PromoteOpToFp32<math::ExpOp>>(context);
       patterns.add<PromoteOpToFp32<math::Exp2Op>>(context);
       patterns.add<PromoteOpToFp32<math::ExpM1Op>>(context);
-      patterns.add<PromoteOpToFp32<math::FloorOp>>(context);
-      patterns.add<PromoteOpToFp32<math::FmaOp>>(context);
+      patterns.add<PromoteOpToFp32<math::FloorOp>>(context, nativeFp16Math);
+      patterns.add<PromoteOpToFp32<math::FmaOp>>(context, nativeFp16Math);
       patterns.add<PromoteOpToFp32<math::LogOp>>(context);
       patterns.add<PromoteOpToFp32<math::Log2Op>>(context);
       patterns.add<PromoteOpToFp32<math::Log10Op>>(context);
@@ -430,10 +440,10 @@ struct ConvertUnsupportedOps
       patterns.add<PromoteOpToFp32<math::RsqrtOp>>(context);
       patterns.add<PromoteOpToFp32<math::SinOp>>(context);
       patterns.add<PromoteOpToFp32<math::SinhOp>>(context);
-      patterns.add<PromoteOpToFp32<math::SqrtOp>>(context);
+      patterns.add<PromoteOpToFp32<math::SqrtOp>>(context, nativeFp16Math);
       patterns.add<PromoteOpToFp32<math::TanOp>>(context);
       patterns.add<PromoteOpToFp32<math::TanhOp>>(context);
-      patterns.add<PromoteOpToFp32<math::TruncOp>>(context);
+      patterns.add<PromoteOpToFp32<math::TruncOp>>(context, nativeFp16Math);
     }
 
     if (failed(mlir::applyPatternsGreedily(mod, std::move(patterns))))
@@ -454,9 +464,11 @@ std::unique_ptr<OperationPass<ModuleOp>> createConvertUnsupportedOps() {
 std::unique_ptr<OperationPass<ModuleOp>>
 createConvertUnsupportedOps(bool promoteBf16ToFp32,
                             bool convertMixedPrecisionMatmul,
-                            bool promoteLibMathToFp32) {
+                            bool promoteLibMathToFp32,
+                            bool nativeFp16Math) {
   return std::make_unique<ConvertUnsupportedOps>(
-      promoteBf16ToFp32, convertMixedPrecisionMatmul, promoteLibMathToFp32);
+      promoteBf16ToFp32, convertMixedPrecisionMatmul, promoteLibMathToFp32,
+      nativeFp16Math);
 }
 
 } // namespace cpu
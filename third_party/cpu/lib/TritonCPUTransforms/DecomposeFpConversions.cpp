@@ -9,6 +9,9 @@
 #include "triton/Dialect/Triton/IR/Dialect.h"
 #include "triton/Dialect/TritonCPU/IR/Dialect.h"
 
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "llvm/ADT/APFloat.h"
+
 namespace mlir {
 namespace triton {
 namespace cpu {
@@ -461,6 +464,114 @@ Value convertFpToFp(Location loc, Value src, Type dstTy,
   return fn(loc, src, rewriter);
 }
 
+// FP16 encodings of FP8 values without the sign bit, split into tables of
+// low and high bytes. All FP8 values, including subnormals and NaNs, are
+// exactly representable in FP16.
+void getFp8ToFp16Tables(const llvm::fltSemantics &srcSem,
+                        SmallVectorImpl<int8_t> &lo,
+                        SmallVectorImpl<int8_t> &hi) {
+  for (unsigned code = 0; code < 128; ++code) {
+    llvm::APFloat val(srcSem, llvm::APInt(8, code));
+    bool losesInfo;
+    val.convert(llvm::APFloat::IEEEhalf(), llvm::APFloat::rmNearestTiesToEven,
+                &losesInfo);
+    uint64_t bits = val.bitcastToAPInt().getZExtValue();
+    lo.push_back(static_cast<int8_t>(bits & 0xff));
+    hi.push_back(static_cast<int8_t>(bits >> 8));
+  }
+}
+
+Value byteTable(Location loc, ArrayRef<int8_t> bytes,
+                PatternRewriter &rewriter) {
+  auto ty = VectorType::get(bytes.size(), rewriter.getI8Type());
+  return rewriter.create<arith::ConstantOp>(
+      loc, DenseElementsAttr::get(ty, bytes));
+}
+
+Value callIntrinsic(Location loc, StringRef name, Type resTy,
+                    ValueRange args, PatternRewriter &rewriter) {
+  MLIRContext *ctx = rewriter.getContext();
+  return rewriter
+      .create<LLVM::CallIntrinsicOp>(
+          loc, TypeRange{resTy}, StringAttr::get(ctx, name), args,
+          LLVM::FastmathFlagsAttr::get(ctx, LLVM::FastmathFlags::none))
+      .getResult(0);
+}
+
+// Look up bytes of a 128-entry table for 7-bit indices with vpermi2b of
+// AVX512-VBMI, 64 bytes at a time, or with NEON tbl4/tbx4, 16 bytes at a
+// time.
+Value lookupBytes(Location loc, Value idx, ArrayRef<int8_t> table,
+                  unsigned lookupBits, PatternRewriter &rewriter) {
+  auto idxTy = cast<VectorType>(idx.getType());
+  if (lookupBits == 512) {
+    Value lo = byteTable(loc, table.take_front(64), rewriter);
+    Value hi = byteTable(loc, table.drop_front(64), rewriter);
+    return callIntrinsic(loc, "llvm.x86.avx512.vpermi2var.qi.512", idxTy,
+                         ValueRange{lo, idx, hi}, rewriter);
+  }
+  SmallVector<Value> args;
+  for (int i = 0; i < 4; ++i)
+    args.push_back(byteTable(loc, table.slice(i * 16, 16), rewriter));
+  args.push_back(idx);
+  // Out of range indices give zeros in tbl and keep the first arg in tbx.
+  Value res =
+      callIntrinsic(loc, "llvm.aarch64.neon.tbl4.v16i8", idxTy, args, rewriter);
+  args.clear();
+  args.push_back(res);
+  for (int i = 4; i < 8; ++i)
+    args.push_back(byteTable(loc, table.slice(i * 16, 16), rewriter));
+  args.push_back(op_subi(idx, cst_like(idx, 64)));
+  return callIntrinsic(loc, "llvm.aarch64.neon.tbx4.v16i8", idxTy, args,
+                       rewriter);
+}
+
+// Decode FP8 to FP16 with table lookups of both FP16 bytes, which replaces
+// the shifts and the scaling multiplication of convertFp8. Vectors are
+// processed in chunks of vector registers.
+Value lookupFp8ToFp16(Location loc, Value src, unsigned lookupBits,
+                      PatternRewriter &rewriter) {
+  auto srcTy = cast<VectorType>(src.getType());
+  Type srcElemTy = srcTy.getElementType();
+  SmallVector<int8_t> loTable, hiTable;
+  getFp8ToFp16Tables(cast<FloatType>(srcElemTy).getFloatSemantics(), loTable,
+                     hiTable);
+
+  int64_t numElems = srcTy.getNumElements();
+  int64_t chunkSize = lookupBits / 8;
+  auto flatTy = VectorType::get(numElems, rewriter.getI8Type());
+  Value bytes = rewriter.create<vector::ShapeCastOp>(
+      loc, flatTy, op_bitcast(toInt8(srcTy), src));
+  auto chunkTy = VectorType::get(chunkSize, rewriter.getI8Type());
+  auto chunkResTy = VectorType::get(chunkSize, rewriter.getI16Type());
+  auto resTy = VectorType::get(numElems, rewriter.getI16Type());
+  Value res = rewriter.create<arith::ConstantOp>(
+      loc, resTy, rewriter.getZeroAttr(resTy));
+  for (int64_t offs = 0; offs < numElems; offs += chunkSize) {
+    Value chunk = rewriter.create<vector::ExtractStridedSliceOp>(
+        loc, bytes, ArrayRef<int64_t>{offs}, ArrayRef<int64_t>{chunkSize},
+        ArrayRef<int64_t>{1});
+    Value idx = op_and(chunk, cst_like(chunk, 0x7f));
+    Value lo = lookupBytes(loc, idx, loTable, lookupBits, rewriter);
+    Value hi = lookupBytes(loc, idx, hiTable, lookupBits, rewriter);
+    Value sign = op_and(chunk, cst_like(chunk, 0x80));
+    Value hiBits = op_zext(chunkResTy, op_or(hi, sign));
+    Value chunkRes =
+        op_or(op_shl(hiBits, cst_like(hiBits, 8)), op_zext(chunkResTy, lo));
+    res = rewriter.create<vector::InsertStridedSliceOp>(
+        loc, chunkRes, res, ArrayRef<int64_t>{offs}, ArrayRef<int64_t>{1});
+  }
+  res = rewriter.create<vector::ShapeCastOp>(loc, toInt16(srcTy), res);
+  Value fp16Res = op_bitcast(toFp16(srcTy), res);
+  // Negative zero encodes NaN in FNUZ types.
+  if (isa<Float8E5M2FNUZType>(srcElemTy)) {
+    Value i8Src = op_bitcast(toInt8(srcTy), src);
+    Value isNaN = op_icmp_eq(i8Src, cst_like(i8Src, 0x80));
+    fp16Res = op_select(isNaN, cst_like(fp16Res, std::nan("")), fp16Res);
+  }
+  return fp16Res;
+}
+
 struct RewriteTruncFp8 : public OpRewritePattern<arith::TruncFOp> {
   using OpRewritePattern::OpRewritePattern;
 
@@ -479,7 +590,8 @@ struct RewriteTruncFp8 : public OpRewritePattern<arith::TruncFOp> {
 };
 
 struct RewriteExtFp8 : public OpRewritePattern<arith::ExtFOp> {
-  using OpRewritePattern::OpRewritePattern;
+  RewriteExtFp8(MLIRContext *context, unsigned lookupBits)
+      : OpRewritePattern(context), lookupBits(lookupBits) {}
 
   LogicalResult matchAndRewrite(arith::ExtFOp op,
                                 PatternRewriter &rewriter) const override {
@@ -489,10 +601,31 @@ struct RewriteExtFp8 : public OpRewritePattern<arith::ExtFOp> {
     if (!isFp8(srcTy))
       return failure();
     Type dstTy = op.getType();
-    Value res = convertFpToFp(loc, src, dstTy, std::nullopt, rewriter);
+    Value res;
+    if (canLookup(srcTy)) {
+      res = lookupFp8ToFp16(loc, src, lookupBits, rewriter);
+      if (!isFp16(dstTy))
+        res = rewriter.create<arith::ExtFOp>(loc, dstTy, res);
+    } else {
+      res = convertFpToFp(loc, src, dstTy, std::nullopt, rewriter);
+    }
     rewriter.replaceOp(op, res);
     return success();
   }
+
+  // E5M2 is converted to FP16 with a single shift, other types need scaling
+  // and benefit from lookups. BF16 results are truncated from FP32 ones.
+  bool canLookup(Type srcTy) const {
+    auto vecTy = dyn_cast<VectorType>(srcTy);
+    if (!lookupBits || !vecTy ||
+        vecTy.getNumElements() % (lookupBits / 8) != 0)
+      return false;
+    Type elemTy = vecTy.getElementType();
+    return isa<Float8E4M3FNType, Float8E5M2FNUZType>(elemTy);
+  }
+
+private:
+  unsigned lookupBits;
 };
 
 struct DecomposeFpConversions
@@ -501,9 +634,11 @@ struct DecomposeFpConversions
   DecomposeFpConversions() = default;
 
   DecomposeFpConversions(bool decomposeBf16Conversions,
-                         bool decomposeFp8Conversions) {
+                         bool decomposeFp8Conversions,
+                         unsigned fp8LookupBits) {
     this->decomposeBf16Conversions = decomposeBf16Conversions;
     this->decomposeFp8Conversions = decomposeFp8Conversions;
+    this->fp8LookupBits = fp8LookupBits;
   }
 
   void runOnOperation() override {
@@ -517,7 +652,7 @@ struct DecomposeFpConversions
     }
     if (decomposeFp8Conversions) {
       patterns.add<RewriteTruncFp8>(context);
-      patterns.add<RewriteExtFp8>(context);
+      patterns.add<RewriteExtFp8>(context, fp8LookupBits);
     }
 
     if (failed(mlir::applyPatternsGreedily(mod, std::move(patterns))))
@@ -537,9 +672,10 @@ std::unique_ptr<OperationPass<ModuleOp>> createDecomposeFpConversions() {
 
 std::unique_ptr<OperationPass<ModuleOp>>
 createDecomposeFpConversions(bool decomposeBf16Conversions,
-                             bool decomposeFp8Conversions) {
-  return std::make_unique<DecomposeFpConversions>(decomposeBf16Conversions,
-                                                  decomposeFp8Conversions);
+                             bool decomposeFp8Conversions,
+                             unsigned fp8LookupBits) {
+  return std::make_unique<DecomposeFpConversions>(
+      decomposeBf16Conversions, decomposeFp8Conversions, fp8LookupBits);
 }
 
 } // namespace cpu
@@ -0,0 +1,200 @@
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_FOLDSELECTS
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Return true if both values are the same value or equal constants, e.g.
+// splats of -inf materialized separately for each tl.where.
+bool isSameValue(Value lhs, Value rhs) {
+  if (lhs == rhs)
+    return true;
+  Attribute lhsAttr, rhsAttr;
+  return matchPattern(lhs, m_Constant(&lhsAttr)) &&
+         matchPattern(rhs, m_Constant(&rhsAttr)) && lhsAttr == rhsAttr;
+}
+
+// Merge chains of selects with the same false or true value into a single
+// select by a combined condition, e.g. causal and padding masks of attention
+// scores applied one after another:
+//   select(m1, select(m2, x, f), f) -> select(m1 & m2, x, f)
+//   select(m1, t, select(m2, t, x)) -> select(m1 | m2, t, x)
+// Conditions are combined in mask registers, so a full-tile blend is removed
+// per merged select.
+struct MergeSelectChain : public OpRewritePattern<arith::SelectOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(arith::SelectOp op,
+                                PatternRewriter &rewriter) const override {
+    Value cond = op.getCondition();
+    if (auto inner = op.getTrueValue().getDefiningOp<arith::SelectOp>()) {
+      if (inner->hasOneUse() &&
+          inner.getCondition().getType() == cond.getType() &&
+          isSameValue(inner.getFalseValue(), op.getFalseValue())) {
+        Value newCond = rewriter.create<arith::AndIOp>(op.getLoc(), cond,
+                                                       inner.getCondition());
+        rewriter.replaceOpWithNewOp<arith::SelectOp>(
+            op, newCond, inner.getTrueValue(), op.getFalseValue());
+        return success();
+      }
+    }
+    if (auto inner = op.getFalseValue().getDefiningOp<arith::SelectOp>()) {
+      if (inner->hasOneUse() &&
+          inner.getCondition().getType() == cond.getType() &&
+          isSameValue(inner.getTrueValue(), op.getTrueValue())) {
+        Value newCond = rewriter.create<arith::OrIOp>(op.getLoc(), cond,
+                                                      inner.getCondition());
+        rewriter.replaceOpWithNewOp<arith::SelectOp>(
+            op, newCond, op.getTrueValue(), inner.getFalseValue());
+        return success();
+      }
+    }
+    return failure();
+  }
+};
+
+// Fold a constant false value of a select of a load masked by the same
+// condition into the other value of the load, which masked loads merge into
+// lanes they skip:
+//   select(m, load(p, mask=m), c) -> load(p, mask=m, other=c)
+struct FoldSelectIntoLoad : public OpRewritePattern<arith::SelectOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(arith::SelectOp op,
+                                PatternRewriter &rewriter) const override {
+    auto loadOp = op.getTrueValue().getDefiningOp<triton::LoadOp>();
+    if (!loadOp || !loadOp->hasOneUse() ||
+        loadOp.getMask() != op.getCondition())
+      return failure();
+    TypedAttr falseAttr;
+    if (!matchPattern(op.getFalseValue(), m_Constant(&falseAttr)))
+      return failure();
+
+    // The constant may be defined after the load.
+    rewriter.setInsertionPoint(loadOp);
+    Value other =
+        rewriter.create<arith::ConstantOp>(loadOp.getLoc(), falseAttr);
+    auto newLoad = rewriter.create<triton::LoadOp>(
+        loadOp.getLoc(), loadOp.getPtr(), loadOp.getMask(), other,
+        loadOp.getBoundaryCheck(), loadOp.getPadding(), loadOp.getCache(),
+        loadOp.getEvict(), loadOp.getIsVolatile());
+    rewriter.replaceOp(op, newLoad.getResult());
+    rewriter.eraseOp(loadOp);
+    return success();
+  }
+};
+
+// Return true if no op between the load and the store, which has to follow
+// it in the same block, may write memory.
+bool isMemoryUnchangedBetween(triton::LoadOp loadOp, triton::StoreOp storeOp) {
+  if (loadOp->getBlock() != storeOp->getBlock() ||
+      !loadOp->isBeforeInBlock(storeOp))
+    return false;
+  for (Operation *op = loadOp->getNextNode(); op != storeOp;
+       op = op->getNextNode()) {
+    auto memInterface = dyn_cast<MemoryEffectOpInterface>(op);
+    if (memInterface ? memInterface.hasEffect<MemoryEffects::Write>()
+                     : !isMemoryEffectFree(op))
+      return false;
+  }
+  return true;
+}
+
+// Turn a store of a select between new values and the values loaded from the
+// same pointers into a store masked by the select condition, which leaves
+// the other elements unchanged instead of writing them back:
+//   store(p, select(m, x, load(p, mask)), mask) -> store(p, x, mask & m)
+// Without native masked stores, masked stores are scalarized, so only stores
+// that are already masked are folded.
+struct FoldSelectIntoStore : public OpRewritePattern<triton::StoreOp> {
+  FoldSelectIntoStore(MLIRContext *context, bool nativeMaskedStore)
+      : OpRewritePattern(context), nativeMaskedStore(nativeMaskedStore) {}
+
+  LogicalResult matchAndRewrite(triton::StoreOp op,
+                                PatternRewriter &rewriter) const override {
+    // Block pointers can't be masked, and scalar conditions aren't masks.
+    auto selectOp = op.getValue().getDefiningOp<arith::SelectOp>();
+    auto valueTy = dyn_cast<RankedTensorType>(op.getValue().getType());
+    if (!selectOp || !valueTy || (!nativeMaskedStore && !op.getMask()) ||
+        !isa<RankedTensorType>(op.getPtr().getType()) ||
+        selectOp.getCondition().getType() !=
+            valueTy.clone(rewriter.getI1Type()))
+      return failure();
+    auto loadOp = selectOp.getFalseValue().getDefiningOp<triton::LoadOp>();
+    if (!loadOp || loadOp.getIsVolatile() || loadOp.getPtr() != op.getPtr() ||
+        loadOp.getMask() != op.getMask() ||
+        !isMemoryUnchangedBetween(loadOp, op))
+      return failure();
+
+    Value mask = selectOp.getCondition();
+    if (op.getMask())
+      mask = rewriter.create<arith::AndIOp>(op.getLoc(), op.getMask(), mask);
+    rewriter.replaceOpWithNewOp<triton::StoreOp>(
+        op, op.getPtr(), selectOp.getTrueValue(), mask, op.getCache(),
+        op.getEvict());
+    return success();
+  }
+
+private:
+  bool nativeMaskedStore;
+};
+
+struct FoldSelects : public triton::cpu::impl::FoldSelectsBase<FoldSelects> {
+  FoldSelects() = default;
+
+  FoldSelects(bool nativeMaskedStore) {
+    this->nativeMaskedStore = nativeMaskedStore;
+  }
+
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    RewritePatternSet patterns(context);
+    patterns.add<MergeSelectChain>(context);
+    patterns.add<FoldSelectIntoLoad>(context);
+    patterns.add<FoldSelectIntoStore>(context, nativeMaskedStore);
+
+    if (failed(mlir::applyPatternsGreedily(mod, std::move(patterns))))
+      return signalPassFailure();
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createFoldSelects() {
+  return std::make_unique<FoldSelects>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createFoldSelects(bool nativeMaskedStore) {
+  return std::make_unique<FoldSelects>(nativeMaskedStore);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -0,0 +1,144 @@
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_INSERTPREFETCHES
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+bool isLoopInvariant(scf::ForOp forOp, Value val) {
+  return forOp.isDefinedOutsideOfLoop(val) || matchPattern(val, m_Constant());
+}
+
+// Multiply a loop-invariant step by the prefetch distance. Constants defined
+// in the loop body are cloned, they might follow the load.
+Value scaleStep(OpBuilder &builder, scf::ForOp forOp, Location loc, Value step,
+                unsigned distance) {
+  if (!forOp.isDefinedOutsideOfLoop(step))
+    step = builder.clone(*step.getDefiningOp())->getResult(0);
+  if (distance == 1)
+    return step;
+  Type elemTy = getElementTypeOrSelf(step.getType());
+  TypedAttr distanceAttr = builder.getIntegerAttr(elemTy, distance);
+  if (auto tensorTy = dyn_cast<RankedTensorType>(step.getType()))
+    distanceAttr = SplatElementsAttr::get(tensorTy, distanceAttr);
+  Value scale = builder.create<arith::ConstantOp>(loc, distanceAttr);
+  return builder.create<arith::MulIOp>(loc, step, scale);
+}
+
+// Build the pointer the load reads distance iterations later, or return null
+// if the pointer isn't advanced by a loop-invariant step.
+Value getPrefetchPtr(OpBuilder &builder, scf::ForOp forOp, LoadOp loadOp,
+                     unsigned distance) {
+  auto iterArg = dyn_cast<BlockArgument>(loadOp.getPtr());
+  if (!iterArg || iterArg.getOwner() != forOp.getBody())
+    return nullptr;
+  OpOperand *yieldedOperand = forOp.getTiedLoopYieldedValue(iterArg);
+  if (!yieldedOperand)
+    return nullptr;
+  Value yielded = yieldedOperand->get();
+  Location loc = loadOp.getLoc();
+
+  if (auto advanceOp = yielded.getDefiningOp<AdvanceOp>()) {
+    if (advanceOp.getPtr() != iterArg ||
+        !llvm::all_of(advanceOp.getOffsets(), [&](Value offset) {
+          return isLoopInvariant(forOp, offset);
+        }))
+      return nullptr;
+    SmallVector<Value> offsets;
+    for (Value offset : advanceOp.getOffsets())
+      offsets.push_back(scaleStep(builder, forOp, loc, offset, distance));
+    return builder.create<AdvanceOp>(loc, iterArg.getType(), iterArg, offsets);
+  }
+
+  if (auto addPtrOp = yielded.getDefiningOp<AddPtrOp>()) {
+    if (addPtrOp.getPtr() != iterArg ||
+        !isLoopInvariant(forOp, addPtrOp.getOffset()))
+      return nullptr;
+    Value offset =
+        scaleStep(builder, forOp, loc, addPtrOp.getOffset(), distance);
+    return builder.create<AddPtrOp>(loc, iterArg.getType(), iterArg, offset);
+  }
+
+  return nullptr;
+}
+
+// Locality hint of prefetches of the load from its cache hints of GPU
+// kernels. Streaming loads, e.g. of evict_first, are prefetched with
+// prefetchnta on x86, which keeps them from evicting reused data. Loads
+// caching at the global level with .cg skip L1 with prefetcht1.
+unsigned getLocality(LoadOp loadOp) {
+  if (loadOp.getEvict() == EvictionPolicy::EVICT_FIRST ||
+      loadOp.getCache() == CacheModifier::CS)
+    return 0;
+  if (loadOp.getCache() == CacheModifier::CG &&
+      loadOp.getEvict() != EvictionPolicy::EVICT_LAST)
+    return 2;
+  return 3;
+}
+
+struct InsertPrefetches
+    : public mlir::triton::cpu::impl::InsertPrefetchesBase<InsertPrefetches> {
+  InsertPrefetches() = default;
+
+  InsertPrefetches(unsigned distance) { this->distance = distance; }
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+    mod.walk([&](LoadOp loadOp) {
+      // Only blocks are prefetched, volatile loads are left alone.
+      if (!isa<RankedTensorType>(loadOp.getType()) || loadOp.getIsVolatile())
+        return;
+      unsigned locality = getLocality(loadOp);
+      OpBuilder builder(loadOp);
+      auto forOp = dyn_cast<scf::ForOp>(loadOp->getParentOp());
+      if (forOp && distance > 0) {
+        if (Value ptr = getPrefetchPtr(builder, forOp, loadOp, distance)) {
+          builder.create<PrefetchOp>(loadOp.getLoc(), ptr, locality);
+          return;
+        }
+      }
+      // Lines of streaming loads that aren't prefetched ahead are still
+      // filled non-temporally when prefetched right before the load.
+      if (locality == 0)
+        builder.create<PrefetchOp>(loadOp.getLoc(), loadOp.getPtr(), locality);
+    });
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createInsertPrefetches() {
+  return std::make_unique<InsertPrefetches>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createInsertPrefetches(unsigned distance) {
+  return std::make_unique<InsertPrefetches>(distance);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -0,0 +1,253 @@
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/SCF/Utils/Utils.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+#include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "triton-cpu-interleave-reductions"
+#define DBGS() (llvm::dbgs() << "[" DEBUG_TYPE "]: ")
+#define LDBG(X) LLVM_DEBUG(DBGS() << X << "\n")
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_INTERLEAVEREDUCTIONS
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Return true if partial results of the op can be combined in any order.
+// Max and min are exact in any order, while sums and products are only
+// reassociated with fast math or when the op allows it.
+bool isReassociable(Operation *op, bool reassociateFp) {
+  if (isa<arith::MaximumFOp, arith::MinimumFOp, arith::MaxNumFOp,
+          arith::MinNumFOp>(op))
+    return true;
+  if (!isa<arith::AddFOp, arith::MulFOp>(op))
+    return false;
+  auto fmf = cast<arith::ArithFastMathInterface>(op).getFastMathFlagsAttr();
+  return reassociateFp ||
+         arith::bitEnumContainsAll(fmf.getValue(),
+                                   arith::FastMathFlags::reassoc);
+}
+
+// Return the chain of ops of the loop body combining the iteration argument
+// with other values, each one feeding the next one and the last one yielded
+// back, e.g. acc += x of a row sum. Return an empty chain if values of the
+// chain have other uses, e.g. a running max used by the body.
+SmallVector<Operation *> getReductionChain(scf::ForOp forOp, unsigned idx,
+                                           bool reassociateFp) {
+  SmallVector<Operation *> chain;
+  Operation *yieldOp = forOp.getBody()->getTerminator();
+  Value val = forOp.getRegionIterArgs()[idx];
+  while (val.hasOneUse()) {
+    OpOperand &use = *val.use_begin();
+    Operation *user = use.getOwner();
+    if (user == yieldOp) {
+      if (use.getOperandNumber() != idx)
+        break;
+      return chain;
+    }
+    if (user->getBlock() != forOp.getBody() ||
+        !isReassociable(user, reassociateFp) ||
+        (!chain.empty() && user->getName() != chain.front()->getName()))
+      break;
+    chain.push_back(user);
+    val = user->getResult(0);
+  }
+  return {};
+}
+
+// Neutral value of partial results of the op.
+TypedAttr getIdentityAttr(Operation *op, Type type) {
+  auto elemTy = cast<FloatType>(getElementTypeOrSelf(type));
+  const llvm::fltSemantics &sem = elemTy.getFloatSemantics();
+  APFloat identity =
+      TypeSwitch<Operation *, APFloat>(op)
+          .Case<arith::AddFOp>(
+              [&](auto) { return APFloat::getZero(sem, /*Negative=*/true); })
+          .Case<arith::MulFOp>([&](auto) { return APFloat(sem, 1); })
+          .Case<arith::MaximumFOp>(
+              [&](auto) { return APFloat::getInf(sem, /*Negative=*/true); })
+          .Case<arith::MinimumFOp>([&](auto) { return APFloat::getInf(sem); })
+          .Default([&](auto) { return APFloat::getNaN(sem); });
+  auto attr = FloatAttr::get(elemTy, identity);
+  if (auto vecTy = dyn_cast<VectorType>(type))
+    return cast<TypedAttr>(
+        DenseElementsAttr::get(vecTy, ArrayRef<Attribute>(attr)));
+  return attr;
+}
+
+unsigned getNumVectors(Type type, unsigned vectorBits) {
+  auto vecTy = dyn_cast<VectorType>(type);
+  if (!vecTy)
+    return 1;
+  int64_t bits =
+      vecTy.getNumElements() * vecTy.getElementType().getIntOrFloatBitWidth();
+  return std::max<int64_t>(llvm::divideCeil(bits, vectorBits), 1);
+}
+
+// Give reductions of the loop independent accumulators of interleaved
+// iterations and combine them after the loop:
+//   for (...) acc = acc + x
+//     -> for (... step * 2) { acc0 = acc0 + x(i); acc1 = acc1 + x(i + 1); }
+//        acc = acc0 + acc1
+// The loop is unrolled by the number of accumulators, and remaining
+// iterations run in an epilogue loop from the combined value. Latency of
+// the reduction is then hidden by the other accumulators instead of
+// bounding each iteration, e.g. for GEMV or norms over chunks of rows.
+void interleaveReductions(scf::ForOp forOp, ArrayRef<unsigned> idxs,
+                          unsigned factor, bool reassociateFp) {
+  LDBG("Interleaving " << idxs.size() << " reductions by " << factor);
+  auto unrolled = loopUnrollByFactor(forOp, factor);
+  if (failed(unrolled) || !unrolled->mainLoopOp)
+    return;
+  scf::ForOp mainLoop = *unrolled->mainLoopOp;
+
+  // Chains of unrolled copies of the reduction, each one feeding the next.
+  SmallVector<std::pair<unsigned, SmallVector<Operation *>>> chains;
+  for (unsigned idx : idxs) {
+    auto chain = getReductionChain(mainLoop, idx, reassociateFp);
+    if (chain.size() == factor)
+      chains.emplace_back(idx, std::move(chain));
+  }
+  if (chains.empty())
+    return;
+
+  IRRewriter rewriter(mainLoop);
+  Location loc = mainLoop.getLoc();
+  SmallVector<Value> inits;
+  for (auto &[idx, chain] : chains) {
+    Type type = mainLoop.getRegionIterArgs()[idx].getType();
+    Value identity = rewriter.create<arith::ConstantOp>(
+        loc, getIdentityAttr(chain.front(), type));
+    inits.append(factor - 1, identity);
+  }
+  auto newLoop = cast<scf::ForOp>(*mainLoop.replaceWithAdditionalYields(
+      rewriter, inits, false,
+      [&](OpBuilder &b, Location loc, ArrayRef<BlockArgument> newBBArgs) {
+        SmallVector<Value> vals;
+        for (auto &[idx, chain] : chains)
+          for (Operation *op : ArrayRef(chain).drop_front())
+            vals.push_back(op->getResult(0));
+        return vals;
+      }));
+
+  // Each copy now updates its own accumulator.
+  auto yieldOp = cast<scf::YieldOp>(newLoop.getBody()->getTerminator());
+  auto newArgs = newLoop.getRegionIterArgs().take_back(inits.size());
+  auto newResults = newLoop.getResults().take_back(inits.size());
+  unsigned pos = 0;
+  for (auto &[idx, chain] : chains) {
+    yieldOp.setOperand(idx, chain.front()->getResult(0));
+    for (unsigned i = 1; i < factor; ++i) {
+      Operation *op = chain[i];
+      Value prev = chain[i - 1]->getResult(0);
+      op->setOperand(op->getOperand(0) == prev ? 0 : 1, newArgs[pos + i - 1]);
+    }
+
+    rewriter.setInsertionPointAfter(newLoop);
+    Value res = newLoop.getResult(idx);
+    Value combined = res;
+    Operation *firstCombine = nullptr;
+    for (unsigned i = 1; i < factor; ++i) {
+      Operation *combine = rewriter.clone(*chain.front());
+      combine->setOperands({combined, newResults[pos + i - 1]});
+      firstCombine = firstCombine ? firstCombine : combine;
+      combined = combine->getResult(0);
+    }
+    rewriter.replaceAllUsesExcept(res, combined, firstCombine);
+    pos += factor - 1;
+  }
+}
+
+struct InterleaveReductions
+    : public triton::cpu::impl::InterleaveReductionsBase<
+          InterleaveReductions> {
+  InterleaveReductions() = default;
+
+  InterleaveReductions(unsigned vectorBits, unsigned maxAccumulators,
+                       unsigned minInFlightVectors, bool reassociateFp) {
+    this->vectorBits = vectorBits;
+    this->maxAccumulators = maxAccumulators;
+    this->minInFlightVectors = minInFlightVectors;
+    this->reassociateFp = reassociateFp;
+  }
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+    // Loops are collected first, since unrolling a loop replaces it.
+    SmallVector<scf::ForOp> loops;
+    mod.walk([&](scf::ForOp forOp) { loops.push_back(forOp); });
+    for (scf::ForOp forOp : loops) {
+      // Only flat loop bodies are unrolled to bound code growth.
+      if (llvm::any_of(forOp.getBody()->without_terminator(),
+                       [](Operation &op) { return op.getNumRegions(); }))
+        continue;
+
+      SmallVector<unsigned> idxs;
+      unsigned factor = 1;
+      for (auto [idx, arg] : llvm::enumerate(forOp.getRegionIterArgs())) {
+        auto chain = getReductionChain(forOp, idx, reassociateFp);
+        if (chain.size() != 1)
+          continue;
+        // Reductions of enough native vectors are already independent.
+        unsigned numVectors = getNumVectors(arg.getType(), vectorBits);
+        unsigned accFactor = std::min<unsigned>(
+            maxAccumulators, llvm::divideCeil(minInFlightVectors, numVectors));
+        if (accFactor <= 1)
+          continue;
+        idxs.push_back(idx);
+        factor = std::max(factor, accFactor);
+      }
+      if (idxs.empty())
+        continue;
+
+      // Loops of a few iterations don't have latency to hide.
+      auto lower = getConstantIntValue(forOp.getLowerBound());
+      auto upper = getConstantIntValue(forOp.getUpperBound());
+      auto step = getConstantIntValue(forOp.getStep());
+      if (lower && upper && step && *step > 0 &&
+          *upper - *lower < 2 * factor * *step)
+        continue;
+      interleaveReductions(forOp, idxs, factor, reassociateFp);
+    }
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createInterleaveReductions() {
+  return std::make_unique<InterleaveReductions>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createInterleaveReductions(unsigned vectorBits, unsigned maxAccumulators,
+                           unsigned minInFlightVectors, bool reassociateFp) {
+  return std::make_unique<InterleaveReductions>(
+      vectorBits, maxAccumulators, minInFlightVectors, reassociateFp);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -1,13 +1,25 @@
 #include "cpu/include/TritonCPUTransforms/OptCommon.h"
 #include "cpu/include/TritonCPUTransforms/Passes.h"
 
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/Interfaces/LoopLikeInterface.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 
 #include "triton/Dialect/Triton/IR/Dialect.h"
 #include "triton/Dialect/TritonCPU/IR/Dialect.h"
 
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/MathExtras.h"
+
+#include <numeric>
+#include <optional>
+
 namespace mlir {
 namespace triton {
 namespace cpu {
@@ -126,6 +138,22 @@ struct CdivToDiv : public OpRewritePattern<arith::DivSIOp> {
   }
 };
 
+// Return size if val is (size + divisor - 1), the dividend of
+// cdiv(size, divisor).
+Value getCdivDividend(Value val, int64_t divisor) {
+  auto addOp = val.getDefiningOp<arith::AddIOp>();
+  if (!addOp)
+    return nullptr;
+  for (auto [cstVal, size] : {std::make_pair(addOp.getRhs(), addOp.getLhs()),
+                              std::make_pair(addOp.getLhs(), addOp.getRhs())}) {
+    auto cst = cstVal.getDefiningOp<arith::ConstantOp>();
+    auto intAttr = cst ? dyn_cast<IntegerAttr>(cst.getValue()) : nullptr;
+    if (intAttr && intAttr.getInt() == divisor - 1)
+      return size;
+  }
+  return nullptr;
+}
+
 // This pattern rewrites for-loops used for tiling to optimize out division
 // and multiplication using divisibility hints.
 // Typical tiled loop looks like:
@@ -135,6 +163,8 @@ struct CdivToDiv : public OpRewritePattern<arith::DivSIOp> {
 // If size is known to be divisible by TILE_SIZE then it can be written as:
 //   for offs in range(0, size, TILE_SIZE):
 //     ...
+// The same holds for an upper bound of tl.cdiv(size, TILE_SIZE) computed as
+// (size + TILE_SIZE - 1) / TILE_SIZE with any size.
 // This pattern is used after an attempt to replace cdiv with a regular
 // division. Possible input pattern is:
 //   %c0 = arith.constant 0 : index
@@ -194,8 +224,17 @@ struct ScaleInductionVariable : public OpRewritePattern<scf::ForOp> {
 
     int64_t scaleVal = cast<IntegerAttr>(scaleDef.getValue()).getInt();
     int64_t divisorVal = cast<IntegerAttr>(divRhsDef.getValue()).getInt();
-    if (scaleVal != divisorVal || !isAlwaysDivisible(divLhs, scaleVal) ||
-        lowerVal % scaleVal != 0)
+    if (scaleVal != divisorVal || lowerVal % scaleVal != 0)
+      return failure();
+
+    // New Upper bound. For cdiv(size, TILE_SIZE), the loop runs over all tiles
+    // starting below size the same way, so size doesn't have to be divisible.
+    Value newUpper;
+    if (isAlwaysDivisible(divLhs, scaleVal))
+      newUpper = divLhs;
+    else if (Value size = getCdivDividend(divLhs, scaleVal))
+      newUpper = size;
+    else
       return failure();
 
     // Build new lower bound.
@@ -205,8 +244,6 @@ struct ScaleInductionVariable : public OpRewritePattern<scf::ForOp> {
       newLower = rewriter.create<arith::ConstantIntOp>(
           lower.getLoc(), lowerVal * scaleVal, lower.getType());
     }
-    // New Upper bound.
-    Value newUpper = divLhs;
     // Build new step.
     rewriter.setInsertionPoint(op);
     auto newStep = rewriter.create<arith::MulIOp>(ivUse.getLoc(), step, scale);
@@ -225,12 +262,37 @@ struct ScaleInductionVariable : public OpRewritePattern<scf::ForOp> {
   }
 };
 
+// Return true if the value is known to be non-negative without range
+// analysis, e.g. a program id.
+bool isNonNegative(Value val) {
+  if (auto cst = getConstantIntValue(val))
+    return *cst >= 0;
+  return val.getDefiningOp<triton::GetProgramIdOp>() ||
+         val.getDefiningOp<triton::GetNumProgramsOp>();
+}
+
+// Return the divisor if it is a positive constant.
+std::optional<int64_t> getPositiveDivisor(Value divisor) {
+  auto cst = getConstantIntValue(divisor);
+  if (!cst || *cst <= 0)
+    return std::nullopt;
+  return cst;
+}
+
 // Build affine expression to express min/max value of the given SSA name.
-// symbolTable is used to map SSA names to affine symbols.
+// symbolTable is used to map SSA names to affine symbols. If peeledLoop is
+// given, its induction variable is assumed to take only values of full steps
+// below the upper bound, like in the main part of the loop after its tail is
+// peeled. If nonNegative is set, the value is known to be non-negative
+// whenever the expression matters, e.g. the upper bound of a loop running
+// from a non-negative lower bound, so signed divisions of it round down.
 AffineExpr buildMinOrMaxExpr(Value val, bool isSigned, bool isMax,
-                             llvm::DenseMap<Value, unsigned> &symbolTable) {
+                             llvm::DenseMap<Value, unsigned> &symbolTable,
+                             scf::ForOp peeledLoop = nullptr,
+                             bool nonNegative = false) {
   if (auto def = val.getDefiningOp<vector::SplatOp>()) {
-    return buildMinOrMaxExpr(def.getInput(), isSigned, isMax, symbolTable);
+    return buildMinOrMaxExpr(def.getInput(), isSigned, isMax, symbolTable,
+                             peeledLoop, nonNegative);
   } else if (auto def = val.getDefiningOp<arith::ConstantOp>()) {
     auto attr = def.getValueAttr();
     if (auto intAttr = dyn_cast<IntegerAttr>(attr))
@@ -246,11 +308,56 @@ AffineExpr buildMinOrMaxExpr(Value val, bool isSigned, bool isMax,
       return getAffineConstantExpr((*valueIt).getSExtValue(), val.getContext());
     }
   } else if (auto def = val.getDefiningOp<arith::AddIOp>()) {
-    return buildMinOrMaxExpr(def.getLhs(), isSigned, isMax, symbolTable) +
-           buildMinOrMaxExpr(def.getRhs(), isSigned, isMax, symbolTable);
+    return buildMinOrMaxExpr(def.getLhs(), isSigned, isMax, symbolTable,
+                             peeledLoop) +
+           buildMinOrMaxExpr(def.getRhs(), isSigned, isMax, symbolTable,
+                             peeledLoop);
   } else if (auto def = val.getDefiningOp<arith::SubIOp>()) {
-    return buildMinOrMaxExpr(def.getLhs(), isSigned, isMax, symbolTable) -
-           buildMinOrMaxExpr(def.getRhs(), isSigned, !isMax, symbolTable);
+    return buildMinOrMaxExpr(def.getLhs(), isSigned, isMax, symbolTable,
+                             peeledLoop) -
+           buildMinOrMaxExpr(def.getRhs(), isSigned, !isMax, symbolTable,
+                             peeledLoop);
+  } else if (auto def = val.getDefiningOp<arith::MulIOp>();
+             def && (getConstantIntValue(def.getLhs()) ||
+                     getConstantIntValue(def.getRhs()))) {
+    // Multiplications by a negative constant swap min and max of the other
+    // operand.
+    bool cstLhs = getConstantIntValue(def.getLhs()).has_value();
+    int64_t cst = *getConstantIntValue(cstLhs ? def.getLhs() : def.getRhs());
+    Value other = cstLhs ? def.getRhs() : def.getLhs();
+    return buildMinOrMaxExpr(other, isSigned, cst < 0 ? !isMax : isMax,
+                             symbolTable, peeledLoop) *
+           cst;
+  } else if (isa_and_nonnull<arith::DivSIOp, arith::DivUIOp, arith::RemSIOp,
+                             arith::RemUIOp>(val.getDefiningOp()) &&
+             getPositiveDivisor(val.getDefiningOp()->getOperand(1))) {
+    // Signed divisions and remainders round towards zero, which matches
+    // floordiv and mod of affine expressions for non-negative dividends
+    // only.
+    Operation *def = val.getDefiningOp();
+    Value dividend = def->getOperand(0);
+    int64_t divisor = *getPositiveDivisor(def->getOperand(1));
+    bool isDiv = isa<arith::DivSIOp, arith::DivUIOp>(def);
+    if (isa<arith::DivUIOp, arith::RemUIOp>(def) || nonNegative ||
+        isNonNegative(dividend)) {
+      AffineExpr expr = buildMinOrMaxExpr(dividend, isSigned, isMax,
+                                          symbolTable, peeledLoop);
+      if (isDiv)
+        return expr.floorDiv(divisor);
+      // Remainders don't grow with their dividends, e.g. the max of x % 8
+      // for x in [1, 16] is 7, not 16 % 8. They are bounded by the remainders
+      // of the dividend bounds only if both are in the same multiple of the
+      // divisor.
+      AffineExpr otherExpr = buildMinOrMaxExpr(dividend, isSigned, !isMax,
+                                               symbolTable, peeledLoop);
+      auto cst = dyn_cast<AffineConstantExpr>(expr);
+      auto otherCst = dyn_cast<AffineConstantExpr>(otherExpr);
+      if (cst && otherCst &&
+          llvm::divideFloorSigned(cst.getValue(), divisor) ==
+              llvm::divideFloorSigned(otherCst.getValue(), divisor))
+        return expr % divisor;
+      return getAffineConstantExpr(isMax ? divisor - 1 : 0, val.getContext());
+    }
   } else if (auto blockArg = dyn_cast<BlockArgument>(val)) {
     auto op = blockArg.getOwner()->getParentOp();
     if (auto forOp = dyn_cast<scf::ForOp>(op)) {
@@ -262,15 +369,24 @@ AffineExpr buildMinOrMaxExpr(Value val, bool isSigned, bool isMax,
         // For min value return lower bound.
         if (!isMax)
           return buildMinOrMaxExpr(forOp.getLowerBound(), isSigned, isMax,
-                                   symbolTable);
+                                   symbolTable, peeledLoop);
+
+        // The body only runs if the upper bound is above the lower one.
+        auto lowerCst = getConstantIntValue(lower);
+        bool positiveUpper = lowerCst && *lowerCst >= 0;
 
         // For max value we use upper bound - 1 in generic case and bound - step
-        // if both bounds are divisible by the step.
-        if (isAlwaysDivisible(lower, step) && isAlwaysDivisible(upper, step)) {
-          return buildMinOrMaxExpr(upper, isSigned, isMax, symbolTable) -
-                 buildMinOrMaxExpr(step, isSigned, false, symbolTable);
+        // if both bounds are divisible by the step or only full steps run.
+        if ((isAlwaysDivisible(lower, step) &&
+             isAlwaysDivisible(upper, step)) ||
+            forOp == peeledLoop) {
+          return buildMinOrMaxExpr(upper, isSigned, isMax, symbolTable,
+                                   peeledLoop, positiveUpper) -
+                 buildMinOrMaxExpr(step, isSigned, false, symbolTable,
+                                   peeledLoop);
         }
-        return buildMinOrMaxExpr(upper, isSigned, isMax, symbolTable) -
+        return buildMinOrMaxExpr(upper, isSigned, isMax, symbolTable,
+                                 peeledLoop, positiveUpper) -
                getAffineConstantExpr(1, val.getContext());
       }
     }
@@ -284,78 +400,599 @@ AffineExpr buildMinOrMaxExpr(Value val, bool isSigned, bool isMax,
   return getAffineSymbolExpr(pos, val.getContext());
 }
 
-// Check if vector mask is all-ones by checking compared values ranges.
-// Only simplest cases are covered here, so affine expression is used
-// to represent a range for now.
-bool isAlwaysAllOnes(arith::CmpIOp maskDef) {
+bool isSignedPredicate(arith::CmpIPredicate pred) {
+  return pred == arith::CmpIPredicate::slt ||
+         pred == arith::CmpIPredicate::sle ||
+         pred == arith::CmpIPredicate::sgt || pred == arith::CmpIPredicate::sge;
+}
+
+// Return the predicate with swapped operands, e.g. sgt for slt.
+arith::CmpIPredicate swapPredicate(arith::CmpIPredicate pred) {
+  switch (pred) {
+  case arith::CmpIPredicate::slt:
+    return arith::CmpIPredicate::sgt;
+  case arith::CmpIPredicate::sle:
+    return arith::CmpIPredicate::sge;
+  case arith::CmpIPredicate::sgt:
+    return arith::CmpIPredicate::slt;
+  case arith::CmpIPredicate::sge:
+    return arith::CmpIPredicate::sle;
+  default:
+    return pred;
+  }
+}
+
+// Known bounds of values used as symbols of mask ranges: program ids and
+// values bounded by llvm.intr.assume facts in entry blocks of functions,
+// e.g. tl.assume(size >= 128), which hold for the whole function. Facts are
+// read from the assumes on each query, since rewrites may erase compared
+// values and reuse their storage, but keep the assumes, which have side
+// effects, and their comparisons, see isFact.
+class ValueBounds {
+public:
+  struct Bounds {
+    std::optional<int64_t> lower;
+    std::optional<int64_t> upper;
+  };
+
+  explicit ValueBounds(ModuleOp mod) {
+    mod.walk([&](LLVM::AssumeOp op) {
+      if (isa<FunctionOpInterface>(op->getParentOp()) &&
+          op->getBlock()->isEntryBlock())
+        assumes.push_back(op);
+    });
+  }
+
+  Bounds get(Value val) const {
+    Bounds res;
+    if (auto cst = getConstantIntValue(val)) {
+      res.lower = res.upper = *cst;
+      return res;
+    }
+    if (val.getDefiningOp<triton::GetProgramIdOp>())
+      res = {0, std::numeric_limits<int32_t>::max() - 1};
+    else if (val.getDefiningOp<triton::GetNumProgramsOp>())
+      res = {1, std::numeric_limits<int32_t>::max()};
+    for (LLVM::AssumeOp op : assumes)
+      addFacts(op.getCond(), val, res);
+    return res;
+  }
+
+  // Return true if the op computes a condition of an assume, which must not
+  // be folded with the bounds it gives.
+  static bool isFact(Operation *op) {
+    return llvm::any_of(op->getUsers(), [](Operation *user) {
+      return isa<LLVM::AssumeOp>(user) ||
+             (isa<arith::AndIOp>(user) && isFact(user));
+    });
+  }
+
+private:
+  // Add bounds of val from comparisons with constants, possibly combined
+  // with and.
+  static void addFacts(Value cond, Value val, Bounds &bounds) {
+    if (auto andOp = cond.getDefiningOp<arith::AndIOp>()) {
+      addFacts(andOp.getLhs(), val, bounds);
+      addFacts(andOp.getRhs(), val, bounds);
+      return;
+    }
+    auto cmpOp = cond.getDefiningOp<arith::CmpIOp>();
+    if (!cmpOp || (!isSignedPredicate(cmpOp.getPredicate()) &&
+                   cmpOp.getPredicate() != arith::CmpIPredicate::eq))
+      return;
+    Value lhs = cmpOp.getLhs(), rhs = cmpOp.getRhs();
+    arith::CmpIPredicate pred = cmpOp.getPredicate();
+    if (getConstantIntValue(lhs)) {
+      std::swap(lhs, rhs);
+      pred = swapPredicate(pred);
+    }
+    auto cst = getConstantIntValue(rhs);
+    if (lhs != val || !cst || *cst == INT64_MIN || *cst == INT64_MAX)
+      return;
+    auto addLower = [&](int64_t bound) {
+      bounds.lower = std::max(bounds.lower.value_or(INT64_MIN), bound);
+    };
+    auto addUpper = [&](int64_t bound) {
+      bounds.upper = std::min(bounds.upper.value_or(INT64_MAX), bound);
+    };
+    switch (pred) {
+    case arith::CmpIPredicate::eq:
+      addLower(*cst);
+      addUpper(*cst);
+      break;
+    case arith::CmpIPredicate::sgt:
+      addLower(*cst + 1);
+      break;
+    case arith::CmpIPredicate::sge:
+      addLower(*cst);
+      break;
+    case arith::CmpIPredicate::slt:
+      addUpper(*cst - 1);
+      break;
+    case arith::CmpIPredicate::sle:
+      addUpper(*cst);
+      break;
+    default:
+      break;
+    }
+  }
+
+  SmallVector<LLVM::AssumeOp> assumes;
+};
+
+// Linear bound of an affine expression of a mask range:
+//   (sum(coeffs[i] * s_i) + [lo, hi]) / denom
+// Floor divisions and remainders by constants are approximated keeping the
+// relation with their dividends, x floordiv c = (x - r) / c for some r in
+// [0, c - 1], so that (x floordiv c) * c - x is known to be in [1 - c, 0]
+// for any x, e.g. for offsets of a loop over range(0, size // BLOCK).
+struct LinearBound {
+  llvm::SmallDenseMap<unsigned, int64_t> coeffs;
+  int64_t lo = 0;
+  int64_t hi = 0;
+  int64_t denom = 1;
+
+  static std::optional<LinearBound> get(AffineExpr expr) {
+    LinearBound res;
+    switch (expr.getKind()) {
+    case AffineExprKind::Constant:
+      res.lo = res.hi = cast<AffineConstantExpr>(expr).getValue();
+      return res;
+    case AffineExprKind::SymbolId:
+      res.coeffs[cast<AffineSymbolExpr>(expr).getPosition()] = 1;
+      return res;
+    case AffineExprKind::Add: {
+      auto binExpr = cast<AffineBinaryOpExpr>(expr);
+      auto lhs = get(binExpr.getLHS());
+      auto rhs = lhs ? get(binExpr.getRHS()) : std::nullopt;
+      if (!rhs)
+        return std::nullopt;
+      return lhs->add(*rhs);
+    }
+    case AffineExprKind::Mul:
+    case AffineExprKind::FloorDiv:
+    case AffineExprKind::CeilDiv:
+    case AffineExprKind::Mod: {
+      // Affine expressions only have constant divisors, and constant
+      // factors are moved to the right.
+      auto binExpr = cast<AffineBinaryOpExpr>(expr);
+      auto cst = dyn_cast<AffineConstantExpr>(binExpr.getRHS());
+      auto lhs = cst ? get(binExpr.getLHS()) : std::nullopt;
+      if (!lhs)
+        return std::nullopt;
+      int64_t val = cst.getValue();
+      if (expr.getKind() == AffineExprKind::Mul)
+        return lhs->scale(val);
+      if (val <= 0)
+        return std::nullopt;
+      if (expr.getKind() == AffineExprKind::Mod) {
+        res.hi = val - 1;
+        return res;
+      }
+      // x floordiv c = (x - r) / c and x ceildiv c = (x + r) / c.
+      int64_t rem;
+      if (llvm::MulOverflow(val - 1, lhs->denom, rem) ||
+          llvm::MulOverflow(lhs->denom, val, lhs->denom))
+        return std::nullopt;
+      if (expr.getKind() == AffineExprKind::FloorDiv
+              ? llvm::SubOverflow(lhs->lo, rem, lhs->lo)
+              : llvm::AddOverflow(lhs->hi, rem, lhs->hi))
+        return std::nullopt;
+      return lhs;
+    }
+    default:
+      return std::nullopt;
+    }
+  }
+
+  std::optional<LinearBound> scale(int64_t factor) const {
+    LinearBound res;
+    res.denom = denom;
+    for (auto [pos, coeff] : coeffs)
+      if (llvm::MulOverflow(coeff, factor, res.coeffs[pos]))
+        return std::nullopt;
+    if (llvm::MulOverflow(lo, factor, res.lo) ||
+        llvm::MulOverflow(hi, factor, res.hi))
+      return std::nullopt;
+    if (factor < 0)
+      std::swap(res.lo, res.hi);
+    return res;
+  }
+
+  std::optional<LinearBound> add(const LinearBound &other) const {
+    int64_t newDenom = std::lcm(denom, other.denom);
+    auto lhs = scale(newDenom / denom);
+    auto rhs = other.scale(newDenom / other.denom);
+    if (!lhs || !rhs)
+      return std::nullopt;
+    for (auto [pos, coeff] : rhs->coeffs) {
+      int64_t &sum = lhs->coeffs[pos];
+      if (llvm::AddOverflow(sum, coeff, sum))
+        return std::nullopt;
+      // Terms cancelling each other out don't need bounds of the symbol.
+      if (sum == 0)
+        lhs->coeffs.erase(pos);
+    }
+    if (llvm::AddOverflow(lhs->lo, rhs->lo, lhs->lo) ||
+        llvm::AddOverflow(lhs->hi, rhs->hi, lhs->hi))
+      return std::nullopt;
+    lhs->denom = newDenom;
+    return lhs;
+  }
+
+  // Return the max value if isMax is set or the min value otherwise, given
+  // bounds of the symbols.
+  std::optional<int64_t> getBound(bool isMax, ArrayRef<Value> symbols,
+                                  const ValueBounds &bounds) const {
+    int64_t res = isMax ? hi : lo;
+    for (auto [pos, coeff] : coeffs) {
+      ValueBounds::Bounds symBounds = bounds.get(symbols[pos]);
+      std::optional<int64_t> symBound =
+          (coeff > 0) == isMax ? symBounds.upper : symBounds.lower;
+      int64_t term;
+      if (!symBound || llvm::MulOverflow(coeff, *symBound, term) ||
+          llvm::AddOverflow(res, term, res))
+        return std::nullopt;
+    }
+    return isMax ? llvm::divideFloorSigned(res, denom)
+                 : llvm::divideCeilSigned(res, denom);
+  }
+};
+
+// Range of a comparison as the difference of the max offset and the min
+// length compared by it. The comparison is all-ones if the difference is
+// always negative, or non-positive for inclusive predicates. With allZeros,
+// it is the difference of the min offset and the max length instead, and
+// the comparison is all-zeros if it is never negative, or always positive
+// for inclusive predicates. Symbols of the difference are the values in
+// symbolTable.
+struct MaskRange {
+  AffineExpr diff;
+  bool inclusive = false;
+  llvm::DenseMap<Value, unsigned> symbolTable;
+
+  SmallVector<Value> getSymbols() const {
+    SmallVector<Value> symbols(symbolTable.size());
+    for (auto [val, pos] : symbolTable)
+      symbols[pos] = val;
+    return symbols;
+  }
+};
+
+std::optional<MaskRange> getMaskRange(arith::CmpIOp maskDef,
+                                      scf::ForOp peeledLoop = nullptr,
+                                      bool allZeros = false) {
   auto pred = maskDef.getPredicate();
   if (pred == arith::CmpIPredicate::eq || pred == arith::CmpIPredicate::ne)
-    return false;
+    return std::nullopt;
 
   bool isSigned =
       pred == arith::CmpIPredicate::sgt || pred == arith::CmpIPredicate::sge ||
       pred == arith::CmpIPredicate::sle || pred == arith::CmpIPredicate::slt;
-  llvm::DenseMap<Value, unsigned> symbolTable;
-  AffineExpr maxOffs;
-  AffineExpr minLen;
-  if (pred == arith::CmpIPredicate::slt || pred == arith::CmpIPredicate::sle ||
-      pred == arith::CmpIPredicate::ult || pred == arith::CmpIPredicate::ule) {
-    maxOffs = buildMinOrMaxExpr(maskDef.getLhs(), isSigned, true, symbolTable);
-    minLen = buildMinOrMaxExpr(maskDef.getRhs(), isSigned, false, symbolTable);
-  } else {
-    maxOffs = buildMinOrMaxExpr(maskDef.getRhs(), isSigned, true, symbolTable);
-    minLen = buildMinOrMaxExpr(maskDef.getLhs(), isSigned, false, symbolTable);
-  }
+  MaskRange range;
+  AffineExpr offs;
+  AffineExpr len;
+  Value offsVal = maskDef.getLhs(), lenVal = maskDef.getRhs();
+  if (pred == arith::CmpIPredicate::sgt || pred == arith::CmpIPredicate::sge ||
+      pred == arith::CmpIPredicate::ugt || pred == arith::CmpIPredicate::uge)
+    std::swap(offsVal, lenVal);
+  offs = buildMinOrMaxExpr(offsVal, isSigned, !allZeros, range.symbolTable,
+                           peeledLoop);
+  len = buildMinOrMaxExpr(lenVal, isSigned, allZeros, range.symbolTable,
+                          peeledLoop);
+  range.diff = offs - len;
+  range.inclusive =
+      pred == arith::CmpIPredicate::sle || pred == arith::CmpIPredicate::ule ||
+      pred == arith::CmpIPredicate::sge || pred == arith::CmpIPredicate::uge;
+  return range;
+}
+
+// Check if vector mask is all-ones by checking compared values ranges. The
+// range is represented with an affine expression, which is bounded using
+// known bounds of its symbols.
+bool isAlwaysAllOnes(arith::CmpIOp maskDef, const ValueBounds &bounds,
+                     scf::ForOp peeledLoop = nullptr) {
+  std::optional<MaskRange> range = getMaskRange(maskDef, peeledLoop);
+  if (!range)
+    return false;
 
   // The mask is all-ones if max offset is always less than min length.
-  auto diff = maxOffs - minLen;
-  if (auto diffCst = dyn_cast<AffineConstantExpr>(diff)) {
-    int64_t diffVal = diffCst.getValue();
-    if (pred == arith::CmpIPredicate::slt ||
-        pred == arith::CmpIPredicate::ult ||
-        pred == arith::CmpIPredicate::sgt || pred == arith::CmpIPredicate::ugt)
-      return diffVal < 0;
-    else
-      return diffVal <= 0;
-  }
+  std::optional<int64_t> maxDiff;
+  if (auto diffCst = dyn_cast<AffineConstantExpr>(range->diff))
+    maxDiff = diffCst.getValue();
+  else if (auto linear = LinearBound::get(range->diff))
+    maxDiff = linear->getBound(true, range->getSymbols(), bounds);
+  if (!maxDiff)
+    return false;
+  return range->inclusive ? *maxDiff <= 0 : *maxDiff < 0;
+}
 
-  return false;
+// Check if vector mask is all-zeros, e.g. for offsets past the size in all
+// programs.
+bool isAlwaysAllZeros(arith::CmpIOp maskDef, const ValueBounds &bounds) {
+  std::optional<MaskRange> range = getMaskRange(maskDef, nullptr, true);
+  if (!range)
+    return false;
+
+  // The mask is all-zeros if min offset is never less than max length.
+  auto linear = LinearBound::get(range->diff);
+  std::optional<int64_t> minDiff =
+      linear ? linear->getBound(false, range->getSymbols(), bounds)
+             : std::nullopt;
+  if (!minDiff)
+    return false;
+  return range->inclusive ? *minDiff > 0 : *minDiff >= 0;
 }
 
 struct OptimizeMask : public OpRewritePattern<arith::CmpIOp> {
-  using OpRewritePattern::OpRewritePattern;
+  OptimizeMask(MLIRContext *context, const ValueBounds &bounds)
+      : OpRewritePattern(context), bounds(bounds) {}
 
   LogicalResult matchAndRewrite(arith::CmpIOp op,
                                 PatternRewriter &rewriter) const override {
-    if (!isAlwaysAllOnes(op))
+    if (ValueBounds::isFact(op))
       return failure();
-
-    rewriter.replaceOpWithNewOp<arith::ConstantOp>(
-        op, op.getType(), rewriter.getOneAttr(op.getType()));
-    return success();
+    if (isAlwaysAllOnes(op, bounds)) {
+      rewriter.replaceOpWithNewOp<arith::ConstantOp>(
+          op, op.getType(), rewriter.getOneAttr(op.getType()));
+      return success();
+    }
+    if (isAlwaysAllZeros(op, bounds)) {
+      rewriter.replaceOpWithNewOp<arith::ConstantOp>(
+          op, op.getType(), rewriter.getZeroAttr(op.getType()));
+      return success();
+    }
+    return failure();
   }
+
+private:
+  const ValueBounds &bounds;
 };
 
+// Collect comparisons the mask is a conjunction of. Return false if the mask
+// is computed in another way.
+bool collectMaskComparisons(Value mask, SmallVectorImpl<arith::CmpIOp> &cmps) {
+  if (matchPattern(mask, m_One()))
+    return true;
+  Operation *def = mask.getDefiningOp();
+  if (auto cmpOp = dyn_cast_or_null<arith::CmpIOp>(def)) {
+    cmps.push_back(cmpOp);
+    return true;
+  }
+  if (auto andOp = dyn_cast_or_null<arith::AndIOp>(def))
+    return collectMaskComparisons(andOp.getLhs(), cmps) &&
+           collectMaskComparisons(andOp.getRhs(), cmps);
+  if (isa_and_nonnull<vector::ExtractOp, vector::BroadcastOp, vector::SplatOp,
+                      vector::ShapeCastOp>(def))
+    return collectMaskComparisons(def->getOperand(0), cmps);
+  return false;
+}
+
+Value getMask(Operation *op) {
+  if (auto loadOp = dyn_cast<vector::MaskedLoadOp>(op))
+    return loadOp.getMask();
+  if (auto storeOp = dyn_cast<vector::MaskedStoreOp>(op))
+    return storeOp.getMask();
+  return nullptr;
+}
+
+// Peel the tail of a loop with masked memory accesses whose masks are
+// all-ones on full steps of the loop, e.g. offs + tl.arange(0, TILE_SIZE) <
+// size in a loop over range(0, size, TILE_SIZE). The loop is split into the
+// main part running full steps, where the masks are replaced with all-ones,
+// and the remaining partial step with the original masks:
+//   main = lower + (upper - lower) / step * step
+//   for iv in range(lower, main, step): <unmasked body>
+//   for iv in range(main, upper, step): <masked body>
+// The division rounds towards zero, so none of the parts runs when the upper
+// bound is below the lower one, and the second part runs at most once. The
+// loop of the second part is added to peeledTails.
+void peelMaskedTail(scf::ForOp forOp, const ValueBounds &bounds,
+                    SmallPtrSetImpl<Operation *> &peeledTails) {
+  auto step = getConstantIntValue(forOp.getStep());
+  if (!step || *step <= 0)
+    return;
+
+  // Comparisons to replace in the main part. Only memory accesses that become
+  // unmasked are worth peeling the loop for.
+  SetVector<Operation *> allOnesCmps;
+  forOp.getBody()->walk([&](Operation *op) {
+    Value mask = getMask(op);
+    if (!mask || op->getParentOfType<scf::ForOp>() != forOp)
+      return;
+    SmallVector<arith::CmpIOp> cmps;
+    if (!collectMaskComparisons(mask, cmps) ||
+        !llvm::all_of(cmps, [&](arith::CmpIOp cmpOp) {
+          return isAlwaysAllOnes(cmpOp, bounds, forOp);
+        }))
+      return;
+    for (arith::CmpIOp cmpOp : cmps)
+      if (forOp->isProperAncestor(cmpOp))
+        allOnesCmps.insert(cmpOp);
+  });
+  if (allOnesCmps.empty())
+    return;
+
+  OpBuilder builder(forOp);
+  Location loc = forOp.getLoc();
+  Value lower = forOp.getLowerBound();
+  Value numSteps = builder.create<arith::DivSIOp>(
+      loc, builder.create<arith::SubIOp>(loc, forOp.getUpperBound(), lower),
+      forOp.getStep());
+  Value mainUpper = builder.create<arith::AddIOp>(
+      loc, lower,
+      builder.create<arith::MulIOp>(loc, numSteps, forOp.getStep()));
+
+  IRMapping mapping;
+  auto mainLoop = cast<scf::ForOp>(builder.clone(*forOp, mapping));
+  mainLoop.setUpperBound(mainUpper);
+  for (Operation *cmpOp : allOnesCmps) {
+    auto mainCmp = mapping.lookup(cmpOp->getResult(0)).getDefiningOp();
+    builder.setInsertionPoint(mainCmp);
+    Type type = mainCmp->getResult(0).getType();
+    mainCmp->getResult(0).replaceAllUsesWith(
+        builder.create<arith::ConstantOp>(loc, type, builder.getOneAttr(type)));
+    mainCmp->erase();
+  }
+
+  forOp.setLowerBound(mainUpper);
+  forOp.getInitArgsMutable().assign(mainLoop.getResults());
+  peeledTails.insert(forOp);
+}
+
+// Materialize a difference of a mask range in the given type, whose symbols
+// are integer scalars that are sign-extended to it. Return nullptr if it has
+// other symbols, e.g. loaded vectors, or other kinds of expressions.
+Value buildRangeValue(OpBuilder &builder, Location loc, AffineExpr expr,
+                      ArrayRef<Value> symbols, Type type) {
+  switch (expr.getKind()) {
+  case AffineExprKind::Constant: {
+    int64_t val = cast<AffineConstantExpr>(expr).getValue();
+    return builder.create<arith::ConstantOp>(
+        loc, type, builder.getIntegerAttr(type, val));
+  }
+  case AffineExprKind::SymbolId: {
+    Value val = symbols[cast<AffineSymbolExpr>(expr).getPosition()];
+    if (val.getType() == type)
+      return val;
+    auto intTy = dyn_cast<IntegerType>(val.getType());
+    if (!intTy || !intTy.isSignless() ||
+        intTy.getWidth() >= type.getIntOrFloatBitWidth())
+      return nullptr;
+    return builder.create<arith::ExtSIOp>(loc, type, val);
+  }
+  case AffineExprKind::Add:
+  case AffineExprKind::Mul: {
+    auto binExpr = cast<AffineBinaryOpExpr>(expr);
+    Value lhs =
+        buildRangeValue(builder, loc, binExpr.getLHS(), symbols, type);
+    Value rhs =
+        buildRangeValue(builder, loc, binExpr.getRHS(), symbols, type);
+    if (!lhs || !rhs)
+      return nullptr;
+    if (expr.getKind() == AffineExprKind::Add)
+      return builder.create<arith::AddIOp>(loc, lhs, rhs);
+    return builder.create<arith::MulIOp>(loc, lhs, rhs);
+  }
+  default:
+    return nullptr;
+  }
+}
+
+// Version a masked memory access outside of loops whose mask is all-ones in
+// full tiles, e.g. offs < size for offs = pid * BLOCK_SIZE + tl.arange(0,
+// BLOCK_SIZE) and any size. The access is unmasked when a scalar check of
+// the ranges of the compared values shows the tile is full:
+//   if (pid * BLOCK_SIZE + BLOCK_SIZE - 1 - size < 0) <unmasked access>
+//   else <masked access>
+// So only programs of tail tiles run masked code, without specializing the
+// kernel on sizes. The check is uniform across the program, so its branches
+// are well predicted. The difference is computed in i64, so it doesn't wrap
+// around for offsets close to the max value of their type. Loops are peeled
+// by peelMaskedTail instead, and accesses of their peeled tails, which are
+// never full, are left masked.
+void versionMaskedAccess(Operation *op,
+                         const SmallPtrSetImpl<Operation *> &peeledTails) {
+  Value mask = getMask(op);
+  if (!mask || op->getParentOfType<LoopLikeOpInterface>())
+    return;
+  for (Operation *parent = op->getParentOp(); parent;
+       parent = parent->getParentOp())
+    if (peeledTails.contains(parent))
+      return;
+  SmallVector<arith::CmpIOp> cmps;
+  if (!collectMaskComparisons(mask, cmps) || cmps.empty())
+    return;
+
+  OpBuilder builder(op);
+  Location loc = op->getLoc();
+  Value isFull;
+  for (arith::CmpIOp cmpOp : cmps) {
+    // Differences are compared as signed values, so unsigned comparisons,
+    // e.g. of negative offsets wrapping around, are left masked.
+    std::optional<MaskRange> range = getMaskRange(cmpOp);
+    Type type = getElementTypeOrSelf(cmpOp.getLhs().getType());
+    if (!range || !isSignedPredicate(cmpOp.getPredicate()) ||
+        !type.isSignlessInteger())
+      return;
+    if (type.getIntOrFloatBitWidth() > 64)
+      return;
+    Type diffType = builder.getI64Type();
+    Value diff = buildRangeValue(builder, loc, range->diff,
+                                 range->getSymbols(), diffType);
+    if (!diff)
+      return;
+    Value zero = builder.create<arith::ConstantOp>(
+        loc, diffType, builder.getIntegerAttr(diffType, 0));
+    Value cmpFull = builder.create<arith::CmpIOp>(
+        loc,
+        range->inclusive ? arith::CmpIPredicate::sle
+                         : arith::CmpIPredicate::slt,
+        diff, zero);
+    isFull = isFull ? builder.create<arith::AndIOp>(loc, isFull, cmpFull)
+                    : cmpFull;
+  }
+
+  Type maskType = mask.getType();
+  auto ifOp = builder.create<scf::IfOp>(
+      loc, isFull,
+      [&](OpBuilder &thenBuilder, Location loc) {
+        Operation *unmasked = thenBuilder.clone(*op);
+        Value allOnes = thenBuilder.create<arith::ConstantOp>(
+            loc, maskType, thenBuilder.getOneAttr(maskType));
+        if (auto loadOp = dyn_cast<vector::MaskedLoadOp>(unmasked))
+          loadOp.getMaskMutable().assign(allOnes);
+        else
+          cast<vector::MaskedStoreOp>(unmasked).getMaskMutable().assign(
+              allOnes);
+        thenBuilder.create<scf::YieldOp>(loc, unmasked->getResults());
+      },
+      [&](OpBuilder &elseBuilder, Location loc) {
+        Operation *masked = elseBuilder.clone(*op);
+        elseBuilder.create<scf::YieldOp>(loc, masked->getResults());
+      });
+  op->replaceAllUsesWith(ifOp.getResults());
+  op->erase();
+}
+
 struct OptimizeMasks
     : public triton::cpu::impl::OptimizeMasksBase<OptimizeMasks> {
   OptimizeMasks() = default;
 
+  OptimizeMasks(bool versionTiles) { this->versionTiles = versionTiles; }
+
   void runOnOperation() override {
     MLIRContext *context = &getContext();
     ModuleOp mod = getOperation();
 
-    // TODO: This pass optimizes out masks applying a set of very strict
-    // patterns. We should use more generic range and divisibility analysis
-    // to cover more cases and remove dependency on other transformations.
+    // Masks are proven all-ones or all-zeros with symbolic ranges of their
+    // values, bounded by known bounds of program ids and assumed facts.
+    ValueBounds bounds(mod);
     RewritePatternSet patterns(context);
     patterns.add<CdivToDiv>(context);
     patterns.add<ScaleInductionVariable>(context);
-    patterns.add<OptimizeMask>(context);
+    patterns.add<OptimizeMask>(context, bounds);
     if (failed(mlir::applyPatternsGreedily(mod, std::move(patterns))))
       return signalPassFailure();
 
-    // TODO: if masks removal failed for loads/stores in a for-loop, we might
-    // still optimize it using loop peeling.
+    // If masks removal failed for loads/stores in a for-loop, try to optimize
+    // them using loop peeling. Inner loops are peeled first.
+    SmallVector<scf::ForOp> forOps;
+    mod.walk([&](scf::ForOp forOp) { forOps.push_back(forOp); });
+    SmallPtrSet<Operation *, 8> peeledTails;
+    for (scf::ForOp forOp : forOps)
+      peelMaskedTail(forOp, bounds, peeledTails);
+
+    // Masked accesses of tiles outside of loops are versioned for full tiles.
+    if (versionTiles) {
+      SmallVector<Operation *> accessOps;
+      mod.walk([&](Operation *op) {
+        if (getMask(op))
+          accessOps.push_back(op);
+      });
+      for (Operation *op : accessOps)
+        versionMaskedAccess(op, peeledTails);
+    }
   }
 };
 
@@ -369,6 +1006,11 @@ std::unique_ptr<OperationPass<ModuleOp>> createOptimizeMasks() {
   return std::make_unique<OptimizeMasks>();
 }
 
+std::unique_ptr<OperationPass<ModuleOp>>
+createOptimizeMasks(bool versionTiles) {
+  return std::make_unique<OptimizeMasks>(versionTiles);
+}
+
 } // namespace cpu
 } // namespace triton
 } // namespace mlir
@@ -0,0 +1,245 @@
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Interfaces/ViewLikeInterface.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_PACKDOTOPERANDS
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Rows with a byte stride multiple of the page size map to the same cache
+// sets, so tiles read with such strides thrash the cache.
+constexpr int64_t conflictingRowStrideBytes = 4096;
+
+// Check if rows of a tile read from memRefTy are not contiguous or use a
+// stride causing cache conflicts.
+bool needsPacking(MemRefType memRefTy) {
+  auto layout = dyn_cast<StridedLayoutAttr>(memRefTy.getLayout());
+  if (!layout || memRefTy.getRank() < 2)
+    return false;
+  ArrayRef<int64_t> strides = layout.getStrides();
+  if (strides.back() != 1)
+    return true;
+  int64_t rowStride = strides[strides.size() - 2];
+  int64_t elemBytes =
+      std::max<int64_t>(memRefTy.getElementTypeBitWidth() / 8, 1);
+  return !ShapedType::isDynamic(rowStride) &&
+         (rowStride * elemBytes) % conflictingRowStrideBytes == 0;
+}
+
+// Get the kernel argument or the stack buffer memory referenced by val is
+// derived from. Return null if it is unknown.
+Value getUnderlyingBuffer(Value val) {
+  while (val) {
+    if (auto blockArg = dyn_cast<BlockArgument>(val)) {
+      Operation *parentOp = blockArg.getOwner()->getParentOp();
+      if (isa<FunctionOpInterface>(parentOp))
+        return blockArg;
+      // Loop-carried pointers have to be advanced from themselves.
+      auto forOp = dyn_cast<scf::ForOp>(parentOp);
+      OpOperand *yielded =
+          forOp ? forOp.getTiedLoopYieldedValue(blockArg) : nullptr;
+      if (!yielded)
+        return nullptr;
+      Value next = yielded->get();
+      while (next != blockArg) {
+        if (auto advanceOp = next.getDefiningOp<AdvanceOp>())
+          next = advanceOp.getPtr();
+        else if (auto addPtrOp = next.getDefiningOp<AddPtrOp>())
+          next = addPtrOp.getPtr();
+        else
+          return nullptr;
+      }
+      val = forOp.getTiedLoopInit(blockArg)->get();
+      continue;
+    }
+
+    Operation *defOp = val.getDefiningOp();
+    if (isa<memref::AllocaOp>(defOp))
+      return val;
+    if (auto op = dyn_cast<ExtractMemRefOp>(defOp))
+      val = op.getSrc();
+    else if (auto op = dyn_cast<PtrToMemRefOp>(defOp))
+      val = op.getSrc();
+    else if (auto op = dyn_cast<MakeTensorPtrOp>(defOp))
+      val = op.getBase();
+    else if (auto op = dyn_cast<AdvanceOp>(defOp))
+      val = op.getPtr();
+    else if (auto op = dyn_cast<AddPtrOp>(defOp))
+      val = op.getPtr();
+    else if (auto op = dyn_cast<ViewLikeOpInterface>(defOp))
+      val = op.getViewSource();
+    else
+      return nullptr;
+  }
+  return nullptr;
+}
+
+// Check if forOp might write memory the tile is read from. As in software
+// pipelining, accesses through different kernel arguments are assumed not to
+// alias.
+bool mayWriteBuffer(scf::ForOp forOp, Value buffer) {
+  auto res = forOp->walk([&](Operation *op) {
+    auto memInterface = dyn_cast<MemoryEffectOpInterface>(op);
+    if (!memInterface)
+      return op->hasTrait<OpTrait::HasRecursiveMemoryEffects>()
+                 ? WalkResult::advance()
+                 : WalkResult::interrupt();
+    SmallVector<MemoryEffects::EffectInstance> effects;
+    memInterface.getEffects(effects);
+    for (auto &effect : effects) {
+      if (!isa<MemoryEffects::Write>(effect.getEffect()))
+        continue;
+      Value written = getUnderlyingBuffer(effect.getValue());
+      if (!written || written == buffer)
+        return WalkResult::interrupt();
+    }
+    return WalkResult::advance();
+  });
+  return res.wasInterrupted();
+}
+
+// Check if val can be computed before forOp, i.e. it's defined outside of the
+// loop or by side effect free ops with such operands.
+bool isHoistable(Value val, scf::ForOp forOp) {
+  if (forOp.isDefinedOutsideOfLoop(val))
+    return true;
+  Operation *defOp = val.getDefiningOp();
+  if (!defOp || defOp->getNumRegions() || !isMemoryEffectFree(defOp))
+    return false;
+  return llvm::all_of(defOp->getOperands(), [&](Value operand) {
+    return isHoistable(operand, forOp);
+  });
+}
+
+// Clone ops computing a hoistable value to the insertion point of builder.
+void cloneHoisted(OpBuilder &builder, Value val, scf::ForOp forOp,
+                  IRMapping &mapping) {
+  if (forOp.isDefinedOutsideOfLoop(val) || mapping.contains(val))
+    return;
+  Operation *defOp = val.getDefiningOp();
+  for (Value operand : defOp->getOperands())
+    cloneHoisted(builder, operand, forOp, mapping);
+  builder.clone(*defOp, mapping);
+}
+
+// Find the outermost loop the tile is reused by, i.e. the read is executed on
+// each iteration with the same indices and the data isn't modified.
+scf::ForOp findReuseLoop(vector::TransferReadOp readOp) {
+  Value buffer = getUnderlyingBuffer(readOp.getSource());
+  if (!buffer)
+    return nullptr;
+
+  scf::ForOp reuseLoop;
+  Operation *op = readOp;
+  while (auto forOp = dyn_cast<scf::ForOp>(op->getParentOp())) {
+    if (!llvm::all_of(readOp->getOperands(),
+                      [&](Value val) { return isHoistable(val, forOp); }) ||
+        mayWriteBuffer(forOp, buffer))
+      break;
+    reuseLoop = forOp;
+    op = forOp;
+  }
+  return reuseLoop;
+}
+
+// Copy the tile to a contiguous buffer before the loop reusing it. The loop
+// reads the buffer instead, and the copy is skipped when the loop has no
+// iterations.
+void packTile(vector::TransferReadOp readOp, scf::ForOp reuseLoop) {
+  Location loc = readOp.getLoc();
+  auto vecTy = readOp.getVectorType();
+  auto funcOp = readOp->getParentOfType<FunctionOpInterface>();
+
+  OpBuilder builder(readOp.getContext());
+  builder.setInsertionPointToStart(&funcOp.getFunctionBody().front());
+  auto bufTy = MemRefType::get(vecTy.getShape(), vecTy.getElementType());
+  Value buf = builder.create<memref::AllocaOp>(
+      loc, bufTy, builder.getIntegerAttr(builder.getI64Type(), 64));
+  Value zeroIdx = builder.create<arith::ConstantIndexOp>(loc, 0);
+  SmallVector<Value> zeroIndices(vecTy.getRank(), zeroIdx);
+  SmallVector<bool> inBounds(vecTy.getRank(), true);
+
+  builder.setInsertionPoint(reuseLoop);
+  Value hasIterations = builder.create<arith::CmpIOp>(
+      loc, arith::CmpIPredicate::slt, reuseLoop.getLowerBound(),
+      reuseLoop.getUpperBound());
+  auto ifOp = builder.create<scf::IfOp>(loc, hasIterations,
+                                        /*withElseRegion=*/false);
+  builder.setInsertionPointToStart(ifOp.thenBlock());
+  IRMapping mapping;
+  for (Value operand : readOp->getOperands())
+    cloneHoisted(builder, operand, reuseLoop, mapping);
+  Value tile = builder.clone(*readOp, mapping)->getResult(0);
+  builder.create<vector::TransferWriteOp>(loc, tile, buf, zeroIndices,
+                                          inBounds);
+
+  builder.setInsertionPoint(readOp);
+  Value paddingVal = builder.create<arith::ConstantOp>(
+      loc, builder.getZeroAttr(vecTy.getElementType()));
+  Value packed = builder.create<vector::TransferReadOp>(
+      loc, vecTy, buf, zeroIndices, paddingVal, inBounds);
+  readOp.replaceAllUsesWith(packed);
+  readOp.erase();
+}
+
+struct PackDotOperands
+    : public mlir::triton::cpu::impl::PackDotOperandsBase<PackDotOperands> {
+  PackDotOperands() = default;
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+
+    SetVector<vector::TransferReadOp> tileReads;
+    mod.walk([&](cpu::DotOp dotOp) {
+      for (Value operand : {dotOp.getA(), dotOp.getB()}) {
+        auto readOp = operand.getDefiningOp<vector::TransferReadOp>();
+        if (!readOp)
+          continue;
+        auto memRefTy = dyn_cast<MemRefType>(readOp.getShapedType());
+        if (memRefTy && needsPacking(memRefTy))
+          tileReads.insert(readOp);
+      }
+    });
+
+    for (auto readOp : tileReads) {
+      if (auto reuseLoop = findReuseLoop(readOp))
+        packTile(readOp, reuseLoop);
+    }
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createPackDotOperands() {
+  return std::make_unique<PackDotOperands>();
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -0,0 +1,220 @@
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+#include "triton/Dialect/TritonGPU/Transforms/PipelineExpander.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_PIPELINELOADS
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+bool isLoad(Operation *op) {
+  return isa<vector::TransferReadOp, vector::LoadOp, vector::MaskedLoadOp,
+             vector::GatherOp, memref::LoadOp>(op);
+}
+
+// Ops left by dot lowerings that consume loaded operands.
+bool isCompute(Operation *op) {
+  return isa<vector::FMAOp, vector::ContractionOp, vector::OuterProductOp,
+             cpu::DotOp>(op);
+}
+
+// Conservatively true for ops with unknown effects. Prefetches only hint
+// the cache, so they don't order loads.
+bool mayWrite(Operation *op) {
+  if (isMemoryEffectFree(op) || isa<PrefetchOp>(op))
+    return false;
+  auto iface = dyn_cast<MemoryEffectOpInterface>(op);
+  if (!iface)
+    return true;
+  SmallVector<MemoryEffects::EffectInstance> effects;
+  iface.getEffects(effects);
+  return llvm::any_of(effects, [](MemoryEffects::EffectInstance &effect) {
+    return !isa<MemoryEffects::Read>(effect.getEffect());
+  });
+}
+
+int64_t getResultBytes(Operation *op) {
+  int64_t bytes = 0;
+  for (Type ty : op->getResultTypes()) {
+    if (auto vecTy = dyn_cast<VectorType>(ty))
+      bytes += vecTy.getNumElements() * vecTy.getElementTypeBitWidth() / 8;
+    else
+      bytes += 8;
+  }
+  return bytes;
+}
+
+// Put loads feeding compute ops, together with their address computations,
+// into the first stage and everything else into the last one, so loads of
+// the next numStages - 1 iterations are issued before the compute of the
+// current one. Only innermost loops without writes are pipelined, and only
+// if the loads in flight fit maxStageBytes.
+bool getSchedule(scf::ForOp forOp, unsigned numStages, int64_t maxStageBytes,
+                 std::vector<std::pair<Operation *, unsigned>> &schedule) {
+  Block *body = forOp.getBody();
+  SmallVector<Operation *> worklist;
+  for (Operation &op : body->without_terminator()) {
+    if (op.getNumRegions() || mayWrite(&op))
+      return false;
+    if (isCompute(&op))
+      worklist.push_back(&op);
+  }
+  if (worklist.empty())
+    return false;
+
+  // Loads used by compute ops directly or through pure ops.
+  SetVector<Operation *> early;
+  DenseSet<Operation *> visited;
+  while (!worklist.empty()) {
+    Operation *op = worklist.pop_back_val();
+    for (Value operand : op->getOperands()) {
+      Operation *def = operand.getDefiningOp();
+      if (!def || def->getBlock() != body || !visited.insert(def).second)
+        continue;
+      if (isLoad(def))
+        early.insert(def);
+      else if (isMemoryEffectFree(def) && !isCompute(def))
+        worklist.push_back(def);
+    }
+  }
+  if (early.empty())
+    return false;
+
+  int64_t stageBytes = 0;
+  for (Operation *op : early)
+    stageBytes += getResultBytes(op);
+  if (stageBytes * (numStages - 1) > maxStageBytes)
+    return false;
+
+  // Addresses of the loads, including their updates for the next iteration
+  // carried through loop arguments, are computed in the first stage too.
+  Operation *yield = body->getTerminator();
+  worklist.assign(early.begin(), early.end());
+  while (!worklist.empty()) {
+    Operation *op = worklist.pop_back_val();
+    for (Value operand : op->getOperands()) {
+      if (auto arg = dyn_cast<BlockArgument>(operand))
+        if (arg.getOwner() == body && arg != forOp.getInductionVar())
+          operand = yield->getOperand(arg.getArgNumber() - 1);
+      Operation *def = operand.getDefiningOp();
+      if (!def || def->getBlock() != body)
+        continue;
+      if (isCompute(def))
+        return false;
+      if (early.insert(def))
+        worklist.push_back(def);
+    }
+  }
+
+  for (Operation &op : body->without_terminator())
+    if (early.contains(&op))
+      schedule.emplace_back(&op, 0);
+  for (Operation &op : body->without_terminator())
+    if (!early.contains(&op))
+      schedule.emplace_back(&op, numStages - 1);
+  return true;
+}
+
+// Loads of iterations past the end of a loop with dynamic bounds are put
+// under scf.if yielding zeros. Pure ops and prefetches are kept as is.
+Operation *predicateRead(RewriterBase &rewriter, Operation *op, Value pred) {
+  if (isMemoryEffectFree(op) || isa<PrefetchOp>(op))
+    return op;
+  if (op->getNumRegions() || mayWrite(op))
+    return nullptr;
+  SmallVector<TypedAttr> zeros;
+  for (Type ty : op->getResultTypes()) {
+    TypedAttr zero = rewriter.getZeroAttr(ty);
+    if (!zero)
+      return nullptr;
+    zeros.push_back(zero);
+  }
+
+  rewriter.setInsertionPoint(op);
+  auto ifOp = rewriter.create<scf::IfOp>(
+      op->getLoc(), pred,
+      [&](OpBuilder &b, Location loc) {
+        b.create<scf::YieldOp>(loc, b.clone(*op)->getResults());
+      },
+      [&](OpBuilder &b, Location loc) {
+        SmallVector<Value> vals;
+        for (TypedAttr zero : zeros)
+          vals.push_back(b.create<arith::ConstantOp>(loc, zero));
+        b.create<scf::YieldOp>(loc, vals);
+      });
+  rewriter.replaceOp(op, ifOp);
+  return ifOp;
+}
+
+struct PipelineLoads
+    : public triton::cpu::impl::PipelineLoadsBase<PipelineLoads> {
+  PipelineLoads() = default;
+
+  PipelineLoads(unsigned numStages, unsigned maxStageBytes) {
+    this->numStages = numStages;
+    this->maxStageBytes = maxStageBytes;
+  }
+
+  void runOnOperation() override {
+    if (numStages < 2)
+      return;
+    ModuleOp mod = getOperation();
+
+    SmallVector<scf::ForOp> loops;
+    mod.walk([&](scf::ForOp forOp) { loops.push_back(forOp); });
+    for (scf::ForOp forOp : loops) {
+      std::vector<std::pair<Operation *, unsigned>> schedule;
+      if (!getSchedule(forOp, numStages, maxStageBytes, schedule))
+        continue;
+
+      triton::PipeliningOption options;
+      options.getScheduleFn =
+          [&](scf::ForOp, std::vector<std::pair<Operation *, unsigned>> &s) {
+            s = std::move(schedule);
+          };
+      options.supportDynamicLoops = true;
+      options.peelEpilogue = true;
+      options.predicateFn = predicateRead;
+      IRRewriter rewriter(forOp);
+      (void)triton::pipelineForLoop(rewriter, forOp, options);
+    }
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createPipelineLoads() {
+  return std::make_unique<PipelineLoads>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createPipelineLoads(unsigned numStages, unsigned maxStageBytes) {
+  return std::make_unique<PipelineLoads>(numStages, maxStageBytes);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
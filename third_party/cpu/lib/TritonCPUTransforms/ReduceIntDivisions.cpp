@@ -0,0 +1,162 @@
+#include "cpu/include/TritonCPUTransforms/OptCommon.h"
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/Math/IR/Math.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_REDUCEINTDIVISIONS
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Scalar of a vector splat, e.g. of a kernel argument or a value computed
+// per program. Constant divisors are left to LLVM, which uses the same
+// technique for them.
+Value getSplatSource(Value vec) {
+  Value src;
+  if (auto splat = vec.getDefiningOp<vector::SplatOp>())
+    src = splat.getInput();
+  else if (auto bcast = vec.getDefiningOp<vector::BroadcastOp>())
+    src = bcast.getSource();
+  if (!src || isa<VectorType>(src.getType()) ||
+      matchPattern(src, m_Constant()))
+    return Value();
+  return src;
+}
+
+// Magic numbers of unsigned 32-bit divisions by d, see Hacker's Delight,
+// 10-8: n / d = (t + ((n - t) >> sh1)) >> sh2 for t = mulhi(n, m), where
+// m = 2^32 * (2^l - d) / d + 1, sh1 = min(l, 1), sh2 = max(l - 1, 0) and
+// l = ceil(log2(d)).
+struct DivMagic {
+  Value m;
+  Value sh1;
+  Value sh2;
+};
+
+// Compute magic numbers right after the divisor is defined, which is at the
+// kernel entry for arguments and outside of loops the divisor is invariant
+// in. Zero divisors are replaced with 1 so the computation doesn't trap
+// when divisions are behind conditions.
+DivMagic getDivMagic(Location loc, Value d, PatternRewriter &rewriter) {
+  OpBuilder::InsertionGuard guard(rewriter);
+  rewriter.setInsertionPointAfterValue(d);
+  Type i32Ty = rewriter.getI32Type();
+  Type i64Ty = rewriter.getI64Type();
+  Value one = int_cst(i32Ty, 1);
+  d = op_select(op_icmp_eq(d, int_cst(i32Ty, 0)), one, d);
+  Value l = op_subi(int_cst(i32Ty, 32),
+                    rewriter.create<math::CountLeadingZerosOp>(
+                        loc, op_subi(d, one)));
+  Value d64 = op_zext(i64Ty, d);
+  Value pow64 = op_shl(int_cst(i64Ty, 1), op_zext(i64Ty, l));
+  Value m64 = op_addi(
+      op_divui(op_shl(op_subi(pow64, d64), int_cst(i64Ty, 32)), d64),
+      int_cst(i64Ty, 1));
+  DivMagic magic;
+  magic.m = op_trunci(i32Ty, m64);
+  magic.sh1 = op_minui(l, one);
+  magic.sh2 = op_subi(l, magic.sh1);
+  return magic;
+}
+
+Value udiv(Location loc, Value n, const DivMagic &magic,
+           PatternRewriter &rewriter) {
+  Type ty = n.getType();
+  auto splat = [&](Value val) {
+    return rewriter.create<vector::SplatOp>(loc, ty, val);
+  };
+  Value t = mulhiUI(loc, n, splat(magic.m), rewriter);
+  Value q = op_addi(t, op_lshr(op_subi(n, t), splat(magic.sh1)));
+  return op_lshr(q, splat(magic.sh2));
+}
+
+// Replace divisions and remainders of i32 vectors by splats of scalars with
+// multiplications by magic numbers. Vector divisions have no SIMD
+// instructions and are scalarized otherwise. Signed divisions divide
+// absolute values and fix the sign of the quotient, absolute values of
+// INT_MIN are correct as unsigned numbers.
+template <typename OpT, bool isSigned, bool isRem>
+struct ReduceIntDivision : public OpRewritePattern<OpT> {
+  using OpRewritePattern<OpT>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(OpT op,
+                                PatternRewriter &rewriter) const override {
+    auto vecTy = dyn_cast<VectorType>(op.getType());
+    if (!vecTy || !vecTy.getElementType().isInteger(32))
+      return failure();
+    Value d = getSplatSource(op.getRhs());
+    if (!d)
+      return failure();
+
+    Location loc = op.getLoc();
+    Value n = op.getLhs();
+    Value q;
+    if (isSigned) {
+      Value dAbs;
+      {
+        OpBuilder::InsertionGuard guard(rewriter);
+        rewriter.setInsertionPointAfterValue(d);
+        dAbs = rewriter.create<math::AbsIOp>(loc, d);
+      }
+      DivMagic magic = getDivMagic(loc, dAbs, rewriter);
+      q = udiv(loc, rewriter.create<math::AbsIOp>(loc, n), magic, rewriter);
+      Value dVec = op.getRhs();
+      Value negate = op_icmp_slt(op_xor(n, dVec), cst_like(n, 0));
+      q = op_select(negate, op_subi(cst_like(q, 0), q), q);
+    } else {
+      q = udiv(loc, n, getDivMagic(loc, d, rewriter), rewriter);
+    }
+    Value res = isRem ? op_subi(n, op_muli(q, op.getRhs())) : q;
+    rewriter.replaceOp(op, res);
+    return success();
+  }
+};
+
+struct ReduceIntDivisions
+    : public triton::cpu::impl::ReduceIntDivisionsBase<ReduceIntDivisions> {
+  ReduceIntDivisions() = default;
+
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    RewritePatternSet patterns(context);
+    patterns.add<ReduceIntDivision<arith::DivUIOp, false, false>>(context);
+    patterns.add<ReduceIntDivision<arith::DivSIOp, true, false>>(context);
+    patterns.add<ReduceIntDivision<arith::RemUIOp, false, true>>(context);
+    patterns.add<ReduceIntDivision<arith::RemSIOp, true, true>>(context);
+    if (failed(mlir::applyPatternsGreedily(mod, std::move(patterns))))
+      return signalPassFailure();
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createReduceIntDivisions() {
+  return std::make_unique<ReduceIntDivisions>();
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -0,0 +1,345 @@
+#include "cpu/include/TritonCPUTransforms/OptCommon.h"
+#include "cpu/include/TritonCPUTransforms/Passes.h"
+
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+#include "llvm/ADT/SetVector.h"
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+#define GEN_PASS_DEF_STRIPMINEVECTORS
+#include "cpu/include/TritonCPUTransforms/Passes.h.inc"
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+// Integer constant of a sequence first + i * step, e.g. of tl.arange.
+struct IntSequence {
+  APInt first;
+  APInt step;
+};
+
+std::optional<IntSequence> getIntSequence(Value val) {
+  DenseIntElementsAttr attr;
+  if (!matchPattern(val, m_Constant(&attr)) || attr.getNumElements() < 2 ||
+      !attr.getElementType().isInteger() ||
+      attr.getElementType().isInteger(1))
+    return std::nullopt;
+  auto vals = llvm::to_vector(attr.getValues<APInt>());
+  APInt first = vals[0];
+  APInt step = vals[1] - first;
+  for (int64_t i = 2; i < attr.getNumElements(); ++i)
+    if (vals[i] - vals[i - 1] != step)
+      return std::nullopt;
+  return IntSequence{first, step};
+}
+
+// Values chains are cut at and recomputed per sub-block: splats of scalars
+// and constants that are splats or integer sequences.
+bool isChainLeaf(Value val) {
+  if (auto bcast = val.getDefiningOp<vector::BroadcastOp>())
+    return !isa<VectorType>(bcast.getSourceType());
+  if (val.getDefiningOp<vector::SplatOp>())
+    return true;
+  SplatElementsAttr splat;
+  return matchPattern(val, m_Constant(&splat)) ||
+         getIntSequence(val).has_value();
+}
+
+// Pointer a memref is built for, with offsets added to it skipped.
+Value getBasePtr(Value memRef) {
+  auto ptrToMemRef = memRef.getDefiningOp<PtrToMemRefOp>();
+  if (!ptrToMemRef)
+    return Value();
+  Value ptr = ptrToMemRef.getSrc();
+  while (auto addPtr = ptr.getDefiningOp<triton::AddPtrOp>())
+    ptr = addPtr.getPtr();
+  return ptr;
+}
+
+// Loads of a chain are moved to the store and interleaved with stores of
+// other sub-blocks. It's allowed for loads of the stored elements. Without
+// noalias, any two pointers may alias, e.g. for in-place kernels reading
+// the buffer they write at an offset. With noalias, loads by other kernel
+// arguments are allowed too.
+bool isSafeToInterleave(Value loadMemRef, ValueRange loadIndices,
+                        Value storeMemRef, ValueRange storeIndices,
+                        bool noalias) {
+  if (loadMemRef == storeMemRef && llvm::equal(loadIndices, storeIndices))
+    return true;
+  if (!noalias)
+    return false;
+  Value loadPtr = getBasePtr(loadMemRef);
+  Value storePtr = getBasePtr(storeMemRef);
+  return loadPtr && storePtr && loadPtr != storePtr &&
+         isa<BlockArgument>(loadPtr) && isa<BlockArgument>(storePtr);
+}
+
+// Split a store of a large 1D vector and the elementwise ops and loads
+// computing it into a loop over register-sized sub-blocks, so that
+// intermediate values of the chain don't spill.
+template <typename OpT>
+struct StripMineChain : public OpRewritePattern<OpT> {
+  StripMineChain(MLIRContext *context, int64_t subBlockBits, int64_t minBits,
+                 bool noalias)
+      : OpRewritePattern<OpT>(context), subBlockBits(subBlockBits),
+        minBits(minBits), noalias(noalias) {}
+
+  LogicalResult matchAndRewrite(OpT storeOp,
+                                PatternRewriter &rewriter) const override {
+    auto vecTy = storeOp.getVectorType();
+    if (vecTy.getRank() != 1 ||
+        vecTy.getNumElements() * vecTy.getElementTypeBitWidth() <= minBits)
+      return failure();
+    int64_t numElems = vecTy.getNumElements();
+
+    SetVector<Operation *> chain;
+    if (!collectChain(storeOp, numElems, chain))
+      return failure();
+    if (!hasNoMemoryHazards(storeOp, chain))
+      return failure();
+
+    // Sub-blocks fill subBlockBits with the widest elements of the chain.
+    int64_t maxElemBits = vecTy.getElementTypeBitWidth();
+    for (Operation *op : chain)
+      for (Type ty : op->getResultTypes())
+        maxElemBits = std::max<int64_t>(
+            maxElemBits, cast<VectorType>(ty).getElementTypeBitWidth());
+    int64_t subSize = std::max<int64_t>(subBlockBits / maxElemBits, 1);
+    if (numElems % subSize || numElems / subSize < 2)
+      return failure();
+
+    Location loc = storeOp.getLoc();
+    IRMapping mapping;
+    auto forOp = rewriter.create<scf::ForOp>(loc, index_cst(0),
+                                             index_cst(numElems),
+                                             index_cst(subSize));
+    rewriter.setInsertionPointToStart(forOp.getBody());
+    Value iv = forOp.getInductionVar();
+    auto mapLeaves = [&](Operation *op) {
+      for (Value operand : op->getOperands())
+        if (!mapping.contains(operand) && isa<VectorType>(operand.getType()))
+          mapping.map(operand, createLeaf(loc, operand, iv, subSize, rewriter));
+    };
+    for (Operation *op : chain) {
+      mapLeaves(op);
+      if (auto loadOp = dyn_cast<vector::LoadOp>(op)) {
+        mapping.map(loadOp.getResult(),
+                    rewriter.create<vector::LoadOp>(
+                        loc, getSubTy(loadOp.getVectorType(), subSize),
+                        loadOp.getBase(),
+                        offsetIndices(loc, loadOp.getIndices(), iv, rewriter)));
+      } else if (auto loadOp = dyn_cast<vector::MaskedLoadOp>(op)) {
+        mapping.map(loadOp.getResult(),
+                    rewriter.create<vector::MaskedLoadOp>(
+                        loc, getSubTy(loadOp.getVectorType(), subSize),
+                        loadOp.getBase(),
+                        offsetIndices(loc, loadOp.getIndices(), iv, rewriter),
+                        mapping.lookup(loadOp.getMask()),
+                        mapping.lookup(loadOp.getPassThru())));
+      } else {
+        Operation *newOp = rewriter.clone(*op, mapping);
+        for (Value res : newOp->getResults())
+          res.setType(getSubTy(cast<VectorType>(res.getType()), subSize));
+      }
+    }
+    mapLeaves(storeOp);
+    auto indices = offsetIndices(loc, storeOp.getIndices(), iv, rewriter);
+    if constexpr (std::is_same_v<OpT, vector::MaskedStoreOp>)
+      rewriter.create<vector::MaskedStoreOp>(
+          loc, storeOp.getBase(), indices, mapping.lookup(storeOp.getMask()),
+          mapping.lookup(storeOp.getValueToStore()));
+    else
+      rewriter.create<vector::StoreOp>(
+          loc, mapping.lookup(storeOp.getValueToStore()), storeOp.getBase(),
+          indices);
+
+    rewriter.eraseOp(storeOp);
+    for (Operation *op : llvm::reverse(chain))
+      rewriter.eraseOp(op);
+    return success();
+  }
+
+private:
+  static VectorType getSubTy(VectorType vecTy, int64_t subSize) {
+    return VectorType::get(subSize, vecTy.getElementType());
+  }
+
+  // Collect loads and elementwise ops computing the stored value and mask in
+  // program order. They must be in the block of the store and used only by
+  // the chain, leaves are recomputed per sub-block.
+  bool collectChain(OpT storeOp, int64_t numElems,
+                    SetVector<Operation *> &chain) const {
+    SmallVector<Value> worklist;
+    auto pushVectors = [&](Operation *op) {
+      for (Value operand : op->getOperands())
+        if (isa<VectorType>(operand.getType()))
+          worklist.push_back(operand);
+    };
+    pushVectors(storeOp);
+    while (!worklist.empty()) {
+      Value val = worklist.pop_back_val();
+      auto vecTy = cast<VectorType>(val.getType());
+      if (vecTy.getRank() != 1 || vecTy.getNumElements() != numElems)
+        return false;
+      if (isChainLeaf(val))
+        continue;
+      Operation *op = val.getDefiningOp();
+      if (!op || op->getBlock() != storeOp->getBlock())
+        return false;
+      if (chain.contains(op))
+        continue;
+      if (auto loadOp = dyn_cast<vector::LoadOp>(op)) {
+        if (!isSafeToInterleave(loadOp.getBase(), loadOp.getIndices(),
+                                storeOp.getBase(), storeOp.getIndices(),
+                                noalias))
+          return false;
+      } else if (auto loadOp = dyn_cast<vector::MaskedLoadOp>(op)) {
+        if (!isSafeToInterleave(loadOp.getBase(), loadOp.getIndices(),
+                                storeOp.getBase(), storeOp.getIndices(),
+                                noalias))
+          return false;
+        worklist.push_back(loadOp.getMask());
+        worklist.push_back(loadOp.getPassThru());
+      } else if (op->hasTrait<OpTrait::Elementwise>() &&
+                 isMemoryEffectFree(op) && op->getNumResults() == 1) {
+        pushVectors(op);
+      } else {
+        return false;
+      }
+      chain.insert(op);
+    }
+
+    for (Operation *op : chain)
+      for (Operation *user : op->getUsers())
+        if (user != storeOp && !chain.contains(user))
+          return false;
+    SmallVector<Operation *> ops(chain.begin(), chain.end());
+    llvm::sort(ops, [](Operation *lhs, Operation *rhs) {
+      return lhs->isBeforeInBlock(rhs);
+    });
+    chain = SetVector<Operation *>(ops.begin(), ops.end());
+    return true;
+  }
+
+  // Loads are moved to the store, so memory must not be written in between.
+  bool hasNoMemoryHazards(OpT storeOp,
+                          const SetVector<Operation *> &chain) const {
+    auto firstLoad = llvm::find_if(chain, [](Operation *op) {
+      return isa<vector::LoadOp, vector::MaskedLoadOp>(op);
+    });
+    if (firstLoad == chain.end())
+      return true;
+    for (Operation *op = (*firstLoad)->getNextNode(); op != storeOp;
+         op = op->getNextNode()) {
+      if (chain.contains(op) || isMemoryEffectFree(op))
+        continue;
+      auto iface = dyn_cast<MemoryEffectOpInterface>(op);
+      if (!iface || !iface.onlyHasEffect<MemoryEffects::Read>())
+        return false;
+    }
+    return true;
+  }
+
+  SmallVector<Value> offsetIndices(Location loc, ValueRange indices, Value iv,
+                                   PatternRewriter &rewriter) const {
+    SmallVector<Value> res(indices);
+    res.back() = op_addi(res.back(), iv);
+    return res;
+  }
+
+  // Sub-block of a leaf starting at element iv.
+  Value createLeaf(Location loc, Value val, Value iv, int64_t subSize,
+                   PatternRewriter &rewriter) const {
+    auto subTy = getSubTy(cast<VectorType>(val.getType()), subSize);
+    if (auto bcast = val.getDefiningOp<vector::BroadcastOp>())
+      return rewriter.create<vector::BroadcastOp>(loc, subTy,
+                                                  bcast.getSource());
+    if (auto splat = val.getDefiningOp<vector::SplatOp>())
+      return rewriter.create<vector::BroadcastOp>(loc, subTy,
+                                                  splat.getInput());
+    SplatElementsAttr splat;
+    if (matchPattern(val, m_Constant(&splat)))
+      return rewriter.create<arith::ConstantOp>(loc, splat.resizeSplat(subTy));
+    auto seq = *getIntSequence(val);
+    SmallVector<APInt> elems;
+    for (int64_t i = 0; i < subSize; ++i)
+      elems.push_back(seq.first + seq.step * i);
+    Value res = rewriter.create<arith::ConstantOp>(
+        loc, DenseElementsAttr::get(subTy, elems));
+    Type elemTy = subTy.getElementType();
+    Value start = op_muli(op_index_cast(elemTy, iv),
+                          rewriter.create<arith::ConstantOp>(
+                              loc, rewriter.getIntegerAttr(elemTy, seq.step)));
+    return op_addi(res,
+                   rewriter.create<vector::BroadcastOp>(loc, subTy, start));
+  }
+
+  int64_t subBlockBits;
+  int64_t minBits;
+  bool noalias;
+};
+
+struct StripMineVectors
+    : public triton::cpu::impl::StripMineVectorsBase<StripMineVectors> {
+  StripMineVectors() = default;
+
+  StripMineVectors(unsigned vectorBits, unsigned subBlockVectors,
+                   unsigned minVectors, bool noalias) {
+    this->vectorBits = vectorBits;
+    this->subBlockVectors = subBlockVectors;
+    this->minVectors = minVectors;
+    this->noalias = noalias;
+  }
+
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    int64_t subBlockBits = vectorBits * subBlockVectors;
+    int64_t minBits = vectorBits * minVectors;
+    RewritePatternSet patterns(context);
+    patterns.add<StripMineChain<vector::StoreOp>,
+                 StripMineChain<vector::MaskedStoreOp>>(context, subBlockBits,
+                                                        minBits, noalias);
+    if (failed(mlir::applyPatternsGreedily(mod, std::move(patterns))))
+      return signalPassFailure();
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createStripMineVectors() {
+  return std::make_unique<StripMineVectors>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createStripMineVectors(unsigned vectorBits, unsigned subBlockVectors,
+                       unsigned minVectors, bool noalias) {
+  return std::make_unique<StripMineVectors>(vectorBits, subBlockVectors,
+                                            minVectors, noalias);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
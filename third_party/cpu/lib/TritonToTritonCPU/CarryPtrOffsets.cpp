@@ -0,0 +1,150 @@
+#include "cpu/include/TritonToTritonCPU/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "triton-cpu-carry-ptr-offsets"
+#define DBGS() (llvm::dbgs() << "[" DEBUG_TYPE "]: ")
+#define LDBG(X) LLVM_DEBUG(DBGS() << X << "\n")
+
+namespace mlir {
+namespace triton {
+#define GEN_PASS_DEF_CARRYPTROFFSETS
+#include "cpu/include/TritonToTritonCPU/Passes.h.inc"
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+
+namespace {
+
+// Return true if the tensor has the same value in all its elements, which
+// can be computed as a scalar.
+bool isUniform(Value val) {
+  if (val.getDefiningOp<SplatOp>())
+    return true;
+  SplatElementsAttr splatAttr;
+  return matchPattern(val, m_Constant(&splatAttr));
+}
+
+Value getUniformScalar(OpBuilder &b, Location loc, Value val) {
+  if (auto splatOp = val.getDefiningOp<SplatOp>())
+    return splatOp.getSrc();
+  SplatElementsAttr splatAttr;
+  matchPattern(val, m_Constant(&splatAttr));
+  return b.create<arith::ConstantOp>(loc,
+                                     splatAttr.getSplatValue<TypedAttr>());
+}
+
+// Return true if the iteration argument is a tensor of pointers advanced by
+// the same offset for all its elements, e.g. ptrs += BLOCK_K * stride.
+bool isUniformlyAdvancedPtrs(scf::ForOp forOp, BlockArgument arg) {
+  auto tensorTy = dyn_cast<RankedTensorType>(arg.getType());
+  if (!tensorTy || !isa<PointerType>(tensorTy.getElementType()))
+    return false;
+  auto addPtrOp =
+      forOp.getTiedLoopYieldedValue(arg)->get().getDefiningOp<AddPtrOp>();
+  return addPtrOp && addPtrOp.getPtr() == arg &&
+         isUniform(addPtrOp.getOffset());
+}
+
+// Carry a scalar offset from the initial pointers instead of the tensor of
+// pointers itself, and rebuild the pointers at the start of each iteration:
+//   for (ptrs = init; ...; ptrs += splat(step))
+//     -> for (off = 0; ...; off += step) { ptrs = init + splat(off); }
+// Pointers then keep their symbolic base and offsets, so memory accesses
+// compute scalar row pointers from them rather than extracting them from a
+// vector of addresses rebuilt on every iteration.
+void carryPtrOffsets(scf::ForOp forOp) {
+  SmallVector<unsigned> argIdxs;
+  for (BlockArgument arg : forOp.getRegionIterArgs())
+    if (isUniformlyAdvancedPtrs(forOp, arg))
+      argIdxs.push_back(arg.getArgNumber() - forOp.getNumInductionVars());
+  if (argIdxs.empty())
+    return;
+  LDBG("Carrying offsets of " << argIdxs.size() << " pointer tensors.");
+
+  Location loc = forOp.getLoc();
+  IRRewriter rewriter(forOp);
+  Type offTy = rewriter.getI64Type();
+  Value zero = rewriter.create<arith::ConstantOp>(
+      loc, rewriter.getIntegerAttr(offTy, 0));
+  SmallVector<Value> offInits(argIdxs.size(), zero);
+  auto yieldOp = cast<scf::YieldOp>(forOp.getBody()->getTerminator());
+  auto newForOp = cast<scf::ForOp>(*forOp.replaceWithAdditionalYields(
+      rewriter, offInits, false,
+      [&](OpBuilder &b, Location loc, ArrayRef<BlockArgument> newBBArgs) {
+        SmallVector<Value> offs;
+        for (auto [idx, off] : llvm::zip(argIdxs, newBBArgs)) {
+          auto addPtrOp = yieldOp.getOperand(idx).getDefiningOp<AddPtrOp>();
+          Value step = getUniformScalar(b, loc, addPtrOp.getOffset());
+          if (step.getType() != offTy)
+            step = b.create<arith::ExtSIOp>(loc, offTy, step);
+          offs.push_back(b.create<arith::AddIOp>(loc, off, step));
+        }
+        return offs;
+      }));
+
+  auto offArgs = newForOp.getRegionIterArgs().take_back(argIdxs.size());
+  auto offResults = newForOp.getResults().take_back(argIdxs.size());
+  yieldOp = cast<scf::YieldOp>(newForOp.getBody()->getTerminator());
+  for (auto [idx, offArg, offResult] :
+       llvm::zip(argIdxs, offArgs, offResults)) {
+    Value init = newForOp.getInitArgs()[idx];
+    auto ptrTy = cast<RankedTensorType>(init.getType());
+    auto rebuildPtrs = [&](Value off) -> Value {
+      Value offs = rewriter.create<SplatOp>(loc, ptrTy.clone(offTy), off);
+      return rewriter.create<AddPtrOp>(loc, ptrTy, init, offs);
+    };
+
+    BlockArgument arg = newForOp.getRegionIterArgs()[idx];
+    rewriter.setInsertionPointToStart(newForOp.getBody());
+    rewriter.replaceAllUsesWith(arg, rebuildPtrs(offArg));
+    rewriter.setInsertionPointAfter(newForOp);
+    rewriter.replaceAllUsesWith(newForOp.getResult(idx),
+                                rebuildPtrs(offResult));
+
+    // Directly yield the original pointers, they would be later removed as
+    // unused together with their step.
+    Operation *step = yieldOp.getOperand(idx).getDefiningOp();
+    yieldOp.setOperand(idx, arg);
+    if (step->use_empty())
+      rewriter.eraseOp(step);
+  }
+}
+
+struct CarryPtrOffsets
+    : public triton::impl::CarryPtrOffsetsBase<CarryPtrOffsets> {
+  CarryPtrOffsets() = default;
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+    // Loops are collected first, since rewriting a loop replaces it.
+    SmallVector<scf::ForOp> loops;
+    mod.walk([&](scf::ForOp forOp) { loops.push_back(forOp); });
+    for (scf::ForOp forOp : loops)
+      carryPtrOffsets(forOp);
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createCarryPtrOffsets() {
+  return std::make_unique<CarryPtrOffsets>();
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
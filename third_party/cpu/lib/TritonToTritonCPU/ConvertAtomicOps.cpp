@@ -2,6 +2,7 @@
 
 #include "cpu/include/TritonToTritonCPU/Passes.h"
 
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/Utils/IndexingUtils.h"
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
 #include "mlir/Pass/Pass.h"
@@ -30,6 +31,7 @@ public:
       : ConversionTarget(ctx) {
     addLegalDialect<vector::VectorDialect>();
     addLegalDialect<arith::ArithDialect>();
+    addLegalDialect<memref::MemRefDialect>();
     addLegalDialect<scf::SCFDialect>();
     addLegalDialect<TritonDialect>();
     addLegalDialect<TritonCPUDialect>();
@@ -71,40 +73,320 @@ struct AtomicRMWOpConversion : public OpConversionPattern<triton::AtomicRMWOp> {
 
     auto ptrTy = cast<RankedTensorType>(op.getPtr().getType()).getElementType();
     auto vecTy = cast<VectorType>(vals.getType());
-    auto strides = computeStrides(vecTy.getShape());
-    Value res =
+    Value zero =
         rewriter.create<arith::ConstantOp>(loc, rewriter.getZeroAttr(vecTy));
+    Value varMask = mask && !maskCst ? mask : nullptr;
+
+    // Masked off lanes are redirected to a dummy stack slot instead of
+    // branching around their atomics.
+    Value dummyPtr;
+    if (varMask)
+      dummyPtr = createDummySlot(loc, op, vecTy.getElementType(), rewriter);
+
+    // All lanes updating the same address are combined in registers and
+    // the memory is updated with a single atomic.
+    if (Value ptr = getSplatSrc(ptrs); ptr && op.getResult().use_empty()) {
+      if (auto kind = getCombiningKind(rmwOp, vecTy.getElementType())) {
+        Value res = combineLanes(loc, ptr, ptrTy, vals, mask, maskCst,
+                                 dummyPtr, rmwOp, *kind, sem, scope, rewriter);
+        if (res) {
+          rewriter.replaceOp(op, zero);
+          return success();
+        }
+      }
+    }
+
+    auto strides = computeStrides(vecTy.getShape());
+    auto isLaneActive = [&](int64_t idx) {
+      return !maskCst ||
+             cast<DenseElementsAttr>(maskCst.getValue()).getValues<bool>()[idx];
+    };
+    auto extractLane = [&](Value vec, int64_t idx) -> Value {
+      if (!vec)
+        return nullptr;
+      return rewriter.create<vector::ExtractOp>(loc, vec,
+                                                delinearize(idx, strides));
+    };
+
+    // Adjacent fp16/bf16 lanes are updated together by a CAS on the
+    // containing 32-bit word.
+    bool pairLanes = rmwOp == RMWOp::FADD &&
+                     vecTy.getElementTypeBitWidth() == 16 &&
+                     vecTy.getShape().back() % 2 == 0;
+    Value res = zero;
     int64_t numElems = vecTy.getNumElements();
-    for (int64_t idx = 0; idx < numElems; ++idx) {
-      auto indices = delinearize(idx, strides);
-      Value ptr = rewriter.create<vector::ExtractOp>(loc, ptrs, indices);
-      ptr = rewriter.create<IntToPtrOp>(loc, ptrTy, ptr);
-      Value val = rewriter.create<vector::ExtractOp>(loc, vals, indices);
-      Value resElem;
-
-      if (mask && !maskCst) {
-        // Non-const mask values are lowered to CF.
-        Value maskVal = rewriter.create<vector::ExtractOp>(loc, mask, indices);
-        resElem = lowerScalarMaskToCF(loc, rmwOp, ptr, val, maskVal, sem, scope,
-                                      rewriter);
-      } else if (!mask ||
-                 (maskCst && cast<DenseElementsAttr>(maskCst.getValue())
-                                 .getValues<bool>()[idx])) {
-        // Const true mask case.
-        resElem = rewriter.create<triton::AtomicRMWOp>(
-            loc, val.getType(), rmwOp, ptr, val, nullptr, sem, scope);
+    for (int64_t idx = 0; idx < numElems; idx += pairLanes ? 2 : 1) {
+      if (pairLanes && isLaneActive(idx) && isLaneActive(idx + 1)) {
+        auto [lo, hi] = lowerPairedFAdd(
+            loc, extractLane(ptrs, idx), extractLane(ptrs, idx + 1),
+            extractLane(vals, idx), extractLane(vals, idx + 1),
+            extractLane(varMask, idx), extractLane(varMask, idx + 1),
+            dummyPtr, ptrTy, sem, scope, rewriter);
+        res = rewriter.create<vector::InsertOp>(loc, lo, res,
+                                                delinearize(idx, strides));
+        res = rewriter.create<vector::InsertOp>(loc, hi, res,
+                                                delinearize(idx + 1, strides));
+        continue;
       }
 
-      // Elements with const false mask are skipped.
-      if (resElem) {
-        res = rewriter.create<vector::InsertOp>(loc, resElem, res, indices);
+      for (int64_t lane = idx; lane < idx + (pairLanes ? 2 : 1); ++lane) {
+        // Elements with const false mask are skipped.
+        if (!isLaneActive(lane))
+          continue;
+        Value resElem = lowerLane(
+            loc, rmwOp, extractLane(ptrs, lane), extractLane(vals, lane),
+            extractLane(varMask, lane), dummyPtr, ptrTy, sem, scope, rewriter);
+        res = rewriter.create<vector::InsertOp>(loc, resElem, res,
+                                                delinearize(lane, strides));
       }
     }
 
+    // Masked off lanes return zeros.
+    if (varMask && !op.getResult().use_empty())
+      res = rewriter.create<arith::SelectOp>(loc, varMask, res, zero);
+
     rewriter.replaceOp(op, res);
     return success();
   }
 
+  // Apply an atomic to a single lane. Masked off lane is redirected to the
+  // dummy slot.
+  Value lowerLane(Location loc, RMWOp rmwOp, Value ptr, Value val,
+                  Value mask, Value dummyPtr, Type ptrTy, MemSemantic sem,
+                  MemSyncScope scope, OpBuilder &b) const {
+    if (mask)
+      ptr = b.create<arith::SelectOp>(loc, mask, ptr, dummyPtr);
+    ptr = b.create<IntToPtrOp>(loc, ptrTy, ptr);
+    return b.create<triton::AtomicRMWOp>(loc, val.getType(), rmwOp, ptr, val,
+                                         nullptr, sem, scope);
+  }
+
+  // Add two fp16/bf16 values to adjacent elements. If both elements are
+  // active and form an aligned 32-bit word, then the word is updated by a
+  // CAS loop with additions computed in fp32. Otherwise, elements are
+  // updated separately. Low address holds the low half on supported
+  // little-endian targets.
+  std::pair<Value, Value>
+  lowerPairedFAdd(Location loc, Value ptr0, Value ptr1, Value val0,
+                  Value val1, Value mask0, Value mask1, Value dummyPtr,
+                  Type ptrTy, MemSemantic sem, MemSyncScope scope,
+                  ConversionPatternRewriter &rewriter) const {
+    Type elemTy = val0.getType();
+    Type i16Ty = rewriter.getI16Type();
+    Type i32Ty = rewriter.getI32Type();
+    Type i64Ty = rewriter.getI64Type();
+    Type f32Ty = rewriter.getF32Type();
+    auto i64Cst = [&](int64_t val) -> Value {
+      return rewriter.create<arith::ConstantIntOp>(loc, val, i64Ty);
+    };
+
+    Value contiguous = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::eq, ptr1,
+        rewriter.create<arith::AddIOp>(loc, ptr0, i64Cst(2)));
+    Value aligned = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::eq,
+        rewriter.create<arith::AndIOp>(loc, ptr0, i64Cst(3)), i64Cst(0));
+    Value cond = rewriter.create<arith::AndIOp>(loc, contiguous, aligned);
+    if (mask0) {
+      cond = rewriter.create<arith::AndIOp>(loc, cond, mask0);
+      cond = rewriter.create<arith::AndIOp>(loc, cond, mask1);
+    }
+
+    auto getHalf = [&](OpBuilder &b, Value word, int64_t shift) -> Value {
+      if (shift)
+        word = b.create<arith::ShRUIOp>(
+            loc, word, b.create<arith::ConstantIntOp>(loc, shift, i32Ty));
+      Value bits = b.create<arith::TruncIOp>(loc, i16Ty, word);
+      return b.create<arith::BitcastOp>(loc, elemTy, bits);
+    };
+    auto addToHalf = [&](OpBuilder &b, Value word, int64_t shift,
+                         Value val) -> Value {
+      Value sum = b.create<arith::AddFOp>(
+          loc, b.create<arith::ExtFOp>(loc, f32Ty, getHalf(b, word, shift)),
+          b.create<arith::ExtFOp>(loc, f32Ty, val));
+      Value bits = b.create<arith::BitcastOp>(
+          loc, i16Ty, b.create<arith::TruncFOp>(loc, elemTy, sum));
+      Value res = b.create<arith::ExtUIOp>(loc, i32Ty, bits);
+      if (shift)
+        res = b.create<arith::ShLIOp>(
+            loc, res, b.create<arith::ConstantIntOp>(loc, shift, i32Ty));
+      return res;
+    };
+
+    auto ifOp = rewriter.create<scf::IfOp>(
+        loc, cond,
+        [&](OpBuilder &b, Location loc) {
+          Type wordPtrTy = PointerType::get(
+              i32Ty, cast<PointerType>(ptrTy).getAddressSpace());
+          Value wordPtr = b.create<IntToPtrOp>(loc, wordPtrTy, ptr0);
+          // Start with a zero guess, a failed CAS returns the actual value.
+          Value init = b.create<arith::ConstantIntOp>(loc, 0, i32Ty);
+          auto whileOp = b.create<scf::WhileOp>(
+              loc, TypeRange{i32Ty}, ValueRange{init},
+              [&](OpBuilder &b, Location loc, ValueRange args) {
+                Value old = args[0];
+                Value newWord =
+                    b.create<arith::OrIOp>(loc, addToHalf(b, old, 0, val0),
+                                           addToHalf(b, old, 16, val1));
+                Value prev = b.create<triton::AtomicCASOp>(
+                    loc, i32Ty, wordPtr, old, newWord, sem, scope);
+                Value retry = b.create<arith::CmpIOp>(
+                    loc, arith::CmpIPredicate::ne, prev, old);
+                b.create<scf::ConditionOp>(loc, retry, ValueRange{prev});
+              },
+              [&](OpBuilder &b, Location loc, ValueRange args) {
+                b.create<scf::YieldOp>(loc, args);
+              });
+          Value oldWord = whileOp.getResult(0);
+          b.create<scf::YieldOp>(loc, ValueRange{getHalf(b, oldWord, 0),
+                                                 getHalf(b, oldWord, 16)});
+        },
+        [&](OpBuilder &b, Location loc) {
+          Value res0 = lowerLane(loc, RMWOp::FADD, ptr0, val0, mask0,
+                                 dummyPtr, ptrTy, sem, scope, b);
+          Value res1 = lowerLane(loc, RMWOp::FADD, ptr1, val1, mask1,
+                                 dummyPtr, ptrTy, sem, scope, b);
+          b.create<scf::YieldOp>(loc, ValueRange{res0, res1});
+        });
+    return {ifOp.getResult(0), ifOp.getResult(1)};
+  }
+
+  // Return a scalar value splatted to a vector, or nullptr.
+  Value getSplatSrc(Value vec) const {
+    while (auto cast = vec.getDefiningOp<UnrealizedConversionCastOp>())
+      vec = cast.getOperand(0);
+    if (auto splat = vec.getDefiningOp<vector::SplatOp>())
+      return splat.getInput();
+    if (auto bcast = vec.getDefiningOp<vector::BroadcastOp>())
+      if (!isa<VectorType>(bcast.getSourceType()))
+        return bcast.getSource();
+    return nullptr;
+  }
+
+  // Get a reduction kind to combine lanes updating the same address.
+  // Exchange cannot be combined, float min/max is not expected here.
+  std::optional<vector::CombiningKind> getCombiningKind(RMWOp rmwOp,
+                                                        Type elemTy) const {
+    bool isInt = elemTy.isInteger();
+    switch (rmwOp) {
+    case RMWOp::AND:
+      return vector::CombiningKind::AND;
+    case RMWOp::OR:
+      return vector::CombiningKind::OR;
+    case RMWOp::XOR:
+      return vector::CombiningKind::XOR;
+    case RMWOp::ADD:
+    case RMWOp::FADD:
+      return vector::CombiningKind::ADD;
+    case RMWOp::MAX:
+      if (isInt)
+        return vector::CombiningKind::MAXSI;
+      return std::nullopt;
+    case RMWOp::MIN:
+      if (isInt)
+        return vector::CombiningKind::MINSI;
+      return std::nullopt;
+    case RMWOp::UMAX:
+      if (isInt)
+        return vector::CombiningKind::MAXUI;
+      return std::nullopt;
+    case RMWOp::UMIN:
+      if (isInt)
+        return vector::CombiningKind::MINUI;
+      return std::nullopt;
+    default:
+      return std::nullopt;
+    }
+  }
+
+  // Neutral element of the reduction used for masked off lanes.
+  TypedAttr getNeutralAttr(vector::CombiningKind kind, Type elemTy,
+                           ConversionPatternRewriter &rewriter) const {
+    if (auto floatTy = dyn_cast<FloatType>(elemTy))
+      return rewriter.getFloatAttr(
+          floatTy, APFloat::getZero(floatTy.getFloatSemantics(), true));
+    unsigned width = elemTy.getIntOrFloatBitWidth();
+    APInt val;
+    switch (kind) {
+    case vector::CombiningKind::AND:
+    case vector::CombiningKind::MINUI:
+      val = APInt::getAllOnes(width);
+      break;
+    case vector::CombiningKind::MAXSI:
+      val = APInt::getSignedMinValue(width);
+      break;
+    case vector::CombiningKind::MINSI:
+      val = APInt::getSignedMaxValue(width);
+      break;
+    default:
+      val = APInt::getZero(width);
+    }
+    return rewriter.getIntegerAttr(elemTy, val);
+  }
+
+  // Reduce values of all active lanes and apply the result with a single
+  // atomic. Return nullptr if all lanes are masked off.
+  Value combineLanes(Location loc, Value ptr, Type ptrTy, Value vals,
+                     Value mask, arith::ConstantOp maskCst, Value dummyPtr,
+                     RMWOp rmwOp, vector::CombiningKind kind, MemSemantic sem,
+                     MemSyncScope scope,
+                     ConversionPatternRewriter &rewriter) const {
+    auto vecTy = cast<VectorType>(vals.getType());
+    Type elemTy = vecTy.getElementType();
+    if (maskCst) {
+      auto maskAttr = cast<DenseElementsAttr>(maskCst.getValue());
+      if (llvm::none_of(maskAttr.getValues<bool>(), [](bool v) { return v; }))
+        return nullptr;
+    }
+    if (mask) {
+      Value neutral = rewriter.create<arith::ConstantOp>(
+          loc, DenseElementsAttr::get(
+                   vecTy, getNeutralAttr(kind, elemTy, rewriter)));
+      vals = rewriter.create<arith::SelectOp>(loc, mask, vals, neutral);
+    }
+    if (vecTy.getRank() != 1)
+      vals = rewriter.create<vector::ShapeCastOp>(
+          loc, VectorType::get(vecTy.getNumElements(), elemTy), vals);
+    Value combined;
+    if (isa<FloatType>(elemTy))
+      combined = rewriter.create<vector::ReductionOp>(
+          loc, kind, vals, arith::FastMathFlags::reassoc);
+    else
+      combined = rewriter.create<vector::ReductionOp>(loc, kind, vals);
+
+    if (dummyPtr) {
+      Value flatMask = mask;
+      if (vecTy.getRank() != 1)
+        flatMask = rewriter.create<vector::ShapeCastOp>(
+            loc, VectorType::get(vecTy.getNumElements(), rewriter.getI1Type()),
+            mask);
+      Value anyActive = rewriter.create<vector::ReductionOp>(
+          loc, vector::CombiningKind::OR, flatMask);
+      ptr = rewriter.create<arith::SelectOp>(loc, anyActive, ptr, dummyPtr);
+    }
+    ptr = rewriter.create<IntToPtrOp>(loc, ptrTy, ptr);
+    return rewriter.create<triton::AtomicRMWOp>(loc, elemTy, rmwOp, ptr,
+                                                combined, nullptr, sem, scope);
+  }
+
+  // Allocate a stack slot updated by masked off lanes and return its
+  // address as an integer.
+  Value createDummySlot(Location loc, Operation *op, Type elemTy,
+                        ConversionPatternRewriter &rewriter) const {
+    Operation *allocaPoint = op;
+    while (!isa<triton::FuncOp>(allocaPoint->getParentOp()))
+      allocaPoint = allocaPoint->getParentOp();
+    OpBuilder::InsertionGuard g(rewriter);
+    rewriter.setInsertionPoint(allocaPoint);
+    Value slot = rewriter.create<memref::AllocaOp>(
+        loc, MemRefType::get({}, elemTy),
+        rewriter.getIntegerAttr(rewriter.getI64Type(), 64));
+    Value addr =
+        rewriter.create<memref::ExtractAlignedPointerAsIndexOp>(loc, slot);
+    return rewriter.create<arith::IndexCastOp>(loc, rewriter.getI64Type(),
+                                               addr);
+  }
+
   Value lowerScalarMaskToCF(Location loc, RMWOp rmwOp, Value ptr, Value val,
                             Value mask, MemSemantic sem, MemSyncScope scope,
                             ConversionPatternRewriter &rewriter) const {
@@ -92,9 +92,7 @@ struct MulhiUIOpConversion : public OpConversionPattern<triton::MulhiUIOp> {
     auto loc = op.getLoc();
     auto lhs = rewriter.getRemappedValue(op.getX());
     auto rhs = rewriter.getRemappedValue(op.getY());
-    Value res =
-        rewriter.create<arith::MulUIExtendedOp>(loc, lhs, rhs).getHigh();
-    rewriter.replaceOp(op, res);
+    rewriter.replaceOp(op, mulhiUI(loc, lhs, rhs, rewriter));
     return success();
   }
 };
@@ -0,0 +1,167 @@
+#include "TypeConverter.h"
+
+#include "cpu/include/TritonToTritonCPU/Passes.h"
+
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/Utils/IndexingUtils.h"
+#include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/IR/BuiltinDialect.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+#define GEN_PASS_DEF_CONVERTGATHEROP
+#include "cpu/include/TritonToTritonCPU/Passes.h.inc"
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+using namespace mlir::triton::cpu;
+
+namespace {
+
+class GatherConversionTarget : public ConversionTarget {
+public:
+  explicit GatherConversionTarget(MLIRContext &ctx, TypeConverter &converter)
+      : ConversionTarget(ctx) {
+    addLegalDialect<mlir::BuiltinDialect>();
+    addLegalDialect<vector::VectorDialect>();
+    addLegalDialect<arith::ArithDialect>();
+    addLegalDialect<memref::MemRefDialect>();
+    addLegalDialect<TritonDialect>();
+    addLegalDialect<TritonCPUDialect>();
+
+    addIllegalOp<triton::GatherOp>();
+  }
+};
+
+struct GatherOpConversion : public OpConversionPattern<triton::GatherOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  // The source is stored to a temporary buffer and elements are gathered
+  // from it by linear offsets. Offsets along dimensions other than the
+  // gather axis are constants, so only the indices are scaled at runtime.
+  // Gathers from small buffers are turned into in-register permutes by
+  // ConvertGathersToPermutes for targets that have them.
+  LogicalResult
+  matchAndRewrite(triton::GatherOp op, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto loc = op.getLoc();
+    auto src = rewriter.getRemappedValue(op.getSrc());
+    auto indices = rewriter.getRemappedValue(op.getIndices());
+    auto srcTy = cast<VectorType>(src.getType());
+    auto idxTy = cast<VectorType>(indices.getType());
+    auto resTy =
+        cast<VectorType>(getTypeConverter()->convertType(op.getType()));
+    Type elemTy = srcTy.getElementType();
+    int64_t axis = op.getAxis();
+
+    Operation *allocaPoint = op;
+    while (!isa<triton::FuncOp>(allocaPoint->getParentOp()))
+      allocaPoint = allocaPoint->getParentOp();
+
+    int64_t numSrcElems = srcTy.getNumElements();
+    auto flatSrcTy = VectorType::get(numSrcElems, elemTy);
+    if (srcTy.getRank() != 1)
+      src = rewriter.create<vector::ShapeCastOp>(loc, flatSrcTy, src);
+    Value zeroIdx = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+    Value buf = createAlloca(loc, MemRefType::get({numSrcElems}, elemTy),
+                             allocaPoint, rewriter);
+    rewriter.create<vector::StoreOp>(loc, src, buf, zeroIdx);
+
+    SmallVector<int64_t> srcStrides = computeStrides(srcTy.getShape());
+    SmallVector<int64_t> idxStrides = computeStrides(idxTy.getShape());
+    int64_t numElems = idxTy.getNumElements();
+    SmallVector<int32_t> baseOffsets;
+    for (int64_t i = 0; i < numElems; ++i) {
+      SmallVector<int64_t> coords = delinearize(i, idxStrides);
+      int64_t offset = 0;
+      for (int64_t dim = 0; dim < idxTy.getRank(); ++dim)
+        if (dim != axis)
+          offset += coords[dim] * srcStrides[dim];
+      baseOffsets.push_back(offset);
+    }
+
+    auto flatIdxTy = VectorType::get(numElems, idxTy.getElementType());
+    auto offsetsTy = VectorType::get(numElems, rewriter.getI32Type());
+    Value offsets = indices;
+    if (idxTy.getRank() != 1)
+      offsets = rewriter.create<vector::ShapeCastOp>(loc, flatIdxTy, offsets);
+    unsigned idxBits = idxTy.getElementTypeBitWidth();
+    if (idxBits > 32)
+      offsets = rewriter.create<arith::TruncIOp>(loc, offsetsTy, offsets);
+    else if (idxBits < 32)
+      offsets = rewriter.create<arith::ExtSIOp>(loc, offsetsTy, offsets);
+    if (srcStrides[axis] != 1) {
+      Value stride = rewriter.create<arith::ConstantOp>(
+          loc, DenseElementsAttr::get(
+                   offsetsTy, static_cast<int32_t>(srcStrides[axis])));
+      offsets = rewriter.create<arith::MulIOp>(loc, offsets, stride);
+    }
+    if (llvm::any_of(baseOffsets, [](int32_t val) { return val != 0; })) {
+      Value base = rewriter.create<arith::ConstantOp>(
+          loc, DenseElementsAttr::get(offsetsTy, ArrayRef(baseOffsets)));
+      offsets = rewriter.create<arith::AddIOp>(loc, offsets, base);
+    }
+
+    auto flatResTy = VectorType::get(numElems, elemTy);
+    auto maskTy = VectorType::get(numElems, rewriter.getI1Type());
+    Value mask = rewriter.create<arith::ConstantOp>(
+        loc, DenseElementsAttr::get(maskTy, true));
+    Value passThru = rewriter.create<arith::ConstantOp>(
+        loc, flatResTy, rewriter.getZeroAttr(flatResTy));
+    Value res = rewriter.create<vector::GatherOp>(
+        loc, flatResTy, buf, ValueRange{zeroIdx}, offsets, mask, passThru);
+    if (resTy.getRank() != 1)
+      res = rewriter.create<vector::ShapeCastOp>(loc, resTy, res);
+    rewriter.replaceOp(op, res);
+
+    return success();
+  }
+
+  Value createAlloca(Location loc, MemRefType ty, Operation *before,
+                     ConversionPatternRewriter &rewriter) const {
+    OpBuilder::InsertionGuard g(rewriter);
+    rewriter.setInsertionPoint(before);
+    return rewriter.create<memref::AllocaOp>(
+        loc, ty, rewriter.getIntegerAttr(rewriter.getI64Type(), 64));
+  }
+};
+
+struct ConvertGatherOp
+    : public triton::impl::ConvertGatherOpBase<ConvertGatherOp> {
+  using ConvertGatherOpBase::ConvertGatherOpBase;
+
+  ConvertGatherOp() : ConvertGatherOpBase() {}
+
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    TritonToTritonCPUTypeConverter typeConverter;
+    GatherConversionTarget convTarget(*context, typeConverter);
+    RewritePatternSet patterns(context);
+    patterns.add<GatherOpConversion>(typeConverter, context);
+
+    if (failed(applyPartialConversion(mod, convTarget, std::move(patterns))))
+      return signalPassFailure();
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createConvertGatherOp() {
+  return std::make_unique<ConvertGatherOp>();
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
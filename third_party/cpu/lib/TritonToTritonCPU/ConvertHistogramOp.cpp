@@ -5,6 +5,7 @@
 #include "mlir/Dialect/Index/IR/IndexDialect.h"
 #include "mlir/Dialect/Index/IR/IndexOps.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
 #include "mlir/IR/BuiltinDialect.h"
 #include "mlir/Pass/Pass.h"
@@ -34,6 +35,8 @@ public:
     addLegalDialect<vector::VectorDialect>();
     addLegalDialect<arith::ArithDialect>();
     addLegalDialect<math::MathDialect>();
+    addLegalDialect<memref::MemRefDialect>();
+    addLegalDialect<scf::SCFDialect>();
     addLegalDialect<TritonDialect>();
     addLegalDialect<TritonCPUDialect>();
 
@@ -41,61 +44,106 @@ public:
   }
 };
 
+// Number of sub-histograms updated by consecutive input elements. Separate
+// sub-histograms break dependencies between updates of the same bin, they
+// are summed up after the loop.
+constexpr int64_t numSubHistograms = 4;
+
 struct HistogramOpConversion : public OpConversionPattern<triton::HistogramOp> {
   using OpConversionPattern::OpConversionPattern;
 
+  // Input elements are stored to a temporary buffer and processed in a loop,
+  // each one incrementing its bin counter in memory. Elements out of the
+  // bins range are ignored.
   LogicalResult
   matchAndRewrite(triton::HistogramOp op, OpAdaptor adaptor,
                   ConversionPatternRewriter &rewriter) const override {
     auto loc = op.getLoc();
     auto src = rewriter.getRemappedValue(op.getSrc());
-    auto srcTy = dyn_cast<VectorType>(src.getType());
+    auto srcTy = cast<VectorType>(src.getType());
     auto resTy =
-        dyn_cast<VectorType>(getTypeConverter()->convertType(op.getType()));
-
+        cast<VectorType>(getTypeConverter()->convertType(op.getType()));
+    Type srcElemTy = srcTy.getElementType();
+    Type resElemTy = resTy.getElementType();
+    int64_t numElems = srcTy.getNumElements();
+    int64_t numBins = resTy.getDimSize(0);
+    int64_t numSubHists =
+        numElems % numSubHistograms == 0 ? numSubHistograms : 1;
+
+    Operation *allocaPoint = op;
+    while (!isa<triton::FuncOp>(allocaPoint->getParentOp()))
+      allocaPoint = allocaPoint->getParentOp();
+
+    auto flatSrcTy = VectorType::get(numElems, srcElemTy);
     if (srcTy.getRank() != 1)
-      llvm_unreachable("unsupported input for histogram op (rank != 1)");
-
+      src = rewriter.create<vector::ShapeCastOp>(loc, flatSrcTy, src);
+    Value zeroIdx = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+    Value srcBuf = createAlloca(
+        loc, MemRefType::get({numElems}, srcElemTy), allocaPoint, rewriter);
+    rewriter.create<vector::StoreOp>(loc, src, srcBuf, zeroIdx);
+
+    Value histBuf =
+        createAlloca(loc, MemRefType::get({numSubHists, numBins}, resElemTy),
+                     allocaPoint, rewriter);
     Value zero = rewriter.create<arith::ConstantOp>(
         loc, resTy, rewriter.getZeroAttr(resTy));
-    Value one = rewriter.create<arith::ConstantOp>(loc, resTy,
-                                                   rewriter.getOneAttr(resTy));
-    VectorType cmpVecTy =
-        VectorType::get(resTy.getShape(), srcTy.getElementType());
-    Value rangeVec = rewriter.create<arith::ConstantOp>(
-        loc, resTy, makeRangeAttr(cmpVecTy, rewriter));
-    Value res = zero;
-    for (int64_t i = 0; i < srcTy.getShape()[0]; ++i) {
-      Value idx = rewriter.create<arith::ConstantOp>(
-          loc, rewriter.getIndexType(), rewriter.getIndexAttr(i));
-      Value elem = rewriter.create<vector::ExtractElementOp>(loc, src, idx);
-      Value elemVec = rewriter.create<vector::BroadcastOp>(loc, cmpVecTy, elem);
-      Value mask = rewriter.create<arith::CmpIOp>(loc, arith::CmpIPredicate::eq,
-                                                  elemVec, rangeVec);
-      Value delta = vector::selectPassthru(rewriter, mask, one, zero);
-      res = rewriter.create<arith::AddIOp>(loc, res, delta);
+    for (int64_t i = 0; i < numSubHists; ++i)
+      rewriter.create<vector::StoreOp>(
+          loc, zero, histBuf,
+          ValueRange{rewriter.create<arith::ConstantIndexOp>(loc, i),
+                     zeroIdx});
+
+    Value numElemsVal = rewriter.create<arith::ConstantIndexOp>(loc, numElems);
+    Value stepVal = rewriter.create<arith::ConstantIndexOp>(loc, numSubHists);
+    Value numBinsVal = rewriter.create<arith::ConstantOp>(
+        loc, rewriter.getIntegerAttr(srcElemTy, numBins));
+    Value oneVal = rewriter.create<arith::ConstantOp>(
+        loc, rewriter.getIntegerAttr(resElemTy, 1));
+    rewriter.create<scf::ForOp>(
+        loc, zeroIdx, numElemsVal, stepVal, ValueRange{},
+        [&](OpBuilder &b, Location loc, Value iv, ValueRange iterArgs) {
+          for (int64_t i = 0; i < numSubHists; ++i) {
+            Value subHistIdx = b.create<arith::ConstantIndexOp>(loc, i);
+            Value elemIdx = b.create<arith::AddIOp>(loc, iv, subHistIdx);
+            Value elem = b.create<memref::LoadOp>(loc, srcBuf, elemIdx);
+            // Negative values are out of range in the unsigned comparison.
+            Value inRange = b.create<arith::CmpIOp>(
+                loc, arith::CmpIPredicate::ult, elem, numBinsVal);
+            b.create<scf::IfOp>(loc, inRange, [&](OpBuilder &b, Location loc) {
+              Value bin = b.create<arith::IndexCastOp>(loc, b.getIndexType(),
+                                                       elem);
+              Value count = b.create<memref::LoadOp>(
+                  loc, histBuf, ValueRange{subHistIdx, bin});
+              count = b.create<arith::AddIOp>(loc, count, oneVal);
+              b.create<memref::StoreOp>(loc, count, histBuf,
+                                        ValueRange{subHistIdx, bin});
+              b.create<scf::YieldOp>(loc);
+            });
+          }
+          b.create<scf::YieldOp>(loc);
+        });
+
+    Value res;
+    for (int64_t i = 0; i < numSubHists; ++i) {
+      Value subHist = rewriter.create<vector::LoadOp>(
+          loc, resTy, histBuf,
+          ValueRange{rewriter.create<arith::ConstantIndexOp>(loc, i),
+                     zeroIdx});
+      if (res)
+        subHist = rewriter.create<arith::AddIOp>(loc, res, subHist);
+      res = subHist;
     }
-
     rewriter.replaceOp(op, res);
 
     return success();
   }
 
-  TypedAttr makeRangeAttr(VectorType resTy,
-                          ConversionPatternRewriter &rewriter) const {
-    Type elemTy = resTy.getElementType();
-    if (elemTy.isInteger(32)) {
-      SmallVector<int32_t> range(resTy.getShape()[0]);
-      std::iota(range.begin(), range.end(), 0);
-      return rewriter.getI32VectorAttr(range);
-    } else if (elemTy.isInteger(64)) {
-      SmallVector<int64_t> range(resTy.getShape()[0]);
-      std::iota(range.begin(), range.end(), 0);
-      return rewriter.getI64VectorAttr(range);
-    } else {
-      llvm_unreachable(
-          "unsupported src elem type for histogram (expected i32 or i64)");
-    }
+  Value createAlloca(Location loc, MemRefType ty, Operation *before,
+                     ConversionPatternRewriter &rewriter) const {
+    OpBuilder::InsertionGuard g(rewriter);
+    rewriter.setInsertionPoint(before);
+    return rewriter.create<memref::AllocaOp>(
+        loc, ty, rewriter.getIntegerAttr(rewriter.getI64Type(), 64));
   }
 };
 
@@ -1,3 +1,4 @@
+#include "MemoryAccessCostModel.h"
 #include "TypeConverter.h"
 
 #include "cpu/include/Analysis/TensorPtrShapeInfo.h"
@@ -8,9 +9,12 @@
 #include "mlir/Dialect/ControlFlow/IR/ControlFlowOps.h"
 #include "mlir/Dialect/Index/IR/IndexDialect.h"
 #include "mlir/Dialect/Index/IR/IndexOps.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/Utils/IndexingUtils.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 
@@ -37,6 +41,124 @@ using namespace mlir::triton::cpu;
 
 namespace {
 
+// Lowering of an access by a tensor of pointers that isn't contiguous.
+enum class AccessLowering { Scalar, GatherScatter, Strided };
+
+// Distance in elements between pointers of consecutive rows of a tensor of
+// pointers, equal to factor * scale, where scale is an optional scalar value.
+struct RowStride {
+  int64_t factor = 0;
+  Value scale;
+};
+
+// Get the row stride of a tensor that is the same for all its columns, e.g.
+// for pointers computed as base + rows[:, None] * ld + cols[None, :]. The
+// base and the leading dimension are treated as opaque scalars, so they can
+// be loaded from memory, as in grouped GEMM kernels. Pointers carried by loops
+// keep their stride if they are advanced by values uniform across rows.
+std::optional<RowStride> getRowStride(Value val) {
+  if (auto arg = dyn_cast<BlockArgument>(val)) {
+    auto forOp = dyn_cast<scf::ForOp>(arg.getOwner()->getParentOp());
+    if (!forOp || arg == forOp.getInductionVar())
+      return std::nullopt;
+    Operation *step = forOp.getTiedLoopYieldedValue(arg)->get().getDefiningOp();
+    if (!isa_and_nonnull<AddPtrOp, arith::AddIOp>(step))
+      return std::nullopt;
+    if (step->getOperand(0) != arg && step->getOperand(1) != arg)
+      return std::nullopt;
+    Value inc = step->getOperand(0) == arg ? step->getOperand(1)
+                                           : step->getOperand(0);
+    auto incStride = getRowStride(inc);
+    if (!incStride || incStride->factor != 0)
+      return std::nullopt;
+    return getRowStride(forOp.getTiedLoopInit(arg)->get());
+  }
+
+  Operation *def = val.getDefiningOp();
+  if (!def)
+    return std::nullopt;
+  if (isa<SplatOp>(def))
+    return RowStride();
+  if (auto cstOp = dyn_cast<arith::ConstantOp>(def)) {
+    auto denseVal = dyn_cast<DenseElementsAttr>(cstOp.getValue());
+    if (denseVal && denseVal.isSplat())
+      return RowStride();
+    return std::nullopt;
+  }
+  if (isa<MakeRangeOp>(def))
+    return RowStride{1, nullptr};
+  if (auto expandOp = dyn_cast<ExpandDimsOp>(def)) {
+    if (expandOp.getAxis() == 0)
+      return RowStride();
+    return getRowStride(expandOp.getSrc());
+  }
+  if (auto broadcastOp = dyn_cast<BroadcastOp>(def)) {
+    auto srcTy = cast<RankedTensorType>(broadcastOp.getSrc().getType());
+    if (srcTy.getShape()[0] == 1)
+      return RowStride();
+    return getRowStride(broadcastOp.getSrc());
+  }
+  if (isa<arith::ExtSIOp>(def))
+    return getRowStride(def->getOperand(0));
+  if (isa<AddPtrOp, arith::AddIOp>(def)) {
+    auto lhs = getRowStride(def->getOperand(0));
+    auto rhs = getRowStride(def->getOperand(1));
+    if (!lhs || !rhs)
+      return std::nullopt;
+    if (lhs->factor == 0)
+      return rhs;
+    if (rhs->factor == 0)
+      return lhs;
+    if (lhs->scale || rhs->scale)
+      return std::nullopt;
+    return RowStride{lhs->factor + rhs->factor, nullptr};
+  }
+  if (auto mulOp = dyn_cast<arith::MulIOp>(def)) {
+    for (auto [vals, scale] :
+         {std::make_pair(mulOp.getLhs(), mulOp.getRhs()),
+          std::make_pair(mulOp.getRhs(), mulOp.getLhs())}) {
+      APInt scaleVal;
+      if (matchPattern(scale, m_ConstantInt(&scaleVal))) {
+        auto stride = getRowStride(vals);
+        if (!stride)
+          return std::nullopt;
+        return RowStride{stride->factor * scaleVal.getSExtValue(),
+                         stride->scale};
+      }
+      if (auto splatOp = scale.getDefiningOp<SplatOp>()) {
+        auto stride = getRowStride(vals);
+        if (!stride || stride->scale)
+          return std::nullopt;
+        return RowStride{stride->factor, splatOp.getSrc()};
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+// Return true if the scalar value of a uniform tensor, as computed by
+// computeScalarValue, only depends on values defined outside of the loop.
+bool isScalarInvariant(Value vals, scf::ForOp forOp) {
+  if (forOp.isDefinedOutsideOfLoop(vals))
+    return true;
+  if (!canComputeScalarValue(vals))
+    return false;
+  Operation *def = vals.getDefiningOp();
+  if (auto splatOp = dyn_cast<SplatOp>(def))
+    return forOp.isDefinedOutsideOfLoop(splatOp.getSrc());
+  return llvm::all_of(def->getOperands(), [&](Value operand) {
+    return isScalarInvariant(operand, forOp);
+  });
+}
+
+bool hasMemoryWrites(Operation *op) {
+  auto effects = getEffectsRecursively(op);
+  return !effects ||
+         llvm::any_of(*effects, [](const MemoryEffects::EffectInstance &it) {
+           return isa<MemoryEffects::Write>(it.getEffect());
+         });
+}
+
 template <typename OpT>
 struct MemoryOpConversion : public OpConversionPattern<OpT> {
   using OpConversionPattern<OpT>::OpConversionPattern;
@@ -46,12 +168,56 @@ struct MemoryOpConversion : public OpConversionPattern<OpT> {
   MemoryOpConversion(ModuleAxisInfoAnalysis &axisInfoAnalysis,
                      ModuleTensorPtrShapeInfoAnalysis &shapeInfoAnalysis,
                      TypeConverter &typeConverter, MLIRContext *context,
-                     bool useGatherScatter)
+                     bool useGatherScatter,
+                     const MemoryAccessCostModel &costModel)
       : OpConversionPattern<OpT>(typeConverter, context),
-        axisAnalysis(axisInfoAnalysis), shapeAnalysis(shapeInfoAnalysis) {
+        axisAnalysis(axisInfoAnalysis), shapeAnalysis(shapeInfoAnalysis),
+        costModel(costModel) {
     this->useGatherScatter = useGatherScatter;
   }
 
+  // Choose the lowering of an access by a tensor of pointers that isn't
+  // contiguous. Without the cost model, gathers and scatters are used
+  // whenever they are allowed.
+  AccessLowering chooseLowering(OpT op) const {
+    auto [basePtr, offset] = getMemoryBaseOffset(op);
+    bool canGatherScatter = useGatherScatter && basePtr && offset;
+    if (!costModel.enabled())
+      return canGatherScatter ? AccessLowering::GatherScatter
+                              : AccessLowering::Scalar;
+    // Pointers without a common base are gathered or scattered by their
+    // addresses, which is only chosen for hardware gathers and scatters.
+    canGatherScatter = useGatherScatter;
+
+    constexpr bool isLoad = std::is_same_v<OpT, triton::LoadOp>;
+    auto tensorTy = cast<RankedTensorType>(getMemoryOpType(op));
+    int64_t elemBytes =
+        MemoryAccessCostModel::getElemBytes(tensorTy.getElementType());
+    int64_t rowSize = tensorTy.getShape().back();
+    bool masked = static_cast<bool>(op.getMask());
+
+    AccessLowering best = AccessLowering::Scalar;
+    int64_t bestCost = costModel.getScalarCost(rowSize, masked);
+    if (canGatherScatter) {
+      auto cost = costModel.getGatherScatterCost(
+          rowSize, elemBytes,
+          isLoad ? costModel.nativeGather : costModel.nativeScatter);
+      if (cost && *cost < bestCost) {
+        best = AccessLowering::GatherScatter;
+        bestCost = *cost;
+      }
+    }
+    if (isLoad || costModel.nativeMaskedStore) {
+      if (auto stride = getConstantRowStride(axisAnalysis, op.getPtr())) {
+        int64_t cost = costModel.getStridedCost(rowSize, *stride, elemBytes,
+                                                masked || !isLoad);
+        if (cost < bestCost)
+          best = AccessLowering::Strided;
+      }
+    }
+    return best;
+  }
+
   Value extractScalarPointer(Location loc, Value ptrs,
                              ArrayRef<int64_t> indices,
                              ConversionPatternRewriter &rewriter) const {
@@ -90,6 +256,32 @@ struct MemoryOpConversion : public OpConversionPattern<OpT> {
     return rewriter.create<ExtractMemRefOp>(loc, memRefTy, ptr);
   }
 
+  // Gathers and scatters by addresses take 1D vectors.
+  Value flattenVector(Location loc, Value vec,
+                      ConversionPatternRewriter &rewriter) const {
+    auto vecTy = cast<VectorType>(vec.getType());
+    if (vecTy.getRank() == 1)
+      return vec;
+    return rewriter.create<vector::ShapeCastOp>(
+        loc, VectorType::get(vecTy.getNumElements(), vecTy.getElementType()),
+        vec);
+  }
+
+  Value toAddresses(Location loc, Value ptrs,
+                    ConversionPatternRewriter &rewriter) const {
+    auto ptrsTy = cast<VectorType>(ptrs.getType());
+    auto addrsTy = VectorType::get(ptrsTy.getShape(),
+                                   LLVM::LLVMPointerType::get(getContext()));
+    return rewriter.create<LLVM::IntToPtrOp>(loc, addrsTy, ptrs);
+  }
+
+  Value allTrueMask(Location loc, int64_t numElems,
+                    ConversionPatternRewriter &rewriter) const {
+    auto maskTy = VectorType::get(numElems, rewriter.getI1Type());
+    return rewriter.create<arith::ConstantOp>(
+        loc, maskTy, DenseElementsAttr::get(maskTy, true));
+  }
+
   Value convertOtherVal(triton::LoadOp loadOp,
                         ConversionPatternRewriter &rewriter) const {
     if (loadOp.getOther())
@@ -137,10 +329,19 @@ struct MemoryOpConversion : public OpConversionPattern<OpT> {
     return memRef;
   }
 
+  // Boundary checks are kept unless the block is known to stay within the
+  // tensor, e.g. when a pointer is advanced by whole blocks in a loop with
+  // constant bounds that end at the tensor size.
+  bool isInBounds(Value ptr, unsigned dim) const {
+    auto *shapeInfo = shapeAnalysis.getPtrShapeInfo(ptr);
+    return shapeInfo && isTensorPtrInBounds(ptr, *shapeInfo, dim);
+  }
+
 protected:
   ModuleAxisInfoAnalysis &axisAnalysis;
   ModuleTensorPtrShapeInfoAnalysis &shapeAnalysis;
   bool useGatherScatter;
+  MemoryAccessCostModel costModel;
 };
 
 struct LoadOpConversion : public MemoryOpConversion<triton::LoadOp> {
@@ -177,11 +378,20 @@ struct LoadOpConversion : public MemoryOpConversion<triton::LoadOp> {
     auto boundaryChecks = loadOp.getBoundaryCheck();
 
     if (!triton::isTensorPointerType(ptr.getType())) {
+      if (succeeded(lowerToUniformLoads(loadOp, rewriter)))
+        return success();
       auto axisInfo = axisAnalysis.getAxisInfo(ptr);
       if (isContiguousRowMajorAccess(axisInfo, loadOp)) {
+        if (succeeded(lowerToStridedBlock(loadOp, rewriter)))
+          return success();
         return lowerToContiguousRowMajor(loadOp, rewriter);
       }
-      if (useGatherScatter && succeeded(lowerToGather(loadOp, rewriter))) {
+      auto lowering = chooseLowering(loadOp);
+      if (lowering == AccessLowering::Strided) {
+        return lowerToStridedRows(loadOp, rewriter);
+      }
+      if (lowering == AccessLowering::GatherScatter &&
+          succeeded(lowerToGather(loadOp, rewriter))) {
         return success();
       }
       return lowerToScalarLoads(loadOp, rewriter);
@@ -199,7 +409,7 @@ struct LoadOpConversion : public MemoryOpConversion<triton::LoadOp> {
     auto indices = rewriter.create<ExtractIndicesOp>(loc, ptr).getResults();
     SmallVector<bool, 4> inBounds(rank, true);
     for (auto dim : boundaryChecks) {
-      inBounds[dim] = false;
+      inBounds[dim] = isInBounds(ptr, dim);
     }
     Value padding = getPaddingValue(loc, resTy.getElementType(),
                                     loadOp.getPadding(), rewriter);
@@ -209,6 +419,193 @@ struct LoadOpConversion : public MemoryOpConversion<triton::LoadOp> {
     return success();
   }
 
+  Value extractScalar(Location loc, Value vals, ArrayRef<int64_t> indices,
+                      ConversionPatternRewriter &rewriter) const {
+    if (canComputeScalarValue(vals))
+      return computeScalarValue(vals.getDefiningOp(), vals, indices, rewriter);
+    return rewriter.create<vector::ExtractOp>(
+        loc, rewriter.getRemappedValue(vals), indices);
+  }
+
+  // Return the outermost of the loops directly enclosing the load that it can
+  // be hoisted out of, i.e. loops that don't write memory and whose bounds,
+  // as well as the pointer, the mask and the other value of the load, are
+  // defined outside of it.
+  scf::ForOp getInvariantLoadLoop(triton::LoadOp loadOp) const {
+    scf::ForOp res;
+    SmallVector<scf::ForOp> innerLoops;
+    Operation *op = loadOp;
+    while (auto forOp = dyn_cast<scf::ForOp>(op->getParentOp())) {
+      if (!isScalarInvariant(loadOp.getPtr(), forOp) ||
+          (loadOp.getMask() &&
+           !isScalarInvariant(loadOp.getMask(), forOp)) ||
+          (loadOp.getOther() &&
+           !isScalarInvariant(loadOp.getOther(), forOp)) ||
+          hasMemoryWrites(forOp))
+        break;
+      if (llvm::any_of(innerLoops, [&](scf::ForOp inner) {
+            return !forOp.isDefinedOutsideOfLoop(inner.getLowerBound()) ||
+                   !forOp.isDefinedOutsideOfLoop(inner.getUpperBound());
+          }))
+        break;
+      res = forOp;
+      innerLoops.push_back(forOp);
+      op = forOp;
+    }
+    return res;
+  }
+
+  // Load tensors of pointers that are the same along trailing dimensions,
+  // e.g. tl.load(scale_ptr + zeros) or per-row parameters loaded with
+  // broadcast pointers, with a scalar load per row broadcast to the row
+  // instead of gathers or loads of each element. Loads of a single value are
+  // hoisted out of loops they are invariant in when the loops don't write
+  // memory, under a check that the loops run, so they don't read memory the
+  // kernel wouldn't access.
+  LogicalResult
+  lowerToUniformLoads(triton::LoadOp loadOp,
+                      ConversionPatternRewriter &rewriter) const {
+    int64_t uniformDims = getUniformLoadDims(axisAnalysis, loadOp);
+    if (!uniformDims)
+      return failure();
+    auto vecTy =
+        cast<VectorType>(getTypeConverter()->convertType(loadOp.getType()));
+    auto shape = vecTy.getShape();
+    int64_t rank = shape.size();
+
+    auto loc = loadOp.getLoc();
+    Type elemTy = vecTy.getElementType();
+    OpBuilder::InsertionGuard guard(rewriter);
+    SmallVector<Value> preds;
+    if (uniformDims == rank) {
+      if (scf::ForOp forOp = getInvariantLoadLoop(loadOp)) {
+        rewriter.setInsertionPoint(forOp);
+        for (Operation *op = loadOp->getParentOp(); op != forOp->getParentOp();
+             op = op->getParentOp()) {
+          auto loop = cast<scf::ForOp>(op);
+          preds.push_back(rewriter.create<arith::CmpIOp>(
+              loc, arith::CmpIPredicate::slt, loop.getLowerBound(),
+              loop.getUpperBound()));
+        }
+      }
+    }
+
+    auto loadRow = [&](ArrayRef<int64_t> indices) -> Value {
+      Value ptr = extractScalarPointer(loc, loadOp.getPtr(), indices, rewriter);
+      SmallVector<Value> rowPreds(preds);
+      if (loadOp.getMask())
+        rowPreds.push_back(
+            extractScalar(loc, loadOp.getMask(), indices, rewriter));
+      auto doLoad = [&]() -> Value {
+        return rewriter.create<triton::LoadOp>(
+            loc, ptr, loadOp.getCache(), loadOp.getEvict(), false);
+      };
+      if (rowPreds.empty())
+        return doLoad();
+      Value pred = rowPreds.front();
+      for (Value rowPred : ArrayRef(rowPreds).drop_front())
+        pred = rewriter.create<arith::AndIOp>(loc, pred, rowPred);
+      Value other;
+      if (loadOp.getOther())
+        other = extractScalar(loc, loadOp.getOther(), indices, rewriter);
+      else
+        other = rewriter.create<arith::ConstantOp>(
+            loc, rewriter.getZeroAttr(elemTy));
+      auto ifOp = rewriter.create<scf::IfOp>(
+          loc, pred,
+          [&](OpBuilder &builder, Location loc) {
+            rewriter.create<scf::YieldOp>(loc, doLoad());
+          },
+          [&](OpBuilder &builder, Location loc) {
+            rewriter.create<scf::YieldOp>(loc, other);
+          });
+      return ifOp.getResult(0);
+    };
+
+    if (uniformDims == rank) {
+      SmallVector<int64_t> indices(rank, 0);
+      Value val = loadRow(indices);
+      Value res = rewriter.create<vector::BroadcastOp>(loc, vecTy, val);
+      rewriter.replaceOp(loadOp, res);
+      return success();
+    }
+
+    auto outerShape = shape.drop_back(uniformDims);
+    auto rowTy = VectorType::get(shape.take_back(uniformDims), elemTy);
+    auto strides = computeStrides(outerShape);
+    Value res = rewriter.create<arith::ConstantOp>(
+        loc, vecTy,
+        SplatElementsAttr::get(vecTy, rewriter.getZeroAttr(elemTy)));
+    int64_t numRows = ShapedType::getNumElements(outerShape);
+    for (int64_t idx = 0; idx < numRows; ++idx) {
+      SmallVector<int64_t> outerIndices = delinearize(idx, strides);
+      SmallVector<int64_t> indices(outerIndices);
+      indices.append(uniformDims, 0);
+      Value row =
+          rewriter.create<vector::BroadcastOp>(loc, rowTy, loadRow(indices));
+      res = rewriter.create<vector::InsertOp>(loc, row, res, outerIndices);
+    }
+    rewriter.replaceOp(loadOp, res);
+    return success();
+  }
+
+  // Read unmasked dot operands with contiguous rows and a uniform row stride
+  // from a strided memref built for the first pointer, as for block pointers.
+  // Dot lowerings then read such operands directly from memory.
+  LogicalResult
+  lowerToStridedBlock(triton::LoadOp loadOp,
+                      ConversionPatternRewriter &rewriter) const {
+    auto ptrTy = cast<RankedTensorType>(loadOp.getPtr().getType());
+    if (loadOp.getMask() || ptrTy.getRank() != 2 || loadOp->use_empty() ||
+        !llvm::all_of(loadOp->getUsers(),
+                      [](Operation *user) { return isa<triton::DotOp>(user); }))
+      return failure();
+    auto stride = getRowStride(loadOp.getPtr());
+    if (!stride || stride->factor <= 0)
+      return failure();
+
+    auto loc = loadOp.getLoc();
+    auto vecTy =
+        cast<VectorType>(getTypeConverter()->convertType(loadOp.getType()));
+    auto shape = vecTy.getShape();
+    Type i64Ty = rewriter.getI64Type();
+    auto i64Cst = [&](int64_t val) -> Value {
+      return rewriter.create<arith::ConstantOp>(
+          loc, rewriter.getI64IntegerAttr(val));
+    };
+    Value rowStride = i64Cst(stride->factor);
+    if (stride->scale) {
+      Value scale = stride->scale;
+      if (scale.getType() != i64Ty)
+        scale = rewriter.create<arith::ExtSIOp>(loc, i64Ty, scale);
+      rowStride = rewriter.create<arith::MulIOp>(loc, scale, rowStride);
+    }
+    Value zero = rewriter.create<arith::ConstantOp>(
+        loc, rewriter.getI32IntegerAttr(0));
+    Value basePtr =
+        extractScalarPointer(loc, loadOp.getPtr(), {0, 0}, rewriter);
+    SmallVector<int32_t> tensorShape(shape.begin(), shape.end());
+    Value blockPtr = rewriter.create<MakeTensorPtrOp>(
+        loc, basePtr, ValueRange{i64Cst(shape[0]), i64Cst(shape[1])},
+        ValueRange{rowStride, i64Cst(1)}, ValueRange{zero, zero}, tensorShape,
+        ArrayRef<int32_t>{1, 0});
+
+    int64_t memRefStride =
+        stride->scale ? ShapedType::kDynamic : stride->factor;
+    auto layout =
+        StridedLayoutAttr::get(getContext(), 0, {memRefStride, int64_t(1)});
+    auto memRefTy = MemRefType::get(shape, vecTy.getElementType(), layout);
+    Value memRef = rewriter.create<ExtractMemRefOp>(loc, memRefTy, blockPtr);
+    auto indices =
+        rewriter.create<ExtractIndicesOp>(loc, blockPtr).getResults();
+    Value padding = rewriter.create<arith::ConstantOp>(
+        loc, rewriter.getZeroAttr(vecTy.getElementType()));
+    SmallVector<bool, 2> inBounds(2, true);
+    rewriter.replaceOpWithNewOp<vector::TransferReadOp>(
+        loadOp, vecTy, memRef, indices, padding, inBounds);
+    return success();
+  }
+
   LogicalResult
   lowerToContiguousRowMajor(triton::LoadOp loadOp,
                             ConversionPatternRewriter &rewriter) const {
@@ -264,6 +661,81 @@ struct LoadOpConversion : public MemoryOpConversion<triton::LoadOp> {
     return success();
   }
 
+  // Load each row with a constant stride using a contiguous load spanning the
+  // row and a shuffle picking its elements. Masked loads don't access memory
+  // between the elements of a row.
+  LogicalResult lowerToStridedRows(triton::LoadOp loadOp,
+                                   ConversionPatternRewriter &rewriter) const {
+    auto loc = loadOp.getLoc();
+    auto vecTy =
+        dyn_cast<VectorType>(getTypeConverter()->convertType(loadOp.getType()));
+    auto shape = vecTy.getShape();
+    int64_t rowSize = shape.back();
+    int64_t stride = *getConstantRowStride(axisAnalysis, loadOp.getPtr());
+    int64_t spanSize = (rowSize - 1) * stride + 1;
+
+    // Positions of the row elements in the span, and the positions of the span
+    // elements in the row with rowSize for elements between them.
+    SmallVector<int64_t> rowPositions, spanPositions(spanSize, rowSize);
+    for (int64_t i = 0; i < rowSize; ++i) {
+      rowPositions.push_back(i * stride);
+      spanPositions[i * stride] = i;
+    }
+
+    auto strides = computeStrides(shape);
+    int64_t numElems = vecTy.getNumElements();
+    Type spanTy = VectorType::get(spanSize, vecTy.getElementType());
+    Type memRefTy = MemRefType::get(spanSize, vecTy.getElementType());
+    Value mask = loadOp.getMask() ? rewriter.getRemappedValue(loadOp.getMask())
+                                  : nullptr;
+    Value zeroIdx = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+    Value defaultVal = convertOtherVal(loadOp, rewriter);
+    Value noMask;
+    if (mask) {
+      auto maskTy = VectorType::get(rowSize, rewriter.getI1Type());
+      noMask = rewriter.create<arith::ConstantOp>(
+          loc, maskTy, DenseElementsAttr::get(maskTy, false));
+    }
+    Value res = defaultVal;
+    for (int64_t idx = 0; idx < numElems; idx += rowSize) {
+      auto indices = delinearize(idx, strides);
+      SmallVector<int64_t> subIndices(indices.begin(),
+                                      indices.begin() + indices.size() - 1);
+      auto ptr = extractScalarPointer(loc, loadOp.getPtr(), indices, rewriter);
+      Value memRef =
+          rewriter.create<triton::cpu::PtrToMemRefOp>(loc, memRefTy, ptr);
+      Value span;
+      if (mask) {
+        Value subMask = mask;
+        Value passThru = defaultVal;
+        if (shape.size() > 1) {
+          subMask = rewriter.create<vector::ExtractOp>(loc, mask, subIndices);
+          passThru =
+              rewriter.create<vector::ExtractOp>(loc, defaultVal, subIndices);
+        }
+        Value spanMask = rewriter.create<vector::ShuffleOp>(
+            loc, subMask, noMask, spanPositions);
+        Value spanPassThru = rewriter.create<vector::ShuffleOp>(
+            loc, passThru, passThru, spanPositions);
+        span = rewriter.create<vector::MaskedLoadOp>(
+            loc, spanTy, memRef, zeroIdx, spanMask, spanPassThru);
+      } else {
+        span = rewriter.create<vector::LoadOp>(loc, spanTy, memRef, zeroIdx);
+      }
+      Value vec =
+          rewriter.create<vector::ShuffleOp>(loc, span, span, rowPositions);
+
+      if (shape.size() > 1) {
+        res = rewriter.create<vector::InsertOp>(loc, vec, res, subIndices);
+      } else {
+        res = vec;
+      }
+    }
+
+    rewriter.replaceOp(loadOp, res);
+    return success();
+  }
+
   LogicalResult lowerToGather(triton::LoadOp loadOp,
                               ConversionPatternRewriter &rewriter) const {
     auto loc = loadOp.getLoc();
@@ -274,7 +746,7 @@ struct LoadOpConversion : public MemoryOpConversion<triton::LoadOp> {
     auto [basePtr, offset] = getMemoryBaseOffset(loadOp);
 
     if (!basePtr || !offset)
-      return failure();
+      return lowerToAddressGather(loadOp, rewriter);
 
     auto pointeeType =
         dyn_cast<PointerType>(basePtr.getType()).getPointeeType();
@@ -302,6 +774,32 @@ struct LoadOpConversion : public MemoryOpConversion<triton::LoadOp> {
     return success();
   }
 
+  // Gather elements by a vector of their addresses, when pointers don't have
+  // a common base, e.g. pointers loaded from memory.
+  LogicalResult
+  lowerToAddressGather(triton::LoadOp loadOp,
+                       ConversionPatternRewriter &rewriter) const {
+    auto loc = loadOp.getLoc();
+    auto vecTy = cast<VectorType>(
+        getTypeConverter()->convertType(loadOp.getResult().getType()));
+    Value ptrs = flattenVector(
+        loc, rewriter.getRemappedValue(loadOp.getPtr()), rewriter);
+    Value mask = loadOp.getMask()
+                     ? flattenVector(
+                           loc, rewriter.getRemappedValue(loadOp.getMask()),
+                           rewriter)
+                     : allTrueMask(loc, vecTy.getNumElements(), rewriter);
+    Value passThru =
+        flattenVector(loc, convertOtherVal(loadOp, rewriter), rewriter);
+    int64_t elemBytes =
+        MemoryAccessCostModel::getElemBytes(vecTy.getElementType());
+    Value res = rewriter.create<LLVM::masked_gather>(
+        loc, passThru.getType(), toAddresses(loc, ptrs, rewriter), mask,
+        ValueRange{passThru}, rewriter.getI32IntegerAttr(elemBytes));
+    rewriter.replaceOpWithNewOp<vector::ShapeCastOp>(loadOp, vecTy, res);
+    return success();
+  }
+
   LogicalResult lowerToScalarLoads(triton::LoadOp loadOp,
                                    ConversionPatternRewriter &rewriter) const {
     // Scalar loads and boundary checks are not expected.
@@ -374,7 +872,12 @@ struct StoreOpConversion : public MemoryOpConversion<triton::StoreOp> {
       if (isContiguousRowMajorAccess(axisInfo, storeOp)) {
         return lowerToContiguousRowMajor(storeOp, rewriter);
       }
-      if (useGatherScatter && succeeded(lowerToScatter(storeOp, rewriter))) {
+      auto lowering = chooseLowering(storeOp);
+      if (lowering == AccessLowering::Strided) {
+        return lowerToStridedRows(storeOp, rewriter);
+      }
+      if (lowering == AccessLowering::GatherScatter &&
+          succeeded(lowerToScatter(storeOp, rewriter))) {
         return success();
       }
       return lowerToScalarStores(storeOp, rewriter);
@@ -391,7 +894,7 @@ struct StoreOpConversion : public MemoryOpConversion<triton::StoreOp> {
     auto indices = rewriter.create<ExtractIndicesOp>(loc, ptr).getResults();
     SmallVector<bool, 4> inBounds(rank, true);
     for (auto dim : boundaryChecks) {
-      inBounds[dim] = false;
+      inBounds[dim] = isInBounds(ptr, dim);
     }
     auto vecWrite = rewriter.create<vector::TransferWriteOp>(loc, value, memRef,
                                                              indices, inBounds);
@@ -418,6 +921,9 @@ struct StoreOpConversion : public MemoryOpConversion<triton::StoreOp> {
     Value mask = storeOp.getMask()
                      ? rewriter.getRemappedValue(storeOp.getMask())
                      : nullptr;
+    // Streaming stores bypass caches, outputs written once then don't evict
+    // data that is still in use.
+    bool nontemporal = storeOp.getCache() == triton::CacheModifier::CS;
     Value zeroIdx = rewriter.create<arith::ConstantIndexOp>(loc, 0);
     for (int64_t idx = 0; idx < numElems; idx += shape.back()) {
       auto indices = delinearize(idx, strides);
@@ -434,10 +940,30 @@ struct StoreOpConversion : public MemoryOpConversion<triton::StoreOp> {
           subIndices.pop_back();
           subMask = rewriter.create<vector::ExtractOp>(loc, mask, indices);
         }
-        rewriter.create<vector::MaskedStoreOp>(loc, memRef, zeroIdx, subMask,
-                                               val);
+        if (nontemporal) {
+          // Masked stores can't be non-temporal, so only partial rows use
+          // them.
+          Value isFullRow = rewriter.create<vector::ReductionOp>(
+              loc, vector::CombiningKind::AND, subMask);
+          rewriter.create<scf::IfOp>(
+              loc, isFullRow,
+              [&](OpBuilder &builder, Location loc) {
+                builder.create<vector::StoreOp>(loc, val, memRef, zeroIdx)
+                    .setNontemporal(true);
+                builder.create<scf::YieldOp>(loc);
+              },
+              [&](OpBuilder &builder, Location loc) {
+                builder.create<vector::MaskedStoreOp>(loc, memRef, zeroIdx,
+                                                      subMask, val);
+                builder.create<scf::YieldOp>(loc);
+              });
+        } else {
+          rewriter.create<vector::MaskedStoreOp>(loc, memRef, zeroIdx,
+                                                 subMask, val);
+        }
       } else {
-        rewriter.create<vector::StoreOp>(loc, val, memRef, zeroIdx);
+        rewriter.create<vector::StoreOp>(loc, val, memRef, zeroIdx)
+            .setNontemporal(nontemporal);
       }
     }
 
@@ -445,6 +971,57 @@ struct StoreOpConversion : public MemoryOpConversion<triton::StoreOp> {
     return success();
   }
 
+  // Store each row with a constant stride using a masked store spanning the
+  // row, which skips elements between the row ones.
+  LogicalResult lowerToStridedRows(triton::StoreOp storeOp,
+                                   ConversionPatternRewriter &rewriter) const {
+    auto loc = storeOp.getLoc();
+    auto vals = rewriter.getRemappedValue(storeOp.getValue());
+    auto vecTy = dyn_cast<VectorType>(vals.getType());
+    auto shape = vecTy.getShape();
+    int64_t rowSize = shape.back();
+    int64_t stride = *getConstantRowStride(axisAnalysis, storeOp.getPtr());
+    int64_t spanSize = (rowSize - 1) * stride + 1;
+
+    // Positions of the span elements in the row with rowSize for elements
+    // between the row ones.
+    SmallVector<int64_t> spanPositions(spanSize, rowSize);
+    for (int64_t i = 0; i < rowSize; ++i)
+      spanPositions[i * stride] = i;
+
+    auto strides = computeStrides(shape);
+    int64_t numElems = vecTy.getNumElements();
+    Type memRefTy = MemRefType::get(spanSize, vecTy.getElementType());
+    Value mask = storeOp.getMask()
+                     ? rewriter.getRemappedValue(storeOp.getMask())
+                     : nullptr;
+    auto maskTy = VectorType::get(rowSize, rewriter.getI1Type());
+    Value noMask = rewriter.create<arith::ConstantOp>(
+        loc, maskTy, DenseElementsAttr::get(maskTy, false));
+    Value rowMask = rewriter.create<arith::ConstantOp>(
+        loc, maskTy, DenseElementsAttr::get(maskTy, true));
+    Value zeroIdx = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+    for (int64_t idx = 0; idx < numElems; idx += rowSize) {
+      auto indices = delinearize(idx, strides);
+      auto ptr = extractScalarPointer(loc, storeOp.getPtr(), indices, rewriter);
+      Value memRef =
+          rewriter.create<triton::cpu::PtrToMemRefOp>(loc, memRefTy, ptr);
+      indices.pop_back();
+      Value val = rewriter.create<vector::ExtractOp>(loc, vals, indices);
+      if (mask)
+        rowMask = rewriter.create<vector::ExtractOp>(loc, mask, indices);
+      Value spanMask = rewriter.create<vector::ShuffleOp>(loc, rowMask, noMask,
+                                                          spanPositions);
+      Value spanVal =
+          rewriter.create<vector::ShuffleOp>(loc, val, val, spanPositions);
+      rewriter.create<vector::MaskedStoreOp>(loc, memRef, zeroIdx, spanMask,
+                                             spanVal);
+    }
+
+    rewriter.eraseOp(storeOp);
+    return success();
+  }
+
   LogicalResult lowerToScatter(triton::StoreOp storeOp,
                                ConversionPatternRewriter &rewriter) const {
     auto loc = storeOp.getLoc();
@@ -455,7 +1032,7 @@ struct StoreOpConversion : public MemoryOpConversion<triton::StoreOp> {
     auto [basePtr, offset] = getMemoryBaseOffset(storeOp);
 
     if (!basePtr || !offset)
-      return failure();
+      return lowerToAddressScatter(storeOp, rewriter);
 
     auto strides = computeStrides(shape);
     int64_t numElems = vecTy.getNumElements();
@@ -494,6 +1071,31 @@ struct StoreOpConversion : public MemoryOpConversion<triton::StoreOp> {
     return success();
   }
 
+  // Scatter elements by a vector of their addresses, when pointers don't have
+  // a common base.
+  LogicalResult
+  lowerToAddressScatter(triton::StoreOp storeOp,
+                        ConversionPatternRewriter &rewriter) const {
+    auto loc = storeOp.getLoc();
+    Value vals = flattenVector(
+        loc, rewriter.getRemappedValue(storeOp.getValue()), rewriter);
+    Value ptrs = flattenVector(
+        loc, rewriter.getRemappedValue(storeOp.getPtr()), rewriter);
+    auto vecTy = cast<VectorType>(vals.getType());
+    Value mask = storeOp.getMask()
+                     ? flattenVector(
+                           loc, rewriter.getRemappedValue(storeOp.getMask()),
+                           rewriter)
+                     : allTrueMask(loc, vecTy.getNumElements(), rewriter);
+    int64_t elemBytes =
+        MemoryAccessCostModel::getElemBytes(vecTy.getElementType());
+    rewriter.create<LLVM::masked_scatter>(
+        loc, vals, toAddresses(loc, ptrs, rewriter), mask,
+        rewriter.getI32IntegerAttr(elemBytes));
+    rewriter.eraseOp(storeOp);
+    return success();
+  }
+
   LogicalResult lowerToScalarStores(triton::StoreOp storeOp,
                                     ConversionPatternRewriter &rewriter) const {
     // Scalar stores and boundary checks are not expected.
@@ -581,6 +1183,187 @@ struct CpuLoadOpConversion : public MemoryOpConversion<triton::cpu::LoadOp> {
   }
 };
 
+// Lower a prefetch to prefetches of all cache lines of the block. Blocks
+// addressed by tensors of pointers are prefetched only if their rows are
+// contiguous.
+struct PrefetchOpConversion
+    : public MemoryOpConversion<triton::cpu::PrefetchOp> {
+  using MemoryOpConversion::MemoryOpConversion;
+
+  static constexpr int64_t cacheLineSize = 64;
+
+  LogicalResult
+  matchAndRewrite(triton::cpu::PrefetchOp prefetchOp, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto loc = prefetchOp.getLoc();
+    auto ptr = prefetchOp.getPtr();
+    bool isBlockPtr = triton::isTensorPointerType(ptr.getType());
+    auto blockTy = isBlockPtr ? cast<RankedTensorType>(
+                                    cast<PointerType>(ptr.getType())
+                                        .getPointeeType())
+                              : cast<RankedTensorType>(ptr.getType());
+    Type elemTy = blockTy.getElementType();
+    if (!isBlockPtr)
+      elemTy = cast<PointerType>(elemTy).getPointeeType();
+    auto shape = blockTy.getShape();
+    if (!elemTy.isIntOrFloat() ||
+        (!isBlockPtr && !isContiguousRows(ptr, shape))) {
+      rewriter.eraseOp(prefetchOp);
+      return success();
+    }
+
+    int64_t elemBytes = std::max(elemTy.getIntOrFloatBitWidth() / 8, 1u);
+    int64_t lineElems = std::max(cacheLineSize / elemBytes, int64_t(1));
+    int64_t numLines = (shape.back() + lineElems - 1) / lineElems;
+    auto rowShape = shape.drop_back();
+    int64_t numRows = ShapedType::getNumElements(rowShape);
+    auto rowStrides = computeStrides(rowShape);
+
+    auto prefetch = [&](Value memRef, ArrayRef<Value> indices) {
+      rewriter.create<memref::PrefetchOp>(loc, memRef, indices,
+                                          /*isWrite=*/false,
+                                          prefetchOp.getLocality(),
+                                          /*isDataCache=*/true);
+    };
+    auto addIndex = [&](Value idx, int64_t offset) -> Value {
+      if (offset == 0)
+        return idx;
+      Value offsetVal = rewriter.create<arith::ConstantIndexOp>(loc, offset);
+      return rewriter.create<arith::AddIOp>(loc, idx, offsetVal);
+    };
+
+    if (isBlockPtr) {
+      auto memRef = extractMemRef(loc, ptr, rewriter);
+      auto indices = rewriter.create<ExtractIndicesOp>(loc, ptr).getResults();
+      for (int64_t row = 0; row < numRows; ++row) {
+        auto rowIndices = delinearize(row, rowStrides);
+        SmallVector<Value> lineIndices;
+        for (auto [idx, offset] : llvm::zip(indices, rowIndices))
+          lineIndices.push_back(addIndex(idx, offset));
+        lineIndices.push_back(indices.back());
+        for (int64_t line = 0; line < numLines; ++line) {
+          lineIndices.back() = addIndex(indices.back(), line * lineElems);
+          prefetch(memRef, lineIndices);
+        }
+      }
+    } else {
+      Type memRefTy = MemRefType::get(shape.back(), elemTy);
+      for (int64_t row = 0; row < numRows; ++row) {
+        auto indices = delinearize(row, rowStrides);
+        indices.push_back(0);
+        Value rowPtr = extractScalarPointer(loc, ptr, indices, rewriter);
+        Value memRef =
+            rewriter.create<triton::cpu::PtrToMemRefOp>(loc, memRefTy, rowPtr);
+        for (int64_t line = 0; line < numLines; ++line) {
+          Value idx =
+              rewriter.create<arith::ConstantIndexOp>(loc, line * lineElems);
+          prefetch(memRef, idx);
+        }
+      }
+    }
+
+    rewriter.eraseOp(prefetchOp);
+    return success();
+  }
+
+  bool isContiguousRows(Value ptr, ArrayRef<int64_t> shape) const {
+    auto axisInfo = axisAnalysis.getAxisInfo(ptr);
+    return axisInfo && shape.back() > 1 &&
+           axisInfo->getContiguity().back() == shape.back();
+  }
+};
+
+// Build a block pointer to the block of a tensor descriptor accessed by op and
+// return the memref covering the whole tensor with indices of the block in
+// it. Only descriptors created by tt.make_tensor_descriptor in the same
+// function are supported.
+template <typename OpT>
+FailureOr<std::pair<Value, SmallVector<Value>>>
+getDescriptorBlockAccess(OpT op, ConversionPatternRewriter &rewriter) {
+  auto loc = op.getLoc();
+  auto makeDescOp = op.getDesc().template getDefiningOp<MakeTensorDescOp>();
+  if (!makeDescOp)
+    return rewriter.notifyMatchFailure(
+        op, "descriptor isn't created by tt.make_tensor_descriptor");
+
+  auto blockTy = makeDescOp.getType().getBlockType();
+  int64_t rank = blockTy.getRank();
+  SmallVector<Value> shape;
+  SmallVector<int64_t> memRefShape;
+  for (Value dim : makeDescOp.getShape()) {
+    shape.push_back(
+        rewriter.create<arith::ExtSIOp>(loc, rewriter.getI64Type(), dim));
+    memRefShape.push_back(
+        getConstantIntValue(dim).value_or(ShapedType::kDynamic));
+  }
+  SmallVector<int64_t> memRefStrides;
+  for (Value stride : makeDescOp.getStrides())
+    memRefStrides.push_back(
+        getConstantIntValue(stride).value_or(ShapedType::kDynamic));
+  SmallVector<int32_t> tensorShape(blockTy.getShape().begin(),
+                                   blockTy.getShape().end());
+  SmallVector<int32_t> order(llvm::reverse(llvm::seq<int32_t>(0, rank)));
+
+  Value blockPtr = rewriter.create<MakeTensorPtrOp>(
+      loc, makeDescOp.getBase(), shape, makeDescOp.getStrides(),
+      op.getIndices(), tensorShape, order);
+  auto layout =
+      StridedLayoutAttr::get(rewriter.getContext(), 0, memRefStrides);
+  auto memRefTy =
+      MemRefType::get(memRefShape, blockTy.getElementType(), layout);
+  Value memRef = rewriter.create<ExtractMemRefOp>(loc, memRefTy, blockPtr);
+  SmallVector<Value> indices(
+      rewriter.create<ExtractIndicesOp>(loc, blockPtr).getResults());
+  return std::make_pair(memRef, indices);
+}
+
+// Out-of-bounds parts of descriptor blocks are handled by transfer ops, so
+// no element masks are built and in-bounds blocks use plain vector accesses.
+struct DescriptorLoadOpConversion
+    : public OpConversionPattern<triton::DescriptorLoadOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult
+  matchAndRewrite(triton::DescriptorLoadOp loadOp, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto access = getDescriptorBlockAccess(loadOp, rewriter);
+    if (failed(access))
+      return failure();
+    auto [memRef, indices] = *access;
+
+    auto loc = loadOp.getLoc();
+    auto resTy =
+        cast<VectorType>(getTypeConverter()->convertType(loadOp.getType()));
+    Value padding = rewriter.create<arith::ConstantOp>(
+        loc, rewriter.getZeroAttr(resTy.getElementType()));
+    SmallVector<bool, 4> inBounds(resTy.getRank(), false);
+    rewriter.replaceOpWithNewOp<vector::TransferReadOp>(
+        loadOp, resTy, memRef, indices, padding, inBounds);
+    return success();
+  }
+};
+
+struct DescriptorStoreOpConversion
+    : public OpConversionPattern<triton::DescriptorStoreOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult
+  matchAndRewrite(triton::DescriptorStoreOp storeOp, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto access = getDescriptorBlockAccess(storeOp, rewriter);
+    if (failed(access))
+      return failure();
+    auto [memRef, indices] = *access;
+
+    Value value = rewriter.getRemappedValue(storeOp.getSrc());
+    auto vecTy = cast<VectorType>(value.getType());
+    SmallVector<bool, 4> inBounds(vecTy.getRank(), false);
+    rewriter.replaceOpWithNewOp<vector::TransferWriteOp>(storeOp, value, memRef,
+                                                         indices, inBounds);
+    return success();
+  }
+};
+
 class MemoryOpConversionTarget : public ConversionTarget {
 public:
   explicit MemoryOpConversionTarget(MLIRContext &ctx) : ConversionTarget(ctx) {
@@ -592,7 +1375,9 @@ public:
     addLegalDialect<TritonCPUDialect>();
     addLegalOp<mlir::UnrealizedConversionCastOp>();
 
-    addIllegalOp<mlir::triton::cpu::StoreOp, mlir::triton::cpu::LoadOp>();
+    addIllegalOp<mlir::triton::cpu::StoreOp, mlir::triton::cpu::LoadOp,
+                 mlir::triton::cpu::PrefetchOp>();
+    addIllegalOp<triton::DescriptorLoadOp, triton::DescriptorStoreOp>();
 
     // Allow only scalar loads and stores.
     addDynamicallyLegalOp<triton::LoadOp>([](triton::LoadOp loadOp) {
@@ -612,22 +1397,64 @@ struct ConvertMemoryOps
     this->useGatherScatter = useGatherScatter;
   }
 
+  ConvertMemoryOps(bool useGatherScatter, unsigned vectorBytes,
+                   bool nativeGather, bool nativeScatter,
+                   bool nativeMaskedStore) {
+    this->useGatherScatter = useGatherScatter;
+    this->vectorBytes = vectorBytes;
+    this->nativeGather = nativeGather;
+    this->nativeScatter = nativeScatter;
+    this->nativeMaskedStore = nativeMaskedStore;
+  }
+
   void runOnOperation() override {
     MLIRContext *context = &getContext();
     ModuleOp mod = getOperation();
 
-    ModuleAxisInfoAnalysis axisInfoAnalysis(mod);
-    ModuleTensorPtrShapeInfoAnalysis shapeInfoAnalysis(mod);
+    // Reuse the analyses of previous passes that left the IR unchanged, e.g.
+    // ScalarizeUsingForOps when it has nothing to scalarize.
+    auto &axisInfoAnalysis = getAnalysis<ModuleAxisInfoAnalysis>();
+    auto &shapeInfoAnalysis = getAnalysis<ModuleTensorPtrShapeInfoAnalysis>();
     MemoryOpConversionTarget convTarget(*context);
     TritonToTritonCPUTypeConverter pointerConverter;
+    MemoryAccessCostModel costModel{vectorBytes, nativeGather, nativeScatter,
+                                    nativeMaskedStore};
     RewritePatternSet patterns(context);
     patterns.add<LoadOpConversion, StoreOpConversion, CpuStoreOpConversion,
-                 CpuLoadOpConversion>(axisInfoAnalysis, shapeInfoAnalysis,
-                                      pointerConverter, context,
-                                      useGatherScatter);
+                 CpuLoadOpConversion, PrefetchOpConversion>(
+        axisInfoAnalysis, shapeInfoAnalysis, pointerConverter, context,
+        useGatherScatter, costModel);
+    patterns.add<DescriptorLoadOpConversion, DescriptorStoreOpConversion>(
+        pointerConverter, context);
 
     if (failed(applyPartialConversion(mod, convTarget, std::move(patterns))))
       return signalPassFailure();
+
+    // Descriptors have no uses left after their accesses are lowered.
+    mod.walk([](MakeTensorDescOp makeDescOp) {
+      if (makeDescOp->use_empty())
+        makeDescOp->erase();
+    });
+
+    // Non-temporal stores are weakly ordered, so functions using them end
+    // with a full fence, which orders them on x86 unlike a release one.
+    mod.walk([&](triton::FuncOp funcOp) {
+      bool hasNontemporalStores =
+          funcOp
+              .walk([](vector::StoreOp storeOp) {
+                return storeOp.getNontemporal() ? WalkResult::interrupt()
+                                                : WalkResult::advance();
+              })
+              .wasInterrupted();
+      if (!hasNontemporalStores)
+        return;
+      funcOp.walk([&](triton::ReturnOp returnOp) {
+        OpBuilder builder(returnOp);
+        builder.create<LLVM::FenceOp>(returnOp.getLoc(), TypeRange{},
+                                      LLVM::AtomicOrdering::seq_cst,
+                                      StringAttr());
+      });
+    });
   }
 };
 
@@ -646,6 +1473,15 @@ createConvertMemoryOps(bool useGatherScatter) {
   return std::make_unique<ConvertMemoryOps>(useGatherScatter);
 }
 
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertMemoryOps(bool useGatherScatter, unsigned vectorBytes,
+                       bool nativeGather, bool nativeScatter,
+                       bool nativeMaskedStore) {
+  return std::make_unique<ConvertMemoryOps>(useGatherScatter, vectorBytes,
+                                            nativeGather, nativeScatter,
+                                            nativeMaskedStore);
+}
+
 } // namespace cpu
 } // namespace triton
 } // namespace mlir
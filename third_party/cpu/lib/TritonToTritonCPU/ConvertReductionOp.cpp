@@ -62,9 +62,92 @@ struct ReduceOpConversion
                                    useMultiDimReductionOp)))
       return success();
 
+    if (succeeded(reduceByHalving(op, rewriter)))
+      return success();
+
     return ReduceScanOpConversionBase::matchAndRewrite(op, adaptor, rewriter);
   }
 
+  // Reduce along the axis by combining the two halves of the remaining
+  // elements at each step. Elements of other dimensions are reduced in
+  // parallel and the total work is linear in the input size, unlike the
+  // shuffle trees over whole vectors. This covers reductions with multiple
+  // inputs, e.g. argmin/argmax (value, index) pairs, whose steps become
+  // vector compares and blends, or Welford (mean, m2, weight) triples.
+  LogicalResult reduceByHalving(triton::ReduceOp op,
+                                ConversionPatternRewriter &rewriter) const {
+    auto loc = op.getLoc();
+    Region &combineOp = op.getRegion();
+    SmallVector<Value> res;
+    if (failed(rewriter.getRemappedValues(op.getOperands(), res)))
+      return failure();
+
+    int64_t axis = op.getAxis();
+    foldInputTransposes(res, axis);
+    auto vecTy = cast<VectorType>(res[0].getType());
+    SmallVector<int64_t> shape(vecTy.getShape());
+    if (!llvm::isPowerOf2_64(shape[axis]))
+      return failure();
+
+    SmallVector<int64_t> strides(axis + 1, 1);
+    while (shape[axis] > 1) {
+      shape[axis] /= 2;
+      SmallVector<int64_t> sizes(shape.begin(), shape.begin() + axis + 1);
+      SmallVector<int64_t> loOffsets(axis + 1, 0);
+      SmallVector<int64_t> hiOffsets = loOffsets;
+      hiOffsets[axis] = shape[axis];
+      SmallVector<Value> lo, hi;
+      for (Value val : res) {
+        lo.push_back(rewriter.create<vector::ExtractStridedSliceOp>(
+            loc, val, loOffsets, sizes, strides));
+        hi.push_back(rewriter.create<vector::ExtractStridedSliceOp>(
+            loc, val, hiOffsets, sizes, strides));
+      }
+      res = accumulate(hi, lo, combineOp, rewriter);
+    }
+
+    // Drop the reduced dimension.
+    for (size_t i = 0; i < res.size(); ++i) {
+      Type resTy = getTypeConverter()->convertType(op.getType(i));
+      if (isa<VectorType>(resTy))
+        res[i] = rewriter.create<vector::ShapeCastOp>(loc, resTy, res[i]);
+      else
+        res[i] = rewriter.create<vector::ExtractOp>(
+            loc, res[i], SmallVector<int64_t>(shape.size(), 0));
+    }
+    rewriter.replaceOp(op, res);
+    return success();
+  }
+
+  // Reduce the sources of transposed inputs along the dimension the axis is
+  // transposed from, when the transposes keep the order of other dimensions,
+  // so the result is the same. The reduction is then chosen by the layout of
+  // the source, e.g. the row sums of a transposed tile become vertical adds
+  // of the rows of the tile, and the transpose isn't needed.
+  void foldInputTransposes(SmallVector<Value> &inputs, int64_t &axis) const {
+    ArrayRef<int64_t> perm;
+    for (Value val : inputs) {
+      auto transposeOp = val.getDefiningOp<vector::TransposeOp>();
+      if (!transposeOp ||
+          (!perm.empty() && transposeOp.getPermutation() != perm))
+        return;
+      perm = transposeOp.getPermutation();
+    }
+
+    int64_t lastDim = -1;
+    for (auto [dim, srcDim] : llvm::enumerate(perm)) {
+      if (static_cast<int64_t>(dim) == axis)
+        continue;
+      if (srcDim < lastDim)
+        return;
+      lastDim = srcDim;
+    }
+
+    for (Value &val : inputs)
+      val = val.getDefiningOp<vector::TransposeOp>().getVector();
+    axis = perm[axis];
+  }
+
   SmallVector<Value>
   lower1DInput(ValueRange inputs, ReduceOp op,
                ConversionPatternRewriter &rewriter) const override {
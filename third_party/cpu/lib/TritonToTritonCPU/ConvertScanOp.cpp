@@ -43,9 +43,81 @@ struct ScanOpConversion
     : public ReduceScanOpConversionBase<triton::ScanOp, triton::ScanReturnOp> {
   using ReduceScanOpConversionBase::ReduceScanOpConversionBase;
 
+  // Vectors longer than a SIMD register are scanned in register-sized
+  // chunks, which are then combined with the carry of preceding chunks.
+  // This keeps the number of combines linear in the vector size instead of
+  // applying log(n) shift steps to the whole vector.
+  static constexpr int64_t chunkBits = 512;
+
   SmallVector<Value>
   lower1DInput(ValueRange inputs, ScanOp op,
                ConversionPatternRewriter &rewriter) const override {
+    int64_t vecSize = cast<VectorType>(inputs[0].getType()).getShape()[0];
+    int64_t chunkSize = getChunkSize(inputs);
+    if (vecSize <= chunkSize || vecSize % chunkSize)
+      return scanVector(inputs, op, rewriter);
+    return scanChunks(inputs, chunkSize, op, rewriter);
+  }
+
+  int64_t getChunkSize(ValueRange inputs) const {
+    int64_t chunkSize = chunkBits;
+    for (Value val : inputs) {
+      Type elemTy = cast<VectorType>(val.getType()).getElementType();
+      chunkSize = std::min(
+          chunkSize,
+          chunkBits / std::max<int64_t>(elemTy.getIntOrFloatBitWidth(), 8));
+    }
+    return chunkSize;
+  }
+
+  SmallVector<Value> scanChunks(ValueRange inputs, int64_t chunkSize,
+                                ScanOp op,
+                                ConversionPatternRewriter &rewriter) const {
+    auto loc = op.getLoc();
+    Region &combineOp = op.getRegion();
+    bool reverse = op.getReverse();
+    int64_t vecSize = cast<VectorType>(inputs[0].getType()).getShape()[0];
+    int64_t numChunks = vecSize / chunkSize;
+
+    SmallVector<Value> res;
+    for (Value val : inputs)
+      res.push_back(rewriter.create<arith::ConstantOp>(
+          loc, rewriter.getZeroAttr(val.getType())));
+    SmallVector<Value> carry;
+    for (int64_t i = 0; i < numChunks; ++i) {
+      int64_t offset = (reverse ? numChunks - 1 - i : i) * chunkSize;
+      SmallVector<Value> chunks;
+      for (Value val : inputs)
+        chunks.push_back(rewriter.create<vector::ExtractStridedSliceOp>(
+            loc, val, ArrayRef<int64_t>{offset}, ArrayRef<int64_t>{chunkSize},
+            ArrayRef<int64_t>{1}));
+      chunks = scanVector(chunks, op, rewriter);
+      if (!carry.empty()) {
+        SmallVector<Value> carrySplats;
+        for (auto [val, chunk] : llvm::zip(carry, chunks))
+          carrySplats.push_back(
+              rewriter.create<vector::SplatOp>(loc, chunk.getType(), val));
+        chunks = accumulate(chunks, carrySplats, combineOp, rewriter);
+      }
+
+      // The last element in the scan order carries into the next chunk.
+      int64_t lastIdx = reverse ? 0 : chunkSize - 1;
+      carry.clear();
+      for (auto [idx, chunk] : llvm::enumerate(chunks)) {
+        carry.push_back(
+            rewriter.create<vector::ExtractOp>(loc, chunk, lastIdx));
+        res[idx] = rewriter.create<vector::InsertStridedSliceOp>(
+            loc, chunk, res[idx], ArrayRef<int64_t>{offset},
+            ArrayRef<int64_t>{1});
+      }
+    }
+    return res;
+  }
+
+  // Scan a vector with log(n) steps combining elements with elements
+  // shifted by a growing stride.
+  SmallVector<Value> scanVector(ValueRange inputs, ScanOp op,
+                                ConversionPatternRewriter &rewriter) const {
     auto loc = op.getLoc();
     Region &combineOp = op.getRegion();
     bool reverse = op.getReverse();
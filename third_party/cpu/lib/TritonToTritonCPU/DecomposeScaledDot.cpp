@@ -0,0 +1,236 @@
+#include "cpu/include/TritonToTritonCPU/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+
+namespace mlir {
+namespace triton {
+#define GEN_PASS_DEF_DECOMPOSESCALEDDOT
+#include "cpu/include/TritonToTritonCPU/Passes.h.inc"
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+
+namespace {
+
+// Order swapping two innermost dimensions.
+SmallVector<int32_t> getTransposeOrder(int64_t rank) {
+  auto order = llvm::to_vector(llvm::seq<int32_t>(rank));
+  std::swap(order[rank - 2], order[rank - 1]);
+  return order;
+}
+
+Value intSplat(Location loc, RankedTensorType ty, int64_t val,
+               PatternRewriter &rewriter) {
+  auto elemTy = cast<IntegerType>(ty.getElementType());
+  return rewriter.create<arith::ConstantOp>(
+      loc, ty, DenseElementsAttr::get(ty, APInt(elemTy.getWidth(), val)));
+}
+
+struct DecomposeScaledDotOp : public OpRewritePattern<triton::DotScaledOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(triton::DotScaledOp op,
+                                PatternRewriter &rewriter) const override {
+    FloatType computeTy = getComputeType(op, rewriter);
+    Value a = scaleArg(op, 0, computeTy, rewriter);
+    Value b = scaleArg(op, 1, computeTy, rewriter);
+    rewriter.replaceOpWithNewOp<triton::DotOp>(op, a, b, op.getC());
+    return success();
+  }
+
+private:
+  FloatType getComputeType(triton::DotScaledOp op,
+                           PatternRewriter &rewriter) const {
+    if (op.getAElemType() == ScaleDotElemType::FP16 ||
+        op.getBElemType() == ScaleDotElemType::FP16)
+      return rewriter.getF16Type();
+    return rewriter.getBF16Type();
+  }
+
+  // Decode e2m1 values held in the low 4 bits of i16 elements into the
+  // compute type. Zero and the only subnormal value (0.5) are selected
+  // separately, normal values just get their exponent rebiased.
+  Value decodeFp4(Location loc, Value nibbles, FloatType computeTy,
+                  PatternRewriter &rewriter) const {
+    auto ty = cast<RankedTensorType>(nibbles.getType());
+    bool isBf16 = computeTy.isBF16();
+    int64_t mantBits = isBf16 ? 7 : 10;
+    int64_t bias = isBf16 ? 127 : 15;
+    int64_t half = isBf16 ? 0x3F00 : 0x3800;
+    auto cst = [&](int64_t val) { return intSplat(loc, ty, val, rewriter); };
+
+    Value sign = rewriter.create<arith::ShLIOp>(
+        loc, rewriter.create<arith::AndIOp>(loc, nibbles, cst(0x8)), cst(12));
+    Value exp = rewriter.create<arith::AndIOp>(
+        loc, rewriter.create<arith::ShRUIOp>(loc, nibbles, cst(1)), cst(0x3));
+    Value mant = rewriter.create<arith::AndIOp>(loc, nibbles, cst(0x1));
+    Value normal = rewriter.create<arith::OrIOp>(
+        loc,
+        rewriter.create<arith::ShLIOp>(
+            loc, rewriter.create<arith::AddIOp>(loc, exp, cst(bias - 1)),
+            cst(mantBits)),
+        rewriter.create<arith::ShLIOp>(loc, mant, cst(mantBits - 1)));
+    Value subnormal = rewriter.create<arith::MulIOp>(loc, mant, cst(half));
+    Value isSubnormal = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::eq, exp, cst(0));
+    Value bits = rewriter.create<arith::OrIOp>(
+        loc, rewriter.create<arith::SelectOp>(loc, isSubnormal, subnormal,
+                                              normal),
+        sign);
+    return rewriter.create<triton::BitcastOp>(loc, ty.clone(computeTy), bits);
+  }
+
+  // Unpack e2m1 pairs stored in i8 elements along kDim, the first element
+  // in the low bits.
+  Value upcastFp4(Location loc, Value packed, int64_t kDim,
+                  FloatType computeTy, PatternRewriter &rewriter) const {
+    auto ty = cast<RankedTensorType>(packed.getType());
+    int64_t rank = ty.getRank();
+    auto i16Ty = ty.clone(rewriter.getI16Type());
+    Value ext = rewriter.create<arith::ExtUIOp>(loc, i16Ty, packed);
+    Value lo = rewriter.create<arith::AndIOp>(
+        loc, ext, intSplat(loc, i16Ty, 0xF, rewriter));
+    Value hi = rewriter.create<arith::ShRUIOp>(
+        loc, ext, intSplat(loc, i16Ty, 4, rewriter));
+    lo = decodeFp4(loc, lo, computeTy, rewriter);
+    hi = decodeFp4(loc, hi, computeTy, rewriter);
+
+    // Join puts pairs into a new innermost dimension, move it right after
+    // kDim before merging the two.
+    Value res = rewriter.create<triton::JoinOp>(loc, lo, hi);
+    if (kDim != rank - 1)
+      res = rewriter.create<triton::TransOp>(loc, res,
+                                             getTransposeOrder(rank + 1));
+    SmallVector<int64_t> shape(ty.getShape());
+    shape[kDim] *= 2;
+    return rewriter.create<triton::ReshapeOp>(
+        loc, shape, cast<TypedValue<RankedTensorType>>(res));
+  }
+
+  // Convert fp8 values to the compute type. A bf16 operand of an fp16 dot
+  // is rounded through fp32, as CPU lowering of FpToFpOp only changes the
+  // width.
+  Value upcastFp(Location loc, Value val, FloatType computeTy,
+                 PatternRewriter &rewriter) const {
+    auto ty = cast<RankedTensorType>(val.getType());
+    if (ty.getElementTypeBitWidth() < computeTy.getWidth())
+      return rewriter.create<triton::FpToFpOp>(loc, ty.clone(computeTy), val);
+    Value ext = rewriter.create<triton::FpToFpOp>(
+        loc, ty.clone(rewriter.getF32Type()), val);
+    return rewriter.create<triton::FpToFpOp>(
+        loc, ty.clone(computeTy), ext,
+        RoundingModeAttr::get(rewriter.getContext(), RoundingMode::RTNE));
+  }
+
+  // Convert e8m0 scales to the compute type. For fp16, go through fp32 as
+  // the scale exponent range doesn't fit fp16.
+  Value upcastScale(Location loc, Value scale, FloatType computeTy,
+                    PatternRewriter &rewriter) const {
+    auto ty = cast<RankedTensorType>(scale.getType());
+    FloatType fpTy = computeTy.isBF16() ? computeTy : rewriter.getF32Type();
+    unsigned width = fpTy.getWidth();
+    auto intTy = ty.clone(rewriter.getIntegerType(width));
+    Value res = rewriter.create<arith::ExtUIOp>(loc, intTy, scale);
+    res = rewriter.create<arith::ShLIOp>(
+        loc, res,
+        intSplat(loc, intTy, fpTy.getFPMantissaWidth() - 1, rewriter));
+    res = rewriter.create<triton::BitcastOp>(loc, ty.clone(fpTy), res);
+    if (fpTy != computeTy)
+      res = rewriter.create<arith::TruncFOp>(loc, ty.clone(computeTy), res);
+    return res;
+  }
+
+  // Repeat each scale, or scale mask, 32 times along kDim.
+  Value broadcastScale(Location loc, Value scale, int64_t kDim,
+                       PatternRewriter &rewriter) const {
+    auto ty = cast<RankedTensorType>(scale.getType());
+    SmallVector<int64_t> shape(ty.getShape());
+    shape.insert(shape.begin() + kDim + 1, 32);
+    Value res = rewriter.create<triton::ExpandDimsOp>(loc, scale, kDim + 1);
+    res = rewriter.create<triton::BroadcastOp>(loc, ty.clone(shape), res);
+    shape.erase(shape.begin() + kDim + 1);
+    shape[kDim] *= 32;
+    return rewriter.create<triton::ReshapeOp>(
+        loc, shape, cast<TypedValue<RankedTensorType>>(res));
+  }
+
+  Value scaleArg(triton::DotScaledOp op, int opIdx, FloatType computeTy,
+                 PatternRewriter &rewriter) const {
+    Location loc = op.getLoc();
+    Value val = opIdx == 0 ? op.getA() : op.getB();
+    Value scale = opIdx == 0 ? op.getAScale() : op.getBScale();
+    ScaleDotElemType elemTy =
+        opIdx == 0 ? op.getAElemType() : op.getBElemType();
+    auto valTy = cast<RankedTensorType>(val.getType());
+    int64_t rank = valTy.getRank();
+    int64_t kDim = opIdx == 0 ? rank - 1 : rank - 2;
+
+    if (elemTy == ScaleDotElemType::E2M1)
+      val = upcastFp4(loc, val, kDim, computeTy, rewriter);
+    else if (valTy.getElementType() != computeTy)
+      val = upcastFp(loc, val, computeTy, rewriter);
+    if (!scale)
+      return val;
+
+    // Scales of both operands come with K as the innermost dimension.
+    if (opIdx == 1)
+      scale = rewriter.create<triton::TransOp>(loc, scale,
+                                               getTransposeOrder(rank));
+    Value fpScale = broadcastScale(
+        loc, upcastScale(loc, scale, computeTy, rewriter), kDim, rewriter);
+    Value res = rewriter.create<arith::MulFOp>(loc, val, fpScale);
+    if (op.getFastMath())
+      return res;
+
+    // Scale 0xFF encodes NaN.
+    auto scaleTy = cast<RankedTensorType>(scale.getType());
+    Value isNan = rewriter.create<arith::CmpIOp>(
+        loc, arith::CmpIPredicate::eq, scale,
+        intSplat(loc, scaleTy, 0xFF, rewriter));
+    isNan = broadcastScale(loc, isNan, kDim, rewriter);
+    auto resTy = cast<RankedTensorType>(res.getType());
+    Value nan = rewriter.create<arith::ConstantOp>(
+        loc, resTy,
+        DenseElementsAttr::get(resTy,
+                               APFloat::getNaN(computeTy.getFloatSemantics())));
+    return rewriter.create<arith::SelectOp>(loc, isNan, nan, res);
+  }
+};
+
+struct DecomposeScaledDot
+    : public triton::impl::DecomposeScaledDotBase<DecomposeScaledDot> {
+  using DecomposeScaledDotBase::DecomposeScaledDotBase;
+
+  DecomposeScaledDot() : DecomposeScaledDotBase() {}
+
+  void runOnOperation() override {
+    MLIRContext *context = &getContext();
+    ModuleOp mod = getOperation();
+
+    RewritePatternSet patterns(context);
+    patterns.add<DecomposeScaledDotOp>(context);
+
+    if (failed(applyPatternsGreedily(mod, std::move(patterns))))
+      return signalPassFailure();
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createDecomposeScaledDot() {
+  return std::make_unique<DecomposeScaledDot>();
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -0,0 +1,238 @@
+#include "cpu/include/TritonToTritonCPU/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Conversion/TritonGPUToLLVM/Utility.h"
+#include "triton/Dialect/Triton/IR/Dialect.h"
+#include "triton/Dialect/TritonCPU/IR/Dialect.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "triton-cpu-defer-scalar-atomics"
+#define DBGS() (llvm::dbgs() << "[" DEBUG_TYPE "]: ")
+#define LDBG(X) LLVM_DEBUG(DBGS() << X << "\n")
+
+namespace mlir {
+namespace triton {
+#define GEN_PASS_DEF_DEFERSCALARATOMICS
+#include "cpu/include/TritonToTritonCPU/Passes.h.inc"
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+
+namespace {
+
+// Slots are padded to cache lines, so threads don't share them. The first
+// element of a slot holds the partial result and the second 8 bytes hold
+// the target pointer, which the launcher combines the slot into.
+constexpr int64_t slotBytes = 64;
+
+// Name of the element type in kernel signatures, or an empty string for
+// types partials are not supported for.
+StringRef getTypeName(Type ty) {
+  if (ty.isInteger(32))
+    return "i32";
+  if (ty.isInteger(64))
+    return "i64";
+  if (ty.isF32())
+    return "fp32";
+  if (ty.isF64())
+    return "fp64";
+  return "";
+}
+
+bool isDeferrable(triton::AtomicRMWOp op, Value ptr) {
+  if (op.getPtr() != ptr || !op.getResult().use_empty())
+    return false;
+  bool isFloat = isa<FloatType>(getElementTypeOrSelf(op.getVal().getType()));
+  return op.getAtomicRmwOp() ==
+         (isFloat ? triton::RMWOp::FADD : triton::RMWOp::ADD);
+}
+
+// Check if all uses of a scalar pointer argument are additions of atomics
+// with unused results, directly or through splats. The target is then only
+// read after the launch, so updates can be deferred.
+bool isDeferrableTarget(BlockArgument arg) {
+  auto ptrTy = dyn_cast<triton::PointerType>(arg.getType());
+  if (!ptrTy || getTypeName(ptrTy.getPointeeType()).empty() || arg.use_empty())
+    return false;
+  for (Operation *user : arg.getUsers()) {
+    if (auto atomicOp = dyn_cast<triton::AtomicRMWOp>(user)) {
+      if (!isDeferrable(atomicOp, arg))
+        return false;
+    } else if (auto splatOp = dyn_cast<triton::SplatOp>(user)) {
+      for (Operation *splatUser : splatOp->getUsers()) {
+        auto atomicOp = dyn_cast<triton::AtomicRMWOp>(splatUser);
+        if (!atomicOp || !isDeferrable(atomicOp, splatOp))
+          return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+Value intCst(Location loc, Type ty, int64_t val, OpBuilder &b) {
+  return b.create<arith::ConstantOp>(loc, ty, b.getIntegerAttr(ty, val));
+}
+
+// Check if the kernel has float atomic adds that are not deferred to the
+// targets. Their sums depend on the order programs run in.
+bool hasUnorderedAtomics(triton::FuncOp funcOp,
+                         ArrayRef<BlockArgument> targets) {
+  auto isTarget = [&](Value ptr) {
+    if (auto splatOp = ptr.getDefiningOp<triton::SplatOp>())
+      ptr = splatOp.getSrc();
+    return llvm::is_contained(targets, ptr);
+  };
+  auto result = funcOp.walk([&](triton::AtomicRMWOp op) {
+    if (op.getAtomicRmwOp() == triton::RMWOp::FADD && !isTarget(op.getPtr()))
+      return WalkResult::interrupt();
+    return WalkResult::advance();
+  });
+  return result.wasInterrupted();
+}
+
+// Linear id of the program, X first, then Y, then Z.
+Value getLinearProgramId(Location loc, OpBuilder &b) {
+  Value x = b.create<triton::GetProgramIdOp>(loc, 0);
+  Value y = b.create<triton::GetProgramIdOp>(loc, 1);
+  Value z = b.create<triton::GetProgramIdOp>(loc, 2);
+  Value gridX = b.create<triton::GetNumProgramsOp>(loc, 0);
+  Value gridY = b.create<triton::GetNumProgramsOp>(loc, 1);
+  Value yz = b.create<arith::AddIOp>(
+      loc, y, b.create<arith::MulIOp>(loc, gridY, z));
+  return b.create<arith::AddIOp>(loc, x,
+                                 b.create<arith::MulIOp>(loc, gridX, yz));
+}
+
+// Redirect atomics of the targets to slots of the executing thread. The
+// kernel gets the number of slots and a slot buffer per target as trailing
+// arguments. Atomics stay atomic, as threads can share a slot when there
+// are more threads than slots, but become relaxed because other programs
+// can't observe the target before the launch ends anyway. With perProgram,
+// each program gets its own slot instead, so partials summed in slot order
+// don't depend on the number of threads or the schedule.
+void deferAtomics(triton::FuncOp funcOp, ArrayRef<BlockArgument> targets,
+                  bool perProgram) {
+  Location loc = funcOp.getLoc();
+  OpBuilder b(funcOp.getContext());
+  Type i32Ty = b.getI32Type();
+  Type i64Ty = b.getI64Type();
+
+  unsigned numArgs = funcOp.getNumArguments();
+  (void)funcOp.insertArgument(numArgs, i32Ty, DictionaryAttr(), loc);
+  for (auto [idx, target] : llvm::enumerate(targets))
+    (void)funcOp.insertArgument(numArgs + 1 + idx, target.getType(),
+                                DictionaryAttr(), loc);
+  Value numSlots = funcOp.getArgument(numArgs);
+
+  b.setInsertionPointToStart(&funcOp.getBody().front());
+  Value slot = perProgram
+                   ? getLinearProgramId(loc, b)
+                   : b.create<cpu::ThreadSlotOp>(loc, i32Ty, numSlots);
+  auto i64PtrTy = triton::PointerType::get(i64Ty, 1);
+  for (auto [idx, target] : llvm::enumerate(targets)) {
+    auto ptrTy = cast<triton::PointerType>(target.getType());
+    int64_t elemBytes = ptrTy.getPointeeType().getIntOrFloatBitWidth() / 8;
+    Value slots = funcOp.getArgument(numArgs + 1 + idx);
+    Value slotPtr = b.create<triton::AddPtrOp>(
+        loc, ptrTy, slots,
+        b.create<arith::MulIOp>(loc, slot,
+                                intCst(loc, i32Ty, slotBytes / elemBytes, b)));
+
+    // Record the target for the launcher.
+    Value targetSlot = b.create<triton::AddPtrOp>(
+        loc, i64PtrTy,
+        b.create<triton::BitcastOp>(loc, i64PtrTy, slotPtr),
+        intCst(loc, i32Ty, 1, b));
+    b.create<triton::StoreOp>(
+        loc, targetSlot, b.create<triton::PtrToIntOp>(loc, i64Ty, target),
+        triton::CacheModifier::NONE, triton::EvictionPolicy::NORMAL);
+
+    for (OpOperand &use : llvm::make_early_inc_range(target.getUses())) {
+      Operation *user = use.getOwner();
+      if (isa<triton::PtrToIntOp>(user))
+        continue;
+      use.set(slotPtr);
+      SmallVector<Operation *> atomicOps;
+      if (isa<triton::SplatOp>(user))
+        atomicOps.append(user->user_begin(), user->user_end());
+      else
+        atomicOps.push_back(user);
+      for (Operation *op : atomicOps)
+        cast<triton::AtomicRMWOp>(op).setSem(triton::MemSemantic::RELAXED);
+    }
+  }
+}
+
+struct DeferScalarAtomics
+    : public triton::impl::DeferScalarAtomicsBase<DeferScalarAtomics> {
+  using DeferScalarAtomicsBase::DeferScalarAtomicsBase;
+
+  DeferScalarAtomics() : DeferScalarAtomicsBase() {}
+
+  DeferScalarAtomics(bool perProgram) : DeferScalarAtomicsBase() {
+    this->perProgram = perProgram;
+  }
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+
+    SmallVector<StringRef> typeNames;
+    bool unordered = false;
+    mod.walk([&](triton::FuncOp funcOp) {
+      if (!LLVM::isKernel(funcOp) || funcOp.isExternal())
+        return;
+      SmallVector<BlockArgument> targets;
+      for (BlockArgument arg : funcOp.getArguments())
+        if (isDeferrableTarget(arg))
+          targets.push_back(arg);
+      if (perProgram && hasUnorderedAtomics(funcOp, targets))
+        unordered = true;
+      if (targets.empty())
+        return;
+      LDBG("Deferring atomics of " << targets.size() << " targets of "
+                                   << funcOp.getName());
+      for (BlockArgument target : targets)
+        typeNames.push_back(getTypeName(
+            cast<triton::PointerType>(target.getType()).getPointeeType()));
+      deferAtomics(funcOp, targets, perProgram);
+    });
+
+    // The launcher allocates a slot buffer per listed element type and
+    // passes the slot arguments to kernels of modules with this attribute.
+    if (!typeNames.empty())
+      mod->setAttr("triton_cpu.thread_partials",
+                   StringAttr::get(&getContext(), llvm::join(typeNames, ",")));
+    // The launcher runs kernels of modules with this attribute on a single
+    // thread to keep their results reproducible.
+    if (unordered)
+      mod->setAttr("triton_cpu.unordered_atomics",
+                   BoolAttr::get(&getContext(), true));
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createDeferScalarAtomics() {
+  return std::make_unique<DeferScalarAtomics>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>>
+createDeferScalarAtomics(bool perProgram) {
+  return std::make_unique<DeferScalarAtomics>(perProgram);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -0,0 +1,180 @@
+#include "cpu/include/TritonToTritonCPU/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "triton-cpu-forward-stores"
+#define DBGS() (llvm::dbgs() << "[" DEBUG_TYPE "]: ")
+#define LDBG(X) LLVM_DEBUG(DBGS() << X << "\n")
+
+namespace mlir {
+namespace triton {
+#define GEN_PASS_DEF_FORWARDSTORES
+#include "cpu/include/TritonToTritonCPU/Passes.h.inc"
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+
+namespace {
+
+// The argument a pointer is derived from, if any.
+BlockArgument getBaseArg(Value ptr) {
+  while (Operation *def = ptr.getDefiningOp()) {
+    if (isa<AddPtrOp, SplatOp, BroadcastOp, ExpandDimsOp>(def))
+      ptr = def->getOperand(0);
+    else
+      return nullptr;
+  }
+  return dyn_cast<BlockArgument>(ptr);
+}
+
+bool isReadOnly(Operation *op) {
+  auto iface = dyn_cast<MemoryEffectOpInterface>(op);
+  if (!iface || op->getNumRegions())
+    return false;
+  SmallVector<MemoryEffects::EffectInstance> effects;
+  iface.getEffects(effects);
+  return llvm::all_of(effects, [](MemoryEffects::EffectInstance &effect) {
+    return isa<MemoryEffects::Read>(effect.getEffect());
+  });
+}
+
+struct StoreEntry {
+  StoreOp op;
+  // The stored memory may have been read since the store.
+  bool read;
+};
+
+class StoreForwarder {
+public:
+  StoreForwarder(bool noalias) : noalias(noalias) {}
+
+  // Stores are tracked from one op of a block to the next. Ops with regions
+  // or unknown effects end the tracking, so only straight-line code, like
+  // bodies of inlined elementwise kernels, is optimized.
+  void run(Block &block) {
+    stores.clear();
+    for (Operation &op : llvm::make_early_inc_range(block)) {
+      if (auto loadOp = dyn_cast<LoadOp>(op))
+        visitLoad(loadOp);
+      else if (auto storeOp = dyn_cast<StoreOp>(op))
+        visitStore(storeOp);
+      else if (isReadOnly(&op))
+        for (auto &entry : stores)
+          entry.read = true;
+      else if (op.getNumRegions() || !isMemoryEffectFree(&op))
+        stores.clear();
+    }
+  }
+
+private:
+  // Without noalias, any two pointers may alias. With noalias, pointers
+  // derived from different arguments don't.
+  bool mayAlias(Value lhs, Value rhs) const {
+    if (lhs == rhs || !noalias)
+      return true;
+    BlockArgument lhsBase = getBaseArg(lhs);
+    BlockArgument rhsBase = getBaseArg(rhs);
+    return !lhsBase || !rhsBase || lhsBase == rhsBase;
+  }
+
+  static bool isSimple(StoreOp storeOp) {
+    return storeOp.getBoundaryCheck().empty();
+  }
+
+  // A load of the same elements as a preceding store, with nothing written
+  // in between, yields the stored value.
+  void visitLoad(LoadOp loadOp) {
+    Value ptr = loadOp.getPtr();
+    if (!loadOp.getBoundaryCheck().empty() || loadOp.getIsVolatile()) {
+      markRead(ptr);
+      return;
+    }
+    auto it = llvm::find_if(llvm::reverse(stores), [&](StoreEntry &entry) {
+      return entry.op.getPtr() == ptr && entry.op.getMask() == loadOp.getMask();
+    });
+    if (it == stores.rend()) {
+      markRead(ptr);
+      return;
+    }
+    LDBG("Forwarding " << it->op << " to " << loadOp);
+    Value val = it->op.getValue();
+    if (Value other = loadOp.getOther()) {
+      OpBuilder b(loadOp);
+      val = b.create<arith::SelectOp>(loadOp.getLoc(), loadOp.getMask(), val,
+                                      other);
+    }
+    loadOp.getResult().replaceAllUsesWith(val);
+    loadOp.erase();
+  }
+
+  // A store of the same elements as a preceding store, that has not been
+  // read since, overwrites all of it.
+  void visitStore(StoreOp storeOp) {
+    Value ptr = storeOp.getPtr();
+    SmallVector<StoreEntry> kept;
+    for (auto &entry : stores) {
+      if (!mayAlias(entry.op.getPtr(), ptr)) {
+        kept.push_back(entry);
+        continue;
+      }
+      if (!entry.read && isSimple(storeOp) && entry.op.getPtr() == ptr &&
+          entry.op.getMask() == storeOp.getMask()) {
+        LDBG("Removing overwritten " << entry.op);
+        entry.op.erase();
+      }
+    }
+    stores = std::move(kept);
+    if (isSimple(storeOp))
+      stores.push_back({storeOp, false});
+  }
+
+  void markRead(Value ptr) {
+    for (auto &entry : stores)
+      if (mayAlias(entry.op.getPtr(), ptr))
+        entry.read = true;
+  }
+
+  bool noalias;
+  SmallVector<StoreEntry> stores;
+};
+
+struct ForwardStores : public triton::impl::ForwardStoresBase<ForwardStores> {
+  ForwardStores() = default;
+
+  ForwardStores(bool noalias) { this->noalias = noalias; }
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+    StoreForwarder forwarder(noalias);
+    SmallVector<Block *> blocks;
+    mod.walk([&](Block *block) { blocks.push_back(block); });
+    for (Block *block : blocks)
+      forwarder.run(*block);
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createForwardStores() {
+  return std::make_unique<ForwardStores>();
+}
+
+std::unique_ptr<OperationPass<ModuleOp>> createForwardStores(bool noalias) {
+  return std::make_unique<ForwardStores>(noalias);
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
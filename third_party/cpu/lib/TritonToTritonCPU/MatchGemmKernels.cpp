@@ -0,0 +1,595 @@
+#include "cpu/include/TritonToTritonCPU/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Conversion/TritonGPUToLLVM/Utility.h"
+#include "triton/Dialect/Triton/IR/Dialect.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "triton-cpu-match-gemm-kernels"
+#define DBGS() (llvm::dbgs() << "[" DEBUG_TYPE "]: ")
+#define LDBG(X) LLVM_DEBUG(DBGS() << X << "\n")
+
+namespace mlir {
+namespace triton {
+#define GEN_PASS_DEF_MATCHGEMMKERNELS
+#include "cpu/include/TritonToTritonCPU/Passes.h.inc"
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+
+namespace {
+
+// A scalar parameter of the GEMM, which is an argument of the kernel or a
+// constant.
+struct GemmParam {
+  int64_t argIdx = -1;
+  int64_t value = 0;
+
+  bool operator==(const GemmParam &other) const {
+    return argIdx == other.argIdx && value == other.value;
+  }
+  bool operator!=(const GemmParam &other) const { return !(*this == other); }
+
+  std::string str() const {
+    return argIdx >= 0 ? "$" + std::to_string(argIdx) : std::to_string(value);
+  }
+};
+
+std::optional<GemmParam> getParam(Value val) {
+  while (auto extOp = val.getDefiningOp<arith::ExtSIOp>())
+    val = extOp.getIn();
+  if (auto arg = dyn_cast<BlockArgument>(val)) {
+    if (isa<triton::FuncOp>(arg.getOwner()->getParentOp()))
+      return GemmParam{arg.getArgNumber(), 0};
+    return std::nullopt;
+  }
+  if (auto cst = getConstantIntValue(val))
+    return GemmParam{-1, *cst};
+  return std::nullopt;
+}
+
+Value stripBroadcast(Value val) {
+  while (auto broadcastOp = val.getDefiningOp<triton::BroadcastOp>())
+    val = broadcastOp.getSrc();
+  return val;
+}
+
+// Get the parameter all elements of a tensor are equal to.
+std::optional<GemmParam> getSplatParam(Value val) {
+  val = stripBroadcast(val);
+  if (auto splatOp = val.getDefiningOp<triton::SplatOp>())
+    return getParam(splatOp.getSrc());
+  SplatElementsAttr attr;
+  if (matchPattern(val, m_Constant(&attr)) &&
+      isa<IntegerType>(attr.getElementType()))
+    return GemmParam{-1, attr.getSplatValue<APInt>().getSExtValue()};
+  return std::nullopt;
+}
+
+bool isZeroSplat(Value val) {
+  SplatElementsAttr attr;
+  if (!matchPattern(val, m_Constant(&attr)))
+    return false;
+  if (isa<FloatType>(attr.getElementType()))
+    return attr.getSplatValue<APFloat>().isZero();
+  return attr.getSplatValue<APInt>().isZero();
+}
+
+// A term of the offsets of a 2-D tile of pointers: a 1-D index vector
+// expanded along dim and scaled by a stride.
+struct OffsetTerm {
+  Value idx;
+  unsigned dim;
+  GemmParam stride;
+};
+
+std::optional<OffsetTerm> matchTerm(Value val) {
+  OffsetTerm res{Value(), 0, GemmParam{-1, 1}};
+  bool hasStride = false;
+  bool expanded = false;
+  while (true) {
+    val = stripBroadcast(val);
+    if (auto mulOp = val.getDefiningOp<arith::MulIOp>()) {
+      if (hasStride)
+        return std::nullopt;
+      if (auto stride = getSplatParam(mulOp.getRhs())) {
+        res.stride = *stride;
+        val = mulOp.getLhs();
+      } else if (auto stride = getSplatParam(mulOp.getLhs())) {
+        res.stride = *stride;
+        val = mulOp.getRhs();
+      } else {
+        return std::nullopt;
+      }
+      hasStride = true;
+    } else if (auto expandOp = val.getDefiningOp<triton::ExpandDimsOp>()) {
+      if (expanded)
+        return std::nullopt;
+      res.dim = expandOp.getAxis() == 1 ? 0 : 1;
+      val = expandOp.getSrc();
+      expanded = true;
+    } else {
+      break;
+    }
+  }
+  if (!expanded || cast<RankedTensorType>(val.getType()).getRank() != 1)
+    return std::nullopt;
+  res.idx = val;
+  return res;
+}
+
+bool collectTerms(Value offsets, SmallVectorImpl<OffsetTerm> &terms) {
+  offsets = stripBroadcast(offsets);
+  if (auto addOp = offsets.getDefiningOp<arith::AddIOp>())
+    return collectTerms(addOp.getLhs(), terms) &&
+           collectTerms(addOp.getRhs(), terms);
+  auto term = matchTerm(offsets);
+  if (!term)
+    return false;
+  terms.push_back(*term);
+  return true;
+}
+
+// A 2-D tile of pointers base + rows * rowStride + cols * colStride.
+struct TilePtr {
+  GemmParam base;
+  OffsetTerm rows;
+  OffsetTerm cols;
+};
+
+std::optional<TilePtr> matchTilePtr(Value ptr) {
+  SmallVector<OffsetTerm> terms;
+  while (true) {
+    ptr = stripBroadcast(ptr);
+    auto addPtrOp = ptr.getDefiningOp<triton::AddPtrOp>();
+    if (!addPtrOp)
+      break;
+    if (!collectTerms(addPtrOp.getOffset(), terms))
+      return std::nullopt;
+    ptr = addPtrOp.getPtr();
+  }
+  auto splatOp = ptr.getDefiningOp<triton::SplatOp>();
+  if (!splatOp || terms.size() != 2 || terms[0].dim == terms[1].dim)
+    return std::nullopt;
+  auto base = getParam(splatOp.getSrc());
+  if (!base || base->argIdx < 0)
+    return std::nullopt;
+  if (terms[0].dim == 1)
+    std::swap(terms[0], terms[1]);
+  return TilePtr{*base, terms[0], terms[1]};
+}
+
+// Index vector of a tile, start + arange(0, size), which can be wrapped
+// modulo a bound. The start is the index of the tile of the program times the
+// size, e.g. pid_m * BLOCK_M, or there is none for tiles along K.
+struct TileIndex {
+  Value start;
+  Value program;
+  int64_t size;
+  std::optional<GemmParam> bound;
+};
+
+std::optional<TileIndex> matchIndex(Value idx) {
+  TileIndex res;
+  if (auto remOp = idx.getDefiningOp<arith::RemSIOp>()) {
+    res.bound = getSplatParam(remOp.getRhs());
+    if (!res.bound)
+      return std::nullopt;
+    idx = remOp.getLhs();
+  }
+  if (auto addOp = idx.getDefiningOp<arith::AddIOp>()) {
+    for (unsigned i = 0; i < 2 && !res.start; ++i) {
+      if (auto splatOp =
+              addOp->getOperand(i).getDefiningOp<triton::SplatOp>()) {
+        res.start = splatOp.getSrc();
+        idx = addOp->getOperand(1 - i);
+      }
+    }
+    if (!res.start)
+      return std::nullopt;
+  }
+  auto rangeOp = idx.getDefiningOp<triton::MakeRangeOp>();
+  if (!rangeOp || rangeOp.getStart() != 0)
+    return std::nullopt;
+  res.size = rangeOp.getEnd();
+  if (res.start) {
+    auto mulOp = res.start.getDefiningOp<arith::MulIOp>();
+    if (!mulOp)
+      return std::nullopt;
+    if (getConstantIntValue(mulOp.getRhs()) == res.size)
+      res.program = mulOp.getLhs();
+    else if (getConstantIntValue(mulOp.getLhs()) == res.size)
+      res.program = mulOp.getRhs();
+    else
+      return std::nullopt;
+  }
+  return res;
+}
+
+// Get the parameter of cdiv(param, divisor), which is computed as
+// (param + divisor - 1) // divisor.
+std::optional<GemmParam> getCdivParam(Value val, int64_t divisor) {
+  auto divOp = val.getDefiningOp<arith::DivSIOp>();
+  if (!divOp || getConstantIntValue(divOp.getRhs()) != divisor)
+    return std::nullopt;
+  auto addOp = divOp.getLhs().getDefiningOp<arith::AddIOp>();
+  if (!addOp || getConstantIntValue(addOp.getRhs()) != divisor - 1)
+    return std::nullopt;
+  return getParam(addOp.getLhs());
+}
+
+// Check if the scalar is the number of tiles of a dimension, cdiv(size,
+// blockSize).
+bool isNumTiles(Value val, GemmParam size, int64_t blockSize) {
+  if (auto cst = getConstantIntValue(val))
+    return size.argIdx < 0 &&
+           *cst == (size.value + blockSize - 1) / blockSize;
+  return getCdivParam(val, blockSize) == size;
+}
+
+// Get the order of output tiles of programs given the indices of their rows
+// and cols tiles: "xy" or "yx" for program ids along X and Y, or "linear" for
+// pid // tiles_n and pid % tiles_n of the program id along X. The launcher
+// checks that the grid has a program per tile in this order. Return an empty
+// string for other mappings, which may not cover all of C.
+std::string getTileOrder(Value rows, Value cols, GemmParam n,
+                         int64_t blockN) {
+  auto rowPid = rows.getDefiningOp<triton::GetProgramIdOp>();
+  auto colPid = cols.getDefiningOp<triton::GetProgramIdOp>();
+  if (rowPid && colPid) {
+    if (rowPid.getAxisAsInt() == 0 && colPid.getAxisAsInt() == 1)
+      return "xy";
+    if (rowPid.getAxisAsInt() == 1 && colPid.getAxisAsInt() == 0)
+      return "yx";
+    return "";
+  }
+  auto divOp = rows.getDefiningOp<arith::DivSIOp>();
+  auto remOp = cols.getDefiningOp<arith::RemSIOp>();
+  if (!divOp || !remOp || divOp.getLhs() != remOp.getLhs())
+    return "";
+  auto pid = divOp.getLhs().getDefiningOp<triton::GetProgramIdOp>();
+  if (!pid || pid.getAxisAsInt() != 0 ||
+      !isNumTiles(divOp.getRhs(), n, blockN) ||
+      !isNumTiles(remOp.getRhs(), n, blockN))
+    return "";
+  return "linear";
+}
+
+// Check if the scalar is factor * param.
+bool isScaledParam(Value val, int64_t factor, GemmParam param) {
+  if (auto cst = getConstantIntValue(val))
+    return param.argIdx < 0 && *cst == factor * param.value;
+  auto mulOp = val.getDefiningOp<arith::MulIOp>();
+  if (!mulOp)
+    return false;
+  for (unsigned i = 0; i < 2; ++i)
+    if (getConstantIntValue(mulOp->getOperand(i)) == factor &&
+        getParam(mulOp->getOperand(1 - i)) == param)
+      return true;
+  return false;
+}
+
+// Check if all elements of the tensor are factor * param.
+bool isScaledSplat(Value val, int64_t factor, GemmParam param) {
+  if (auto splatOp = val.getDefiningOp<triton::SplatOp>())
+    return isScaledParam(splatOp.getSrc(), factor, param);
+  auto cst = getSplatParam(val);
+  return cst && cst->argIdx < 0 && param.argIdx < 0 &&
+         cst->value == factor * param.value;
+}
+
+StringRef getTypeName(Type ty) {
+  if (ty.isF32())
+    return "fp32";
+  if (ty.isF16())
+    return "fp16";
+  if (ty.isBF16())
+    return "bf16";
+  return "";
+}
+
+// A tile of an operand loaded in the K loop from pointers carried by it
+// and advanced by step each iteration.
+struct OperandTile {
+  TilePtr ptr;
+  bool masked;
+};
+
+// Check if the scalar is the number of K elements left from the current
+// iteration of the loop over K, i.e. K - k for loops over range(0, K, BLOCK_K)
+// or K - k * BLOCK_K for loops over blocks of K.
+bool isRemainingK(Value val, scf::ForOp forOp, GemmParam k, int64_t blockK) {
+  auto subOp = val.getDefiningOp<arith::SubIOp>();
+  if (!subOp || getParam(subOp.getLhs()) != k)
+    return false;
+  Value iv = forOp.getInductionVar();
+  Value done = subOp.getRhs();
+  if (done == iv)
+    return getConstantIntValue(forOp.getStep()) == blockK;
+  auto mulOp = done.getDefiningOp<arith::MulIOp>();
+  if (!mulOp || getConstantIntValue(forOp.getStep()) != 1)
+    return false;
+  for (unsigned i = 0; i < 2; ++i)
+    if (mulOp->getOperand(i) == iv &&
+        getConstantIntValue(mulOp->getOperand(1 - i)) == blockK)
+      return true;
+  return false;
+}
+
+// Check if the mask only bounds the K index vector of the tile by the number
+// of K elements left, e.g. offs_k[None, :] < K - k * BLOCK_K.
+bool isKMask(Value mask, Value kIdx, scf::ForOp forOp, GemmParam k,
+             int64_t blockK) {
+  auto cmpOp = stripBroadcast(mask).getDefiningOp<arith::CmpIOp>();
+  if (!cmpOp || cmpOp.getPredicate() != arith::CmpIPredicate::slt)
+    return false;
+  Value lhs = stripBroadcast(cmpOp.getLhs());
+  auto expandOp = lhs.getDefiningOp<triton::ExpandDimsOp>();
+  auto splatOp =
+      stripBroadcast(cmpOp.getRhs()).getDefiningOp<triton::SplatOp>();
+  return expandOp && expandOp.getSrc() == kIdx && splatOp &&
+         isRemainingK(splatOp.getSrc(), forOp, k, blockK);
+}
+
+std::optional<OperandTile> matchOperand(scf::ForOp forOp, Value operand,
+                                        bool isB, GemmParam k,
+                                        int64_t blockK) {
+  auto loadOp = operand.getDefiningOp<triton::LoadOp>();
+  if (!loadOp)
+    return std::nullopt;
+  auto iterArg = dyn_cast<BlockArgument>(loadOp.getPtr());
+  if (!iterArg || iterArg.getOwner() != forOp.getBody() ||
+      iterArg.getArgNumber() == 0)
+    return std::nullopt;
+  unsigned idx = iterArg.getArgNumber() - 1;
+  auto ptr = matchTilePtr(forOp.getInitArgs()[idx]);
+  if (!ptr)
+    return std::nullopt;
+  OffsetTerm kTerm = isB ? ptr->rows : ptr->cols;
+  auto kIdx = matchIndex(kTerm.idx);
+  if (!kIdx || kIdx->start || kIdx->bound || kIdx->size != blockK)
+    return std::nullopt;
+
+  // Pointers are advanced by a block along K.
+  auto yieldOp = cast<scf::YieldOp>(forOp.getBody()->getTerminator());
+  auto advanceOp = yieldOp.getOperand(idx).getDefiningOp<triton::AddPtrOp>();
+  if (!advanceOp || advanceOp.getPtr() != iterArg)
+    return std::nullopt;
+  if (!isScaledSplat(advanceOp.getOffset(), blockK, kTerm.stride))
+    return std::nullopt;
+
+  bool masked = static_cast<bool>(loadOp.getMask());
+  if (masked && (!loadOp.getOther() || !isZeroSplat(loadOp.getOther()) ||
+                 !isKMask(loadOp.getMask(), kTerm.idx, forOp, k, blockK)))
+    return std::nullopt;
+  return OperandTile{*ptr, masked};
+}
+
+// Number of K elements iterated over by the loop, which goes over blocks of
+// K either as range(0, cdiv(K, BLOCK_K)) or as range(0, K, BLOCK_K).
+std::optional<GemmParam> getLoopK(scf::ForOp forOp, int64_t blockK) {
+  if (getConstantIntValue(forOp.getLowerBound()) != 0)
+    return std::nullopt;
+  auto step = getConstantIntValue(forOp.getStep());
+  if (step == blockK)
+    return getParam(forOp.getUpperBound());
+  if (step != 1)
+    return std::nullopt;
+  return getCdivParam(forOp.getUpperBound(), blockK);
+}
+
+// Collect bounds of the row and column index vectors of the output tile
+// compared with by the store mask, e.g. (offs_cm[:, None] < M) &
+// (offs_cn[None, :] < N).
+bool collectStoreBounds(Value mask, const TilePtr &c,
+                        std::optional<GemmParam> &boundM,
+                        std::optional<GemmParam> &boundN) {
+  mask = stripBroadcast(mask);
+  if (auto andOp = mask.getDefiningOp<arith::AndIOp>())
+    return collectStoreBounds(andOp.getLhs(), c, boundM, boundN) &&
+           collectStoreBounds(andOp.getRhs(), c, boundM, boundN);
+  auto cmpOp = mask.getDefiningOp<arith::CmpIOp>();
+  if (!cmpOp || cmpOp.getPredicate() != arith::CmpIPredicate::slt)
+    return false;
+  auto bound = getSplatParam(cmpOp.getRhs());
+  auto expandOp =
+      stripBroadcast(cmpOp.getLhs()).getDefiningOp<triton::ExpandDimsOp>();
+  if (!bound || !expandOp)
+    return false;
+  if (expandOp.getSrc() == c.rows.idx)
+    boundM = bound;
+  else if (expandOp.getSrc() == c.cols.idx)
+    boundN = bound;
+  else
+    return false;
+  return true;
+}
+
+// Match a kernel computing a tile of C = A x B per program, whose tile is
+// picked by its program id as in getTileOrder, which loads
+// tiles of A and B advanced along K in a single loop, accumulates their dot
+// from zeros and stores the accumulator, optionally converted to the type
+// of C or passed through a ReLU, and has no other side effects. Return the
+// GEMM descriptor the launcher dispatches whole launches of the kernel with,
+// or an empty string.
+std::string matchGemm(triton::FuncOp funcOp) {
+  if (!funcOp.getBody().hasOneBlock())
+    return "";
+  SmallVector<triton::DotOp> dotOps;
+  SmallVector<triton::StoreOp> storeOps;
+  bool unsupported = false;
+  funcOp.walk([&](Operation *op) {
+    if (op == funcOp)
+      return;
+    if (auto dotOp = dyn_cast<triton::DotOp>(op))
+      dotOps.push_back(dotOp);
+    else if (auto storeOp = dyn_cast<triton::StoreOp>(op))
+      storeOps.push_back(storeOp);
+    else if (isa<triton::CallOp, scf::IfOp, scf::WhileOp,
+                 triton::MakeTensorPtrOp>(op) ||
+             (!isMemoryEffectFree(op) && !isa<triton::LoadOp>(op) &&
+              !op->hasTrait<OpTrait::HasRecursiveMemoryEffects>() &&
+              !isa<triton::ReturnOp>(op)))
+      unsupported = true;
+  });
+  if (unsupported || dotOps.size() != 1 || storeOps.size() != 1)
+    return "";
+  triton::DotOp dotOp = dotOps.front();
+  triton::StoreOp storeOp = storeOps.front();
+
+  // The accumulator of the dot is carried through the K loop from zeros.
+  auto forOp = dyn_cast<scf::ForOp>(dotOp->getParentOp());
+  auto accArg = dyn_cast<BlockArgument>(dotOp.getC());
+  if (!forOp || forOp->getParentOp() != funcOp || !accArg ||
+      accArg.getOwner() != forOp.getBody() || accArg.getArgNumber() == 0 ||
+      !accArg.hasOneUse())
+    return "";
+  unsigned accIdx = accArg.getArgNumber() - 1;
+  auto yieldOp = cast<scf::YieldOp>(forOp.getBody()->getTerminator());
+  if (yieldOp.getOperand(accIdx) != dotOp.getResult() ||
+      !isZeroSplat(forOp.getInitArgs()[accIdx]) ||
+      !dotOp.getType().getElementType().isF32())
+    return "";
+
+  auto aTy = cast<RankedTensorType>(dotOp.getA().getType());
+  auto bTy = cast<RankedTensorType>(dotOp.getB().getType());
+  if (aTy.getRank() != 2 || aTy.getElementType() != bTy.getElementType() ||
+      getTypeName(aTy.getElementType()).empty())
+    return "";
+  int64_t blockM = aTy.getShape()[0];
+  int64_t blockK = aTy.getShape()[1];
+  int64_t blockN = bTy.getShape()[1];
+
+  auto k = getLoopK(forOp, blockK);
+  if (!k)
+    return "";
+  auto a = matchOperand(forOp, dotOp.getA(), /*isB=*/false, *k, blockK);
+  auto b = matchOperand(forOp, dotOp.getB(), /*isB=*/true, *k, blockK);
+  auto c = matchTilePtr(storeOp.getPtr());
+  if (!a || !b || !c)
+    return "";
+
+  // Rows of A and C, and columns of B and C, are the same tile of them.
+  auto aRows = matchIndex(a->ptr.rows.idx);
+  auto bCols = matchIndex(b->ptr.cols.idx);
+  auto cRows = matchIndex(c->rows.idx);
+  auto cCols = matchIndex(c->cols.idx);
+  if (!aRows || !bCols || !cRows || !cCols || !aRows->start ||
+      aRows->start != cRows->start || !bCols->start ||
+      bCols->start != cCols->start || aRows->size != blockM ||
+      cRows->size != blockM || bCols->size != blockN ||
+      cCols->size != blockN || cRows->bound || cCols->bound)
+    return "";
+
+  std::optional<GemmParam> m = aRows->bound;
+  std::optional<GemmParam> n = bCols->bound;
+  if (storeOp.getMask() && !collectStoreBounds(storeOp.getMask(), *c, m, n))
+    return "";
+  if (!m || !n)
+    return "";
+  std::string tileOrder =
+      getTileOrder(cRows->program, cCols->program, *n, blockN);
+  if (tileOrder.empty())
+    return "";
+
+  // The stored value is the accumulator, optionally converted to the type of
+  // C and passed through a ReLU.
+  Type cElemTy = getElementTypeOrSelf(
+      cast<triton::PointerType>(getElementTypeOrSelf(storeOp.getPtr()))
+          .getPointeeType());
+  if (getTypeName(cElemTy).empty())
+    return "";
+  bool relu = false;
+  Value val = storeOp.getValue();
+  while (val != forOp.getResult(accIdx)) {
+    Operation *op = val.getDefiningOp();
+    if (isa_and_nonnull<arith::TruncFOp, triton::FpToFpOp>(op)) {
+      val = op->getOperand(0);
+    } else if (isa_and_nonnull<arith::MaximumFOp, arith::MaxNumFOp>(op) &&
+               !relu) {
+      if (isZeroSplat(op->getOperand(1)))
+        val = op->getOperand(0);
+      else if (isZeroSplat(op->getOperand(0)))
+        val = op->getOperand(1);
+      else
+        return "";
+      relu = true;
+    } else {
+      return "";
+    }
+  }
+
+  SmallVector<std::string> fields = {
+      "a=" + a->ptr.base.str(),
+      "b=" + b->ptr.base.str(),
+      "c=" + c->base.str(),
+      "m=" + m->str(),
+      "n=" + n->str(),
+      "k=" + k->str(),
+      "stride_am=" + a->ptr.rows.stride.str(),
+      "stride_ak=" + a->ptr.cols.stride.str(),
+      "stride_bk=" + b->ptr.rows.stride.str(),
+      "stride_bn=" + b->ptr.cols.stride.str(),
+      "stride_cm=" + c->rows.stride.str(),
+      "stride_cn=" + c->cols.stride.str(),
+      "block_m=" + std::to_string(blockM),
+      "block_n=" + std::to_string(blockN),
+      "block_k=" + std::to_string(blockK),
+      "ab_type=" + getTypeName(aTy.getElementType()).str(),
+      "c_type=" + getTypeName(cElemTy).str(),
+      "k_masked=" + std::to_string(a->masked || b->masked),
+      "relu=" + std::to_string(relu),
+      "tiles=" + tileOrder};
+  return llvm::join(fields, ",");
+}
+
+struct MatchGemmKernels
+    : public triton::impl::MatchGemmKernelsBase<MatchGemmKernels> {
+  using MatchGemmKernelsBase::MatchGemmKernelsBase;
+
+  MatchGemmKernels() : MatchGemmKernelsBase() {}
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+
+    SmallVector<triton::FuncOp> kernels;
+    mod.walk([&](triton::FuncOp funcOp) {
+      if (LLVM::isKernel(funcOp) && !funcOp.isExternal())
+        kernels.push_back(funcOp);
+    });
+    if (kernels.size() != 1)
+      return;
+
+    std::string desc = matchGemm(kernels.front());
+    if (desc.empty())
+      return;
+    LDBG("Matched GEMM kernel " << kernels.front().getName() << ": " << desc);
+    // The launcher dispatches whole launches of kernels of modules with this
+    // attribute to a GEMM library.
+    mod->setAttr("triton_cpu.gemm", StringAttr::get(&getContext(), desc));
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createMatchGemmKernels() {
+  return std::make_unique<MatchGemmKernels>();
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -0,0 +1,81 @@
+#ifndef TRITON_CONVERSION_TRITON_TO_TRITONCPU_MEMORYACCESSCOSTMODEL_H
+#define TRITON_CONVERSION_TRITON_TO_TRITONCPU_MEMORYACCESSCOSTMODEL_H
+
+#include "triton/Dialect/Triton/IR/Types.h"
+
+#include "llvm/Support/MathExtras.h"
+
+#include <optional>
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+// Cost model choosing the lowering of non-contiguous accesses. Costs are
+// rough reciprocal throughputs of the instructions each lowering produces.
+struct MemoryAccessCostModel {
+  // Vector register size in bytes, zero disables the cost model.
+  unsigned vectorBytes = 0;
+  bool nativeGather = true;
+  bool nativeScatter = true;
+  bool nativeMaskedStore = true;
+
+  // Fixed cost of a hardware gather or scatter instruction on top of a load
+  // or store per element, which makes them slower than scalar accesses for
+  // short vectors on many x86 cores.
+  static constexpr int64_t gatherScatterOverhead = 6;
+
+  bool enabled() const { return vectorBytes > 0; }
+
+  // Size of accessed elements, pointers are accessed as 64-bit integers.
+  static int64_t getElemBytes(Type elemTy) {
+    if (isa<PointerType>(elemTy))
+      return 8;
+    return std::max<int64_t>(elemTy.getIntOrFloatBitWidth() / 8, 1);
+  }
+
+  int64_t getNumVectors(int64_t numElems, int64_t elemBytes) const {
+    return llvm::divideCeil(numElems * elemBytes, vectorBytes);
+  }
+
+  // Each element is extracted from the pointers, accessed and inserted into
+  // or extracted from the values, with a branch if the access is masked.
+  int64_t getScalarCost(int64_t numElems, bool masked) const {
+    return numElems * (masked ? 3 : 2);
+  }
+
+  // Emulated gathers and scatters are never cheaper than scalar accesses.
+  std::optional<int64_t> getGatherScatterCost(int64_t numElems,
+                                              int64_t elemBytes,
+                                              bool native) const {
+    if (!native)
+      return std::nullopt;
+    return getNumVectors(numElems, elemBytes) * gatherScatterOverhead +
+           numElems;
+  }
+
+  // Check if rows of numElems elements are accessed faster with gathers or
+  // scatters than with scalar accesses.
+  bool preferGatherScatter(int64_t numElems, int64_t elemBytes, bool masked,
+                           bool isLoad) const {
+    auto cost = getGatherScatterCost(numElems, elemBytes,
+                                     isLoad ? nativeGather : nativeScatter);
+    return cost && *cost < getScalarCost(numElems, masked);
+  }
+
+  // A row with a constant stride is accessed with contiguous vector loads or
+  // stores spanning the whole row, and shuffles between them and the row. The
+  // mask of a masked row is shuffled too. Stores are always masked to skip
+  // the elements between the row ones.
+  int64_t getStridedCost(int64_t numElems, int64_t stride, int64_t elemBytes,
+                         bool masked) const {
+    int64_t numLoads = getNumVectors((numElems - 1) * stride + 1, elemBytes);
+    return (masked ? 3 : 2) * numLoads + getNumVectors(numElems, elemBytes);
+  }
+};
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
+
+#endif
@@ -0,0 +1,222 @@
+#include "cpu/include/TritonToTritonCPU/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+
+#include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "triton-cpu-narrow-offsets"
+#define DBGS() (llvm::dbgs() << "[" DEBUG_TYPE "]: ")
+#define LDBG(X) LLVM_DEBUG(DBGS() << X << "\n")
+
+namespace mlir {
+namespace triton {
+#define GEN_PASS_DEF_NARROWOFFSETS
+#include "cpu/include/TritonToTritonCPU/Passes.h.inc"
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+
+namespace {
+
+Type getI32Like(Type type) {
+  auto i32Ty = IntegerType::get(type.getContext(), 32);
+  if (auto tensorTy = dyn_cast<RankedTensorType>(type))
+    return tensorTy.clone(i32Ty);
+  return i32Ty;
+}
+
+// Return true if the value is a pointer argument of a function specialized
+// for tensors of less than 2GB, see CPUBackend.is_within_2gb.
+bool isSmallTensorArg(Value val) {
+  auto arg = dyn_cast<BlockArgument>(val);
+  if (!arg || !isa<PointerType>(arg.getType()) ||
+      !arg.getOwner()->isEntryBlock())
+    return false;
+  auto func = dyn_cast<FunctionOpInterface>(arg.getOwner()->getParentOp());
+  if (!func)
+    return false;
+  auto range = func.getArgAttrOfType<IntegerAttr>(arg.getArgNumber(),
+                                                   "tt.pointer_range");
+  return range && range.getInt() == 32;
+}
+
+// Return true if all users of the pointers only access memory through them
+// or derive other pointers, so values of pointers that aren't accessed can
+// change.
+bool hasOnlyAccessUsers(Value ptr) {
+  return llvm::all_of(ptr.getUsers(), [](Operation *user) {
+    return isa<LoadOp, StoreOp, AtomicRMWOp, AtomicCASOp, AddPtrOp, SplatOp,
+               BroadcastOp, ExpandDimsOp>(user);
+  });
+}
+
+class OffsetNarrower {
+public:
+  OffsetNarrower(MLIRContext *ctx) : rewriter(ctx) {}
+
+  // Rebuild the i32 offset of the pointers from a small tensor argument, or
+  // fail if they aren't derived from one. The offset is null for the argument
+  // itself.
+  FailureOr<Value> getOffsetFromArg(Value ptr, Value &base) {
+    if (isSmallTensorArg(ptr)) {
+      base = ptr;
+      return Value();
+    }
+    Operation *defOp = ptr.getDefiningOp();
+    if (!defOp || !hasOnlyAccessUsers(ptr))
+      return failure();
+    return TypeSwitch<Operation *, FailureOr<Value>>(defOp)
+        .Case<AddPtrOp>([&](auto op) -> FailureOr<Value> {
+          auto prev = getOffsetFromArg(op.getPtr(), base);
+          if (failed(prev))
+            return failure();
+          Value off = narrow(op.getOffset());
+          if (!*prev)
+            return off;
+          rewriter.setInsertionPoint(op);
+          return rewriter.create<arith::AddIOp>(op.getLoc(), *prev, off)
+              .getResult();
+        })
+        .Case<SplatOp, BroadcastOp, ExpandDimsOp>(
+            [&](auto op) -> FailureOr<Value> {
+              auto prev = getOffsetFromArg(op.getSrc(), base);
+              if (failed(prev) || !*prev)
+                return prev;
+              rewriter.setInsertionPoint(op);
+              return reshape(op, *prev);
+            })
+        .Default([](Operation *) { return failure(); });
+  }
+
+  // Return the value truncated to i32, computed from 32-bit sources where
+  // possible. Ops are exact modulo 2^32, so only their results have to fit.
+  // New ops are inserted right after the value, which dominates its users.
+  Value narrow(Value val) {
+    auto intTy = cast<IntegerType>(getElementTypeOrSelf(val.getType()));
+    if (intTy.getWidth() == 32)
+      return val;
+    if (Value narrowed = cache.lookup(val))
+      return narrowed;
+
+    Type type = getI32Like(val.getType());
+    Location loc = val.getLoc();
+    Operation *defOp = val.getDefiningOp();
+    Value res;
+    if (intTy.getWidth() < 32) {
+      rewriter.setInsertionPointAfterValue(val);
+      res = rewriter.create<arith::ExtSIOp>(loc, type, val);
+    } else if (auto cstAttr = getTruncatedConstant(val, type)) {
+      rewriter.setInsertionPointAfterValue(val);
+      res = rewriter.create<arith::ConstantOp>(loc, cstAttr);
+    } else if (isa_and_nonnull<arith::AddIOp, arith::SubIOp, arith::MulIOp>(
+                   defOp)) {
+      // Overflow flags of the i64 ops don't hold in i32.
+      Value lhs = narrow(defOp->getOperand(0));
+      Value rhs = narrow(defOp->getOperand(1));
+      rewriter.setInsertionPointAfterValue(val);
+      OperationState state(loc, defOp->getName(), {lhs, rhs}, {type});
+      res = rewriter.create(state)->getResult(0);
+    } else if (isa_and_nonnull<arith::ExtSIOp, arith::ExtUIOp>(defOp)) {
+      Value src = defOp->getOperand(0);
+      auto srcTy = cast<IntegerType>(getElementTypeOrSelf(src.getType()));
+      if (srcTy.getWidth() == 32 || isa<arith::ExtSIOp>(defOp)) {
+        res = narrow(src);
+      } else {
+        rewriter.setInsertionPointAfterValue(val);
+        res = rewriter.create<arith::ExtUIOp>(loc, type, src);
+      }
+    } else if (isa_and_nonnull<SplatOp, BroadcastOp, ExpandDimsOp>(defOp)) {
+      Value src = narrow(defOp->getOperand(0));
+      rewriter.setInsertionPointAfterValue(val);
+      res = TypeSwitch<Operation *, Value>(defOp)
+                .Case<SplatOp, BroadcastOp, ExpandDimsOp>(
+                    [&](auto op) { return reshape(op, src); });
+    } else {
+      rewriter.setInsertionPointAfterValue(val);
+      res = rewriter.create<arith::TruncIOp>(loc, type, val);
+    }
+    cache[val] = res;
+    return res;
+  }
+
+  IRRewriter rewriter;
+
+private:
+  TypedAttr getTruncatedConstant(Value val, Type type) {
+    Attribute attr;
+    if (!matchPattern(val, m_Constant(&attr)))
+      return {};
+    if (auto intAttr = dyn_cast<IntegerAttr>(attr))
+      return IntegerAttr::get(type, intAttr.getValue().trunc(32));
+    if (auto denseAttr = dyn_cast<DenseIntElementsAttr>(attr))
+      return cast<TypedAttr>(denseAttr.mapValues(
+          getElementTypeOrSelf(type),
+          [](const APInt &v) { return v.trunc(32); }));
+    return {};
+  }
+
+  // Apply the op reshaping pointers or offsets to the i32 offset.
+  template <typename OpTy> Value reshape(OpTy op, Value off) {
+    if constexpr (std::is_same_v<OpTy, ExpandDimsOp>)
+      return rewriter.create<ExpandDimsOp>(op.getLoc(), off, op.getAxis());
+    else
+      return rewriter.create<OpTy>(op.getLoc(), getI32Like(op.getType()),
+                                   off);
+  }
+
+  DenseMap<Value, Value> cache;
+};
+
+struct NarrowOffsets : public triton::impl::NarrowOffsetsBase<NarrowOffsets> {
+  NarrowOffsets() = default;
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+    SmallVector<AddPtrOp> addPtrOps;
+    mod.walk([&](AddPtrOp op) {
+      auto offTy = dyn_cast<RankedTensorType>(op.getOffset().getType());
+      if (offTy && offTy.getElementType().isInteger(64))
+        addPtrOps.push_back(op);
+    });
+
+    OffsetNarrower narrower(&getContext());
+    IRRewriter &rewriter = narrower.rewriter;
+    for (AddPtrOp op : addPtrOps) {
+      Value base;
+      auto off = narrower.getOffsetFromArg(op.getResult(), base);
+      if (failed(off) || !*off)
+        continue;
+      LDBG("Narrowing offsets of " << op);
+      // Pointers are rebuilt from the argument with the whole 32-bit offset,
+      // so offsets of intermediate pointers don't have to fit.
+      rewriter.setInsertionPoint(op);
+      auto ptrTy = cast<RankedTensorType>(op.getType());
+      Value ptrs = rewriter.create<SplatOp>(op.getLoc(), ptrTy, base);
+      rewriter.replaceOpWithNewOp<AddPtrOp>(op, ptrTy, ptrs, *off);
+    }
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createNarrowOffsets() {
+  return std::make_unique<NarrowOffsets>();
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
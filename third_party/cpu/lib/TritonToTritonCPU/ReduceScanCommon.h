@@ -192,15 +192,15 @@ struct ReduceScanOpConversionBase : public OpConversionPattern<OpT> {
     Value res = localMap.lookupOrNull(val);
     if (!res) {
       // If value is not found then it's an invariant defined in the outer
-      // region. We check if it has been already translated and add a splat
-      // operation if it hasn't.
-      res = invariantsMap.lookupOrNull(val);
+      // region. We check if it has been already translated to the required
+      // shape and add a splat operation if it hasn't.
+      auto vecTy = VectorType::get(shape, val.getType());
+      res = invariantsMap.lookup({val, vecTy});
       if (!res) {
         auto ip = rewriter.saveInsertionPoint();
         rewriter.setInsertionPointAfterValue(val);
-        res = rewriter.create<vector::SplatOp>(
-            val.getLoc(), VectorType::get(shape, val.getType()), val);
-        invariantsMap.map(val, res);
+        res = rewriter.create<vector::SplatOp>(val.getLoc(), vecTy, val);
+        invariantsMap[{val, vecTy}] = res;
         rewriter.restoreInsertionPoint(ip);
       }
     }
@@ -236,7 +236,8 @@ struct ReduceScanOpConversionBase : public OpConversionPattern<OpT> {
   }
 
 private:
-  mutable IRMapping invariantsMap;
+  // Splats of invariants, by the invariant and the splat type.
+  mutable DenseMap<std::pair<Value, Type>, Value> invariantsMap;
 };
 
 } // namespace cpu
@@ -2,6 +2,7 @@
 
 #include "cpu/include/ScalarizePass/ScalarizeInterface.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
 #include "triton/Dialect/Triton/IR/Dialect.h"
 
 using namespace mlir;
@@ -252,6 +253,56 @@ template <> struct ScalariztionFunctor<TransOp> {
   }
 };
 
+// Function argument a pointer is computed from, if any.
+BlockArgument getBasePtrArg(Value ptr) {
+  while (Operation *def = ptr.getDefiningOp()) {
+    if (isa<AddPtrOp, SplatOp, BroadcastOp, ExpandDimsOp>(def))
+      ptr = def->getOperand(0);
+    else
+      return nullptr;
+  }
+  return dyn_cast<BlockArgument>(ptr);
+}
+
+// Elements of an unmasked load can be loaded one at a time where they are
+// used, e.g. block indices of a paged KV-cache that compute row pointers of
+// K and V blocks. The loaded memory has to be a function argument that the
+// function doesn't write, so that moving the load doesn't change its value.
+template <>
+bool TritonOpScalarizeInterface<LoadOp>::canComputeScalarValue(
+    Operation *op, Value vals) const {
+  auto loadOp = cast<LoadOp>(op);
+  if (loadOp.getMask() || loadOp.getOther() ||
+      !loadOp.getBoundaryCheck().empty() || loadOp.getIsVolatile())
+    return false;
+  BlockArgument base = getBasePtrArg(loadOp.getPtr());
+  if (!base || !isa<FunctionOpInterface>(base.getOwner()->getParentOp()))
+    return false;
+  auto funcOp = cast<FunctionOpInterface>(base.getOwner()->getParentOp());
+  bool written = funcOp
+                     .walk([&](Operation *user) {
+                       Value ptr;
+                       if (auto storeOp = dyn_cast<StoreOp>(user))
+                         ptr = storeOp.getPtr();
+                       else if (auto rmwOp = dyn_cast<AtomicRMWOp>(user))
+                         ptr = rmwOp.getPtr();
+                       else if (auto casOp = dyn_cast<AtomicCASOp>(user))
+                         ptr = casOp.getPtr();
+                       else
+                         return WalkResult::advance();
+                       BlockArgument userBase = getBasePtrArg(ptr);
+                       return !userBase || userBase == base
+                                  ? WalkResult::interrupt()
+                                  : WalkResult::advance();
+                     })
+                     .wasInterrupted();
+  if (written)
+    return false;
+  auto scalarized =
+      dyn_cast_or_null<ScalarizeInterface>(loadOp.getPtr().getDefiningOp());
+  return scalarized && scalarized.canComputeScalarValue(loadOp.getPtr());
+}
+
 } // namespace
 
 template <typename OpType> static void registerOne(MLIRContext *ctx) {
@@ -266,12 +317,12 @@ void mlir::triton::cpu::registerTritonOpScalarizeExternalModels(
     DialectRegistry &registry) {
   registry.addExtension(+[](MLIRContext *ctx, TritonDialect *dialect) {
     registerAll<AddPtrOp, BroadcastOp, ExpandDimsOp, TransOp, SplatOp,
-                MakeRangeOp>(ctx);
+                MakeRangeOp, LoadOp>(ctx);
   });
   registry.addExtension(+[](MLIRContext *ctx, arith::ArithDialect *dialect) {
-    registerAll<arith::AddFOp, arith::AddIOp, arith::CmpFOp, arith::CmpIOp,
-                arith::DivFOp, arith::DivSIOp, arith::MulIOp, arith::MulFOp,
-                arith::RemFOp, arith::RemUIOp, arith::RemSIOp,
-                arith::ConstantOp>(ctx);
+    registerAll<arith::AddFOp, arith::AddIOp, arith::SubIOp, arith::CmpFOp,
+                arith::CmpIOp, arith::DivFOp, arith::DivSIOp, arith::MulIOp,
+                arith::MulFOp, arith::RemFOp, arith::RemUIOp, arith::RemSIOp,
+                arith::ExtSIOp, arith::ExtUIOp, arith::ConstantOp>(ctx);
   });
 }
@@ -1,3 +1,4 @@
+#include "MemoryAccessCostModel.h"
 #include "TypeConverter.h"
 
 #include "cpu/include/TritonToTritonCPU/Passes.h"
@@ -32,8 +33,10 @@ template <typename OpTy>
 struct ScalarizeOpConversion : public OpRewritePattern<OpTy> {
 
   ScalarizeOpConversion(ModuleAxisInfoAnalysis &axisInfoAnalysis,
-                        MLIRContext *context, bool skipGatherScatter)
-      : OpRewritePattern<OpTy>(context), axisAnalysis(axisInfoAnalysis) {
+                        MLIRContext *context, bool skipGatherScatter,
+                        const MemoryAccessCostModel &costModel)
+      : OpRewritePattern<OpTy>(context), axisAnalysis(axisInfoAnalysis),
+        costModel(costModel) {
     this->skipGatherScatter = skipGatherScatter;
   }
 
@@ -142,16 +145,42 @@ struct ScalarizeOpConversion : public OpRewritePattern<OpTy> {
       return false;
     }
 
+    // Loads of pointers uniform along rows are lowered to a scalar load per
+    // row by memory ops conversion.
+    if constexpr (std::is_same_v<OpTy, triton::LoadOp>) {
+      if (getUniformLoadDims(axisAnalysis, scalarizeOp))
+        return false;
+    }
+
     auto [basePtr, offset] = getMemoryBaseOffset(scalarizeOp);
     if (skipGatherScatter && basePtr && offset) {
       return false;
     }
 
+    // Accesses with a constant stride can be vectorized by memory ops
+    // conversion.
+    if (skipGatherScatter && getConstantRowStride(axisAnalysis, ptr)) {
+      return false;
+    }
+
     // Scalar memory ops and boundary checks are not expected.
     if (!scalarizeOp.getBoundaryCheck().empty()) {
       return false;
     }
 
+    // Other pointers are gathered or scattered by their addresses when the
+    // target makes it cheaper than a scalar loop, see ConvertMemoryOps.
+    if (skipGatherScatter && costModel.enabled()) {
+      auto tensorTy = dyn_cast<RankedTensorType>(getMemoryOpType(scalarizeOp));
+      if (tensorTy &&
+          costModel.preferGatherScatter(
+              tensorTy.getShape().back(),
+              MemoryAccessCostModel::getElemBytes(tensorTy.getElementType()),
+              static_cast<bool>(scalarizeOp.getMask()),
+              std::is_same_v<OpTy, triton::LoadOp>))
+        return false;
+    }
+
     return ScalarizeOpConversion<OpTy>::shouldScalarizeOp(scalarizeOp);
   }
 
@@ -169,6 +198,7 @@ struct ScalarizeOpConversion : public OpRewritePattern<OpTy> {
 protected:
   ModuleAxisInfoAnalysis &axisAnalysis;
   bool skipGatherScatter;
+  MemoryAccessCostModel costModel;
 };
 
 template <>
@@ -371,19 +401,36 @@ struct ScalarizeUsingForOpPass
     this->skipGatherScatter = skipGatherScatter;
   }
 
+  ScalarizeUsingForOpPass(bool skipGatherScatter, unsigned vectorBytes,
+                          bool nativeGather, bool nativeScatter)
+      : ScalarizeUsingForOpBase() {
+    this->skipGatherScatter = skipGatherScatter;
+    this->vectorBytes = vectorBytes;
+    this->nativeGather = nativeGather;
+    this->nativeScatter = nativeScatter;
+  }
+
   void runOnOperation() override {
     MLIRContext *context = &getContext();
     ModuleOp mod = getOperation();
 
-    ModuleAxisInfoAnalysis axisInfoAnalysis(mod);
+    auto &axisInfoAnalysis = getAnalysis<ModuleAxisInfoAnalysis>();
+    MemoryAccessCostModel costModel{vectorBytes, nativeGather, nativeScatter};
     RewritePatternSet patterns(context);
     patterns.add<ScalarizeOpConversion<triton::LoadOp>,
                  ScalarizeOpConversion<triton::StoreOp>>(
-        axisInfoAnalysis, context, skipGatherScatter);
+        axisInfoAnalysis, context, skipGatherScatter, costModel);
 
-    if (applyPatternsGreedily(mod, std::move(patterns)).failed()) {
+    bool changed = false;
+    if (applyPatternsGreedily(mod, std::move(patterns), GreedyRewriteConfig(),
+                              &changed)
+            .failed()) {
       return signalPassFailure();
     }
+    // Passes lowering memory ops run next and reuse the analysis if no
+    // access is scalarized.
+    if (!changed)
+      markAllAnalysesPreserved();
   }
 };
 
@@ -402,6 +449,13 @@ createScalarizeUsingForOpPass(bool skipGatherScatter) {
   return std::make_unique<ScalarizeUsingForOpPass>(skipGatherScatter);
 }
 
+std::unique_ptr<OperationPass<ModuleOp>>
+createScalarizeUsingForOpPass(bool skipGatherScatter, unsigned vectorBytes,
+                              bool nativeGather, bool nativeScatter) {
+  return std::make_unique<ScalarizeUsingForOpPass>(
+      skipGatherScatter, vectorBytes, nativeGather, nativeScatter);
+}
+
 } // namespace cpu
 } // namespace triton
 } // namespace mlir
@@ -0,0 +1,148 @@
+#include "cpu/include/TritonToTritonCPU/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Dialect/Triton/IR/Dialect.h"
+
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "triton-cpu-skip-empty-dots"
+#define DBGS() (llvm::dbgs() << "[" DEBUG_TYPE "]: ")
+#define LDBG(X) LLVM_DEBUG(DBGS() << X << "\n")
+
+namespace mlir {
+namespace triton {
+#define GEN_PASS_DEF_SKIPEMPTYDOTS
+#include "cpu/include/TritonToTritonCPU/Passes.h.inc"
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+
+namespace {
+
+// Conservatively true for ops with unknown effects.
+bool mayWrite(Operation *op) {
+  if (isMemoryEffectFree(op))
+    return false;
+  auto iface = dyn_cast<MemoryEffectOpInterface>(op);
+  if (!iface || op->getNumRegions())
+    return true;
+  SmallVector<MemoryEffects::EffectInstance> effects;
+  iface.getEffects(effects);
+  return llvm::any_of(effects, [](MemoryEffects::EffectInstance &effect) {
+    return !isa<MemoryEffects::Read>(effect.getEffect());
+  });
+}
+
+// Return a load of a dot operand that can be moved to the dot, i.e. the dot
+// is its only user in the same block and nothing in between writes memory.
+triton::LoadOp getMovableLoad(Value operand, triton::DotOp dotOp) {
+  auto loadOp = operand.getDefiningOp<triton::LoadOp>();
+  if (!loadOp || !loadOp->hasOneUse() ||
+      loadOp->getBlock() != dotOp->getBlock() ||
+      !loadOp.getBoundaryCheck().empty())
+    return nullptr;
+  for (Operation *op = loadOp->getNextNode(); op != dotOp;
+       op = op->getNextNode())
+    if (mayWrite(op))
+      return nullptr;
+  return loadOp;
+}
+
+// Return the scalar flag a load is masked with, if the masked off load
+// yields zeros.
+Value getUniformMask(triton::LoadOp loadOp) {
+  Value mask = loadOp.getMask();
+  auto splatOp = mask ? mask.getDefiningOp<SplatOp>() : nullptr;
+  if (!splatOp)
+    return nullptr;
+  Value other = loadOp.getOther();
+  if (other && !matchPattern(other, m_AnyZeroFloat()) &&
+      !matchPattern(other, m_Zero()))
+    return nullptr;
+  return splatOp.getSrc();
+}
+
+// Dots of blocks that are masked off as a whole, e.g. empty blocks of
+// block-sparse operands, contribute nothing to the accumulator. Loads of
+// operands masked by uniform flags are moved together with the dot under
+// scf.if of the flags, so empty blocks are skipped before they are loaded,
+// and blocks that are loaded are read without masks.
+void skipEmptyDot(triton::DotOp dotOp) {
+  SmallVector<triton::LoadOp> loads;
+  SmallVector<Value> flags;
+  for (Value operand : {dotOp.getA(), dotOp.getB()}) {
+    auto loadOp = getMovableLoad(operand, dotOp);
+    if (!loadOp)
+      continue;
+    loads.push_back(loadOp);
+    if (Value flag = getUniformMask(loadOp))
+      flags.push_back(flag);
+  }
+  if (flags.empty())
+    return;
+  LDBG("Skipping empty blocks of " << dotOp);
+
+  OpBuilder b(dotOp);
+  Location loc = dotOp.getLoc();
+  Value cond = flags[0];
+  if (flags.size() > 1 && flags[1] != flags[0])
+    cond = b.create<arith::AndIOp>(loc, flags[0], flags[1]);
+  auto ifOp = b.create<scf::IfOp>(
+      loc, cond,
+      [&](OpBuilder &b, Location loc) {
+        IRMapping mapping;
+        for (auto loadOp : loads) {
+          if (!getUniformMask(loadOp)) {
+            b.clone(*loadOp, mapping);
+            continue;
+          }
+          Value val = b.create<triton::LoadOp>(
+              loadOp.getLoc(), loadOp.getPtr(), loadOp.getCache(),
+              loadOp.getEvict(), loadOp.getIsVolatile());
+          mapping.map(loadOp.getResult(), val);
+        }
+        b.create<scf::YieldOp>(loc, b.clone(*dotOp, mapping)->getResults());
+      },
+      [&](OpBuilder &b, Location loc) {
+        b.create<scf::YieldOp>(loc, dotOp.getC());
+      });
+  dotOp.getResult().replaceAllUsesWith(ifOp.getResult(0));
+  dotOp.erase();
+  for (auto loadOp : loads)
+    loadOp.erase();
+}
+
+struct SkipEmptyDots
+    : public triton::impl::SkipEmptyDotsBase<SkipEmptyDots> {
+  using SkipEmptyDotsBase::SkipEmptyDotsBase;
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+    SmallVector<triton::DotOp> dots;
+    mod.walk([&](triton::DotOp dotOp) { dots.push_back(dotOp); });
+    for (auto dotOp : dots)
+      skipEmptyDot(dotOp);
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createSkipEmptyDots() {
+  return std::make_unique<SkipEmptyDots>();
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
@@ -0,0 +1,474 @@
+#include "cpu/include/TritonToTritonCPU/Passes.h"
+
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/Pass/Pass.h"
+
+#include "triton/Conversion/TritonGPUToLLVM/Utility.h"
+#include "triton/Dialect/Triton/IR/Dialect.h"
+
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "triton-cpu-split-k"
+#define DBGS() (llvm::dbgs() << "[" DEBUG_TYPE "]: ")
+#define LDBG(X) LLVM_DEBUG(DBGS() << X << "\n")
+
+namespace mlir {
+namespace triton {
+#define GEN_PASS_DEF_SPLITK
+#include "cpu/include/TritonToTritonCPU/Passes.h.inc"
+} // namespace triton
+} // namespace mlir
+
+using namespace mlir;
+using namespace mlir::triton;
+
+namespace {
+
+// A K loop of a kernel with accumulators of dots or sums carried through it.
+// Other loop-carried values are advanced by the same increment every
+// iteration, e.g. pointers of K tiles, and are listed with their updates.
+struct SplitKCandidate {
+  scf::ForOp forOp;
+  SmallVector<unsigned> accIdxs;
+  SmallVector<std::pair<unsigned, Operation *>> inductions;
+};
+
+// Check if the loop-carried value idx is only updated by a single dot or a
+// single addition, so partial accumulators of splits can be summed.
+bool isSumAcc(scf::ForOp forOp, unsigned idx) {
+  Value iterArg = forOp.getRegionIterArg(idx);
+  if (!iterArg.hasOneUse() || !isa<RankedTensorType>(iterArg.getType()))
+    return false;
+  Operation *user = *iterArg.getUsers().begin();
+  if (auto dotOp = dyn_cast<triton::DotOp>(user)) {
+    if (dotOp.getC() != iterArg)
+      return false;
+  } else if (!isa<arith::AddFOp, arith::AddIOp>(user)) {
+    return false;
+  }
+  if (!user->getResult(0).hasOneUse())
+    return false;
+  auto yieldOp = cast<scf::YieldOp>(forOp.getBody()->getTerminator());
+  if (yieldOp.getOperand(idx) != user->getResult(0))
+    return false;
+  // Partial accumulators are kept in 32-bit scratch slots.
+  auto accTy = cast<RankedTensorType>(iterArg.getType());
+  return accTy.getElementType().isF32() ||
+         accTy.getElementType().isInteger(32);
+}
+
+// Check if the loop-carried value idx is loop-invariant or advanced by a
+// loop-invariant increment every iteration, like pointers moved with
+// `a_ptrs += BLOCK_K` or tl.advance. Set update to the op advancing it, or
+// to null for invariant values.
+bool isInduction(scf::ForOp forOp, unsigned idx, Operation *&update) {
+  Value iterArg = forOp.getRegionIterArg(idx);
+  auto yieldOp = cast<scf::YieldOp>(forOp.getBody()->getTerminator());
+  Value next = yieldOp.getOperand(idx);
+  update = nullptr;
+  if (next == iterArg)
+    return true;
+  update = next.getDefiningOp();
+  if (!update || update->getBlock() != forOp.getBody())
+    return false;
+  if (auto addPtrOp = dyn_cast<triton::AddPtrOp>(update))
+    return addPtrOp.getPtr() == iterArg &&
+           forOp.isDefinedOutsideOfLoop(addPtrOp.getOffset());
+  if (auto advanceOp = dyn_cast<triton::AdvanceOp>(update))
+    return advanceOp.getPtr() == iterArg &&
+           llvm::all_of(advanceOp.getOffsets(), [&](Value offset) {
+             return forOp.isDefinedOutsideOfLoop(offset);
+           });
+  if (auto addOp = dyn_cast<arith::AddIOp>(update)) {
+    Value inc = addOp.getLhs() == iterArg ? addOp.getRhs() : addOp.getLhs();
+    return (addOp.getLhs() == iterArg || addOp.getRhs() == iterArg) &&
+           forOp.isDefinedOutsideOfLoop(inc);
+  }
+  return false;
+}
+
+// Find the first top-level loop of the kernel whose used results are all
+// accumulators of dots or sums and whose other loop-carried values are
+// inductions, so splits can start from any iteration. Programs of different
+// splits run the code before the loop redundantly, so kernels with atomics or
+// calls are skipped.
+std::optional<SplitKCandidate> findCandidate(triton::FuncOp funcOp) {
+  if (!funcOp.getBody().hasOneBlock())
+    return std::nullopt;
+  bool hasSideEffects = false;
+  funcOp.walk([&](Operation *op) {
+    if (isa<triton::CallOp, triton::AtomicRMWOp, triton::AtomicCASOp>(op))
+      hasSideEffects = true;
+  });
+  if (hasSideEffects)
+    return std::nullopt;
+
+  for (auto forOp : funcOp.getBody().front().getOps<scf::ForOp>()) {
+    auto step = getConstantIntValue(forOp.getStep());
+    if (!step || *step <= 0)
+      continue;
+    SplitKCandidate res{forOp, {}};
+    bool valid = true;
+    for (auto [idx, result] : llvm::enumerate(forOp.getResults())) {
+      Operation *update;
+      if (isSumAcc(forOp, idx))
+        res.accIdxs.push_back(idx);
+      else if (!result.use_empty() || !isInduction(forOp, idx, update))
+        valid = false;
+      else if (update)
+        res.inductions.emplace_back(idx, update);
+    }
+    if (valid && !res.accIdxs.empty())
+      return res;
+  }
+  return std::nullopt;
+}
+
+Value intCst(Location loc, Type ty, int64_t val, OpBuilder &b) {
+  return b.create<arith::ConstantOp>(loc, ty, b.getIntegerAttr(ty, val));
+}
+
+Value castInt(Location loc, Value val, Type ty, OpBuilder &b) {
+  if (val.getType() == ty)
+    return val;
+  if (ty.isIndex() || val.getType().isIndex())
+    return b.create<arith::IndexCastOp>(loc, ty, val);
+  if (ty.getIntOrFloatBitWidth() > val.getType().getIntOrFloatBitWidth())
+    return b.create<arith::ExtSIOp>(loc, ty, val);
+  return b.create<arith::TruncIOp>(loc, ty, val);
+}
+
+// Multiply the increment of an induction by count iterations.
+Value scaleInc(Location loc, Value inc, Value count, OpBuilder &b) {
+  Value scale = castInt(loc, count, getElementTypeOrSelf(inc.getType()), b);
+  if (auto tensorTy = dyn_cast<RankedTensorType>(inc.getType()))
+    scale = b.create<triton::SplatOp>(loc, tensorTy, scale);
+  return b.create<arith::MulIOp>(loc, inc, scale);
+}
+
+// Get the value of an induction after count iterations of the loop starting
+// from init.
+Value advanceInduction(Location loc, Value init, Value iterArg,
+                       Operation *update, Value count, OpBuilder &b) {
+  if (auto addPtrOp = dyn_cast<triton::AddPtrOp>(update))
+    return b.create<triton::AddPtrOp>(
+        loc, init.getType(), init,
+        scaleInc(loc, addPtrOp.getOffset(), count, b));
+  if (auto advanceOp = dyn_cast<triton::AdvanceOp>(update)) {
+    SmallVector<Value> offsets;
+    for (Value offset : advanceOp.getOffsets())
+      offsets.push_back(scaleInc(loc, offset, count, b));
+    return b.create<triton::AdvanceOp>(loc, init.getType(), init, offsets);
+  }
+  auto addOp = cast<arith::AddIOp>(update);
+  Value inc = addOp.getLhs() == iterArg ? addOp.getRhs() : addOp.getLhs();
+  return b.create<arith::AddIOp>(loc, init, scaleInc(loc, inc, count, b));
+}
+
+// Get pointers to a flattened tile starting at element offset of base.
+Value getTilePtrs(Location loc, Value base, Value offset, int64_t numElems,
+                  OpBuilder &b) {
+  Value ptr = b.create<triton::AddPtrOp>(loc, base.getType(), base, offset);
+  auto idxTy = RankedTensorType::get({numElems}, b.getI32Type());
+  auto ptrsTy = RankedTensorType::get({numElems}, base.getType());
+  Value range = b.create<triton::MakeRangeOp>(loc, idxTy, 0, numElems);
+  Value ptrs = b.create<triton::SplatOp>(loc, ptrsTy, ptr);
+  return b.create<triton::AddPtrOp>(loc, ptrsTy, ptrs, range);
+}
+
+void storeTile(Location loc, Value tile, Value base, Value offset,
+               OpBuilder &b) {
+  auto tileTy = cast<RankedTensorType>(tile.getType());
+  int64_t numElems = tileTy.getNumElements();
+  Value flat = b.create<triton::ReshapeOp>(
+      loc, ArrayRef<int64_t>{numElems},
+      cast<TypedValue<RankedTensorType>>(tile));
+  b.create<triton::StoreOp>(loc, getTilePtrs(loc, base, offset, numElems, b),
+                            flat, triton::CacheModifier::NONE,
+                            triton::EvictionPolicy::NORMAL);
+}
+
+Value loadTile(Location loc, RankedTensorType tileTy, Value base, Value offset,
+               OpBuilder &b) {
+  int64_t numElems = tileTy.getNumElements();
+  Value flat = b.create<triton::LoadOp>(
+      loc, getTilePtrs(loc, base, offset, numElems, b),
+      triton::CacheModifier::NONE, triton::EvictionPolicy::NORMAL,
+      /*isVolatile=*/false);
+  return b.create<triton::ReshapeOp>(loc, tileTy.getShape(),
+                                     cast<TypedValue<RankedTensorType>>(flat));
+}
+
+// Split iterations of the K loop between numSplits programs along Z and
+// reduce their partial accumulators. Each program stores its accumulators
+// into its slot of the scratch buffer and increments the counter of its
+// tile. The last program of a tile sums the slots in split order, so the
+// result doesn't depend on the order programs finish in, resets the counter
+// and runs the rest of the kernel, e.g. the store of the result.
+//
+// The kernel gets three trailing arguments: the number of splits, the
+// scratch buffer with a slot of slotSize elements per split of each tile
+// and zero-initialized counters, one per tile. A single split skips the
+// reduction.
+int64_t splitK(triton::FuncOp funcOp, const SplitKCandidate &cand) {
+  scf::ForOp forOp = cand.forOp;
+  Location loc = forOp.getLoc();
+  MLIRContext *ctx = funcOp.getContext();
+  OpBuilder b(ctx);
+  Type i32Ty = b.getI32Type();
+  Type i64Ty = b.getI64Type();
+
+  unsigned numArgs = funcOp.getNumArguments();
+  (void)funcOp.insertArgument(numArgs, i32Ty, DictionaryAttr(), loc);
+  (void)funcOp.insertArgument(numArgs + 1,
+                              triton::PointerType::get(b.getF32Type(), 1),
+                              DictionaryAttr(), loc);
+  (void)funcOp.insertArgument(numArgs + 2, triton::PointerType::get(i32Ty, 1),
+                              DictionaryAttr(), loc);
+  Value numSplits = funcOp.getArgument(numArgs);
+  Value scratch = funcOp.getArgument(numArgs + 1);
+  Value counters = funcOp.getArgument(numArgs + 2);
+
+  // Splits of a program are interleaved along Z.
+  SmallVector<Operation *> zOps;
+  funcOp.walk([&](Operation *op) {
+    if (auto pidOp = dyn_cast<triton::GetProgramIdOp>(op)) {
+      if (pidOp.getAxisAsInt() == 2)
+        zOps.push_back(op);
+    } else if (auto numOp = dyn_cast<triton::GetNumProgramsOp>(op)) {
+      if (numOp.getAxisAsInt() == 2)
+        zOps.push_back(op);
+    }
+  });
+  b.setInsertionPointToStart(&funcOp.getBody().front());
+  Value splitZ = b.create<triton::GetProgramIdOp>(loc, 2);
+  Value split = b.create<arith::RemUIOp>(loc, splitZ, numSplits);
+  Value z = b.create<arith::DivUIOp>(loc, splitZ, numSplits);
+  Value gridZ = b.create<arith::DivUIOp>(
+      loc, b.create<triton::GetNumProgramsOp>(loc, 2), numSplits);
+  for (Operation *op : zOps) {
+    op->replaceAllUsesWith(
+        ValueRange{isa<triton::GetProgramIdOp>(op) ? z : gridZ});
+    op->erase();
+  }
+  Value x = b.create<triton::GetProgramIdOp>(loc, 0);
+  Value y = b.create<triton::GetProgramIdOp>(loc, 1);
+  Value gridX = b.create<triton::GetNumProgramsOp>(loc, 0);
+  Value gridY = b.create<triton::GetNumProgramsOp>(loc, 1);
+  Value tile = b.create<arith::AddIOp>(
+      loc, x,
+      b.create<arith::MulIOp>(
+          loc, gridX,
+          b.create<arith::AddIOp>(
+              loc, y, b.create<arith::MulIOp>(loc, gridY, z))));
+
+  // Give each split a contiguous range of iterations. Only the first split
+  // starts from the original accumulators.
+  b.setInsertionPoint(forOp);
+  Type ivTy = forOp.getLowerBound().getType();
+  Value lb = forOp.getLowerBound();
+  Value ub = forOp.getUpperBound();
+  Value step = forOp.getStep();
+  Value splitsIv = castInt(loc, numSplits, ivTy, b);
+  Value range = b.create<arith::MaxSIOp>(
+      loc, b.create<arith::SubIOp>(loc, ub, lb), intCst(loc, ivTy, 0, b));
+  Value numIters = b.create<arith::DivSIOp>(
+      loc,
+      b.create<arith::AddIOp>(
+          loc, range,
+          b.create<arith::SubIOp>(loc, step, intCst(loc, ivTy, 1, b))),
+      step);
+  Value itersPerSplit = b.create<arith::DivSIOp>(
+      loc,
+      b.create<arith::AddIOp>(
+          loc, numIters,
+          b.create<arith::SubIOp>(loc, splitsIv, intCst(loc, ivTy, 1, b))),
+      splitsIv);
+  Value chunk = b.create<arith::MulIOp>(loc, itersPerSplit, step);
+  Value newLb = b.create<arith::AddIOp>(
+      loc, lb,
+      b.create<arith::MulIOp>(loc, castInt(loc, split, ivTy, b), chunk));
+  Value newUb = b.create<arith::MinSIOp>(
+      loc, ub, b.create<arith::AddIOp>(loc, newLb, chunk));
+  forOp.setLowerBound(newLb);
+  forOp.setUpperBound(newUb);
+
+  // Inductions of a split start where the previous splits left them.
+  Value skipped = b.create<arith::MulIOp>(
+      loc, castInt(loc, split, ivTy, b), itersPerSplit);
+  for (auto [idx, update] : cand.inductions) {
+    OpOperand &init = forOp.getInitArgsMutable()[idx];
+    init.assign(advanceInduction(loc, init.get(), forOp.getRegionIterArg(idx),
+                                 update, skipped, b));
+  }
+
+  Value isFirst = b.create<arith::CmpIOp>(loc, arith::CmpIPredicate::eq, split,
+                                          intCst(loc, i32Ty, 0, b));
+  for (unsigned idx : cand.accIdxs) {
+    OpOperand &init = forOp.getInitArgsMutable()[idx];
+    Value zero = b.create<arith::ConstantOp>(
+        loc, b.getZeroAttr(init.get().getType()));
+    init.assign(b.create<arith::SelectOp>(loc, isFirst, init.get(), zero));
+  }
+
+  SmallVector<Operation *> epilogue;
+  for (Operation *op = forOp->getNextNode();
+       op && !op->hasTrait<OpTrait::IsTerminator>(); op = op->getNextNode())
+    epilogue.push_back(op);
+
+  SmallVector<Value> accs;
+  SmallVector<Type> accTys;
+  SmallVector<int64_t> accOffsets;
+  int64_t slotSize = 0;
+  for (unsigned idx : cand.accIdxs) {
+    Value acc = forOp.getResult(idx);
+    accs.push_back(acc);
+    accTys.push_back(acc.getType());
+    accOffsets.push_back(slotSize);
+    slotSize += cast<RankedTensorType>(acc.getType()).getNumElements();
+  }
+
+  // Scratch buffer viewed with the element type of an accumulator.
+  auto getScratch = [&](OpBuilder &b, Type accTy) -> Value {
+    Type elemTy = cast<RankedTensorType>(accTy).getElementType();
+    if (elemTy.isF32())
+      return scratch;
+    return b.create<triton::BitcastOp>(loc, triton::PointerType::get(elemTy, 1),
+                                       scratch);
+  };
+  // Element offset of the slot of a split of this tile.
+  auto getSlotOffset = [&](OpBuilder &b, Value splitIdx,
+                           int64_t accOffset) -> Value {
+    Value tileSplit = b.create<arith::AddIOp>(
+        loc,
+        b.create<arith::MulIOp>(loc, castInt(loc, tile, i64Ty, b),
+                                castInt(loc, numSplits, i64Ty, b)),
+        castInt(loc, splitIdx, i64Ty, b));
+    return b.create<arith::AddIOp>(
+        loc,
+        b.create<arith::MulIOp>(loc, tileSplit,
+                                intCst(loc, i64Ty, slotSize, b)),
+        intCst(loc, i64Ty, accOffset, b));
+  };
+
+  // Sum slots of all splits of this tile in split order.
+  auto sumSlots = [&](OpBuilder &b, Type accTy, int64_t accOffset) -> Value {
+    auto tileTy = cast<RankedTensorType>(accTy);
+    bool isFloat = isa<FloatType>(tileTy.getElementType());
+    Value zero = b.create<arith::ConstantOp>(loc, b.getZeroAttr(accTy));
+    auto loop = b.create<scf::ForOp>(
+        loc, intCst(loc, i32Ty, 0, b), numSplits, intCst(loc, i32Ty, 1, b),
+        ValueRange{zero},
+        [&](OpBuilder &b, Location loc, Value idx, ValueRange iterArgs) {
+          Value part = loadTile(loc, tileTy, getScratch(b, accTy),
+                                getSlotOffset(b, idx, accOffset), b);
+          Value sum =
+              isFloat ? b.create<arith::AddFOp>(loc, iterArgs[0], part)
+                            .getResult()
+                      : b.create<arith::AddIOp>(loc, iterArgs[0], part)
+                            .getResult();
+          b.create<scf::YieldOp>(loc, sum);
+        });
+    return loop.getResult(0);
+  };
+
+  b.setInsertionPointAfter(forOp);
+  Value isSplit = b.create<arith::CmpIOp>(loc, arith::CmpIPredicate::sgt,
+                                          numSplits, intCst(loc, i32Ty, 1, b));
+  auto reduceOp = b.create<scf::IfOp>(
+      loc, isSplit,
+      [&](OpBuilder &b, Location loc) {
+        for (auto [acc, accOffset] : llvm::zip(accs, accOffsets))
+          storeTile(loc, acc, getScratch(b, acc.getType()),
+                    getSlotOffset(b, split, accOffset), b);
+        Value counter = b.create<triton::AddPtrOp>(loc, counters.getType(),
+                                                   counters, tile);
+        // Release the partial accumulators to, and acquire those of other
+        // splits for, the last split.
+        Value prev = b.create<triton::AtomicRMWOp>(
+            loc, i32Ty, triton::RMWOp::ADD, counter, intCst(loc, i32Ty, 1, b),
+            Value(), triton::MemSemantic::ACQUIRE_RELEASE,
+            triton::MemSyncScope::GPU);
+        Value isLast = b.create<arith::CmpIOp>(
+            loc, arith::CmpIPredicate::eq, prev,
+            b.create<arith::SubIOp>(loc, numSplits, intCst(loc, i32Ty, 1, b)));
+        auto sumOp = b.create<scf::IfOp>(
+            loc, isLast,
+            [&](OpBuilder &b, Location loc) {
+              SmallVector<Value> sums;
+              for (auto [accTy, accOffset] : llvm::zip(accTys, accOffsets))
+                sums.push_back(sumSlots(b, accTy, accOffset));
+              // Counters are left zeroed for the next launch.
+              b.create<triton::StoreOp>(loc, counter, intCst(loc, i32Ty, 0, b),
+                                        triton::CacheModifier::NONE,
+                                        triton::EvictionPolicy::NORMAL);
+              b.create<scf::YieldOp>(loc, sums);
+            },
+            [&](OpBuilder &b, Location loc) {
+              b.create<scf::YieldOp>(loc, accs);
+            });
+        SmallVector<Value> results{isLast};
+        results.append(sumOp.getResults().begin(), sumOp.getResults().end());
+        b.create<scf::YieldOp>(loc, results);
+      },
+      [&](OpBuilder &b, Location loc) {
+        SmallVector<Value> results{intCst(loc, b.getI1Type(), 1, b)};
+        results.append(accs);
+        b.create<scf::YieldOp>(loc, results);
+      });
+  auto epilogueOp =
+      b.create<scf::IfOp>(loc, reduceOp.getResult(0), /*withElseRegion=*/false);
+  Operation *epilogueYield = epilogueOp.thenBlock()->getTerminator();
+  for (Operation *op : epilogue)
+    op->moveBefore(epilogueYield);
+  for (auto [acc, reduced] :
+       llvm::zip(accs, reduceOp.getResults().drop_front()))
+    acc.replaceUsesWithIf(reduced, [&](OpOperand &use) {
+      return epilogueOp->isAncestor(use.getOwner());
+    });
+  return slotSize;
+}
+
+struct SplitK : public triton::impl::SplitKBase<SplitK> {
+  using SplitKBase::SplitKBase;
+
+  SplitK() : SplitKBase() {}
+
+  void runOnOperation() override {
+    ModuleOp mod = getOperation();
+
+    int64_t slotSize = 0;
+    mod.walk([&](triton::FuncOp funcOp) {
+      if (!LLVM::isKernel(funcOp))
+        return;
+      if (auto cand = findCandidate(funcOp)) {
+        LDBG("Splitting K loop: " << cand->forOp);
+        slotSize = std::max(slotSize, splitK(funcOp, *cand));
+      }
+    });
+
+    // The launcher allocates scratch slots of this size in bytes and passes
+    // the split arguments to kernels of modules with this attribute.
+    if (slotSize)
+      mod->setAttr("triton_cpu.split_k_slot_size",
+                   IntegerAttr::get(IntegerType::get(&getContext(), 64),
+                                    slotSize * 4));
+  }
+};
+
+} // namespace
+
+namespace mlir {
+namespace triton {
+namespace cpu {
+
+std::unique_ptr<OperationPass<ModuleOp>> createSplitK() {
+  return std::make_unique<SplitK>();
+}
+
+} // namespace cpu
+} // namespace triton
+} // namespace mlir
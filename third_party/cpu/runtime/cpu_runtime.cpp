@@ -1,10 +1,17 @@
 #include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <tuple>
@@ -359,6 +366,191 @@ void printMemRef(std::stringstream &ss, int32_t rank, void *descriptor,
   }
 }
 
+// Print the pid prefix like the GPU and interpreter. And vectors are printed
+// similar to Torch's printing like the following:
+// (1, 0, 0) x: [ -0.4963,  -1.7682,   2.0885,   3.1320,  -4.3074,   5.6341,
+//                -6.4901,   7.8964,  -8.4556,  -9.6323, -10.3489, -11.4017,
+//               -12.0223,  13.1689,  14.2939, -15.5185]
+std::string formatMemRef(int32_t pid0, int32_t pid1, int32_t pid2,
+                         const char *prefix, int32_t rank, void *descriptor,
+                         int32_t btw, bool isInteger, bool isSigned,
+                         bool asHex) {
+  std::stringstream ss;
+  ss << "(" << pid0 << ", " << pid1 << ", " << pid2 << ")" << prefix;
+  std::string linePrefix(ss.str().size(), ' ');
+  printMemRef(ss, rank, descriptor, btw, isInteger, isSigned, asHex,
+              linePrefix);
+  ss << "\n";
+  return ss.str();
+}
+
+template <typename... Args>
+std::string formatString(const char *format, Args... args) {
+  int size = snprintf(nullptr, 0, format, args...);
+  if (size < 0)
+    return {};
+  std::string str(size + 1, '\0');
+  snprintf(str.data(), str.size(), format, args...);
+  str.pop_back();
+  return str;
+}
+
+// Keep in sync with PrintValueKind in DebugOpsToLLVM.cpp.
+enum class PrintValueKind : int32_t {
+  None = 0,
+  Int32 = 1,
+  Int64 = 2,
+  Double = 3,
+  Pointer = 4,
+};
+
+// A print of a program, recorded in binary and formatted when the launch
+// flushes its prints. Formats and prefixes are constants of the kernel
+// module, which stays loaded until then.
+struct PrintRecord {
+  int32_t pid[3];
+  const char *format;
+  // Scalar prints.
+  PrintValueKind kind;
+  int64_t value;
+  // Tensor prints, whose elements are copied in row-major order.
+  int32_t rank;
+  int32_t btw;
+  bool isInteger;
+  bool isSigned;
+  bool asHex;
+  std::vector<intptr_t> sizes;
+  std::vector<char> data;
+
+  bool isTensor() const { return !sizes.empty(); }
+
+  std::string toString() const {
+    if (!isTensor()) {
+      switch (kind) {
+      case PrintValueKind::None:
+        return formatString(format, pid[0], pid[1], pid[2]);
+      case PrintValueKind::Int32:
+        return formatString(format, pid[0], pid[1], pid[2],
+                            static_cast<int32_t>(value));
+      case PrintValueKind::Int64:
+        return formatString(format, pid[0], pid[1], pid[2], value);
+      case PrintValueKind::Double: {
+        double val;
+        std::memcpy(&val, &value, sizeof(val));
+        return formatString(format, pid[0], pid[1], pid[2], val);
+      }
+      case PrintValueKind::Pointer:
+        return formatString(format, pid[0], pid[1], pid[2],
+                            reinterpret_cast<void *>(value));
+      }
+      llvm_unreachable("Unsupported print value kind");
+    }
+    // A descriptor of the contiguous copy, laid out like
+    // RawMemRefDescriptor.
+    std::vector<intptr_t> descriptor(3 + 2 * rank);
+    descriptor[0] = descriptor[1] = reinterpret_cast<intptr_t>(data.data());
+    intptr_t stride = 1;
+    for (int32_t i = rank - 1; i >= 0; --i) {
+      descriptor[3 + i] = sizes[i];
+      descriptor[3 + rank + i] = stride;
+      stride *= sizes[i];
+    }
+    return formatMemRef(pid[0], pid[1], pid[2], format, rank,
+                        descriptor.data(), btw, isInteger, isSigned, asHex);
+  }
+};
+
+void copyMemRefElements(const char *data, int32_t rank, const intptr_t *sizes,
+                        const intptr_t *strides, size_t elemSize,
+                        std::vector<char> &out) {
+  if (rank == 0) {
+    out.insert(out.end(), data, data + elemSize);
+    return;
+  }
+  for (intptr_t i = 0; i < sizes[0]; ++i)
+    copyMemRefElements(data + i * strides[0] * elemSize, rank - 1, sizes + 1,
+                       strides + 1, elemSize, out);
+}
+
+struct PrintBuffer {
+  // Only contended while prints are flushed.
+  std::mutex mutex;
+  std::vector<PrintRecord> records;
+};
+
+// Prints of kernel threads are appended to buffers of their threads, so
+// threads don't serialize on the output, and written by program id when the
+// launch flushes them. TRITON_CPU_UNBUFFERED_PRINT writes them right away,
+// e.g. to see prints of a kernel that crashes.
+class PrintBuffers {
+public:
+  static PrintBuffers &get() {
+    static PrintBuffers buffers;
+    return buffers;
+  }
+
+  static bool unbuffered() {
+    static const bool value = [] {
+      const char *env = std::getenv("TRITON_CPU_UNBUFFERED_PRINT");
+      return env && std::string(env) != "0";
+    }();
+    return value;
+  }
+
+  void add(PrintRecord record) {
+    if (unbuffered()) {
+      std::cout << record.toString() << std::flush;
+      return;
+    }
+    PrintBuffer &buffer = local();
+    {
+      std::lock_guard<std::mutex> lock(buffer.mutex);
+      buffer.records.push_back(std::move(record));
+    }
+    pending.store(true, std::memory_order_release);
+  }
+
+  void flush() {
+    if (!pending.exchange(false, std::memory_order_acquire))
+      return;
+    std::vector<PrintRecord> records;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &buffer : buffers) {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      std::move(buffer->records.begin(), buffer->records.end(),
+                std::back_inserter(records));
+      buffer->records.clear();
+    }
+    // Prints of a program run on one thread, so a stable sort keeps them in
+    // program order.
+    std::stable_sort(records.begin(), records.end(),
+                     [](const PrintRecord &a, const PrintRecord &b) {
+                       return std::lexicographical_compare(
+                           a.pid, a.pid + 3, b.pid, b.pid + 3);
+                     });
+    std::string out;
+    for (const PrintRecord &record : records)
+      out += record.toString();
+    std::cout << out << std::flush;
+  }
+
+private:
+  // Buffers outlive their threads, so records of exited threads are flushed
+  // too.
+  PrintBuffer &local() {
+    thread_local PrintBuffer *buffer = [this] {
+      std::lock_guard<std::mutex> lock(mutex);
+      buffers.push_back(std::make_unique<PrintBuffer>());
+      return buffers.back().get();
+    }();
+    return *buffer;
+  }
+
+  std::mutex mutex;
+  std::vector<std::unique_ptr<PrintBuffer>> buffers;
+  std::atomic<bool> pending{false};
+};
+
 } // namespace
 
 extern "C" {
@@ -368,28 +560,57 @@ EXPORT void triton_assert(int32_t pid0, int32_t pid1, int32_t pid2, bool cond,
                           const char *function) {
   if (cond)
     return;
+  // Show what other programs printed before the failure.
+  PrintBuffers::get().flush();
   fprintf(stderr, "%s:%u: %s: block: [%u, %u, %u] Assertion `%s` failed.\n",
           file, line, function, pid0, pid1, pid2, message);
   abort();
 }
 
-// Print the pid prefix like the GPU and interpreter. And vectors are printed
-// similar to Torch's printing like the following:
-// (1, 0, 0) x: [ -0.4963,  -1.7682,   2.0885,   3.1320,  -4.3074,   5.6341,
-//                -6.4901,   7.8964,  -8.4556,  -9.6323, -10.3489, -11.4017,
-//               -12.0223,  13.1689,  14.2939, -15.5185]
+// Record a print of a scalar with a printf format of the pid and the value,
+// which is given by its bits.
+EXPORT void triton_print_scalar(int32_t pid0, int32_t pid1, int32_t pid2,
+                                const char *format, int64_t value,
+                                int32_t kind) {
+  PrintRecord record{};
+  record.pid[0] = pid0;
+  record.pid[1] = pid1;
+  record.pid[2] = pid2;
+  record.format = format;
+  record.kind = static_cast<PrintValueKind>(kind);
+  record.value = value;
+  PrintBuffers::get().add(std::move(record));
+}
+
+// Record a print of a tensor, see formatMemRef.
 EXPORT void triton_print_unranked_memref(int32_t pid0, int32_t pid1,
                                          int32_t pid2, const char *prefix,
                                          UnrankedMemRefType memref, int32_t btw,
                                          bool isInteger, bool isSigned,
                                          bool asHex) {
-  std::stringstream ss;
-  ss << "(" << pid0 << ", " << pid1 << ", " << pid2 << ")" << prefix;
-  std::string linePrefix(ss.str().size(), ' ');
-  printMemRef(ss, memref.rank, memref.descriptor, btw, isInteger, isSigned,
-              asHex, linePrefix);
-  ss << "\n";
-  std::cout << ss.str() << std::flush;
+  PrintRecord record{};
+  record.pid[0] = pid0;
+  record.pid[1] = pid1;
+  record.pid[2] = pid2;
+  record.format = prefix;
+  record.rank = static_cast<int32_t>(memref.rank);
+  record.btw = btw;
+  record.isInteger = isInteger;
+  record.isSigned = isSigned;
+  record.asHex = asHex;
+  // Booleans are stored in bytes.
+  size_t elemSize = std::max(btw / 8, 1);
+  const auto *desc =
+      static_cast<const RawMemRefDescriptor<char> *>(memref.descriptor);
+  const intptr_t *sizes = desc->sizesAndStrides;
+  record.sizes.assign(sizes, sizes + record.rank);
+  copyMemRefElements(desc->aligned + desc->offset * elemSize, record.rank,
+                     sizes, sizes + record.rank, elemSize, record.data);
+  PrintBuffers::get().add(std::move(record));
 }
 
+// Write prints recorded since the last flush, ordered by program id. Called
+// by launchers when programs of a launch are done.
+EXPORT void triton_cpu_print_flush() { PrintBuffers::get().flush(); }
+
 } // extern "C"
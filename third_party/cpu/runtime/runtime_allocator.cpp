@@ -0,0 +1,213 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+extern "C" int32_t triton_cpu_get_num_numa_nodes();
+
+namespace {
+
+constexpr size_t HUGE_PAGE_SIZE_2M = size_t(2) << 20;
+constexpr size_t HUGE_PAGE_SIZE_1G = size_t(1) << 30;
+
+size_t basePageSize() {
+#if defined(__linux__) || defined(__APPLE__)
+  static const size_t size = sysconf(_SC_PAGESIZE);
+  return size;
+#else
+  return 4096;
+#endif
+}
+
+size_t roundUp(size_t size, size_t alignment) {
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+struct Allocation {
+  size_t size;
+  // Size of hugetlbfs pages backing the allocation, or the base page size.
+  size_t pageSize;
+};
+
+// Allocations by their addresses, so they are freed by address only.
+class Allocations {
+public:
+  static Allocations &get() {
+    static Allocations allocations;
+    return allocations;
+  }
+
+  void add(void *ptr, Allocation allocation) {
+    std::lock_guard<std::mutex> lock(mutex);
+    allocations[ptr] = allocation;
+  }
+
+  bool remove(void *ptr, Allocation &allocation) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = allocations.find(ptr);
+    if (it == allocations.end())
+      return false;
+    allocation = it->second;
+    allocations.erase(it);
+    return true;
+  }
+
+  size_t pageSize(const void *ptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = allocations.find(const_cast<void *>(ptr));
+    return it == allocations.end() ? 0 : it->second.pageSize;
+  }
+
+private:
+  std::mutex mutex;
+  std::unordered_map<void *, Allocation> allocations;
+};
+
+#if defined(__linux__) || defined(__APPLE__)
+// Map size bytes from pages of the hugetlbfs pool, which has to be reserved
+// by the administrator, e.g. through /proc/sys/vm/nr_hugepages.
+void *mapHugeTlb(size_t size, size_t pageSize) {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+  int shift = pageSize == HUGE_PAGE_SIZE_1G ? 30 : 21;
+  void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                       (shift << MAP_HUGE_SHIFT),
+                   -1, 0);
+  return ptr == MAP_FAILED ? nullptr : ptr;
+#else
+  return nullptr;
+#endif
+}
+
+// Map size bytes aligned to alignment. Maps extra alignment bytes and trims
+// the mapping, so the result can be backed by transparent huge pages.
+void *mapAligned(size_t size, size_t alignment) {
+  size_t mapSize = size + alignment;
+  void *mapped = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED)
+    return nullptr;
+  uintptr_t begin = reinterpret_cast<uintptr_t>(mapped);
+  uintptr_t aligned = roundUp(begin, alignment);
+  if (aligned > begin)
+    munmap(mapped, aligned - begin);
+  size_t tail = begin + mapSize - (aligned + size);
+  if (tail)
+    munmap(reinterpret_cast<void *>(aligned + size), tail);
+  return reinterpret_cast<void *>(aligned);
+}
+
+// Interleave pages of the mapping between all NUMA nodes. Pages are placed
+// when they are first touched, so this has to precede any access.
+void interleavePages(void *ptr, size_t size) {
+#if defined(__linux__) && defined(SYS_mbind)
+  // Value from linux/mempolicy.h.
+  constexpr int MPOL_INTERLEAVE = 3;
+  int numNodes = triton_cpu_get_num_numa_nodes();
+  if (numNodes < 2)
+    return;
+  constexpr int BITS = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> mask((numNodes + BITS - 1) / BITS);
+  for (int node = 0; node < numNodes; ++node)
+    mask[node / BITS] |= 1UL << (node % BITS);
+  syscall(SYS_mbind, ptr, size, MPOL_INTERLEAVE, mask.data(),
+          mask.size() * BITS + 1, 0);
+#endif
+}
+#endif
+
+} // namespace
+
+extern "C" {
+
+// Allocate a zeroed buffer of at least size bytes aligned to page_size.
+// page_size is 2M or 1G to back the buffer with huge pages, which cuts TLB
+// misses of kernels streaming through large tensors, else base pages are
+// used. Huge pages come from the hugetlbfs pool when it has enough reserved
+// pages, otherwise 1G pages fall back to 2M ones and those to transparent
+// huge pages, which the kernel provides on a best-effort basis. With
+// interleave set, pages are spread round-robin across NUMA nodes, so threads
+// of all nodes share the memory bandwidth of all nodes. Return nullptr on
+// failure.
+EXPORT void *triton_cpu_alloc(size_t size, size_t page_size, bool interleave) {
+  if (size == 0)
+    size = 1;
+#if defined(__linux__) || defined(__APPLE__)
+  void *ptr = nullptr;
+  Allocation allocation{0, basePageSize()};
+  for (size_t hugePageSize : {HUGE_PAGE_SIZE_1G, HUGE_PAGE_SIZE_2M}) {
+    if (page_size < hugePageSize)
+      continue;
+    allocation.size = roundUp(size, hugePageSize);
+    ptr = mapHugeTlb(allocation.size, hugePageSize);
+    if (ptr) {
+      allocation.pageSize = hugePageSize;
+      break;
+    }
+  }
+  if (!ptr) {
+    size_t alignment =
+        page_size >= HUGE_PAGE_SIZE_2M ? HUGE_PAGE_SIZE_2M : basePageSize();
+    allocation.size = roundUp(size, alignment);
+    ptr = mapAligned(allocation.size, alignment);
+    if (!ptr)
+      return nullptr;
+#if defined(MADV_HUGEPAGE)
+    if (page_size >= HUGE_PAGE_SIZE_2M)
+      madvise(ptr, allocation.size, MADV_HUGEPAGE);
+#endif
+  }
+  if (interleave)
+    interleavePages(ptr, allocation.size);
+#else
+  size_t alignment = page_size >= HUGE_PAGE_SIZE_2M ? HUGE_PAGE_SIZE_2M : 4096;
+  Allocation allocation{roundUp(size, alignment), 4096};
+  void *ptr = std::aligned_alloc(alignment, allocation.size);
+  if (!ptr)
+    return nullptr;
+  std::memset(ptr, 0, allocation.size);
+#endif
+  Allocations::get().add(ptr, allocation);
+  return ptr;
+}
+
+// Free a buffer allocated by triton_cpu_alloc.
+EXPORT void triton_cpu_free(void *ptr) {
+  Allocation allocation;
+  if (!ptr || !Allocations::get().remove(ptr, allocation))
+    return;
+#if defined(__linux__) || defined(__APPLE__)
+  munmap(ptr, allocation.size);
+#else
+  std::free(ptr);
+#endif
+}
+
+// Return the size of hugetlbfs pages backing a buffer allocated by
+// triton_cpu_alloc, the base page size if it isn't backed by them, or zero
+// if the buffer isn't allocated by triton_cpu_alloc.
+EXPORT size_t triton_cpu_alloc_page_size(const void *ptr) {
+  return Allocations::get().pageSize(ptr);
+}
+
+} // extern "C"
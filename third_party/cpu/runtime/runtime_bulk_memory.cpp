@@ -0,0 +1,184 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#if defined(__GNUC__)
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+// Copies and fills of at least this many bytes use non-temporal stores, so
+// that streaming them doesn't evict the working set of other threads from
+// shared caches. 4M by default, set by TRITON_CPU_BULK_NT_THRESHOLD in bytes
+// with an optional K, M or G suffix.
+size_t nontemporalThreshold() {
+  static const size_t size = []() -> size_t {
+    const char *env = std::getenv("TRITON_CPU_BULK_NT_THRESHOLD");
+    if (!env || !*env)
+      return 4 << 20;
+    char *end;
+    size_t value = std::strtoull(env, &end, 10);
+    switch (*end) {
+    case 'G':
+    case 'g':
+      return value << 30;
+    case 'M':
+    case 'm':
+      return value << 20;
+    case 'K':
+    case 'k':
+      return value << 10;
+    default:
+      return value;
+    }
+  }();
+  return size;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Enhanced rep movsb makes a single instruction the fastest copy of sizes
+// that stay in caches.
+bool hasErms() {
+#if defined(__GNUC__)
+  static const bool erms = []() {
+    unsigned eax, ebx, ecx, edx;
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+           (ebx & (1u << 9));
+  }();
+  return erms;
+#else
+  return false;
+#endif
+}
+
+void repMovsb(char *dst, const char *src, size_t size) {
+#if defined(__GNUC__)
+  asm volatile("rep movsb" : "+D"(dst), "+S"(src), "+c"(size) : : "memory");
+#else
+  std::memcpy(dst, src, size);
+#endif
+}
+
+// Number of bytes before the next 16-byte boundary of the pointer.
+size_t headBytes(const char *ptr, size_t size) {
+  size_t head = -reinterpret_cast<uintptr_t>(ptr) & 15;
+  return head < size ? head : size;
+}
+
+void streamCopy(char *dst, const char *src, size_t size) {
+  size_t head = headBytes(dst, size);
+  std::memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  size -= head;
+  for (; size >= 64; dst += 64, src += 64, size -= 64) {
+    auto *from = reinterpret_cast<const __m128i *>(src);
+    auto *to = reinterpret_cast<__m128i *>(dst);
+    __m128i v0 = _mm_loadu_si128(from);
+    __m128i v1 = _mm_loadu_si128(from + 1);
+    __m128i v2 = _mm_loadu_si128(from + 2);
+    __m128i v3 = _mm_loadu_si128(from + 3);
+    _mm_stream_si128(to, v0);
+    _mm_stream_si128(to + 1, v1);
+    _mm_stream_si128(to + 2, v2);
+    _mm_stream_si128(to + 3, v3);
+  }
+  for (; size >= 16; dst += 16, src += 16, size -= 16)
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst),
+                     _mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+  std::memcpy(dst, src, size);
+  // Make streamed stores visible before the program finishes.
+  _mm_sfence();
+}
+
+// The pattern repeats elements of a size dividing 8, and dst is aligned to
+// elements, so each 16-byte vector of it starts at an element.
+void streamFill(char *dst, uint64_t pattern, size_t size) {
+  const uint64_t vec[2] = {pattern, pattern};
+  size_t head = headBytes(dst, size);
+  std::memcpy(dst, vec, head);
+  dst += head;
+  size -= head;
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(vec));
+  for (; size >= 16; dst += 16, size -= 16)
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst), v);
+  std::memcpy(dst, vec, size);
+  _mm_sfence();
+}
+#endif
+
+// Repeat the low elemSize bytes of the value over 8 bytes.
+uint64_t replicate(uint64_t value, int32_t elemSize) {
+  for (int32_t bytes = elemSize; bytes < 8; bytes *= 2)
+    value |= value << (bytes * 8);
+  return value;
+}
+
+} // namespace
+
+extern "C" {
+
+// Copy size bytes from src to dst for triton_cpu.bulk_copy. Ranges may
+// overlap, since the op replaces a load of the whole block followed by a
+// store. Large copies, or all copies with nontemporal, bypass caches with
+// streaming stores on x86, and cached ones use rep movsb where it is fast.
+EXPORT void triton_cpu_bulk_copy(void *dst, const void *src, int64_t size,
+                                 int32_t nontemporal) {
+  if (size <= 0 || dst == src)
+    return;
+  auto *to = static_cast<char *>(dst);
+  auto *from = static_cast<const char *>(src);
+  size_t bytes = static_cast<size_t>(size);
+  if (to < from + bytes && from < to + bytes) {
+    std::memmove(to, from, bytes);
+    return;
+  }
+#if defined(__x86_64__) || defined(__i386__)
+  if (nontemporal || bytes >= nontemporalThreshold())
+    return streamCopy(to, from, bytes);
+  if (hasErms())
+    return repMovsb(to, from, bytes);
+#endif
+  std::memcpy(to, from, bytes);
+}
+
+// Store count elements of elem_size bytes holding the low bytes of value
+// from dst for triton_cpu.bulk_fill. Values of equal bytes, e.g. zeros, are
+// set by memset unless they are streamed like large copies.
+EXPORT void triton_cpu_bulk_fill(void *dst, uint64_t value, int32_t elem_size,
+                                 int64_t count, int32_t nontemporal) {
+  if (count <= 0)
+    return;
+  auto *to = static_cast<char *>(dst);
+  size_t bytes = static_cast<size_t>(count) * elem_size;
+  // Targets are little-endian, so the pattern starts with the low bytes.
+  uint64_t pattern = replicate(value, elem_size);
+#if defined(__x86_64__) || defined(__i386__)
+  bool stream = nontemporal || bytes >= nontemporalThreshold();
+  if (stream && reinterpret_cast<uintptr_t>(to) % elem_size == 0)
+    return streamFill(to, pattern, bytes);
+#endif
+  if (pattern == replicate(pattern & 0xff, 1)) {
+    std::memset(to, static_cast<int>(pattern & 0xff), bytes);
+    return;
+  }
+  size_t offset = 0;
+  for (; offset + 8 <= bytes; offset += 8)
+    std::memcpy(to + offset, &pattern, 8);
+  std::memcpy(to + offset, &pattern, bytes - offset);
+}
+
+} // extern "C"
@@ -0,0 +1,61 @@
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+// Cache line size of all supported targets.
+constexpr uintptr_t CACHE_LINE_SIZE = 64;
+
+inline void flushLine(const char *ptr) {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_clflush(ptr);
+#elif defined(__aarch64__)
+  // Clean and invalidate to the point of coherency.
+  asm volatile("dc civac, %0" : : "r"(ptr) : "memory");
+#else
+  (void)ptr;
+#endif
+}
+
+inline void flushFence() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_mfence();
+#elif defined(__aarch64__)
+  asm volatile("dsb ish" : : : "memory");
+#endif
+}
+
+} // namespace
+
+extern "C" {
+
+// Evict the cache lines of [ptr, ptr + size) from all cache levels, so the
+// next access reads memory. Flushing only the ranges a kernel accesses is
+// much cheaper than overwriting a buffer larger than the LLC. Return false if
+// the target has no user-space cache flush instruction.
+EXPORT bool triton_cpu_flush_cache(const void *ptr, size_t size) {
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+  uintptr_t begin = reinterpret_cast<uintptr_t>(ptr) & ~(CACHE_LINE_SIZE - 1);
+  uintptr_t end = reinterpret_cast<uintptr_t>(ptr) + size;
+  for (uintptr_t line = begin; line < end; line += CACHE_LINE_SIZE)
+    flushLine(reinterpret_cast<const char *>(line));
+  flushFence();
+  return true;
+#else
+  return false;
+#endif
+}
+
+} // extern "C"
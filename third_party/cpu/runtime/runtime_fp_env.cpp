@@ -0,0 +1,78 @@
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+#if defined(__x86_64__) || defined(_M_X64)
+// Flush-to-zero and denormals-are-zero bits of MXCSR.
+constexpr uint32_t MXCSR_FTZ = 1u << 15;
+constexpr uint32_t MXCSR_DAZ = 1u << 6;
+// Sticky exception flags of MXCSR, which are set by kernels and kept when the
+// control bits are restored.
+constexpr uint32_t MXCSR_FLAGS = 0x3f;
+#elif defined(__aarch64__)
+// Flush-to-zero bit of FPCR, which also flushes denormal inputs.
+constexpr uint64_t FPCR_FZ = uint64_t(1) << 24;
+
+uint64_t getFpcr() {
+  uint64_t fpcr;
+  asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+  return fpcr;
+}
+
+void setFpcr(uint64_t fpcr) { asm volatile("msr fpcr, %0" : : "r"(fpcr)); }
+#endif
+
+} // namespace
+
+extern "C" {
+
+// Flush denormal results to zero and treat denormal inputs as zero on the
+// calling thread, which avoids the microcode assists that slow down
+// operations on denormals by orders of magnitude. Return the previous state
+// of the floating-point environment for triton_cpu_restore_fp_env.
+EXPORT uint64_t triton_cpu_flush_denormals() {
+#if defined(__x86_64__) || defined(_M_X64)
+  uint32_t mxcsr = _mm_getcsr();
+  if ((mxcsr & (MXCSR_FTZ | MXCSR_DAZ)) != (MXCSR_FTZ | MXCSR_DAZ))
+    _mm_setcsr(mxcsr | MXCSR_FTZ | MXCSR_DAZ);
+  return mxcsr;
+#elif defined(__aarch64__)
+  uint64_t fpcr = getFpcr();
+  if (!(fpcr & FPCR_FZ))
+    setFpcr(fpcr | FPCR_FZ);
+  return fpcr;
+#else
+  return 0;
+#endif
+}
+
+// Restore the state returned by triton_cpu_flush_denormals. Only control
+// bits, e.g. rounding and denormal modes, are restored, so exceptions raised
+// by kernels stay visible to the caller, e.g. to fetestexcept. FPCR has no
+// exception flags, they are in FPSR.
+EXPORT void triton_cpu_restore_fp_env(uint64_t state) {
+#if defined(__x86_64__) || defined(_M_X64)
+  uint32_t cur = _mm_getcsr();
+  uint32_t mxcsr =
+      (static_cast<uint32_t>(state) & ~MXCSR_FLAGS) | (cur & MXCSR_FLAGS);
+  if (cur != mxcsr)
+    _mm_setcsr(mxcsr);
+#elif defined(__aarch64__)
+  if (getFpcr() != state)
+    setFpcr(state);
+#endif
+}
+
+} // extern "C"
@@ -0,0 +1,75 @@
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/TargetParser/Host.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <asm/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+const llvm::StringMap<bool> &getHostFeatures() {
+  static const llvm::StringMap<bool> features = llvm::sys::getHostCPUFeatures();
+  return features;
+}
+
+// AMX requires the process to request the extended XSTATE, see enable_amx in
+// triton_cpu.cc. Libraries loaded ahead of time can't rely on the compiler
+// having done it.
+bool enableAmx() {
+#if defined(__linux__) && defined(ARCH_REQ_XCOMP_PERM)
+  static const bool enabled = []() {
+    constexpr int XFEATURE_XTILEDATA = 18;
+    return syscall(SYS_arch_prctl, ARCH_REQ_XCOMP_PERM, XFEATURE_XTILEDATA) ==
+           0;
+  }();
+  return enabled;
+#else
+  return false;
+#endif
+}
+
+} // namespace
+
+extern "C" {
+
+// Return true if the host supports all features of a comma-separated list of
+// LLVM feature names, e.g. "avx512f,avx512bw". ISA variants of kernels call
+// it to select the variant to run when they are loaded.
+EXPORT bool triton_cpu_isa_supported(const char *features) {
+  const auto &host = getHostFeatures();
+  llvm::SmallVector<llvm::StringRef> required;
+  llvm::StringRef(features).split(required, ',', -1, /*KeepEmpty=*/false);
+  for (llvm::StringRef feature : required) {
+    auto it = host.find(feature);
+    if (it == host.end() || !it->second)
+      return false;
+    if (feature == "amx-tile" && !enableAmx())
+      return false;
+  }
+  return true;
+}
+
+// Called when a kernel has no ISA variant supported by the host.
+EXPORT void triton_cpu_isa_unsupported(const char *kernel) {
+  std::fprintf(stderr,
+               "Kernel %s has no ISA variant supported by the host CPU, "
+               "recompile it with a lower ISA in isa_variants.\n",
+               kernel);
+  std::abort();
+}
+
+} // extern "C"
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include "runtime_perf_counters.h"
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+// Default number of records kept by the launch trace.
+constexpr size_t DEFAULT_TRACE_SIZE = 1 << 14;
+
+// A launch as seen by readers of the trace. Keep in sync with
+// LaunchRecord in driver.py.
+struct LaunchRecord {
+  // Kernel entry point, null for batches of launches.
+  const void *kernel;
+  // Correlation id of the submitting thread at the time of the launch, see
+  // triton_cpu_launch_trace_set_correlation_id.
+  uint64_t correlation_id;
+  // Steady clock timestamps of the launch start and end in nanoseconds.
+  int64_t start_ns;
+  int64_t end_ns;
+  uint64_t num_programs;
+  uint32_t grid_x;
+  uint32_t grid_y;
+  uint32_t grid_z;
+  int32_t num_threads;
+  // Hardware event counts of the launch summed over its threads, see
+  // triton_cpu_perf_enable. Zero num_counters means counts are unavailable.
+  int32_t num_counters;
+  uint64_t counters[MAX_PERF_COUNTERS];
+};
+
+thread_local uint64_t correlationId = 0;
+
+// Lock-free ring buffer of launch records. Writers take consecutive record
+// indices and publish each record with a sequence number, so readers can
+// detect records that are being written or were already overwritten without
+// blocking writers.
+class LaunchTrace {
+public:
+  static LaunchTrace &get() {
+    static LaunchTrace trace(traceSize());
+    return trace;
+  }
+
+  std::atomic<bool> enabled{false};
+
+  void record(const LaunchRecord &rec) {
+    uint64_t idx = head.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = slots[idx & mask];
+    slot.seq.store(2 * idx + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.kernel.store(rec.kernel, std::memory_order_relaxed);
+    slot.correlationId.store(rec.correlation_id, std::memory_order_relaxed);
+    slot.startNs.store(rec.start_ns, std::memory_order_relaxed);
+    slot.endNs.store(rec.end_ns, std::memory_order_relaxed);
+    slot.numPrograms.store(rec.num_programs, std::memory_order_relaxed);
+    slot.gridX.store(rec.grid_x, std::memory_order_relaxed);
+    slot.gridY.store(rec.grid_y, std::memory_order_relaxed);
+    slot.gridZ.store(rec.grid_z, std::memory_order_relaxed);
+    slot.numThreads.store(rec.num_threads, std::memory_order_relaxed);
+    slot.numCounters.store(rec.num_counters, std::memory_order_relaxed);
+    for (int i = 0; i < rec.num_counters; ++i)
+      slot.counters[i].store(rec.counters[i], std::memory_order_relaxed);
+    slot.seq.store(2 * idx + 2, std::memory_order_release);
+  }
+
+  uint64_t position() const { return head.load(std::memory_order_acquire); }
+
+  // Copy up to maxRecords records starting from *cursor and advance the
+  // cursor past them. Records that were overwritten or are still being
+  // written are skipped.
+  size_t read(uint64_t *cursor, LaunchRecord *out, size_t maxRecords) const {
+    uint64_t end = position();
+    uint64_t idx = std::max(*cursor, end > size() ? end - size() : 0);
+    size_t count = 0;
+    for (; idx < end && count < maxRecords; ++idx) {
+      const Slot &slot = slots[idx & mask];
+      if (slot.seq.load(std::memory_order_acquire) != 2 * idx + 2)
+        continue;
+      LaunchRecord rec;
+      rec.kernel = slot.kernel.load(std::memory_order_relaxed);
+      rec.correlation_id = slot.correlationId.load(std::memory_order_relaxed);
+      rec.start_ns = slot.startNs.load(std::memory_order_relaxed);
+      rec.end_ns = slot.endNs.load(std::memory_order_relaxed);
+      rec.num_programs = slot.numPrograms.load(std::memory_order_relaxed);
+      rec.grid_x = slot.gridX.load(std::memory_order_relaxed);
+      rec.grid_y = slot.gridY.load(std::memory_order_relaxed);
+      rec.grid_z = slot.gridZ.load(std::memory_order_relaxed);
+      rec.num_threads = slot.numThreads.load(std::memory_order_relaxed);
+      rec.num_counters = std::clamp(
+          slot.numCounters.load(std::memory_order_relaxed), 0,
+          MAX_PERF_COUNTERS);
+      for (int i = 0; i < MAX_PERF_COUNTERS; ++i)
+        rec.counters[i] = i < rec.num_counters
+                              ? slot.counters[i].load(std::memory_order_relaxed)
+                              : 0;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) != 2 * idx + 2)
+        continue;
+      out[count++] = rec;
+    }
+    *cursor = idx;
+    return count;
+  }
+
+  size_t size() const { return mask + 1; }
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> seq{0};
+    std::atomic<const void *> kernel{nullptr};
+    std::atomic<uint64_t> correlationId{0};
+    std::atomic<int64_t> startNs{0};
+    std::atomic<int64_t> endNs{0};
+    std::atomic<uint64_t> numPrograms{0};
+    std::atomic<uint32_t> gridX{0};
+    std::atomic<uint32_t> gridY{0};
+    std::atomic<uint32_t> gridZ{0};
+    std::atomic<int32_t> numThreads{0};
+    std::atomic<int32_t> numCounters{0};
+    std::atomic<uint64_t> counters[MAX_PERF_COUNTERS] = {};
+  };
+
+  // The number of records rounded up to a power of two.
+  static size_t traceSize() {
+    const char *env = std::getenv("TRITON_CPU_LAUNCH_TRACE_SIZE");
+    long long requested = env ? std::atoll(env) : 0;
+    size_t size = requested > 0 ? static_cast<size_t>(requested)
+                                : DEFAULT_TRACE_SIZE;
+    size_t res = 1;
+    while (res < size)
+      res <<= 1;
+    return res;
+  }
+
+  explicit LaunchTrace(size_t size) : mask(size - 1), slots(new Slot[size]) {}
+
+  const size_t mask;
+  std::unique_ptr<Slot[]> slots;
+  std::atomic<uint64_t> head{0};
+};
+
+} // namespace
+
+extern "C" {
+
+// Start or stop recording launches into the launch trace.
+EXPORT void triton_cpu_launch_trace_enable(bool enable) {
+  LaunchTrace::get().enabled.store(enable, std::memory_order_relaxed);
+}
+
+EXPORT bool triton_cpu_launch_trace_enabled() {
+  return LaunchTrace::get().enabled.load(std::memory_order_relaxed);
+}
+
+// Return the current steady clock time in nanoseconds, the clock of launch
+// trace timestamps.
+EXPORT int64_t triton_cpu_launch_trace_now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Set the correlation id of launches submitted by the calling thread, zero to
+// not correlate them. Profilers use it to attribute launches to their scopes.
+EXPORT void triton_cpu_launch_trace_set_correlation_id(uint64_t id) {
+  correlationId = id;
+}
+
+EXPORT uint64_t triton_cpu_launch_trace_get_correlation_id() {
+  return correlationId;
+}
+
+// Append a launch to the trace. Launchers call it for every launch while the
+// trace is enabled. counters holds num_counters hardware event counts of the
+// launch, it can be null if num_counters is zero.
+EXPORT void triton_cpu_launch_trace_record(
+    const void *kernel, uint64_t correlation_id, int64_t start_ns,
+    int64_t end_ns, uint32_t grid_x, uint32_t grid_y, uint32_t grid_z,
+    int32_t num_threads, const uint64_t *counters, int32_t num_counters) {
+  LaunchRecord rec;
+  rec.kernel = kernel;
+  rec.correlation_id = correlation_id;
+  rec.start_ns = start_ns;
+  rec.end_ns = end_ns;
+  rec.num_programs = static_cast<uint64_t>(grid_x) * grid_y * grid_z;
+  rec.grid_x = grid_x;
+  rec.grid_y = grid_y;
+  rec.grid_z = grid_z;
+  rec.num_threads = num_threads;
+  rec.num_counters =
+      counters ? std::clamp(num_counters, 0, MAX_PERF_COUNTERS) : 0;
+  std::memset(rec.counters, 0, sizeof(rec.counters));
+  std::copy(counters, counters + rec.num_counters, rec.counters);
+  LaunchTrace::get().record(rec);
+}
+
+// Return the total number of records appended to the trace. It can be used as
+// the initial cursor of triton_cpu_launch_trace_read to skip older records.
+EXPORT uint64_t triton_cpu_launch_trace_position() {
+  return LaunchTrace::get().position();
+}
+
+// Copy up to max_records records starting from index *cursor into out and
+// advance the cursor. Only the last triton_cpu_launch_trace_size() records
+// are kept, older ones are skipped. Each reader, e.g. Python benchmarking
+// utilities or a profiler, keeps its own cursor. Return the number of copied
+// records.
+EXPORT size_t triton_cpu_launch_trace_read(uint64_t *cursor, LaunchRecord *out,
+                                           size_t max_records) {
+  return LaunchTrace::get().read(cursor, out, max_records);
+}
+
+EXPORT size_t triton_cpu_launch_trace_size() {
+  return LaunchTrace::get().size();
+}
+
+} // extern "C"
@@ -0,0 +1,169 @@
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+enum class Advice {
+  WillNeed,
+  Cold,
+};
+
+struct Region {
+  uintptr_t begin;
+  size_t size;
+};
+
+size_t pageSize() {
+#if defined(__linux__) || defined(__APPLE__)
+  static const size_t size = sysconf(_SC_PAGESIZE);
+  return size;
+#else
+  return 4096;
+#endif
+}
+
+// Advise the kernel about [begin, end), rounded out to pages. Errors, e.g.
+// for memory that isn't mapped from a file, are ignored since advice is
+// only a hint.
+void advise(uintptr_t begin, uintptr_t end, Advice advice) {
+#if defined(__linux__) || defined(__APPLE__)
+  uintptr_t mask = pageSize() - 1;
+  begin &= ~mask;
+  end = (end + mask) & ~mask;
+  if (begin >= end)
+    return;
+  void *addr = reinterpret_cast<void *>(begin);
+  switch (advice) {
+  case Advice::WillNeed:
+    madvise(addr, end - begin, MADV_WILLNEED);
+    break;
+  case Advice::Cold:
+    // Unlike MADV_DONTNEED, MADV_COLD keeps the contents of private and
+    // anonymous memory, it only makes finished pages the first to reclaim.
+#if defined(MADV_COLD)
+    madvise(addr, end - begin, MADV_COLD);
+#endif
+    break;
+  }
+#endif
+}
+
+// Issues memory advice for slices of the regions accessed by an out-of-core
+// launch on a helper thread, so that reading ahead the next slice overlaps
+// with running kernels on the current one. Slice i of a region is the i-th of
+// num_slices equal byte ranges, which programs of the i-th slice of the grid
+// access when they traverse the region linearly.
+class SliceAdvisor {
+public:
+  SliceAdvisor(std::vector<Region> regions, size_t num_slices)
+      : regions(std::move(regions)), num_slices(num_slices),
+        worker([this] { run(); }) {}
+
+  ~SliceAdvisor() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cv.notify_one();
+    worker.join();
+  }
+
+  void enqueue(size_t slice, Advice advice) {
+    if (slice >= num_slices)
+      return;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      requests.push_back({slice, advice});
+    }
+    cv.notify_one();
+  }
+
+private:
+  struct Request {
+    size_t slice;
+    Advice advice;
+  };
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      cv.wait(lock, [this] { return stop || !requests.empty(); });
+      if (requests.empty())
+        return;
+      Request request = requests.front();
+      requests.pop_front();
+      lock.unlock();
+      for (const Region &region : regions) {
+        uintptr_t begin =
+            region.begin + region.size * request.slice / num_slices;
+        uintptr_t end =
+            region.begin + region.size * (request.slice + 1) / num_slices;
+        advise(begin, end, request.advice);
+      }
+      lock.lock();
+    }
+  }
+
+  std::vector<Region> regions;
+  size_t num_slices;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<Request> requests;
+  bool stop = false;
+  std::thread worker;
+};
+
+} // namespace
+
+extern "C" {
+
+// Create an advisor for an out-of-core launch over num_regions regions given
+// by their pointers and sizes in bytes, split into num_slices slices.
+EXPORT void *triton_cpu_slice_advisor_create(const void *const *ptrs,
+                                             const size_t *sizes,
+                                             int32_t num_regions,
+                                             size_t num_slices) {
+  std::vector<Region> regions;
+  for (int32_t i = 0; i < num_regions; ++i)
+    regions.push_back({reinterpret_cast<uintptr_t>(ptrs[i]), sizes[i]});
+  return new SliceAdvisor(std::move(regions), num_slices);
+}
+
+// Called before programs of the slice run, and with slice num_slices after
+// the last one. Asks the kernel to read ahead the next slice and to reclaim
+// the previous one first under memory pressure. The first slice is read
+// ahead as well, so its reads are sequential too.
+EXPORT void triton_cpu_slice_advisor_begin(void *advisor, size_t slice) {
+  auto *slice_advisor = static_cast<SliceAdvisor *>(advisor);
+  if (slice == 0)
+    slice_advisor->enqueue(0, Advice::WillNeed);
+  slice_advisor->enqueue(slice + 1, Advice::WillNeed);
+  if (slice > 0)
+    slice_advisor->enqueue(slice - 1, Advice::Cold);
+}
+
+// Wait for pending advice and destroy the advisor.
+EXPORT void triton_cpu_slice_advisor_destroy(void *advisor) {
+  delete static_cast<SliceAdvisor *>(advisor);
+}
+
+} // extern "C"
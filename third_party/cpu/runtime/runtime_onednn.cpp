@@ -1,4 +1,5 @@
 #if defined(ONEDNN_AVAILABLE)
+#include "oneapi/dnnl/dnnl.hpp"
 #include "oneapi/dnnl/dnnl_types.h"
 #include "oneapi/dnnl/dnnl_ukernel.hpp"
 #include "oneapi/dnnl/dnnl_ukernel_types.h"
@@ -7,15 +8,24 @@
 #endif
 #endif
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <future>
 #include <iostream>
-#include <map>
+#include <list>
+#include <memory>
 #include <mutex>
-#include <shared_mutex>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
+#include "runtime_onednn.h"
+#include "runtime_stats.h"
+
 #if defined(_MSC_VER)
 #define EXPORT __declspec(dllexport)
 #elif defined(__GNUC__)
@@ -29,10 +39,6 @@ using namespace dnnl;
 using namespace dnnl::ukernel;
 #endif
 
-using read_lock_guard_t = std::shared_lock<std::shared_mutex>;
-using write_lock_guard_t = std::unique_lock<std::shared_mutex>;
-static std::shared_mutex g_brgemm_lock;
-
 extern "C" {
 
 struct onednn_handle {
@@ -40,26 +46,111 @@ struct onednn_handle {
   dnnl::ukernel::brgemm brg;
 };
 
-EXPORT void *create_brgemm(int64_t M, int64_t N, int64_t K_k,
-                           int64_t batch_size, int64_t lda, int64_t ldb,
-                           int64_t ldc, int64_t dtypeA, int64_t dtypeB,
-                           int64_t dtypeC, bool skip_packing) {
-  using KeyT = std::array<int64_t, 10>;
-  KeyT key{M, N, K_k, batch_size, lda, ldb, ldc, dtypeA, dtypeB, dtypeC};
+} // extern C
+
+namespace {
 
-  static std::map<KeyT, onednn_handle> savedUkernels;
-  {
-    read_lock_guard_t r_g(g_brgemm_lock);
-    if (savedUkernels.count(key) != 0) {
-      return &savedUkernels.find(key)->second;
-    }
+// create_brgemm arguments: 11 GEMM parameters, ldd, dtypeD, and a triple of
+// algorithm kind, alpha and beta for each post-op slot.
+using KeyT = std::array<int64_t, 13 + 3 * BRGEMM_MAX_POST_OPS>;
+
+struct KeyHash {
+  size_t operator()(const KeyT &key) const {
+    size_t res = 0;
+    for (int64_t val : key)
+      res ^= std::hash<int64_t>{}(val) + 0x9e3779b97f4a7c15ULL + (res << 6) +
+             (res >> 2);
+    return res;
   }
+};
+
+// Handles returned by create_brgemm are cache entries. Kernels on all threads
+// ask for the same few handles, so the global cache is split into shards with
+// separate locks, and each thread additionally caches entries and generated
+// code it already got without locking. A lock is only held to find or insert
+// an entry, and the JIT runs outside of it. Other threads requesting the same
+// code wait for it.
+//
+// Shapes may be dynamic, so the amount of generated code is bounded by a
+// capacity of entries with code. Over the capacity, the code of the least
+// recently generated entry that wasn't used since the previous eviction check
+// is released, i.e. last uses are approximated with a second chance (CLOCK)
+// policy that doesn't require locking on uses. Entries are never removed, so
+// handles cached by kernels stay valid, and released code is generated again
+// on the next use. Threads executing released code keep it alive through
+// shared_ptr copies until they see the eviction.
+struct CachedHandle {
+  KeyT key;
+  // Generated code, null when not generated yet or released.
+  std::shared_ptr<const onednn_handle> impl;
+  // Valid while a thread generates the code.
+  std::shared_future<void> pending;
+  // Set on uses, cleared by eviction checks.
+  std::atomic<bool> used{false};
+};
+
+struct HandleCacheShard {
+  std::mutex lock;
+  std::unordered_map<KeyT, std::unique_ptr<CachedHandle>, KeyHash> handles;
+  // Entries with generated code, most recently generated or spared first.
+  std::list<CachedHandle *> generated;
+};
 
-  write_lock_guard_t w_g(g_brgemm_lock);
+constexpr size_t numHandleCacheShards = 16;
+HandleCacheShard g_brgemm_cache[numHandleCacheShards];
 
-  if (savedUkernels.count(key) != 0) {
-    return &savedUkernels.find(key)->second;
+constexpr int64_t defaultHandleCacheCapacity = 1024;
+
+int64_t getCapacityEnv() {
+  const char *env = std::getenv("TRITON_CPU_UKERNEL_CACHE_CAPACITY");
+  return env ? std::max<int64_t>(std::atoll(env), 0)
+             : defaultHandleCacheCapacity;
+}
+
+// Maximum number of entries with generated code, 0 means unbounded.
+std::atomic<int64_t> g_capacity{getCapacityEnv()};
+std::atomic<uint64_t> g_hits{0};
+std::atomic<uint64_t> g_misses{0};
+std::atomic<uint64_t> g_evictions{0};
+
+HandleCacheShard &getShard(const KeyT &key) {
+  return g_brgemm_cache[KeyHash{}(key) % numHandleCacheShards];
+}
+
+// Release code of entries over the shard's part of the capacity. Must be
+// called with the shard lock held.
+void evictOverCapacity(HandleCacheShard &shard) {
+  int64_t capacity = g_capacity.load(std::memory_order_relaxed);
+  if (capacity <= 0)
+    return;
+  size_t shardCapacity =
+      (capacity + numHandleCacheShards - 1) / numHandleCacheShards;
+  while (shard.generated.size() > shardCapacity) {
+    CachedHandle *victim = shard.generated.back();
+    shard.generated.pop_back();
+    if (victim->used.exchange(false, std::memory_order_relaxed)) {
+      shard.generated.push_front(victim);
+      continue;
+    }
+    victim->impl.reset();
+    g_evictions.fetch_add(1, std::memory_order_release);
   }
+}
+
+// Post-op alpha and beta parameters are passed as bits of f32 values.
+float getPostOpParam(int64_t bits) {
+  uint32_t val = static_cast<uint32_t>(bits);
+  float res;
+  std::memcpy(&res, &val, sizeof(res));
+  return res;
+}
+
+std::shared_ptr<const onednn_handle> generate_brgemm(const KeyT &key) {
+  int64_t M = key[0], N = key[1], K_k = key[2], batch_size = key[3];
+  int64_t lda = key[4], ldb = key[5], ldc = key[6];
+  int64_t dtypeA = key[7], dtypeB = key[8], dtypeC = key[9];
+  bool skip_packing = key[10] != 0;
+  int64_t ldd = key[11], dtypeD = key[12];
 
   auto dnnl_dtypeA = static_cast<dnnl::memory::data_type>(dtypeA);
   auto dnnl_dtypeB = static_cast<dnnl::memory::data_type>(dtypeB);
@@ -93,6 +184,19 @@ EXPORT void *create_brgemm(int64_t M, int64_t N, int64_t K_k,
 
   // Instruct the kernel to append the result to C tensor.
   brg.set_add_C(true);
+  // Write the post-processed result to D tensor when it is requested.
+  if (dtypeD != dnnl_data_type_undef) {
+    dnnl::post_ops po;
+    for (size_t i = 0; i < BRGEMM_MAX_POST_OPS; ++i) {
+      int64_t alg = key[13 + 3 * i];
+      if (alg == dnnl_alg_kind_undef)
+        continue;
+      po.append_eltwise(static_cast<dnnl::algorithm>(alg),
+                        getPostOpParam(key[14 + 3 * i]),
+                        getPostOpParam(key[15 + 3 * i]));
+    }
+    brg.set_post_ops(ldd, static_cast<dnnl::memory::data_type>(dtypeD), po);
+  }
   // Finalize the initialization.
   brg.finalize();
 
@@ -115,20 +219,289 @@ EXPORT void *create_brgemm(int64_t M, int64_t N, int64_t K_k,
     tf = std::move(pack_B);
   }
 
-  auto it = savedUkernels.insert({key, {tf, brg}});
-  return &it.first->second;
+  return std::make_shared<const onednn_handle>(onednn_handle{tf, brg});
+}
+
+// Get generated code of the entry, generating it if needed.
+std::shared_ptr<const onednn_handle> getImpl(CachedHandle *handle) {
+  HandleCacheShard &shard = getShard(handle->key);
+  std::promise<void> promise;
+  {
+    std::unique_lock<std::mutex> guard(shard.lock);
+    while (handle->pending.valid()) {
+      std::shared_future<void> pending = handle->pending;
+      guard.unlock();
+      pending.wait();
+      guard.lock();
+    }
+    if (handle->impl) {
+      g_hits.fetch_add(1, std::memory_order_relaxed);
+      handle->used.store(true, std::memory_order_relaxed);
+      return handle->impl;
+    }
+    handle->pending = promise.get_future().share();
+  }
+
+  g_misses.fetch_add(1, std::memory_order_relaxed);
+  std::shared_ptr<const onednn_handle> impl;
+  try {
+    impl = generate_brgemm(handle->key);
+  } catch (...) {
+    std::lock_guard<std::mutex> guard(shard.lock);
+    handle->pending = {};
+    promise.set_value();
+    throw;
+  }
+
+  std::lock_guard<std::mutex> guard(shard.lock);
+  handle->impl = impl;
+  handle->used.store(true, std::memory_order_relaxed);
+  handle->pending = {};
+  shard.generated.push_front(handle);
+  evictOverCapacity(shard);
+  promise.set_value();
+  return impl;
+}
+
+// Get generated code of the entry through the cache of the calling thread.
+// The code stays alive while the thread cache holds it, i.e. at least until
+// the next call on this thread.
+const onednn_handle *getThreadImpl(CachedHandle *handle) {
+  struct ThreadCache {
+    uint64_t seenEvictions = 0;
+    std::unordered_map<CachedHandle *, std::shared_ptr<const onednn_handle>>
+        impls;
+  };
+  thread_local ThreadCache cache;
+
+  // Drop references to released code.
+  uint64_t evictions = g_evictions.load(std::memory_order_acquire);
+  if (evictions != cache.seenEvictions) {
+    cache.impls.clear();
+    cache.seenEvictions = evictions;
+  }
+
+  auto it = cache.impls.find(handle);
+  if (it != cache.impls.end()) {
+    if (!handle->used.load(std::memory_order_relaxed))
+      handle->used.store(true, std::memory_order_relaxed);
+    return it->second.get();
+  }
+
+  std::shared_ptr<const onednn_handle> impl = getImpl(handle);
+  const onednn_handle *res = impl.get();
+  cache.impls.emplace(handle, std::move(impl));
+  return res;
+}
+
+// Whole-launch GEMMs of kernels matched by the MatchGemmKernels pass run as
+// oneDNN matmul primitives, which do their own blocking, packing and
+// threading. Primitives are cached by shapes, strides, types and the
+// epilogue, like ukernel handles but without a capacity, as launches of a
+// GEMM kernel have few distinct shapes.
+
+// Element types of GEMM operands, see _GemmOffload of the driver.
+enum GemmType : int32_t { GEMM_F32 = 0, GEMM_F16 = 1, GEMM_BF16 = 2 };
+
+// M, N, K, strides of A, B and C, type of A and B, type of C and ReLU.
+using GemmKeyT = std::array<int64_t, 12>;
+
+struct GemmKeyHash {
+  size_t operator()(const GemmKeyT &key) const {
+    size_t res = 0;
+    for (int64_t val : key)
+      res ^= std::hash<int64_t>{}(val) + 0x9e3779b97f4a7c15ULL + (res << 6) +
+             (res >> 2);
+    return res;
+  }
+};
+
+memory::data_type getGemmDataType(int64_t type) {
+  switch (type) {
+  case GEMM_F16:
+    return memory::data_type::f16;
+  case GEMM_BF16:
+    return memory::data_type::bf16;
+  default:
+    return memory::data_type::f32;
+  }
+}
+
+const dnnl::engine &getGemmEngine() {
+  static const dnnl::engine engine(dnnl::engine::kind::cpu, 0);
+  return engine;
+}
+
+struct GemmPrimitive {
+  dnnl::matmul prim;
+  memory::desc a, b, c;
+};
+
+std::shared_ptr<const GemmPrimitive> createGemm(const GemmKeyT &key) {
+  int64_t M = key[0], N = key[1], K = key[2];
+  memory::data_type abType = getGemmDataType(key[9]);
+  memory::desc a({M, K}, abType, {key[3], key[4]});
+  memory::desc b({K, N}, abType, {key[5], key[6]});
+  memory::desc c({M, N}, getGemmDataType(key[10]), {key[7], key[8]});
+  dnnl::primitive_attr attr;
+  if (key[11]) {
+    dnnl::post_ops po;
+    po.append_eltwise(algorithm::eltwise_relu, 0.f, 0.f);
+    attr.set_post_ops(po);
+  }
+  dnnl::matmul::primitive_desc pd(getGemmEngine(), a, b, c, attr);
+  return std::make_shared<const GemmPrimitive>(
+      GemmPrimitive{dnnl::matmul(pd), a, b, c});
+}
+
+std::shared_ptr<const GemmPrimitive> getGemm(const GemmKeyT &key) {
+  static std::mutex lock;
+  static std::unordered_map<GemmKeyT, std::shared_ptr<const GemmPrimitive>,
+                            GemmKeyHash>
+      cache;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = cache.find(key);
+    if (it != cache.end())
+      return it->second;
+  }
+  std::shared_ptr<const GemmPrimitive> gemm = createGemm(key);
+  std::lock_guard<std::mutex> guard(lock);
+  return cache.emplace(key, std::move(gemm)).first->second;
+}
+
+struct GemmTask {
+  std::shared_ptr<const GemmPrimitive> gemm;
+  const void *a;
+  const void *b;
+  void *c;
+};
+
+void runGemmTask(void *ctx) {
+  auto *task = static_cast<GemmTask *>(ctx);
+  const dnnl::engine &engine = getGemmEngine();
+  dnnl::stream stream(engine);
+  const GemmPrimitive &gemm = *task->gemm;
+  gemm.prim.execute(
+      stream,
+      {{DNNL_ARG_SRC,
+        memory(gemm.a, engine, const_cast<void *>(task->a))},
+       {DNNL_ARG_WEIGHTS,
+        memory(gemm.b, engine, const_cast<void *>(task->b))},
+       {DNNL_ARG_DST, memory(gemm.c, engine, task->c)}});
+  stream.wait();
+}
+
+void destroyGemmTask(void *ctx) { delete static_cast<GemmTask *>(ctx); }
+
+} // namespace
+
+extern "C" void triton_cpu_stream_enqueue(void *stream, void (*fn)(void *),
+                                          void *ctx, void (*destroy)(void *));
+
+extern "C" {
+
+// Return 0 if oneDNN supports the GEMM of triton_cpu_gemm with these shapes,
+// strides, types and epilogue, or -1. Launchers check it before calling
+// launch hooks, so these are called once for launches running the kernel.
+EXPORT int32_t triton_cpu_gemm_supported(int64_t M, int64_t N, int64_t K,
+                                         int64_t stride_am, int64_t stride_ak,
+                                         int64_t stride_bk, int64_t stride_bn,
+                                         int64_t stride_cm, int64_t stride_cn,
+                                         int32_t ab_type, int32_t c_type,
+                                         int32_t relu) {
+  GemmKeyT key{M,         N,         K,         stride_am,
+               stride_ak, stride_bk, stride_bn, stride_cm,
+               stride_cn, ab_type,   c_type,    relu != 0};
+  try {
+    // Supported primitives are cached for triton_cpu_gemm.
+    getGemm(key);
+  } catch (const dnnl::error &) {
+    return -1;
+  }
+  return 0;
+}
+
+// Compute C = A x B of M x K and K x N matrices with strides in elements,
+// optionally through a ReLU, for a whole launch of a GEMM kernel. With a
+// stream, the GEMM runs after previously submitted launches of the stream,
+// otherwise it runs immediately. Return 0 on success, or -1 if oneDNN
+// doesn't support the GEMM, so that the launcher runs the kernel instead.
+EXPORT int32_t triton_cpu_gemm(void *stream, const void *a, const void *b,
+                               void *c, int64_t M, int64_t N, int64_t K,
+                               int64_t stride_am, int64_t stride_ak,
+                               int64_t stride_bk, int64_t stride_bn,
+                               int64_t stride_cm, int64_t stride_cn,
+                               int32_t ab_type, int32_t c_type,
+                               int32_t relu) {
+  GemmKeyT key{M,         N,         K,         stride_am,
+               stride_ak, stride_bk, stride_bn, stride_cm,
+               stride_cn, ab_type,   c_type,    relu != 0};
+  GemmTask *task;
+  try {
+    task = new GemmTask{getGemm(key), a, b, c};
+  } catch (const dnnl::error &) {
+    return -1;
+  }
+  if (!stream) {
+    runGemmTask(task);
+    destroyGemmTask(task);
+    return 0;
+  }
+  triton_cpu_stream_enqueue(stream, runGemmTask, task, destroyGemmTask);
+  return 0;
+}
+
+// The post-processed result is written to a separate D tensor with ldd
+// leading dimension when dtypeD is not dnnl_data_type_undef. Post-op slots
+// with dnnl_alg_kind_undef algorithm are ignored.
+EXPORT void *
+create_brgemm(int64_t M, int64_t N, int64_t K_k, int64_t batch_size,
+              int64_t lda, int64_t ldb, int64_t ldc, int64_t dtypeA,
+              int64_t dtypeB, int64_t dtypeC, bool skip_packing, int64_t ldd,
+              int64_t dtypeD, int64_t alg0, int64_t alpha0, int64_t beta0,
+              int64_t alg1, int64_t alpha1, int64_t beta1, int64_t alg2,
+              int64_t alpha2, int64_t beta2) {
+  KeyT key{M,      N,      K_k,    batch_size, lda,  ldb,
+           ldc,    dtypeA, dtypeB, dtypeC,     skip_packing,
+           ldd,    dtypeD, alg0,   alpha0,     beta0,
+           alg1,   alpha1, beta1,  alg2,       alpha2, beta2};
+
+  triton_cpu_stats_add(BRGEMM_LOOKUPS, 1);
+  thread_local std::unordered_map<KeyT, CachedHandle *, KeyHash> localCache;
+  auto localIt = localCache.find(key);
+  if (localIt != localCache.end())
+    return localIt->second;
+
+  HandleCacheShard &shard = getShard(key);
+  CachedHandle *handle;
+  {
+    std::lock_guard<std::mutex> guard(shard.lock);
+    std::unique_ptr<CachedHandle> &entry = shard.handles[key];
+    if (!entry) {
+      entry = std::make_unique<CachedHandle>();
+      entry->key = key;
+    }
+    handle = entry.get();
+  }
+
+  // Generate the code right away to report errors at the creation.
+  getThreadImpl(handle);
+  localCache.emplace(key, handle);
+  return handle;
 }
 
 EXPORT void brgemm_execute(const void *handle, void *A_ptr,
                            void *original_B_ptr, void *C_ptr,
                            int64_t A_step_in_bytes, int64_t B_step_in_bytes,
                            int64_t B_block_size_in_bytes, int64_t num_batches,
-                           bool skip_packing) {
+                           bool skip_packing, void *D_ptr) {
 
   uint8_t *blocked_data = reinterpret_cast<uint8_t *>(original_B_ptr);
   const uint8_t *B_ptr_calc = reinterpret_cast<const uint8_t *>(original_B_ptr);
 
-  const onednn_handle *kernel = reinterpret_cast<const onednn_handle *>(handle);
+  auto *cached = reinterpret_cast<CachedHandle *>(const_cast<void *>(handle));
+  const onednn_handle *kernel = getThreadImpl(cached);
 
   const auto pack_B = kernel->transform;
   const auto brg = kernel->brg;
@@ -158,7 +531,13 @@ EXPORT void brgemm_execute(const void *handle, void *A_ptr,
   std::vector<uint8_t> scratchpad_sm(scratchpad_size);
   //  An execute call. `A_B` is a vector of pointers to A and packed B
   //  tensors. `acc_ptr` is a pointer to an accumulator buffer.
-  brg.execute(A_ptr, blocked_data, A_B_offsets, C_ptr, scratchpad_sm.data());
+  //  With post-ops, the final result is written to `D_ptr`.
+  if (D_ptr)
+    brg.execute(A_ptr, blocked_data, A_B_offsets, C_ptr, D_ptr,
+                scratchpad_sm.data());
+  else
+    brg.execute(A_ptr, blocked_data, A_B_offsets, C_ptr,
+                scratchpad_sm.data());
 
   dnnl::ukernel::brgemm::release_hw_context();
 
@@ -167,4 +546,36 @@ EXPORT void brgemm_execute(const void *handle, void *A_ptr,
   };
 }
 
+// Keep in sync with UkernelCacheStats in driver.py.
+struct UkernelCacheStats {
+  // Lookups that missed thread caches and found generated code.
+  uint64_t hits;
+  // Lookups that generated code.
+  uint64_t misses;
+  // Number of times generated code was released.
+  uint64_t evictions;
+  // Number of entries with generated code.
+  uint64_t entries;
+  // Maximum number of entries with generated code, 0 means unbounded.
+  int64_t capacity;
+};
+
+EXPORT void triton_cpu_ukernel_cache_stats(UkernelCacheStats *stats) {
+  stats->hits = g_hits.load(std::memory_order_relaxed);
+  stats->misses = g_misses.load(std::memory_order_relaxed);
+  stats->evictions = g_evictions.load(std::memory_order_relaxed);
+  stats->entries = 0;
+  for (HandleCacheShard &shard : g_brgemm_cache) {
+    std::lock_guard<std::mutex> guard(shard.lock);
+    stats->entries += shard.generated.size();
+  }
+  stats->capacity = g_capacity.load(std::memory_order_relaxed);
+}
+
+// Set the maximum number of entries with generated code, 0 means unbounded.
+// Entries over the capacity are released on next code generations.
+EXPORT void triton_cpu_ukernel_cache_set_capacity(int64_t capacity) {
+  g_capacity.store(std::max<int64_t>(capacity, 0), std::memory_order_relaxed);
+}
+
 } // extern C
@@ -0,0 +1,11 @@
+#ifndef TRITONCPU_RUNTIME_RUNTIME_ONEDNN_H
+#define TRITONCPU_RUNTIME_RUNTIME_ONEDNN_H
+
+#include <cstddef>
+
+// Number of post-op slots passed to create_brgemm of runtime_onednn.cpp,
+// each a triple of algorithm kind, alpha and beta. Also limits the post-ops
+// that the compiler fuses into ukernel calls.
+constexpr size_t BRGEMM_MAX_POST_OPS = 3;
+
+#endif // TRITONCPU_RUNTIME_RUNTIME_ONEDNN_H
@@ -0,0 +1,341 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "runtime_perf_counters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+struct CounterDesc {
+  std::string name;
+  uint32_t type;
+  uint64_t config;
+};
+
+// Counters measured for each launch. LLC misses approximate the DRAM
+// traffic, since uncore bandwidth counters can't be attributed to threads.
+// Additional raw events, e.g. AVX-512 license transitions, are given by
+// TRITON_CPU_PERF_RAW_EVENTS as a comma-separated list of name=config pairs,
+// where config is the raw event code, e.g. "lvl2_license=0x2028".
+const std::vector<CounterDesc> &getCounterDescs() {
+  static std::vector<CounterDesc> descs = []() {
+    std::vector<CounterDesc> res;
+#if defined(__linux__)
+    res.push_back({"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES});
+    res.push_back(
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS});
+    res.push_back(
+        {"llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES});
+    res.push_back({"llc_references", PERF_TYPE_HARDWARE,
+                   PERF_COUNT_HW_CACHE_REFERENCES});
+    if (const char *env = std::getenv("TRITON_CPU_PERF_RAW_EVENTS")) {
+      std::stringstream ss(env);
+      std::string item;
+      while (std::getline(ss, item, ',') &&
+             res.size() < static_cast<size_t>(MAX_PERF_COUNTERS)) {
+        auto pos = item.find('=');
+        if (pos == std::string::npos || pos == 0)
+          continue;
+        res.push_back({item.substr(0, pos), PERF_TYPE_RAW,
+                       std::strtoull(item.c_str() + pos + 1, nullptr, 0)});
+      }
+    }
+#endif
+    return res;
+  }();
+  return descs;
+}
+
+// A group of counters of the calling thread. Counters count user-space
+// events of the thread only, reading them costs a single syscall.
+class ThreadCounters {
+public:
+  ThreadCounters() {
+#if defined(__linux__)
+    for (const auto &desc : getCounterDescs()) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = desc.type;
+      attr.config = desc.config;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      attr.disabled = fds.empty();
+      int fd = static_cast<int>(
+          syscall(SYS_perf_event_open, &attr, 0, -1,
+                  fds.empty() ? -1 : fds.front(), 0));
+      // Counters that aren't supported by the CPU read as zero.
+      fds.push_back(fd);
+      if (fds.front() < 0)
+        break;
+    }
+    if (!fds.empty() && fds.front() >= 0)
+      ioctl(fds.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+
+  ~ThreadCounters() {
+#if defined(__linux__)
+    for (int fd : fds)
+      if (fd >= 0)
+        close(fd);
+#endif
+  }
+
+  // Read values of all counters, return false if counters are unavailable.
+  bool read(uint64_t *values) {
+#if defined(__linux__)
+    if (fds.empty() || fds.front() < 0)
+      return false;
+    uint64_t buf[1 + MAX_PERF_COUNTERS];
+    if (::read(fds.front(), buf, sizeof(buf)) < 0)
+      return false;
+    // Values of the group members that were opened successfully follow the
+    // number of members in their order.
+    size_t member = 0;
+    for (size_t i = 0; i < fds.size(); ++i)
+      values[i] = fds[i] >= 0 && member < buf[0] ? buf[1 + member++] : 0;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+private:
+  std::vector<int> fds;
+};
+
+std::atomic<bool> enabled{false};
+
+// Samples instruction pointers of the calling thread every period
+// nanoseconds of its CPU time into a perf ring buffer. The task clock is a
+// software event, so sampling works without access to the PMU, e.g. in VMs.
+class ThreadSampler {
+public:
+  explicit ThreadSampler(uint64_t period) : period(period) {
+#if defined(__linux__)
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_TASK_CLOCK;
+    attr.sample_period = period;
+    attr.sample_type = PERF_SAMPLE_IP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.disabled = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+                                  PERF_FLAG_FD_CLOEXEC));
+    if (fd < 0)
+      return;
+    pageSize = sysconf(_SC_PAGESIZE);
+    mapSize = (1 + DATA_PAGES) * pageSize;
+    map = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+      map = nullptr;
+      close(fd);
+      fd = -1;
+    }
+#endif
+  }
+
+  ~ThreadSampler() {
+#if defined(__linux__)
+    if (map)
+      munmap(map, mapSize);
+    if (fd >= 0)
+      close(fd);
+#endif
+  }
+
+  uint64_t getPeriod() const { return period; }
+
+  void enable() {
+#if defined(__linux__)
+    if (fd >= 0)
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  // Stop sampling and append the instruction pointers sampled since the
+  // last call to ips. Samples that didn't fit into the ring buffer are lost.
+  void disable(std::vector<uint64_t> &ips) {
+#if defined(__linux__)
+    if (fd < 0)
+      return;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    auto *meta = static_cast<perf_event_mmap_page *>(map);
+    uint64_t head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+    uint64_t tail = meta->data_tail;
+    while (tail < head) {
+      perf_event_header header;
+      readRing(tail, &header, sizeof(header));
+      if (header.size == 0)
+        break;
+      if (header.type == PERF_RECORD_SAMPLE) {
+        uint64_t ip;
+        readRing(tail + sizeof(header), &ip, sizeof(ip));
+        ips.push_back(ip);
+      }
+      tail += header.size;
+    }
+    __atomic_store_n(&meta->data_tail, head, __ATOMIC_RELEASE);
+#endif
+  }
+
+private:
+  // Pages of the ring buffer after its metadata page, a power of two.
+  static constexpr size_t DATA_PAGES = 64;
+
+  // Copy size bytes at offset of the ring buffer, which may wrap around.
+  void readRing(uint64_t offset, void *dst, size_t size) const {
+    const char *data = static_cast<const char *>(map) + pageSize;
+    size_t dataSize = DATA_PAGES * pageSize;
+    for (size_t i = 0; i < size; ++i)
+      static_cast<char *>(dst)[i] = data[(offset + i) & (dataSize - 1)];
+  }
+
+  uint64_t period;
+  int fd = -1;
+  void *map = nullptr;
+  size_t pageSize = 0;
+  size_t mapSize = 0;
+};
+
+std::atomic<uint64_t> samplingPeriod{0};
+
+// Numbers of samples of instruction pointers, taken by all threads since the
+// last read.
+class SampleCounts {
+public:
+  static SampleCounts &get() {
+    static SampleCounts counts;
+    return counts;
+  }
+
+  void add(const std::vector<uint64_t> &ips) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint64_t ip : ips)
+      ++counts[ip];
+  }
+
+  size_t read(uint64_t *ips, uint64_t *numSamples, size_t maxCount) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (auto it = counts.begin(); it != counts.end() && count < maxCount;
+         ++count) {
+      ips[count] = it->first;
+      numSamples[count] = it->second;
+      it = counts.erase(it);
+    }
+    return count;
+  }
+
+private:
+  std::mutex mutex;
+  std::unordered_map<uint64_t, uint64_t> counts;
+};
+
+thread_local std::unique_ptr<ThreadSampler> threadSampler;
+
+} // namespace
+
+extern "C" {
+
+// Start or stop counting hardware events of launches. Counters are opened
+// lazily by each thread that runs programs while counting is enabled.
+EXPORT void triton_cpu_perf_enable(bool enable) {
+  enabled.store(enable, std::memory_order_relaxed);
+}
+
+EXPORT bool triton_cpu_perf_enabled() {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+EXPORT int32_t triton_cpu_perf_num_counters() {
+  return static_cast<int32_t>(getCounterDescs().size());
+}
+
+// Capacity of the value buffers that readers of counters must provide.
+EXPORT int32_t triton_cpu_perf_max_counters() { return MAX_PERF_COUNTERS; }
+
+EXPORT const char *triton_cpu_perf_counter_name(int32_t idx) {
+  const auto &descs = getCounterDescs();
+  if (idx < 0 || idx >= static_cast<int32_t>(descs.size()))
+    return nullptr;
+  return descs[idx].name.c_str();
+}
+
+// Read the counters of the calling thread into values, which must hold
+// triton_cpu_perf_num_counters() elements. Return false if counters are not
+// available, e.g. when perf events are restricted by perf_event_paranoid.
+EXPORT bool triton_cpu_perf_read_thread(uint64_t *values) {
+  static thread_local std::unique_ptr<ThreadCounters> counters;
+  if (!counters)
+    counters = std::make_unique<ThreadCounters>();
+  return counters->read(values);
+}
+
+// Start sampling instruction pointers of threads running programs every
+// period_ns nanoseconds of their CPU time, or stop it if period_ns is zero.
+// Samplers are opened lazily by each thread that runs programs.
+EXPORT void triton_cpu_ip_sampling_enable(uint64_t period_ns) {
+  samplingPeriod.store(period_ns, std::memory_order_relaxed);
+}
+
+EXPORT bool triton_cpu_ip_sampling_enabled() {
+  return samplingPeriod.load(std::memory_order_relaxed) != 0;
+}
+
+// Sample the calling thread until triton_cpu_ip_sampling_end_thread, e.g.
+// while it runs its share of a job, so that waiting for jobs isn't sampled.
+EXPORT void triton_cpu_ip_sampling_begin_thread() {
+  uint64_t period = samplingPeriod.load(std::memory_order_relaxed);
+  if (!period)
+    return;
+  if (!threadSampler || threadSampler->getPeriod() != period)
+    threadSampler = std::make_unique<ThreadSampler>(period);
+  threadSampler->enable();
+}
+
+EXPORT void triton_cpu_ip_sampling_end_thread() {
+  if (!threadSampler)
+    return;
+  std::vector<uint64_t> ips;
+  threadSampler->disable(ips);
+  if (!ips.empty())
+    SampleCounts::get().add(ips);
+}
+
+// Move up to max_count sampled instruction pointers with their numbers of
+// samples into ips and num_samples, return how many were moved.
+EXPORT size_t triton_cpu_ip_sampling_read(uint64_t *ips, uint64_t *num_samples,
+                                          size_t max_count) {
+  return SampleCounts::get().read(ips, num_samples, max_count);
+}
+
+} // extern "C"
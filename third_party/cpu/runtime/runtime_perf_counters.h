@@ -0,0 +1,18 @@
+#ifndef TRITONCPU_RUNTIME_RUNTIME_PERF_COUNTERS_H
+#define TRITONCPU_RUNTIME_RUNTIME_PERF_COUNTERS_H
+
+#include <cstdint>
+
+// Maximum number of hardware event counters read per thread. Launchers
+// generated by driver.py read it with triton_cpu_perf_max_counters.
+constexpr int32_t MAX_PERF_COUNTERS = 8;
+
+// Hardware event counters provided by runtime_perf_counters.cpp.
+extern "C" bool triton_cpu_perf_enabled();
+extern "C" int32_t triton_cpu_perf_num_counters();
+extern "C" bool triton_cpu_perf_read_thread(uint64_t *values);
+extern "C" bool triton_cpu_ip_sampling_enabled();
+extern "C" void triton_cpu_ip_sampling_begin_thread();
+extern "C" void triton_cpu_ip_sampling_end_thread();
+
+#endif // TRITONCPU_RUNTIME_RUNTIME_PERF_COUNTERS_H
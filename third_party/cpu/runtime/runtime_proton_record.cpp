@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+// Default number of events kept per thread.
+constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 16;
+
+// An event of a proton.record op executed by a kernel. Keep in sync with
+// RecordEvent in driver.py.
+struct RecordEvent {
+  // Name of the kernel executing the op.
+  const char *kernel;
+  int32_t region_id;
+  int32_t is_start;
+  uint32_t pid_x;
+  uint32_t pid_y;
+  uint32_t pid_z;
+  int64_t thread;
+  // Value of the cycle counter, see triton_cpu_proton_record_frequency.
+  uint64_t counter;
+};
+
+uint64_t readCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t res;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(res));
+  return res;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+int64_t currentThreadId() {
+#if defined(__linux__)
+  return static_cast<int64_t>(syscall(SYS_gettid));
+#else
+  return static_cast<int64_t>(
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+#endif
+}
+
+// Events recorded by kernels. Each thread appends events to its own buffer
+// without synchronization with other threads, readers copy the events
+// published since their previous read. Events are dropped once the buffer of
+// a thread is full until the records are cleared.
+class Records {
+public:
+  static Records &get() {
+    static Records *records = new Records(bufferSize());
+    return *records;
+  }
+
+  void record(const char *kernel, int32_t regionId, bool isStart,
+              uint32_t pidX, uint32_t pidY, uint32_t pidZ) {
+    uint64_t counter = readCounter();
+    Buffer &buf = localBuffer();
+    size_t idx = buf.size.load(std::memory_order_relaxed);
+    if (idx >= capacity) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    buf.events[idx] = {kernel, regionId, isStart, pidX, pidY, pidZ,
+                       buf.thread, counter};
+    buf.size.store(idx + 1, std::memory_order_release);
+  }
+
+  // Copy up to maxEvents events recorded since the previous read to out.
+  size_t read(RecordEvent *out, size_t maxEvents) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    size_t count = 0;
+    for (auto &buf : buffers) {
+      size_t end = buf->size.load(std::memory_order_acquire);
+      size_t take = std::min(maxEvents - count, end - buf->consumed);
+      std::copy(buf->events.get() + buf->consumed,
+                buf->events.get() + buf->consumed + take, out + count);
+      buf->consumed += take;
+      count += take;
+    }
+    return count;
+  }
+
+  // Discard all events. Kernels must not run concurrently.
+  void clear() {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (auto &buf : buffers) {
+      buf->size.store(0, std::memory_order_relaxed);
+      buf->consumed = 0;
+    }
+    dropped.store(0, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> dropped{0};
+
+private:
+  struct Buffer {
+    explicit Buffer(size_t capacity)
+        : events(new RecordEvent[capacity]), thread(currentThreadId()) {}
+
+    std::unique_ptr<RecordEvent[]> events;
+    std::atomic<size_t> size{0};
+    // Number of events copied by readers, protected by buffersMutex.
+    size_t consumed = 0;
+    const int64_t thread;
+  };
+
+  static size_t bufferSize() {
+    const char *env = std::getenv("TRITON_CPU_PROTON_RECORD_SIZE");
+    long long requested = env ? std::atoll(env) : 0;
+    return requested > 0 ? static_cast<size_t>(requested)
+                         : DEFAULT_BUFFER_SIZE;
+  }
+
+  explicit Records(size_t capacity) : capacity(capacity) {}
+
+  Buffer &localBuffer() {
+    static thread_local std::shared_ptr<Buffer> buf;
+    if (!buf) {
+      buf = std::make_shared<Buffer>(capacity);
+      std::lock_guard<std::mutex> lock(buffersMutex);
+      buffers.push_back(buf);
+    }
+    return *buf;
+  }
+
+  const size_t capacity;
+  std::mutex buffersMutex;
+  std::vector<std::shared_ptr<Buffer>> buffers;
+};
+
+double measureFrequency() {
+#if defined(__aarch64__)
+  uint64_t res;
+  asm volatile("mrs %0, cntfrq_el0" : "=r"(res));
+  return static_cast<double>(res);
+#elif defined(__x86_64__) || defined(__i386__)
+  // Calibrate the TSC against the steady clock.
+  auto start = std::chrono::steady_clock::now();
+  uint64_t startCounter = readCounter();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  uint64_t endCounter = readCounter();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return static_cast<double>(endCounter - startCounter) / elapsed.count();
+#else
+  return 1e9;
+#endif
+}
+
+} // namespace
+
+extern "C" {
+
+// Record an event of a proton.record op, kernels call it for each executed
+// op.
+EXPORT void triton_cpu_proton_record(const char *kernel, int32_t region_id,
+                                     bool is_start, uint32_t pid_x,
+                                     uint32_t pid_y, uint32_t pid_z) {
+  Records::get().record(kernel, region_id, is_start, pid_x, pid_y, pid_z);
+}
+
+// Copy up to max_events events recorded since the previous read into out and
+// return their number. Events of a thread are returned in the order of
+// execution.
+EXPORT size_t triton_cpu_proton_record_read(RecordEvent *out,
+                                            size_t max_events) {
+  return Records::get().read(out, max_events);
+}
+
+// Discard all recorded events. It must not be called while kernels run.
+EXPORT void triton_cpu_proton_record_clear() { Records::get().clear(); }
+
+// Return the number of events dropped because thread buffers were full, see
+// TRITON_CPU_PROTON_RECORD_SIZE.
+EXPORT uint64_t triton_cpu_proton_record_dropped() {
+  return Records::get().dropped.load(std::memory_order_relaxed);
+}
+
+// Return the number of counter ticks per second.
+EXPORT double triton_cpu_proton_record_frequency() {
+  static double frequency = measureFrequency();
+  return frequency;
+}
+
+} // extern "C"
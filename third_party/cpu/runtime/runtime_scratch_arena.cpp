@@ -0,0 +1,95 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+extern "C" void *triton_cpu_alloc(size_t size, size_t page_size,
+                                  bool interleave);
+extern "C" void triton_cpu_free(void *ptr);
+
+namespace {
+
+// Size of pages backing arenas, 2M by default. 1G pages, e.g. for threads with
+// arenas of hundreds of megabytes, or base pages with 4K are selected by
+// TRITON_CPU_SCRATCH_ARENA_PAGE_SIZE.
+size_t arenaPageSize() {
+  static const size_t size = []() -> size_t {
+    const char *env = std::getenv("TRITON_CPU_SCRATCH_ARENA_PAGE_SIZE");
+    if (!env || !*env)
+      return 2 << 20;
+    char *end;
+    size_t value = std::strtoull(env, &end, 10);
+    switch (*end) {
+    case 'G':
+    case 'g':
+      return value << 30;
+    case 'M':
+    case 'm':
+      return value << 20;
+    case 'K':
+    case 'k':
+      return value << 10;
+    default:
+      return value;
+    }
+  }();
+  return size;
+}
+
+// Scratch arena of a thread. Arenas of pool workers live as long as the
+// workers, so buffers are reused by all launches. Arenas are allocated in
+// whole huge pages by triton_cpu_alloc, which also makes them aligned to
+// cache lines.
+struct ScratchArena {
+  char *data = nullptr;
+  size_t size = 0;
+
+  ~ScratchArena() { release(); }
+
+  void release() {
+    triton_cpu_free(data);
+    data = nullptr;
+    size = 0;
+  }
+
+  // Replace the arena with a larger one. The content isn't preserved.
+  void grow(size_t minSize) {
+    release();
+    data = static_cast<char *>(triton_cpu_alloc(minSize, arenaPageSize(),
+                                                /*interleave=*/false));
+    if (data)
+      size = minSize;
+  }
+};
+
+thread_local ScratchArena arena;
+
+} // namespace
+
+extern "C" {
+
+// Return the scratch arena of the calling thread with at least size bytes.
+// Kernels take buffers too large for worker stacks from it, see
+// AllocateScratchArena. The arena is reused by all programs executed by the
+// thread, so its content isn't preserved between them.
+EXPORT void *triton_cpu_scratch_arena(int64_t size) {
+  if (static_cast<size_t>(size) <= arena.size)
+    return arena.data;
+  arena.grow(size);
+  if (!arena.data) {
+    fprintf(stderr, "Failed to allocate a scratch arena of %lld bytes\n",
+            static_cast<long long>(size));
+    abort();
+  }
+  return arena.data;
+}
+
+} // extern "C"
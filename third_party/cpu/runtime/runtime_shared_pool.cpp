@@ -0,0 +1,362 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+// Cooperative division of cores between processes, e.g. serving workers of
+// different models on a host, whose thread pools would oversubscribe the
+// host several times if each used all cores. Processes started with the same
+// TRITON_CPU_SHARED_POOL name map a table of core leases in shared memory.
+// Each pool launch leases cores for its threads and returns them when it
+// completes, so idle processes hold no cores and busy ones get all of them.
+// While several processes are active, a launch leases at most an equal share
+// of the cores. A launch that finds no free cores still runs on one thread,
+// so processes never wait for each other.
+
+// Maximum number of processes sharing a table.
+constexpr int MAX_PROCESSES = 256;
+
+// State of an initialized table, which also identifies its layout.
+constexpr uint32_t TABLE_READY = 0x54435031;
+constexpr uint32_t TABLE_INITIALIZING = 1;
+
+// Minimal interval between scans for leases of processes that exited
+// without returning them.
+constexpr int64_t RECLAIM_INTERVAL_NS = 100000000;
+
+// Reserved pid of entries that are being claimed or whose leases are being
+// reclaimed.
+constexpr int32_t RECLAIMING_PID = -1;
+
+struct alignas(64) ProcessEntry {
+  // Owner of the entry, zero for free entries.
+  std::atomic<int32_t> pid;
+  // Start time of the owner, which tells it from later processes reusing its
+  // pid.
+  std::atomic<uint64_t> startTime;
+  // Cores leased by launches of the owner.
+  std::atomic<int32_t> leased;
+  // Running launches of the owner, including those without leased cores.
+  std::atomic<int32_t> launches;
+};
+
+// Layout of the shared table. A zero-filled table is uninitialized.
+struct Table {
+  std::atomic<uint32_t> state;
+  // Number of cores divided between processes.
+  int32_t capacity;
+  alignas(64) std::atomic<int32_t> leased;
+  // Processes with running launches, which share the cores.
+  std::atomic<int32_t> active;
+  ProcessEntry processes[MAX_PROCESSES];
+};
+
+static_assert(std::atomic<int32_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+              "shared table needs address-free atomics");
+
+int64_t steadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+#if defined(__linux__)
+// Start time of the process, in clock ticks since boot, or zero if it doesn't
+// exist. It doesn't allocate, so children can call it right after fork.
+uint64_t getStartTime(int32_t pid) {
+  char path[32];
+  snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return 0;
+  char buf[1024];
+  ssize_t len = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (len <= 0)
+    return 0;
+  buf[len] = 0;
+  // The start time is the 20th field after the command, which is in
+  // parentheses and may contain any character.
+  char *ptr = strrchr(buf, ')');
+  for (int field = 0; ptr && field < 20; ++field)
+    ptr = strchr(ptr + 1, ' ');
+  return ptr ? strtoull(ptr + 1, nullptr, 10) : 0;
+}
+#endif
+
+bool isValidName(const std::string &name) {
+  return !name.empty() && std::all_of(name.begin(), name.end(), [](char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' ||
+           c == '-';
+  });
+}
+
+class SharedPool {
+public:
+  static SharedPool &get() {
+    // Intentionally leaked, launches may run during static destruction.
+    static SharedPool *pool = new SharedPool();
+    return *pool;
+  }
+
+  bool enabled() const { return entry != nullptr; }
+
+  // Lease up to count cores and return the number of threads the launch can
+  // use, at least one. Set tokens to the number of leased cores.
+  int lease(int count, int *tokens) {
+    *tokens = 0;
+    if (!entry)
+      return count;
+    if (entry->launches.fetch_add(1, std::memory_order_relaxed) == 0)
+      table->active.fetch_add(1, std::memory_order_relaxed);
+    int active = std::max(table->active.load(std::memory_order_relaxed), 1);
+    int share = (table->capacity + active - 1) / active;
+    int want = std::min(count, share);
+    int cur = table->leased.load(std::memory_order_relaxed);
+    int granted;
+    bool reclaimed = false;
+    while (true) {
+      granted = std::min(want, table->capacity - cur);
+      if (granted <= 0) {
+        if (reclaimed || !(reclaimed = reclaimDead()))
+          return 1;
+        cur = table->leased.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (table->leased.compare_exchange_weak(cur, cur + granted,
+                                              std::memory_order_acq_rel))
+        break;
+    }
+    entry->leased.fetch_add(granted, std::memory_order_relaxed);
+    *tokens = granted;
+    return granted;
+  }
+
+  // Complete a launch that leased tokens cores.
+  void release(int tokens) {
+    if (!entry)
+      return;
+    if (tokens > 0) {
+      entry->leased.fetch_sub(tokens, std::memory_order_relaxed);
+      table->leased.fetch_sub(tokens, std::memory_order_release);
+    }
+    if (entry->launches.fetch_sub(1, std::memory_order_relaxed) == 1)
+      table->active.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void stats(int32_t *capacity, int32_t *leased, int32_t *active) const {
+    *capacity = table ? table->capacity : 0;
+    *leased = table ? table->leased.load(std::memory_order_relaxed) : 0;
+    *active = table ? table->active.load(std::memory_order_relaxed) : 0;
+  }
+
+private:
+  SharedPool() {
+    const char *name = std::getenv("TRITON_CPU_SHARED_POOL");
+    if (!name || !isValidName(name))
+      return;
+    table = mapTable(name);
+    if (!table)
+      return;
+    claimOrReclaimEntry();
+    if (!entry)
+      return;
+    std::atexit([]() { SharedPool::get().releaseEntry(); });
+#if defined(__linux__)
+    // Children of fork inherit the mapping and the entry of the parent, but
+    // have launches of their own, so they claim an entry for them.
+    pthread_atfork(nullptr, nullptr, []() {
+      SharedPool &pool = SharedPool::get();
+      pool.lastReclaimNs.store(INT64_MIN / 2, std::memory_order_relaxed);
+      pool.claimOrReclaimEntry();
+    });
+#endif
+  }
+
+  void claimOrReclaimEntry() {
+    entry = claimEntry();
+    if (!entry && reclaimDead())
+      entry = claimEntry();
+  }
+
+  // Map the table of the name, initializing it in the first process. Return
+  // null if it cannot be mapped or has a different layout.
+  static Table *mapTable(const std::string &name) {
+#if defined(__linux__)
+    std::string path = "/dev/shm/triton_cpu_pool_" + name;
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (fd < 0)
+      return nullptr;
+    struct stat st;
+    bool sized = fstat(fd, &st) == 0 &&
+                 (st.st_size == sizeof(Table) ||
+                  (st.st_size == 0 && ftruncate(fd, sizeof(Table)) == 0));
+    void *addr = sized ? mmap(nullptr, sizeof(Table), PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, 0)
+                       : MAP_FAILED;
+    close(fd);
+    if (addr == MAP_FAILED)
+      return nullptr;
+    auto *table = static_cast<Table *>(addr);
+
+    uint32_t state = 0;
+    if (table->state.compare_exchange_strong(state, TABLE_INITIALIZING)) {
+      int size = static_cast<int>(std::thread::hardware_concurrency());
+      if (const char *env = std::getenv("TRITON_CPU_SHARED_POOL_SIZE"))
+        size = std::atoi(env);
+      table->capacity = std::max(size, 1);
+      table->state.store(TABLE_READY, std::memory_order_release);
+      return table;
+    }
+    // Wait for the first process to initialize the table.
+    int64_t deadline = steadyNowNs() + 1000000000;
+    while (state == TABLE_INITIALIZING && steadyNowNs() < deadline) {
+      std::this_thread::yield();
+      state = table->state.load(std::memory_order_acquire);
+    }
+    if (state == TABLE_READY)
+      return table;
+    munmap(addr, sizeof(Table));
+#endif
+    return nullptr;
+  }
+
+  ProcessEntry *claimEntry() {
+#if defined(__linux__)
+    int32_t pid = static_cast<int32_t>(getpid());
+    uint64_t startTime = getStartTime(pid);
+    for (ProcessEntry &e : table->processes) {
+      // The entry is reserved until the start time is set, so it's not
+      // reclaimed with the start time of the previous owner.
+      int32_t expected = 0;
+      if (!e.pid.compare_exchange_strong(expected, RECLAIMING_PID))
+        continue;
+      e.startTime.store(startTime, std::memory_order_relaxed);
+      e.pid.store(pid, std::memory_order_release);
+      return &e;
+    }
+#endif
+    return nullptr;
+  }
+
+  // Free the entry at exit. Entries with cores still leased by running
+  // launches are reclaimed by other processes once this one exits.
+  void releaseEntry() {
+    if (entry && entry->launches.load(std::memory_order_relaxed) == 0)
+      entry->pid.store(0, std::memory_order_release);
+  }
+
+  // Return true if the owner of the entry exited. Its pid may have been
+  // reused by a later process, which has a different start time.
+  static bool isDead(const ProcessEntry &e, int32_t pid) {
+#if defined(__linux__)
+    if (kill(pid, 0) != 0)
+      return errno == ESRCH;
+    uint64_t startTime = getStartTime(pid);
+    return startTime != 0 &&
+           startTime != e.startTime.load(std::memory_order_relaxed);
+#else
+    return false;
+#endif
+  }
+
+  // Return leases of processes that exited without returning them, e.g.
+  // crashed ones. Return true if any were reclaimed.
+  bool reclaimDead() {
+#if defined(__linux__)
+    int64_t now = steadyNowNs();
+    int64_t last = lastReclaimNs.load(std::memory_order_relaxed);
+    if (now - last < RECLAIM_INTERVAL_NS ||
+        !lastReclaimNs.compare_exchange_strong(last, now))
+      return false;
+    bool res = false;
+    for (ProcessEntry &e : table->processes) {
+      int32_t pid = e.pid.load(std::memory_order_acquire);
+      if (pid <= 0 || pid == getpid() || !isDead(e, pid))
+        continue;
+      if (!e.pid.compare_exchange_strong(pid, RECLAIMING_PID))
+        continue;
+      if (e.launches.exchange(0, std::memory_order_relaxed) > 0)
+        table->active.fetch_sub(1, std::memory_order_relaxed);
+      int32_t leased = e.leased.exchange(0, std::memory_order_relaxed);
+      if (leased > 0) {
+        table->leased.fetch_sub(leased, std::memory_order_release);
+        res = true;
+      }
+      e.pid.store(0, std::memory_order_release);
+    }
+    return res;
+#else
+    return false;
+#endif
+  }
+
+  Table *table = nullptr;
+  ProcessEntry *entry = nullptr;
+  std::atomic<int64_t> lastReclaimNs{INT64_MIN / 2};
+};
+
+} // namespace
+
+extern "C" {
+
+// Return true if the process shares cores with other processes, see
+// SharedPool.
+EXPORT bool triton_cpu_shared_pool_enabled() {
+  return SharedPool::get().enabled();
+}
+
+// Lease cores for a launch that could use up to num_threads threads and
+// return the number of threads it can use. *tokens is set to the number of
+// leased cores. Once the launch completes, triton_cpu_shared_pool_release
+// must be called with them, even if no cores were leased. Without a shared
+// pool, num_threads is returned and no cores are leased.
+EXPORT int32_t triton_cpu_shared_pool_lease(int32_t num_threads,
+                                            int32_t *tokens) {
+  int leased;
+  int32_t res = SharedPool::get().lease(num_threads, &leased);
+  *tokens = leased;
+  return res;
+}
+
+EXPORT void triton_cpu_shared_pool_release(int32_t tokens) {
+  SharedPool::get().release(tokens);
+}
+
+// Return the number of shared cores, the number of them leased by all
+// processes and the number of processes with running launches. All are zero
+// without a shared pool.
+EXPORT void triton_cpu_shared_pool_stats(int32_t *capacity, int32_t *leased,
+                                         int32_t *active) {
+  SharedPool::get().stats(capacity, leased, active);
+}
+
+} // extern "C"
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+// Failed attempts that pause for 2^iteration cycles before threads
+// sleep, i.e. up to about 1K pauses, which covers short critical sections.
+constexpr int32_t SPIN_ITERATIONS = 10;
+// Bounds of timed sleeps. Locks released by plain atomics don't wake
+// sleepers, so sleeps are short and only grow while the lock stays taken.
+constexpr int64_t MIN_SLEEP_NS = 1000;
+constexpr int64_t MAX_SLEEP_NS = 100000;
+// Doublings of MIN_SLEEP_NS that reach MAX_SLEEP_NS.
+constexpr int32_t MAX_SLEEP_SHIFT = 7;
+
+void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#elif defined(__riscv)
+  // Zihintpause pause, a hint executed as a fence on older cores.
+  asm volatile(".insn i 0x0f, 0, x0, x0, 0x010" ::: "memory");
+#endif
+}
+
+template <typename T> T loadRelaxed(const void *ptr) {
+  return __atomic_load_n(static_cast<const T *>(ptr), __ATOMIC_RELAXED);
+}
+
+// Sleep until the 32-bit value at ptr isn't current anymore or the timeout
+// expires.
+void sleepWhileEqual(void *ptr, int32_t current, int64_t ns) {
+#if defined(__linux__)
+  struct timespec timeout = {0, static_cast<long>(ns)};
+  syscall(SYS_futex, ptr, FUTEX_WAIT_PRIVATE, current, &timeout, nullptr, 0);
+#else
+  std::this_thread::yield();
+#endif
+}
+
+} // namespace
+
+extern "C" {
+
+// Back off before the next attempt of a compare-and-swap spin loop, see
+// triton_cpu.spin_wait. The first failed attempts pause with exponential
+// backoff. Later ones sleep while the value at ptr isn't expected with a
+// futex for 32-bit values and yield for others. The iteration is saturated
+// before shifting, since the counter of the loop may wrap around in long
+// waits.
+EXPORT void triton_cpu_spin_wait(void *ptr, int64_t expected, int32_t bytes,
+                                 int32_t iteration) {
+  iteration = std::clamp(iteration, 0, SPIN_ITERATIONS + MAX_SLEEP_SHIFT);
+  if (iteration < SPIN_ITERATIONS) {
+    for (int32_t i = 0; i < (1 << iteration); ++i)
+      cpuRelax();
+    return;
+  }
+  if (bytes != 4) {
+    if (loadRelaxed<int64_t>(ptr) != expected)
+      std::this_thread::yield();
+    return;
+  }
+  int32_t current = loadRelaxed<int32_t>(ptr);
+  if (current == static_cast<int32_t>(expected))
+    return;
+  int32_t shift = iteration - SPIN_ITERATIONS;
+  sleepWhileEqual(ptr, current,
+                  std::min(MIN_SLEEP_NS << shift, MAX_SLEEP_NS));
+}
+
+} // extern "C"
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "runtime_stats.h"
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+// Names of counters in stats.py, indexed by StatCounter.
+const char *const COUNTER_NAMES[NUM_COUNTERS] = {
+    "pool_jobs",         "pool_thread_ns",    "pool_busy_ns",
+    "pool_dispatches",   "pool_dispatch_ns",  "pool_slot_waits",
+    "pool_slot_wait_ns", "brgemm_lookups",
+};
+
+// Launches of a kernel. Keep in sync with KernelStats in stats.py.
+struct KernelStats {
+  const void *kernel;
+  uint64_t launches;
+  uint64_t programs;
+  // Wall time of launches in nanoseconds.
+  uint64_t ns;
+};
+
+// Always-on counters. Each thread updates its own block without atomic
+// read-modify-write operations, readers sum blocks of all threads. Blocks
+// outlive their threads, so counts of exited threads are kept.
+class RuntimeStats {
+public:
+  static RuntimeStats &get() {
+    static RuntimeStats *stats = new RuntimeStats();
+    return *stats;
+  }
+
+  void add(StatCounter counter, uint64_t value) {
+    std::atomic<uint64_t> &slot = localBlock().counters[counter];
+    slot.store(slot.load(std::memory_order_relaxed) + value,
+               std::memory_order_relaxed);
+  }
+
+  void recordLaunch(const void *kernel, uint64_t programs, uint64_t ns) {
+    Block &block = localBlock();
+    // Only readers contend for the lock of the block.
+    std::lock_guard<std::mutex> lock(block.kernelsMutex);
+    KernelStats &stats = block.kernels[kernel];
+    stats.launches += 1;
+    stats.programs += programs;
+    stats.ns += ns;
+  }
+
+  void read(uint64_t *values) {
+    std::fill(values, values + NUM_COUNTERS, 0);
+    std::lock_guard<std::mutex> lock(blocksMutex);
+    for (auto &block : blocks)
+      for (int i = 0; i < NUM_COUNTERS; ++i)
+        values[i] += block->counters[i].load(std::memory_order_relaxed);
+  }
+
+  // Copy up to maxKernels per-kernel stats summed over threads to out and
+  // return the number of kernels.
+  size_t readKernels(KernelStats *out, size_t maxKernels) {
+    std::unordered_map<const void *, KernelStats> sums;
+    {
+      std::lock_guard<std::mutex> lock(blocksMutex);
+      for (auto &block : blocks) {
+        std::lock_guard<std::mutex> blockLock(block->kernelsMutex);
+        for (auto &[kernel, stats] : block->kernels) {
+          KernelStats &sum = sums[kernel];
+          sum.launches += stats.launches;
+          sum.programs += stats.programs;
+          sum.ns += stats.ns;
+        }
+      }
+    }
+    size_t count = 0;
+    for (auto &[kernel, stats] : sums) {
+      if (count == maxKernels)
+        break;
+      out[count] = stats;
+      out[count++].kernel = kernel;
+    }
+    return sums.size();
+  }
+
+private:
+  struct alignas(64) Block {
+    std::atomic<uint64_t> counters[NUM_COUNTERS] = {};
+    std::mutex kernelsMutex;
+    std::unordered_map<const void *, KernelStats> kernels;
+  };
+
+  Block &localBlock() {
+    static thread_local std::shared_ptr<Block> block;
+    if (!block) {
+      block = std::make_shared<Block>();
+      std::lock_guard<std::mutex> lock(blocksMutex);
+      blocks.push_back(block);
+    }
+    return *block;
+  }
+
+  std::mutex blocksMutex;
+  std::vector<std::shared_ptr<Block>> blocks;
+};
+
+} // namespace
+
+extern "C" {
+
+// Add value to a counter of the calling thread, see StatCounter.
+EXPORT void triton_cpu_stats_add(int32_t counter, uint64_t value) {
+  if (counter >= 0 && counter < NUM_COUNTERS)
+    RuntimeStats::get().add(static_cast<StatCounter>(counter), value);
+}
+
+// Return the name of the counter, or null past the last one.
+EXPORT const char *triton_cpu_stats_counter_name(int32_t counter) {
+  return counter >= 0 && counter < NUM_COUNTERS ? COUNTER_NAMES[counter]
+                                                : nullptr;
+}
+
+// Record a launch of num_programs programs of the kernel that took ns
+// nanoseconds. Launchers call it for every launch.
+EXPORT void triton_cpu_stats_record_launch(const void *kernel,
+                                           uint64_t num_programs, int64_t ns) {
+  uint64_t wallNs = static_cast<uint64_t>(std::max<int64_t>(ns, 0));
+  RuntimeStats::get().recordLaunch(kernel, num_programs, wallNs);
+}
+
+// Copy NUM_COUNTERS counters summed over all threads into values. Counters
+// only grow, so monitoring systems can compute rates from their deltas.
+EXPORT void triton_cpu_stats_read(uint64_t *values) {
+  RuntimeStats::get().read(values);
+}
+
+// Copy up to max_kernels per-kernel stats into out and return the number of
+// launched kernels, which may be larger than max_kernels.
+EXPORT size_t triton_cpu_stats_read_kernels(KernelStats *out,
+                                            size_t max_kernels) {
+  return RuntimeStats::get().readKernels(out, max_kernels);
+}
+
+} // extern "C"
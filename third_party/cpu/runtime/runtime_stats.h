@@ -0,0 +1,30 @@
+#ifndef TRITONCPU_RUNTIME_RUNTIME_STATS_H
+#define TRITONCPU_RUNTIME_RUNTIME_STATS_H
+
+#include <cstdint>
+
+// Always-on counters of the runtime provided by runtime_stats.cpp. Names of
+// the counters are read by stats.py with triton_cpu_stats_counter_name.
+enum StatCounter : int32_t {
+  // Jobs run by the thread pool and the sum of their wall times multiplied by
+  // the number of their participants.
+  POOL_JOBS = 0,
+  POOL_THREAD_NS = 1,
+  // Time participants of pool jobs spent running programs.
+  POOL_BUSY_NS = 2,
+  // Jobs taken by pool workers and the time from the job submission to the
+  // start of the workers, i.e. the wake-up latency.
+  POOL_DISPATCHES = 3,
+  POOL_DISPATCH_NS = 4,
+  // Submissions that waited for free thread slots and the total wait time.
+  POOL_SLOT_WAITS = 5,
+  POOL_SLOT_WAIT_NS = 6,
+  // Calls of create_brgemm, most of which hit the thread caches of handles.
+  BRGEMM_LOOKUPS = 7,
+  NUM_COUNTERS = 8,
+};
+
+// Add value to a counter of the calling thread, see StatCounter.
+extern "C" void triton_cpu_stats_add(int32_t counter, uint64_t value);
+
+#endif // TRITONCPU_RUNTIME_RUNTIME_STATS_H
@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+using TaskFn = void (*)(void *ctx);
+
+// A task submitted to a stream or recorded into a graph. The destroy
+// function, if any, releases ctx when the task is no longer needed, i.e.
+// after it runs on a stream or when the graph holding it is destroyed.
+struct Task {
+  TaskFn fn;
+  void *ctx;
+  TaskFn destroy;
+
+  void release() {
+    if (destroy)
+      destroy(ctx);
+  }
+};
+
+// A recorded sequence of launches that can be replayed multiple times.
+// Launches are replayed with the same arguments they were captured with.
+class Graph {
+public:
+  ~Graph() {
+    for (auto &task : tasks)
+      task.release();
+  }
+
+  void add(const Task &task) { tasks.push_back(task); }
+
+  void run() const {
+    for (auto &task : tasks)
+      task.fn(task.ctx);
+  }
+
+  size_t size() const { return tasks.size(); }
+
+private:
+  std::vector<Task> tasks;
+};
+
+// An in-order queue of launches. Each stream owns a dispatcher thread that
+// runs submitted tasks one by one, so launches on the same stream are
+// ordered while the submitting thread proceeds immediately. Tasks typically
+// run kernels on the shared thread pool.
+class Stream {
+public:
+  Stream() : dispatcher([this]() { dispatch(); }) {}
+
+  ~Stream() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    queueCv.notify_one();
+    dispatcher.join();
+  }
+
+  void enqueue(const Task &task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (capturing) {
+        capturing->add(task);
+        return;
+      }
+      queue.push_back(task);
+      ++submitted;
+    }
+    queueCv.notify_one();
+  }
+
+  // While capturing, submitted tasks are recorded into the graph instead of
+  // being executed.
+  void beginCapture(Graph *graph) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capturing = graph;
+  }
+
+  void endCapture() {
+    std::lock_guard<std::mutex> lock(mutex);
+    capturing = nullptr;
+  }
+
+  void synchronize() {
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t target = submitted;
+    doneCv.wait(lock, [&]() { return completed >= target; });
+  }
+
+  bool query() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return completed == submitted;
+  }
+
+private:
+  void dispatch() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      queueCv.wait(lock, [&]() { return stop || !queue.empty(); });
+      // Drain the queue before stopping, so that destroying a stream doesn't
+      // drop submitted launches.
+      if (queue.empty())
+        return;
+      Task task = queue.front();
+      queue.pop_front();
+      lock.unlock();
+      task.fn(task.ctx);
+      task.release();
+      lock.lock();
+      ++completed;
+      doneCv.notify_all();
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable queueCv;
+  std::condition_variable doneCv;
+  std::deque<Task> queue;
+  uint64_t submitted = 0;
+  uint64_t completed = 0;
+  bool stop = false;
+  Graph *capturing = nullptr;
+  std::thread dispatcher;
+};
+
+// Dependency of the programs of consumer launches on chunks of the programs
+// of producer launches, usually running on another stream. Programs of the
+// producer are split into chunks of consecutive linear program ids, and each
+// consumer program waits only for the chunk it reads, so the consumer
+// processes chunks while they are still in the cache instead of waiting for
+// the whole producer launch.
+//
+// The dependency pairs the r-th producer launch with the r-th consumer
+// launch, counting launches in the order they run on their streams. Counters
+// of completed programs accumulate over rounds, so launches can be repeated,
+// e.g. in a pipeline or a graph replay, without resetting the dependency.
+class RangeDependency {
+public:
+  // Start the next round of the producer with num_programs programs split
+  // into chunks of chunk_size. Return the round. Chunks are fixed by the
+  // first round, later rounds are expected to have the same grid.
+  uint64_t beginProducer(size_t numPrograms, size_t chunkSize) {
+    std::call_once(init, [&]() {
+      this->numPrograms = numPrograms;
+      this->chunkSize = std::max<size_t>(chunkSize, 1);
+      size_t numChunks = (numPrograms + this->chunkSize - 1) / this->chunkSize;
+      done.reset(new std::atomic<uint64_t>[numChunks]());
+      this->numChunks = numChunks;
+    });
+    return ++producerRounds;
+  }
+
+  // Mark the producer round as running. Called by threads of the producer
+  // launch, i.e. once the pool gave it threads, so after this the producer
+  // makes progress regardless of consumers waiting for it.
+  void markStarted(uint64_t round) {
+    uint64_t prev = started.load(std::memory_order_relaxed);
+    while (prev < round &&
+           !started.compare_exchange_weak(prev, round,
+                                          std::memory_order_release))
+      ;
+  }
+
+  // Record completion of producer programs [begin, end).
+  void signal(size_t begin, size_t end) {
+    end = std::min(end, numPrograms);
+    while (begin < end) {
+      size_t chunk = begin / chunkSize;
+      size_t chunkEnd = std::min((chunk + 1) * chunkSize, end);
+      done[chunk].fetch_add(chunkEnd - begin, std::memory_order_release);
+      begin = chunkEnd;
+    }
+  }
+
+  // Start the next round of the consumer and wait until the producer round
+  // it depends on runs. Consumers only take pool threads after that, so
+  // they can't starve the producer of threads. Return the round.
+  uint64_t beginConsumer() {
+    uint64_t round = ++consumerRounds;
+    spinUntil([&]() {
+      return started.load(std::memory_order_acquire) >= round;
+    });
+    return round;
+  }
+
+  // Wait until producer chunks read by consumer programs [begin, end),
+  // taking chunk_size consumer programs per producer chunk, are complete.
+  void wait(uint64_t round, size_t begin, size_t end, size_t chunkSize) {
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    size_t first = begin / chunkSize;
+    size_t last = std::min((end - 1) / chunkSize + 1, numChunks);
+    for (size_t chunk = first; chunk < last; ++chunk) {
+      uint64_t expected =
+          round * (std::min((chunk + 1) * this->chunkSize, numPrograms) -
+                   chunk * this->chunkSize);
+      spinUntil([&]() {
+        return done[chunk].load(std::memory_order_acquire) >= expected;
+      });
+    }
+  }
+
+private:
+  // Chunks complete in microseconds, so poll a while before yielding.
+  template <typename Pred> static void spinUntil(Pred pred) {
+    for (int i = 0; !pred(); ++i)
+      if (i >= 1024)
+        std::this_thread::yield();
+  }
+
+  std::once_flag init;
+  size_t numPrograms = 0;
+  size_t chunkSize = 1;
+  size_t numChunks = 0;
+  std::unique_ptr<std::atomic<uint64_t>[]> done;
+  std::atomic<uint64_t> producerRounds{0};
+  std::atomic<uint64_t> consumerRounds{0};
+  std::atomic<uint64_t> started{0};
+};
+
+// Dependencies of launches submitted by the calling thread, see
+// triton_cpu_range_dep_set_current.
+thread_local void *currentProducer = nullptr;
+thread_local int64_t currentProducerChunk = 0;
+thread_local void *currentConsumer = nullptr;
+thread_local int64_t currentConsumerChunk = 0;
+
+} // namespace
+
+extern "C" {
+
+EXPORT void *triton_cpu_stream_create() { return new Stream(); }
+
+// Wait for all submitted launches and destroy the stream.
+EXPORT void triton_cpu_stream_destroy(void *stream) {
+  delete static_cast<Stream *>(stream);
+}
+
+// Submit fn(ctx) to run after all previously submitted tasks of the stream.
+// destroy(ctx), if not null, is called when the task is no longer needed.
+EXPORT void triton_cpu_stream_enqueue(void *stream, TaskFn fn, void *ctx,
+                                      TaskFn destroy) {
+  static_cast<Stream *>(stream)->enqueue({fn, ctx, destroy});
+}
+
+// Block until all tasks submitted to the stream before this call complete.
+EXPORT void triton_cpu_stream_synchronize(void *stream) {
+  static_cast<Stream *>(stream)->synchronize();
+}
+
+// Return true if all submitted tasks are complete.
+EXPORT bool triton_cpu_stream_query(void *stream) {
+  return static_cast<Stream *>(stream)->query();
+}
+
+EXPORT void *triton_cpu_graph_create() { return new Graph(); }
+
+EXPORT void triton_cpu_graph_destroy(void *graph) {
+  delete static_cast<Graph *>(graph);
+}
+
+EXPORT int64_t triton_cpu_graph_size(void *graph) {
+  return static_cast<Graph *>(graph)->size();
+}
+
+// Record tasks submitted to the stream into the graph until
+// triton_cpu_stream_end_capture is called.
+EXPORT void triton_cpu_stream_begin_capture(void *stream, void *graph) {
+  static_cast<Stream *>(stream)->beginCapture(static_cast<Graph *>(graph));
+}
+
+EXPORT void triton_cpu_stream_end_capture(void *stream) {
+  static_cast<Stream *>(stream)->endCapture();
+}
+
+// Replay the graph. With a null stream, the graph runs synchronously on the
+// calling thread, otherwise it is submitted to the stream as a single task.
+// The graph must outlive the replay.
+EXPORT void triton_cpu_graph_launch(void *graph, void *stream) {
+  auto run = [](void *ctx) { static_cast<Graph *>(ctx)->run(); };
+  if (stream)
+    static_cast<Stream *>(stream)->enqueue({run, graph, nullptr});
+  else
+    run(graph);
+}
+
+EXPORT void *triton_cpu_range_dep_create() { return new RangeDependency(); }
+
+// Destroy the dependency. Launches using it must be complete.
+EXPORT void triton_cpu_range_dep_destroy(void *dep) {
+  delete static_cast<RangeDependency *>(dep);
+}
+
+// Make launches submitted by the calling thread produce chunks of
+// producer_chunk programs of the producer dependency and wait for chunks of
+// the consumer dependency, consumer_chunk programs per chunk. Null
+// dependencies are ignored.
+EXPORT void triton_cpu_range_dep_set_current(void *producer,
+                                             int64_t producer_chunk,
+                                             void *consumer,
+                                             int64_t consumer_chunk) {
+  currentProducer = producer;
+  currentProducerChunk = producer_chunk;
+  currentConsumer = consumer;
+  currentConsumerChunk = consumer_chunk;
+}
+
+EXPORT void triton_cpu_range_dep_get_current(void **producer,
+                                             int64_t *producer_chunk,
+                                             void **consumer,
+                                             int64_t *consumer_chunk) {
+  *producer = currentProducer;
+  *producer_chunk = currentProducerChunk;
+  *consumer = currentConsumer;
+  *consumer_chunk = currentConsumerChunk;
+}
+
+EXPORT uint64_t triton_cpu_range_dep_begin_producer(void *dep,
+                                                    size_t num_programs,
+                                                    size_t chunk) {
+  return static_cast<RangeDependency *>(dep)->beginProducer(num_programs,
+                                                            chunk);
+}
+
+EXPORT void triton_cpu_range_dep_mark_started(void *dep, uint64_t round) {
+  static_cast<RangeDependency *>(dep)->markStarted(round);
+}
+
+EXPORT void triton_cpu_range_dep_signal(void *dep, size_t begin, size_t end) {
+  static_cast<RangeDependency *>(dep)->signal(begin, end);
+}
+
+EXPORT uint64_t triton_cpu_range_dep_begin_consumer(void *dep) {
+  return static_cast<RangeDependency *>(dep)->beginConsumer();
+}
+
+EXPORT void triton_cpu_range_dep_wait(void *dep, uint64_t round, size_t begin,
+                                      size_t end, size_t chunk) {
+  static_cast<RangeDependency *>(dep)->wait(round, begin, end, chunk);
+}
+
+} // extern "C"
@@ -0,0 +1,118 @@
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+extern "C" void triton_cpu_stream_enqueue(void *stream, void (*fn)(void *),
+                                          void *ctx, void (*destroy)(void *));
+
+namespace {
+
+// Slots of per-thread partials are padded to cache lines. A slot holds the
+// partial result followed by the target pointer at byte 8, which a kernel
+// records when it updates the slot, see DeferScalarAtomics.
+constexpr size_t SLOT_SIZE = 64;
+constexpr size_t TARGET_OFFSET = 8;
+
+// Element types of partials, see _ThreadPartials of the driver.
+enum PartialsType : int32_t { I32 = 0, I64 = 1, F32 = 2, F64 = 3 };
+
+std::atomic<int32_t> nextThreadSlot{0};
+
+// Add val to *target atomically, other launches may update it concurrently.
+template <typename T> void atomicAdd(T *target, T val) {
+  T expected, desired;
+  __atomic_load(target, &expected, __ATOMIC_RELAXED);
+  do {
+    desired = expected + val;
+  } while (!__atomic_compare_exchange(target, &expected, &desired,
+                                      /*weak=*/true, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED));
+}
+
+// Sum partials in slot order into the target and reset the used slots for
+// the next launch. Slots of threads that ran no program have no target.
+template <typename T> void combine(char *slots, int32_t numSlots) {
+  T *target = nullptr;
+  T sum = 0;
+  for (int32_t i = 0; i < numSlots; ++i) {
+    char *slot = slots + i * SLOT_SIZE;
+    T *slotTarget;
+    std::memcpy(&slotTarget, slot + TARGET_OFFSET, sizeof(slotTarget));
+    if (!slotTarget)
+      continue;
+    target = slotTarget;
+    T val;
+    std::memcpy(&val, slot, sizeof(T));
+    sum += val;
+    std::memset(slot, 0, TARGET_OFFSET + sizeof(slotTarget));
+  }
+  if (target)
+    atomicAdd(target, sum);
+}
+
+void combine(char *slots, int32_t numSlots, int32_t type) {
+  switch (type) {
+  case I32:
+    combine<int32_t>(slots, numSlots);
+    break;
+  case I64:
+    combine<int64_t>(slots, numSlots);
+    break;
+  case F32:
+    combine<float>(slots, numSlots);
+    break;
+  case F64:
+    combine<double>(slots, numSlots);
+    break;
+  }
+}
+
+struct CombineTask {
+  char *slots;
+  int32_t numSlots;
+  int32_t type;
+};
+
+void runCombineTask(void *ctx) {
+  auto *task = static_cast<CombineTask *>(ctx);
+  combine(task->slots, task->numSlots, task->type);
+}
+
+void destroyCombineTask(void *ctx) { delete static_cast<CombineTask *>(ctx); }
+
+} // namespace
+
+extern "C" {
+
+// Return the slot of the calling thread in buffers of num_slots per-thread
+// partials. Threads get consecutive slots on first use, which wrap around
+// when there are more threads than slots.
+EXPORT int32_t triton_cpu_thread_slot(int32_t num_slots) {
+  thread_local int32_t slot =
+      nextThreadSlot.fetch_add(1, std::memory_order_relaxed);
+  return slot % num_slots;
+}
+
+// Combine per-thread partials of a launch into their target. With a
+// stream, the combine runs after previously submitted launches of the
+// stream, otherwise it runs immediately.
+EXPORT void triton_cpu_combine_thread_partials(void *stream, void *slots,
+                                               int32_t num_slots,
+                                               int32_t type) {
+  if (!stream) {
+    combine(static_cast<char *>(slots), num_slots, type);
+    return;
+  }
+  auto *task = new CombineTask{static_cast<char *>(slots), num_slots, type};
+  triton_cpu_stream_enqueue(stream, runCombineTask, task, destroyCombineTask);
+}
+
+} // extern "C"
@@ -0,0 +1,1231 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "runtime_perf_counters.h"
+#include "runtime_stats.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+#define EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define EXPORT __attribute__((visibility("default")))
+#else
+#define EXPORT
+#endif
+
+namespace {
+
+// Signature of a task executed by the pool. Each participating thread gets a
+// contiguous [begin, end) range of the iteration space.
+using TaskFn = void (*)(void *ctx, size_t begin, size_t end);
+
+// Keep in sync with the launcher code in driver.py.
+enum class Schedule : int32_t {
+  // Each participant runs a single contiguous chunk of the iteration space.
+  Static = 0,
+  // Each participant starts with a contiguous chunk and processes it in small
+  // pieces. Participants that run out of work steal the second half of the
+  // remaining work of other participants.
+  Steal = 1,
+};
+
+// Special values of the numa_node argument of triton_cpu_parallel_for. Keep
+// in sync with the launcher code in driver.py.
+constexpr int32_t NUMA_DISABLED = -2;
+constexpr int32_t NUMA_ANY_NODE = -1;
+
+// Keep in sync with the launcher code in driver.py.
+enum class Placement : int32_t {
+  // Each worker can run on any of the selected CPUs.
+  None = 0,
+  // Workers are pinned to the selected CPUs filling cores and packages one by
+  // one, SMT siblings of a core get consecutive workers.
+  Compact = 1,
+  // Workers are pinned to the selected CPUs round-robin over packages first,
+  // then over cores. SMT siblings are used after all cores are taken.
+  Scatter = 2,
+};
+
+// Keep in sync with the launcher code in driver.py.
+enum class CoreType : int32_t {
+  Any = 0,
+  // Performance cores of hybrid CPUs, e.g. P-cores of Intel Alder Lake or
+  // big cores of Arm big.LITTLE. All cores of non-hybrid CPUs.
+  Performance = 1,
+  // Efficiency cores of hybrid CPUs, e.g. E-cores or LITTLE cores.
+  Efficiency = 2,
+};
+
+// Number of pieces each participant initially splits its chunk into in the
+// work-stealing mode.
+constexpr size_t STEAL_PIECES_PER_THREAD = 16;
+
+// Number of polling iterations a worker performs before parking on the
+// condition variable. Kernel launches usually come in bursts, so spinning
+// for a short while avoids paying the wake-up latency of a futex on every
+// launch.
+constexpr int DEFAULT_SPIN_COUNT = 1 << 16;
+
+// Number of polling iterations of workers of processes sharing cores, see
+// runtime_shared_pool.cpp. They park quickly, so they don't burn cores that
+// other processes lease between launches.
+constexpr int SHARED_SPIN_COUNT = 1 << 10;
+
+// Minimal amount of work per thread, in nanoseconds, for the adaptive thread
+// count. Waking up a thread and joining it costs a few microseconds, so
+// smaller launches run faster on fewer threads.
+constexpr int DEFAULT_MIN_THREAD_WORK_NS = 20000;
+
+int getIntEnv(const char *name, int defaultVal) {
+  const char *str = std::getenv(name);
+  if (!str)
+    return defaultVal;
+  char *end;
+  long val = std::strtol(str, &end, 10);
+  if (end == str)
+    return defaultVal;
+  return static_cast<int>(val);
+}
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Parse a CPU list in the Linux sysfs format, e.g. "0-3,8,10-11".
+std::vector<int> parseCpuList(const std::string &str) {
+  std::vector<int> res;
+  std::stringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty() || item == "\n")
+      continue;
+    size_t dash = item.find('-');
+    char *end;
+    int first = std::strtol(item.c_str(), &end, 10);
+    int last = dash == std::string::npos
+                   ? first
+                   : std::strtol(item.c_str() + dash + 1, &end, 10);
+    for (int cpu = first; cpu <= last; ++cpu)
+      res.push_back(cpu);
+  }
+  return res;
+}
+
+std::string readFirstLine(const std::string &path) {
+  std::ifstream file(path);
+  std::string line;
+  if (file)
+    std::getline(file, line);
+  return line;
+}
+
+// CPUs of each NUMA node of the host. Empty if the topology cannot be
+// detected.
+const std::vector<std::vector<int>> &getNumaNodes() {
+  static const std::vector<std::vector<int>> nodes = []() {
+    std::vector<std::vector<int>> res;
+#if defined(__linux__)
+    for (int node = 0;; ++node) {
+      std::string cpuList = readFirstLine("/sys/devices/system/node/node" +
+                                          std::to_string(node) + "/cpulist");
+      if (cpuList.empty())
+        break;
+      res.push_back(parseCpuList(cpuList));
+    }
+#endif
+    return res;
+  }();
+  return nodes;
+}
+
+// Return the NUMA node holding the page at the specified address or -1 if it
+// is unknown.
+int getNumaNodeOfAddress(const void *ptr) {
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+  // Values from linux/mempolicy.h.
+  constexpr unsigned long MPOL_F_NODE = 1 << 0;
+  constexpr unsigned long MPOL_F_ADDR = 1 << 1;
+  int node = -1;
+  if (syscall(SYS_get_mempolicy, &node, nullptr, 0, ptr,
+              MPOL_F_NODE | MPOL_F_ADDR) == 0)
+    return node;
+#endif
+  return -1;
+}
+
+// CPUs of each core type of a hybrid CPU, empty if the CPU isn't hybrid.
+struct HybridCpus {
+  std::vector<int> performance;
+  std::vector<int> efficiency;
+};
+
+const HybridCpus &getHybridCpus() {
+  static const HybridCpus cpus = []() {
+    HybridCpus res;
+#if defined(__linux__)
+    // Intel hybrid CPUs expose a PMU per core type.
+    res.performance = parseCpuList(readFirstLine("/sys/devices/cpu_core/cpus"));
+    res.efficiency = parseCpuList(readFirstLine("/sys/devices/cpu_atom/cpus"));
+    if (!res.performance.empty() && !res.efficiency.empty())
+      return res;
+    res = {};
+    // Arm big.LITTLE CPUs report the relative capacity of each CPU.
+    std::map<int, int> capacity;
+    for (int cpu : parseCpuList(
+             readFirstLine("/sys/devices/system/cpu/possible"))) {
+      std::string str = readFirstLine("/sys/devices/system/cpu/cpu" +
+                                      std::to_string(cpu) + "/cpu_capacity");
+      if (!str.empty())
+        capacity[cpu] = std::atoi(str.c_str());
+    }
+    int maxCapacity = 0;
+    for (auto [cpu, cap] : capacity)
+      maxCapacity = std::max(maxCapacity, cap);
+    for (auto [cpu, cap] : capacity)
+      (cap == maxCapacity ? res.performance : res.efficiency).push_back(cpu);
+    if (res.efficiency.empty())
+      res = {};
+#endif
+    return res;
+  }();
+  return cpus;
+}
+
+// Relative performance of a CPU. Only meaningful on hybrid CPUs, where it is
+// the reported capacity or the maximum frequency of the CPU.
+double getCpuCapacity(int cpu) {
+  std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/";
+  std::string str = readFirstLine(dir + "cpu_capacity");
+  if (str.empty())
+    str = readFirstLine(dir + "cpufreq/cpuinfo_max_freq");
+  double res = str.empty() ? 0.0 : std::atof(str.c_str());
+  return res > 0.0 ? res : 1.0;
+}
+
+struct CpuTopology {
+  int cpu;
+  int package;
+  int core;
+  // Index of the CPU among the SMT siblings of its core.
+  int smtIndex;
+  CoreType coreType;
+};
+
+CpuTopology getCpuTopology(int cpu) {
+  std::string dir =
+      "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+  auto readInt = [&](const std::string &name) {
+    std::string str = readFirstLine(dir + name);
+    return str.empty() ? 0 : std::atoi(str.c_str());
+  };
+  std::vector<int> siblings =
+      parseCpuList(readFirstLine(dir + "thread_siblings_list"));
+  int smtIndex =
+      std::find(siblings.begin(), siblings.end(), cpu) - siblings.begin();
+  if (smtIndex == static_cast<int>(siblings.size()))
+    smtIndex = 0;
+  const auto &efficiency = getHybridCpus().efficiency;
+  CoreType coreType =
+      std::find(efficiency.begin(), efficiency.end(), cpu) != efficiency.end()
+          ? CoreType::Efficiency
+          : CoreType::Performance;
+  return {cpu, readInt("physical_package_id"), readInt("core_id"), smtIndex,
+          coreType};
+}
+
+// CPUs the process is allowed to run on.
+const std::vector<int> &getProcessCpus() {
+  static const std::vector<int> cpus = []() {
+    std::vector<int> res;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        if (CPU_ISSET(cpu, &set))
+          res.push_back(cpu);
+#endif
+    return res;
+  }();
+  return cpus;
+}
+
+// Select CPUs for worker threads. For pinned placements, the result is
+// ordered so that the i-th worker is pinned to the i-th CPU.
+std::vector<int> selectCpus(const char *cpuMask, Placement placement,
+                            bool oneThreadPerCore, CoreType coreType) {
+  std::vector<int> cpus =
+      cpuMask && *cpuMask ? parseCpuList(cpuMask) : getProcessCpus();
+  std::vector<CpuTopology> topology;
+  for (int cpu : cpus) {
+    CpuTopology info = getCpuTopology(cpu);
+    if ((!oneThreadPerCore || info.smtIndex == 0) &&
+        (coreType == CoreType::Any || info.coreType == coreType))
+      topology.push_back(info);
+  }
+
+  if (placement == Placement::Compact) {
+    std::sort(topology.begin(), topology.end(), [](auto &lhs, auto &rhs) {
+      return std::tie(lhs.package, lhs.core, lhs.smtIndex, lhs.cpu) <
+             std::tie(rhs.package, rhs.core, rhs.smtIndex, rhs.cpu);
+    });
+  } else if (placement == Placement::Scatter) {
+    // Rank cores within each package to interleave packages.
+    std::map<std::pair<int, int>, int> coreRank;
+    std::map<int, int> numCores;
+    std::sort(topology.begin(), topology.end(), [](auto &lhs, auto &rhs) {
+      return std::tie(lhs.package, lhs.core) < std::tie(rhs.package, rhs.core);
+    });
+    for (auto &info : topology)
+      if (coreRank.emplace(std::make_pair(info.package, info.core),
+                           numCores[info.package])
+              .second)
+        ++numCores[info.package];
+    std::sort(topology.begin(), topology.end(), [&](auto &lhs, auto &rhs) {
+      int lhsRank = coreRank[{lhs.package, lhs.core}];
+      int rhsRank = coreRank[{rhs.package, rhs.core}];
+      return std::tie(lhs.smtIndex, lhsRank, lhs.package, lhs.cpu) <
+             std::tie(rhs.smtIndex, rhsRank, rhs.package, rhs.cpu);
+    });
+  }
+
+  std::vector<int> res;
+  for (auto &info : topology)
+    res.push_back(info.cpu);
+  return res;
+}
+
+bool setThreadAffinity(std::thread &thread, const std::vector<int> &cpus) {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus)
+    if (cpu >= 0 && cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) ==
+         0;
+#else
+  return false;
+#endif
+}
+
+// A chunk of a job executed by a thread, see Timeline.
+struct TimelineEvent {
+  // Sequence number of the job.
+  uint64_t job;
+  // OS id of the executing thread and the CPU it started the chunk on.
+  int64_t thread;
+  int32_t cpu;
+  // Range of iterations of the chunk.
+  uint64_t begin;
+  uint64_t end;
+  // Steady clock timestamps in nanoseconds.
+  int64_t start_ns;
+  int64_t end_ns;
+};
+
+int64_t steadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int64_t currentThreadId() {
+#if defined(__linux__) && defined(SYS_gettid)
+  return static_cast<int64_t>(syscall(SYS_gettid));
+#else
+  return static_cast<int64_t>(
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+#endif
+}
+
+int32_t currentCpu() {
+#if defined(__linux__)
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
+
+// Optional recording of chunks executed by each thread, used to diagnose
+// load imbalance. Each thread appends events to its own buffer, so threads
+// don't contend while recording. Buffers outlive their threads until the
+// events are read.
+class Timeline {
+public:
+  static Timeline &get() {
+    static Timeline *timeline = new Timeline();
+    return *timeline;
+  }
+
+  std::atomic<bool> enabled{false};
+
+  uint64_t nextJob() {
+    return jobs.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  void record(const TimelineEvent &event) {
+    Buffer &buf = localBuffer();
+    std::lock_guard<std::mutex> lock(buf.mutex);
+    buf.events.push_back(event);
+  }
+
+  // Move up to maxEvents recorded events to out.
+  size_t read(TimelineEvent *out, size_t maxEvents) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    size_t count = 0;
+    for (auto &buf : buffers) {
+      std::lock_guard<std::mutex> bufLock(buf->mutex);
+      size_t take = std::min(maxEvents - count, buf->events.size());
+      std::copy(buf->events.begin(), buf->events.begin() + take, out + count);
+      buf->events.erase(buf->events.begin(), buf->events.begin() + take);
+      count += take;
+    }
+    return count;
+  }
+
+private:
+  struct Buffer {
+    std::mutex mutex;
+    std::vector<TimelineEvent> events;
+  };
+
+  Buffer &localBuffer() {
+    static thread_local std::shared_ptr<Buffer> buf;
+    if (!buf) {
+      buf = std::make_shared<Buffer>();
+      std::lock_guard<std::mutex> lock(buffersMutex);
+      buffers.push_back(buf);
+    }
+    return *buf;
+  }
+
+  std::atomic<uint64_t> jobs{0};
+  std::mutex buffersMutex;
+  std::vector<std::shared_ptr<Buffer>> buffers;
+};
+
+// Cores shared with other processes provided by runtime_shared_pool.cpp.
+extern "C" bool triton_cpu_shared_pool_enabled();
+extern "C" int32_t triton_cpu_shared_pool_lease(int32_t num_threads,
+                                                int32_t *tokens);
+extern "C" void triton_cpu_shared_pool_release(int32_t tokens);
+
+// Hardware event counts of the last job submitted by the thread, summed over
+// its participants.
+struct JobCounters {
+  int32_t numCounters = 0;
+  uint64_t values[MAX_PERF_COUNTERS];
+};
+
+thread_local JobCounters lastJobCounters;
+
+// Process-wide pool of persistent worker threads. The thread submitting a
+// job is thread 0 of the job, so a pool of size N owns N - 1 worker threads.
+//
+// The pool size is the budget of active threads shared by all submitting
+// threads. A job takes a number of thread slots: one per worker it runs on
+// and one for the submitting thread if it participates. Jobs submitted
+// concurrently run at the same time on disjoint sets of workers. When no
+// slots are available, submissions wait in the order of their priority, then
+// of their arrival.
+//
+// Usually, a job includes the submitting thread, but in the NUMA mode and
+// when a custom affinity is used, only the pinned worker threads participate.
+class ThreadPool {
+public:
+  static ThreadPool &get() {
+    // Intentionally leaked to avoid joining workers during static
+    // destruction, when the kernel libraries may already be unloaded.
+    static ThreadPool *pool = new ThreadPool(defaultSize());
+    return *pool;
+  }
+
+  int size() const { return static_cast<int>(workers.size()) + 1; }
+
+  void parallelFor(size_t n, int numThreads, Schedule schedule, size_t align,
+                   int numaNode, int priority, TaskFn fn, void *ctx) {
+    lastJobCounters.numCounters = 0;
+    if (n == 0)
+      return;
+
+    // Workers [begin, end) can run the job.
+    bool callerRuns = false;
+    int begin = 1;
+    int end = size();
+    if (int affinityWorkers = numAffinityWorkers.load()) {
+      end = 1 + affinityWorkers;
+    } else if (numaNode != NUMA_DISABLED && enableNuma()) {
+      if (numaNode >= 0 && numaNode < static_cast<int>(nodeWorkers.size()))
+        std::tie(begin, end) = nodeWorkers[numaNode];
+    } else {
+      callerRuns = true;
+    }
+    int count = end - begin + callerRuns;
+    if (numThreads > 0)
+      count = std::min(count, numThreads);
+    align = std::max<size_t>(align, 1);
+    count = static_cast<int>(std::min<size_t>(static_cast<size_t>(count),
+                                              (n + align - 1) / align));
+
+    // Buffers of the submitting thread reused across its jobs.
+    static thread_local std::vector<int> ids;
+    static thread_local std::vector<double> capacities;
+    static thread_local std::unique_ptr<WorkRange[]> ranges;
+    static thread_local int numRanges = 0;
+
+    int slots = acquire(count, priority, callerRuns, begin, end, &ids);
+    // Cores leased from the shared pool, if the process shares cores with
+    // other processes. Slots over the lease are given back right away.
+    int32_t tokens = 0;
+    int leased = triton_cpu_shared_pool_lease(slots, &tokens);
+    if (leased < slots) {
+      shrink(slots - leased, ids);
+      slots = leased;
+    }
+    Job job;
+    job.fn = fn;
+    job.ctx = ctx;
+    job.submitNs = steadyNowNs();
+    if (Timeline::get().enabled.load(std::memory_order_relaxed))
+      job.timelineId = Timeline::get().nextJob();
+    if (triton_cpu_perf_enabled()) {
+      job.numCounters = triton_cpu_perf_num_counters();
+      for (int i = 0; i < job.numCounters; ++i)
+        job.counters[i].store(0, std::memory_order_relaxed);
+    }
+    job.n = n;
+    job.align = align;
+    job.participants = slots;
+    if (slots == 1 && callerRuns) {
+      run(job, 0, job.submitNs);
+      release(slots, ids);
+      triton_cpu_shared_pool_release(tokens);
+      saveCounters(job);
+      recordStats(job);
+      return;
+    }
+
+    // Work ranges are packed into 32-bit halves of a 64-bit word.
+    job.schedule = n > UINT32_MAX ? Schedule::Static : schedule;
+    // Capacities are known for pinned workers only, see setAffinity.
+    if (!callerRuns && !workerCapacity.empty()) {
+      capacities.assign(1, 0.0);
+      for (int id : ids)
+        capacities.push_back(capacities.back() + workerCapacity[id]);
+      job.capacityPrefix = capacities.data();
+    }
+    if (job.schedule == Schedule::Steal) {
+      if (numRanges < slots) {
+        ranges.reset(new WorkRange[slots]);
+        numRanges = slots;
+      }
+      job.ranges = ranges.get();
+      job.grain = alignUp(n / (slots * STEAL_PIECES_PER_THREAD), align);
+      for (int i = 0; i < slots; ++i)
+        job.ranges[i].bounds.store(
+            packRange(chunkBegin(job, i), chunkBegin(job, i + 1)),
+            std::memory_order_relaxed);
+    }
+    job.pending.store(static_cast<int>(ids.size()), std::memory_order_relaxed);
+
+    // Publish the job to its workers.
+    for (size_t i = 0; i < ids.size(); ++i) {
+      WorkerState &worker = states[ids[i]];
+      worker.idx = static_cast<int>(i) + callerRuns;
+      worker.job.store(&job, std::memory_order_seq_cst);
+    }
+    if (parked.load(std::memory_order_seq_cst) > 0) {
+      std::lock_guard<std::mutex> parkGuard(parkMutex);
+      parkCv.notify_all();
+    }
+
+    if (callerRuns)
+      run(job, 0, steadyNowNs());
+
+    for (int i = 0; job.pending.load(std::memory_order_acquire) != 0; ++i) {
+      if (i < spinCount)
+        cpuRelax();
+      else
+        std::this_thread::yield();
+    }
+    release(slots, ids);
+    triton_cpu_shared_pool_release(tokens);
+    saveCounters(job);
+    recordStats(job);
+  }
+
+  // Take up to count thread slots for threads that are not pool workers,
+  // waiting for at least one slot to be available.
+  int acquireExternal(int count, int priority) {
+    return acquire(count, priority, true, 0, 0, nullptr);
+  }
+
+  void releaseExternal(int count) {
+    std::lock_guard<std::mutex> lock(schedMutex);
+    freeSlots += count;
+    if (!waiters.empty())
+      schedCv.notify_all();
+  }
+
+  // Restrict worker threads to a set of CPUs. The submitting thread doesn't
+  // participate in jobs while a custom affinity is set, so the work runs on
+  // the selected CPUs only. Null cpuMask with no placement, oneThreadPerCore
+  // disabled and any core type restores the default unpinned pool.
+  //
+  // When workers are pinned to cores of different types, the static schedule
+  // gives each worker a share of the work proportional to the capacity of
+  // its core.
+  void setAffinity(const char *cpuMask, Placement placement,
+                   bool oneThreadPerCore, CoreType coreType) {
+    std::string key = std::string(cpuMask ? cpuMask : "") + ";" +
+                      std::to_string(static_cast<int>(placement)) + ";" +
+                      std::to_string(oneThreadPerCore) + ";" +
+                      std::to_string(static_cast<int>(coreType));
+    std::lock_guard<std::mutex> lock(schedMutex);
+    if (key == affinityKey)
+      return;
+    affinityKey = key;
+
+    bool isDefault = (!cpuMask || !*cpuMask) &&
+                     placement == Placement::None && !oneThreadPerCore &&
+                     coreType == CoreType::Any;
+    std::vector<int> cpus;
+    if (!isDefault)
+      cpus = selectCpus(cpuMask, placement, oneThreadPerCore, coreType);
+    workerCapacity.clear();
+    if (cpus.empty() || workers.empty()) {
+      numAffinityWorkers = 0;
+      for (auto &worker : workers)
+        setThreadAffinity(worker, getProcessCpus());
+      if (!nodeWorkers.empty())
+        bindNumaWorkers();
+      return;
+    }
+
+    int numWorkers = std::min(workers.size(), cpus.size());
+    for (int i = 0; i < numWorkers; ++i) {
+      if (placement == Placement::None)
+        setThreadAffinity(workers[i], cpus);
+      else
+        setThreadAffinity(workers[i], {cpus[i]});
+    }
+    if (placement != Placement::None && !getHybridCpus().efficiency.empty()) {
+      workerCapacity.assign(1, 0.0);
+      for (int i = 0; i < numWorkers; ++i)
+        workerCapacity.push_back(getCpuCapacity(cpus[i]));
+    }
+    numAffinityWorkers = numWorkers;
+  }
+
+private:
+  // Remaining work of a participant in the work-stealing mode. The owner
+  // takes pieces from the front, thieves take halves from the back.
+  struct alignas(64) WorkRange {
+    std::atomic<uint64_t> bounds{0};
+  };
+
+  // A job lives on the stack of the submitting thread until all its
+  // participants are done.
+  struct Job {
+    TaskFn fn = nullptr;
+    void *ctx = nullptr;
+    size_t n = 0;
+    int participants = 0;
+    Schedule schedule = Schedule::Static;
+    size_t grain = 1;
+    // Boundaries between chunks of different participants are multiples of
+    // align iterations, so that outputs of neighbouring iterations sharing a
+    // cache line are written by a single thread.
+    size_t align = 1;
+    // If set, participants get shares of the work in proportion to their
+    // capacities. Element i is the total capacity of participants [0, i).
+    const double *capacityPrefix = nullptr;
+    // Ranges of participants in the work-stealing mode.
+    WorkRange *ranges = nullptr;
+    // If not zero, chunks of the job are recorded in the timeline with this
+    // job id.
+    uint64_t timelineId = 0;
+    // Steady clock timestamp of the submission, after thread slots are taken.
+    int64_t submitNs = 0;
+    // If not zero, participants add hardware event counts of their work to
+    // counters. countedParticipants is the number of participants whose
+    // counters were available.
+    int numCounters = 0;
+    std::atomic<uint64_t> counters[MAX_PERF_COUNTERS];
+    std::atomic<int> countedParticipants{0};
+    // Number of workers that haven't finished the job yet.
+    std::atomic<int> pending{0};
+  };
+
+  struct alignas(64) WorkerState {
+    // The job assigned to the worker, if any, and the index of the worker
+    // among the job participants.
+    std::atomic<Job *> job{nullptr};
+    int idx = 0;
+    // Set while the worker is taken by a job.
+    bool busy = false;
+  };
+
+  static uint64_t packRange(size_t begin, size_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | static_cast<uint64_t>(end);
+  }
+
+  static size_t rangeBegin(uint64_t bounds) { return bounds >> 32; }
+  static size_t rangeEnd(uint64_t bounds) { return bounds & UINT32_MAX; }
+
+  static int defaultSize() {
+    // Match the OpenMP default so that switching between the pool and the
+    // OpenMP launcher doesn't change the amount of parallelism.
+    int hwThreads = static_cast<int>(std::thread::hardware_concurrency());
+    int res = getIntEnv("TRITON_CPU_MAX_THREADS",
+                        getIntEnv("OMP_NUM_THREADS", hwThreads));
+    return std::max(res, 1);
+  }
+
+  explicit ThreadPool(int size)
+      : spinCount(getIntEnv("TRITON_CPU_SPIN_COUNT",
+                            triton_cpu_shared_pool_enabled()
+                                ? SHARED_SPIN_COUNT
+                                : DEFAULT_SPIN_COUNT)),
+        states(size), freeSlots(size) {
+    workers.reserve(size - 1);
+    for (int i = 1; i < size; ++i)
+      workers.emplace_back([this, i]() { workerLoop(i); });
+  }
+
+  // Take up to count thread slots, waiting for at least one. If ids is set,
+  // take a free worker from [begin, end) for each slot except the one of the
+  // caller if callerRuns is set, and return their ids. Return the number of
+  // taken slots.
+  int acquire(int count, int priority, bool callerRuns, int begin, int end,
+              std::vector<int> *ids) {
+    auto freeWorkers = [&]() {
+      int res = 0;
+      for (int id = begin; id < end; ++id)
+        res += !states[id].busy;
+      return res;
+    };
+    auto canRun = [&]() {
+      return freeSlots > 0 && (!ids || callerRuns || freeWorkers() > 0);
+    };
+
+    std::unique_lock<std::mutex> lock(schedMutex);
+    if (!waiters.empty() || !canRun()) {
+      int64_t waitStart = steadyNowNs();
+      // Higher priorities go first, then earlier submissions.
+      auto key = std::make_pair(-priority, nextTicket++);
+      waiters.insert(key);
+      schedCv.wait(lock,
+                   [&]() { return *waiters.begin() == key && canRun(); });
+      waiters.erase(waiters.begin());
+      // The next waiter might be able to run with the remaining slots.
+      if (!waiters.empty())
+        schedCv.notify_all();
+      triton_cpu_stats_add(POOL_SLOT_WAITS, 1);
+      triton_cpu_stats_add(POOL_SLOT_WAIT_NS, steadyNowNs() - waitStart);
+    }
+
+    int slots = std::min(count, freeSlots);
+    if (ids) {
+      ids->clear();
+      int numWorkers = slots - callerRuns;
+      for (int id = begin; id < end && static_cast<int>(ids->size()) < numWorkers;
+           ++id) {
+        if (!states[id].busy) {
+          states[id].busy = true;
+          ids->push_back(id);
+        }
+      }
+      slots = static_cast<int>(ids->size()) + callerRuns;
+    }
+    freeSlots -= slots;
+    return slots;
+  }
+
+  void release(int slots, const std::vector<int> &ids) {
+    std::lock_guard<std::mutex> lock(schedMutex);
+    for (int id : ids)
+      states[id].busy = false;
+    freeSlots += slots;
+    if (!waiters.empty())
+      schedCv.notify_all();
+  }
+
+  // Give back count slots of the last taken workers.
+  void shrink(int count, std::vector<int> &ids) {
+    std::lock_guard<std::mutex> lock(schedMutex);
+    for (int i = 0; i < count; ++i) {
+      states[ids.back()].busy = false;
+      ids.pop_back();
+    }
+    freeSlots += count;
+    if (!waiters.empty())
+      schedCv.notify_all();
+  }
+
+  // Bind worker threads to NUMA nodes on the first use of the NUMA mode.
+  // Workers are split evenly between nodes in the order of node ids, so
+  // each node owns a contiguous range of worker ids and contiguous ranges
+  // of the iteration space are processed by the same node. Return false if
+  // the host has a single NUMA node or there are not enough workers.
+  bool enableNuma() {
+    std::call_once(numaInitFlag, [this]() {
+      const auto &nodes = getNumaNodes();
+      int numWorkers = static_cast<int>(workers.size());
+      int numNodes = static_cast<int>(nodes.size());
+      if (numNodes < 2 || numWorkers < numNodes)
+        return;
+      nodeWorkers.resize(numNodes);
+      for (int node = 0; node < numNodes; ++node) {
+        int begin = 1 + numWorkers * node / numNodes;
+        int end = 1 + numWorkers * (node + 1) / numNodes;
+        nodeWorkers[node] = {begin, end};
+      }
+      std::lock_guard<std::mutex> lock(schedMutex);
+      if (!numAffinityWorkers)
+        bindNumaWorkers();
+    });
+    return !nodeWorkers.empty();
+  }
+
+  void bindNumaWorkers() {
+    const auto &nodes = getNumaNodes();
+    for (size_t node = 0; node < nodeWorkers.size(); ++node)
+      for (int id = nodeWorkers[node].first; id < nodeWorkers[node].second;
+           ++id)
+        setThreadAffinity(workers[id - 1], nodes[node]);
+  }
+
+  // Run the part of the job of participant idx, which starts at startNs.
+  static void run(Job &job, int idx, int64_t startNs) {
+    uint64_t before[MAX_PERF_COUNTERS];
+    bool counted = job.numCounters > 0 && triton_cpu_perf_read_thread(before);
+    bool sampled = triton_cpu_ip_sampling_enabled();
+    if (sampled)
+      triton_cpu_ip_sampling_begin_thread();
+    if (job.schedule == Schedule::Steal)
+      runStealing(job, idx);
+    else
+      runStatic(job, idx);
+    if (sampled)
+      triton_cpu_ip_sampling_end_thread();
+    triton_cpu_stats_add(POOL_BUSY_NS, steadyNowNs() - startNs);
+    uint64_t after[MAX_PERF_COUNTERS];
+    if (!counted || !triton_cpu_perf_read_thread(after))
+      return;
+    for (int i = 0; i < job.numCounters; ++i)
+      job.counters[i].fetch_add(after[i] - before[i],
+                                std::memory_order_relaxed);
+    job.countedParticipants.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Make counters of a completed job available to the submitting thread.
+  static void saveCounters(const Job &job) {
+    lastJobCounters.numCounters =
+        job.countedParticipants.load(std::memory_order_relaxed) > 0
+            ? job.numCounters
+            : 0;
+    for (int i = 0; i < lastJobCounters.numCounters; ++i)
+      lastJobCounters.values[i] =
+          job.counters[i].load(std::memory_order_relaxed);
+  }
+
+  // Account the wall time of a completed job for all its participants, so
+  // that busy time over it gives the parallel efficiency of the pool.
+  static void recordStats(const Job &job) {
+    triton_cpu_stats_add(POOL_JOBS, 1);
+    triton_cpu_stats_add(POOL_THREAD_NS,
+                         (steadyNowNs() - job.submitNs) * job.participants);
+  }
+
+  static void runChunk(const Job &job, size_t begin, size_t end) {
+    if (!job.timelineId) {
+      job.fn(job.ctx, begin, end);
+      return;
+    }
+    int32_t cpu = currentCpu();
+    int64_t start = steadyNowNs();
+    job.fn(job.ctx, begin, end);
+    Timeline::get().record({job.timelineId, currentThreadId(), cpu, begin, end,
+                            start, steadyNowNs()});
+  }
+
+  // Round the value up to a multiple of align, at least align.
+  static size_t alignUp(size_t value, size_t align) {
+    return std::max<size_t>((value + align - 1) / align, 1) * align;
+  }
+
+  // Start of the static chunk of a participant.
+  static size_t chunkBegin(const Job &job, int idx) {
+    size_t begin;
+    if (!job.capacityPrefix) {
+      begin = job.n * idx / job.participants;
+    } else {
+      double share =
+          job.capacityPrefix[idx] / job.capacityPrefix[job.participants];
+      begin = static_cast<size_t>(job.n * share);
+    }
+    if (job.align > 1)
+      begin = (begin + job.align / 2) / job.align * job.align;
+    return std::min(begin, job.n);
+  }
+
+  static void runStatic(Job &job, int idx) {
+    size_t begin = chunkBegin(job, idx);
+    size_t end =
+        idx + 1 == job.participants ? job.n : chunkBegin(job, idx + 1);
+    if (begin < end)
+      runChunk(job, begin, end);
+  }
+
+  // Take the next piece of the own range.
+  static bool popFront(Job &job, int idx, size_t &begin, size_t &end) {
+    std::atomic<uint64_t> &bounds = job.ranges[idx].bounds;
+    uint64_t cur = bounds.load(std::memory_order_acquire);
+    while (true) {
+      size_t b = rangeBegin(cur);
+      size_t e = rangeEnd(cur);
+      if (b >= e)
+        return false;
+      size_t mid = std::min(b + job.grain, e);
+      if (bounds.compare_exchange_weak(cur, packRange(mid, e),
+                                       std::memory_order_acq_rel)) {
+        begin = b;
+        end = mid;
+        return true;
+      }
+    }
+  }
+
+  // Take the second half of the victim's remaining range.
+  static bool stealBack(Job &job, int victim, size_t &begin, size_t &end) {
+    std::atomic<uint64_t> &bounds = job.ranges[victim].bounds;
+    uint64_t cur = bounds.load(std::memory_order_acquire);
+    while (true) {
+      size_t b = rangeBegin(cur);
+      size_t e = rangeEnd(cur);
+      if (b >= e)
+        return false;
+      size_t mid = b + (e - b) / 2 / job.align * job.align;
+      if (bounds.compare_exchange_weak(cur, packRange(b, mid),
+                                       std::memory_order_acq_rel)) {
+        begin = mid;
+        end = e;
+        return true;
+      }
+    }
+  }
+
+  static void runStealing(Job &job, int idx) {
+    size_t begin, end;
+    while (true) {
+      while (popFront(job, idx, begin, end))
+        runChunk(job, begin, end);
+
+      // Look for a victim starting from the closest neighbour. Stolen work is
+      // published in the own range, so it can be stolen again.
+      bool stolen = false;
+      for (int i = 1; i < job.participants && !stolen; ++i)
+        stolen = stealBack(job, (idx + i) % job.participants, begin, end);
+      if (!stolen)
+        return;
+      job.ranges[idx].bounds.store(packRange(begin, end),
+                                   std::memory_order_release);
+    }
+  }
+
+  Job *waitForJob(WorkerState &state) {
+    Job *job;
+    for (int i = 0; i < spinCount; ++i) {
+      job = state.job.load(std::memory_order_acquire);
+      if (job)
+        return job;
+      cpuRelax();
+    }
+
+    std::unique_lock<std::mutex> lock(parkMutex);
+    parked.fetch_add(1, std::memory_order_seq_cst);
+    parkCv.wait(lock, [&]() {
+      job = state.job.load(std::memory_order_seq_cst);
+      return job != nullptr;
+    });
+    parked.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+  }
+
+  void workerLoop(int id) {
+    WorkerState &state = states[id];
+    while (true) {
+      Job *job = waitForJob(state);
+      int64_t start = steadyNowNs();
+      triton_cpu_stats_add(POOL_DISPATCHES, 1);
+      triton_cpu_stats_add(POOL_DISPATCH_NS, start - job->submitNs);
+      run(*job, state.idx, start);
+      // The worker stays busy until the submitting thread sees the job
+      // complete, so it can't get a new job before the reset.
+      state.job.store(nullptr, std::memory_order_relaxed);
+      job->pending.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  const int spinCount;
+  std::vector<std::thread> workers;
+  // Indexed by worker id, element 0 is unused.
+  std::vector<WorkerState> states;
+
+  // Protects the scheduling state and the affinity configuration.
+  std::mutex schedMutex;
+  std::condition_variable schedCv;
+  int freeSlots;
+  // Waiting submissions ordered by negated priority, then by arrival.
+  std::set<std::pair<int, uint64_t>> waiters;
+  uint64_t nextTicket = 0;
+
+  // Configuration of the current custom affinity and the number of workers
+  // pinned by it. Zero means the default unpinned pool.
+  std::string affinityKey = ";0;0;0";
+  std::atomic<int> numAffinityWorkers{0};
+  // Capacities of cores the workers are pinned to, indexed by worker id, if
+  // the workers are pinned to cores of different types.
+  std::vector<double> workerCapacity;
+
+  std::once_flag numaInitFlag;
+  // [begin, end) range of worker ids bound to each NUMA node.
+  std::vector<std::pair<int, int>> nodeWorkers;
+
+  std::mutex parkMutex;
+  std::condition_variable parkCv;
+  std::atomic<int> parked{0};
+};
+
+// Per-kernel estimates of the program cost used to choose the number of
+// threads of launches that don't specify it. Costs are measured on previous
+// launches of the kernel, assuming the launch time scales linearly with the
+// number of programs per thread.
+class LaunchStats {
+public:
+  static LaunchStats &get() {
+    static LaunchStats *stats = new LaunchStats();
+    return *stats;
+  }
+
+  int numThreads(const void *kernel, size_t n, int maxThreads,
+                 int64_t costNs) {
+    double cost = static_cast<double>(costNs);
+    if (costNs <= 0) {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = costs.find(kernel);
+      // Use all threads until the kernel is measured.
+      if (it == costs.end())
+        return maxThreads;
+      cost = it->second;
+    }
+    double work = cost * static_cast<double>(n);
+    double res = std::ceil(work / minThreadWorkNs);
+    return static_cast<int>(
+        std::clamp(res, 1.0, static_cast<double>(maxThreads)));
+  }
+
+  void record(const void *kernel, size_t n, int numThreads, int64_t ns) {
+    if (n == 0 || numThreads <= 0)
+      return;
+    double cost = static_cast<double>(ns) * numThreads / n;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto [it, inserted] = costs.emplace(kernel, cost);
+    // Exponential moving average smooths out noisy launches.
+    if (!inserted)
+      it->second = 0.75 * it->second + 0.25 * cost;
+  }
+
+private:
+  LaunchStats()
+      : minThreadWorkNs(std::max(getIntEnv("TRITON_CPU_MIN_THREAD_WORK_NS",
+                                           DEFAULT_MIN_THREAD_WORK_NS),
+                                 1)) {}
+
+  const double minThreadWorkNs;
+  std::mutex mutex;
+  std::unordered_map<const void *, double> costs;
+};
+
+} // namespace
+
+extern "C" {
+
+// Run fn over the [0, n) iteration space using at most num_threads threads of
+// the persistent pool (all of them if num_threads <= 0). The call returns
+// when all iterations are complete. Iterations are split between threads at
+// multiples of align, e.g. of the number of programs whose outputs fill a
+// cache line.
+//
+// Unless numa_node is NUMA_DISABLED, workers are bound to NUMA nodes and the
+// iteration space is split between nodes in contiguous ranges. A
+// non-negative numa_node restricts the execution to the workers of that node.
+//
+// Concurrent calls share the pool and run on disjoint sets of threads, so the
+// total number of active threads never exceeds the pool size. A call gets
+// fewer threads than requested if the pool is busy. When no threads are
+// available, calls with a higher priority are served first.
+EXPORT void triton_cpu_parallel_for(size_t n, int32_t num_threads,
+                                    int32_t schedule, int32_t align,
+                                    int32_t numa_node, int32_t priority,
+                                    TaskFn fn, void *ctx) {
+  ThreadPool::get().parallelFor(
+      n, num_threads, static_cast<Schedule>(schedule),
+      static_cast<size_t>(std::max(align, 1)), numa_node, priority, fn, ctx);
+}
+
+// Take up to num_threads thread slots of the pool for threads managed by the
+// caller, e.g. an OpenMP team, waiting until at least one slot is available.
+// Return the number of taken slots that must be returned with
+// triton_cpu_release_threads.
+EXPORT int32_t triton_cpu_acquire_threads(int32_t num_threads,
+                                          int32_t priority) {
+  return ThreadPool::get().acquireExternal(std::max(num_threads, 1), priority);
+}
+
+EXPORT void triton_cpu_release_threads(int32_t num_threads) {
+  ThreadPool::get().releaseExternal(num_threads);
+}
+
+// Pin pool workers to CPUs from cpu_mask (in the Linux cpulist format, all
+// CPUs available to the process if null) using the specified placement.
+// When one_thread_per_core is set, only the first SMT sibling of each core
+// is used. Unless core_type is CoreType::Any, only cores of that type are
+// used. Launches submitted after this call run on the selected CPUs only.
+EXPORT void triton_cpu_set_affinity(const char *cpu_mask, int32_t placement,
+                                    bool one_thread_per_core,
+                                    int32_t core_type) {
+  ThreadPool::get().setAffinity(cpu_mask, static_cast<Placement>(placement),
+                                one_thread_per_core,
+                                static_cast<CoreType>(core_type));
+}
+
+// Return true if the host CPU has cores of different types.
+EXPORT bool triton_cpu_is_hybrid() {
+  return !getHybridCpus().efficiency.empty();
+}
+
+EXPORT int32_t triton_cpu_get_num_threads() { return ThreadPool::get().size(); }
+
+// Choose the number of threads, at most max_threads (the pool size if
+// max_threads <= 0), to run n programs of the kernel with. cost_ns is the
+// estimated cost of a program in nanoseconds. If it is not positive, the
+// cost is estimated from previous launches of the kernel recorded with
+// triton_cpu_record_launch_time.
+EXPORT int32_t triton_cpu_get_adaptive_num_threads(const void *kernel, size_t n,
+                                                   int32_t max_threads,
+                                                   int64_t cost_ns) {
+  if (max_threads <= 0)
+    max_threads = ThreadPool::get().size();
+  max_threads = static_cast<int32_t>(std::min<size_t>(
+      static_cast<size_t>(max_threads), std::max<size_t>(n, 1)));
+  return LaunchStats::get().numThreads(kernel, n, max_threads, cost_ns);
+}
+
+// Record the time of a launch of n programs of the kernel on num_threads
+// threads.
+EXPORT void triton_cpu_record_launch_time(const void *kernel, size_t n,
+                                          int32_t num_threads, int64_t ns) {
+  LaunchStats::get().record(kernel, n, num_threads, ns);
+}
+
+// Start or stop recording chunks executed by pool threads. While recording,
+// every chunk of iterations run by a thread is timestamped.
+EXPORT void triton_cpu_timeline_enable(bool enable) {
+  Timeline::get().enabled.store(enable, std::memory_order_relaxed);
+}
+
+// Move up to max_events recorded events to out and return their number.
+// Events of a thread are returned in the order of execution.
+EXPORT size_t triton_cpu_timeline_read(TimelineEvent *out, size_t max_events) {
+  return Timeline::get().read(out, max_events);
+}
+
+// Copy hardware event counts of the last triton_cpu_parallel_for call of the
+// calling thread, summed over all threads that ran it, into values and return
+// their number. Return zero if counting wasn't enabled with
+// triton_cpu_perf_enable or counters are unavailable.
+EXPORT int32_t triton_cpu_perf_get_last_job(uint64_t *values) {
+  std::copy(lastJobCounters.values,
+            lastJobCounters.values + lastJobCounters.numCounters, values);
+  return lastJobCounters.numCounters;
+}
+
+EXPORT int32_t triton_cpu_get_num_numa_nodes() {
+  return static_cast<int32_t>(getNumaNodes().size());
+}
+
+// Return the NUMA node holding the memory at the specified address or -1 if
+// it is unknown.
+EXPORT int32_t triton_cpu_get_numa_node(const void *ptr) {
+  return getNumaNodeOfAddress(ptr);
+}
+
+// Touch each page of the buffer from the pool threads running in the NUMA
+// mode. Pages are distributed between nodes the same way as programs of a
+// static launch, so freshly allocated outputs of kernels writing contiguous
+// blocks end up on the node that writes them. Already populated pages are
+// not migrated.
+EXPORT void triton_cpu_numa_first_touch(void *ptr, size_t size) {
+  if (!ptr || size == 0)
+    return;
+  struct Buffer {
+    char *base;
+    size_t size;
+    size_t pageSize;
+  };
+#if defined(__linux__)
+  size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+  size_t pageSize = 4096;
+#endif
+  Buffer buf{static_cast<char *>(ptr), size, pageSize};
+  size_t numPages = (size + pageSize - 1) / pageSize;
+  ThreadPool::get().parallelFor(
+      numPages, 0, Schedule::Static, 1, NUMA_ANY_NODE, 0,
+      [](void *ctx, size_t begin, size_t end) {
+        auto *buf = static_cast<Buffer *>(ctx);
+        for (size_t page = begin; page < end; ++page) {
+          volatile char *p =
+              buf->base + std::min(page * buf->pageSize, buf->size - 1);
+          *p = *p;
+        }
+      },
+      &buf);
+}
+
+} // extern "C"
@@ -49,7 +49,11 @@ static libxsmm_datatype getXsmmCompType(libxsmm_datatype in_dtype) {
   case LIBXSMM_DATATYPE_F32:
   case LIBXSMM_DATATYPE_F16:
   case LIBXSMM_DATATYPE_BF16:
+  case LIBXSMM_DATATYPE_HF8:
+  case LIBXSMM_DATATYPE_BF8:
     return LIBXSMM_DATATYPE_F32;
+  case LIBXSMM_DATATYPE_I8:
+    return LIBXSMM_DATATYPE_I32;
   default:
     return LIBXSMM_DATATYPE_UNSUPPORTED;
   }
@@ -0,0 +1,63 @@
+/* clang-format off */
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "{header_name}"
+
+// Range entry point of the kernel, it runs programs [x_begin, x_end) x y x z.
+// Arguments after the kernel arguments: x_begin, x_end, y, z, gridX, gridY, gridZ.
+void {entry_name}_range({kernel_arg_types}uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+
+// Persistent thread pool provided by libTritonCPURuntime.
+void triton_cpu_parallel_for(size_t n, int32_t num_threads, int32_t schedule, int32_t align,
+                             int32_t numa_node, int32_t priority, void (*fn)(void *, size_t, size_t),
+                             void *ctx);
+// Write device prints buffered by the threads of the last launch.
+void triton_cpu_print_flush(void);
+
+// Keep in sync with runtime_thread_pool.cpp.
+#define NUMA_DISABLED -2
+
+typedef struct {{
+  uint32_t gX, gY, gZ;
+  {arg_fields}
+}} {kernel_name}_args_t;
+
+// Run programs [begin, end) numbered in the linear order. Programs with
+// consecutive X ids run in a single call of the range entry point.
+static void {kernel_name}_run(void *ctx, size_t begin, size_t end) {{
+  const {kernel_name}_args_t *args = (const {kernel_name}_args_t *)ctx;
+  size_t i = begin;
+  while (i < end) {{
+    uint32_t x = (uint32_t)(i % args->gX);
+    size_t yz = i / args->gX;
+    uint32_t y = (uint32_t)(yz % args->gY);
+    uint32_t z = (uint32_t)(yz / args->gY);
+    size_t length = args->gX - x;
+    if (length > end - i)
+      length = end - i;
+    {entry_name}_range({call_args}x, x + (uint32_t)length, y, z, args->gX, args->gY, args->gZ);
+    i += length;
+  }}
+}}
+
+// The kernel is linked into the binary, there is nothing to load. These
+// keep the API of ahead-of-time compiled GPU kernels.
+void load_{kernel_name}(void) {{}}
+void unload_{kernel_name}(void) {{}}
+
+/*
+{kernel_docstring}
+*/
+TritonCPUResult {kernel_name}(int32_t num_threads, {signature}) {{
+{arg_checks}  {kernel_name}_args_t tt_args = {{ (uint32_t)({gridX}), (uint32_t)({gridY}), (uint32_t)({gridZ}){arg_inits} }};
+  size_t tt_num_programs = (size_t)tt_args.gX * tt_args.gY * tt_args.gZ;
+  if (num_threads <= 0)
+    num_threads = {num_threads};
+  if (tt_num_programs > 0) {{
+    triton_cpu_parallel_for(tt_num_programs, num_threads, {schedule}, {program_align}, NUMA_DISABLED, 0, {kernel_name}_run, &tt_args);
+    triton_cpu_print_flush();
+  }}
+  return TRITON_CPU_SUCCESS;
+}}
@@ -0,0 +1,26 @@
+#ifndef TT_KERNEL_INCLUDES
+#define TT_KERNEL_INCLUDES
+
+#include <inttypes.h>
+#include <stdint.h>
+
+// Status returned by launchers of ahead-of-time compiled CPU kernels.
+typedef int TritonCPUResult;
+#define TRITON_CPU_SUCCESS 0
+#define TRITON_CPU_ERROR_INVALID_VALUE 1
+
+#endif
+
+#ifdef __cplusplus
+extern "C" {{
+#endif
+
+void unload_{kernel_name}(void);
+void load_{kernel_name}(void);
+// tt-linker-backend: cpu
+// tt-linker: {kernel_name}:{full_signature}:{algo_info}
+TritonCPUResult{_placeholder} {kernel_name}(int32_t num_threads, {signature});
+
+#ifdef __cplusplus
+}}
+#endif
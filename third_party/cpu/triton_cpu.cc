@@ -1,3 +1,5 @@
+#include "Analysis/KernelCost.h"
+#include "Analysis/UnrolledSize.h"
 #include "ScalarizePass/ScalarizeInterfaceImpl.h"
 #include "TritonCPUToLLVM/Passes.h"
 #include "TritonCPUTransforms/Passes.h"
@@ -12,16 +14,34 @@
 #include "mlir/Dialect/Vector/IR/VectorOps.h"
 #include "mlir/Dialect/Vector/Transforms/Passes.h"
 #include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassInstrumentation.h"
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Target/LLVMIR/Dialect/AMX/AMXToLLVMIRTranslation.h"
 #include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/VectorUtils.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/ProfileData/InstrProf.h"
+#include "llvm/ProfileData/InstrProfWriter.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 
+#include <chrono>
+#include <map>
+#include <mutex>
+
 #if defined(__x86_64__) || defined(__i386__)
 #include <asm/prctl.h>
 #endif
@@ -49,6 +69,70 @@ bool is_xsmm_available() {
 
 namespace py = pybind11;
 
+namespace {
+
+// Wall time and IR size of each pass run by a pass manager. Passes nested on
+// functions run once per function, possibly in parallel, and their records
+// accumulate over all functions.
+struct PassProfile {
+  struct Record {
+    std::string name;
+    double ms = 0;
+    int64_t ops = 0;
+  };
+
+  std::mutex mutex;
+  std::vector<Record> records;
+  llvm::DenseMap<mlir::Pass *, size_t> recordIds;
+  std::map<std::pair<mlir::Pass *, mlir::Operation *>,
+           std::chrono::steady_clock::time_point>
+      starts;
+};
+
+class PassProfileInstrumentation : public mlir::PassInstrumentation {
+public:
+  explicit PassProfileInstrumentation(std::shared_ptr<PassProfile> profile)
+      : profile(std::move(profile)) {}
+
+  void runBeforePass(mlir::Pass *pass, mlir::Operation *op) override {
+    // Pass adaptors running nested pipelines have no argument, time of their
+    // passes is recorded by the passes themselves.
+    if (pass->getArgument().empty())
+      return;
+    std::lock_guard<std::mutex> lock(profile->mutex);
+    if (profile->recordIds.try_emplace(pass, profile->records.size()).second)
+      profile->records.push_back({pass->getArgument().str()});
+    profile->starts[{pass, op}] = std::chrono::steady_clock::now();
+  }
+
+  void runAfterPass(mlir::Pass *pass, mlir::Operation *op) override {
+    if (pass->getArgument().empty())
+      return;
+    auto end = std::chrono::steady_clock::now();
+    // The op is only modified by the pass, so it is counted outside of the
+    // lock.
+    int64_t ops = 0;
+    op->walk([&](mlir::Operation *) { ++ops; });
+    std::lock_guard<std::mutex> lock(profile->mutex);
+    auto it = profile->starts.find({pass, op});
+    PassProfile::Record &record =
+        profile->records[profile->recordIds.lookup(pass)];
+    record.ms +=
+        std::chrono::duration<double, std::milli>(end - it->second).count();
+    record.ops += ops;
+    profile->starts.erase(it);
+  }
+
+  void runAfterPassFailed(mlir::Pass *pass, mlir::Operation *op) override {
+    runAfterPass(pass, op);
+  }
+
+private:
+  std::shared_ptr<PassProfile> profile;
+};
+
+} // namespace
+
 void init_triton_cpu_passes_ttcpuir(py::module &&m) {
   using namespace mlir::triton;
 
@@ -64,13 +148,34 @@ void init_triton_cpu_passes_ttcpuir(py::module &&m) {
     pm.addPass(
         mlir::triton::cpu::createScalarizeUsingForOpPass(skip_gather_scatter));
   });
+  m.def("add_scalarize_cost_model",
+        [](mlir::PassManager &pm, bool skip_gather_scatter,
+           unsigned vector_bytes, bool native_gather, bool native_scatter) {
+          pm.addPass(mlir::triton::cpu::createScalarizeUsingForOpPass(
+              skip_gather_scatter, vector_bytes, native_gather,
+              native_scatter));
+        });
   m.def("add_convert_memory_ops", [](mlir::PassManager &pm,
                                      bool use_gather_scatter) {
     pm.addPass(mlir::triton::cpu::createConvertMemoryOps(use_gather_scatter));
   });
+  m.def("add_convert_memory_ops_cost_model",
+        [](mlir::PassManager &pm, bool use_gather_scatter,
+           unsigned vector_bytes, bool native_gather, bool native_scatter,
+           bool native_masked_store) {
+          pm.addPass(mlir::triton::cpu::createConvertMemoryOps(
+              use_gather_scatter, vector_bytes, native_gather, native_scatter,
+              native_masked_store));
+        });
   m.def("add_convert_ptr_ops", [](mlir::PassManager &pm) {
     pm.addPass(mlir::triton::cpu::createConvertPtrOps());
   });
+  m.def("add_carry_ptr_offsets", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createCarryPtrOffsets());
+  });
+  m.def("add_narrow_offsets", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createNarrowOffsets());
+  });
   m.def("add_convert_elementwise_ops", [](mlir::PassManager &pm) {
     pm.addPass(mlir::triton::cpu::createConvertElementwiseOps());
   });
@@ -80,9 +185,31 @@ void init_triton_cpu_passes_ttcpuir(py::module &&m) {
   m.def("add_convert_dot_op", [](mlir::PassManager &pm) {
     pm.addPass(mlir::triton::cpu::createConvertDotOp());
   });
+  m.def("add_decompose_scaled_dot", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createDecomposeScaledDot());
+  });
+  m.def("add_split_k", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createSplitK());
+  });
+  m.def("add_match_gemm_kernels", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createMatchGemmKernels());
+  });
+  m.def("add_defer_scalar_atomics",
+        [](mlir::PassManager &pm, bool per_program) {
+          pm.addPass(mlir::triton::cpu::createDeferScalarAtomics(per_program));
+        });
+  m.def("add_skip_empty_dots", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createSkipEmptyDots());
+  });
+  m.def("add_forward_stores", [](mlir::PassManager &pm, bool noalias) {
+    pm.addPass(mlir::triton::cpu::createForwardStores(noalias));
+  });
   m.def("add_convert_histogram_op", [](mlir::PassManager &pm) {
     pm.addPass(mlir::triton::cpu::createConvertHistogramOp());
   });
+  m.def("add_convert_gather_op", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createConvertGatherOp());
+  });
   m.def("add_convert_reduction_op",
         [](mlir::PassManager &pm, bool use_reduction_op,
            bool use_multidim_reduction_op) {
@@ -104,8 +231,25 @@ void init_triton_cpu_passes_ttcpuir(py::module &&m) {
   m.def("add_triton_cpu_canonicalizer", [](mlir::PassManager &pm) {
     pm.addPass(mlir::triton::cpu::createCanonicalize());
   });
-  m.def("add_optimize_masks", [](mlir::PassManager &pm) {
-    pm.addPass(mlir::triton::cpu::createOptimizeMasks());
+  m.def("add_optimize_masks", [](mlir::PassManager &pm, bool version_tiles) {
+    pm.addPass(mlir::triton::cpu::createOptimizeMasks(version_tiles));
+  });
+  m.def("add_fold_selects", [](mlir::PassManager &pm,
+                               bool native_masked_store) {
+    pm.addPass(mlir::triton::cpu::createFoldSelects(native_masked_store));
+  });
+  m.def("add_convert_to_bulk_memory_ops",
+        [](mlir::PassManager &pm, int64_t min_size) {
+          pm.addPass(mlir::triton::cpu::createConvertToBulkMemoryOps(min_size));
+        });
+  m.def("add_backoff_spin_loops", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createBackoffSpinLoops());
+  });
+  m.def("add_insert_prefetches", [](mlir::PassManager &pm, unsigned distance) {
+    pm.addPass(mlir::triton::cpu::createInsertPrefetches(distance));
+  });
+  m.def("add_pack_dot_operands", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createPackDotOperands());
   });
   m.def("add_convert_dot_product", [](mlir::PassManager &pm,
                                       bool useHorizontalSum) {
@@ -118,29 +262,80 @@ void init_triton_cpu_passes_ttcpuir(py::module &&m) {
                                           cpu::Ukernels ukernels) {
     pm.addPass(mlir::triton::cpu::createConvertDotOpToUkernelOps(ukernels));
   });
-  m.def("add_convert_dot_to_amx", [](mlir::PassManager &pm, bool convertInt8,
-                                     bool convertFp16, bool convertBf16) {
-    pm.addPass(mlir::triton::cpu::createConvertDotToAMX(
-        convertInt8, convertFp16, convertBf16));
+  m.def("add_convert_dot_to_amx",
+        [](mlir::PassManager &pm, bool convertInt8, bool convertFp16,
+           bool convertBf16, bool convertFp8, int64_t accBlockM,
+           int64_t accBlockN) {
+          pm.addPass(mlir::triton::cpu::createConvertDotToAMX(
+              convertInt8, convertFp16, convertBf16, convertFp8, accBlockM,
+              accBlockN));
+        });
+  m.def("add_convert_dot_to_fma",
+        [](mlir::PassManager &pm, unsigned vectorBits, unsigned numVecRegs,
+           int64_t blockM, int64_t blockN) {
+          pm.addPass(mlir::triton::cpu::createConvertDotToFMA(
+              vectorBits, numVecRegs, blockM, blockN));
+        });
+  m.def("add_convert_dot_to_mmla", [](mlir::PassManager &pm, bool convertInt8,
+                                      bool convertInt8Sdot, bool convertBf16) {
+    pm.addPass(mlir::triton::cpu::createConvertDotToMMLA(
+        convertInt8, convertInt8Sdot, convertBf16));
+  });
+  m.def("add_convert_dot_to_vnni", [](mlir::PassManager &pm, bool useAvx512) {
+    pm.addPass(mlir::triton::cpu::createConvertDotToVNNI(useAvx512));
   });
-  m.def("add_convert_dot_to_fma", [](mlir::PassManager &pm) {
-    pm.addPass(mlir::triton::cpu::createConvertDotToFMA());
+  m.def("add_split_batched_dots", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createSplitBatchedDots());
   });
   m.def("add_convert_dot_generic", [](mlir::PassManager &pm) {
     pm.addPass(mlir::triton::cpu::createConvertDotGeneric());
   });
   m.def("add_convert_unsupported_ops",
         [](mlir::PassManager &pm, bool promote_bf16_to_fp32,
-           bool convert_mixed_precision_matmul, bool promote_lib_math_to_fp32) {
+           bool convert_mixed_precision_matmul, bool promote_lib_math_to_fp32,
+           bool native_fp16_math) {
           pm.addPass(mlir::triton::cpu::createConvertUnsupportedOps(
               promote_bf16_to_fp32, convert_mixed_precision_matmul,
-              promote_lib_math_to_fp32));
+              promote_lib_math_to_fp32, native_fp16_math));
+        });
+  m.def("add_reduce_int_divisions", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createReduceIntDivisions());
+  });
+  m.def("add_pipeline_loads", [](mlir::PassManager &pm, unsigned num_stages,
+                                 unsigned max_stage_bytes) {
+    pm.addPass(
+        mlir::triton::cpu::createPipelineLoads(num_stages, max_stage_bytes));
+  });
+  m.def("add_convert_gathers_to_permutes",
+        [](mlir::PassManager &pm, unsigned lookup_bits) {
+          pm.addPass(
+              mlir::triton::cpu::createConvertGathersToPermutes(lookup_bits));
+        });
+  m.def("add_interleave_reductions",
+        [](mlir::PassManager &pm, unsigned vector_bits,
+           unsigned max_accumulators, unsigned min_in_flight_vectors,
+           bool reassociate_fp) {
+          pm.addPass(mlir::triton::cpu::createInterleaveReductions(
+              vector_bits, max_accumulators, min_in_flight_vectors,
+              reassociate_fp));
+        });
+  m.def("add_strip_mine_vectors",
+        [](mlir::PassManager &pm, unsigned vector_bits,
+           unsigned sub_block_vectors, unsigned min_vectors, bool noalias) {
+          pm.addPass(mlir::triton::cpu::createStripMineVectors(
+              vector_bits, sub_block_vectors, min_vectors, noalias));
+        });
+  m.def("add_convert_if_to_selects",
+        [](mlir::PassManager &pm, unsigned vector_bits, int64_t max_cost) {
+          pm.addPass(mlir::triton::cpu::createConvertIfToSelects(vector_bits,
+                                                                 max_cost));
         });
   m.def("add_decompose_fp_conversions",
         [](mlir::PassManager &pm, bool decomposeBf16Conversions,
-           bool decomposeFp8Conversions) {
+           bool decomposeFp8Conversions, unsigned fp8LookupBits) {
           pm.addPass(mlir::triton::cpu::createDecomposeFpConversions(
-              decomposeBf16Conversions, decomposeFp8Conversions));
+              decomposeBf16Conversions, decomposeFp8Conversions,
+              fp8LookupBits));
         });
   m.def("add_vector_to_scf", [](mlir::PassManager &pm, bool full_unroll,
                                 unsigned target_rank, bool lower_tensors) {
@@ -150,16 +345,35 @@ void init_triton_cpu_passes_ttcpuir(py::module &&m) {
     opts.enableLowerTensors(lower_tensors);
     pm.addPass(mlir::createConvertVectorToSCFPass(opts));
   });
-  m.def("add_lower_vector_multi_dim", [](mlir::PassManager &pm) {
-    pm.addNestedPass<mlir::triton::FuncOp>(
-        mlir::triton::cpu::createLowerMultiReductionPass());
+  m.def("add_vector_to_scf_size_aware",
+        [](mlir::PassManager &pm, unsigned target_rank,
+           unsigned max_unrolled_slices) {
+          pm.addPass(mlir::triton::cpu::createVectorToSCFPass(
+              target_rank, max_unrolled_slices));
+        });
+  m.def("add_allocate_scratch_arena", [](mlir::PassManager &pm,
+                                         int64_t min_size) {
+    pm.addPass(mlir::triton::cpu::createAllocateScratchArena(min_size));
   });
-  m.def("add_func_op_to_llvmir", [](mlir::PassManager &pm) {
-    pm.addPass(mlir::triton::cpu::createFuncOpToLLVMPass());
+  m.def("add_lower_vector_multi_dim",
+        [](mlir::PassManager &pm, unsigned vector_bits) {
+          pm.addNestedPass<mlir::triton::FuncOp>(
+              mlir::triton::cpu::createLowerMultiReductionPass(vector_bits));
+        });
+  m.def("add_lower_transposes",
+        [](mlir::PassManager &pm, unsigned vector_bits, bool enable_avx2) {
+          pm.addPass(mlir::triton::cpu::createLowerTransposesPass(
+              vector_bits, enable_avx2));
+        });
+  m.def("add_func_op_to_llvmir", [](mlir::PassManager &pm, bool noalias) {
+    pm.addPass(mlir::triton::cpu::createFuncOpToLLVMPass(noalias));
   });
   m.def("add_program_id_to_llvmir", [](mlir::PassManager &pm) {
     pm.addPass(mlir::triton::cpu::createGetProgramIdOpToLLVMPass());
   });
+  m.def("add_hoist_grid_invariants", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createHoistGridInvariantsPass());
+  });
   m.def("add_memory_op_to_llvmir", [](mlir::PassManager &pm) {
     pm.addPass(mlir::triton::cpu::createMemoryOpToLLVMPass());
   });
@@ -169,6 +383,9 @@ void init_triton_cpu_passes_ttcpuir(py::module &&m) {
   m.def("add_debug_ops_to_llvmir", [](mlir::PassManager &pm) {
     pm.addPass(mlir::triton::cpu::createDebugOpsToLLVMPass());
   });
+  m.def("add_record_op_to_llvmir", [](mlir::PassManager &pm) {
+    pm.addPass(mlir::triton::cpu::createRecordOpToLLVMPass());
+  });
   m.def("add_ukernels_to_onednn_llvmir", [](mlir::PassManager &pm) {
     pm.addPass(mlir::triton::cpu::createUkernelOpsToOneDNNLLVMPass());
   });
@@ -213,10 +430,16 @@ void init_triton_cpu_passes_ttcpuir(py::module &&m) {
   m.def("add_memref_to_llvmir", [](mlir::PassManager &pm) {
     pm.addPass(mlir::createFinalizeMemRefToLLVMConversionPass());
   });
-  m.def("add_math_to_vec_lib", [](mlir::PassManager &pm, cpu::VecLib lib,
-                                  std::set<std::string> cpu_features) {
-    pm.addPass(mlir::triton::cpu::createMathToVecLibPass(lib, cpu_features));
+  m.def("add_math_to_polynomials", [](mlir::PassManager &pm, bool avx2) {
+    pm.addPass(mlir::triton::cpu::createMathToPolynomialsPass(avx2));
   });
+  m.def("add_math_to_vec_lib",
+        [](mlir::PassManager &pm, cpu::VecLib lib,
+           std::set<std::string> cpu_features, size_t scalable_bits,
+           size_t max_vec_bits) {
+          pm.addPass(mlir::triton::cpu::createMathToVecLibPass(
+              lib, cpu_features, scalable_bits, max_vec_bits));
+        });
   m.def("add_math_to_libm", [](mlir::PassManager &pm) {
     pm.addPass(mlir::createConvertMathToLibmPass());
   });
@@ -239,15 +462,33 @@ void init_triton_cpu(py::module &&m) {
     // on the first AMX usage instead of issuing SIGILL.
     // See https://www.kernel.org/doc/Documentation/x86/xstate.rst for more
     // details.
+    // The permission is granted per process and is inherited on fork, so
+    // the request is made only once.
     constexpr int XFEATURE_XTILEDATA = 18;
-    if (syscall(SYS_arch_prctl, ARCH_REQ_XCOMP_PERM, XFEATURE_XTILEDATA))
-      return false;
-    return true;
+    static const bool enabled =
+        syscall(SYS_arch_prctl, ARCH_REQ_XCOMP_PERM, XFEATURE_XTILEDATA) == 0;
+    return enabled;
 #else
     return false;
 #endif // __linux__ && ARCH_REQ_XCOMP_PERM
   });
 
+  // Return the size of RVV registers of the host (VLEN) in bits. Must only
+  // be called on hosts with the V extension, the vlenb CSR traps otherwise.
+  m.def("get_rvv_vector_bits", []() -> unsigned {
+#if defined(__riscv)
+    unsigned long vlenb;
+    asm volatile(".option push\n"
+                 ".option arch, +v\n"
+                 "csrr %0, vlenb\n"
+                 ".option pop"
+                 : "=r"(vlenb));
+    return vlenb * 8;
+#else
+    return 0;
+#endif // __riscv
+  });
+
   m.def("onednn_available", is_onednn_available);
 
   m.def("xsmm_available", is_xsmm_available);
@@ -262,14 +503,544 @@ void init_triton_cpu(py::module &&m) {
     context.loadAllAvailableDialects();
   });
 
+  // Add the "<name>_packed" entry point to the kernel. It takes the kernel
+  // arguments packed into an array of 8-byte slots followed by the program
+  // id range and the grid size like "<name>_range", so a single launcher can
+  // call kernels of any signature.
+  m.def("add_packed_entry", [](llvm::Module *mod, const std::string &name) {
+    llvm::Function *kernel = mod->getFunction(name + "_range");
+    if (!kernel)
+      throw std::runtime_error("kernel " + name + " not found");
+    llvm::LLVMContext &ctx = mod->getContext();
+    llvm::IRBuilder<> builder(ctx);
+    llvm::Type *i32Ty = builder.getInt32Ty();
+    auto *entryTy = llvm::FunctionType::get(
+        builder.getVoidTy(),
+        {builder.getPtrTy(), i32Ty, i32Ty, i32Ty, i32Ty, i32Ty, i32Ty, i32Ty},
+        /*isVarArg=*/false);
+    auto *entry = llvm::Function::Create(
+        entryTy, llvm::Function::ExternalLinkage, name + "_packed", mod);
+    entry->addFnAttr(llvm::Attribute::NoUnwind);
+    builder.SetInsertPoint(llvm::BasicBlock::Create(ctx, "entry", entry));
+    // The last 7 arguments are the program id range and the grid size.
+    unsigned numKernelArgs = kernel->arg_size() - 7;
+    llvm::SmallVector<llvm::Value *> args;
+    for (unsigned i = 0; i < numKernelArgs; ++i) {
+      llvm::Value *slot = builder.CreateConstInBoundsGEP1_32(
+          builder.getInt64Ty(), entry->getArg(0), i);
+      args.push_back(builder.CreateLoad(kernel->getArg(i)->getType(), slot));
+    }
+    for (unsigned i = 0; i < 7; ++i)
+      args.push_back(entry->getArg(i + 1));
+    builder.CreateCall(kernel, args);
+    builder.CreateRetVoid();
+  });
+
+  // Compile all functions of the module for the target CPU and features
+  // instead of the host ones, see ISA variants in compiler.py.
+  m.def("set_target_attributes", [](llvm::Module *mod, const std::string &cpu,
+                                    const std::string &features) {
+    for (llvm::Function &fn : *mod) {
+      if (fn.isDeclaration())
+        continue;
+      fn.addFnAttr("target-cpu", cpu);
+      fn.addFnAttr("target-features", features);
+    }
+  });
+
+  // Limit LLVM to vectors of at most bits, e.g. 256 to keep AVX-512 hosts
+  // from dropping their frequency for 512-bit instructions. Wider vectors of
+  // the IR are split as well, except in functions calling target intrinsics
+  // or functions on wider vectors, or taking or returning wider vectors
+  // themselves, whose arguments have to stay legal.
+  m.def("set_prefer_vector_width", [](llvm::Module *mod, unsigned bits) {
+    auto getVectorBits = [](llvm::Type *ty) -> uint64_t {
+      auto *vecTy = llvm::dyn_cast<llvm::FixedVectorType>(ty);
+      return vecTy ? vecTy->getPrimitiveSizeInBits().getFixedValue() : 0;
+    };
+    for (llvm::Function &fn : *mod) {
+      if (fn.isDeclaration())
+        continue;
+      // Arguments and results of the function itself, e.g. of helpers called
+      // by kernels, must match the callers.
+      llvm::FunctionType *ownTy = fn.getFunctionType();
+      uint64_t minLegalBits = getVectorBits(ownTy->getReturnType());
+      for (llvm::Type *paramTy : ownTy->params())
+        minLegalBits = std::max(minLegalBits, getVectorBits(paramTy));
+      for (llvm::Instruction &inst : llvm::instructions(fn)) {
+        auto *call = llvm::dyn_cast<llvm::CallBase>(&inst);
+        if (!call)
+          continue;
+        // Generic intrinsics, e.g. llvm.fma, are split like other ops.
+        llvm::Function *callee = call->getCalledFunction();
+        if (callee && callee->isIntrinsic() && !callee->isTargetIntrinsic())
+          continue;
+        llvm::FunctionType *fnTy = call->getFunctionType();
+        minLegalBits =
+            std::max(minLegalBits, getVectorBits(fnTy->getReturnType()));
+        for (llvm::Type *paramTy : fnTy->params())
+          minLegalBits = std::max(minLegalBits, getVectorBits(paramTy));
+      }
+      fn.addFnAttr("prefer-vector-width", std::to_string(bits));
+      fn.addFnAttr("min-legal-vector-width", std::to_string(minLegalBits));
+    }
+  });
+
+  // Replace masked loads and stores of fixed vectors whose masks enable a
+  // prefix of lanes, e.g. offs < n of a tail block, with VP intrinsics taking
+  // the number of enabled lanes. RVV then sets the vector length with vsetvl
+  // instead of computing and applying a mask register. Masks of the form
+  // (<k, k + 1, ...> + splat(offset)) < splat(bound) are recognized.
+  m.def("convert_prefix_masks_to_vector_length", [](llvm::Module *mod) {
+    using namespace llvm::PatternMatch;
+    auto isStep = [](llvm::Value *val, int64_t &first) {
+      auto *cst = llvm::dyn_cast<llvm::Constant>(val);
+      auto *vecTy = llvm::dyn_cast<llvm::FixedVectorType>(val->getType());
+      if (!cst || !vecTy)
+        return false;
+      for (unsigned i = 0; i < vecTy->getNumElements(); ++i) {
+        auto *elem = llvm::dyn_cast_or_null<llvm::ConstantInt>(
+            cst->getAggregateElement(i));
+        if (!elem)
+          return false;
+        if (i == 0)
+          first = elem->getSExtValue();
+        else if (elem->getSExtValue() != first + i)
+          return false;
+      }
+      return true;
+    };
+    // Return the number of enabled lanes of the mask as i32, or null.
+    auto getLength = [&](llvm::IRBuilder<> &builder,
+                         llvm::Value *mask) -> llvm::Value * {
+      auto *cmp = llvm::dyn_cast<llvm::ICmpInst>(mask);
+      if (!cmp)
+        return nullptr;
+      llvm::ICmpInst::Predicate pred = cmp->getPredicate();
+      llvm::Value *lhs = cmp->getOperand(0);
+      llvm::Value *rhs = cmp->getOperand(1);
+      if (pred == llvm::ICmpInst::ICMP_SGT) {
+        std::swap(lhs, rhs);
+        pred = llvm::ICmpInst::ICMP_SLT;
+      }
+      llvm::Value *bound = llvm::getSplatValue(rhs);
+      if (pred != llvm::ICmpInst::ICMP_SLT || !bound)
+        return nullptr;
+      int64_t first;
+      llvm::Value *step, *offsets = nullptr;
+      if (!isStep(lhs, first) &&
+          !(match(lhs, m_c_Add(m_Value(step), m_Value(offsets))) &&
+            isStep(step, first)))
+        return nullptr;
+      llvm::Value *offset = nullptr;
+      if (offsets && !(offset = llvm::getSplatValue(offsets)))
+        return nullptr;
+      unsigned numElems =
+          llvm::cast<llvm::FixedVectorType>(mask->getType())->getNumElements();
+      // bound - first - offset is computed in twice as many bits, so it
+      // can't wrap, e.g. to a positive length for offsets past the bound.
+      auto *elemTy = llvm::cast<llvm::IntegerType>(bound->getType());
+      auto *wideTy = builder.getIntNTy(elemTy->getBitWidth() * 2);
+      llvm::Value *len =
+          builder.CreateNSWSub(builder.CreateSExt(bound, wideTy),
+                               llvm::ConstantInt::get(wideTy, first,
+                                                      /*IsSigned=*/true));
+      if (offset)
+        len = builder.CreateNSWSub(len, builder.CreateSExt(offset, wideTy));
+      len = builder.CreateBinaryIntrinsic(llvm::Intrinsic::smax, len,
+                                          llvm::ConstantInt::get(wideTy, 0));
+      len = builder.CreateBinaryIntrinsic(
+          llvm::Intrinsic::smin, len, llvm::ConstantInt::get(wideTy, numElems));
+      return builder.CreateTrunc(len, builder.getInt32Ty());
+    };
+
+    for (llvm::Function &fn : *mod) {
+      llvm::SmallVector<llvm::IntrinsicInst *> calls;
+      for (llvm::Instruction &inst : llvm::instructions(fn)) {
+        auto *call = llvm::dyn_cast<llvm::IntrinsicInst>(&inst);
+        if (call && (call->getIntrinsicID() == llvm::Intrinsic::masked_load ||
+                     call->getIntrinsicID() == llvm::Intrinsic::masked_store))
+          calls.push_back(call);
+      }
+      for (llvm::IntrinsicInst *call : calls) {
+        bool isLoad = call->getIntrinsicID() == llvm::Intrinsic::masked_load;
+        // masked.load(ptr, align, mask, passthru) and
+        // masked.store(value, ptr, align, mask).
+        unsigned ptrIdx = isLoad ? 0 : 1;
+        llvm::Value *ptr = call->getArgOperand(ptrIdx);
+        auto align = llvm::cast<llvm::ConstantInt>(
+                         call->getArgOperand(ptrIdx + 1))
+                         ->getAlignValue();
+        llvm::Value *mask = call->getArgOperand(ptrIdx + 2);
+        llvm::IRBuilder<> builder(call);
+        llvm::Value *len = getLength(builder, mask);
+        if (!len)
+          continue;
+        llvm::Value *allTrue = llvm::Constant::getAllOnesValue(mask->getType());
+        llvm::CallInst *vpCall;
+        if (isLoad) {
+          vpCall = builder.CreateIntrinsic(llvm::Intrinsic::vp_load,
+                                           {call->getType(), ptr->getType()},
+                                           {ptr, allTrue, len});
+          llvm::Value *res = vpCall;
+          // Disabled lanes take the pass-through values.
+          llvm::Value *passthru = call->getArgOperand(3);
+          if (!llvm::isa<llvm::UndefValue>(passthru))
+            res = builder.CreateIntrinsic(llvm::Intrinsic::vp_merge,
+                                          {call->getType()},
+                                          {allTrue, vpCall, passthru, len});
+          call->replaceAllUsesWith(res);
+        } else {
+          llvm::Value *value = call->getArgOperand(0);
+          vpCall = builder.CreateIntrinsic(llvm::Intrinsic::vp_store,
+                                           {value->getType(), ptr->getType()},
+                                           {value, ptr, allTrue, len});
+        }
+        vpCall->addParamAttr(ptrIdx, llvm::Attribute::getWithAlignment(
+                                         mod->getContext(), align));
+        call->eraseFromParent();
+      }
+    }
+  });
+
+  // Export counters of a module instrumented for PGO, see pgo_warmup in
+  // compiler.py. Kernels aren't linked with the profile runtime, so the
+  // launcher reads counters of each function through their symbols instead,
+  // which become visible to dlsym here. Return (function name, CFG hash,
+  // counters symbol, number of counters) of each instrumented function.
+  m.def("export_pgo_counters", [](llvm::Module *mod) {
+    // Data of functions refers to their names by MD5 hashes only.
+    std::map<uint64_t, std::string> names;
+    if (auto *namesVar = mod->getGlobalVariable(
+            llvm::getInstrProfNamesVarName(), /*AllowInternal=*/true)) {
+      auto *init =
+          llvm::dyn_cast<llvm::ConstantDataArray>(namesVar->getInitializer());
+      if (init) {
+        llvm::Error err = llvm::readAndDecodeStrings(
+            init->getRawDataValues(), [&](llvm::StringRef name) {
+              names[llvm::IndexedInstrProf::ComputeHash(name)] = name.str();
+              return llvm::Error::success();
+            });
+        if (err)
+          throw std::runtime_error("can't decode PGO names: " +
+                                   llvm::toString(std::move(err)));
+      }
+    }
+    const llvm::StringRef countersPrefix =
+        llvm::getInstrProfCountersVarPrefix();
+    std::vector<std::tuple<std::string, uint64_t, std::string, uint64_t>>
+        counters;
+    for (llvm::GlobalVariable &var : mod->globals()) {
+      llvm::StringRef symbol = var.getName();
+      if (!symbol.starts_with(countersPrefix))
+        continue;
+      auto *data = mod->getGlobalVariable(
+          (llvm::getInstrProfDataVarPrefix() +
+           symbol.drop_front(countersPrefix.size()))
+              .str(),
+          /*AllowInternal=*/true);
+      auto *dataInit = data ? llvm::dyn_cast<llvm::ConstantStruct>(
+                                  data->getInitializer())
+                            : nullptr;
+      auto *countersTy = llvm::dyn_cast<llvm::ArrayType>(var.getValueType());
+      if (!dataInit || !countersTy)
+        continue;
+      // The first fields of the data are the name hash and the CFG hash.
+      auto *nameRef =
+          llvm::dyn_cast<llvm::ConstantInt>(dataInit->getOperand(0));
+      auto *funcHash =
+          llvm::dyn_cast<llvm::ConstantInt>(dataInit->getOperand(1));
+      if (!nameRef || !funcHash)
+        continue;
+      auto name = names.find(nameRef->getZExtValue());
+      if (name == names.end())
+        continue;
+      var.setLinkage(llvm::GlobalValue::ExternalLinkage);
+      var.setVisibility(llvm::GlobalValue::DefaultVisibility);
+      counters.emplace_back(name->second, funcHash->getZExtValue(),
+                            symbol.str(), countersTy->getNumElements());
+    }
+    return counters;
+  });
+
+  // Write an indexed profile, as llvm-profdata merge would, of counters
+  // exported by export_pgo_counters given as (function name, CFG hash,
+  // counter values) of each function.
+  m.def(
+      "write_pgo_profile",
+      [](const std::vector<std::tuple<std::string, uint64_t,
+                                      std::vector<uint64_t>>> &records) {
+        llvm::InstrProfWriter writer;
+        if (llvm::Error err = writer.mergeProfileKind(
+                llvm::InstrProfKind::IRInstrumentation))
+          throw std::runtime_error(llvm::toString(std::move(err)));
+        std::string warnings;
+        for (const auto &[name, hash, counts] : records)
+          writer.addRecord(llvm::NamedInstrProfRecord(name, hash, counts),
+                           [&](llvm::Error err) {
+                             warnings += llvm::toString(std::move(err));
+                           });
+        if (!warnings.empty())
+          throw std::runtime_error("can't write PGO profile: " + warnings);
+        std::unique_ptr<llvm::MemoryBuffer> buffer = writer.writeBuffer();
+        return py::bytes(buffer->getBufferStart(), buffer->getBufferSize());
+      });
+
+  // Link ISA variants of a kernel into a single module. Each variant is a
+  // (LLVM IR, suffix, required features) tuple, variants are ordered from the
+  // best to the worst one. Entry points of variants are renamed to
+  // "<entry>__<suffix>" and other symbols are internalized. The "<name>_range"
+  // and "<name>_packed" entry points call the best variant supported by the
+  // host, which is chosen by a constructor when the library is loaded.
+  // Dispatch code is compiled for baseline_cpu, so it runs on any host.
+  m.def("link_isa_variants",
+        [](const std::string &name,
+           const std::vector<std::tuple<std::string, std::string, std::string>>
+               &variants,
+           const std::string &baseline_cpu) {
+          if (variants.empty())
+            throw std::runtime_error("no ISA variants to link");
+          llvm::LLVMContext ctx;
+          std::unique_ptr<llvm::Module> dst;
+          const std::vector<std::string> entries = {"_range", "_packed"};
+          for (const auto &[ir, suffix, features] : variants) {
+            llvm::SMDiagnostic error;
+            std::unique_ptr<llvm::Module> mod = llvm::parseIR(
+                llvm::MemoryBufferRef(ir, name + "__" + suffix), error, ctx);
+            if (!mod)
+              throw std::runtime_error("failed to parse IR of " + suffix +
+                                       " variant: " +
+                                       error.getMessage().str());
+            for (llvm::GlobalValue &gv : mod->global_values()) {
+              if (gv.isDeclaration() || gv.getName().starts_with("llvm."))
+                continue;
+              std::string gvName = gv.getName().str();
+              if (gvName == name + "_range" || gvName == name + "_packed" ||
+                  gvName == name)
+                gv.setName(gvName + "__" + suffix);
+              else
+                gv.setLinkage(llvm::GlobalValue::InternalLinkage);
+            }
+            if (!dst)
+              dst = std::move(mod);
+            else if (llvm::Linker::linkModules(*dst, std::move(mod)))
+              throw std::runtime_error("failed to link " + suffix +
+                                       " variant");
+          }
+
+          llvm::IRBuilder<> builder(ctx);
+          llvm::Type *ptrTy = builder.getPtrTy();
+          auto setBaseline = [&](llvm::Function *fn) {
+            fn->addFnAttr("target-cpu", baseline_cpu);
+            fn->addFnAttr(llvm::Attribute::NoUnwind);
+          };
+          auto *supportedFn = llvm::cast<llvm::Function>(
+              dst->getOrInsertFunction(
+                     "triton_cpu_isa_supported",
+                     llvm::FunctionType::get(builder.getInt1Ty(), {ptrTy},
+                                             /*isVarArg=*/false))
+                  .getCallee());
+          auto *unsupportedFn = llvm::cast<llvm::Function>(
+              dst->getOrInsertFunction(
+                     "triton_cpu_isa_unsupported",
+                     llvm::FunctionType::get(builder.getVoidTy(), {ptrTy},
+                                             /*isVarArg=*/false))
+                  .getCallee());
+          unsupportedFn->setDoesNotReturn();
+
+          // Pointers to the selected variant of each entry point.
+          std::vector<llvm::GlobalVariable *> selected;
+          for (const std::string &entry : entries) {
+            llvm::Function *first = dst->getFunction(
+                name + entry + "__" + std::get<1>(variants.front()));
+            if (!first)
+              throw std::runtime_error("entry point " + name + entry +
+                                       " not found");
+            auto *ptr = new llvm::GlobalVariable(
+                *dst, ptrTy, /*isConstant=*/false,
+                llvm::GlobalValue::InternalLinkage,
+                llvm::ConstantPointerNull::get(builder.getPtrTy()),
+                name + entry + "__selected");
+            selected.push_back(ptr);
+
+            auto *fn = llvm::Function::Create(
+                first->getFunctionType(), llvm::Function::ExternalLinkage,
+                name + entry, dst.get());
+            setBaseline(fn);
+            auto *entryBB = llvm::BasicBlock::Create(ctx, "entry", fn);
+            auto *callBB = llvm::BasicBlock::Create(ctx, "call", fn);
+            auto *failBB = llvm::BasicBlock::Create(ctx, "unsupported", fn);
+            builder.SetInsertPoint(entryBB);
+            llvm::Value *callee = builder.CreateLoad(ptrTy, ptr);
+            builder.CreateCondBr(builder.CreateIsNull(callee), failBB, callBB);
+            builder.SetInsertPoint(failBB);
+            builder.CreateCall(unsupportedFn,
+                               {builder.CreateGlobalString(name)});
+            builder.CreateUnreachable();
+            builder.SetInsertPoint(callBB);
+            llvm::SmallVector<llvm::Value *> args;
+            for (llvm::Argument &arg : fn->args())
+              args.push_back(&arg);
+            builder.CreateCall(first->getFunctionType(), callee, args);
+            builder.CreateRetVoid();
+          }
+
+          // Select the best supported variant when the library is loaded.
+          auto *ctor = llvm::Function::Create(
+              llvm::FunctionType::get(builder.getVoidTy(), false),
+              llvm::Function::InternalLinkage, name + "__select_isa_variant",
+              dst.get());
+          setBaseline(ctor);
+          auto *bb = llvm::BasicBlock::Create(ctx, "entry", ctor);
+          for (const auto &[ir, suffix, features] : variants) {
+            builder.SetInsertPoint(bb);
+            llvm::Value *supported = builder.CreateCall(
+                supportedFn, {builder.CreateGlobalString(features)});
+            auto *selectBB = llvm::BasicBlock::Create(ctx, suffix, ctor);
+            auto *nextBB = llvm::BasicBlock::Create(ctx, "next", ctor);
+            builder.CreateCondBr(supported, selectBB, nextBB);
+            builder.SetInsertPoint(selectBB);
+            for (size_t i = 0; i < entries.size(); ++i)
+              builder.CreateStore(
+                  dst->getFunction(name + entries[i] + "__" + suffix),
+                  selected[i]);
+            builder.CreateRetVoid();
+            bb = nextBB;
+          }
+          builder.SetInsertPoint(bb);
+          builder.CreateRetVoid();
+          llvm::appendToGlobalCtors(*dst, ctor, /*Priority=*/65535);
+
+          std::string res;
+          llvm::raw_string_ostream os(res);
+          dst->print(os, nullptr);
+          return res;
+        });
+
+  // Prepare the LLVM IR of a kernel for ahead-of-time compilation: symbols of
+  // the kernel and its entry points, including those of ISA variants, get
+  // new_name in place of name, and all other definitions are internalized.
+  // Several specializations of a kernel can then be linked into a binary.
+  m.def("rename_kernel", [](const std::string &ir, const std::string &name,
+                            const std::string &new_name) {
+    llvm::LLVMContext ctx;
+    llvm::SMDiagnostic error;
+    std::unique_ptr<llvm::Module> mod =
+        llvm::parseIR(llvm::MemoryBufferRef(ir, name), error, ctx);
+    if (!mod)
+      throw std::runtime_error("failed to parse IR of " + name + ": " +
+                               error.getMessage().str());
+    for (llvm::GlobalValue &gv : mod->global_values()) {
+      if (gv.isDeclaration() || gv.getName().starts_with("llvm."))
+        continue;
+      std::string gvName = gv.getName().str();
+      llvm::StringRef rest = llvm::StringRef(gvName);
+      if (rest.consume_front(name) &&
+          (rest.empty() || rest.starts_with("_range") ||
+           rest.starts_with("_packed") || rest.starts_with("__")))
+        gv.setName(new_name + rest.str());
+      else if (!gv.hasLocalLinkage())
+        gv.setLinkage(llvm::GlobalValue::InternalLinkage);
+    }
+
+    std::string res;
+    llvm::raw_string_ostream os(res);
+    mod->print(os, nullptr);
+    return res;
+  });
+
+  // Link kernels prepared by rename_kernel into a single module, so many
+  // kernels can be loaded from one shared object. The manifest is stored to
+  // the exported triton_cpu_bundle_manifest string, so the loader finds the
+  // kernels of the library without a separate index.
+  m.def("link_kernel_bundle", [](const std::vector<std::string> &irs,
+                                 const std::string &manifest) {
+    if (irs.empty())
+      throw std::runtime_error("no kernels to bundle");
+    llvm::LLVMContext ctx;
+    std::unique_ptr<llvm::Module> dst;
+    for (size_t i = 0; i < irs.size(); ++i) {
+      std::string bufName = "kernel" + std::to_string(i);
+      llvm::SMDiagnostic error;
+      std::unique_ptr<llvm::Module> mod =
+          llvm::parseIR(llvm::MemoryBufferRef(irs[i], bufName), error, ctx);
+      if (!mod)
+        throw std::runtime_error("failed to parse IR of " + bufName + ": " +
+                                 error.getMessage().str());
+      if (!dst)
+        dst = std::move(mod);
+      else if (llvm::Linker::linkModules(*dst, std::move(mod)))
+        throw std::runtime_error("failed to link " + bufName);
+    }
+    new llvm::GlobalVariable(
+        *dst, llvm::ArrayType::get(llvm::Type::getInt8Ty(ctx),
+                                   manifest.size() + 1),
+        /*isConstant=*/true, llvm::GlobalValue::ExternalLinkage,
+        llvm::ConstantDataArray::getString(ctx, manifest),
+        "triton_cpu_bundle_manifest");
+
+    std::string res;
+    llvm::raw_string_ostream os(res);
+    dst->print(os, nullptr);
+    return res;
+  });
+
+  // Record wall time and the number of ops after each pass run by pm, see
+  // the profile_compile option.
+  py::class_<PassProfile, std::shared_ptr<PassProfile>>(m, "pass_profile")
+      .def("records", [](PassProfile &self) {
+        std::lock_guard<std::mutex> lock(self.mutex);
+        std::vector<std::tuple<std::string, double, int64_t>> res;
+        for (const PassProfile::Record &record : self.records)
+          res.emplace_back(record.name, record.ms, record.ops);
+        return res;
+      });
+
+  m.def("add_pass_profile", [](mlir::PassManager &pm) {
+    auto profile = std::make_shared<PassProfile>();
+    pm.addInstrumentation(
+        std::make_unique<PassProfileInstrumentation>(profile));
+    return profile;
+  });
+
+  m.def("count_llvm_instructions", [](llvm::Module *mod) -> int64_t {
+    return mod->getInstructionCount();
+  });
+
   m.def("find_kernel_names", [](mlir::ModuleOp &mod) {
     std::vector<std::string> res;
     mod.walk([&](mlir::FunctionOpInterface funcOp) {
-      // Kernel functions are public and have a body.
+      // Kernel functions are public and have a body. Skip additional entry
+      // points of kernels.
       if (!funcOp.getFunctionBody().empty() &&
-          funcOp.getVisibility() == mlir::SymbolTable::Visibility::Public)
+          funcOp.getVisibility() == mlir::SymbolTable::Visibility::Public &&
+          !funcOp->hasAttr(mlir::triton::cpu::AttrKernelEntryName))
         res.push_back(funcOp.getName().str());
     });
     return res;
   });
+
+  // Return the static estimate of FLOPs and global memory bytes of a single
+  // program of the kernel, see KernelCost.
+  m.def("estimate_kernel_cost",
+        [](mlir::ModuleOp &mod, const std::string &name) {
+          auto cost = mlir::triton::cpu::estimateKernelCost(mod, name);
+          py::dict res;
+          res["flops"] = cost.flops;
+          res["bytes"] = cost.bytes;
+          res["exact"] = cost.exact;
+          res["min_store_bytes"] = cost.minStoreBytes;
+          return res;
+        });
+
+  // Return the static estimate of the number of operations the blocks of a
+  // TTIR module are unrolled into, see UnrolledSize.
+  m.def("estimate_unrolled_size",
+        [](mlir::ModuleOp &mod, unsigned vector_bits) {
+          auto size = mlir::triton::cpu::estimateUnrolledSize(mod, vector_bits);
+          py::dict res;
+          res["vector_ops"] = size.vectorOps;
+          res["element_ops"] = size.elementOps;
+          return res;
+        });
 }
@@ -2,18 +2,32 @@
 #define PROTON_CONTEXT_PYTHON_H_
 
 #include "Context.h"
+#include <memory>
 
 namespace proton {
 
 /// Unwind the Python stack and early return a list of contexts.
+///
+/// Frames are interned by code object and instruction, and the contexts of
+/// each call path are built once, so a capture walks the frames without
+/// decoding their names. The contexts of the path are still copied into the
+/// result of every capture.
+/// With a `sampleInterval` above one, only every `sampleInterval`-th launch of
+/// a call site, i.e. the innermost frame outside of triton, walks the whole
+/// stack, and the others are attributed to the path of its last walk.
 class PythonContextSource : public ContextSource {
 public:
-  PythonContextSource() = default;
+  explicit PythonContextSource(size_t sampleInterval = 1);
+  ~PythonContextSource() override;
 
   size_t getDepth() override;
 
 private:
   std::vector<Context> getContextsImpl() override;
+
+  class FrameCache;
+  std::unique_ptr<FrameCache> frameCache;
+  size_t sampleInterval;
 };
 
 } // namespace proton
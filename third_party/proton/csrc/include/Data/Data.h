@@ -35,8 +35,11 @@ public:
   /// Clear all caching data.
   virtual void clear() = 0;
 
+  /// Merge metrics that are buffered by threads into the data.
+  virtual void flush() {}
+
   /// Dump the data to the given output format.
-  void dump(OutputFormat outputFormat);
+  virtual void dump(OutputFormat outputFormat);
 
 protected:
   /// The actual implementation of the dump operation.
@@ -3,8 +3,13 @@
 
 #include "Context/Context.h"
 #include "Data.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <unordered_map>
+#include <vector>
 
 namespace proton {
 
@@ -15,6 +20,14 @@ public:
 
   TreeData(const std::string &path) : TreeData(path, nullptr) {}
 
+  /// Create data that streams metrics for long-running processes. Every
+  /// `streamInterval`, metrics recorded so far are written as a window to a
+  /// gzip-compressed hatchet file `<path>.<window>.hatchet.gz` and reset, so
+  /// memory doesn't grow with the run time. Only the last `maxStreamWindows`
+  /// window files are kept.
+  TreeData(const std::string &path, ContextSource *contextSource,
+           std::chrono::milliseconds streamInterval, size_t maxStreamWindows);
+
   size_t addOp(size_t scopeId, const std::string &name) override;
 
   void addMetric(size_t scopeId, std::shared_ptr<Metric> metric) override;
@@ -25,6 +38,10 @@ public:
 
   void clear() override;
 
+  void flush() override;
+
+  void dump(OutputFormat outputFormat) override;
+
 protected:
   // ScopeInterface
   void enterScope(const Scope &scope) override;
@@ -36,6 +53,19 @@ private:
   void dumpHatchet(std::ostream &os) const;
   void doDump(std::ostream &os, OutputFormat outputFormat) const override;
 
+  bool isStreaming() const { return streamInterval.count() > 0; }
+  std::string getWindowPath(size_t window) const;
+  // Write the metrics recorded since the last window and reset them.
+  void streamWindow();
+
+  // Metrics are added to a buffer of the calling thread, which only contends
+  // with merges of the buffer, and merged into the tree when the thread exits
+  // a scope, when the buffer holds MaxBufferedScopes scopes, or on flush.
+  struct MetricBuffer;
+  static constexpr size_t MaxBufferedScopes = 1024;
+  MetricBuffer &getThreadBuffer();
+  void mergeBuffer(MetricBuffer &buffer);
+
   // `tree` and `scopeIdToContextId` can be accessed by both the user thread and
   // the background threads concurrently, so methods that access them should be
   // protected by a (shared) mutex.
@@ -43,6 +73,21 @@ private:
   std::unique_ptr<Tree> tree;
   // ScopeId -> ContextId
   std::unordered_map<size_t, size_t> scopeIdToContextId;
+
+  // Threads find their buffers by the id of the data rather than its
+  // address, which may be reused by data created later.
+  inline static std::atomic<size_t> nextId{0};
+  const size_t id{nextId++};
+  std::mutex buffersMutex;
+  std::vector<std::shared_ptr<MetricBuffer>> buffers;
+
+  const std::chrono::milliseconds streamInterval{0};
+  const size_t maxStreamWindows{0};
+  // Time of the next window in nanoseconds since the steady clock's epoch
+  std::atomic<int64_t> nextWindowTime{0};
+  // Serializes windows, so their files are written in order
+  std::mutex streamMutex;
+  size_t numWindows{0};
 };
 
 } // namespace proton
@@ -6,7 +6,7 @@
 
 namespace proton {
 
-enum class DeviceType { HIP, CUDA, COUNT };
+enum class DeviceType { HIP, CUDA, CPU, COUNT };
 
 template <DeviceType T> struct DeviceTraits;
 
@@ -20,6 +20,11 @@ template <> struct DeviceTraits<DeviceType::HIP> {
   constexpr static const char *name = "HIP";
 };
 
+template <> struct DeviceTraits<DeviceType::CPU> {
+  constexpr static DeviceType type = DeviceType::CPU;
+  constexpr static const char *name = "CPU";
+};
+
 struct Device {
   DeviceType type;
   uint64_t id;
@@ -0,0 +1,53 @@
+#ifndef PROTON_PROFILER_CPU_PROFILER_H_
+#define PROTON_PROFILER_CPU_PROFILER_H_
+
+#include "Context/Context.h"
+#include "Profiler/Profiler.h"
+#include "Utility/Singleton.h"
+
+#include <memory>
+#include <string>
+
+namespace proton {
+
+/// Profiler of Triton kernels running on the CPU backend.
+/// Launchers of the CPU backend record launches into the launch trace of the
+/// Triton CPU runtime. Each launch is tagged with the id of the op in
+/// progress on the submitting thread, so launches running asynchronously on
+/// streams are attributed to the right scope.
+/// With PC sampling, the runtime also samples instruction pointers of threads
+/// running programs, and samples are attributed to source lines of kernels
+/// under the scope of the op in progress.
+class CpuProfiler : public Profiler,
+                    public ThreadLocalOpInterface,
+                    public Singleton<CpuProfiler> {
+public:
+  CpuProfiler();
+  virtual ~CpuProfiler();
+
+  /// Set the directory containing libTritonCPURuntime.so. It is only used if
+  /// the runtime is not loaded into the process yet.
+  CpuProfiler &setLibPath(const std::string &libPath);
+
+  CpuProfiler &enablePCSampling();
+  CpuProfiler &disablePCSampling();
+  bool isPCSamplingEnabled() const;
+
+protected:
+  // OpInterface
+  void startOp(const Scope &scope) override;
+  void stopOp(const Scope &scope) override;
+
+  // Profiler
+  void doStart() override;
+  void doFlush() override;
+  void doStop() override;
+
+private:
+  struct CpuProfilerPimpl;
+  std::unique_ptr<CpuProfilerPimpl> pImpl;
+};
+
+} // namespace proton
+
+#endif // PROTON_PROFILER_CPU_PROFILER_H_
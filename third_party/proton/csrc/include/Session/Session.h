@@ -8,6 +8,7 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <set>
 #include <string>
 #include <vector>
@@ -161,7 +162,9 @@ private:
     updateInterfaceCount<Interface, Counter, false>(sessionId, interfaceCounts);
   }
 
-  mutable std::mutex mutex;
+  // Metrics are added under a shared lock, so threads adding them don't
+  // serialize on the session manager.
+  mutable std::shared_mutex mutex;
 
   size_t nextSessionId{};
   // path -> session id
@@ -1,7 +1,9 @@
 #include "Context/Python.h"
 #include "pybind11/pybind11.h"
-#include <algorithm>
+#include <functional>
+#include <optional>
 #include <string>
+#include <unordered_map>
 
 namespace proton {
 
@@ -52,6 +54,19 @@ PyFrameObject *getFrameBack(PyFrameObject *frame) {
 }
 #endif
 
+// bpo-46836 added PyFrame_GetLasti() to Python 3.11.0a7
+#if PY_VERSION_HEX < 0x030B00A7
+int getFrameLasti(PyFrameObject *frame) {
+  assert(frame != nullptr);
+  return frame->f_lasti;
+}
+#else
+int getFrameLasti(PyFrameObject *frame) {
+  assert(frame != nullptr);
+  return PyFrame_GetLasti(frame);
+}
+#endif
+
 std::string unpackPyobject(PyObject *pyObject) {
   if (PyBytes_Check(pyObject)) {
     size_t size = PyBytes_GET_SIZE(pyObject);
@@ -69,31 +84,155 @@ std::string unpackPyobject(PyObject *pyObject) {
   return "";
 }
 
-} // namespace
+struct PairHash {
+  template <typename T, typename U>
+  size_t operator()(const std::pair<T, U> &pair) const {
+    size_t hash = std::hash<T>()(pair.first);
+    return hash ^ (std::hash<U>()(pair.second) + 0x9e3779b9 + (hash << 6) +
+                   (hash >> 2));
+  }
+};
 
-std::vector<Context> PythonContextSource::getContextsImpl() {
+// Return the directory of the triton package, whose frames don't identify
+// call sites.
+std::string getTritonDir() {
   pybind11::gil_scoped_acquire gil;
+  try {
+    auto file = pybind11::module_::import("triton")
+                    .attr("__file__")
+                    .cast<std::string>();
+    return file.substr(0, file.find_last_of('/') + 1);
+  } catch (const std::exception &) {
+    PyErr_Clear();
+    return "";
+  }
+}
+
+} // namespace
 
-  PyFrameObject *frame = PyEval_GetFrame();
-  Py_XINCREF(frame);
+/// Interned frames and call paths. All members are protected by the GIL.
+class PythonContextSource::FrameCache {
+public:
+  FrameCache() : tritonDir(getTritonDir()) {}
 
-  std::vector<Context> contexts;
-  while (frame != nullptr) {
-    PyCodeObject *f_code = getFrameCodeObject(frame);
+  ~FrameCache() {
+    // Code objects stay alive at exit, when the interpreter is gone.
+    if (!Py_IsInitialized())
+      return;
+    pybind11::gil_scoped_acquire gil;
+    for (auto &[key, frameId] : frameIds)
+      Py_DECREF(key.first);
+  }
+
+  // Return the contexts of the current stack, root first.
+  const std::vector<Context> &capture(size_t sampleInterval) {
+    PyFrameObject *frame = PyEval_GetFrame();
+    Py_XINCREF(frame);
+
+    stackFrameIds.clear();
+    std::optional<size_t> callSite;
+    while (frame != nullptr) {
+      auto frameId = getFrameId(frame);
+      stackFrameIds.push_back(frameId);
+      if (sampleInterval > 1 && !callSite && !frames[frameId].internal) {
+        callSite = frameId;
+        auto site = callSites.find(frameId);
+        if (site != callSites.end() &&
+            site->second.launches++ % sampleInterval != 0) {
+          Py_DECREF(frame);
+          return pathContexts[site->second.pathId];
+        }
+      }
+      auto newFrame = getFrameBack(frame);
+      Py_DECREF(frame);
+      frame = newFrame;
+    }
+
+    auto pathId = getPathId(stackFrameIds);
+    if (callSite)
+      callSites.try_emplace(*callSite, CallSite{1, pathId})
+          .first->second.pathId = pathId;
+    return pathContexts[pathId];
+  }
+
+private:
+  struct Frame {
+    Context context;
+    // Whether the frame is in the triton package.
+    bool internal;
+  };
+
+  struct CallSite {
+    size_t launches;
+    size_t pathId;
+  };
+
+  size_t getFrameId(PyFrameObject *frame) {
+    PyCodeObject *code = getFrameCodeObject(frame);
+    auto [it, inserted] = frameIds.try_emplace(
+        std::make_pair(code, getFrameLasti(frame)), frames.size());
+    if (!inserted) {
+      Py_DECREF(code);
+      return it->second;
+    }
+    // The entry keeps the reference to the code object, so its address
+    // isn't reused by another one.
     size_t lineno = PyFrame_GetLineNumber(frame);
-    size_t firstLineNo = f_code->co_firstlineno;
-    std::string file = unpackPyobject(f_code->co_filename);
-    std::string function = unpackPyobject(f_code->co_name);
-    auto pythonFrame = file + ":" + function + "@" + std::to_string(lineno);
-    contexts.push_back(Context(pythonFrame));
-    auto newFrame = getFrameBack(frame);
-    Py_DECREF(frame);
-    frame = newFrame;
+    std::string file = unpackPyobject(code->co_filename);
+    std::string function = unpackPyobject(code->co_name);
+    bool internal = !tritonDir.empty() && file.rfind(tritonDir, 0) == 0;
+    frames.push_back(
+        {Context(file + ":" + function + "@" + std::to_string(lineno)),
+         internal});
+    return it->second;
+  }
+
+  // Return the id of the path of frames, innermost first, and build its
+  // contexts the first time.
+  size_t getPathId(const std::vector<size_t> &frameIdsInnermostFirst) {
+    size_t pathId = 0;
+    for (auto frameId : frameIdsInnermostFirst)
+      pathId = pathIds.try_emplace({pathId, frameId}, pathIds.size() + 1)
+                   .first->second;
+    auto [it, inserted] = pathContexts.try_emplace(pathId);
+    if (inserted) {
+      it->second.reserve(frameIdsInnermostFirst.size());
+      for (auto frameId = frameIdsInnermostFirst.rbegin();
+           frameId != frameIdsInnermostFirst.rend(); ++frameId)
+        it->second.push_back(frames[*frameId].context);
+    }
+    return pathId;
   }
-  std::reverse(contexts.begin(), contexts.end());
-  return contexts;
+
+  std::string tritonDir;
+  // (code object, last instruction) -> frame id
+  std::unordered_map<std::pair<PyCodeObject *, int>, size_t, PairHash>
+      frameIds;
+  // frame id -> frame
+  std::vector<Frame> frames;
+  // (path id of the inner frames, frame id) -> path id, 0 is the empty path
+  std::unordered_map<std::pair<size_t, size_t>, size_t, PairHash> pathIds;
+  // path id -> contexts, only for captured paths
+  std::unordered_map<size_t, std::vector<Context>> pathContexts;
+  // frame id of the innermost frame outside of triton -> call site
+  std::unordered_map<size_t, CallSite> callSites;
+  std::vector<size_t> stackFrameIds;
+};
+
+PythonContextSource::PythonContextSource(size_t sampleInterval)
+    : frameCache(std::make_unique<FrameCache>()),
+      sampleInterval(sampleInterval) {}
+
+PythonContextSource::~PythonContextSource() = default;
+
+std::vector<Context> PythonContextSource::getContextsImpl() {
+  pybind11::gil_scoped_acquire gil;
+  return frameCache->capture(sampleInterval);
 }
 
-size_t PythonContextSource::getDepth() { return getContextsImpl().size(); }
+size_t PythonContextSource::getDepth() {
+  pybind11::gil_scoped_acquire gil;
+  return frameCache->capture(/*sampleInterval=*/1).size();
+}
 
 } // namespace proton
@@ -10,6 +10,7 @@
 namespace proton {
 
 void Data::dump(OutputFormat outputFormat) {
+  flush();
   std::shared_lock<std::shared_mutex> lock(mutex);
 
   std::unique_ptr<std::ostream> out;
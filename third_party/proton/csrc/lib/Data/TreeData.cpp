@@ -4,12 +4,16 @@
 #include "Driver/Device.h"
 #include "nlohmann/json.hpp"
 
+#include <cstdio>
 #include <limits>
 #include <map>
 #include <mutex>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 
+#include <zlib.h>
+
 using json = nlohmann::json;
 
 namespace proton {
@@ -99,8 +103,72 @@ private:
   std::map<size_t, TreeNode> treeNodeMap;
 };
 
+struct TreeData::MetricBuffer {
+  struct ScopeMetrics {
+    std::map<MetricKind, std::shared_ptr<Metric>> metrics;
+    std::map<std::string, FlexibleMetric> flexibleMetrics;
+  };
+
+  std::mutex mutex;
+  // Metrics aggregated by scope id
+  std::unordered_map<size_t, ScopeMetrics> scopes;
+};
+
 void TreeData::init() { tree = std::make_unique<Tree>(); }
 
+TreeData::MetricBuffer &TreeData::getThreadBuffer() {
+  thread_local std::unordered_map<size_t, std::shared_ptr<MetricBuffer>>
+      threadBuffers;
+  auto &buffer = threadBuffers[id];
+  if (!buffer) {
+    buffer = std::make_shared<MetricBuffer>();
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    buffers.push_back(buffer);
+  }
+  return *buffer;
+}
+
+void TreeData::mergeBuffer(MetricBuffer &buffer) {
+  std::unordered_map<size_t, MetricBuffer::ScopeMetrics> scopes;
+  {
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    scopes.swap(buffer.scopes);
+  }
+  if (scopes.empty())
+    return;
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  for (auto &[scopeId, scopeMetrics] : scopes) {
+    auto scopeIdIt = scopeIdToContextId.find(scopeId);
+    // The profile data is deactivated, ignore the metrics
+    if (scopeIdIt == scopeIdToContextId.end())
+      continue;
+    auto &node = tree->getNode(scopeIdIt->second);
+    for (auto &[metricKind, metric] : scopeMetrics.metrics) {
+      if (node.metrics.find(metricKind) == node.metrics.end())
+        node.metrics.emplace(metricKind, metric);
+      else
+        node.metrics[metricKind]->updateMetric(*metric);
+    }
+    for (auto &[metricName, flexibleMetric] : scopeMetrics.flexibleMetrics) {
+      auto it = node.flexibleMetrics.find(metricName);
+      if (it == node.flexibleMetrics.end())
+        node.flexibleMetrics.emplace(metricName, flexibleMetric);
+      else
+        it->second.updateMetric(flexibleMetric);
+    }
+  }
+}
+
+void TreeData::flush() {
+  std::vector<std::shared_ptr<MetricBuffer>> threadBuffers;
+  {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    threadBuffers = buffers;
+  }
+  for (auto &buffer : threadBuffers)
+    mergeBuffer(*buffer);
+}
+
 void TreeData::enterScope(const Scope &scope) {
   // enterOp and addMetric maybe called from different threads
   std::unique_lock<std::shared_mutex> lock(mutex);
@@ -111,7 +179,24 @@ void TreeData::enterScope(const Scope &scope) {
   scopeIdToContextId[scope.scopeId] = contextId;
 }
 
-void TreeData::exitScope(const Scope &scope) {}
+void TreeData::exitScope(const Scope &scope) {
+  mergeBuffer(getThreadBuffer());
+  if (!isStreaming())
+    return;
+  // Only the thread that moves the window time forward writes the window
+  int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+  int64_t windowTime = nextWindowTime.load(std::memory_order_relaxed);
+  if (now < windowTime)
+    return;
+  int64_t next =
+      now +
+      std::chrono::duration_cast<std::chrono::nanoseconds>(streamInterval)
+          .count();
+  if (nextWindowTime.compare_exchange_strong(windowTime, next))
+    streamWindow();
+}
 
 size_t TreeData::addOp(size_t scopeId, const std::string &name) {
   std::unique_lock<std::shared_mutex> lock(mutex);
@@ -135,39 +220,46 @@ size_t TreeData::addOp(size_t scopeId, const std::string &name) {
 }
 
 void TreeData::addMetric(size_t scopeId, std::shared_ptr<Metric> metric) {
-  std::unique_lock<std::shared_mutex> lock(mutex);
-  auto scopeIdIt = scopeIdToContextId.find(scopeId);
-  // The profile data is deactivated, ignore the metric
-  if (scopeIdIt == scopeIdToContextId.end())
-    return;
-  auto contextId = scopeIdIt->second;
-  auto &node = tree->getNode(contextId);
-  if (node.metrics.find(metric->getKind()) == node.metrics.end())
-    node.metrics.emplace(metric->getKind(), metric);
-  else
-    node.metrics[metric->getKind()]->updateMetric(*metric);
+  auto &buffer = getThreadBuffer();
+  bool full = false;
+  {
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    auto &metrics = buffer.scopes[scopeId].metrics;
+    auto it = metrics.find(metric->getKind());
+    if (it == metrics.end())
+      metrics.emplace(metric->getKind(), metric);
+    else
+      it->second->updateMetric(*metric);
+    full = buffer.scopes.size() >= MaxBufferedScopes;
+  }
+  if (full)
+    mergeBuffer(buffer);
 }
 
 void TreeData::addMetrics(
     size_t scopeId, const std::map<std::string, MetricValueType> &metrics) {
-  std::unique_lock<std::shared_mutex> lock(mutex);
-  auto scopeIdIt = scopeIdToContextId.find(scopeId);
-  // The profile data is deactivated, ignore the metric
-  if (scopeIdIt == scopeIdToContextId.end())
-    return;
-  auto contextId = scopeIdIt->second;
-  auto &node = tree->getNode(contextId);
-  for (auto [metricName, metricValue] : metrics) {
-    if (node.flexibleMetrics.find(metricName) == node.flexibleMetrics.end()) {
-      node.flexibleMetrics.emplace(metricName,
-                                   FlexibleMetric(metricName, metricValue));
-    } else {
-      node.flexibleMetrics.at(metricName).updateValue(metricValue);
+  auto &buffer = getThreadBuffer();
+  bool full = false;
+  {
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    auto &flexibleMetrics = buffer.scopes[scopeId].flexibleMetrics;
+    for (auto [metricName, metricValue] : metrics) {
+      auto it = flexibleMetrics.find(metricName);
+      if (it == flexibleMetrics.end())
+        flexibleMetrics.emplace(metricName,
+                                FlexibleMetric(metricName, metricValue));
+      else
+        it->second.updateValue(metricValue);
     }
+    full = buffer.scopes.size() >= MaxBufferedScopes;
   }
+  if (full)
+    mergeBuffer(buffer);
 }
 
 void TreeData::clear() {
+  // Metrics of scopes that are about to be forgotten are still recorded.
+  flush();
   std::unique_lock<std::shared_mutex> lock(mutex);
   scopeIdToContextId.clear();
 }
@@ -281,6 +373,51 @@ void TreeData::dumpHatchet(std::ostream &os) const {
   os << std::endl << output.dump(4) << std::endl;
 }
 
+std::string TreeData::getWindowPath(size_t window) const {
+  return path + "." + std::to_string(window) + "." +
+         outputFormatToString(OutputFormat::Hatchet) + ".gz";
+}
+
+void TreeData::streamWindow() {
+  flush();
+  std::lock_guard<std::mutex> streamLock(streamMutex);
+  std::string window;
+  {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    std::ostringstream os;
+    dumpHatchet(os);
+    window = os.str();
+    // Nodes are kept, since scopes that are still active refer to them
+    tree->template walk<Tree::WalkPolicy::PreOrder>(
+        [](Tree::TreeNode &treeNode) {
+          treeNode.metrics.clear();
+          treeNode.flexibleMetrics.clear();
+        });
+  }
+  auto windowPath = getWindowPath(numWindows);
+  gzFile file = gzopen(windowPath.c_str(), "wb");
+  if (file == nullptr)
+    throw std::runtime_error("Failed to open " + windowPath);
+  int written = gzwrite(file, window.data(), window.size());
+  gzclose(file);
+  if (written != static_cast<int>(window.size()))
+    throw std::runtime_error("Failed to write " + windowPath);
+  if (numWindows >= maxStreamWindows)
+    std::remove(getWindowPath(numWindows - maxStreamWindows).c_str());
+  numWindows++;
+}
+
+void TreeData::dump(OutputFormat outputFormat) {
+  if (!isStreaming()) {
+    Data::dump(outputFormat);
+    return;
+  }
+  if (outputFormat != OutputFormat::Hatchet)
+    throw std::runtime_error("Streaming data only supports hatchet output");
+  // The last window holds the metrics recorded since the previous one
+  streamWindow();
+}
+
 void TreeData::doDump(std::ostream &os, OutputFormat outputFormat) const {
   if (outputFormat == OutputFormat::Hatchet) {
     dumpHatchet(os);
@@ -294,6 +431,18 @@ TreeData::TreeData(const std::string &path, ContextSource *contextSource)
   init();
 }
 
+TreeData::TreeData(const std::string &path, ContextSource *contextSource,
+                   std::chrono::milliseconds streamInterval,
+                   size_t maxStreamWindows)
+    : Data(path, contextSource), streamInterval(streamInterval),
+      maxStreamWindows(maxStreamWindows) {
+  init();
+  nextWindowTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       (std::chrono::steady_clock::now() + streamInterval)
+                           .time_since_epoch())
+                       .count();
+}
+
 TreeData::~TreeData() {}
 
 } // namespace proton
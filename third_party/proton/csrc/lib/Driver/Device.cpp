@@ -4,8 +4,24 @@
 
 #include "Utility/Errors.h"
 
+#include <sys/utsname.h>
+#include <thread>
+
 namespace proton {
 
+namespace {
+
+Device getCpuDevice(uint64_t index) {
+  struct utsname name;
+  std::string arch = uname(&name) == 0 ? name.machine : "";
+  // There is a single CPU device. Its compute units are hardware threads.
+  return Device(DeviceType::CPU, index, /*clockRate=*/0,
+                /*memoryClockRate=*/0, /*busWidth=*/0,
+                std::thread::hardware_concurrency(), arch);
+}
+
+} // namespace
+
 Device getDevice(DeviceType type, uint64_t index) {
   if (type == DeviceType::CUDA) {
     return cuda::getDevice(index);
@@ -13,6 +29,9 @@ Device getDevice(DeviceType type, uint64_t index) {
   if (type == DeviceType::HIP) {
     return hip::getDevice(index);
   }
+  if (type == DeviceType::CPU) {
+    return getCpuDevice(index);
+  }
   throw std::runtime_error("DeviceType not supported");
 }
 
@@ -21,6 +40,8 @@ const std::string getDeviceTypeString(DeviceType type) {
     return DeviceTraits<DeviceType::CUDA>::name;
   } else if (type == DeviceType::HIP) {
     return DeviceTraits<DeviceType::HIP>::name;
+  } else if (type == DeviceType::CPU) {
+    return DeviceTraits<DeviceType::CPU>::name;
   }
   throw std::runtime_error("DeviceType not supported");
 }
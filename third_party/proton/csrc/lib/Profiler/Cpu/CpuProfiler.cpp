@@ -0,0 +1,376 @@
+#include "Profiler/Cpu/CpuProfiler.h"
+#include "Data/Metric.h"
+#include "Driver/Device.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace proton {
+
+namespace {
+
+// Keep in sync with LaunchRecord in runtime_launch_trace.cpp of the CPU
+// backend.
+struct LaunchRecord {
+  const void *kernel;
+  uint64_t correlationId;
+  int64_t startNs;
+  int64_t endNs;
+  uint64_t numPrograms;
+  uint32_t gridX;
+  uint32_t gridY;
+  uint32_t gridZ;
+  int32_t numThreads;
+  int32_t numCounters;
+  uint64_t counters[8];
+};
+
+constexpr const char *RuntimeLibName = "libTritonCPURuntime.so";
+
+// DRAM traffic is estimated from LLC misses, each moving a cache line.
+constexpr const char *LlcMissesCounter = "llc_misses";
+constexpr uint64_t CacheLineSize = 64;
+
+// Correlation ids are scope ids shifted by one, zero means no scope.
+uint64_t toCorrelationId(size_t scopeId) { return scopeId + 1; }
+size_t toScopeId(uint64_t correlationId) { return correlationId - 1; }
+
+// Sample every 100us of CPU time of each thread running programs.
+constexpr uint64_t DefaultSamplingPeriodNs = 100000;
+
+// Run a program found in PATH with the arguments and return its standard
+// output, or an empty string if it can't be run. Arguments are passed as is,
+// without a shell, so paths may contain any characters.
+std::string runCommand(const std::vector<std::string> &args) {
+  std::vector<char *> argv;
+  for (const std::string &arg : args)
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0)
+    return "";
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+  posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+                                   O_WRONLY, 0);
+  pid_t pid;
+  bool spawned = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(),
+                              environ) == 0;
+  posix_spawn_file_actions_destroy(&actions);
+  close(fds[1]);
+  std::string output;
+  if (spawned) {
+    char buf[4096];
+    ssize_t size;
+    while ((size = read(fds[0], buf, sizeof(buf))) != 0) {
+      if (size > 0)
+        output.append(buf, size);
+      else if (errno != EINTR)
+        break;
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+  }
+  close(fds[0]);
+  return output;
+}
+
+// Source lines of code at offsets into a shared library, as
+// "file:line@function", or empty strings if the library has no line info for
+// them. Kernel libraries carry DWARF line tables emitted from the debug
+// info of kernels, see add_di_scope. Lines are looked up with addr2line.
+std::vector<std::string> getSourceLines(const std::string &lib,
+                                        const std::vector<uint64_t> &offsets) {
+  std::vector<std::string> lines;
+  constexpr size_t MaxOffsetsPerCall = 256;
+  for (size_t begin = 0; begin < offsets.size(); begin += MaxOffsetsPerCall) {
+    std::vector<std::string> args = {"addr2line", "-f", "-e", lib};
+    size_t end = std::min(offsets.size(), begin + MaxOffsetsPerCall);
+    for (size_t i = begin; i < end; ++i) {
+      std::ostringstream offset;
+      offset << "0x" << std::hex << offsets[i];
+      args.push_back(offset.str());
+    }
+    std::string output = runCommand(args);
+    // Each offset prints a function line and a "file:line" line.
+    std::istringstream ss(output);
+    std::string function, location;
+    for (size_t i = begin; i < end; ++i) {
+      if (!std::getline(ss, function) || !std::getline(ss, location)) {
+        lines.push_back("");
+        continue;
+      }
+      location = location.substr(0, location.find(' '));
+      auto colon = location.rfind(':');
+      bool known = location.rfind("??", 0) != 0 &&
+                   colon != std::string::npos && colon + 1 < location.size() &&
+                   location[colon + 1] != '?' && location[colon + 1] != '0';
+      lines.push_back(known ? location + "@" + function : "");
+    }
+  }
+  return lines;
+}
+
+} // namespace
+
+struct CpuProfiler::CpuProfilerPimpl {
+  CpuProfilerPimpl(CpuProfiler &profiler) : profiler(profiler) {}
+
+  void load() {
+    if (lib)
+      return;
+    // Reuse the runtime loaded by kernel launchers, so that the profiler sees
+    // the same launch trace.
+    lib = dlopen(RuntimeLibName, RTLD_NOLOAD | RTLD_LAZY);
+    if (!lib && !libPath.empty())
+      lib = dlopen((libPath + "/" + RuntimeLibName).c_str(),
+                   RTLD_LAZY | RTLD_GLOBAL);
+    if (!lib)
+      lib = dlopen(RuntimeLibName, RTLD_LAZY | RTLD_GLOBAL);
+    if (!lib)
+      throw std::runtime_error("Could not load `" + std::string(RuntimeLibName) +
+                               "`");
+    loadSymbol(enable, "triton_cpu_launch_trace_enable");
+    loadSymbol(enabled, "triton_cpu_launch_trace_enabled");
+    loadSymbol(position, "triton_cpu_launch_trace_position");
+    loadSymbol(read, "triton_cpu_launch_trace_read");
+    loadSymbol(setCorrelationId, "triton_cpu_launch_trace_set_correlation_id");
+    loadSymbol(perfEnable, "triton_cpu_perf_enable");
+    loadSymbol(perfEnabled, "triton_cpu_perf_enabled");
+    loadSymbol(perfNumCounters, "triton_cpu_perf_num_counters");
+    loadSymbol(perfCounterName, "triton_cpu_perf_counter_name");
+    loadSymbol(ipSamplingEnable, "triton_cpu_ip_sampling_enable");
+    loadSymbol(ipSamplingRead, "triton_cpu_ip_sampling_read");
+    counterNames.clear();
+    for (int32_t i = 0; i < perfNumCounters(); ++i)
+      counterNames.push_back(perfCounterName(i));
+  }
+
+  template <typename FnT> void loadSymbol(FnT &fn, const char *name) {
+    fn = reinterpret_cast<FnT>(dlsym(lib, name));
+    if (!fn)
+      throw std::runtime_error("Failed to load " + std::string(name) +
+                               " from " + RuntimeLibName);
+  }
+
+  // Attribute launches recorded since the last call to their scopes.
+  void processRecords() {
+    std::lock_guard<std::mutex> lock(mutex);
+    constexpr size_t BufferSize = 256;
+    LaunchRecord records[BufferSize];
+    size_t count;
+    do {
+      count = read(&cursor, records, BufferSize);
+      auto dataSet = profiler.getDataSet();
+      for (size_t i = 0; i < count; ++i) {
+        const auto &record = records[i];
+        if (record.correlationId == 0 || record.endNs < record.startNs)
+          continue;
+        auto scopeId = toScopeId(record.correlationId);
+        auto grid = std::to_string(record.gridX) + "x" +
+                    std::to_string(record.gridY) + "x" +
+                    std::to_string(record.gridZ);
+        std::map<std::string, MetricValueType> metrics = {
+            {"grid (pty)", grid},
+            {"num_threads (pty)", static_cast<uint64_t>(record.numThreads)}};
+        for (int32_t j = 0; j < record.numCounters &&
+                            j < static_cast<int32_t>(counterNames.size());
+             ++j) {
+          metrics[counterNames[j]] = record.counters[j];
+          if (counterNames[j] == LlcMissesCounter)
+            metrics["dram_bytes"] = record.counters[j] * CacheLineSize;
+        }
+        for (auto *data : dataSet) {
+          data->addMetric(scopeId,
+                          std::make_shared<KernelMetric>(
+                              static_cast<uint64_t>(record.startNs),
+                              static_cast<uint64_t>(record.endNs), 1, 0,
+                              static_cast<uint64_t>(DeviceType::CPU)));
+          data->addMetrics(scopeId, metrics);
+        }
+      }
+    } while (count == BufferSize);
+  }
+
+  // Return the source line of an instruction pointer, see getSourceLines.
+  const std::string &getSourceLine(uint64_t ip) {
+    static const std::string unknown;
+    auto it = ipToLine.find(ip);
+    return it == ipToLine.end() ? unknown : it->second;
+  }
+
+  // Look up source lines of instruction pointers that aren't cached yet,
+  // with a single addr2line run per library.
+  void resolveSourceLines(const std::vector<uint64_t> &ips) {
+    std::map<std::string, std::vector<uint64_t>> libIps;
+    for (uint64_t ip : ips) {
+      if (ipToLine.count(ip))
+        continue;
+      Dl_info info;
+      if (!dladdr(reinterpret_cast<void *>(ip), &info) || !info.dli_fname) {
+        ipToLine[ip] = "";
+        continue;
+      }
+      libIps[info.dli_fname].push_back(ip);
+    }
+    for (auto &[lib, ips] : libIps) {
+      Dl_info info;
+      dladdr(reinterpret_cast<void *>(ips.front()), &info);
+      auto base = reinterpret_cast<uint64_t>(info.dli_fbase);
+      std::vector<uint64_t> offsets;
+      for (uint64_t ip : ips)
+        offsets.push_back(ip - base);
+      auto lines = getSourceLines(lib, offsets);
+      for (size_t i = 0; i < ips.size(); ++i)
+        ipToLine[ips[i]] = lines[i];
+    }
+  }
+
+  // Attribute instruction pointers sampled since the last call to source
+  // lines under the scope. Samples without line info, e.g. in the runtime
+  // or libm, are attributed to the scope itself.
+  void processSamples(size_t scopeId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    constexpr size_t BufferSize = 256;
+    uint64_t ips[BufferSize];
+    uint64_t numSamples[BufferSize];
+    std::map<uint64_t, uint64_t> ipSamples;
+    size_t count;
+    do {
+      count = ipSamplingRead(ips, numSamples, BufferSize);
+      for (size_t i = 0; i < count; ++i)
+        ipSamples[ips[i]] += numSamples[i];
+    } while (count == BufferSize);
+    if (ipSamples.empty())
+      return;
+    std::vector<uint64_t> sampledIps;
+    for (auto [ip, samples] : ipSamples)
+      sampledIps.push_back(ip);
+    resolveSourceLines(sampledIps);
+    std::map<std::string, uint64_t> lineSamples;
+    for (auto [ip, samples] : ipSamples)
+      lineSamples[getSourceLine(ip)] += samples;
+    for (auto *data : profiler.getDataSet()) {
+      for (auto &[line, samples] : lineSamples) {
+        auto lineScopeId = line.empty() ? scopeId : data->addOp(scopeId, line);
+        data->addMetrics(lineScopeId, {{"num_samples", samples}});
+      }
+    }
+  }
+
+  CpuProfiler &profiler;
+  std::string libPath;
+  bool pcSamplingEnabled{false};
+  void *lib{nullptr};
+  void (*enable)(bool){nullptr};
+  bool (*enabled)(){nullptr};
+  uint64_t (*position)(){nullptr};
+  size_t (*read)(uint64_t *, LaunchRecord *, size_t){nullptr};
+  void (*setCorrelationId)(uint64_t){nullptr};
+  void (*perfEnable)(bool){nullptr};
+  bool (*perfEnabled)(){nullptr};
+  int32_t (*perfNumCounters)(){nullptr};
+  const char *(*perfCounterName)(int32_t){nullptr};
+  void (*ipSamplingEnable)(uint64_t){nullptr};
+  size_t (*ipSamplingRead)(uint64_t *, uint64_t *, size_t){nullptr};
+  // Source lines of sampled instruction pointers. Kernel libraries stay
+  // loaded once loaded, so addresses aren't reused for other code.
+  std::map<uint64_t, std::string> ipToLine;
+  // Names of hardware events in the order of LaunchRecord::counters.
+  std::vector<std::string> counterNames;
+
+  std::mutex mutex;
+  uint64_t cursor{0};
+  // Whether the trace and hardware event counting were enabled before the
+  // profiler started, e.g. for benchmarking.
+  bool wasEnabled{false};
+  bool wasPerfEnabled{false};
+};
+
+CpuProfiler::CpuProfiler() {
+  pImpl = std::make_unique<CpuProfilerPimpl>(*this);
+}
+
+CpuProfiler::~CpuProfiler() = default;
+
+CpuProfiler &CpuProfiler::setLibPath(const std::string &libPath) {
+  pImpl->libPath = libPath;
+  return *this;
+}
+
+CpuProfiler &CpuProfiler::enablePCSampling() {
+  pImpl->pcSamplingEnabled = true;
+  return *this;
+}
+
+CpuProfiler &CpuProfiler::disablePCSampling() {
+  pImpl->pcSamplingEnabled = false;
+  return *this;
+}
+
+bool CpuProfiler::isPCSamplingEnabled() const {
+  return pImpl->pcSamplingEnabled;
+}
+
+void CpuProfiler::startOp(const Scope &scope) {
+  for (auto data : getDataSet())
+    data->addOp(scope.scopeId, scope.name);
+  pImpl->setCorrelationId(toCorrelationId(scope.scopeId));
+}
+
+void CpuProfiler::stopOp(const Scope &scope) {
+  pImpl->setCorrelationId(0);
+  // Synchronous launches are complete at this point. Process them eagerly so
+  // that the launch trace doesn't wrap around between flushes.
+  pImpl->processRecords();
+  if (isPCSamplingEnabled())
+    pImpl->processSamples(scope.scopeId);
+}
+
+void CpuProfiler::doStart() {
+  pImpl->load();
+  pImpl->cursor = pImpl->position();
+  pImpl->wasEnabled = pImpl->enabled();
+  pImpl->wasPerfEnabled = pImpl->perfEnabled();
+  pImpl->enable(true);
+  pImpl->perfEnable(true);
+  if (isPCSamplingEnabled())
+    pImpl->ipSamplingEnable(DefaultSamplingPeriodNs);
+}
+
+void CpuProfiler::doFlush() {
+  if (pImpl->lib)
+    pImpl->processRecords();
+}
+
+void CpuProfiler::doStop() {
+  pImpl->processRecords();
+  if (!pImpl->wasEnabled)
+    pImpl->enable(false);
+  if (!pImpl->wasPerfEnabled)
+    pImpl->perfEnable(false);
+  if (isPCSamplingEnabled()) {
+    pImpl->ipSamplingEnable(0);
+    // Drop samples of launches outside of ops.
+    uint64_t ips[256], numSamples[256];
+    while (pImpl->ipSamplingRead(ips, numSamples, 256) == 256)
+      ;
+  }
+}
+
+} // namespace proton
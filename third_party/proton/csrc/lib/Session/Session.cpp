@@ -2,13 +2,21 @@
 #include "Context/Python.h"
 #include "Context/Shadow.h"
 #include "Data/TreeData.h"
+#include "Profiler/Cpu/CpuProfiler.h"
 #include "Profiler/Cupti/CuptiProfiler.h"
 #include "Profiler/Roctracer/RoctracerProfiler.h"
 #include "Utility/String.h"
 
+#include <cstdlib>
+
 namespace proton {
 
 namespace {
+int64_t getIntEnv(const char *name, int64_t defaultValue) {
+  const char *value = std::getenv(name);
+  return value ? std::atoll(value) : defaultValue;
+}
+
 Profiler *getProfiler(const std::string &name, const std::string &path) {
   if (proton::toLower(name) == "cupti") {
     return &CuptiProfiler::instance().setLibPath(path);
@@ -19,6 +27,12 @@ Profiler *getProfiler(const std::string &name, const std::string &path) {
   if (proton::toLower(name) == "roctracer") {
     return &RoctracerProfiler::instance();
   }
+  if (proton::toLower(name) == "cpu") {
+    return &CpuProfiler::instance().setLibPath(path).disablePCSampling();
+  }
+  if (proton::toLower(name) == "cpu_pcsampling") {
+    return &CpuProfiler::instance().setLibPath(path).enablePCSampling();
+  }
   throw std::runtime_error("Unknown profiler: " + name);
 }
 
@@ -28,6 +42,17 @@ std::unique_ptr<Data> makeData(const std::string &dataName,
   if (toLower(dataName) == "tree") {
     return std::make_unique<TreeData>(path, contextSource);
   }
+  if (toLower(dataName) == "stream") {
+    auto streamInterval = std::chrono::milliseconds(
+        getIntEnv("PROTON_STREAM_INTERVAL_MS", 10000));
+    auto maxStreamWindows = getIntEnv("PROTON_STREAM_WINDOWS", 16);
+    if (streamInterval.count() <= 0 || maxStreamWindows <= 0)
+      throw std::runtime_error(
+          "PROTON_STREAM_INTERVAL_MS and PROTON_STREAM_WINDOWS must be "
+          "positive");
+    return std::make_unique<TreeData>(path, contextSource, streamInterval,
+                                      maxStreamWindows);
+  }
   throw std::runtime_error("Unknown data: " + dataName);
 }
 
@@ -36,7 +61,11 @@ makeContextSource(const std::string &contextSourceName) {
   if (toLower(contextSourceName) == "shadow") {
     return std::make_unique<ShadowContextSource>();
   } else if (toLower(contextSourceName) == "python") {
-    return std::make_unique<PythonContextSource>();
+    auto sampleInterval = getIntEnv("PROTON_PYTHON_SAMPLE_INTERVAL", 1);
+    if (sampleInterval <= 0)
+      throw std::runtime_error(
+          "PROTON_PYTHON_SAMPLE_INTERVAL must be positive");
+    return std::make_unique<PythonContextSource>(sampleInterval);
   }
   throw std::runtime_error("Unknown context source: " + contextSourceName);
 }
@@ -84,24 +113,24 @@ std::unique_ptr<Session> SessionManager::makeSession(
 }
 
 void SessionManager::activateSession(size_t sessionId) {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   activateSessionImpl(sessionId);
 }
 
 void SessionManager::activateAllSessions() {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   for (auto iter : sessionActive) {
     activateSessionImpl(iter.first);
   }
 }
 
 void SessionManager::deactivateSession(size_t sessionId) {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   deActivateSessionImpl(sessionId);
 }
 
 void SessionManager::deactivateAllSessions() {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   for (auto iter : sessionActive) {
     deActivateSessionImpl(iter.first);
   }
@@ -145,7 +174,7 @@ size_t SessionManager::addSession(const std::string &path,
                                   const std::string &profilerPath,
                                   const std::string &contextSourceName,
                                   const std::string &dataName) {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   if (hasSession(path)) {
     auto sessionId = getSessionId(path);
     activateSessionImpl(sessionId);
@@ -160,7 +189,7 @@ size_t SessionManager::addSession(const std::string &path,
 
 void SessionManager::finalizeSession(size_t sessionId,
                                      OutputFormat outputFormat) {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   if (!hasSession(sessionId)) {
     return;
   }
@@ -170,7 +199,7 @@ void SessionManager::finalizeSession(size_t sessionId,
 }
 
 void SessionManager::finalizeAllSessions(OutputFormat outputFormat) {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   auto sessionIds = std::vector<size_t>{};
   for (auto &[sessionId, session] : sessions) {
     deActivateSessionImpl(sessionId);
@@ -183,7 +212,7 @@ void SessionManager::finalizeAllSessions(OutputFormat outputFormat) {
 }
 
 void SessionManager::enterScope(const Scope &scope) {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   for (auto iter : scopeInterfaceCounts) {
     auto [scopeInterface, count] = iter;
     if (count > 0) {
@@ -193,7 +222,7 @@ void SessionManager::enterScope(const Scope &scope) {
 }
 
 void SessionManager::exitScope(const Scope &scope) {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   for (auto iter : scopeInterfaceCounts) {
     auto [scopeInterface, count] = iter;
     if (count > 0) {
@@ -203,7 +232,7 @@ void SessionManager::exitScope(const Scope &scope) {
 }
 
 void SessionManager::enterOp(const Scope &scope) {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   for (auto iter : opInterfaceCounts) {
     auto [opInterface, count] = iter;
     if (count > 0) {
@@ -213,7 +242,7 @@ void SessionManager::enterOp(const Scope &scope) {
 }
 
 void SessionManager::exitOp(const Scope &scope) {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   for (auto iter : opInterfaceCounts) {
     auto [opInterface, count] = iter;
     if (count > 0) {
@@ -224,16 +253,16 @@ void SessionManager::exitOp(const Scope &scope) {
 
 void SessionManager::addMetrics(
     size_t scopeId, const std::map<std::string, MetricValueType> &metrics) {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_lock<std::shared_mutex> lock(mutex);
   for (auto [sessionId, active] : sessionActive) {
     if (active) {
-      sessions[sessionId]->data->addMetrics(scopeId, metrics);
+      sessions.at(sessionId)->data->addMetrics(scopeId, metrics);
     }
   }
 }
 
 void SessionManager::setState(std::optional<Context> context) {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   for (auto iter : contextSourceCounts) {
     auto [contextSource, count] = iter;
     if (count > 0) {
@@ -243,7 +272,7 @@ void SessionManager::setState(std::optional<Context> context) {
 }
 
 size_t SessionManager::getContextDepth(size_t sessionId) {
-  std::lock_guard<std::mutex> lock(mutex);
+  std::lock_guard<std::shared_mutex> lock(mutex);
   throwIfSessionNotInitialized(sessions, sessionId);
   return sessions[sessionId]->getContextDepth();
 }
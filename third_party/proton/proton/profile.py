@@ -17,6 +17,8 @@ def _select_backend() -> str:
         return "cupti"
     elif backend == "hip":
         return "roctracer"
+    elif backend == "cpu":
+        return "cpu"
     else:
         raise ValueError("No backend is available for the current target.")
 
@@ -30,6 +32,9 @@ def _get_backend_default_path(backend: str) -> str:
             # Get the default path for the cupti backend,
             # which is the most compatible with the current CUPTI header file triton is compiled with
             lib_path = str(pathlib.Path(__file__).parent.parent.absolute() / "backends" / "nvidia" / "lib" / "cupti")
+    elif backend in ("cpu", "cpu_pcsampling"):
+        # The directory of libTritonCPURuntime
+        lib_path = str(pathlib.Path(__file__).parent.parent.absolute() / "_C")
     return lib_path
 
 
@@ -66,13 +71,17 @@ def start(
         name (str, optional): The name (with path) of the profiling session.
                               If not provided, the default name is "~/proton.hatchet".
         backend (str, optional): The backend to use for profiling.
-                                 Available options are [None, "cupti", "cupti_pcsampling", "roctracer"].
+                                 Available options are [None, "cupti", "cupti_pcsampling", "roctracer", "cpu",
+                                 "cpu_pcsampling"].
                                  Defaults to None, which automatically selects the backend matching the current active runtime.
         context (str, optional): The context to use for profiling.
                                  Available options are ["shadow", "python"].
                                  Defaults to "shadow".
         data (str, optional): The data structure to use for profiling.
-                              Available options are ["tree"].
+                              Available options are ["tree", "stream"].
+                              "stream" writes metrics of long-running processes every PROTON_STREAM_INTERVAL_MS
+                              milliseconds (10000 by default) to compressed windows "<name>.<window>.hatchet.gz",
+                              keeping the last PROTON_STREAM_WINDOWS windows (16 by default).
                               Defaults to "tree".
         hook (str, optional): The hook to use for profiling.
                               Available options are [None, "triton"].
@@ -95,7 +104,9 @@ def start(
     backend_path = _get_backend_default_path(backend)
 
     set_profiling_on()
-    if hook and hook == "triton":
+    # The CPU backend has no tracing API reporting kernel names, it relies on
+    # the launch hook to attribute kernels to scopes.
+    if (hook and hook == "triton") or backend in ("cpu", "cpu_pcsampling"):
         register_triton_hook()
     return libproton.start(name, context, data, backend, backend_path)
 
@@ -1,6 +1,11 @@
 import argparse
 from collections import namedtuple
+import glob
+import gzip
+import io
 import json
+import os
+import re
 import pandas as pd
 try:
     import hatchet as ht
@@ -71,6 +76,57 @@ def get_raw_metrics(file):
     return gf, inclusive_metrics, exclusive_metrics, device_info
 
 
+def merge_databases(databases):
+    """Merge hatchet databases, e.g. windows of a stream, summing numeric metrics of matching frames."""
+
+    def merge_node(node, other):
+        for name, value in other["metrics"].items():
+            if name in node["metrics"] and not isinstance(value, str):
+                node["metrics"][name] += value
+            else:
+                node["metrics"].setdefault(name, value)
+        children = {child["frame"]["name"]: child for child in node["children"]}
+        for child in other["children"]:
+            if child["frame"]["name"] in children:
+                merge_node(children[child["frame"]["name"]], child)
+            else:
+                node["children"].append(child)
+                children[child["frame"]["name"]] = child
+
+    merged = databases[0]
+    for database in databases[1:]:
+        merge_node(merged[0], database[0])
+        for device_type, devices in database[1].items():
+            merged[1].setdefault(device_type, {}).update(devices)
+    return merged
+
+
+def get_stream_windows(file_name):
+    """Return the window files of a profile recorded with data="stream", from the oldest to the newest."""
+    prefix = file_name[:-len(".hatchet")] if file_name.endswith(".hatchet") else file_name
+    pattern = re.compile(re.escape(prefix) + r"\.(\d+)\.hatchet\.gz$")
+    windows = [(int(match.group(1)), path)
+               for path in glob.glob(glob.escape(prefix) + ".*.hatchet.gz")
+               if (match := pattern.match(path))]
+    return [path for _, path in sorted(windows)]
+
+
+def open_profile(file_name):
+    """Open a profile, which can be a hatchet file, a compressed window of a stream, or the name of a stream, whose
+    windows are merged."""
+    if file_name.endswith(".gz"):
+        return gzip.open(file_name, "rt")
+    if not os.path.exists(file_name):
+        windows = get_stream_windows(file_name)
+        if windows:
+            databases = []
+            for window in windows:
+                with gzip.open(window, "rt") as f:
+                    databases.append(json.load(f))
+            return io.StringIO(json.dumps(merge_databases(databases)))
+    return open(file_name, "r")
+
+
 def get_min_time_flops(df, device_info):
     min_time_flops = pd.DataFrame(0.0, index=df.index, columns=["min_time"])
     for device_type in device_info:
@@ -100,6 +156,9 @@ def get_min_time_flops(df, device_info):
                         max_flops = 383e12 / (width / 8)
                     elif arch == "gfx941" or arch == "gfx942":
                         max_flops = 2614.9e12 / (width / 8)
+                elif device_type == "CPU":
+                    # The peak throughput of CPUs is not known.
+                    continue
                 else:
                     raise ValueError(f"Unsupported device type: {device_type}")
                 min_time_flops.loc[idx, "min_time"] += device_frames[f"flops{width}"].fillna(0) / max_flops
@@ -109,6 +168,9 @@ def get_min_time_flops(df, device_info):
 def get_min_time_bytes(df, device_info):
     min_time_bytes = pd.DataFrame(0.0, index=df.index, columns=["min_time"])
     for device_type in device_info:
+        if device_type == "CPU":
+            # The peak bandwidth of CPUs is not known.
+            continue
         for device_index in device_info[device_type]:
             idx = df["device_id"] == device_index
             device_frames = df[idx]
@@ -162,6 +224,16 @@ def derive_metrics(gf, metrics, inclusive_metrics, exclusive_metrics, device_inf
             gf.dataframe["util"] = min_time_flops["min_time"].combine(min_time_bytes["min_time"], max) / time_sec
             gf.dataframe.loc[internal_frame_indices, "util"] = np.nan
             derived_metrics.append("util")
+        elif metric == "ipc":  # inclusive, hardware counters of the cpu backend
+            instructions = match_available_metrics("instructions", inclusive_metrics, exclusive_metrics)[0]
+            cycles = match_available_metrics("cycles", inclusive_metrics, exclusive_metrics)[0]
+            gf.dataframe["ipc (inc)"] = gf.dataframe[instructions] / gf.dataframe[cycles]
+            derived_metrics.append("ipc (inc)")
+        elif metric == "dram_byte/flop":  # inclusive, hardware counters of the cpu backend
+            dram_bytes = match_available_metrics("dram_bytes", inclusive_metrics, exclusive_metrics)[0]
+            flops = match_available_metrics("flops", inclusive_metrics, exclusive_metrics)[0]
+            gf.dataframe["dram_byte/flop (inc)"] = gf.dataframe[dram_bytes] / gf.dataframe[flops]
+            derived_metrics.append("dram_byte/flop (inc)")
         elif metric in derivable_metrics:  # flop<width>/s, <t/g>byte/s, inclusive
             derivable_metric = derivable_metrics[metric]
             metric_name = derivable_metric.name
@@ -272,7 +344,7 @@ def print_tree(gf, metrics, depth=100, format=None, print_sorted=False):
 
 
 def parse(metrics, filename, include=None, exclude=None, threshold=None):
-    with open(filename, "r") as f:
+    with open_profile(filename) as f:
         gf, inclusive_metrics, exclusive_metrics, device_info = get_raw_metrics(f)
         assert len(inclusive_metrics + exclusive_metrics) > 0, "No metrics found in the input file"
         gf.update_inclusive_columns()
@@ -283,7 +355,7 @@ def parse(metrics, filename, include=None, exclude=None, threshold=None):
 
 
 def show_metrics(file_name):
-    with open(file_name, "r") as f:
+    with open_profile(file_name) as f:
         _, inclusive_metrics, exclusive_metrics, _ = get_raw_metrics(f)
         print("Available inclusive metrics:")
         if inclusive_metrics:
@@ -313,6 +385,8 @@ Derived metrics can be created when source metrics are available.
 - flop[<8/16/32/64>]/s, gflop[<8/16/32/64>]/s, tflop[<8/16/32/64>]/s: flops / time
 - byte/s, gbyte/s, tbyte/s: bytes / time
 - util: max(sum(flops<width>) / peak_flops<width>_time, sum(bytes) / peak_bandwidth_time)
+- ipc: instructions / cycles, hardware counters of the cpu backend
+- dram_byte/flop: dram_bytes / flops, where dram_bytes are estimated from LLC misses of the cpu backend
 - <metric>/%%: frame(metric) / sum(metric). Only availble for inclusive metrics (e.g. time)
 """,
     )
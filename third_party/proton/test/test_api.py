@@ -146,6 +146,53 @@ def test_scope_metrics(tmp_path: pathlib.Path):
             assert child["metrics"]["b"] == 1.0
 
 
+def test_scope_metrics_threads(tmp_path: pathlib.Path):
+    import threading
+    temp_file = tmp_path / "test_scope_metrics_threads.hatchet"
+    proton.start(str(temp_file.with_suffix("")))
+    num_threads, num_scopes = 8, 2000
+
+    def work():
+        for _ in range(num_scopes):
+            with proton.scope("test0", {"a": 1.0}):
+                pass
+
+    threads = [threading.Thread(target=work) for _ in range(num_threads)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    proton.finalize()
+    with temp_file.open() as f:
+        data = json.load(f)
+    # Metrics buffered by each thread are all merged into the same scope.
+    assert len(data[0]["children"]) == 1
+    assert data[0]["children"][0]["metrics"]["a"] == num_threads * num_scopes
+
+
+def test_scope_metrics_stream(tmp_path: pathlib.Path, monkeypatch):
+    import time
+    from triton.profiler.viewer import get_stream_windows, open_profile
+    monkeypatch.setenv("PROTON_STREAM_INTERVAL_MS", "1")
+    monkeypatch.setenv("PROTON_STREAM_WINDOWS", "4")
+    temp_file = tmp_path / "test_scope_metrics_stream.hatchet"
+    proton.start(str(temp_file.with_suffix("")), data="stream")
+    for _ in range(8):
+        time.sleep(0.002)
+        with proton.scope("test0", {"a": 1.0}):
+            pass
+    proton.finalize()
+    # Every scope ends a window and finalize writes an empty one. Only the last windows are kept, each with the
+    # metrics recorded since the previous one.
+    windows = get_stream_windows(str(temp_file))
+    assert len(windows) == 4
+    assert not temp_file.exists()
+    with open_profile(str(temp_file)) as f:
+        data = json.load(f)
+    assert len(data[0]["children"]) == 1
+    assert data[0]["children"][0]["metrics"]["a"] == 3.0
+
+
 def test_scope_properties(tmp_path: pathlib.Path):
     temp_file = tmp_path / "test_scope_properties.hatchet"
     proton.start(str(temp_file.with_suffix("")))
@@ -1,3 +1,4 @@
+import json
 import pathlib
 import pytest
 
@@ -41,6 +42,50 @@ def test_context(source: str, tmp_path: pathlib.Path):
     assert temp_file.exists()
 
 
+def test_sampled_python_context(tmp_path: pathlib.Path, monkeypatch):
+    monkeypatch.setenv("PROTON_PYTHON_SAMPLE_INTERVAL", "4")
+    temp_file = tmp_path / "test_sampled_python_context.hatchet"
+    session_id = libproton.start(str(temp_file.with_suffix("")), "python", "tree", _select_backend(), "")
+    depths = [libproton.get_context_depth(session_id) for _ in range(8)]
+    libproton.finalize(session_id, "hatchet")
+    assert len(set(depths)) == 1 and depths[0] > 0
+    assert temp_file.exists()
+
+
+def test_sampled_python_context_paths(tmp_path: pathlib.Path, monkeypatch):
+    monkeypatch.setenv("PROTON_PYTHON_SAMPLE_INTERVAL", "4")
+    temp_file = tmp_path / "test_sampled_python_context_paths.hatchet"
+    session_id = libproton.start(str(temp_file.with_suffix("")), "python", "tree", _select_backend(), "")
+
+    def record():
+        # The call site of all captures.
+        scope_id = libproton.record_scope()
+        libproton.enter_scope(scope_id, "scope")
+        libproton.exit_scope(scope_id, "scope")
+
+    def walked_path():
+        record()
+
+    def skipped_path():
+        record()
+
+    # The first capture from the call site walks the stack, the next three are attributed to its path.
+    walked_path()
+    for _ in range(3):
+        skipped_path()
+    libproton.finalize(session_id, "hatchet")
+
+    def frame_names(node):
+        yield node["frame"]["name"]
+        for child in node.get("children", []):
+            yield from frame_names(child)
+
+    with temp_file.open() as f:
+        names = list(frame_names(json.load(f)[0]))
+    assert any("walked_path" in name for name in names)
+    assert not any("skipped_path" in name for name in names)
+
+
 def test_session(tmp_path: pathlib.Path):
     temp_file = tmp_path / "test_session.hatchet"
     session_id = libproton.start(str(temp_file.with_suffix("")), "shadow", "tree", _select_backend(), "")
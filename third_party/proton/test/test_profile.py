@@ -316,3 +316,56 @@ def test_multiple_sessions(tmp_path: pathlib.Path):
     scope0_count = int(data[0]["children"][0]["children"][0]["metrics"]["count"])
     scope1_count = int(data[0]["children"][1]["children"][0]["metrics"]["count"])
     assert scope0_count + scope1_count == 3
+
+
+@pytest.mark.skipif(triton.runtime.driver.active.get_current_target().backend != "cpu", reason="CPU profiler test")
+def test_cpu_triton(tmp_path: pathlib.Path):
+
+    @triton.jit
+    def foo(x, y):
+        tl.store(y, tl.load(x))
+
+    x = torch.tensor([2], device="cpu")
+    y = torch.zeros_like(x)
+    temp_file = tmp_path / "test_cpu_triton.hatchet"
+    proton.start(str(temp_file.with_suffix("")))
+    with proton.scope("test0"):
+        foo[(4, )](x, y)
+    proton.finalize()
+    with temp_file.open() as f:
+        data = json.load(f)
+    assert data[0]["children"][0]["frame"]["name"] == "test0"
+    kernel = data[0]["children"][0]["children"][0]
+    assert kernel["frame"]["name"] == "foo"
+    assert kernel["metrics"]["time (ns)"] > 0
+    assert kernel["metrics"]["grid"] == "4x1x1"
+    assert "CPU" in data[1]
+
+
+@pytest.mark.skipif(triton.runtime.driver.active.get_current_target().backend != "cpu", reason="CPU profiler test")
+def test_cpu_pcsampling(tmp_path: pathlib.Path):
+    import os
+    if os.environ.get("PROTON_SKIP_PC_SAMPLING_TEST", "0") == "1":
+        pytest.skip("PC sampling test is disabled")
+
+    @triton.jit
+    def foo(x, y, size: tl.constexpr):
+        offs = tl.arange(0, size)
+        for _ in range(20000):
+            tl.store(y + offs, tl.load(x + offs) + 1.0)
+
+    x = torch.ones((1024, ), device="cpu", dtype=torch.float32)
+    y = torch.zeros_like(x)
+    temp_file = tmp_path / "test_cpu_pcsampling.hatchet"
+    proton.start(str(temp_file.with_suffix("")), backend="cpu_pcsampling")
+    with proton.scope("test"):
+        foo[(4, )](x, y, x.size()[0])
+    proton.finalize()
+    with temp_file.open() as f:
+        data = json.load(f)
+    kernel = data[0]["children"][0]["children"][0]
+    assert kernel["frame"]["name"] == "foo"
+    assert kernel["metrics"]["num_samples"] > 0
+    # Samples in the kernel are attributed to its source lines.
+    lines = [child["frame"]["name"] for child in kernel["children"]]
+    assert any("test_profile.py:" in line and line.endswith("@foo") for line in lines)
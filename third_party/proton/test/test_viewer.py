@@ -1,6 +1,6 @@
 import pytest
 import subprocess
-from triton.profiler.viewer import get_min_time_flops, get_min_time_bytes, get_raw_metrics, format_frames, derive_metrics, filter_frames, parse
+from triton.profiler.viewer import get_min_time_flops, get_min_time_bytes, get_raw_metrics, format_frames, derive_metrics, filter_frames, parse, merge_databases
 from triton.profiler.hook import COMPUTE_METADATA_SCOPE_NAME
 import numpy as np
 
@@ -197,3 +197,19 @@ def test_flops_derivation():
         },
         sample_file=cuda_example_file,
     )
+
+
+def test_merge_databases():
+
+    def window(time, device_id):
+        return [{
+            "frame": {"name": "ROOT", "type": "function"}, "metrics": {"time (ns)": 0}, "children": [{
+                "frame": {"name": "kernel", "type": "function"}, "metrics":
+                {"time (ns)": time, "count": 1, "device_id": device_id}, "children": []
+            }]
+        }, {"CPU": {device_id: {"arch": "x86_64"}}}]
+
+    merged = merge_databases([window(10, "0"), window(20, "1")])
+    kernel = merged[0]["children"][0]
+    assert kernel["metrics"] == {"time (ns)": 30, "count": 2, "device_id": "0"}
+    assert set(merged[1]["CPU"]) == {"0", "1"}
@@ -514,6 +514,20 @@ TEST_F(LinearLayoutTest, InvertAndCompose_BroadcastedDims2) {
   EXPECT_EQ(c.compose(b), a.transposeOuts(llvm::to_vector(b.getOutDimNames())));
 }
 
+TEST_F(LinearLayoutTest, InvertAndCompose_Repeated) {
+  LinearLayout a({{S("in1"), {{1}, {2}}}, {S("in2"), {{0}}}}, {S("out")});
+  LinearLayout b({{S("in3"), {{2}, {1}}}, {S("in4"), {{0}}}}, {S("out")});
+  LinearLayout c = a.invertAndCompose(b);
+  EXPECT_EQ(a.invertAndCompose(b), c);
+  // Layouts that differ only in out dim sizes have results of their own.
+  LinearLayout a2({{S("in1"), {{1}, {2}}}, {S("in2"), {{0}}}}, {{S("out"), 8}},
+                  /*requireSurjective=*/false);
+  LinearLayout b2({{S("in3"), {{2}, {1}, {4}}}, {S("in4"), {{0}}}},
+                  {S("out")});
+  LinearLayout c2 = a2.invertAndCompose(b2);
+  EXPECT_EQ(c2.compose(b2), a2);
+}
+
 TEST_F(LinearLayoutTest, InvertAndCompose_IdentityInDim) {
   SmallVector<StringAttr> outDims = {S("dim0"), S("dim1"), S("dim2"),
                                      S("dim3"), S("dim4"), S("dim5"),